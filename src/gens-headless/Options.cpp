@@ -0,0 +1,572 @@
+/***************************************************************************
+ * gens-headless: Gens/GS II headless frontend.                            *
+ * Options.cpp: Command line option parser.                                *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "Options.hpp"
+
+// LibGens
+using LibGens::MdFb;
+using LibGens::SysVersion;
+
+// C includes.
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#ifndef ECANCELED
+#define ECANCELED 158
+#endif
+
+// C++ includes.
+#include <string>
+using std::string;
+
+// popt
+#include <popt.h>
+
+namespace GensHeadless {
+
+class OptionsPrivate
+{
+	public:
+		OptionsPrivate();
+
+	private:
+		friend class Options;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add GensHeadless-specific version of Q_DISABLE_COPY().
+		OptionsPrivate(const OptionsPrivate &);
+		OptionsPrivate &operator=(const OptionsPrivate &);
+
+	public:
+		/**
+		 * Reset all options to their default values.
+		 */
+		void reset(void);
+
+	public:
+		// NOTE: bool values are ints for compatibility
+		// with popt. The accessor functions normalize
+		// the ints to bool.
+		string rom_filename;		// ROM to load.
+		string tmss_rom_filename;	// TMSS ROM image.
+
+		// Run options.
+		int frames;			// Number of frames to run.
+		int fast;			// Use execFrameFast()?
+
+		// Audio options.
+		int sound_freq;			// Sound frequency.
+		int stereo;			// Stereo audio?
+
+		// Emulation options.
+		int sprite_limits;		// Enable sprite limits?
+		int auto_fix_checksum;		// Auto fix checksum?
+		SysVersion::RegionCode_t region;	// Region code.
+		MdFb::ColorDepth bpp;		// Color depth. (15, 16, 32)
+
+		// Output options.
+		string dump_frames_dir;		// Framebuffer dump directory.
+		string dump_audio_filename;	// Audio dump file.
+		string dump_vgm_filename;	// VGM register log.
+		string dump_gym_filename;	// GYM register log.
+		string dump_wav_filename;	// WAV audio capture.
+		string dump_video_filename;	// AVI video capture.
+		int video_drop;			// Drop video frames instead of stalling?
+		string save_state_filename;	// Savestate to write after the last frame.
+		int dump_interval;		// Dump interval, in frames.
+		int hash;			// Print hashes?
+};
+
+/** OptionsPrivate **/
+
+OptionsPrivate::OptionsPrivate()
+{
+	// Reset the options to the default values.
+	reset();
+}
+
+/**
+ * Reset all options to their default values.
+ */
+void OptionsPrivate::reset(void)
+{
+	rom_filename.clear();
+	tmss_rom_filename.clear();
+
+	// Run options.
+	frames = 600;
+	fast = false;
+
+	// Audio options.
+	sound_freq = 44100;
+	stereo = true;
+
+	// Emulation options.
+	sprite_limits = true;
+	auto_fix_checksum = false;
+	region = SysVersion::REGION_AUTO;
+	bpp = MdFb::BPP_32;
+
+	// Output options.
+	dump_frames_dir.clear();
+	dump_audio_filename.clear();
+	dump_vgm_filename.clear();
+	dump_gym_filename.clear();
+	dump_wav_filename.clear();
+	dump_video_filename.clear();
+	video_drop = false;
+	save_state_filename.clear();
+	dump_interval = 0;
+	hash = false;
+}
+
+/** Options **/
+
+Options::Options()
+	: d(new OptionsPrivate())
+{ }
+
+Options::~Options()
+{
+	delete d;
+}
+
+/**
+ * Reset all options to their default values.
+ */
+void Options::reset(void)
+{
+	d->reset();
+}
+
+// TODO: Improve these.
+static void print_prg_info(void)
+{
+	fprintf(stderr, "gens-headless: Gens/GS II headless frontend.\n");
+}
+
+static void print_gpl(void)
+{
+	fprintf(stderr,
+		"This program is free software; you can redistribute it and/or modify it\n"
+		"under the terms of the GNU General Public License as published by the\n"
+		"Free Software Foundation; either version 2 of the License, or (at your\n"
+		"option) any later version.\n"
+		"\n"
+		"This program is distributed in the hope that it will be useful, but\n"
+		"WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+		"MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+		"GNU General Public License for more details.\n"
+		"\n"
+		"You should have received a copy of the GNU General Public License along\n"
+		"with this program; if not, write to the Free Software Foundation, Inc.,\n"
+		"51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.\n");
+}
+
+static void print_help(const poptContext con)
+{
+	print_prg_info();
+	fputc('\n', stderr);
+	// NOTE: poptPrintHelp() only prints the filename portion of argv[0].
+	poptPrintHelp(con, stderr, 0);
+}
+
+/**
+ * Parse command line arguments using popt.
+ * @param argc
+ * @param argv
+ * @return 0 if parsed successfully; non-zero on error.
+ * Some error codes:
+ * - -EINVAL: invalid arguments
+ * - -ECANCELED: operation canceled
+ *   - occurs if user specifies something like --help, which exits immediately.
+ */
+int Options::parse(int argc, const char *argv[])
+{
+	if (!argv) {
+		// Invalid arguments.
+		return -EINVAL;
+	}
+
+	// Reset the options.
+	reset();
+
+	// Temporary internal option variables.
+	// Required for strings, since popt uses
+	// const char*, so we have to copy them
+	// to standard C++ strings later.
+	struct {
+		const char *rom_filename;
+		const char *tmss_rom_filename;
+		const char *region;
+		const char *dump_frames_dir;
+		const char *dump_audio_filename;
+		const char *dump_vgm_filename;
+		const char *dump_gym_filename;
+		const char *dump_wav_filename;
+		const char *dump_video_filename;
+		const char *save_state_filename;
+		int bpp;
+	} tmp;
+	memset(&tmp, 0, sizeof(tmp));
+	tmp.bpp = 32;
+
+	// popt: help options table.
+	struct poptOption helpOptionsTable[] = {
+		{"help", '?', POPT_ARG_NONE, NULL, '?', "Show this help message", NULL},
+		{"usage", '\0', POPT_ARG_NONE, NULL, 'u', "Display brief usage message", NULL},
+		{"version", 'V', POPT_ARG_NONE, NULL, 'V', "Display version information", NULL},
+		POPT_TABLEEND
+	};
+
+	// popt: run options table.
+	struct poptOption runOptionsTable[] = {
+		{"frames", 'n', POPT_ARG_INT, &d->frames, 0,
+			"  Number of frames to run. (default is 600)", "N"},
+		{"fast", '\0', POPT_ARG_VAL, &d->fast, 1,
+			"  Don't render frames that aren't dumped or hashed.", NULL},
+		POPT_TABLEEND
+	};
+
+	// popt: audio options table.
+	struct poptOption audioOptionsTable[] = {
+		{"frequency", '\0', POPT_ARG_INT, &d->sound_freq, 0,
+			"  Audio frequency.", "FREQ"},
+		{"mono", '\0', POPT_ARG_VAL, &d->stereo, 0,
+			"  Use monaural audio.", NULL},
+		{"stereo", '\0', POPT_ARG_VAL, &d->stereo, 1,
+			"* Use stereo audio.", NULL},
+		POPT_TABLEEND
+	};
+
+	// popt: emulation options table.
+	struct poptOption emulationOptionsTable[] = {
+		{"sprite-limits", '\0', POPT_ARG_VAL, &d->sprite_limits, 1,
+			"* Enable sprite limits.", NULL},
+		{"no-sprite-limits", '\0', POPT_ARG_VAL, &d->sprite_limits, 0,
+			"  Disable sprite limits.", NULL},
+		{"auto-fix-checksum", '\0', POPT_ARG_VAL, &d->auto_fix_checksum, 1,
+			"  Automatically fix checksums.", NULL},
+		{"no-auto-fix-checksum", '\0', POPT_ARG_VAL, &d->auto_fix_checksum, 0,
+			"* Don't automatically fix checksums.", NULL},
+		{"region", '\0', POPT_ARG_STRING, &tmp.region, 0,
+			"  Set the region code: J,U,E,Asia,Auto (default is auto)", "REGION"},
+		{"bpp", '\0', POPT_ARG_INT, &tmp.bpp, 0,
+			"  Set the internal color depth. (15, 16, 32)", "BPP"},
+		POPT_TABLEEND
+	};
+
+	// popt: output options table.
+	struct poptOption outputOptionsTable[] = {
+		{"dump-frames", '\0', POPT_ARG_STRING, &tmp.dump_frames_dir, 0,
+			"  Dump framebuffers to DIR as PNG images.", "DIR"},
+		{"dump-audio", '\0', POPT_ARG_STRING, &tmp.dump_audio_filename, 0,
+			"  Dump audio to FILE as raw 16-bit PCM.", "FILE"},
+		{"dump-vgm", '\0', POPT_ARG_STRING, &tmp.dump_vgm_filename, 0,
+			"  Log YM2612 and PSG register writes to FILE in VGM format.", "FILE"},
+		{"dump-gym", '\0', POPT_ARG_STRING, &tmp.dump_gym_filename, 0,
+			"  Log YM2612 and PSG register writes to FILE in GYM format.", "FILE"},
+		{"dump-wav", '\0', POPT_ARG_STRING, &tmp.dump_wav_filename, 0,
+			"  Dump audio to FILE as a WAV file.", "FILE"},
+		{"dump-video", '\0', POPT_ARG_STRING, &tmp.dump_video_filename, 0,
+			"  Dump video and audio to FILE as a lossless AVI file.", "FILE"},
+		{"video-drop", '\0', POPT_ARG_VAL, &d->video_drop, 1,
+			"  Drop video frames if the encoder falls behind.", NULL},
+		{"video-stall", '\0', POPT_ARG_VAL, &d->video_drop, 0,
+			"* Wait for the encoder if it falls behind.", NULL},
+		{"save-state", '\0', POPT_ARG_STRING, &tmp.save_state_filename, 0,
+			"  Save a ZOMG savestate to FILE after the last frame.", "FILE"},
+		{"dump-interval", '\0', POPT_ARG_INT, &d->dump_interval, 0,
+			"  Dump framebuffers and hashes every N frames. (default is last frame only)", "N"},
+		{"hash", '\0', POPT_ARG_VAL, &d->hash, 1,
+			"  Print framebuffer, audio, and state CRC32s to stdout.", NULL},
+		POPT_TABLEEND
+	};
+
+	// popt: main options table.
+	struct poptOption optionsTable[] = {
+		{"tmss-rom", '\0', POPT_ARG_STRING, &tmp.tmss_rom_filename, 0,
+			"TMSS ROM filename.", "FILENAME"},
+		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, runOptionsTable, 0,
+			"Run options:", NULL},
+		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, audioOptionsTable, 0,
+			"Audio options: (* indicates default)", NULL},
+		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, emulationOptionsTable, 0,
+			"Emulation options: (* indicates default)", NULL},
+		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, outputOptionsTable, 0,
+			"Output options:", NULL},
+		{NULL, '\0', POPT_ARG_INCLUDE_TABLE, helpOptionsTable, 0,
+			"Help options:", NULL},
+		POPT_TABLEEND
+	};
+
+	// Create the popt context.
+	poptContext optCon = poptGetContext(NULL, argc, argv, optionsTable, 0);
+	poptSetOtherOptionHelp(optCon, "[OPTIONS] rom_file");
+	if (argc < 2) {
+		poptPrintUsage(optCon, stderr, 0);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	// popt: Alias '-h' to '-?'.
+	// NOTE: help_argv must be free()able, so it
+	// can't be static or allocated on the stack.
+	{
+		const char **help_argv = (const char**)malloc(sizeof(const char*) * 2);
+		help_argv[0] = "-?";
+		help_argv[1] = NULL;
+		struct poptAlias help_alias = {NULL, 'h', 1, help_argv};
+		poptAddAlias(optCon, help_alias, 0);
+	}
+
+	// Process options.
+	int c;
+	while ((c = poptGetNextOpt(optCon)) >= 0) {
+		switch (c) {
+			case 'V':
+				print_prg_info();
+				fputc('\n', stderr);
+				print_gpl();
+				poptFreeContext(optCon);
+				return -ECANCELED;
+
+			case '?':
+				print_help(optCon);
+				poptFreeContext(optCon);
+				return -ECANCELED;
+
+			case 'u':
+				poptPrintUsage(optCon, stderr, 0);
+				poptFreeContext(optCon);
+				return -ECANCELED;
+
+			default:
+				break;
+		}
+	}
+
+	if (c < -1) {
+		// An error occurred during option processing.
+		switch (c) {
+			case POPT_ERROR_BADOPT:
+				// Unrecognized option.
+				fprintf(stderr, "%s: unrecognized option '%s'\n"
+					"Try `%s --help` for more information.\n",
+					argv[0], poptBadOption(optCon, POPT_BADOPTION_NOALIAS), argv[0]);
+				break;
+			default:
+				// Other error.
+				fprintf(stderr, "%s: '%s': %s\n"
+					"Try `%s --help` for more information.\n",
+					argv[0], poptBadOption(optCon, POPT_BADOPTION_NOALIAS),
+					poptStrerror(c), argv[0]);
+				break;
+		}
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	// Process arguments to ensure that they're valid.
+
+	// Filenames.
+	if (tmp.tmss_rom_filename != nullptr)
+		d->tmss_rom_filename = string(tmp.tmss_rom_filename);
+	if (tmp.dump_frames_dir != nullptr)
+		d->dump_frames_dir = string(tmp.dump_frames_dir);
+	if (tmp.dump_audio_filename != nullptr)
+		d->dump_audio_filename = string(tmp.dump_audio_filename);
+	if (tmp.dump_vgm_filename != nullptr)
+		d->dump_vgm_filename = string(tmp.dump_vgm_filename);
+	if (tmp.dump_gym_filename != nullptr)
+		d->dump_gym_filename = string(tmp.dump_gym_filename);
+	if (tmp.dump_wav_filename != nullptr)
+		d->dump_wav_filename = string(tmp.dump_wav_filename);
+	if (tmp.dump_video_filename != nullptr)
+		d->dump_video_filename = string(tmp.dump_video_filename);
+	if (tmp.save_state_filename != nullptr)
+		d->save_state_filename = string(tmp.save_state_filename);
+
+	// Region code.
+	if (tmp.region != nullptr) {
+		if (!strcasecmp(tmp.region, "u") ||
+		    !strcasecmp(tmp.region, "usa"))
+		{
+			d->region = SysVersion::REGION_US_NTSC;
+		}
+		else if (!strcasecmp(tmp.region, "j") ||
+			 !strcasecmp(tmp.region, "jp") ||
+			 !strcasecmp(tmp.region, "jpn") ||
+			 !strcasecmp(tmp.region, "japan"))
+		{
+			d->region = SysVersion::REGION_JP_NTSC;
+		}
+		else if (!strcasecmp(tmp.region, "e") ||
+			 !strcasecmp(tmp.region, "eu") ||
+			 !strcasecmp(tmp.region, "eur") ||
+			 !strcasecmp(tmp.region, "europe") ||
+			 !strcasecmp(tmp.region, "pal"))
+		{
+			d->region = SysVersion::REGION_EU_PAL;
+		}
+		else if (!strcasecmp(tmp.region, "asia"))
+		{
+			d->region = SysVersion::REGION_ASIA_PAL;
+		}
+		else if (!strcasecmp(tmp.region, "auto"))
+		{
+			d->region = SysVersion::REGION_AUTO;
+		}
+		else
+		{
+			// Invalid region code.
+			fprintf(stderr, "%s: '--region=%s': invalid region code\n"
+				"Valid options are J, U, E, Asia, and Auto.\n"
+				"Try `%s --help` for more information.\n",
+				argv[0], tmp.region, argv[0]);
+			poptFreeContext(optCon);
+			return -EINVAL;
+		}
+	}
+
+	// Verify certain options.
+	d->bpp = MdFb::bppToColorDepth(tmp.bpp);
+	if (d->bpp < 0 || d->bpp >= MdFb::BPP_MAX) {
+		// Invalid color depth.
+		fprintf(stderr, "%s: '--bpp=%d': invalid color depth\n"
+			"Valid options are 15, 16, and 32.\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], tmp.bpp, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	if (d->frames <= 0) {
+		fprintf(stderr, "%s: '--frames=%d': frame count must be positive\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], d->frames, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	if (d->dump_interval < 0) {
+		fprintf(stderr, "%s: '--dump-interval=%d': interval cannot be negative\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], d->dump_interval, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	if (!d->dump_vgm_filename.empty() && !d->dump_gym_filename.empty()) {
+		fprintf(stderr, "%s: '--dump-vgm' and '--dump-gym' cannot be used together\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	// Get the ROM filename.
+	tmp.rom_filename = poptGetArg(optCon);
+	if (tmp.rom_filename != nullptr) {
+		// ROM filename was specified.
+		d->rom_filename = string(tmp.rom_filename);
+	} else {
+		// A ROM is required, but wasn't specified.
+		fprintf(stderr, "%s: no ROM filename specified\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	// Check if too many filenames were specified.
+	if (poptPeekArg(optCon) != NULL) {
+		// Too many filenames were specified.
+		fprintf(stderr, "%s: too many parameters\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	// Done parsing arguments.
+	poptFreeContext(optCon);
+	return 0;
+}
+
+/** Parameter accessors. **/
+
+#define ACCESSOR(type, name) \
+type Options::name(void) const \
+{ \
+	return (type)d->name; \
+}
+
+#define ACCESSOR_BOOL(name) \
+bool Options::name(void) const \
+{ \
+	return !!d->name; \
+}
+
+/** General options. **/
+ACCESSOR(string, rom_filename)
+ACCESSOR(string, tmss_rom_filename)
+
+/**
+ * Is TMSS enabled?
+ * This option is implied by the presence of a TMSS ROM filename.
+ * @return True if TMSS is enabled; false if not.
+ */
+bool Options::is_tmss_enabled(void) const
+{
+	return !d->tmss_rom_filename.empty();
+}
+
+/** Run options. **/
+ACCESSOR(int, frames)
+ACCESSOR_BOOL(fast)
+
+/** Audio options. **/
+ACCESSOR(int, sound_freq)
+ACCESSOR_BOOL(stereo)
+
+/** Emulation options. **/
+ACCESSOR_BOOL(sprite_limits)
+ACCESSOR_BOOL(auto_fix_checksum)
+ACCESSOR(SysVersion::RegionCode_t, region)
+ACCESSOR(MdFb::ColorDepth, bpp)
+
+/** Output options. **/
+ACCESSOR(string, dump_frames_dir)
+ACCESSOR(string, dump_audio_filename)
+ACCESSOR(string, dump_vgm_filename)
+ACCESSOR(string, dump_gym_filename)
+ACCESSOR(string, dump_wav_filename)
+ACCESSOR(string, dump_video_filename)
+ACCESSOR_BOOL(video_drop)
+ACCESSOR(string, save_state_filename)
+ACCESSOR(int, dump_interval)
+ACCESSOR_BOOL(hash)
+
+}
@@ -0,0 +1,208 @@
+/***************************************************************************
+ * gens-headless: Gens/GS II headless frontend.                            *
+ * Options.hpp: Command line option parser.                                *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __GENS_HEADLESS_OPTIONS_HPP__
+#define __GENS_HEADLESS_OPTIONS_HPP__
+
+// LibGens
+#include "libgens/Util/MdFb.hpp"
+#include "libgens/EmuContext/SysVersion.hpp"
+
+// C++ includes.
+#include <string>
+
+namespace GensHeadless {
+
+class OptionsPrivate;
+class Options
+{
+	public:
+		Options();
+		~Options();
+
+	private:
+		friend class OptionsPrivate;
+		OptionsPrivate *const d;
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add GensHeadless-specific version of Q_DISABLE_COPY().
+		Options(const Options &);
+		Options &operator=(const Options &);
+
+	public:
+		/**
+		 * Reset all options to their default values.
+		 */
+		void reset(void);
+
+		/**
+		 * Parse command line arguments.
+		 * @param argc
+		 * @param argv
+		 * @return 0 on success; non-zero on error.
+		 */
+		int parse(int argc, const char *argv[]);
+
+	public:
+		/** Command line parameters. **/
+
+		/**
+		 * Get the filename of the ROM to load.
+		 */
+		std::string rom_filename(void) const;
+
+		/**
+		 * Get the filename of the TMSS ROM to load.
+		 */
+		std::string tmss_rom_filename(void) const;
+
+		/**
+		 * Is TMSS enabled?
+		 * This option is implied by the presence of a TMSS ROM filename.
+		 * @return True if TMSS is enabled; false if not.
+		 */
+		bool is_tmss_enabled(void) const;
+
+		/** Run options. **/
+
+		/**
+		 * Number of frames to run.
+		 * @return Number of frames.
+		 */
+		int frames(void) const;
+
+		/**
+		 * Use execFrameFast() instead of execFrame()?
+		 * Frames aren't rendered in this mode, so framebuffer
+		 * dumps and hashes are only updated on dump frames.
+		 * @return True to skip rendering; false to render every frame.
+		 */
+		bool fast(void) const;
+
+		/** Audio options. **/
+
+		/**
+		 * Get the requested sound frequency.
+		 * @return Sound frequency.
+		 */
+		int sound_freq(void) const;
+
+		/**
+		 * Use stereo audio?
+		 * @return True for stereo; false for monaural.
+		 */
+		bool stereo(void) const;
+
+		/** Emulation options. **/
+
+		/**
+		 * Enable sprite limits?
+		 * @return True to enable; false to disable.
+		 */
+		bool sprite_limits(void) const;
+
+		/**
+		 * Automatically fix checksums?
+		 * @return True to auto-fix; false to not.
+		 */
+		bool auto_fix_checksum(void) const;
+
+		/**
+		 * Region code.
+		 * @return Region code.
+		 */
+		LibGens::SysVersion::RegionCode_t region(void) const;
+
+		/**
+		 * Color depth to use.
+		 * @return Color depth.
+		 */
+		LibGens::MdFb::ColorDepth bpp(void) const;
+
+		/** Output options. **/
+
+		/**
+		 * Directory to dump framebuffers to, as PNG.
+		 * @return Directory, or empty string to not dump framebuffers.
+		 */
+		std::string dump_frames_dir(void) const;
+
+		/**
+		 * File to dump audio to, as raw 16-bit host-endian PCM.
+		 * @return Filename, or empty string to not dump audio.
+		 */
+		std::string dump_audio_filename(void) const;
+
+		/**
+		 * File to log YM2612 and PSG register writes to, in VGM format.
+		 * @return Filename, or empty string to not log registers.
+		 */
+		std::string dump_vgm_filename(void) const;
+
+		/**
+		 * File to log YM2612 and PSG register writes to, in GYM format.
+		 * @return Filename, or empty string to not log registers.
+		 */
+		std::string dump_gym_filename(void) const;
+
+		/**
+		 * File to dump audio to, as a WAV file.
+		 * @return Filename, or empty string to not dump audio.
+		 */
+		std::string dump_wav_filename(void) const;
+
+		/**
+		 * File to dump video and audio to, as a lossless AVI file.
+		 * @return Filename, or empty string to not dump video.
+		 */
+		std::string dump_video_filename(void) const;
+
+		/**
+		 * Drop video frames if the encoder falls behind?
+		 * If false, the emulation thread waits for the encoder.
+		 * @return True to drop frames; false to wait.
+		 */
+		bool video_drop(void) const;
+
+		/**
+		 * File to save a ZOMG savestate to after the last frame.
+		 * @return Filename, or empty string to not save a state.
+		 */
+		std::string save_state_filename(void) const;
+
+		/**
+		 * Dump interval, in frames.
+		 * Framebuffers are dumped and hashes are printed
+		 * every N frames, and always after the last frame.
+		 * @return Dump interval. (0 == last frame only)
+		 */
+		int dump_interval(void) const;
+
+		/**
+		 * Print framebuffer, audio, and state hashes?
+		 * @return True to print hashes; false to not.
+		 */
+		bool hash(void) const;
+};
+
+}
+
+#endif /* __GENS_HEADLESS_OPTIONS_HPP__ */
@@ -0,0 +1,420 @@
+/***************************************************************************
+ * gens-headless: Gens/GS II headless frontend.                            *
+ * gens-headless.cpp: Entry point.                                         *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Reentrant functions.
+// MUST be included before everything else due to
+// _POSIX_SOURCE and _POSIX_C_SOURCE definitions.
+#include "libcompat/reentrant.h"
+
+// LibGens
+#include "libgens/lg_main.hpp"
+#include "libgens/Rom.hpp"
+#include "libgens/EmuContext/EmuContext.hpp"
+#include "libgens/EmuContext/EmuContextFactory.hpp"
+#include "libgens/Vdp/Vdp.hpp"
+#include "libgens/cpu/M68K_Mem.hpp"
+#include "libgens/cpu/Z80.hpp"
+#include "libgens/sound/SoundMgr.hpp"
+#include "libgens/sound/SoundCapture.hpp"
+#include "libgens/Util/VideoCapture.hpp"
+#include "libgens/Util/MdFb.hpp"
+#include "libgens/Util/Screenshot.hpp"
+#include "libgens/Util/Timing.hpp"
+using LibGens::Rom;
+using LibGens::EmuContext;
+using LibGens::EmuContextFactory;
+using LibGens::MdFb;
+using LibGens::SoundMgr;
+using LibGens::SoundCapture;
+using LibGens::VideoCapture;
+using LibGens::SysVersion;
+using LibGens::Timing;
+
+// LG_PATH_SEP_CHR
+#include "libgens/macros/common.h"
+
+// aligned_malloc()
+#include "libcompat/aligned_malloc.h"
+
+// Command line parameters.
+#include "Options.hpp"
+
+// OS-specific includes.
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+#include "libcompat/W32U/W32U_mini.h"
+#include "libcompat/W32U/W32U_argv.h"
+#endif
+
+// zlib: crc32()
+#include <zlib.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <clocale>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+using std::string;
+
+namespace GensHeadless {
+
+/** Command line parameters. **/
+static Options *options = nullptr;
+
+/**
+ * Calculate the CRC32 of the current framebuffer.
+ * Only the visible portion of each line is included.
+ * @param fb MD framebuffer.
+ * @return CRC32.
+ */
+static uint32_t fbCrc32(const MdFb *fb)
+{
+	uLong crc = crc32(0, nullptr, 0);
+	const int numLines = fb->numLines();
+	if (fb->bpp() == MdFb::BPP_32) {
+		const unsigned int len = fb->pxPerLine() * sizeof(uint32_t);
+		for (int y = 0; y < numLines; y++) {
+			crc = crc32(crc, (const Bytef*)fb->lineBuf32(y), len);
+		}
+	} else {
+		const unsigned int len = fb->pxPerLine() * sizeof(uint16_t);
+		for (int y = 0; y < numLines; y++) {
+			crc = crc32(crc, (const Bytef*)fb->lineBuf16(y), len);
+		}
+	}
+	return (uint32_t)crc;
+}
+
+/**
+ * Calculate the CRC32 of the emulated system's RAM.
+ * This includes 68000 RAM and Z80 RAM.
+ * @param context Emulation context.
+ * @return CRC32.
+ */
+static uint32_t stateCrc32(const EmuContext *context)
+{
+	uLong crc = crc32(0, nullptr, 0);
+	if (context->m_m68kMem) {
+		crc = crc32(crc, context->m_m68kMem->Ram_68k.u8,
+			    sizeof(context->m_m68kMem->Ram_68k.u8));
+	}
+	if (context->m_z80) {
+		crc = crc32(crc, context->m_z80->m_ramZ80,
+			    sizeof(context->m_z80->m_ramZ80));
+	}
+	return (uint32_t)crc;
+}
+
+/**
+ * Dump the current framebuffer to a PNG image.
+ * @param context Emulation context.
+ * @param frame Frame number.
+ * @return 0 on success; negative errno on error.
+ */
+static int dumpFrame(const EmuContext *context, int frame)
+{
+	string dir = options->dump_frames_dir();
+	if (!dir.empty() && dir.at(dir.size()-1) != LG_PATH_SEP_CHR) {
+		dir += LG_PATH_SEP_CHR;
+	}
+
+	char filename[32];
+	snprintf(filename, sizeof(filename), "frame%06d.png", frame);
+	const string pathname = dir + filename;
+
+	int ret = LibGens::Screenshot::toFile(pathname.c_str(),
+			context->m_vdp->MD_Screen, context->rom());
+	if (ret != 0) {
+		fprintf(stderr, "Error writing '%s': %d\n", pathname.c_str(), ret);
+	}
+	return ret;
+}
+
+/**
+ * Run the emulator.
+ * @return Exit code.
+ */
+static int run(void)
+{
+	// Initialize LibGens.
+	LibGens::Init();
+
+	// Load the ROM image.
+	const string rom_filename = options->rom_filename();
+	Rom *rom = new Rom(rom_filename.c_str());
+	if (!rom->isOpen()) {
+		// Error opening the ROM.
+		fprintf(stderr, "Error opening ROM file %s: (TODO get error code)\n",
+			rom_filename.c_str());
+		delete rom;
+		LibGens::End();
+		return EXIT_FAILURE;
+	}
+	if (rom->isMultiFile()) {
+		// Select the first file.
+		rom->select_z_entry(rom->get_z_entry_list());
+	}
+
+	// Check if this ROM format is supported.
+	if (!EmuContextFactory::isRomFormatSupported(rom) ||
+	    !EmuContextFactory::isRomSystemSupported(rom))
+	{
+		fprintf(stderr, "Error loading ROM file %s: ROM is not supported.\n",
+			rom_filename.c_str());
+		delete rom;
+		LibGens::End();
+		return EXIT_FAILURE;
+	}
+
+	// Set some static EmuContext properties.
+	EmuContext::SetAutoFixChecksum(options->auto_fix_checksum());
+	if (options->is_tmss_enabled()) {
+		EmuContext::SetTmssRomFilename(options->tmss_rom_filename());
+		EmuContext::SetTmssEnabled(true);
+	}
+
+	// Detect the ROM region.
+	SysVersion::RegionCode_t region = options->region();
+	if (region == SysVersion::REGION_AUTO) {
+		// Auto-detect the region code.
+		// Using region code order 0x4812.
+		// (US, Europe, Japan, Asia)
+		region = SysVersion::DetectRegion(rom->regionCode(), 0x4812);
+		if (region == SysVersion::REGION_AUTO) {
+			// Detection failed.
+			// Default to US/NTSC.
+			region = SysVersion::REGION_US_NTSC;
+		}
+	}
+
+	// Create the emulation context.
+	EmuContext *context = EmuContextFactory::createContext(rom, region);
+	if (!context || !context->isRomOpened()) {
+		// Error loading the ROM into EmuMD.
+		fprintf(stderr, "Error initializing EmuContext for %s: (TODO get error code)\n",
+			rom_filename.c_str());
+		delete context;
+		delete rom;
+		LibGens::End();
+		return EXIT_FAILURE;
+	}
+
+	// Set VDP properties.
+	context->m_vdp->options.spriteLimits = options->sprite_limits();
+	context->m_vdp->MD_Screen->setBpp(options->bpp());
+
+	// Initialize audio.
+	SoundMgr *soundMgr = context->m_soundMgr;
+	soundMgr->setRate(options->sound_freq(), false);
+	const bool stereo = options->stereo();
+	const int sampleSize = (stereo ? 4 : 2);
+	int16_t *segBuffer = (int16_t*)aligned_malloc(16, SoundMgr::MAX_SEGMENT_SIZE * sampleSize);
+
+	FILE *f_audio = nullptr;
+	const string dump_audio_filename = options->dump_audio_filename();
+	if (!dump_audio_filename.empty()) {
+		f_audio = fopen(dump_audio_filename.c_str(), "wb");
+		if (!f_audio) {
+			fprintf(stderr, "Error opening audio dump file '%s'.\n",
+				dump_audio_filename.c_str());
+		}
+	}
+
+	// Sound capture. (VGM/GYM register log and WAV audio)
+	// Files are written by a background thread.
+	SoundCapture capture;
+	const string dump_vgm_filename = options->dump_vgm_filename();
+	const string dump_gym_filename = options->dump_gym_filename();
+	const string dump_wav_filename = options->dump_wav_filename();
+	if (!dump_vgm_filename.empty() || !dump_gym_filename.empty() ||
+	    !dump_wav_filename.empty())
+	{
+		const bool gym = !dump_gym_filename.empty();
+		const string &reg_filename = (gym ? dump_gym_filename : dump_vgm_filename);
+		int cret = capture.start(
+			(!reg_filename.empty() ? reg_filename.c_str() : nullptr),
+			(gym ? SoundCapture::REGFMT_GYM : SoundCapture::REGFMT_VGM),
+			(!dump_wav_filename.empty() ? dump_wav_filename.c_str() : nullptr));
+		if (cret == 0) {
+			soundMgr->setCapture(&capture);
+		} else {
+			fprintf(stderr, "Error starting sound capture: %d\n", cret);
+		}
+	}
+
+	// Video capture. (AVI)
+	// Frames are encoded and written by background threads.
+	VideoCapture videoCapture;
+	const string dump_video_filename = options->dump_video_filename();
+	if (!dump_video_filename.empty()) {
+		int vret = videoCapture.start(dump_video_filename.c_str(),
+			context->m_vdp->isPal(),
+			options->sound_freq(), (stereo ? 2 : 1),
+			(options->video_drop() ? VideoCapture::QUEUE_DROP : VideoCapture::QUEUE_STALL));
+		if (vret != 0) {
+			fprintf(stderr, "Error starting video capture: %d\n", vret);
+		}
+	}
+
+	const int frames = options->frames();
+	const int dump_interval = options->dump_interval();
+	const bool fast = options->fast();
+	const bool hash = options->hash();
+	const bool dump_frames = !options->dump_frames_dir().empty();
+	uLong audioCrc = crc32(0, nullptr, 0);
+
+	Timing timing;
+	const uint64_t start = timing.getTime();
+	for (int frame = 1; frame <= frames; frame++) {
+		// Framebuffers and hashes are dumped every
+		// dump_interval frames, and after the last frame.
+		const bool isDumpFrame = (frame == frames ||
+			(dump_interval > 0 && (frame % dump_interval) == 0));
+
+		const bool rendered = !(fast && !isDumpFrame);
+		if (rendered) {
+			context->execFrame();
+		} else {
+			context->execFrameFast();
+		}
+
+		// Read the audio segment.
+		int samples;
+		if (stereo) {
+			samples = soundMgr->writeStereo(segBuffer, soundMgr->getSegLength());
+		} else {
+			samples = soundMgr->writeMono(segBuffer, soundMgr->getSegLength());
+		}
+		if (samples > 0) {
+			if (hash) {
+				audioCrc = crc32(audioCrc, (const Bytef*)segBuffer, samples * sampleSize);
+			}
+			if (f_audio) {
+				fwrite(segBuffer, sampleSize, samples, f_audio);
+			}
+		}
+		if (videoCapture.isRunning()) {
+			// Frames that weren't rendered repeat the previous frame.
+			videoCapture.pushFrame(
+				(rendered ? context->m_vdp->MD_Screen : nullptr),
+				segBuffer, samples);
+		}
+
+		if (isDumpFrame) {
+			if (dump_frames) {
+				dumpFrame(context, frame);
+			}
+			if (hash) {
+				// Framebuffer CRC32 is for the current frame.
+				// Audio CRC32 covers all audio up to this point.
+				printf("frame %d: fb=%08X audio=%08X state=%08X\n", frame,
+					fbCrc32(context->m_vdp->MD_Screen),
+					(uint32_t)audioCrc, stateCrc32(context));
+			}
+		}
+	}
+	const uint64_t elapsed = timing.getTime() - start;
+
+	// Print the timing information.
+	const double secs = (double)elapsed / 1000000.0;
+	fprintf(stderr, "%d frames in %.3f s (%.1f fps, %.1f us/frame)\n",
+		frames, secs, (secs > 0 ? (double)frames / secs : 0.0),
+		(double)elapsed / (double)frames);
+
+	if (f_audio) {
+		fclose(f_audio);
+	}
+	if (capture.isRunning()) {
+		soundMgr->setCapture(nullptr);
+		int cret = capture.stop();
+		if (cret != 0) {
+			fprintf(stderr, "Sound capture: write error: %s\n", strerror(-cret));
+		}
+		if (capture.dropped() > 0) {
+			fprintf(stderr, "Sound capture: %u audio segments were dropped.\n",
+				capture.dropped());
+		}
+	}
+	if (videoCapture.isRunning()) {
+		int vret = videoCapture.stop();
+		if (vret != 0) {
+			fprintf(stderr, "Video capture: write error: %s\n", strerror(-vret));
+		}
+		VideoCapture::Stats stats;
+		videoCapture.stats(&stats);
+		fprintf(stderr, "Video capture: %u frames, %u dropped, "
+			"%u stalls (%.3f s), max %u queued.\n",
+			stats.frames, stats.dropped, stats.stalls,
+			(double)stats.stallTime / 1000000.0, stats.maxQueued);
+	}
+	aligned_free(segBuffer);
+
+	// Save the final state.
+	int ret = EXIT_SUCCESS;
+	const string save_state_filename = options->save_state_filename();
+	if (!save_state_filename.empty()) {
+		int zret = context->zomgSave(save_state_filename.c_str());
+		if (zret != 0) {
+			fprintf(stderr, "Error saving state to '%s': %d\n",
+				save_state_filename.c_str(), zret);
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	delete context;
+	delete rom;
+	LibGens::End();
+	return ret;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef _WIN32
+	// Convert command line parameters to UTF-8.
+	if (W32U_GetArgvU(&argc, &argv, nullptr) != 0) {
+		// ERROR!
+		return EXIT_FAILURE;
+	}
+#endif /* _WIN32 */
+
+	// Initialize locale settings.
+	setlocale(LC_ALL, "");
+
+	// Parse command line options.
+	GensHeadless::options = new GensHeadless::Options();
+	int ret = GensHeadless::options->parse(argc, (const char**)argv);
+	if (ret != 0) {
+		// Error parsing command line options.
+		// Options::parse() already printed an error message.
+		delete GensHeadless::options;
+		return ret;
+	}
+
+	ret = GensHeadless::run();
+	delete GensHeadless::options;
+	return ret;
+}
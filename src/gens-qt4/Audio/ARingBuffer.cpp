@@ -24,22 +24,23 @@
 #include "ARingBuffer.hpp"
 
 // C includes.
+#include <assert.h>
 #include <string.h>
 
 namespace GensQt4
 {
 
 ARingBuffer::ARingBuffer()
+	: m_segLength(0)
+	, m_channels(1)
+	, m_segWP(0)
+	, m_overruns(0)
+	, m_segRP(0)
+	, m_underruns(0)
+	, m_segRP_minor(0)
 {
-	// Set the segment and buffer lengths to 0.
 	// NOTE: ARingBuffer::reInit() MUST be called before using the ring buffer!
-	// Otherwise, SIGFPE will occur.
-	m_segLength = 0;
-	
-	// Clear the segment pointers.
-	m_segWP = 0;
-	m_segRP = 0;
-	m_segRP_minor = 0;
+	memset(m_segFrames, 0, sizeof(m_segFrames));
 	
 	// TODO: Dynamically allocate m_buffer?
 }
@@ -52,86 +53,124 @@ ARingBuffer::~ARingBuffer()
 
 /**
  * reInit(): Reinitialize the Ring Buffer.
- * @param segSize Segment size. (Number of samples)
+ * The consumer must not be running when this is called.
+ * @param segSize Maximum segment size. (Number of sample frames)
  * @param stereo If true, segments are stereo; otherwise, they're mono.
  */
 void ARingBuffer::reInit(int segSize, bool stereo)
 {
-	// Calculate the segment and buffer lengths.
-	m_segLength = (segSize * (stereo ? 2 : 1));
-	m_stereo = stereo;
+	assert(segSize > 0 && segSize <= MAX_SEGMENT_SIZE);
+	m_segLength = segSize;
+	m_channels = (stereo ? 2 : 1);
 	
 	// Clear the segment buffer.
 	memset(m_buffer, 0x00, sizeof(m_buffer));
+	memset(m_segFrames, 0x00, sizeof(m_segFrames));
 	
-	// Clear the segment pointers.
-	m_segWP = 0;
-	m_segRP = 0;
+	// Clear the segment pointers and counters.
+	m_segWP.store(0);
+	m_segRP.store(0);
 	m_segRP_minor = 0;
+	m_overruns.store(0);
+	m_underruns.store(0);
 }
 
 
 /**
- * writeLock(): Lock the buffer for writing one segment.
- * @return Pointer to current write segment.
+ * writeBegin(): Get the next segment for writing.
+ * Producer thread only.
+ * @return Pointer to the next write segment, or nullptr if the queue is full.
  */
-int16_t *ARingBuffer::writeLock(void)
+int16_t *ARingBuffer::writeBegin(void)
 {
-	// Lock the buffer segment.
-	m_bufLock[m_segWP].lock();
-	
-	// Return a pointer to the buffer at the current WP.
-	return &m_buffer[m_segWP][0];
+	// Acquire ordering ensures the consumer is done
+	// with a segment before we overwrite it.
+	const unsigned int wp = m_segWP.load(std::memory_order_relaxed);
+	const unsigned int rp = m_segRP.load(std::memory_order_acquire);
+	if (wp - rp >= (unsigned int)NUM_SEGMENTS) {
+		// Queue is full. The segment will be dropped.
+		m_overruns.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	return &m_buffer[wp & SEGMENT_MASK][0];
 }
 
 
 /**
- * writeUnlock(): Unlock the buffer and advance the write pointer.
+ * writeEnd(): Queue the segment returned by writeBegin().
+ * Producer thread only.
+ * @param frames Number of sample frames written to the segment.
  */
-void ARingBuffer::writeUnlock(void)
+void ARingBuffer::writeEnd(int frames)
 {
-	// Unlock the buffer segment.
-	m_bufLock[m_segWP].unlock();
-	
-	// Advance the WP to the next segment.
-	m_segWP++;
-	m_segWP %= NUM_SEGMENTS;
+	assert(frames >= 0 && frames <= m_segLength);
+	const unsigned int wp = m_segWP.load(std::memory_order_relaxed);
+	m_segFrames[wp & SEGMENT_MASK] = frames;
+
+	// Release ordering makes the segment data
+	// visible to the consumer before the WP.
+	m_segWP.store(wp + 1, std::memory_order_release);
 }
 
 
 /**
  * read(): Read data into the specified output buffer.
+ * Consumer thread only.
+ * If there isn't enough data, the rest of
+ * the output buffer is filled with silence.
  * @param out Output buffer.
- * @param samples Samples to read.
+ * @param frames Number of sample frames to read.
+ * @return Number of sample frames read from the queue.
  */
-void ARingBuffer::read(int16_t *out, int samples)
+int ARingBuffer::read(int16_t *out, int frames)
 {
-	// Lock the current read buffer segment.
-	m_bufLock[m_segRP].lock();
-	
-	if (m_stereo)
-		samples *= 2;
-	
-	// TODO: Optimize this!
-	for (; samples > 0; samples--)
-	{
-		*out++ = m_buffer[m_segRP][m_segRP_minor];
-		
-		// Next sample.
-		m_segRP_minor++;
-		if (m_segRP_minor >= m_segLength)
-		{
+	const unsigned int wp = m_segWP.load(std::memory_order_acquire);
+	unsigned int rp = m_segRP.load(std::memory_order_relaxed);
+
+	int read = 0;
+	while (read < frames && rp != wp) {
+		// Copy as much as possible from the current segment.
+		const int seg = (rp & SEGMENT_MASK);
+		int avail = (m_segFrames[seg] - m_segRP_minor);
+		if (avail > (frames - read))
+			avail = (frames - read);
+		memcpy(&out[read * m_channels],
+		       &m_buffer[seg][m_segRP_minor * m_channels],
+		       avail * m_channels * sizeof(int16_t));
+		read += avail;
+		m_segRP_minor += avail;
+
+		if (m_segRP_minor >= m_segFrames[seg]) {
 			// Next segment.
-			m_bufLock[m_segRP].unlock();
-			m_segRP++;
-			m_segRP %= NUM_SEGMENTS;
+			// Release ordering returns the segment
+			// to the producer after we're done with it.
+			rp++;
 			m_segRP_minor = 0;
-			m_bufLock[m_segRP].lock();
+			m_segRP.store(rp, std::memory_order_release);
 		}
 	}
-	
-	// Unlock the current read buffer segment.
-	m_bufLock[m_segRP].unlock();
+
+	if (read < frames) {
+		// Not enough data. Fill the rest with silence.
+		memset(&out[read * m_channels], 0x00,
+		       (frames - read) * m_channels * sizeof(int16_t));
+		m_underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return read;
+}
+
+
+/**
+ * takeStats(): Get the underrun/overrun counters and reset them.
+ * May be called from either thread.
+ * @param stats Stats struct to store the counters in.
+ */
+void ARingBuffer::takeStats(Stats *stats)
+{
+	stats->underruns = m_underruns.exchange(0, std::memory_order_relaxed);
+	stats->overruns = m_overruns.exchange(0, std::memory_order_relaxed);
 }
 
 }
@@ -33,52 +33,78 @@
 #include <unistd.h>
 #endif
 
-// Qt includes.
-#include <QtCore/QMutex>
+// C++ includes.
+#include <atomic>
 
 namespace GensQt4
 {
 
+/**
+ * Wait-free single-producer, single-consumer audio segment queue.
+ *
+ * The emulation thread writes one segment per frame with
+ * writeBegin()/writeEnd(), and the audio callback reads
+ * sample frames with read(). Neither side ever takes a lock,
+ * so the audio callback can't be blocked by the emulation thread.
+ *
+ * If the queue is full, the new segment is dropped (overrun).
+ * If the queue runs dry, the rest of the output is filled
+ * with silence (underrun).
+ */
 class ARingBuffer
 {
 	public:
 		ARingBuffer();
 		~ARingBuffer();
 
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		ARingBuffer(const ARingBuffer &);
+		ARingBuffer &operator=(const ARingBuffer &);
+
+	public:
 		/**
 		 * Reinitialize the Ring Buffer.
-		 * @param segSize Segment size. (Number of samples)
+		 * The consumer must not be running when this is called.
+		 * @param segSize Maximum segment size. (Number of sample frames)
 		 * @param stereo If true, segments are stereo; otherwise, they're mono.
 		 */
 		void reInit(int segSize, bool stereo);
 
-		int getSegWP(void) const { return m_segWP; }
-		int getSegRP(void) const { return m_segRP; }
+		int getSegWP(void) const { return (m_segWP.load() & SEGMENT_MASK); }
+		int getSegRP(void) const { return (m_segRP.load() & SEGMENT_MASK); }
 
 		/**
-		 * Lock the buffer for writing one segment.
-		 * @return Pointer to current write segment.
+		 * Get the next segment for writing.
+		 * Producer thread only.
+		 * @return Pointer to the next write segment, or nullptr if the queue is full.
 		 */
-		int16_t *writeLock(void);
-		
+		int16_t *writeBegin(void);
+
 		/**
-		 * Unlock the buffer and advance the write pointer.
+		 * Queue the segment returned by writeBegin().
+		 * Producer thread only.
+		 * @param frames Number of sample frames written to the segment.
 		 */
-		void writeUnlock(void);
+		void writeEnd(int frames);
 
 		/**
-		 * read(): Read data into the specified output buffer.
+		 * Read data into the specified output buffer.
+		 * Consumer thread only.
+		 * If there isn't enough data, the rest of
+		 * the output buffer is filled with silence.
 		 * @param out Output buffer.
-		 * @param samples Samples to read.
+		 * @param frames Number of sample frames to read.
+		 * @return Number of sample frames read from the queue.
 		 */
-		void read(int16_t *out, int samples);
+		int read(int16_t *out, int frames);
 
 		/**
 		 * Wait for the read pointer to pass the write pointer.
 		 */
 		void wpSegWait(void) const
 		{
-			while (m_segWP == m_segRP) {
+			while (m_segWP.load() == m_segRP.load()) {
 				// NOTE: On Gens/GS Win32, I had to remove usleep()
 				// due to lag issues. Let's see if that happens here.
 				// TODO: MSVC equivalent.
@@ -94,41 +120,71 @@ class ARingBuffer
 		 */
 		bool isBufferEmpty(void) const
 		{
-			return (m_segWP == m_segRP);
+			return (m_segWP.load() == m_segRP.load());
 		}
 
+		/**
+		 * Underrun/overrun counters.
+		 */
+		struct Stats {
+			unsigned int underruns;	// Number of short reads.
+			unsigned int overruns;	// Number of dropped segments.
+		};
+
+		/**
+		 * Get the underrun/overrun counters and reset them.
+		 * May be called from either thread.
+		 * @param stats Stats struct to store the counters in.
+		 */
+		void takeStats(Stats *stats);
+
 		static const int NUM_SEGMENTS = 8;
 		static const int MAX_SEGMENT_SIZE = LibGens::SoundMgr::MAX_SEGMENT_SIZE;
 
 	protected:
+		static const unsigned int SEGMENT_MASK = (NUM_SEGMENTS - 1);
+
+		// Cache line size, used to keep the producer and
+		// consumer state from sharing a cache line.
+		static const unsigned int CACHE_LINE_SIZE = 64;
+
 		/**
 		 * Segment buffer.
 		 * Stores up to NUM_SEGMENTS segments.
-		 * Up to 1024 samples. (1024*2 for stereo)
+		 * Up to MAX_SEGMENT_SIZE sample frames each.
 		 */
-		int16_t m_buffer[NUM_SEGMENTS][1024*2];
+		int16_t m_buffer[NUM_SEGMENTS][MAX_SEGMENT_SIZE*2];
 
-		// Buffer segment locks.
-		QMutex m_bufLock[NUM_SEGMENTS];
+		/**
+		 * Number of sample frames in each segment.
+		 * Written by the producer before the segment is queued.
+		 */
+		int m_segFrames[NUM_SEGMENTS];
 
 		/**
-		 * Length of a segment, in int16_t units.
+		 * Maximum length of a segment, in sample frames.
 		 */
 		int m_segLength;
 
 		/**
-		 * Stereo/Mono setting.
+		 * Number of channels. (1 == mono, 2 == stereo)
 		 */
-		bool m_stereo;
+		int m_channels;
 
 		/**
-		 * Read/Write pointers. (segment indexes)
+		 * Read/Write pointers. (free-running segment indexes)
 		 * m_segWP: emulator to m_buffer
 		 * m_segRP: m_buffer to sound card
+		 * The queue is full if (m_segWP - m_segRP) == NUM_SEGMENTS.
 		 */
-		int m_segWP;
-		int m_segRP;
-		int m_segRP_minor;
+		uint8_t m_pad0[CACHE_LINE_SIZE];
+		std::atomic<unsigned int> m_segWP;
+		std::atomic<unsigned int> m_overruns;
+		uint8_t m_pad1[CACHE_LINE_SIZE];
+		std::atomic<unsigned int> m_segRP;
+		std::atomic<unsigned int> m_underruns;
+		int m_segRP_minor;	// Sample frames read from the current segment.
+		uint8_t m_pad2[CACHE_LINE_SIZE];
 };
 
 }
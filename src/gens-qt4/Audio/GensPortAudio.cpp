@@ -45,8 +45,8 @@ namespace GensQt4 {
 GensPortAudio::GensPortAudio()
 {
 	// Clear internal variables.
-	m_bufferPos = 0;
 	m_sampleSize = 0;
+	m_soundMgr = nullptr;
 
 	// FIXME: SoundMgr::writeStereo() requires a 16-byte
 	// aligned destination buffer for SSE2.
@@ -77,8 +77,7 @@ void GensPortAudio::open(void)
 	// Initialize the buffer before initializing PortAudio.
 	// This prevents a race condition.
 	m_mtxBuffer.lock();
-	memset(m_buffer, 0x00, sizeof(m_buffer));
-	m_bufferPos = 0;
+	m_buffer.reInit(SoundMgr::MAX_SEGMENT_SIZE, m_stereo);
 	m_sampleSize = (sizeof(int16_t) * (m_stereo ? 2 : 1));
 	m_mtxBuffer.unlock();
 
@@ -171,6 +170,15 @@ void GensPortAudio::close(void)
 	}
 	m_stream = NULL;
 
+	// Report ring buffer underruns and overruns.
+	ARingBuffer::Stats stats;
+	m_buffer.takeStats(&stats);
+	if (stats.underruns != 0 || stats.overruns != 0) {
+		LOG_MSG(audio, LOG_MSG_LEVEL_DEBUG1,
+			"Ring buffer: %u underruns, %u overruns",
+			stats.underruns, stats.overruns);
+	}
+
 	// Shut down PortAudio.
 	err = Pa_Terminate();
 	if (err != paNoError) {
@@ -204,13 +212,29 @@ void GensPortAudio::setRate(int newRate)
 		// TODO: Insert a pause between close() and open() to prevent stuttering?
 		close();
 		m_rate = newRate;
-		SoundMgr::SetRate(newRate, true);
+		if (m_soundMgr)
+			m_soundMgr->setRate(newRate, true);
 		open();
 	} else {
 		// Audio isn't open. Save the new audio rate.
 		// PSG/YM state doesn't need to be saved.
 		m_rate = newRate;
-		SoundMgr::SetRate(newRate, false);
+		if (m_soundMgr)
+			m_soundMgr->setRate(newRate, false);
+	}
+}
+
+/**
+ * Set the Sound Manager to read audio from.
+ * @param soundMgr Sound Manager. (may be nullptr)
+ */
+void GensPortAudio::setSoundMgr(SoundMgr *soundMgr)
+{
+	QMutexLocker locker(&m_mtxBuffer);
+	m_soundMgr = soundMgr;
+	if (m_soundMgr) {
+		// Make sure the Sound Manager uses our sampling rate.
+		m_soundMgr->setRate(m_rate, false);
 	}
 }
 
@@ -247,35 +271,10 @@ int GensPortAudio::gensPaCallback(const void *inputBuffer, void *outputBuffer,
 	((void)timeInfo);
 	((void)statusFlags);
 
-	QMutexLocker locker(&m_mtxBuffer);
-
-	// NOTE: Sample size is 16-bit, but we're using 8-bit here
-	// for convenience, since everything's measured in bytes.
-	uint8_t *out = (uint8_t*)outputBuffer;
-
 	// Get the data from the buffer.
-	framesPerBuffer *= m_sampleSize;
-
-	if (m_bufferPos < framesPerBuffer) {
-		// Not enough data in the buffer.
-		// Copy whatever's left.
-		memcpy(out, m_buffer, m_bufferPos);
-		memset(&out[m_bufferPos], 0x00, (framesPerBuffer - m_bufferPos));
-		m_bufferPos = 0;
-	} else {
-		// Enough data is available in the buffer.
-		memcpy(out, m_buffer, framesPerBuffer);
-
-		// Shift the rest of the buffer over.
-		unsigned long diff = (m_bufferPos - framesPerBuffer);
-		if (diff == 0) {
-			m_bufferPos = 0;
-		} else {
-			memmove(m_buffer, &m_buffer[framesPerBuffer>>1], diff);
-			m_bufferPos = diff;
-		}
-	}
-
+	// This never blocks; if there isn't enough data,
+	// the rest of the output is filled with silence.
+	m_buffer.read((int16_t*)outputBuffer, (int)framesPerBuffer);
 	return 0;
 }
 
@@ -287,37 +286,30 @@ int GensPortAudio::write(void)
 {
 	QMutexLocker locker(&m_mtxBuffer);
 
-	if (!m_open)
-		return 1;
-
-	// TODO: Lock the buffer for writing.
-	// TODO: Use the segment size.
-	const int segLength = SoundMgr::GetSegLength();
-	const int cbSegSize = segLength * m_sampleSize;
-	if ((m_bufferPos + cbSegSize) > sizeof(m_buffer)) {
-		fprintf(stderr, "GensPortAudio::%s(): Internal buffer overflow.\n", __func__);
+	if (!m_open || !m_soundMgr)
 		return 1;
-	}
 
+	// Always read the segment from the Sound Manager,
+	// even if it ends up being dropped.
+	const int segLength = m_soundMgr->getSegLength();
 	int written;	// Number of samples written.
 	if (m_stereo) {
-		written = SoundMgr::writeStereo(m_tmpWriteBuf, segLength);
+		written = m_soundMgr->writeStereo(m_tmpWriteBuf, segLength);
 	} else {
-		written = SoundMgr::writeMono(m_tmpWriteBuf, segLength);
+		written = m_soundMgr->writeMono(m_tmpWriteBuf, segLength);
 	}
-	
-	written *= m_sampleSize;
-
-	// Copy from the bounce buffer to the ring buffer.
-	int16_t *buf = &m_buffer[m_bufferPos>>1];
-	memcpy(buf, m_tmpWriteBuf, written);
 
-	// Increment the buffer position.
-	m_bufferPos += written;
+	// Get the next segment in the ring buffer.
+	int16_t *buf = m_buffer.writeBegin();
+	if (!buf) {
+		// Ring buffer is full. Drop this segment.
+		// (ARingBuffer counts this as an overrun.)
+		return 1;
+	}
 
-	// Unlock the ring buffer.
-	// TODO
-	//m_buffer.writeUnlock();
+	// Copy from the bounce buffer to the ring buffer.
+	memcpy(buf, m_tmpWriteBuf, written * m_sampleSize);
+	m_buffer.writeEnd(written);
 
 	// Return 0 if all requested data was written.
 	// Otherwise, return 1.
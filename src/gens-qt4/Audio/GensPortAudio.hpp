@@ -38,6 +38,10 @@
 // Audio Ring Buffer.
 #include "ARingBuffer.hpp"
 
+namespace LibGens {
+	class SoundMgr;
+}
+
 namespace GensQt4 {
 
 class GensPortAudio : public ABackend
@@ -61,6 +65,12 @@ class GensPortAudio : public ABackend
 		void setRate(int newRate);
 		void setStereo(bool newStereo);
 
+		/**
+		 * Set the Sound Manager to read audio from.
+		 * @param soundMgr Sound Manager. (may be nullptr)
+		 */
+		void setSoundMgr(LibGens::SoundMgr *soundMgr);
+
 		/**
 		 * Write the current segment to the audio buffer.
 		 * @return 0 on success; non-zero on error.
@@ -95,13 +105,20 @@ class GensPortAudio : public ABackend
 		PaStream *m_stream;
 
 		// Audio buffer.
-		int16_t m_buffer[1024*SEGMENTS_TO_BUFFER*2];
-		unsigned long m_bufferPos; // Byte position in m_buffer.
+		// The PortAudio callback reads from this
+		// without locking. (see ARingBuffer)
+		ARingBuffer m_buffer;
+
+		// Protects m_soundMgr and the write side of m_buffer.
+		// NOT used by the PortAudio callback.
 		QMutex m_mtxBuffer;
 
 		// Sample size. (Calculated on open().)
 		int m_sampleSize;
 
+		// Sound Manager for the current emulation context.
+		LibGens::SoundMgr *m_soundMgr;
+
 		// FIXME: SoundMgr::writeStereo() requires a 16-byte
 		// aligned destination buffer for SSE2.
 		// GensPortAudio will be removed later, so I'm using
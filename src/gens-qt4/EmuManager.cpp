@@ -26,10 +26,15 @@
 #include "EmuManager.hpp"
 #include "gqt4_main.hpp"
 
+// C includes. (C++ namespace)
+#include <cstring>
+
 // LibGens includes.
 #include "libgens/Util/Timing.hpp"
+#include "libgens/Util/RewindBuffer.hpp"
 #include "libgens/Rom.hpp"
 using LibGens::Rom;
+using LibGens::RewindBuffer;
 
 #include "libgens/EmuContext/EmuContext.hpp"
 #include "libgens/EmuContext/EmuContextFactory.hpp"
@@ -80,6 +85,8 @@ namespace GensQt4 {
 
 EmuManager::EmuManager(QObject *parent, VBackend *vBackend)
 	: super(parent)
+	, m_rewind(nullptr)
+	, m_rewinding(false)
 	, m_keyManager(nullptr)
 	, m_vBackend(vBackend)
 	, m_romClosedFb(nullptr)
@@ -145,6 +152,8 @@ EmuManager::EmuManager(QObject *parent, VBackend *vBackend)
 	// Emulation options. (Options menu)
 	gqt4_cfg->registerChangeNotification(QLatin1String("Options/enableSRam"),
 					this, SLOT(enableSRam_changed_slot(QVariant)));
+	gqt4_cfg->registerChangeNotification(QLatin1String("Options/rewindBufferSize"),
+					this, SLOT(rewindBufferSize_changed_slot(QVariant)));
 }
 
 EmuManager::~EmuManager()
@@ -159,6 +168,10 @@ EmuManager::~EmuManager()
 	
 	// TODO: Do we really need to clear this?
 	m_paused.data = 0;
+
+	// Delete the rewind buffer.
+	delete m_rewind;
+	m_rewind = nullptr;
 	
 	// Unreference the last-closed ROM framebuffer.
 	if (m_romClosedFb)
@@ -460,8 +473,12 @@ int EmuManager::loadRom_int(LibGens::Rom *rom)
 	// TODO: Use gqt4_emuContext instead?
 
 	// Open audio.
+	m_audio->setSoundMgr(gqt4_emuContext->m_soundMgr);
 	m_audio->open();
 
+	// Create the rewind buffer.
+	rewindBufferSize_changed_slot(gqt4_cfg->get(QLatin1String("Options/rewindBufferSize")));
+
 	// Initialize timing information.
 	m_lastTime = 0;
 	m_lastTime_fps = m_lastTime;
@@ -573,6 +590,7 @@ int EmuManager::closeRom(bool emitStateChanged)
 		// Delete the emulation context.
 		// FIXME: Delete gqt4_emuContext after VBackend is finished using it. (MEMORY LEAK)
 		m_vBackend->setEmuContext(nullptr);
+		m_audio->setSoundMgr(nullptr);
 		delete gqt4_emuContext;
 		gqt4_emuContext = nullptr;
 
@@ -580,6 +598,10 @@ int EmuManager::closeRom(bool emitStateChanged)
 		// TODO: Handle this in gqt4_emuContext.
 		delete m_rom;
 		m_rom = nullptr;
+
+		// Delete the rewind buffer.
+		delete m_rewind;
+		m_rewind = nullptr;
 	}
 
 	// Close audio.
@@ -687,6 +709,57 @@ QString EmuManager::getSaveStateFilename(void)
 	return filename;
 }
 
+/**
+ * Update the rewind buffer after a frame is emulated.
+ * If rewinding, the previous state is restored;
+ * otherwise, the current state is saved.
+ */
+void EmuManager::updateRewind(void)
+{
+	// NOTE: Restoring a state discards the audio
+	// of the last frame, so rewinding is silent.
+	if (m_rewinding && m_rewind->pop(gqt4_emuContext) == 0)
+		return;
+
+	int ret = m_rewind->push(gqt4_emuContext);
+	if (ret != 0) {
+		// Error saving the state. Disable rewind.
+		delete m_rewind;
+		m_rewind = nullptr;
+
+		//: OSD message indicating that rewind was disabled due to an error.
+		const QString msg = tr("Rewind disabled: %1", "osd");
+		emit osdPrintMsg(1500, msg.arg(QLatin1String(strerror(-ret))));
+	}
+}
+
+/**
+ * Start or stop rewinding.
+ * @param rewinding If true, rewind one frame per emulated frame.
+ */
+void EmuManager::setRewinding(bool rewinding)
+{
+	m_rewinding = rewinding;
+}
+
+/**
+ * Rewind buffer size has changed.
+ * @param rewindBufferSize (int) New rewind buffer size, in MB. (0 == disabled)
+ */
+void EmuManager::rewindBufferSize_changed_slot(const QVariant &rewindBufferSize)
+{
+	// The rewind buffer is only accessed by the GUI thread,
+	// so it can be replaced immediately.
+	// NOTE: The existing history is discarded.
+	delete m_rewind;
+	m_rewind = nullptr;
+
+	const int mb = rewindBufferSize.toInt();
+	if (m_rom && mb > 0) {
+		m_rewind = new RewindBuffer((size_t)mb * 1024 * 1024);
+	}
+}
+
 /**
  * Emulation thread is finished rendering a frame.
  * @param wasFastFrame The frame was rendered "fast", i.e. no VDP updates.
@@ -736,6 +809,10 @@ void EmuManager::emuFrameDone(bool wasFastFrame)
 	if (!m_qEmuRequest.isEmpty())
 		processQEmuRequest();
 
+	// Update the rewind buffer.
+	if (m_rewind)
+		updateRewind();
+
 	// Update the I/O Manager.
 	if (m_keyManager) {
 		m_keyManager->updateIoManager(gqt4_emuContext->m_ioManager);
@@ -42,6 +42,10 @@
 // Video Backend.
 #include "VBackend/VBackend.hpp"
 
+namespace LibGens {
+	class RewindBuffer;
+}
+
 namespace GensQt4 {
 
 // Audio backend.
@@ -164,6 +168,18 @@ class EmuManager : public QObject
 		/** Savestates. **/
 		int m_saveSlot;
 
+		/** Rewind. **/
+		// NOTE: Only accessed by the GUI thread.
+		LibGens::RewindBuffer *m_rewind;	// nullptr if rewind is disabled.
+		bool m_rewinding;
+
+		/**
+		 * Update the rewind buffer after a frame is emulated.
+		 * If rewinding, the previous state is restored;
+		 * otherwise, the current state is saved.
+		 */
+		void updateRewind(void);
+
 		/**
 		 * Get the savestate filename.
 		 * TODO: Move savestate code to another file?
@@ -390,6 +406,12 @@ class EmuManager : public QObject
 		void saveState(void); // Save to current slot.
 		void loadState(void); // Load from current slot.
 
+		/**
+		 * Start or stop rewinding.
+		 * @param rewinding If true, rewind one frame per emulated frame.
+		 */
+		void setRewinding(bool rewinding);
+
 		/**
 		 * Toggle the paused state.
 		 */
@@ -428,6 +450,12 @@ class EmuManager : public QObject
 		 */
 		void enableSRam_changed_slot(const QVariant &enableSRam);
 
+		/**
+		 * Rewind buffer size has changed.
+		 * @param rewindBufferSize (int) New rewind buffer size, in MB. (0 == disabled)
+		 */
+		void rewindBufferSize_changed_slot(const QVariant &rewindBufferSize);
+
 	public slots:
 		/**
 		 * Reset the emulator.
@@ -840,7 +840,7 @@ void EmuManager::doResetCpu(EmuManager::ResetCpuIndex cpu_idx)
 	QString msg;
 	switch (cpu_idx) {
 		case RQT_CPU_M68K:
-			LibGens::M68K::Reset();
+			gqt4_emuContext->m_m68k->reset();
 			//: OSD message indicating the 68000 CPU was reset.
 			msg = tr("68000 reset.", "osd");
 			break;
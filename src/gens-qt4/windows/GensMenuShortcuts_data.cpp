@@ -106,6 +106,7 @@ const GensMenuShortcutsPrivate::KeyBinding_t GensMenuShortcutsPrivate::KeyBindin
 
 	// Non-menu keys.
 	{"other/fastBlur",		"actionNoMenuFastBlur"},
+	{"other/rewind",		"actionNoMenuRewind"},
 
 	// Savestates.
 	// TODO: Change to saveSlot/0?
@@ -213,6 +214,7 @@ const GensKey_t GensMenuShortcutsPrivate::DefKeyBindings_gens[KeyBinding_count+1
 
 	// Non-menu keys.
 	KEYV_F9,			// actionNoMenuFastBlur
+	KEYV_BACKSPACE,			// actionNoMenuRewind
 
 	// Savestates.
 	KEYV_0,				// actionNoMenuSaveSlot0
@@ -327,6 +329,7 @@ const GensKey_t GensMenuShortcutsPrivate::DefKeyBindings_kega[KeyBinding_count+1
 
 	// Non-menu keys.
 	KEYV_F9,			// actionNoMenuFastBlur
+	0,				// actionNoMenuRewind
 
 	// Savestates.
 	// NOTE: Kega doesn't map keys 0-9, but we'll
@@ -448,6 +451,7 @@ const GensKey_t GensMenuShortcutsPrivate::DefKeyBindings_regen[KeyBinding_count+
 
 	// Non-menu keys.
 	KEYV_F9,			// actionNoMenuFastBlur
+	0,				// actionNoMenuRewind
 
 	// Savestates.
 	KEYM_SHIFT | KEYV_0,		// actionNoMenuSaveSlot0
@@ -211,6 +211,7 @@ class GensWindow : public QMainWindow
 
 		// Non-Menu Actions
 		void on_actionNoMenuFastBlur_triggered(bool checked);
+		void on_actionNoMenuRewind_triggered(bool checked);
 		void map_actionNoMenuSaveSlot_triggered(int saveSlot);
 		void on_actionNoMenuSaveSlotPrev_triggered(void);
 		void on_actionNoMenuSaveSlotNext_triggered(void);
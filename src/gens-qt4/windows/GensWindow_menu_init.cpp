@@ -247,6 +247,7 @@ void GensWindowPrivate::initMenuBar(void)
 		nonMenu->clear();
 	}
 	nonMenu->addAction(ui.actionNoMenuFastBlur);
+	nonMenu->addAction(ui.actionNoMenuRewind);
 	nonMenu->addAction(ui.actionNoMenuSaveSlot0);
 	nonMenu->addAction(ui.actionNoMenuSaveSlot1);
 	nonMenu->addAction(ui.actionNoMenuSaveSlot2);
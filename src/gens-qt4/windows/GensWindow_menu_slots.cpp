@@ -264,6 +264,12 @@ void GensWindow::on_actionNoMenuFastBlur_triggered(bool checked)
 	d->vBackend->setFastBlur(checked);
 }
 
+void GensWindow::on_actionNoMenuRewind_triggered(bool checked)
+{
+	Q_D(GensWindow);
+	d->emuManager->setRewinding(checked);
+}
+
 void GensWindow::map_actionNoMenuSaveSlot_triggered(int saveSlot)
 {
 	assert(saveSlot >= 0 && saveSlot <= 9);
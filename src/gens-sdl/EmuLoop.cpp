@@ -32,8 +32,10 @@
 
 #include "SdlHandler.hpp"
 #include "VBackend.hpp"
+#include "TripleBuffer.hpp"
 using GensSdl::SdlHandler;
 using GensSdl::VBackend;
+using GensSdl::TripleBuffer;
 
 // String lookup for ROM information.
 #include "str_lookup.hpp"
@@ -43,10 +45,21 @@ using GensSdl::VBackend;
 #include "libgens/Util/MdFb.hpp"
 #include "libgens/Vdp/Vdp.hpp"
 #include "libgens/EmuContext/SysVersion.hpp"
+#include "libgens/Util/Profiler.hpp"
+#include "libgens/Util/RewindBuffer.hpp"
+#include "libgens/sound/SoundMgr.hpp"
+#include "libgens/sound/SoundCapture.hpp"
+#include "libgens/Util/VideoCapture.hpp"
+#include "libgens/cpu/M68K.hpp"
 using LibGens::Rom;
 using LibGens::MdFb;
 using LibGens::Vdp;
 using LibGens::SysVersion;
+using LibGens::Profiler;
+using LibGens::RewindBuffer;
+using LibGens::SoundMgr;
+using LibGens::SoundCapture;
+using LibGens::VideoCapture;
 
 // Emulation Context.
 #include "libgens/EmuContext/EmuContext.hpp"
@@ -73,8 +86,14 @@ using LibZomg::Zomg;
 
 // C includes. (C++ namespace)
 #include <cassert>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 // C++ includes.
+#include <atomic>
 #include <string>
 using std::string;
 
@@ -151,6 +170,134 @@ class EmuLoopPrivate : public EventLoopPrivate
 		 * and the ROM name.
 		 */
 		void updateWinTitleInfo(void);
+
+		// Show the profiler overlay.
+		bool showProfiler;
+
+		// Number of frames to average for the profiler overlay.
+		static const unsigned int PROFILER_OSD_FRAMES = 30;
+
+		/**
+		 * Toggle the profiler overlay.
+		 */
+		void doProfilerOverlay(void);
+
+		/**
+		 * Update the profiler overlay.
+		 * The overlay is refreshed every PROFILER_OSD_FRAMES frames.
+		 */
+		void updateProfilerOverlay(void);
+
+		// Run-ahead.
+		int runAhead;			// Number of frames to run ahead.
+		uint8_t *snapshotBuf;		// In-memory snapshot buffer.
+		size_t snapshotBufSize;		// Size of snapshotBuf.
+
+		/**
+		 * Run a frame with run-ahead.
+		 * The real frame is emulated first, followed by
+		 * runAhead speculative frames. The last speculative
+		 * frame is displayed, and then the real state is
+		 * restored from an in-memory snapshot.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int runAheadFrame(void);
+
+		// Rewind.
+		RewindBuffer *rewindBuffer;	// nullptr if rewind is disabled.
+		bool rewinding;			// True while Backspace is held.
+
+		/**
+		 * Update the rewind buffer before running a frame.
+		 * If rewinding, the previous state is restored;
+		 * otherwise, the current state is saved.
+		 * @return True if the previous state was restored.
+		 */
+		bool updateRewind(void);
+
+		// Sound capture.
+		SoundCapture *soundCapture;	// nullptr if not capturing.
+
+		/**
+		 * Start the sound capture, if requested.
+		 * @param options Options.
+		 */
+		void startSoundCapture(const Options *options);
+
+		/**
+		 * Stop the sound capture, if it's running.
+		 */
+		void stopSoundCapture(void);
+
+		// Video capture.
+		VideoCapture *videoCapture;	// nullptr if not capturing.
+
+		/**
+		 * Start the video capture, if requested.
+		 * @param options Options.
+		 */
+		void startVideoCapture(const Options *options);
+
+		/**
+		 * Stop the video capture, if it's running.
+		 */
+		void stopVideoCapture(void);
+
+		/**
+		 * Record a frame to the video capture, if it's running.
+		 * @param rendered If true, record MD_Screen; otherwise, repeat the previous frame.
+		 * @param samples Number of samples in the SdlHandler segment buffer, or -1 to record silence.
+		 */
+		void captureFrame(bool rendered, int samples);
+
+		// Threaded presentation.
+		TripleBuffer *tripleBuffer;	// nullptr if threaded presentation is disabled.
+		SDL_Thread *emuThread;		// Emulation thread.
+		SDL_mutex *emuMutex;		// Held while the emulation context is in use.
+		bool emuThreadStop;		// Stop the emulation thread. (emuMutex)
+		std::atomic<unsigned int> emuFrames;	// Frames emulated, including skipped frames.
+
+		// OSD message queued by the emulation thread. (emuMutex)
+		char emuOsdMsg[256];
+		int emuOsdDuration;
+
+		/**
+		 * Print an OSD message from the emulation code.
+		 * With threaded presentation, the VBackend can only be
+		 * used by the presentation thread, so the message is
+		 * queued until the emulation thread releases emuMutex.
+		 * @param duration Duration for the message to appear, in milliseconds.
+		 * @param msg Message. (printf-formatted; UTF-8)
+		 * @params ... Format arguments.
+		 */
+		void emuOsdPrintf(int duration, const char *msg, ...)
+			ATTR_FORMAT_PRINTF(3, 4);
+
+		// Frame pacing statistics. (presentation thread)
+		struct pacing_t {
+			uint64_t lastPresent;	// Time of the last present.
+			uint64_t intervalSum;	// Total time between presents.
+			uint64_t intervalMax;	// Longest time between presents.
+			uint64_t updateSum;	// Total time spent in update_video().
+			uint64_t updateMax;	// Longest update_video().
+			unsigned int presents;	// Number of presents.
+		};
+		pacing_t pacing;
+
+		// Show the frame pacing overlay.
+		bool showPacing;
+
+		/**
+		 * Toggle the frame pacing overlay.
+		 */
+		void doPacingOverlay(void);
+
+		/**
+		 * Update the frame pacing overlay.
+		 * This is called when the FPS counter is updated,
+		 * i.e. about once per second.
+		 */
+		void updatePacingOverlay(void);
 };
 
 /** EmuLoopPrivate **/
@@ -175,12 +322,37 @@ EmuLoopPrivate::EmuLoopPrivate()
 	, emuContext(nullptr)
 	, keyManager(nullptr)
 	, saveSlot_selected(0)
+	, showProfiler(false)
+	, runAhead(0)
+	, snapshotBuf(nullptr)
+	, snapshotBufSize(0)
+	, rewindBuffer(nullptr)
+	, rewinding(false)
+	, soundCapture(nullptr)
+	, videoCapture(nullptr)
+	, tripleBuffer(nullptr)
+	, emuThread(nullptr)
+	, emuMutex(nullptr)
+	, emuThreadStop(false)
+	, emuFrames(0)
+	, emuOsdDuration(0)
+	, showPacing(false)
 {
 	last_paused.data = 0;
+	emuOsdMsg[0] = 0;
+	memset(&pacing, 0, sizeof(pacing));
 }
 
 EmuLoopPrivate::~EmuLoopPrivate()
 {
+	delete tripleBuffer;
+	if (emuMutex) {
+		SDL_DestroyMutex(emuMutex);
+	}
+	free(snapshotBuf);
+	delete rewindBuffer;
+	stopSoundCapture();
+	stopVideoCapture();
 	delete rom;
 	delete emuContext;
 	delete keyManager;
@@ -403,6 +575,201 @@ void EmuLoopPrivate::doScreenShot(void)
 	}
 }
 
+/**
+ * Toggle the profiler overlay.
+ */
+void EmuLoopPrivate::doProfilerOverlay(void)
+{
+	Profiler *profiler = emuContext->m_profiler;
+	if (!profiler) {
+		vBackend->osd_print(1500,
+			"Profiler is not available.\n"
+			"Rebuild with GENS_ENABLE_PROFILER.");
+		return;
+	}
+
+	showProfiler = !showProfiler;
+	if (showProfiler) {
+		// The frame pacing overlay uses the same OSD area.
+		showPacing = false;
+
+		// Start a new averaging period.
+		profiler->reset();
+		vBackend->osd_stats("Profiler: waiting for data...");
+	} else {
+		// Hide the overlay.
+		vBackend->osd_stats(nullptr);
+	}
+}
+
+/**
+ * Update the profiler overlay.
+ * The overlay is refreshed every PROFILER_OSD_FRAMES frames.
+ */
+void EmuLoopPrivate::updateProfilerOverlay(void)
+{
+	Profiler *profiler = emuContext->m_profiler;
+	if (!showProfiler || !profiler)
+		return;
+
+	const Profiler::Stats &total = profiler->total();
+	if (total.frames < PROFILER_OSD_FRAMES)
+		return;
+
+	// Average the statistics over the collected frames.
+	// NOTE: Frames that were skipped don't have VDP time.
+	char buf[512];
+	const double frameUs = (double)total.frameNs / total.frames / 1000.0;
+	int pos = snprintf(buf, sizeof(buf), "Frame: %7.1f us (%u lines)\n",
+			   frameUs, total.lines / total.frames);
+	for (int i = 0; i < Profiler::PROF_MAX && pos < (int)sizeof(buf); i++) {
+		const double subUs = (double)total.subsystemNs[i] / total.frames / 1000.0;
+		const double pct = (frameUs > 0 ? (subUs * 100.0 / frameUs) : 0.0);
+		pos += snprintf(&buf[pos], sizeof(buf) - pos, "%-6s %7.1f us %5.1f%%\n",
+				Profiler::SubsystemName((Profiler::Subsystem_t)i), subUs, pct);
+	}
+
+	// Slowest line in the last frame.
+	const Profiler::Stats &last = profiler->lastFrame();
+	const uint32_t *lineNs = profiler->lastFrameLineNs();
+	unsigned int maxLine = 0;
+	const unsigned int lines = (last.lines < (unsigned int)Profiler::MAX_LINES
+				    ? last.lines : Profiler::MAX_LINES);
+	for (unsigned int i = 1; i < lines; i++) {
+		if (lineNs[i] > lineNs[maxLine])
+			maxLine = i;
+	}
+	if (lines > 0 && pos < (int)sizeof(buf)) {
+		pos += snprintf(&buf[pos], sizeof(buf) - pos, "Max line: %u (%.1f us)",
+				maxLine, lineNs[maxLine] / 1000.0);
+	}
+
+	// Audio buffer fill level.
+	unsigned int fill, capacity;
+	RingBuffer::Stats audioStats;
+	if (pos < (int)sizeof(buf) &&
+	    sdlHandler->audio_stats(&fill, &capacity, &audioStats) == 0)
+	{
+		pos += snprintf(&buf[pos], sizeof(buf) - pos,
+			 "\nAudio: %u/%u (min %u, max %u) U:%u O:%u",
+			 fill, capacity, audioStats.minFill, audioStats.maxFill,
+			 audioStats.underruns, audioStats.overruns);
+	}
+
+	// Scroll plane row cache hit rate.
+	Vdp *const vdp = emuContext->m_vdp;
+	if (pos < (int)sizeof(buf) && vdp->isPlaneCacheEnabled()) {
+		LibGens::VdpPlaneCache::Stats planeStats;
+		vdp->takePlaneCacheStats(&planeStats);
+		const uint64_t cells = planeStats.hits + planeStats.misses;
+		const double hitPct = (cells > 0 ? (planeStats.hits * 100.0 / cells) : 0.0);
+		pos += snprintf(&buf[pos], sizeof(buf) - pos,
+			 "\nPlanes: %5.1f%% hit (%u inval)",
+			 hitPct, (unsigned int)planeStats.invalidations);
+	}
+
+	// Skipped lines.
+	if (pos < (int)sizeof(buf) && vdp->isLineSkipEnabled()) {
+		LibGens::VdpLineSkip::Stats skipStats;
+		vdp->takeLineSkipStats(&skipStats);
+		const uint64_t total = skipStats.rendered + skipStats.skipped;
+		const double skipPct = (total > 0 ? (skipStats.skipped * 100.0 / total) : 0.0);
+		snprintf(&buf[pos], sizeof(buf) - pos,
+			 "\nLines: %5.1f%% skipped", skipPct);
+	}
+
+	vBackend->osd_stats(buf);
+	profiler->reset();
+}
+
+/**
+ * Print an OSD message from the emulation code.
+ * With threaded presentation, the VBackend can only be
+ * used by the presentation thread, so the message is
+ * queued until the emulation thread releases emuMutex.
+ * @param duration Duration for the message to appear, in milliseconds.
+ * @param msg Message. (printf-formatted; UTF-8)
+ * @params ... Format arguments.
+ */
+void EmuLoopPrivate::emuOsdPrintf(int duration, const char *msg, ...)
+{
+	va_list ap;
+	va_start(ap, msg);
+	if (!tripleBuffer) {
+		// Single-threaded. Print the message directly.
+		vBackend->osd_vprintf(duration, msg, ap);
+	} else {
+		// Threaded presentation.
+		// The caller holds emuMutex.
+		vsnprintf(emuOsdMsg, sizeof(emuOsdMsg), msg, ap);
+		emuOsdDuration = duration;
+	}
+	va_end(ap);
+}
+
+/**
+ * Toggle the frame pacing overlay.
+ */
+void EmuLoopPrivate::doPacingOverlay(void)
+{
+	if (!tripleBuffer) {
+		vBackend->osd_print(1500,
+			"Frame pacing statistics are only\n"
+			"available with --threaded-present.");
+		return;
+	}
+
+	showPacing = !showPacing;
+	if (showPacing) {
+		// The profiler overlay uses the same OSD area.
+		showProfiler = false;
+		vBackend->osd_stats("Frame pacing: waiting for data...");
+	} else {
+		// Hide the overlay.
+		vBackend->osd_stats(nullptr);
+	}
+}
+
+/**
+ * Update the frame pacing overlay.
+ * This is called when the FPS counter is updated,
+ * i.e. about once per second.
+ */
+void EmuLoopPrivate::updatePacingOverlay(void)
+{
+	// Always take the statistics so each
+	// period starts from zero, even if the
+	// overlay isn't visible.
+	TripleBuffer::Stats stats;
+	tripleBuffer->takeStats(&stats);
+	const unsigned int frames = emuFrames.exchange(0);
+	const pacing_t p = pacing;
+	pacing.intervalSum = 0;
+	pacing.intervalMax = 0;
+	pacing.updateSum = 0;
+	pacing.updateMax = 0;
+	pacing.presents = 0;
+
+	if (!showPacing)
+		return;
+
+	const unsigned int skipped = (frames > stats.published ? frames - stats.published : 0);
+	const double intervalAvg = (p.presents > 0 ? (double)p.intervalSum / p.presents / 1000.0 : 0.0);
+	const double updateAvg = (p.presents > 0 ? (double)p.updateSum / p.presents / 1000.0 : 0.0);
+
+	char buf[256];
+	snprintf(buf, sizeof(buf),
+		 "Emulated:  %3u fps (%u skipped)\n"
+		 "Presented: %3u fps (%u dropped)\n"
+		 "Interval: %5.1f ms avg, %5.1f ms max\n"
+		 "Update:   %5.1f ms avg, %5.1f ms max",
+		 frames, skipped,
+		 stats.acquired, stats.dropped,
+		 intervalAvg, p.intervalMax / 1000.0,
+		 updateAvg, p.updateMax / 1000.0);
+	vBackend->osd_stats(buf);
+}
+
 /**
  * Update the window title information.
  * This uses the system abbreviation
@@ -524,6 +891,13 @@ int EmuLoop::processSdlEvent(const SDL_Event *event) {
 					if (event->key.keysym.mod & (KMOD_LSHIFT | KMOD_RSHIFT)) {
 						// Take a screenshot.
 						d->doScreenShot();
+					} else if (d->rewindBuffer) {
+						// Rewind while Backspace is held.
+						d->rewinding = true;
+					} else if (!event->key.repeat) {
+						d->vBackend->osd_print(1500,
+							"Rewind is disabled.\n"
+							"Use --rewind=MB to enable it.");
 					}
 					break;
 
@@ -573,6 +947,16 @@ int EmuLoop::processSdlEvent(const SDL_Event *event) {
 					d->doLoadState();
 					break;
 
+				case SDLK_F10:
+					// Toggle the profiler overlay.
+					d->doProfilerOverlay();
+					break;
+
+				case SDLK_F11:
+					// Toggle the frame pacing overlay.
+					d->doPacingOverlay();
+					break;
+
 				default: {
 					// Check if the base class event handler will handle this.
 					int ret = EventLoop::processSdlEvent(event);
@@ -588,6 +972,11 @@ int EmuLoop::processSdlEvent(const SDL_Event *event) {
 			break;
 
 		case SDL_KEYUP:
+			if (event->key.keysym.sym == SDLK_BACKSPACE) {
+				// Stop rewinding.
+				d->rewinding = false;
+			}
+
 			// SDL keycodes nearly match GensKey.
 			d->keyManager->keyUp(SdlHandler::scancodeToGensKey(event->key.keysym.scancode));
 			break;
@@ -606,6 +995,227 @@ int EmuLoop::processSdlEvent(const SDL_Event *event) {
 	return ret;
 }
 
+/**
+ * Run a frame with run-ahead.
+ * The real frame is emulated first, followed by
+ * runAhead speculative frames. The last speculative
+ * frame is displayed, and then the real state is
+ * restored from an in-memory snapshot.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int EmuLoopPrivate::runAheadFrame(void)
+{
+	// Run the real frame. Only its audio is used.
+	emuContext->execFrameFast();
+	const int samples = sdlHandler->update_audio();
+
+	// Save the real state.
+	if (!snapshotBuf) {
+		// Get the required buffer size.
+		// This may increase if the game uses more SRAM later,
+		// in which case the buffer is enlarged below.
+		int reqSize = emuContext->snapshotSave(nullptr, 0);
+		if (reqSize <= 0)
+			return (reqSize < 0 ? reqSize : -EIO);
+		snapshotBufSize = reqSize;
+		snapshotBuf = (uint8_t*)malloc(snapshotBufSize);
+		if (!snapshotBuf) {
+			snapshotBufSize = 0;
+			return -ENOMEM;
+		}
+	}
+
+	int size = emuContext->snapshotSave(snapshotBuf, snapshotBufSize);
+	while (size == -ENOSPC) {
+		// Buffer is too small.
+		uint8_t *newBuf = (uint8_t*)realloc(snapshotBuf, snapshotBufSize * 2);
+		if (!newBuf)
+			return -ENOMEM;
+		snapshotBuf = newBuf;
+		snapshotBufSize *= 2;
+		size = emuContext->snapshotSave(snapshotBuf, snapshotBufSize);
+	}
+	if (size < 0)
+		return size;
+
+	// Run the speculative frames.
+	// Audio from these frames is discarded,
+	// so they aren't logged by the sound capture.
+	// NOTE: The sound capture is detached until the real
+	// state is restored, so the restore isn't logged either.
+	SoundMgr *const soundMgr = emuContext->m_soundMgr;
+	soundMgr->setCapture(nullptr);
+	for (int i = runAhead; i > 1; i--) {
+		emuContext->execFrameFast();
+	}
+	emuContext->execFrame();
+
+	// Record the displayed frame with the real frame's audio.
+	captureFrame(true, samples);
+
+	// Restore the real state.
+	int ret = emuContext->snapshotLoad(snapshotBuf, size);
+	soundMgr->setCapture(soundCapture);
+	return ret;
+}
+
+/**
+ * Start the sound capture, if requested.
+ * @param options Options.
+ */
+void EmuLoopPrivate::startSoundCapture(const Options *options)
+{
+	const string dump_vgm_filename = options->dump_vgm_filename();
+	const string dump_gym_filename = options->dump_gym_filename();
+	const string dump_wav_filename = options->dump_wav_filename();
+	if (dump_vgm_filename.empty() && dump_gym_filename.empty() &&
+	    dump_wav_filename.empty())
+	{
+		// Nothing to capture.
+		return;
+	}
+
+	const bool gym = !dump_gym_filename.empty();
+	const string &reg_filename = (gym ? dump_gym_filename : dump_vgm_filename);
+	soundCapture = new SoundCapture();
+	int ret = soundCapture->start(
+		(!reg_filename.empty() ? reg_filename.c_str() : nullptr),
+		(gym ? SoundCapture::REGFMT_GYM : SoundCapture::REGFMT_VGM),
+		(!dump_wav_filename.empty() ? dump_wav_filename.c_str() : nullptr));
+	if (ret != 0) {
+		fprintf(stderr, "Error starting sound capture: %d\n", ret);
+		delete soundCapture;
+		soundCapture = nullptr;
+		return;
+	}
+
+	emuContext->m_soundMgr->setCapture(soundCapture);
+}
+
+/**
+ * Stop the sound capture, if it's running.
+ */
+void EmuLoopPrivate::stopSoundCapture(void)
+{
+	if (!soundCapture)
+		return;
+
+	if (emuContext) {
+		emuContext->m_soundMgr->setCapture(nullptr);
+	}
+	int ret = soundCapture->stop();
+	if (ret != 0) {
+		fprintf(stderr, "Sound capture: write error: %s\n", strerror(-ret));
+	}
+	if (soundCapture->dropped() > 0) {
+		fprintf(stderr, "Sound capture: %u audio segments were dropped.\n",
+			soundCapture->dropped());
+	}
+	delete soundCapture;
+	soundCapture = nullptr;
+}
+
+/**
+ * Start the video capture, if requested.
+ * @param options Options.
+ */
+void EmuLoopPrivate::startVideoCapture(const Options *options)
+{
+	const string dump_video_filename = options->dump_video_filename();
+	if (dump_video_filename.empty()) {
+		// Nothing to capture.
+		return;
+	}
+
+	videoCapture = new VideoCapture();
+	int ret = videoCapture->start(dump_video_filename.c_str(),
+		emuContext->m_vdp->isPal(),
+		options->sound_freq(), (options->stereo() ? 2 : 1),
+		(options->video_drop() ? VideoCapture::QUEUE_DROP : VideoCapture::QUEUE_STALL));
+	if (ret != 0) {
+		fprintf(stderr, "Error starting video capture: %d\n", ret);
+		delete videoCapture;
+		videoCapture = nullptr;
+	}
+}
+
+/**
+ * Stop the video capture, if it's running.
+ */
+void EmuLoopPrivate::stopVideoCapture(void)
+{
+	if (!videoCapture)
+		return;
+
+	int ret = videoCapture->stop();
+	if (ret != 0) {
+		fprintf(stderr, "Video capture: write error: %s\n", strerror(-ret));
+	}
+	VideoCapture::Stats stats;
+	videoCapture->stats(&stats);
+	fprintf(stderr, "Video capture: %u frames, %u dropped, "
+		"%u stalls (%.3f s), max %u queued.\n",
+		stats.frames, stats.dropped, stats.stalls,
+		(double)stats.stallTime / 1000000.0, stats.maxQueued);
+	delete videoCapture;
+	videoCapture = nullptr;
+}
+
+/**
+ * Record a frame to the video capture, if it's running.
+ * @param rendered If true, record MD_Screen; otherwise, repeat the previous frame.
+ * @param samples Number of samples in the SdlHandler segment buffer, or -1 to record silence.
+ */
+void EmuLoopPrivate::captureFrame(bool rendered, int samples)
+{
+	if (!videoCapture)
+		return;
+
+	const MdFb *fb = (rendered ? emuContext->m_vdp->MD_Screen : nullptr);
+	if (samples < 0) {
+		// Audio is muted. Record a segment of silence
+		// so the video stays in sync.
+		videoCapture->pushFrame(fb, nullptr, emuContext->m_soundMgr->getSegLength());
+	} else {
+		videoCapture->pushFrame(fb, sdlHandler->segBuffer(), samples);
+	}
+}
+
+/**
+ * Update the rewind buffer before running a frame.
+ * If rewinding, the previous state is restored;
+ * otherwise, the current state is saved.
+ * @return True if the previous state was restored.
+ */
+bool EmuLoopPrivate::updateRewind(void)
+{
+	if (!rewindBuffer)
+		return false;
+
+	if (rewinding) {
+		// If nothing has been saved yet, run
+		// the frame normally and save it.
+		// NOTE: The sound capture is detached while restoring
+		// the previous state so the restore isn't logged.
+		SoundMgr *const soundMgr = emuContext->m_soundMgr;
+		soundMgr->setCapture(nullptr);
+		int ret = rewindBuffer->pop(emuContext);
+		soundMgr->setCapture(soundCapture);
+		if (ret == 0)
+			return true;
+	}
+
+	int ret = rewindBuffer->push(emuContext);
+	if (ret != 0) {
+		// Error saving the state. Disable rewind.
+		delete rewindBuffer;
+		rewindBuffer = nullptr;
+		rewinding = false;
+		emuOsdPrintf(1500, "Rewind disabled:\n* %s", strerror(-ret));
+	}
+	return false;
+}
+
 /**
  * Run the event loop.
  * @param options Options.
@@ -709,14 +1319,50 @@ int EmuLoop::run(const Options *options)
 	Vdp *vdp = d->emuContext->m_vdp;
 	vdp->options.spriteLimits = options->sprite_limits();
 
+	// M68K decoded instruction cache.
+	if (options->m68k_decode_cache()) {
+		d->emuContext->m_m68k->setDecodeCache(true);
+	}
+
+	// VDP scroll plane row cache.
+	if (options->vdp_plane_cache()) {
+		vdp->setPlaneCache(true);
+	}
+
+	// VDP pattern cache.
+	if (options->vdp_pattern_cache()) {
+		vdp->setPatternCache(true);
+	}
+
+	// VDP skip-unchanged-line rendering.
+	if (options->vdp_line_skip()) {
+		vdp->setLineSkip(true);
+	}
+
+	// VDP bulk DMA. (enabled by default)
+	vdp->setDmaBulk(options->vdp_dma_bulk());
+
+	// Run-ahead.
+	d->runAhead = options->run_ahead();
+
+	// Rewind.
+	if (options->rewind() > 0) {
+		d->rewindBuffer = new RewindBuffer((size_t)options->rewind() * 1024 * 1024);
+	}
+
 	// Initialize the SDL handlers.
 	d->sdlHandler = new SdlHandler();
 	if (d->sdlHandler->init_video() < 0)
 		return EXIT_FAILURE;
-	if (d->sdlHandler->init_audio(options->sound_freq(), options->stereo()) < 0)
+	if (d->sdlHandler->init_audio(d->emuContext->m_soundMgr, options->sound_freq(),
+					   options->stereo(), options->audio_buffer()) < 0)
 		return EXIT_FAILURE;
 	d->vBackend = d->sdlHandler->vBackend();
 
+	// Start the sound and video captures, if requested.
+	d->startSoundCapture(options);
+	d->startVideoCapture(options);
+
 	// Check for startup messages.
 	checkForStartupMessages();
 
@@ -762,8 +1408,26 @@ int EmuLoop::run(const Options *options)
 	MdFb *fb = d->emuContext->m_vdp->MD_Screen->ref();
 	fb->setBpp(options->bpp());
 
+	if (options->threaded_present()) {
+		// Threaded presentation.
+		// The emulation thread renders into a TripleBuffer,
+		// and this thread presents the newest completed frame.
+		d->tripleBuffer = new TripleBuffer(fb);
+		d->emuMutex = SDL_CreateMutex();
+		if (!d->emuMutex) {
+			fprintf(stderr, "SDL_CreateMutex() failed: %s\n"
+				"Threaded presentation is disabled.\n", SDL_GetError());
+			delete d->tripleBuffer;
+			d->tripleBuffer = nullptr;
+		}
+	}
+
 	// Set the SDL video source.
-	d->sdlHandler->set_video_source(fb);
+	if (d->tripleBuffer) {
+		d->sdlHandler->set_video_source(d->tripleBuffer->frontBuffer());
+	} else {
+		d->sdlHandler->set_video_source(fb);
+	}
 
 	// Start audio.
 	d->sdlHandler->pause_audio(false);
@@ -786,11 +1450,33 @@ int EmuLoop::run(const Options *options)
 	d->running = true;
 	d->paused.data = 0;
 	d->last_paused.data = 0;
+
+	if (d->tripleBuffer) {
+		// Start the emulation thread.
+		d->emuThreadStop = false;
+		d->emuThread = SDL_CreateThread(emuThreadFunc, "EmuThread", this);
+		if (!d->emuThread) {
+			fprintf(stderr, "SDL_CreateThread() failed: %s\n"
+				"Threaded presentation is disabled.\n", SDL_GetError());
+			d->sdlHandler->set_video_source(fb);
+			delete d->tripleBuffer;
+			d->tripleBuffer = nullptr;
+		}
+	}
+
 	while (d->running) {
+		if (d->tripleBuffer) {
+			// Threaded presentation.
+			// Keep the emulation thread from running
+			// while events are being processed.
+			SDL_LockMutex(d->emuMutex);
+		}
+
 		// Process the SDL event queue.
 		processSdlEventQueue();
 		if (!d->running) {
 			// Emulation has stopped.
+			// NOTE: emuMutex is still locked.
 			break;
 		}
 
@@ -812,6 +1498,35 @@ int EmuLoop::run(const Options *options)
 			// TODO: Wait for what would be the next frame?
 			// Otherwise, we'll end up "spinning" if e.g.
 			// there are OSD messages being processed.
+			if (d->tripleBuffer) {
+				// Don't count the paused time in
+				// the frame pacing statistics.
+				d->pacing.lastPresent = 0;
+				SDL_UnlockMutex(d->emuMutex);
+			}
+			continue;
+		}
+
+		if (d->tripleBuffer) {
+			// Threaded presentation.
+			// Frames are run by the emulation thread.
+
+			// Print the OSD message queued by the emulation thread.
+			if (d->emuOsdMsg[0] != 0) {
+				d->vBackend->osd_print(d->emuOsdDuration, d->emuOsdMsg);
+				d->emuOsdMsg[0] = 0;
+			}
+
+			// Update the I/O manager.
+			d->keyManager->updateIoManager(d->emuContext->m_ioManager);
+
+			// Update the profiler overlay.
+			d->updateProfilerOverlay();
+
+			SDL_UnlockMutex(d->emuMutex);
+
+			// Present the newest completed frame.
+			presentFrame();
 			continue;
 		}
 
@@ -825,6 +1540,20 @@ int EmuLoop::run(const Options *options)
 
 		// Update the I/O manager.
 		d->keyManager->updateIoManager(d->emuContext->m_ioManager);
+
+		// Update the profiler overlay.
+		d->updateProfilerOverlay();
+	}
+
+	if (d->tripleBuffer) {
+		// Stop the emulation thread.
+		// NOTE: emuMutex is still locked from the main loop.
+		d->emuThreadStop = true;
+		SDL_UnlockMutex(d->emuMutex);
+		if (d->emuThread) {
+			SDL_WaitThread(d->emuThread, nullptr);
+			d->emuThread = nullptr;
+		}
 	}
 
 	// Unreference the framebuffer.
@@ -834,7 +1563,13 @@ int EmuLoop::run(const Options *options)
 	// TODO: Move to EmuContext::~EmuContext()?
 	d->emuContext->saveData();
 
+	// Stop the sound and video captures.
+	d->stopSoundCapture();
+	d->stopVideoCapture();
+
 	// Shut down LibGens.
+	delete d->rewindBuffer;
+	d->rewindBuffer = nullptr;
 	delete d->keyManager;
 	d->keyManager = nullptr;
 	delete d->emuContext;
@@ -867,7 +1602,30 @@ int EmuLoop::run(const Options *options)
 void EmuLoop::runFullFrame(void)
 {
 	EmuLoopPrivate *const d = d_func();
+	if (d->updateRewind()) {
+		// Rewinding. Show the restored frame.
+		// Audio is muted while rewinding.
+		d->emuContext->execFrame();
+		d->emuContext->m_soundMgr->clearSegment();
+		d->captureFrame(true, -1);
+		return;
+	}
+
+	if (d->runAhead > 0) {
+		int ret = d->runAheadFrame();
+		if (ret != 0) {
+			// Run-ahead failed. Disable it.
+			// NOTE: If the snapshot couldn't be restored,
+			// emulation continues from the speculative state.
+			d->runAhead = 0;
+			d->emuOsdPrintf(1500, "Run-ahead disabled:\n* %s", strerror(-ret));
+		}
+		return;
+	}
+
 	d->emuContext->execFrame();
+	const int samples = d->sdlHandler->update_audio();
+	d->captureFrame(true, samples);
 }
 
 /**
@@ -879,7 +1637,161 @@ void EmuLoop::runFullFrame(void)
 void EmuLoop::runFastFrame(void)
 {
 	EmuLoopPrivate *const d = d_func();
+	if (d->updateRewind()) {
+		// Rewinding. Audio is muted while rewinding.
+		d->emuContext->execFrameFast();
+		d->emuContext->m_soundMgr->clearSegment();
+		d->captureFrame(false, -1);
+		return;
+	}
+
+	// NOTE: Run-ahead isn't needed here,
+	// since fast frames aren't displayed.
 	d->emuContext->execFrameFast();
+	const int samples = d->sdlHandler->update_audio();
+	d->captureFrame(false, samples);
+}
+
+/**
+ * Emulation thread entry point for threaded presentation.
+ * @param param EmuLoop.
+ * @return 0.
+ */
+int SDLCALL EmuLoop::emuThreadFunc(void *param)
+{
+	static_cast<EmuLoop*>(param)->runEmuThread();
+	return 0;
+}
+
+/**
+ * Run the emulation thread.
+ * Frames are rendered into the TripleBuffer's back buffer
+ * and published for the presentation thread.
+ * This handles frameskip timing the same way as runFrame().
+ */
+void EmuLoop::runEmuThread(void)
+{
+	EmuLoopPrivate *const d = d_func();
+	Vdp *const vdp = d->emuContext->m_vdp;
+
+	// Frameskip timing.
+	LibGens::Timing timing;
+	uint64_t old_clk = timing.getTime();
+	uint64_t usec_frameskip = 0;
+
+	SDL_LockMutex(d->emuMutex);
+	while (!d->emuThreadStop) {
+		if (d->paused.data) {
+			// Emulation is paused.
+			// Don't count the paused time as lag.
+			SDL_UnlockMutex(d->emuMutex);
+			usleep(10000);
+			SDL_LockMutex(d->emuMutex);
+			old_clk = timing.getTime();
+			usec_frameskip = 0;
+			continue;
+		}
+
+		// Determine how many frames to run.
+		const uint64_t new_clk = timing.getTime();
+		usec_frameskip += ((new_clk - old_clk) & 0x3FFFFF); // no more than 4 secs
+		old_clk = new_clk;
+		unsigned int frames_todo = (unsigned int)(usec_frameskip / d->usec_per_frame);
+		usec_frameskip %= d->usec_per_frame;
+
+		if (frames_todo == 0) {
+			// No frames to do yet.
+			// Wait until the next frame. The main thread
+			// can process events while we're waiting.
+			const uint64_t usec_sleep = (d->usec_per_frame - usec_frameskip);
+			SDL_UnlockMutex(d->emuMutex);
+			if (usec_sleep > 1000) {
+				usleep(usec_sleep - 1000);
+			} else {
+				yield();
+			}
+			SDL_LockMutex(d->emuMutex);
+			continue;
+		}
+		d->emuFrames += frames_todo;
+
+		// Render into the back buffer.
+		// The VDP only sets the image parameters when
+		// the display mode changes, so copy them from
+		// the previous frame.
+		MdFb *const back = d->tripleBuffer->backBuffer();
+		back->copyParams(vdp->MD_Screen);
+		vdp->setMdScreen(back);
+
+		for (; frames_todo != 1; frames_todo--) {
+			// Run a frame without rendering.
+			runFastFrame();
+		}
+		runFullFrame();
+
+		// Autosave SRAM/EEPROM.
+		d->emuContext->autoSaveData(1);
+
+		// Publish the frame.
+		// MD_Screen keeps pointing to it until the next
+		// frame starts, so screenshots and savestates
+		// taken in the meantime use the newest frame.
+		d->tripleBuffer->publish();
+
+		// Let the main thread process events.
+		SDL_UnlockMutex(d->emuMutex);
+		yield();
+		SDL_LockMutex(d->emuMutex);
+	}
+	SDL_UnlockMutex(d->emuMutex);
+}
+
+/**
+ * Present the newest completed frame, if any.
+ * Called by run() in threaded presentation mode.
+ * @return True if a frame was presented; false if not.
+ */
+bool EmuLoop::presentFrame(void)
+{
+	EmuLoopPrivate *const d = d_func();
+
+	// Update the FPS counter.
+	d->clks.new_clk = d->clks.timing.getTime();
+	if (d->updateFpsCounter()) {
+		// Update the frame pacing overlay.
+		d->updatePacingOverlay();
+	}
+
+	MdFb *const fb = d->tripleBuffer->acquire();
+	if (!fb) {
+		// No new frame yet.
+		// Don't spin while waiting for it.
+		usleep(1000);
+		return false;
+	}
+
+	// Present the frame.
+	const uint64_t start_clk = d->clks.timing.getTime();
+	d->sdlHandler->set_video_source(fb);
+	d->sdlHandler->update_video();
+	d->clks.frames++;
+	const uint64_t end_clk = d->clks.timing.getTime();
+
+	// Frame pacing statistics.
+	EmuLoopPrivate::pacing_t &pacing = d->pacing;
+	const uint64_t update = (end_clk - start_clk);
+	pacing.updateSum += update;
+	if (update > pacing.updateMax)
+		pacing.updateMax = update;
+	if (pacing.lastPresent != 0) {
+		const uint64_t interval = (start_clk - pacing.lastPresent);
+		pacing.intervalSum += interval;
+		if (interval > pacing.intervalMax)
+			pacing.intervalMax = interval;
+	}
+	pacing.lastPresent = start_clk;
+	pacing.presents++;
+	return true;
 }
 
 }
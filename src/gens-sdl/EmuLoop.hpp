@@ -80,6 +80,29 @@ class EmuLoop : public EventLoop
 		 * by running a frame with audio updates only.
 		 */
 		virtual void runFastFrame(void) final;
+
+	private:
+		/**
+		 * Emulation thread entry point for threaded presentation.
+		 * @param param EmuLoop.
+		 * @return 0.
+		 */
+		static int SDLCALL emuThreadFunc(void *param);
+
+		/**
+		 * Run the emulation thread.
+		 * Frames are rendered into the TripleBuffer's back buffer
+		 * and published for the presentation thread.
+		 * This handles frameskip timing the same way as runFrame().
+		 */
+		void runEmuThread(void);
+
+		/**
+		 * Present the newest completed frame, if any.
+		 * Called by run() in threaded presentation mode.
+		 * @return True if a frame was presented; false if not.
+		 */
+		bool presentFrame(void);
 };
 
 }
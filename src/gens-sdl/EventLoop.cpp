@@ -173,6 +173,38 @@ void EventLoopPrivate::doAboutMessage(void)
        lastF1time = curTime;
 }
 
+/**
+ * Update the FPS counter.
+ * clks.new_clk must be set to the current time.
+ * @return True if the FPS value was updated; false if not.
+ */
+bool EventLoopPrivate::updateFpsCounter(void)
+{
+	unsigned int fps_tmp = ((clks.new_clk - clks.fps_clk) & 0x3FFFFF);
+	if (fps_tmp < 1000000) {
+		// Less than 1 second has passed.
+		return false;
+	}
+
+	// More than 1 second has passed.
+	clks.fps_clk = clks.new_clk;
+	// FIXME: Just use abs() here.
+	if (clks.frames_old > clks.frames) {
+		clks.fps = (clks.frames_old - clks.frames);
+	} else {
+		clks.fps = (clks.frames - clks.frames_old);
+	}
+	clks.frames_old = clks.frames;
+
+	// TODO: Average the FPS over multiple seconds
+	// and/or quarter-seconds.
+	// TODO: FPS manager and OSD FPS.
+
+	// Update the window title.
+	updateWindowTitle();
+	return true;
+}
+
 /**
  * Set frame timing.
  * This resets the frameskip timers.
@@ -419,25 +451,7 @@ void EventLoop::runFrame(void)
 	d_ptr->clks.new_clk = d_ptr->clks.timing.getTime();
 
 	// Update the FPS counter.
-	unsigned int fps_tmp = ((d_ptr->clks.new_clk - d_ptr->clks.fps_clk) & 0x3FFFFF);
-	if (fps_tmp >= 1000000) {
-		// More than 1 second has passed.
-		d_ptr->clks.fps_clk = d_ptr->clks.new_clk;
-		// FIXME: Just use abs() here.
-		if (d_ptr->clks.frames_old > d_ptr->clks.frames) {
-			d_ptr->clks.fps = (d_ptr->clks.frames_old - d_ptr->clks.frames);
-		} else {
-			d_ptr->clks.fps = (d_ptr->clks.frames - d_ptr->clks.frames_old);
-		}
-		d_ptr->clks.frames_old = d_ptr->clks.frames;
-
-		// TODO: Average the FPS over multiple seconds
-		// and/or quarter-seconds.
-		// TODO: FPS manager and OSD FPS.
-
-		// Update the window title.
-		d_ptr->updateWindowTitle();
-	}
+	d_ptr->updateFpsCounter();
 
 	// Frameskip.
 	if (d_ptr->frameskip) {
@@ -476,13 +490,11 @@ void EventLoop::runFrame(void)
 			for (; frames_todo != 1; frames_todo--) {
 				// Run a frame without rendering.
 				runFastFrame();
-				d_ptr->sdlHandler->update_audio();
 			}
 			frames_todo = 0;
 
 			// Run a frame and render it.
 			runFullFrame();
-			d_ptr->sdlHandler->update_audio();
 			d_ptr->sdlHandler->update_video();
 			// Increment the frame counter.
 			d_ptr->clks.frames++;
@@ -490,7 +502,6 @@ void EventLoop::runFrame(void)
 	} else {
 		// Run a frame and render it.
 		runFullFrame();
-		d_ptr->sdlHandler->update_audio();
 		d_ptr->sdlHandler->update_video();
 		// Increment the frame counter.
 		d_ptr->clks.frames++;
@@ -169,6 +169,13 @@ class EventLoopPrivate
 		// Microseconds per frame.
 		unsigned int usec_per_frame;
 
+		/**
+		 * Update the FPS counter.
+		 * clks.new_clk must be set to the current time.
+		 * @return True if the FPS value was updated; false if not.
+		 */
+		bool updateFpsCounter(void);
+
 		/**
 		 * Set frame timing.
 		 * This resets the frameskip timers.
@@ -411,8 +411,13 @@ void GLBackend::set_video_source(LibGens::MdFb *fb)
 		m_fb = fb->ref();
 	}
 
-	// Reallocate the texture.
-	d->reallocTexture();
+	// Reallocate the texture if the color depth changed.
+	// All MdFbs have the same dimensions, so switching
+	// between them (e.g. threaded presentation) doesn't
+	// require a new texture.
+	if (!m_fb || m_fb->bpp() != d->lastBpp) {
+		d->reallocTexture();
+	}
 }
 
 /**
@@ -629,4 +634,15 @@ void GLBackend::osd_preview_image(int duration, const _Zomg_Img_Data_t *img_data
 	d->osd->preview_image(duration, img_data);
 }
 
+/**
+ * Set the statistics overlay text on the Onscreen Display.
+ * @param text Statistics text. (ASCII; may contain newlines) If nullptr or empty, hide the overlay.
+ */
+void GLBackend::osd_stats(const char *text)
+{
+	d->osd->setStatsText(text);
+	// VBackend is dirty.
+	setDirty();
+}
+
 }
@@ -97,6 +97,12 @@ class GLBackend : public VBackend {
 		 */
 		virtual void osd_preview_image(int duration, const _Zomg_Img_Data_t *img_data) final;
 
+		/**
+		 * Set the statistics overlay text on the Onscreen Display.
+		 * @param text Statistics text. (ASCII; may contain newlines) If nullptr or empty, hide the overlay.
+		 */
+		virtual void osd_stats(const char *text) final;
+
 	protected:
 		// Window size.
 		// TODO: Accessors?
@@ -74,17 +74,31 @@ class OptionsPrivate
 		// Audio options.
 		int sound_freq;			// Sound frequency.
 		int stereo;			// Stereo audio?
+		int audio_buffer;		// Audio device buffer size, in samples.
+		string dump_vgm_filename;	// VGM register log.
+		string dump_gym_filename;	// GYM register log.
+		string dump_wav_filename;	// WAV audio capture.
+		string dump_video_filename;	// AVI video capture.
+		int video_drop;			// Drop video frames instead of stalling?
 
 		// Emulation options.
 		int sprite_limits;		// Enable sprite limits?
 		int auto_fix_checksum;		// Auto fix checksum?
 		SysVersion::RegionCode_t region;	// Region code.
+		int run_ahead;			// Run-ahead frames.
+		int rewind;			// Rewind buffer size, in MB.
+		int m68k_decode_cache;		// M68K decoded instruction cache?
+		int vdp_plane_cache;		// VDP scroll plane row cache?
+		int vdp_pattern_cache;		// VDP pattern cache?
+		int vdp_line_skip;		// VDP skip-unchanged-line rendering?
+		int vdp_dma_bulk;		// VDP bulk DMA?
 
 		// UI options.
 		int fps_counter;		// Enable FPS counter?
 		int auto_pause;			// Auto pause?
 		int paused_effect;		// Paused effect?
 		MdFb::ColorDepth bpp;		// Color depth. (15, 16, 32)
+		int threaded_present;		// Threaded presentation?
 
 		// Special run modes.
 		int run_crazy_effect;		// Run the Crazy Effect
@@ -112,17 +126,31 @@ void OptionsPrivate::reset(void)
 	// Audio options.
 	sound_freq = 44100;
 	stereo = true;
+	audio_buffer = 1024;
+	dump_vgm_filename.clear();
+	dump_gym_filename.clear();
+	dump_wav_filename.clear();
+	dump_video_filename.clear();
+	video_drop = true;
 
 	// Emulation options.
 	sprite_limits = true;
 	auto_fix_checksum = false;
 	region = SysVersion::REGION_AUTO;
+	run_ahead = 0;
+	rewind = 0;
+	m68k_decode_cache = false;
+	vdp_plane_cache = false;
+	vdp_pattern_cache = false;
+	vdp_line_skip = false;
+	vdp_dma_bulk = true;
 
 	// UI options.
 	fps_counter = true;
 	auto_pause = false;
 	paused_effect = true;
 	bpp = MdFb::BPP_32;
+	threaded_present = false;
 
 	// Special run modes.
 	run_crazy_effect = false;
@@ -208,6 +236,10 @@ int Options::parse(int argc, const char *argv[])
 		const char *rom_filename;
 		const char *tmss_rom_filename;
 		const char *region;
+		const char *dump_vgm_filename;
+		const char *dump_gym_filename;
+		const char *dump_wav_filename;
+		const char *dump_video_filename;
 		int bpp;
 	} tmp;
 	memset(&tmp, 0, sizeof(tmp));
@@ -232,6 +264,20 @@ int Options::parse(int argc, const char *argv[])
 			"  Use monaural audio.", NULL},
 		{"stereo", '\0', POPT_ARG_VAL, &d->stereo, 1,
 			"  Use stereo audio.", NULL},
+		{"audio-buffer", '\0', POPT_ARG_INT, &d->audio_buffer, 0,
+			"  Audio device buffer size, in samples. (power of two, default is 1024)", "SAMPLES"},
+		{"dump-vgm", '\0', POPT_ARG_STRING, &tmp.dump_vgm_filename, 0,
+			"  Log YM2612 and PSG register writes to FILE in VGM format.", "FILE"},
+		{"dump-gym", '\0', POPT_ARG_STRING, &tmp.dump_gym_filename, 0,
+			"  Log YM2612 and PSG register writes to FILE in GYM format.", "FILE"},
+		{"dump-wav", '\0', POPT_ARG_STRING, &tmp.dump_wav_filename, 0,
+			"  Record audio to FILE as a WAV file.", "FILE"},
+		{"dump-video", '\0', POPT_ARG_STRING, &tmp.dump_video_filename, 0,
+			"  Record video and audio to FILE as a lossless AVI file.", "FILE"},
+		{"video-drop", '\0', POPT_ARG_VAL, &d->video_drop, 1,
+			"  Drop video frames if the encoder falls behind. (default)", NULL},
+		{"video-stall", '\0', POPT_ARG_VAL, &d->video_drop, 0,
+			"  Wait for the encoder if it falls behind.", NULL},
 		POPT_TABLEEND
 	};
 
@@ -247,6 +293,30 @@ int Options::parse(int argc, const char *argv[])
 			"* Don't automatically fix checksums.", NULL},
 		{"region", '\0', POPT_ARG_STRING, &tmp.region, 0,
 			"  Set the region code: J,U,E,Asia,Auto (default is auto)", "REGION"},
+		{"run-ahead", '\0', POPT_ARG_INT, &d->run_ahead, 0,
+			"  Run ahead by N frames to reduce input latency. (0-4, default is 0)", "N"},
+		{"rewind", '\0', POPT_ARG_INT, &d->rewind, 0,
+			"  Keep up to MB megabytes of rewind history. (0 == disabled, default is 0)", "MB"},
+		{"m68k-decode-cache", '\0', POPT_ARG_VAL, &d->m68k_decode_cache, 1,
+			"  Cache decoded 68000 instructions.", NULL},
+		{"no-m68k-decode-cache", '\0', POPT_ARG_VAL, &d->m68k_decode_cache, 0,
+			"* Don't cache decoded 68000 instructions.", NULL},
+		{"vdp-plane-cache", '\0', POPT_ARG_VAL, &d->vdp_plane_cache, 1,
+			"  Cache scroll plane rows between lines and frames.", NULL},
+		{"no-vdp-plane-cache", '\0', POPT_ARG_VAL, &d->vdp_plane_cache, 0,
+			"* Don't cache scroll plane rows.", NULL},
+		{"vdp-pattern-cache", '\0', POPT_ARG_VAL, &d->vdp_pattern_cache, 1,
+			"  Cache H-flipped pattern lines.", NULL},
+		{"no-vdp-pattern-cache", '\0', POPT_ARG_VAL, &d->vdp_pattern_cache, 0,
+			"* Don't cache H-flipped pattern lines.", NULL},
+		{"vdp-line-skip", '\0', POPT_ARG_VAL, &d->vdp_line_skip, 1,
+			"  Don't redraw lines that haven't changed.", NULL},
+		{"no-vdp-line-skip", '\0', POPT_ARG_VAL, &d->vdp_line_skip, 0,
+			"* Redraw every line.", NULL},
+		{"vdp-dma-bulk", '\0', POPT_ARG_VAL, &d->vdp_dma_bulk, 1,
+			"* Copy contiguous DMA transfers in bulk.", NULL},
+		{"no-vdp-dma-bulk", '\0', POPT_ARG_VAL, &d->vdp_dma_bulk, 0,
+			"  Do all DMA transfers word by word.", NULL},
 		POPT_TABLEEND
 	};
 
@@ -266,6 +336,10 @@ int Options::parse(int argc, const char *argv[])
 			"  Don't tint the window when paused.", NULL},
 		{"bpp", '\0', POPT_ARG_INT, &tmp.bpp, 0,
 			"  Set the internal color depth. (15, 16, 32)", "BPP"},
+		{"threaded-present", '\0', POPT_ARG_VAL, &d->threaded_present, 1,
+			"  Run emulation and presentation on separate threads.", NULL},
+		{"no-threaded-present", '\0', POPT_ARG_VAL, &d->threaded_present, 0,
+			"* Run emulation and presentation on the same thread.", NULL},
 		POPT_TABLEEND
 	};
 
@@ -379,6 +453,23 @@ int Options::parse(int argc, const char *argv[])
 		d->tmss_rom_filename = string(tmp.tmss_rom_filename);
 	}
 
+	// Sound capture filenames.
+	if (tmp.dump_vgm_filename != nullptr)
+		d->dump_vgm_filename = string(tmp.dump_vgm_filename);
+	if (tmp.dump_gym_filename != nullptr)
+		d->dump_gym_filename = string(tmp.dump_gym_filename);
+	if (tmp.dump_wav_filename != nullptr)
+		d->dump_wav_filename = string(tmp.dump_wav_filename);
+	if (tmp.dump_video_filename != nullptr)
+		d->dump_video_filename = string(tmp.dump_video_filename);
+	if (!d->dump_vgm_filename.empty() && !d->dump_gym_filename.empty()) {
+		fprintf(stderr, "%s: '--dump-vgm' and '--dump-gym' cannot be used together\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
 	// Region code.
 	if (tmp.region != nullptr) {
 		// Region code specified.
@@ -428,6 +519,40 @@ int Options::parse(int argc, const char *argv[])
 	}
 
 	// Verify certain options.
+	if (d->run_ahead < 0 || d->run_ahead > Options::RUN_AHEAD_MAX) {
+		// Invalid run-ahead value.
+		fprintf(stderr, "%s: '--run-ahead=%d': invalid number of frames\n"
+			"Valid options are 0 through %d.\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], d->run_ahead, Options::RUN_AHEAD_MAX, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	if (d->audio_buffer < Options::AUDIO_BUFFER_MIN ||
+	    d->audio_buffer > Options::AUDIO_BUFFER_MAX ||
+	    (d->audio_buffer & (d->audio_buffer - 1)) != 0)
+	{
+		// Invalid audio buffer size.
+		fprintf(stderr, "%s: '--audio-buffer=%d': invalid buffer size\n"
+			"Valid options are powers of two from %d through %d.\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], d->audio_buffer, Options::AUDIO_BUFFER_MIN,
+			Options::AUDIO_BUFFER_MAX, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
+	if (d->rewind < 0 || d->rewind > Options::REWIND_MAX) {
+		// Invalid rewind buffer size.
+		fprintf(stderr, "%s: '--rewind=%d': invalid buffer size\n"
+			"Valid options are 0 through %d.\n"
+			"Try `%s --help` for more information.\n",
+			argv[0], d->rewind, Options::REWIND_MAX, argv[0]);
+		poptFreeContext(optCon);
+		return -EINVAL;
+	}
+
 	d->bpp = MdFb::bppToColorDepth(tmp.bpp);
 	if (d->bpp < 0 || d->bpp >= MdFb::BPP_MAX) {
 		// Invalid color depth.
@@ -526,17 +651,31 @@ bool Options::is_tmss_enabled(void) const
 /** Audio options. **/
 ACCESSOR(int, sound_freq)
 ACCESSOR_BOOL(stereo)
+ACCESSOR(int, audio_buffer)
+ACCESSOR(string, dump_vgm_filename)
+ACCESSOR(string, dump_gym_filename)
+ACCESSOR(string, dump_wav_filename)
+ACCESSOR(string, dump_video_filename)
+ACCESSOR_BOOL(video_drop)
 
 /** Emulation options. **/
 ACCESSOR_BOOL(sprite_limits)
 ACCESSOR_BOOL(auto_fix_checksum)
 ACCESSOR(SysVersion::RegionCode_t, region);
+ACCESSOR(int, run_ahead)
+ACCESSOR(int, rewind)
+ACCESSOR_BOOL(m68k_decode_cache)
+ACCESSOR_BOOL(vdp_plane_cache)
+ACCESSOR_BOOL(vdp_pattern_cache)
+ACCESSOR_BOOL(vdp_line_skip)
+ACCESSOR_BOOL(vdp_dma_bulk)
 
 /** UI options. **/
 ACCESSOR_BOOL(fps_counter)
 ACCESSOR_BOOL(auto_pause)
 ACCESSOR_BOOL(paused_effect)
 ACCESSOR(MdFb::ColorDepth, bpp)
+ACCESSOR_BOOL(threaded_present)
 
 /** Special run modes. **/
 ACCESSOR_BOOL(run_crazy_effect)
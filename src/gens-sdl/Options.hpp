@@ -110,6 +110,50 @@ class Options
 		 */
 		bool stereo(void) const;
 
+		/**
+		 * Audio device buffer size limits, in samples.
+		 */
+		static const int AUDIO_BUFFER_MIN = 128;
+		static const int AUDIO_BUFFER_MAX = 8192;
+
+		/**
+		 * Audio device buffer size.
+		 * Smaller buffers reduce audio latency.
+		 * @return Audio device buffer size, in samples. (power of two)
+		 */
+		int audio_buffer(void) const;
+
+		/**
+		 * File to log YM2612 and PSG register writes to, in VGM format.
+		 * @return Filename, or empty string to not log registers.
+		 */
+		std::string dump_vgm_filename(void) const;
+
+		/**
+		 * File to log YM2612 and PSG register writes to, in GYM format.
+		 * @return Filename, or empty string to not log registers.
+		 */
+		std::string dump_gym_filename(void) const;
+
+		/**
+		 * File to record audio to, as a WAV file.
+		 * @return Filename, or empty string to not record audio.
+		 */
+		std::string dump_wav_filename(void) const;
+
+		/**
+		 * File to record video and audio to, as a lossless AVI file.
+		 * @return Filename, or empty string to not record video.
+		 */
+		std::string dump_video_filename(void) const;
+
+		/**
+		 * Drop video frames if the encoder falls behind?
+		 * If false, emulation waits for the encoder.
+		 * @return True to drop frames; false to wait.
+		 */
+		bool video_drop(void) const;
+
 		/** Emulation options. **/
 
 		/**
@@ -130,6 +174,62 @@ class Options
 		 */
 		LibGens::SysVersion::RegionCode_t region(void) const;
 
+		/**
+		 * Maximum number of run-ahead frames.
+		 */
+		static const int RUN_AHEAD_MAX = 4;
+
+		/**
+		 * Number of frames to run ahead.
+		 * The displayed frame is emulated this many frames
+		 * ahead of the real state in order to hide the
+		 * game's own input latency.
+		 * @return Number of frames to run ahead. (0 == disabled)
+		 */
+		int run_ahead(void) const;
+
+		/**
+		 * Maximum rewind buffer size, in MB.
+		 */
+		static const int REWIND_MAX = 1024;
+
+		/**
+		 * Rewind buffer size.
+		 * Hold Backspace to rewind.
+		 * @return Rewind buffer size, in MB. (0 == disabled)
+		 */
+		int rewind(void) const;
+
+		/**
+		 * Cache decoded 68000 instructions?
+		 * @return True to enable the decoded instruction cache; false to not.
+		 */
+		bool m68k_decode_cache(void) const;
+
+		/**
+		 * Cache scroll plane rows?
+		 * @return True to enable the VDP scroll plane row cache; false to not.
+		 */
+		bool vdp_plane_cache(void) const;
+
+		/**
+		 * Cache H-flipped pattern lines?
+		 * @return True to enable the VDP pattern cache; false to not.
+		 */
+		bool vdp_pattern_cache(void) const;
+
+		/**
+		 * Skip unchanged lines?
+		 * @return True to enable VDP skip-unchanged-line rendering; false to not.
+		 */
+		bool vdp_line_skip(void) const;
+
+		/**
+		 * Copy contiguous DMA transfers in bulk?
+		 * @return True to enable VDP bulk DMA; false to not.
+		 */
+		bool vdp_dma_bulk(void) const;
+
 		/** UI options. **/
 
 		/**
@@ -156,6 +256,14 @@ class Options
 		 */
 		LibGens::MdFb::ColorDepth bpp(void) const;
 
+		/**
+		 * Run emulation on a separate thread from presentation?
+		 * The newest completed frame is presented, so a slow
+		 * texture upload or vsync stall won't delay emulation.
+		 * @return True to use threaded presentation; false to not.
+		 */
+		bool threaded_present(void) const;
+
 		/** Special run modes. **/
 
 		/**
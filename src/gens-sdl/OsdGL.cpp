@@ -131,6 +131,9 @@ class OsdGLPrivate {
 		 */
 		void checkForExpiredMessages(void);
 
+		// Statistics overlay. (one entry per line)
+		vector<string> statsLines;
+
 		/** Properties. **/
 		bool fpsEnabled;
 		bool msgEnabled;
@@ -537,8 +540,8 @@ void OsdGL::end(void)
  */
 void OsdGL::draw(void)
 {
-	if (d->osdList.empty()) {
-		// No OSD messages.
+	if (d->osdList.empty() && d->statsLines.empty()) {
+		// No OSD messages or statistics.
 		// TODO: Check for FPS and "enabled" values.
 		return;
 	}
@@ -639,7 +642,20 @@ void OsdGL::draw(void)
 	// TODO: Adjust for visible texture size.
 	const uint8_t chrW = d->font->w;
 	const uint8_t chrH = d->font->h;
-	int y = (240 - chrH);
+
+	// Statistics overlay.
+	// Drawn from the top-left corner, using the FPS color.
+	int y = chrH;
+	for (int i = 0; i < (int)d->statsLines.size(); i++) {
+		const string &line = d->statsLines[i];
+		glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+		d->printLine(chrW+1, y+1, line);
+		d->setGLColor(d->fpsColor);
+		d->printLine(chrW, y, line);
+		y += chrH;
+	}
+
+	y = (240 - chrH);
 
 	// Print from top to bottom to avoid collisions
 	// with the drop shadow. (C64 font)
@@ -958,6 +974,31 @@ void OsdGL::preview_image(int duration, const Zomg_Img_Data_t *img_data)
 	d->dirty = true;
 }
 
+/**
+ * Set the statistics overlay text.
+ * This is shown in the top-left corner until it's cleared.
+ * @param text Statistics text. (ASCII; may contain newlines) If nullptr or empty, hide the overlay.
+ */
+void OsdGL::setStatsText(const char *text)
+{
+	d->statsLines.clear();
+	if (text) {
+		const char *start = text;
+		while (*start != 0) {
+			const char *nl = strchr(start, '\n');
+			if (!nl) {
+				d->statsLines.push_back(string(start));
+				break;
+			}
+			d->statsLines.push_back(string(start, nl - start));
+			start = nl + 1;
+		}
+	}
+
+	// OSD is dirty.
+	d->dirty = true;
+}
+
 /** Properties. **/
 
 bool OsdGL::isFpsEnabled(void) const
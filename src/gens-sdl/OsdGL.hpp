@@ -114,6 +114,13 @@ class OsdGL {
 		 */
 		void preview_image(int duration, const _Zomg_Img_Data_t *img_data);
 
+		/**
+		 * Set the statistics overlay text.
+		 * This is shown in the top-left corner until it's cleared.
+		 * @param text Statistics text. (ASCII; may contain newlines) If nullptr or empty, hide the overlay.
+		 */
+		void setStatsText(const char *text);
+
 	public:
 		/** Properties. **/
 
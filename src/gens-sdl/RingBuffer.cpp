@@ -25,95 +25,175 @@
 #include <cassert>
 #include <cstring>
 
+// aligned_malloc()
+#include "libcompat/aligned_malloc.h"
+
 namespace GensSdl {
 
-#include <stdio.h>
 /**
  * Initialize a RingBuffer.
- * @param samples Number of 16-bit stereo samples to allocate.
+ * @param frames Minimum number of sample frames to store. (rounded up to a power of two)
+ * @param frameSize Size of a sample frame, in bytes.
  */
-RingBuffer::RingBuffer(unsigned int samples)
-	: m_i(0)
-	, m_s(0)
+RingBuffer::RingBuffer(unsigned int frames, unsigned int frameSize)
+	: m_frameSize(frameSize)
+	, m_writePos(0)
+	, m_maxFill(0)
+	, m_overruns(0)
+	, m_readPos(0)
+	, m_minFill(~0U)
+	, m_underruns(0)
 {
-	m_size = samples * 4;
-	assert(m_size <= sizeof(m_data));
-	if (m_size > sizeof(m_data))
-		m_size = sizeof(m_data);
+	assert(frames > 0);
+	assert(frameSize > 0);
+
+	// Round the capacity up to a power of two.
+	unsigned int capacity = 1;
+	while (capacity < frames)
+		capacity <<= 1;
+	m_mask = capacity - 1;
 
-	// Clear the data buffer.
-	memset(&m_data, 0, sizeof(m_data));
+	// Allocate the data buffer.
+	const size_t bytes = (size_t)capacity * m_frameSize;
+	m_data = (uint8_t*)aligned_malloc(CACHE_LINE_SIZE, bytes);
+	memset(m_data, 0, bytes);
 }
 
 RingBuffer::~RingBuffer()
 {
-	// TODO
+	aligned_free(m_data);
 }
 
 /**
- * Write/copy data into a circular buffer.
+ * Write sample frames into the ring buffer.
+ * Producer thread only.
+ * If the buffer is full, the remaining frames are dropped.
  * @param src Buffer to copy from.
- * @param size Size of src.
- * @return Number of bytes copied.
+ * @param frames Number of sample frames in src.
+ * @return Number of sample frames copied.
  */
-unsigned int RingBuffer::write(const uint8_t *src, unsigned int size)
+unsigned int RingBuffer::write(const void *src, unsigned int frames)
 {
-	unsigned int j, k;
-
-	if (size > m_size) {
-		src += (size - m_size);
-		size = m_size;
-	}
-	k = (m_size - m_s);
-	j = ((m_i + m_s) % m_size);
-	if (size > k) {
-		m_i = ((m_i + (size - k)) % m_size);
-		m_s = m_size;
-	} else {
-		m_s += size;
+	// Only the producer modifies m_writePos.
+	const unsigned int wpos = m_writePos.load(std::memory_order_relaxed);
+	const unsigned int rpos = m_readPos.load(std::memory_order_acquire);
+	const unsigned int avail = capacity() - (wpos - rpos);
+	if (frames > avail) {
+		// Not enough space. Drop the excess frames.
+		m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1,
+				 std::memory_order_relaxed);
+		frames = avail;
 	}
-	k = (m_size - j);
-	if (k >= size) {
-		memcpy(&m_data.u8[j], src, size);
-	} else {
-		memcpy(&m_data.u8[j], src, k);
-		memcpy(&m_data.u8[0], &src[k], (size - k));
+
+	if (frames > 0) {
+		const unsigned int i = (wpos & m_mask);
+		const unsigned int k = capacity() - i;	// Frames until the end of the buffer.
+		const uint8_t *src8 = static_cast<const uint8_t*>(src);
+		if (frames <= k) {
+			memcpy(&m_data[i * m_frameSize], src8, frames * m_frameSize);
+		} else {
+			memcpy(&m_data[i * m_frameSize], src8, k * m_frameSize);
+			memcpy(&m_data[0], &src8[k * m_frameSize], (frames - k) * m_frameSize);
+		}
+
+		// Publish the data to the consumer.
+		m_writePos.store(wpos + frames, std::memory_order_release);
 	}
-	return size;
+
+	const unsigned int fill = (wpos + frames) - rpos;
+	if (fill > m_maxFill.load(std::memory_order_relaxed))
+		m_maxFill.store(fill, std::memory_order_relaxed);
+	return frames;
 }
 
 /**
- * Read bytes out of a circular buffer.
+ * Read sample frames out of the ring buffer.
+ * Consumer thread only.
  * @param dst Destination buffer.
- * @param size Maximum number of bytes to copy to dst.
- * @return Number of bytes copied.
+ * @param frames Maximum number of sample frames to copy to dst.
+ * @return Number of sample frames copied.
  */
-unsigned int RingBuffer::read(uint8_t *dst, unsigned int size)
+unsigned int RingBuffer::read(void *dst, unsigned int frames)
 {
-	if (size > m_s) {
-		size = m_s;
+	// Only the consumer modifies m_readPos.
+	const unsigned int rpos = m_readPos.load(std::memory_order_relaxed);
+	const unsigned int wpos = m_writePos.load(std::memory_order_acquire);
+	const unsigned int fill = wpos - rpos;
+	if (fill < m_minFill.load(std::memory_order_relaxed))
+		m_minFill.store(fill, std::memory_order_relaxed);
+
+	if (frames > fill) {
+		// Not enough data.
+		m_underruns.store(m_underruns.load(std::memory_order_relaxed) + 1,
+				  std::memory_order_relaxed);
+		frames = fill;
 	}
-	if ((m_i + size) > m_size) {
-		unsigned int k = (m_size - m_i);
-		memcpy(&dst[0], &m_data.u8[(m_i)], k);
-		memcpy(&dst[k], &m_data.u8[0], (size - k));
-	} else {
-		memcpy(&dst[0], &m_data.u8[(m_i)], size);
+
+	if (frames > 0) {
+		const unsigned int i = (rpos & m_mask);
+		const unsigned int k = capacity() - i;	// Frames until the end of the buffer.
+		uint8_t *dst8 = static_cast<uint8_t*>(dst);
+		if (frames <= k) {
+			memcpy(dst8, &m_data[i * m_frameSize], frames * m_frameSize);
+		} else {
+			memcpy(dst8, &m_data[i * m_frameSize], k * m_frameSize);
+			memcpy(&dst8[k * m_frameSize], &m_data[0], (frames - k) * m_frameSize);
+		}
+
+		// Release the space to the producer.
+		m_readPos.store(rpos + frames, std::memory_order_release);
 	}
-	m_i = ((m_i + size) % m_size);
-	m_s -= size;
-	return size;
+
+	return frames;
 }
 
 /**
  * Clear the buffer.
+ * The consumer must not be running when this is called,
+ * e.g. the SDL audio device must be paused.
  */
 void RingBuffer::clear(void)
 {
-	m_i = 0;
-	m_s = 0;
-	// TODO: Is this clear necessary?
-	memset(&m_data, 0, sizeof(m_data));
+	m_readPos.store(m_writePos.load(std::memory_order_relaxed),
+			std::memory_order_release);
+}
+
+/**
+ * Get the number of sample frames in the buffer.
+ * May be called from either thread.
+ * @return Number of sample frames in the buffer.
+ */
+unsigned int RingBuffer::fill(void) const
+{
+	const unsigned int rpos = m_readPos.load(std::memory_order_acquire);
+	const unsigned int wpos = m_writePos.load(std::memory_order_acquire);
+	return (wpos - rpos);
+}
+
+/**
+ * Get the fill-level telemetry.
+ * @param stats Stats struct to store the telemetry in.
+ */
+void RingBuffer::stats(Stats *stats) const
+{
+	const unsigned int minFill = m_minFill.load(std::memory_order_relaxed);
+	stats->minFill = (minFill == ~0U ? 0 : minFill);
+	stats->maxFill = m_maxFill.load(std::memory_order_relaxed);
+	stats->underruns = m_underruns.load(std::memory_order_relaxed);
+	stats->overruns = m_overruns.load(std::memory_order_relaxed);
+}
+
+/**
+ * Reset the fill-level telemetry.
+ */
+void RingBuffer::resetStats(void)
+{
+	// NOTE: If the consumer is running, one update
+	// may be lost. This is fine for telemetry.
+	m_minFill.store(~0U, std::memory_order_relaxed);
+	m_maxFill.store(0, std::memory_order_relaxed);
+	m_underruns.store(0, std::memory_order_relaxed);
+	m_overruns.store(0, std::memory_order_relaxed);
 }
 
 }
@@ -24,54 +24,126 @@
 
 #include <stdint.h>
 
+// C++ includes.
+#include <atomic>
+
 namespace GensSdl {
 
+/**
+ * Lock-free single-producer, single-consumer ring buffer.
+ *
+ * write() may only be called by one thread (the emulation loop),
+ * and read() may only be called by one other thread (the SDL
+ * audio callback). No locks are needed between the two.
+ *
+ * Data is stored in sample frames, e.g. one 16-bit sample
+ * for each channel. The capacity is rounded up to a power
+ * of two so the free-running indexes can be masked instead
+ * of using modulo arithmetic.
+ */
 class RingBuffer
 {
 	public:
 		/**
 		 * Initialize a RingBuffer.
-		 * @param samples Number of 16-bit stereo samples to allocate.
+		 * @param frames Minimum number of sample frames to store. (rounded up to a power of two)
+		 * @param frameSize Size of a sample frame, in bytes.
 		 */
-		RingBuffer(unsigned int samples);
+		RingBuffer(unsigned int frames, unsigned int frameSize);
 
 		~RingBuffer();
 
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add GensSdl-specific version of Q_DISABLE_COPY().
+		RingBuffer(const RingBuffer &);
+		RingBuffer &operator=(const RingBuffer &);
+
+	public:
 		/**
-		 * Write/copy data into a circular buffer.
+		 * Write sample frames into the ring buffer.
+		 * Producer thread only.
+		 * If the buffer is full, the remaining frames are dropped.
 		 * @param src Buffer to copy from.
-		 * @param size Size of src.
-		 * @return Number of bytes copied.
+		 * @param frames Number of sample frames in src.
+		 * @return Number of sample frames copied.
 		 */
-		unsigned int write(const uint8_t *src, unsigned int size);
+		unsigned int write(const void *src, unsigned int frames);
 
 		/**
-		 * Read bytes out of a circular buffer.
+		 * Read sample frames out of the ring buffer.
+		 * Consumer thread only.
 		 * @param dst Destination buffer.
-		 * @param size Maximum number of bytes to copy to dst.
-		 * @return Number of bytes copied.
+		 * @param frames Maximum number of sample frames to copy to dst.
+		 * @return Number of sample frames copied.
 		 */
-		unsigned int read(uint8_t *dst, unsigned int size);
+		unsigned int read(void *dst, unsigned int frames);
 
 		/**
 		 * Clear the buffer.
+		 * The consumer must not be running when this is called,
+		 * e.g. the SDL audio device must be paused.
 		 */
 		void clear(void);
 
-	protected:
-		unsigned int m_i;	// Data start index.
-		unsigned int m_s;	// Data size, in bytes.
+		/**
+		 * Get the buffer capacity.
+		 * @return Buffer capacity, in sample frames.
+		 */
+		inline unsigned int capacity(void) const
+			{ return m_mask + 1; }
+
+		/**
+		 * Get the number of sample frames in the buffer.
+		 * May be called from either thread.
+		 * @return Number of sample frames in the buffer.
+		 */
+		unsigned int fill(void) const;
+
+		/**
+		 * Fill-level telemetry.
+		 */
+		struct Stats {
+			unsigned int minFill;	// Lowest fill level seen by read().
+			unsigned int maxFill;	// Highest fill level seen by write().
+			unsigned int underruns;	// Number of short reads.
+			unsigned int overruns;	// Number of writes that dropped frames.
+		};
+
+		/**
+		 * Get the fill-level telemetry.
+		 * @param stats Stats struct to store the telemetry in.
+		 */
+		void stats(Stats *stats) const;
+
+		/**
+		 * Reset the fill-level telemetry.
+		 */
+		void resetStats(void);
+
+	private:
+		// Cache line size, used to keep the producer and
+		// consumer indexes from sharing a cache line.
+		static const unsigned int CACHE_LINE_SIZE = 64;
+
+		// Buffer. (read-only after construction)
+		uint8_t *m_data;
+		unsigned int m_mask;		// Capacity - 1, in sample frames.
+		unsigned int m_frameSize;	// Size of a sample frame, in bytes.
+		uint8_t m_pad0[CACHE_LINE_SIZE];
 
-		unsigned int m_size;	// Buffer size, in bytes.
+		// Producer state.
+		// Indexes are free-running and masked on access.
+		std::atomic<unsigned int> m_writePos;
+		std::atomic<unsigned int> m_maxFill;
+		std::atomic<unsigned int> m_overruns;
+		uint8_t m_pad1[CACHE_LINE_SIZE];
 
-		// Data buffer.
-		// Stores up to 32,768 16-bit samples.
-		// (16,384 16-bit samples in stereo.)
-		// TODO: Does it need to be larger?
-		union {
-			uint8_t u8[65536];
-			int16_t i16[32768];
-		} m_data;
+		// Consumer state.
+		std::atomic<unsigned int> m_readPos;
+		std::atomic<unsigned int> m_minFill;
+		std::atomic<unsigned int> m_underruns;
+		uint8_t m_pad2[CACHE_LINE_SIZE];
 };
 
 }
@@ -34,7 +34,6 @@ using LibGens::SoundMgr;
 
 #include <SDL.h>
 
-#include "RingBuffer.hpp"
 #include "SdlSWBackend.hpp"
 #include "SdlGLBackend.hpp"
 
@@ -43,6 +42,7 @@ namespace GensSdl {
 SdlHandler::SdlHandler()
 	: m_vBackend(nullptr)
 	, m_framesRendered(0)
+	, m_soundMgr(nullptr)
 	, m_audioDevice(0)
 	, m_audioBuffer(nullptr)
 	, m_sampleSize(0)
@@ -184,11 +184,13 @@ VBackend *SdlHandler::vBackend(void) const
 
 /**
  * Initialize SDL audio.
+ * @param soundMgr SoundMgr to read audio from.
  * @param freq Frequency.
  * @param stereo If true, use stereo.
+ * @param samples Audio device buffer size, in samples.
  * @return 0 on success; non-zero on error.
  */
-int SdlHandler::init_audio(int freq, bool stereo)
+int SdlHandler::init_audio(SoundMgr *soundMgr, int freq, bool stereo, int samples)
 {
 	SDL_AudioSpec wanted_spec, actual_spec;
 
@@ -197,6 +199,7 @@ int SdlHandler::init_audio(int freq, bool stereo)
 		// Shut it down, then reinitialize it.
 		end_audio();
 	}
+	m_soundMgr = soundMgr;
 
 	int ret = SDL_InitSubSystem(SDL_INIT_AUDIO);
 	if (ret < 0) {
@@ -205,12 +208,10 @@ int SdlHandler::init_audio(int freq, bool stereo)
 		return ret;
 	}
 
-	// Number of samples to buffer.
-	// FIXME: Should be segment size, rounded up to pow2.
 	wanted_spec.freq	= freq;
 	wanted_spec.format	= AUDIO_S16SYS;
 	wanted_spec.channels	= (stereo ? 2 : 1);
-	wanted_spec.samples	= 1024;
+	wanted_spec.samples	= samples;
 	wanted_spec.callback	= sdl_audio_callback;
 	wanted_spec.userdata	= this;
 	m_audioDevice = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, &actual_spec, 0);
@@ -222,7 +223,7 @@ int SdlHandler::init_audio(int freq, bool stereo)
 
 	// Initialize SoundMgr.
 	// TODO: NTSC/PAL setting.
-	SoundMgr::ReInit(actual_spec.freq, false, true);
+	m_soundMgr->reInit(actual_spec.freq, false, true);
 
 	// TODO: Verify the actual spec has the correct
 	// number of channels and the right format.
@@ -235,13 +236,16 @@ int SdlHandler::init_audio(int freq, bool stereo)
 	m_stereo = stereo;
 	m_sampleSize = (stereo ? 4 : 2);
 
-	// Buffer should be: (SegLength * m_sampleSize) + actual samples.
-	int samples = (SoundMgr::GetSegLength() * m_sampleSize) + actual_spec.samples;
-	m_audioBuffer = new RingBuffer(samples);
+	// Buffer should hold two segments, plus one device buffer
+	// so the callback can always be satisfied while the next
+	// segment is being emulated.
+	// RingBuffer rounds this up to a power of two.
+	const unsigned int frames = (m_soundMgr->getSegLength() * 2) + actual_spec.samples;
+	m_audioBuffer = new RingBuffer(frames, m_sampleSize);
 
 	// Segment buffer.
 	// Needed to convert "int32_t" to int16_t.
-	m_segBufferSamples = SoundMgr::GetSegLength();
+	m_segBufferSamples = m_soundMgr->getSegLength();
 	m_segBufferLen = m_segBufferSamples * m_sampleSize;
 	m_segBuffer = (int16_t*)aligned_malloc(16, m_segBufferLen);
 	memset(m_segBuffer, 0, m_segBufferLen);
@@ -311,8 +315,10 @@ void SdlHandler::sdl_audio_callback(void *userdata, uint8_t *stream, int len)
 	SdlHandler *handler = (SdlHandler*)userdata;
 
 	// Read data from the RingBuffer.
-	unsigned int wrote = handler->m_audioBuffer->read(stream, len);
-	//printf("callback: request %d, read %u\n", len, wrote);
+	// NOTE: RingBuffer is lock-free, so the emulation loop
+	// doesn't need to lock the audio device to write to it.
+	const unsigned int frames = (unsigned int)len / handler->m_sampleSize;
+	unsigned int wrote = handler->m_audioBuffer->read(stream, frames) * handler->m_sampleSize;
 	if ((int)wrote == len) {
 		// Correct amount of data read.
 		return;
@@ -324,9 +330,15 @@ void SdlHandler::sdl_audio_callback(void *userdata, uint8_t *stream, int len)
 
 /**
  * Update SDL audio using SoundMgr.
+ * @return Number of samples written to the segment buffer.
  */
-void SdlHandler::update_audio(void)
+int SdlHandler::update_audio(void)
 {
+	if (!m_soundMgr) {
+		// Audio hasn't been initialized.
+		return 0;
+	}
+
 	// TODO: If !m_audioDevice, just clear the internal
 	// audio buffer instead of writing it.
 
@@ -334,18 +346,45 @@ void SdlHandler::update_audio(void)
 	// some of the audio.
 	int samples;
 	if (m_stereo) {
-		samples = SoundMgr::writeStereo(m_segBuffer, m_segBufferSamples);
+		samples = m_soundMgr->writeStereo(m_segBuffer, m_segBufferSamples);
 	} else {
-		samples = SoundMgr::writeMono(m_segBuffer, m_segBufferSamples);
+		samples = m_soundMgr->writeMono(m_segBuffer, m_segBufferSamples);
 	}
 
 	// Write to the ringbuffer.
 	if (m_audioDevice > 0 && samples > 0) {
-		const int bytes = samples * m_sampleSize;
-		SDL_LockAudioDevice(m_audioDevice);
-		m_audioBuffer->write(reinterpret_cast<const uint8_t*>(m_segBuffer), bytes);
-		SDL_UnlockAudioDevice(m_audioDevice);
+		m_audioBuffer->write(m_segBuffer, samples);
 	}
+	return samples;
+}
+
+/**
+ * Get the segment buffer.
+ * This contains the audio from the last update_audio() call.
+ * @return Segment buffer, or nullptr if audio isn't initialized.
+ */
+const int16_t *SdlHandler::segBuffer(void) const
+{
+	return m_segBuffer;
+}
+
+/**
+ * Get the audio buffer fill-level telemetry and reset it.
+ * @param fill [out] Current fill level, in sample frames.
+ * @param capacity [out] Buffer capacity, in sample frames.
+ * @param stats [out] Fill-level telemetry since the last call.
+ * @return 0 on success; non-zero if audio isn't initialized.
+ */
+int SdlHandler::audio_stats(unsigned int *fill, unsigned int *capacity, RingBuffer::Stats *stats)
+{
+	if (!m_audioBuffer)
+		return -1;
+
+	*fill = m_audioBuffer->fill();
+	*capacity = m_audioBuffer->capacity();
+	m_audioBuffer->stats(stats);
+	m_audioBuffer->resetStats();
+	return 0;
 }
 
 }
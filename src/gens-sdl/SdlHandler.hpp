@@ -34,6 +34,13 @@
 #include "libgens/Util/MdFb.hpp"
 #include "libgenskeys/GensKey_t.h"
 
+// Audio ring buffer.
+#include "RingBuffer.hpp"
+
+namespace LibGens {
+	class SoundMgr;
+}
+
 // TODO: Minimum gcc version, other compilers?
 // TODO: Move to libgens/macros/common.h?
 #ifdef __GNUC__
@@ -45,7 +52,6 @@
 
 namespace GensSdl {
 
-class RingBuffer;
 class VBackend;
 
 class SdlHandler {
@@ -120,11 +126,13 @@ class SdlHandler {
 
 		/**
 		 * Initialize SDL audio.
+		 * @param soundMgr SoundMgr to read audio from.
 		 * @param freq Frequency.
 		 * @param stereo If true, use stereo.
+		 * @param samples Audio device buffer size, in samples.
 		 * @return 0 on success; non-zero on error.
 		 */
-		int init_audio(int freq, bool stereo);
+		int init_audio(LibGens::SoundMgr *soundMgr, int freq, bool stereo, int samples);
 
 		/**
 		 * Shut down SDL audio.
@@ -140,8 +148,25 @@ class SdlHandler {
 
 		/**
 		 * Update SDL audio using SoundMgr.
+		 * @return Number of samples written to the segment buffer.
+		 */
+		int update_audio(void);
+
+		/**
+		 * Get the segment buffer.
+		 * This contains the audio from the last update_audio() call.
+		 * @return Segment buffer, or nullptr if audio isn't initialized.
+		 */
+		const int16_t *segBuffer(void) const;
+
+		/**
+		 * Get the audio buffer fill-level telemetry and reset it.
+		 * @param fill [out] Current fill level, in sample frames.
+		 * @param capacity [out] Buffer capacity, in sample frames.
+		 * @param stats [out] Fill-level telemetry since the last call.
+		 * @return 0 on success; non-zero if audio isn't initialized.
 		 */
-		void update_audio(void);
+		int audio_stats(unsigned int *fill, unsigned int *capacity, RingBuffer::Stats *stats);
 
 		/**
 		 * Convert an SDL2 scancode to a Gens keycode.
@@ -167,6 +192,7 @@ class SdlHandler {
 		int m_framesRendered;
 
 		// Audio.
+		LibGens::SoundMgr *m_soundMgr;
 		SDL_AudioDeviceID m_audioDevice;
 		RingBuffer *m_audioBuffer;
 		int m_sampleSize;
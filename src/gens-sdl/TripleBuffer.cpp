@@ -0,0 +1,108 @@
+/***************************************************************************
+ * gens-sdl: Gens/GS II basic SDL frontend.                                *
+ * TripleBuffer.cpp: Triple-buffered MdFb.                                 *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "TripleBuffer.hpp"
+
+// LibGens
+#include "libgens/Util/MdFb.hpp"
+using LibGens::MdFb;
+
+namespace GensSdl {
+
+/**
+ * Initialize a TripleBuffer.
+ * @param proto MdFb to copy the color depth and image parameters from.
+ */
+TripleBuffer::TripleBuffer(const MdFb *proto)
+	: m_ready(1)
+	, m_back(0)
+	, m_published(0)
+	, m_dropped(0)
+	, m_front(2)
+	, m_acquired(0)
+{
+	for (int i = 0; i < 3; i++) {
+		m_fb[i] = new MdFb();
+		m_fb[i]->copyParams(proto);
+	}
+}
+
+TripleBuffer::~TripleBuffer()
+{
+	for (int i = 0; i < 3; i++) {
+		m_fb[i]->unref();
+	}
+}
+
+/**
+ * Publish the back buffer as the newest completed frame.
+ * Producer thread only.
+ * A different buffer becomes the back buffer.
+ * Its contents are undefined.
+ */
+void TripleBuffer::publish(void)
+{
+	// Swap the back buffer with the ready buffer.
+	// Release ordering makes the frame visible to acquire().
+	unsigned int prev = m_ready.exchange(m_back | READY_NEW, std::memory_order_acq_rel);
+	if (prev & READY_NEW) {
+		// The previous frame was never acquired.
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_back = (prev & ~READY_NEW);
+	m_published.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Acquire the newest completed frame as the front buffer.
+ * Consumer thread only.
+ * @return New front buffer, or nullptr if no frame was published since the last call.
+ */
+MdFb *TripleBuffer::acquire(void)
+{
+	if (!(m_ready.load(std::memory_order_relaxed) & READY_NEW)) {
+		// No new frame.
+		return nullptr;
+	}
+
+	// Swap the front buffer with the ready buffer.
+	// The producer may have published another frame
+	// since the check above; that's fine, since we
+	// get the newest one either way.
+	unsigned int prev = m_ready.exchange(m_front, std::memory_order_acq_rel);
+	m_front = (prev & ~READY_NEW);
+	m_acquired.fetch_add(1, std::memory_order_relaxed);
+	return m_fb[m_front];
+}
+
+/**
+ * Get the frame statistics and reset them.
+ * May be called from either thread.
+ * @param stats Stats struct to store the statistics in.
+ */
+void TripleBuffer::takeStats(Stats *stats)
+{
+	stats->published = m_published.exchange(0, std::memory_order_relaxed);
+	stats->acquired = m_acquired.exchange(0, std::memory_order_relaxed);
+	stats->dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+}
+
+}
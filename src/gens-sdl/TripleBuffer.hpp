@@ -0,0 +1,141 @@
+/***************************************************************************
+ * gens-sdl: Gens/GS II basic SDL frontend.                                *
+ * TripleBuffer.hpp: Triple-buffered MdFb.                                 *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __GENS_SDL_TRIPLEBUFFER_HPP__
+#define __GENS_SDL_TRIPLEBUFFER_HPP__
+
+#include <stdint.h>
+
+// C++ includes.
+#include <atomic>
+
+namespace LibGens {
+	class MdFb;
+}
+
+namespace GensSdl {
+
+/**
+ * Lock-free triple-buffered MdFb.
+ *
+ * The producer (emulation thread) renders into the back buffer
+ * and then publishes it as the newest completed frame. The
+ * consumer (presentation thread) acquires the newest completed
+ * frame and keeps it as the front buffer until it acquires
+ * another one. Neither thread ever waits for the other; if the
+ * producer publishes twice before the consumer acquires, the
+ * older frame is dropped.
+ */
+class TripleBuffer
+{
+	public:
+		/**
+		 * Initialize a TripleBuffer.
+		 * @param proto MdFb to copy the color depth and image parameters from.
+		 */
+		TripleBuffer(const LibGens::MdFb *proto);
+
+		~TripleBuffer();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add GensSdl-specific version of Q_DISABLE_COPY().
+		TripleBuffer(const TripleBuffer &);
+		TripleBuffer &operator=(const TripleBuffer &);
+
+	public:
+		/**
+		 * Get the back buffer.
+		 * Producer thread only.
+		 * @return Back buffer.
+		 */
+		inline LibGens::MdFb *backBuffer(void) const
+			{ return m_fb[m_back]; }
+
+		/**
+		 * Publish the back buffer as the newest completed frame.
+		 * Producer thread only.
+		 * A different buffer becomes the back buffer.
+		 * Its contents are undefined.
+		 */
+		void publish(void);
+
+		/**
+		 * Get the front buffer.
+		 * Consumer thread only.
+		 * @return Front buffer.
+		 */
+		inline LibGens::MdFb *frontBuffer(void) const
+			{ return m_fb[m_front]; }
+
+		/**
+		 * Acquire the newest completed frame as the front buffer.
+		 * Consumer thread only.
+		 * @return New front buffer, or nullptr if no frame was published since the last call.
+		 */
+		LibGens::MdFb *acquire(void);
+
+		/**
+		 * Frame statistics.
+		 */
+		struct Stats {
+			unsigned int published;	// Frames published by the producer.
+			unsigned int acquired;	// Frames acquired by the consumer.
+			unsigned int dropped;	// Frames replaced before they were acquired.
+		};
+
+		/**
+		 * Get the frame statistics and reset them.
+		 * May be called from either thread.
+		 * @param stats Stats struct to store the statistics in.
+		 */
+		void takeStats(Stats *stats);
+
+	private:
+		// Cache line size, used to keep the producer and
+		// consumer state from sharing a cache line.
+		static const unsigned int CACHE_LINE_SIZE = 64;
+
+		// Set in m_ready if the frame hasn't been acquired yet.
+		static const unsigned int READY_NEW = 0x80;
+
+		// Framebuffers. (read-only after construction)
+		LibGens::MdFb *m_fb[3];
+
+		// Index of the newest completed frame, plus READY_NEW.
+		std::atomic<unsigned int> m_ready;
+		uint8_t m_pad0[CACHE_LINE_SIZE];
+
+		// Producer state.
+		unsigned int m_back;
+		std::atomic<unsigned int> m_published;
+		std::atomic<unsigned int> m_dropped;
+		uint8_t m_pad1[CACHE_LINE_SIZE];
+
+		// Consumer state.
+		unsigned int m_front;
+		std::atomic<unsigned int> m_acquired;
+		uint8_t m_pad2[CACHE_LINE_SIZE];
+};
+
+}
+
+#endif /* __GENS_SDL_TRIPLEBUFFER_HPP__ */
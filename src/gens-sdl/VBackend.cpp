@@ -167,4 +167,15 @@ void VBackend::osd_preview_image(int duration, const _Zomg_Img_Data_t *img_data)
 	return;
 }
 
+/**
+ * Set the statistics overlay text on the Onscreen Display.
+ * @param text Statistics text. (ASCII; may contain newlines) If nullptr or empty, hide the overlay.
+ */
+void VBackend::osd_stats(const char *text)
+{
+	// Default implementation doesn't support OSD.
+	((void)text);
+	return;
+}
+
 }
@@ -179,6 +179,12 @@ class VBackend {
 		 */
 		virtual void osd_preview_image(int duration, const _Zomg_Img_Data_t *img_data);
 
+		/**
+		 * Set the statistics overlay text on the Onscreen Display.
+		 * @param text Statistics text. (ASCII; may contain newlines) If nullptr or empty, hide the overlay.
+		 */
+		virtual void osd_stats(const char *text);
+
 	private:
 		// Dirty flag.
 		// TODO: Combine into a bitfield?
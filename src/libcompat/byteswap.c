@@ -105,3 +105,33 @@ void __byte_swap_32_array(uint32_t *ptr, unsigned int n)
 		*ptr = __swab32(*ptr);
 	}
 }
+
+/**
+ * Interleave two byte arrays into an array of big-endian 16-bit words.
+ * dest[i*2] = even[i]; dest[i*2+1] = odd[i]
+ * This is used to decode SMD-format ROM images.
+ * @param dest Destination array. (n*2 bytes; must not overlap the sources)
+ * @param even Even bytes. (high bytes of each word)
+ * @param odd Odd bytes. (low bytes of each word)
+ * @param n Number of bytes in each source array.
+ */
+void __byte_interleave_16_array(uint8_t *dest, const uint8_t *even, const uint8_t *odd, unsigned int n)
+{
+	// Process 8 bytes from each source per iteration.
+	for (; n >= 8; n -= 8, dest += 16, even += 8, odd += 8) {
+		*(dest +  0) = *(even + 0); *(dest +  1) = *(odd + 0);
+		*(dest +  2) = *(even + 1); *(dest +  3) = *(odd + 1);
+		*(dest +  4) = *(even + 2); *(dest +  5) = *(odd + 2);
+		*(dest +  6) = *(even + 3); *(dest +  7) = *(odd + 3);
+		*(dest +  8) = *(even + 4); *(dest +  9) = *(odd + 4);
+		*(dest + 10) = *(even + 5); *(dest + 11) = *(odd + 5);
+		*(dest + 12) = *(even + 6); *(dest + 13) = *(odd + 6);
+		*(dest + 14) = *(even + 7); *(dest + 15) = *(odd + 7);
+	}
+
+	// Process remaining bytes.
+	for (; n > 0; n--, dest += 2, even++, odd++) {
+		*(dest + 0) = *even;
+		*(dest + 1) = *odd;
+	}
+}
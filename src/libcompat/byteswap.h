@@ -110,6 +110,17 @@ void __byte_swap_16_array(uint16_t *ptr, unsigned int n);
  */
 void __byte_swap_32_array(uint32_t *ptr, unsigned int n);
 
+/**
+ * Interleave two byte arrays into an array of big-endian 16-bit words.
+ * dest[i*2] = even[i]; dest[i*2+1] = odd[i]
+ * This is used to decode SMD-format ROM images.
+ * @param dest Destination array. (n*2 bytes; must not overlap the sources)
+ * @param even Even bytes. (high bytes of each word)
+ * @param odd Odd bytes. (low bytes of each word)
+ * @param n Number of bytes in each source array.
+ */
+void __byte_interleave_16_array(uint8_t *dest, const uint8_t *even, const uint8_t *odd, unsigned int n);
+
 #ifdef __cplusplus
 }
 #endif
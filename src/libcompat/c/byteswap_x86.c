@@ -34,6 +34,133 @@
 #define inline __inline
 #endif
 
+// SSSE3/AVX2-optimized functions.
+// These use function-level target attributes,
+// so they don't require compiling with -mssse3 or -mavx2.
+// The x86 CPU flags are checked at runtime.
+#ifdef LIBCOMPAT_HAS_X86_TARGET_INTRINSICS
+#include <immintrin.h>
+#endif
+
+#ifdef LIBCOMPAT_HAS_X86_TARGET_INTRINSICS
+/**
+ * 16-bit byteswap function. (SSSE3)
+ * @param ptr Pointer to array to swap.
+ * @param n Number of bytes to swap.
+ * @return Number of bytes swapped. (multiple of 16)
+ */
+__attribute__((target("ssse3")))
+static unsigned int byte_swap_16_array_ssse3(uint16_t *ptr, unsigned int n)
+{
+	const __m128i shuf = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+					   9, 8, 11, 10, 13, 12, 15, 14);
+	__m128i *xmm = (__m128i*)ptr;
+	const unsigned int n_swap = (n & ~15);
+
+	// Process 64 bytes per iteration.
+	for (; n >= 64; n -= 64, xmm += 4) {
+		__m128i x0 = _mm_loadu_si128(xmm+0);
+		__m128i x1 = _mm_loadu_si128(xmm+1);
+		__m128i x2 = _mm_loadu_si128(xmm+2);
+		__m128i x3 = _mm_loadu_si128(xmm+3);
+		_mm_storeu_si128(xmm+0, _mm_shuffle_epi8(x0, shuf));
+		_mm_storeu_si128(xmm+1, _mm_shuffle_epi8(x1, shuf));
+		_mm_storeu_si128(xmm+2, _mm_shuffle_epi8(x2, shuf));
+		_mm_storeu_si128(xmm+3, _mm_shuffle_epi8(x3, shuf));
+	}
+
+	// Process remaining 16-byte blocks.
+	for (; n >= 16; n -= 16, xmm++) {
+		_mm_storeu_si128(xmm, _mm_shuffle_epi8(_mm_loadu_si128(xmm), shuf));
+	}
+
+	return n_swap;
+}
+
+/**
+ * 16-bit byteswap function. (AVX2)
+ * @param ptr Pointer to array to swap.
+ * @param n Number of bytes to swap.
+ * @return Number of bytes swapped. (multiple of 32)
+ */
+__attribute__((target("avx2")))
+static unsigned int byte_swap_16_array_avx2(uint16_t *ptr, unsigned int n)
+{
+	// NOTE: vpshufb shuffles within each 128-bit lane,
+	// so the shuffle mask is repeated for both lanes.
+	const __m256i shuf = _mm256_setr_epi8(
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	__m256i *ymm = (__m256i*)ptr;
+	const unsigned int n_swap = (n & ~31);
+
+	// Process 128 bytes per iteration.
+	for (; n >= 128; n -= 128, ymm += 4) {
+		__m256i y0 = _mm256_loadu_si256(ymm+0);
+		__m256i y1 = _mm256_loadu_si256(ymm+1);
+		__m256i y2 = _mm256_loadu_si256(ymm+2);
+		__m256i y3 = _mm256_loadu_si256(ymm+3);
+		_mm256_storeu_si256(ymm+0, _mm256_shuffle_epi8(y0, shuf));
+		_mm256_storeu_si256(ymm+1, _mm256_shuffle_epi8(y1, shuf));
+		_mm256_storeu_si256(ymm+2, _mm256_shuffle_epi8(y2, shuf));
+		_mm256_storeu_si256(ymm+3, _mm256_shuffle_epi8(y3, shuf));
+	}
+
+	// Process remaining 32-byte blocks.
+	for (; n >= 32; n -= 32, ymm++) {
+		_mm256_storeu_si256(ymm, _mm256_shuffle_epi8(_mm256_loadu_si256(ymm), shuf));
+	}
+
+	return n_swap;
+}
+
+/**
+ * Interleave two byte arrays into an array of big-endian 16-bit words. (SSE2)
+ * @param dest Destination array.
+ * @param even Even bytes.
+ * @param odd Odd bytes.
+ * @param n Number of bytes in each source array.
+ * @return Number of bytes processed from each source array. (multiple of 16)
+ */
+__attribute__((target("sse2")))
+static unsigned int byte_interleave_16_array_sse2(uint8_t *dest, const uint8_t *even, const uint8_t *odd, unsigned int n)
+{
+	const unsigned int n_proc = (n & ~15);
+	for (; n >= 16; n -= 16, dest += 32, even += 16, odd += 16) {
+		const __m128i e = _mm_loadu_si128((const __m128i*)even);
+		const __m128i o = _mm_loadu_si128((const __m128i*)odd);
+		_mm_storeu_si128((__m128i*)(dest +  0), _mm_unpacklo_epi8(e, o));
+		_mm_storeu_si128((__m128i*)(dest + 16), _mm_unpackhi_epi8(e, o));
+	}
+	return n_proc;
+}
+
+/**
+ * Interleave two byte arrays into an array of big-endian 16-bit words. (AVX2)
+ * @param dest Destination array.
+ * @param even Even bytes.
+ * @param odd Odd bytes.
+ * @param n Number of bytes in each source array.
+ * @return Number of bytes processed from each source array. (multiple of 32)
+ */
+__attribute__((target("avx2")))
+static unsigned int byte_interleave_16_array_avx2(uint8_t *dest, const uint8_t *even, const uint8_t *odd, unsigned int n)
+{
+	const unsigned int n_proc = (n & ~31);
+	for (; n >= 32; n -= 32, dest += 64, even += 32, odd += 32) {
+		const __m256i e = _mm256_loadu_si256((const __m256i*)even);
+		const __m256i o = _mm256_loadu_si256((const __m256i*)odd);
+		// vpunpck*bw works within each 128-bit lane:
+		// lo = [0-7, 16-23], hi = [8-15, 24-31]
+		const __m256i lo = _mm256_unpacklo_epi8(e, o);
+		const __m256i hi = _mm256_unpackhi_epi8(e, o);
+		_mm256_storeu_si256((__m256i*)(dest +  0), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)(dest + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return n_proc;
+}
+#endif /* LIBCOMPAT_HAS_X86_TARGET_INTRINSICS */
+
 /**
  * Byteswap two 16-bit WORDs in a 32-bit DWORD.
  * @param dword DWORD containing two 16-bit WORDs.
@@ -68,6 +195,22 @@ void __byte_swap_16_array(uint16_t *ptr, unsigned int n)
 	// TODO: Don't bother with MMX or SSE2
 	// if n is below a certain size?
 
+#ifdef LIBCOMPAT_HAS_X86_TARGET_INTRINSICS
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		// AVX2: Swap 32 bytes (16 words) at a time.
+		unsigned int n_swap = byte_swap_16_array_avx2(ptr, n);
+		ptr += (n_swap / 2);
+		n -= n_swap;
+	} else if ((CPU_Flags & MDP_CPUFLAG_X86_SSSE3) &&
+		   !(CPU_Flags & MDP_CPUFLAG_X86_ATOM))
+	{
+		// SSSE3: Swap 16 bytes (8 words) at a time.
+		// NOTE: pshufb is slow on Atom, so SSE2 is used there.
+		unsigned int n_swap = byte_swap_16_array_ssse3(ptr, n);
+		ptr += (n_swap / 2);
+		n -= n_swap;
+	} else
+#endif /* LIBCOMPAT_HAS_X86_TARGET_INTRINSICS */
 #if defined(__GNUC__)
 	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
 		// If wptr isn't 16-byte aligned, swap words
@@ -125,7 +268,7 @@ void __byte_swap_16_array(uint16_t *ptr, unsigned int n)
 
 	// C version. Used if optimized asm isn't available,
 	// or if we have a block that isn't a multiple of
-	// 16 (SSE2) or 8 (MMX) bytes.
+	// 32 (AVX2), 16 (SSSE3, SSE2), or 8 (MMX) bytes.
 
 	// Process 8 WORDs per iteration,
 	// using 32-bit accesses.
@@ -170,3 +313,50 @@ void __byte_swap_32_array(uint32_t *ptr, unsigned int n)
 		*ptr = __swab32(*ptr);
 	}
 }
+
+/**
+ * Interleave two byte arrays into an array of big-endian 16-bit words.
+ * dest[i*2] = even[i]; dest[i*2+1] = odd[i]
+ * This is used to decode SMD-format ROM images.
+ * @param dest Destination array. (n*2 bytes; must not overlap the sources)
+ * @param even Even bytes. (high bytes of each word)
+ * @param odd Odd bytes. (low bytes of each word)
+ * @param n Number of bytes in each source array.
+ */
+void __byte_interleave_16_array(uint8_t *dest, const uint8_t *even, const uint8_t *odd, unsigned int n)
+{
+#ifdef LIBCOMPAT_HAS_X86_TARGET_INTRINSICS
+	unsigned int n_proc = 0;
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		// AVX2: Interleave 32 bytes from each source at a time.
+		n_proc = byte_interleave_16_array_avx2(dest, even, odd, n);
+	} else if (CPU_Flags & (MDP_CPUFLAG_X86_SSE2 | MDP_CPUFLAG_X86_SSSE3)) {
+		// SSE2: Interleave 16 bytes from each source at a time.
+		// NOTE: SSSE3 doesn't add anything useful here,
+		// but SSSE3 implies SSE2.
+		n_proc = byte_interleave_16_array_sse2(dest, even, odd, n);
+	}
+	dest += (n_proc * 2);
+	even += n_proc;
+	odd += n_proc;
+	n -= n_proc;
+#endif /* LIBCOMPAT_HAS_X86_TARGET_INTRINSICS */
+
+	// Process 8 bytes from each source per iteration.
+	for (; n >= 8; n -= 8, dest += 16, even += 8, odd += 8) {
+		*(dest +  0) = *(even + 0); *(dest +  1) = *(odd + 0);
+		*(dest +  2) = *(even + 1); *(dest +  3) = *(odd + 1);
+		*(dest +  4) = *(even + 2); *(dest +  5) = *(odd + 2);
+		*(dest +  6) = *(even + 3); *(dest +  7) = *(odd + 3);
+		*(dest +  8) = *(even + 4); *(dest +  9) = *(odd + 4);
+		*(dest + 10) = *(even + 5); *(dest + 11) = *(odd + 5);
+		*(dest + 12) = *(even + 6); *(dest + 13) = *(odd + 6);
+		*(dest + 14) = *(even + 7); *(dest + 15) = *(odd + 7);
+	}
+
+	// Process remaining bytes.
+	for (; n > 0; n--, dest += 2, even++, odd++) {
+		*(dest + 0) = *even;
+		*(dest + 1) = *odd;
+	}
+}
@@ -255,10 +255,21 @@ uint32_t LibCompat_GetCPUFlags(void)
 #endif /* defined(__i386__) || defined(_M_IX86) */
 
 	// Check for XSAVE.
-	if (__ecx & CPUFLAG_IA32_ECX_XSAVE) {
-		// CPU supports XSAVE. Does the OS?
-		/* FIXME: Detect XSAVE. */
-		can_XSAVE = 0;
+	if ((__ecx & (CPUFLAG_IA32_ECX_XSAVE | CPUFLAG_IA32_ECX_OSXSAVE)) ==
+	    (CPUFLAG_IA32_ECX_XSAVE | CPUFLAG_IA32_ECX_OSXSAVE))
+	{
+		// CPU supports XSAVE, and the OS has enabled it.
+		// Check if the OS saves the SSE and AVX registers.
+#ifdef XGETBV
+		unsigned int xcr0_lo, xcr0_hi;
+		XGETBV(0, xcr0_lo, xcr0_hi);
+		((void)xcr0_hi);
+		if ((xcr0_lo & (IA32_XCR0_SSE | IA32_XCR0_AVX)) ==
+		    (IA32_XCR0_SSE | IA32_XCR0_AVX))
+		{
+			can_XSAVE = 1;
+		}
+#endif /* XGETBV */
 	}
 
 	// Check for AVX.
@@ -83,6 +83,18 @@ extern "C" {
 
 #endif /* __MDP_CPUFLAGS_H */
 
+// Compiler support for SIMD intrinsics in functions with
+// __attribute__((target("..."))), e.g. target("avx2").
+// This allows SIMD code to be built without compiling
+// the entire file with -mssse3 or -mavx2.
+// The CPU flags must still be checked at runtime.
+// Requires gcc 4.9 or later, or clang.
+#if (defined(__i386__) || defined(__amd64__) || defined(__x86_64__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && \
+     (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define LIBCOMPAT_HAS_X86_TARGET_INTRINSICS 1
+#endif
+
 extern uint32_t CPU_Flags;
 uint32_t LibCompat_GetCPUFlags(void);
 
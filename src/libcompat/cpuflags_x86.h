@@ -73,6 +73,11 @@
 #define CPUFLAG_IA32_EXT_ECX_XOP	((uint32_t)(1U << 11))
 #define CPUFLAG_IA32_EXT_ECX_FMA4	((uint32_t)(1U << 16))
 
+// XCR0: Extended control register 0. (XGETBV)
+// These bits indicate which register states are saved by the OS.
+#define IA32_XCR0_SSE		((uint32_t)(1U << 1))
+#define IA32_XCR0_AVX		((uint32_t)(1U << 2))
+
 // CPUID functions.
 #define CPUID_MAX_FUNCTIONS			((uint32_t)(0x00000000U))
 #define CPUID_PROC_INFO_FEATURE_BITS		((uint32_t)(0x00000001U))
@@ -135,6 +140,27 @@
 #error Missing 'cpuid' asm implementation for this compiler.
 #endif
 
+// XGETBV macro.
+// Only valid if CPUID reports OSXSAVE.
+#if defined(__GNUC__)
+// NOTE: Using the opcode directly, since older
+// assemblers don't recognize the 'xgetbv' mnemonic.
+#define XGETBV(xcr, lo, hi) do {				\
+	__asm__ (						\
+		".byte	0x0F, 0x01, 0xD0\n"			\
+		: "=a" (lo), "=d" (hi)				\
+		: "c" (xcr)					\
+		);						\
+	} while (0)
+#elif defined(_MSC_VER) && _MSC_VER >= 1600
+// _xgetbv() was added in MSVC 2010 SP1.
+#define XGETBV(xcr, lo, hi) do {				\
+	unsigned __int64 __xcr = _xgetbv(xcr);			\
+	(lo) = (unsigned int)(__xcr);				\
+	(hi) = (unsigned int)(__xcr >> 32);			\
+} while (0)
+#endif
+
 /**
  * Force a function to be marked as inline.
  * FORCE_INLINE: Release builds only.
@@ -163,7 +189,10 @@
  */
 static FORCE_INLINE_DEBUG int is_cpuid_supported(void)
 {
+#if (defined(__GNUC__) && defined(__i386__)) || \
+    (defined(_MSC_VER) && defined(_M_IX86))
 	int __eax;
+#endif
 #if defined(__GNUC__) && defined(__i386__)
 	// gcc, i386
 	__asm__ (
@@ -63,6 +63,14 @@ void ByteswapTest::SetUp(void)
 	// Verify CPU flags.
 	ByteswapTest_flags flags = GetParam();
 	uint32_t totalFlags = (flags.cpuFlags | flags.cpuFlags_slow);
+	if (flags.cpuFlags != 0 && flags.optional && (CPU_Flags & totalFlags) == 0) {
+		// Optional flags aren't supported by this CPU.
+		printf("CPU does not support the flags for this test.\n"
+		       "Testing the C version instead.\n");
+		cpuFlags_old = CPU_Flags;
+		CPU_Flags = 0;
+		return;
+	}
 	if (flags.cpuFlags != 0) {
 		ASSERT_NE(0U, CPU_Flags & totalFlags) <<
 			"CPU does not support the required flags for this test.";
@@ -237,11 +245,37 @@ TEST_P(ByteswapTest, checkByteSwap32Array)
 	ASSERT_EQ(0, memcmp(data, ByteswapTest_data_swap32, sizeof(data)));
 }
 
+/**
+ * Test 16-bit array interleaving.
+ */
+TEST_P(ByteswapTest, checkInterleave16Array)
+{
+	// Use the first half of the test data as even bytes
+	// and the second half as odd bytes.
+	// NOTE: 258 bytes isn't a multiple of 16 or 32,
+	// so the C version handles the last few bytes.
+	const unsigned int n = sizeof(ByteswapTest_data_orig) / 2;
+	const uint8_t *even = &ByteswapTest_data_orig[0];
+	const uint8_t *odd = &ByteswapTest_data_orig[n];
+
+	uint8_t expected[sizeof(ByteswapTest_data_orig)];
+	for (unsigned int i = 0; i < n; i++) {
+		expected[i*2] = even[i];
+		expected[i*2+1] = odd[i];
+	}
+
+	uint8_t data[sizeof(ByteswapTest_data_orig)];
+	memset(data, 0, sizeof(data));
+	__byte_interleave_16_array(data, even, odd, n);
+	ASSERT_EQ(0, memcmp(data, expected, sizeof(data)));
+}
+
 INSTANTIATE_TEST_CASE_P(ByteswapTest_NoFlags, ByteswapTest,
 	::testing::Values(ByteswapTest_flags(0, 0)
 ));
 
-// NOTE: byteswap.c only implements MMX/SSE2 using GNU assembler.
+// NOTE: byteswap_x86.c implements MMX/SSE2 using GNU assembler,
+// and SSE2/SSSE3/AVX2 using intrinsics with target attributes.
 // TODO: Add some flag to disable non-MMX/SSE2 asm optimizations, e.g. 'bswap'.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
@@ -251,6 +285,12 @@ INSTANTIATE_TEST_CASE_P(ByteswapTest_MMX, ByteswapTest,
 INSTANTIATE_TEST_CASE_P(ByteswapTest_SSE2, ByteswapTest,
 	::testing::Values(ByteswapTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
 ));
+INSTANTIATE_TEST_CASE_P(ByteswapTest_SSSE3, ByteswapTest,
+	::testing::Values(ByteswapTest_flags(MDP_CPUFLAG_X86_SSSE3, 0, true)
+));
+INSTANTIATE_TEST_CASE_P(ByteswapTest_AVX2, ByteswapTest,
+	::testing::Values(ByteswapTest_flags(MDP_CPUFLAG_X86_AVX2, 0, true)
+));
 #endif
 
 } }
@@ -31,10 +31,15 @@ struct ByteswapTest_flags {
 	uint32_t cpuFlags;
 	uint32_t cpuFlags_slow;
 
-	ByteswapTest_flags(uint32_t cpuFlags, uint32_t cpuFlags_slow)
+	// If true, the C version is tested if the
+	// CPU doesn't support the required flags.
+	bool optional;
+
+	ByteswapTest_flags(uint32_t cpuFlags, uint32_t cpuFlags_slow, bool optional = false)
 	{
 		this->cpuFlags = cpuFlags;
 		this->cpuFlags_slow = cpuFlags_slow;
+		this->optional = optional;
 	}
 };
 
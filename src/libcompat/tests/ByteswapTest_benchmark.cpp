@@ -30,6 +30,7 @@
 
 // C includes. (C++ namespace)
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 // Test data.
@@ -50,8 +51,30 @@ class ByteswapTest_benchmark : public ::testing::TestWithParam<ByteswapTest_flag
 	protected:
 		// Previous CPU flags.
 		uint32_t cpuFlags_old;
+
+		// Size of a large ROM image. (4 MB)
+		static const unsigned int LARGE_ROM_SIZE = 4*1024*1024;
+
+		/**
+		 * Allocate a large test buffer filled with the test data.
+		 * @return Test buffer. (LARGE_ROM_SIZE bytes; free with free())
+		 */
+		static uint8_t *allocLargeBuffer(void);
 };
 
+/**
+ * Allocate a large test buffer filled with the test data.
+ * @return Test buffer. (LARGE_ROM_SIZE bytes; free with free())
+ */
+uint8_t *ByteswapTest_benchmark::allocLargeBuffer(void)
+{
+	uint8_t *buf = (uint8_t*)malloc(LARGE_ROM_SIZE);
+	for (unsigned int i = 0; i < LARGE_ROM_SIZE; i += 512) {
+		memcpy(&buf[i], ByteswapTest_data_orig, 512);
+	}
+	return buf;
+}
+
 /**
  * Set up the test.
  */
@@ -60,6 +83,14 @@ void ByteswapTest_benchmark::SetUp(void)
 	// Verify CPU flags.
 	ByteswapTest_flags flags = GetParam();
 	uint32_t totalFlags = (flags.cpuFlags | flags.cpuFlags_slow);
+	if (flags.cpuFlags != 0 && flags.optional && (CPU_Flags & totalFlags) == 0) {
+		// Optional flags aren't supported by this CPU.
+		printf("CPU does not support the flags for this test.\n"
+		       "Testing the C version instead.\n");
+		cpuFlags_old = CPU_Flags;
+		CPU_Flags = 0;
+		return;
+	}
 	if (flags.cpuFlags != 0) {
 		ASSERT_NE(0U, CPU_Flags & totalFlags) <<
 			"CPU does not support the required flags for this test.";
@@ -117,11 +148,51 @@ TEST_P(ByteswapTest_benchmark, checkByteSwap32Array)
 	}
 }
 
+/**
+ * Benchmark 16-bit array byteswapping on a 4 MB ROM image.
+ */
+TEST_P(ByteswapTest_benchmark, checkByteSwap16Array_4MB)
+{
+	uint8_t *data = allocLargeBuffer();
+	ASSERT_TRUE(data != nullptr);
+
+	// Run this test 1,000 times. (4 GB total)
+	for (int i = 1000; i > 0; i--) {
+		__byte_swap_16_array((uint16_t*)data, LARGE_ROM_SIZE);
+	}
+
+	free(data);
+}
+
+/**
+ * Benchmark SMD-style 16-bit interleaving on a 4 MB ROM image.
+ */
+TEST_P(ByteswapTest_benchmark, checkInterleave16Array_4MB)
+{
+	uint8_t *src = allocLargeBuffer();
+	uint8_t *dest = (uint8_t*)malloc(LARGE_ROM_SIZE);
+	ASSERT_TRUE(src != nullptr);
+	ASSERT_TRUE(dest != nullptr);
+
+	// Run this test 1,000 times. (4 GB total)
+	// Each 16 KB SMD block has 8 KB of odd bytes
+	// followed by 8 KB of even bytes.
+	for (int i = 1000; i > 0; i--) {
+		for (unsigned int blk = 0; blk < LARGE_ROM_SIZE; blk += 16384) {
+			__byte_interleave_16_array(&dest[blk], &src[blk + 8192], &src[blk], 8192);
+		}
+	}
+
+	free(dest);
+	free(src);
+}
+
 INSTANTIATE_TEST_CASE_P(ByteswapTest_benchmark_NoFlags, ByteswapTest_benchmark,
 	::testing::Values(ByteswapTest_flags(0, 0)
 ));
 
-// NOTE: byteswap_x86.c only implements MMX/SSE2 using GNU assembler.
+// NOTE: byteswap_x86.c implements MMX/SSE2 using GNU assembler,
+// and SSE2/SSSE3/AVX2 using intrinsics with target attributes.
 // TODO: Add some flag to disable non-MMX/SSE2 asm optimizations, e.g. 'bswap'.
 #if defined(__GNUC__) && \
     (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
@@ -131,6 +202,12 @@ INSTANTIATE_TEST_CASE_P(ByteswapTest_benchmark_MMX, ByteswapTest_benchmark,
 INSTANTIATE_TEST_CASE_P(ByteswapTest_benchmark_SSE2, ByteswapTest_benchmark,
 	::testing::Values(ByteswapTest_flags(MDP_CPUFLAG_X86_SSE2, MDP_CPUFLAG_X86_SSE2SLOW)
 ));
+INSTANTIATE_TEST_CASE_P(ByteswapTest_benchmark_SSSE3, ByteswapTest_benchmark,
+	::testing::Values(ByteswapTest_flags(MDP_CPUFLAG_X86_SSSE3, 0, true)
+));
+INSTANTIATE_TEST_CASE_P(ByteswapTest_benchmark_AVX2, ByteswapTest_benchmark,
+	::testing::Values(ByteswapTest_flags(MDP_CPUFLAG_X86_AVX2, 0, true)
+));
 #endif
 
 } }
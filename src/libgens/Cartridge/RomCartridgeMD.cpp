@@ -35,7 +35,7 @@
 #include "lg_osd.h"
 
 // ZOMG
-#include "libzomg/Zomg.hpp"
+#include "libzomg/ZomgBase.hpp"
 #include "libzomg/zomg_md_time_reg.h"
 
 // aligned_malloc()
@@ -73,7 +73,7 @@ namespace LibGens
 class RomCartridgeMDPrivate
 {
 	public:
-		RomCartridgeMDPrivate(RomCartridgeMD *q, Rom *rom);
+		RomCartridgeMDPrivate(RomCartridgeMD *q, Rom *rom, EmuContext *context);
 		~RomCartridgeMDPrivate();
 
 	private:
@@ -88,6 +88,9 @@ class RomCartridgeMDPrivate
 		// ROM class this RomCartridgeMD is assigned to.
 		Rom *rom;
 
+		// Emulation context this RomCartridgeMD is assigned to.
+		EmuContext *context;
+
 		/**
 		 * ROM fixups table entry.
 		 */
@@ -325,9 +328,10 @@ int RomCartridgeMDPrivate::CheckRomFixups(const string serialNumber, uint16_t ch
 	return -1;
 }
 
-RomCartridgeMDPrivate::RomCartridgeMDPrivate(RomCartridgeMD *q, Rom *rom)
+RomCartridgeMDPrivate::RomCartridgeMDPrivate(RomCartridgeMD *q, Rom *rom, EmuContext *context)
 	: q(q)
 	, rom(rom)
+	, context(context)
 	, romFixup(-1)
 	, eprType(-1)
 { }
@@ -339,8 +343,8 @@ RomCartridgeMDPrivate::~RomCartridgeMDPrivate()
  * RomCartridgeMD functions. *
  *****************************/
 
-RomCartridgeMD::RomCartridgeMD(Rom *rom)
-	: d(new RomCartridgeMDPrivate(this, rom))
+RomCartridgeMD::RomCartridgeMD(Rom *rom, EmuContext *context)
+	: d(new RomCartridgeMDPrivate(this, rom, context))
 	, m_romData(nullptr)
 	, m_romData_size(0)
 	, m_mars(false)
@@ -489,11 +493,11 @@ bool RomCartridgeMD::isRomLoaded(void) const
 
 /**
  * Update M68K CPU program access structs for bankswitching purposes.
- * @param M68K_Fetch Pointer to first STARSCREAM_PROGRAMREGION to update.
+ * @param m68k M68K CPU to update.
  * @param banks Maximum number of banks to update.
  * @return Number of banks updated.
  */
-int RomCartridgeMD::updateSysBanking(int banks)
+int RomCartridgeMD::updateSysBanking(M68K *m68k, int banks)
 {
 	int banksUpdated = 0;
 	if (banks > ARRAY_SIZE(m_cartBanks))
@@ -508,7 +512,7 @@ int RomCartridgeMD::updateSysBanking(int banks)
 			const uint32_t romAddrStart = (0x80000 * (m_cartBanks[i] - BANK_ROM_00));
 			if (romAddrStart < m_romData_size) {
 				// Valid bank. Map it.
-				M68K::SetFetch(romAddrStart, romAddrStart + 0x7FFFF, m_romData + romAddrStart);
+				m68k->setFetch(romAddrStart, romAddrStart + 0x7FFFF, m_romData + romAddrStart);
 				banksUpdated++;
 			}
 		}
@@ -518,6 +522,54 @@ int RomCartridgeMD::updateSysBanking(int banks)
 	return banksUpdated;
 }
 
+/**
+ * Get a direct pointer to a 64 KB page of ROM data.
+ * Used by M68K_Mem's direct page map.
+ *
+ * Pages that may contain SRAM or EEPROM are never mapped,
+ * even if save data or the SRAM control register currently
+ * disables them, so toggling those doesn't require an update.
+ *
+ * @param address Page address. (Low 16 bits are ignored.)
+ * @return Pointer to byteswapped ROM data, or nullptr if readByte()/readWord() must be used.
+ */
+const uint8_t *RomCartridgeMD::readPagePtr(uint32_t address) const
+{
+	if (!m_romData)
+		return nullptr;
+
+	address &= 0xFF0000;
+	const uint32_t pageEnd = (address | 0xFFFF);
+	const uint8_t phys_bank = ((address >> 19) & 0x1F);
+	if (phys_bank >= ARRAY_SIZE(m_cartBanks))
+		return nullptr;
+
+	// Only physical ROM banks can be mapped.
+	// Mappers and unused banks use readByte()/readWord().
+	const uint8_t bank = m_cartBanks[phys_bank];
+	if (/*bank < BANK_ROM_00 ||*/ bank > BANK_ROM_3F)
+		return nullptr;
+
+	// The entire page must be within the ROM image.
+	// Otherwise, out-of-range reads need to return 0xFF.
+	const uint32_t romAddr = (((bank - BANK_ROM_00) << 19) | (address & 0x70000));
+	if (romAddr + 0x10000 > m_romData_size)
+		return nullptr;
+
+	// Check for save data.
+	if (m_EEPRom.isEEPRomTypeSet()) {
+		if (m_EEPRom.isReadPortInRange(address, pageEnd))
+			return nullptr;
+	} else if (m_SRam.start() <= m_SRam.end() &&
+		   m_SRam.start() <= pageEnd && m_SRam.end() >= address)
+	{
+		// Page overlaps SRam.
+		return nullptr;
+	}
+
+	return (static_cast<const uint8_t*>(m_romData) + romAddr);
+}
+
 /**
  * Fix the ROM checksum.
  * @return 0 on success; non-zero on error.
@@ -883,7 +935,7 @@ uint8_t RomCartridgeMD::readByte(uint32_t address)
 	// Check for save data access.
 	// TODO: Determine the physical banks for SRAM/EEPROM and
 	// check that in order to optimize this.
-	if (EmuContext::GetSaveDataEnable()) {
+	if (d->context->saveDataEnable()) {
 		if (m_EEPRom.isEEPRomTypeSet()) {
 			// EEPRom is enabled.
 			if (m_EEPRom.isReadBytePort(address)) {
@@ -989,7 +1041,7 @@ uint16_t RomCartridgeMD::readWord(uint32_t address)
 	// Check for save data access.
 	// TODO: Determine the physical banks for SRAM/EEPROM and
 	// check that in order to optimize this.
-	if (EmuContext::GetSaveDataEnable()) {
+	if (d->context->saveDataEnable()) {
 		if (m_EEPRom.isEEPRomTypeSet()) {
 			// EEPRom is enabled.
 			if (m_EEPRom.isReadWordPort(address)) {
@@ -1091,7 +1143,7 @@ uint16_t RomCartridgeMD::readWord(uint32_t address)
  */
 void RomCartridgeMD::writeByte(uint32_t address, uint8_t data)
 {
-	if (!EmuContext::GetSaveDataEnable()) {
+	if (!d->context->saveDataEnable()) {
 		// Save data is disabled.
 		return;
 	}
@@ -1124,7 +1176,7 @@ void RomCartridgeMD::writeByte(uint32_t address, uint8_t data)
  */
 void RomCartridgeMD::writeWord(uint32_t address, uint16_t data)
 {
-	if (!EmuContext::GetSaveDataEnable()) {
+	if (!d->context->saveDataEnable()) {
 		// Save data is disabled.
 		return;
 	}
@@ -1227,7 +1279,7 @@ void RomCartridgeMD::writeByte_TIME(uint8_t address, uint8_t data)
 			if (m_mars)
 				updateMarsBanking();
 			// TODO: Better way to update Starscream?
-			M68K::UpdateSysBanking();
+			d->context->m_m68k->updateSysBanking();
 			return;
 		}
 	}
@@ -1270,7 +1322,7 @@ void RomCartridgeMD::writeWord_TIME(uint8_t address, uint16_t data)
 			if (m_mars)
 				updateMarsBanking();
 			// TODO: Better way to update Starscream?
-			M68K::UpdateSysBanking();
+			d->context->m_m68k->updateSysBanking();
 			return;
 		}
 	}
@@ -1387,7 +1439,7 @@ void RomCartridgeMD::updateMarsBanking(void)
  * Save the cartridge data, including /TIME, SRAM, and/or EEPROM.
  * @param zomg ZOMG savestate to save to.
  */
-void RomCartridgeMD::zomgSave(LibZomg::Zomg *zomg) const
+void RomCartridgeMD::zomgSave(LibZomg::ZomgBase *zomg) const
 {
 	// Save the MD /TIME registers.
 	Zomg_MD_TimeReg_t md_time_reg_save;
@@ -1432,7 +1484,7 @@ void RomCartridgeMD::zomgSave(LibZomg::Zomg *zomg) const
  * @param zomg ZOMG savestate to restore from.
  * @param loadSaveData If true, load the save data in addition to the state.
  */
-void RomCartridgeMD::zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData)
+void RomCartridgeMD::zomgRestore(LibZomg::ZomgBase *zomg, bool loadSaveData)
 {
 	Zomg_MD_TimeReg_t md_time_reg_save;
 	int ret = zomg->loadMD_TimeReg(&md_time_reg_save);
@@ -1492,7 +1544,7 @@ void RomCartridgeMD::zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData)
 			if (m_mars)
 				updateMarsBanking();
 			// TODO: Better way to update Starscream?
-			M68K::UpdateSysBanking();
+			d->context->m_m68k->updateSysBanking();
 			break;
 		}
 
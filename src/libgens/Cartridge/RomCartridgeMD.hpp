@@ -32,19 +32,21 @@
 #include "Save/EEPRomI2C.hpp"
 
 namespace LibZomg {
-	class Zomg;
+	class ZomgBase;
 }
 
 namespace LibGens {
 
 class Rom;
+class EmuContext;
+class M68K;
 
 class RomCartridgeMDPrivate;
 
 class RomCartridgeMD
 {
 	public:
-		RomCartridgeMD(Rom *rom);
+		RomCartridgeMD(Rom *rom, EmuContext *context);
 		~RomCartridgeMD();
 
 	private:
@@ -78,11 +80,24 @@ class RomCartridgeMD
 
 		/**
 		 * Update M68K CPU program access structs for bankswitching purposes.
-		 * @param M68K_Fetch Pointer to first STARSCREAM_PROGRAMREGION to update.
+		 * @param m68k M68K CPU to update.
 		 * @param banks Maximum number of banks to update.
 		 * @return Number of banks updated.
 		 */
-		int updateSysBanking(int banks);
+		int updateSysBanking(M68K *m68k, int banks);
+
+		/**
+		 * Get a direct pointer to a 64 KB page of ROM data.
+		 * Used by M68K_Mem's direct page map.
+		 *
+		 * Pages that may contain SRAM or EEPROM are never mapped,
+		 * even if save data or the SRAM control register currently
+		 * disables them, so toggling those doesn't require an update.
+		 *
+		 * @param address Page address. (Low 16 bits are ignored.)
+		 * @return Pointer to byteswapped ROM data, or nullptr if readByte()/readWord() must be used.
+		 */
+		const uint8_t *readPagePtr(uint32_t address) const;
 
 		/**
 		 * Fix the ROM checksum.
@@ -117,8 +132,8 @@ class RomCartridgeMD
 		int autoSaveData(int framesElapsed);
 
 		/** ZOMG savestate functions. **/
-		void zomgSave(LibZomg::Zomg *zomg) const;
-		void zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData);
+		void zomgSave(LibZomg::ZomgBase *zomg) const;
+		void zomgRestore(LibZomg::ZomgBase *zomg, bool loadSaveData);
 
 	protected:
 		/**
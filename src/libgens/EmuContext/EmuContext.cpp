@@ -23,10 +23,8 @@
 
 #include "EmuContext.hpp"
 
-#ifdef NDEBUG
-#undef NDEBUG
-#endif
-#include <assert.h>
+// C includes. (C++ namespace)
+#include <cerrno>
 
 // C++ includes.
 #include <string>
@@ -36,27 +34,14 @@ using std::string;
 
 // Objects.
 #include "Vdp/Vdp.hpp"
-#include "cpu/Z80.hpp"
-
-// ROM data access.
-// TODO: Move ROM data to a cartridge class?
-// NOTE: Currently only needed for fixChecksum() / restoreChecksum().
-// Maybe fixChecksum() / restoreChecksum() should be moved to EmuMD.
+#include "cpu/M68K.hpp"
 #include "cpu/M68K_Mem.hpp"
+#include "cpu/Z80.hpp"
+#include "sound/SoundMgr.hpp"
+#include "Util/Profiler.hpp"
 
 namespace LibGens {
 
-// Reference counter.
-// We're only allowing one emulation context at the moment.
-int EmuContext::ms_RefCount = 0;
-
-// Controller I/O manager.
-// TODO: Make this non-static!
-IoManager *EmuContext::m_ioManager;
-
-// Static pointer. Temporarily needed for SRam/EEPRom.
-EmuContext *EmuContext::m_instance = nullptr;
-
 /**
  * Global settings.
  */
@@ -72,7 +57,10 @@ bool EmuContext::ms_TmssEnabled = false;
  * @param region System region. (not used in the base class)
  */
 EmuContext::EmuContext(Rom *rom, SysVersion::RegionCode_t region)
-	: m_z80(nullptr)
+	: m_m68k(nullptr)
+	, m_m68kMem(nullptr)
+	, m_z80(nullptr)
+	, m_profiler(nullptr)
 {
 	init(nullptr, rom, region);
 }
@@ -84,7 +72,10 @@ EmuContext::EmuContext(Rom *rom, SysVersion::RegionCode_t region)
  * @param region System region. (not used in the base class)
  */
 EmuContext::EmuContext(MdFb *fb, Rom *rom, SysVersion::RegionCode_t region)
-	: m_z80(nullptr)
+	: m_m68k(nullptr)
+	, m_m68kMem(nullptr)
+	, m_z80(nullptr)
+	, m_profiler(nullptr)
 {
 	init(fb, rom, region);
 }
@@ -101,41 +92,39 @@ void EmuContext::init(MdFb *fb, Rom *rom, SysVersion::RegionCode_t region)
 	// This may change later on.
 	((void)region);
 
-	ms_RefCount++;
-	assert(ms_RefCount == 1);
-	m_instance = this;
-
 	// Initialize variables.
 	m_rom = rom;
 	m_saveDataEnable = true;	// Enabled by default. (TODO: Config setting.)
 
 	// Create the Controller I/O manager.
-	// TODO: For now, we'll treat them as static.
-	if (!m_ioManager)
-		m_ioManager = new IoManager();
+	m_ioManager = new IoManager();
 
 	// Initialize the VDP.
 	// TODO: Apply user-specified VDP options.
-	m_vdp = new Vdp(fb);
+	m_vdp = new Vdp(fb, this);
+
+	// Initialize the Sound Manager.
+	m_soundMgr = new SoundMgr(this);
 
-	// NOTE: Z80 is NOT initialized here.
-	// It is initialized by the subclass if it's needed.
+#ifdef GENS_ENABLE_PROFILER
+	// Initialize the frame profiler.
+	m_profiler = new Profiler();
+#endif
+
+	// NOTE: M68K and Z80 are NOT initialized here.
+	// They are initialized by the subclass if they're needed.
 }
 
 EmuContext::~EmuContext()
 {
-	ms_RefCount--;
-	assert(ms_RefCount == 0);
-	m_instance = nullptr;
-
-	// TODO: Delete the IoManager?
-	//delete m_ioManager;
-	//m_ioManager = nullptr;
-
 	// Delete any allocated objects.
 	delete m_vdp;
+	delete m_m68k;
+	delete m_m68kMem;
 	delete m_z80;
-	M68K_Mem::ms_Z80 = nullptr;
+	delete m_soundMgr;
+	delete m_ioManager;
+	delete m_profiler;
 }
 
 /**
@@ -149,4 +138,32 @@ void EmuContext::SetPathSRam(const std::string &newPathSRam)
 	// TODO: Update SRam/EEPRom classes in active contexts.
 }
 
+/**
+ * Save the current state to a memory buffer.
+ * Default implementation for systems that don't support snapshots.
+ * @param buf	[out] Snapshot buffer.
+ * @param siz	[in] Size of buf.
+ * @return Snapshot size on success; negative errno on error.
+ */
+int EmuContext::snapshotSave(void *buf, size_t siz) const
+{
+	((void)buf);
+	((void)siz);
+	return -ENOSYS;
+}
+
+/**
+ * Load the current state from a memory buffer.
+ * Default implementation for systems that don't support snapshots.
+ * @param buf	[in] Snapshot buffer.
+ * @param siz	[in] Size of buf.
+ * @return 0 on success; negative errno on error.
+ */
+int EmuContext::snapshotLoad(const void *buf, size_t siz)
+{
+	((void)buf);
+	((void)siz);
+	return -ENOSYS;
+}
+
 }
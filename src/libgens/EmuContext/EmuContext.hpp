@@ -31,6 +31,9 @@
 // TODO: Make the region code non-console-specific.
 #include "SysVersion.hpp"
 
+// C includes. (C++ namespace)
+#include <cstddef>
+
 // C++ includes.
 #include <string>
 
@@ -39,7 +42,11 @@ namespace LibGens {
 class Rom;
 class MdFb;
 class Vdp;
+class M68K;
+class M68K_Mem;
 class Z80;
+class SoundMgr;
+class Profiler;
 
 class EmuContext
 {
@@ -57,10 +64,7 @@ class EmuContext
 	private:
 		void init(MdFb *fb, Rom *rom, SysVersion::RegionCode_t region);
 
-	public:	
-		// Get the current EmuContext instance.
-		static EmuContext *Instance(void);
-
+	public:
 		/**
 		 * Save SRam/EEPRom.
 		 * @return 1 if SRam was saved; 2 if EEPRom was saved; 0 if nothing was saved. (TODO: Enum?)
@@ -102,8 +106,7 @@ class EmuContext
 			{ return (m_rom != nullptr); }
 
 		// Controller I/O manager.
-		// TODO: Make this non-static!
-		static IoManager *m_ioManager;
+		IoManager *m_ioManager;
 
 		/**
 		 * Read the system version register. (MD)
@@ -123,9 +126,6 @@ class EmuContext
 		bool saveDataEnable(void);
 		void setSaveDataEnable(bool newSaveDataEnable);
 
-		// Static functions. Temporarily needed for SRam/EEPRom.
-		static inline bool GetSaveDataEnable(void) { return m_instance->m_saveDataEnable; }
-
 		/**
 		 * Load the current state from a ZOMG file.
 		 * @param filename	[in] ZOMG file.
@@ -140,6 +140,33 @@ class EmuContext
 		 */
 		virtual int zomgSave(const char *filename) const = 0;
 
+		/**
+		 * Save the current state to a memory buffer.
+		 * This is much faster than zomgSave(): there's no compression
+		 * and no file I/O. Snapshots are only valid for the current
+		 * build of libgens, so they shouldn't be written to disk.
+		 * Intended for run-ahead, rewind, etc.
+		 *
+		 * If buf is nullptr, nothing is saved, and the required
+		 * buffer size is returned. This may increase later if
+		 * the game uses more SRAM.
+		 *
+		 * @param buf	[out] Snapshot buffer. (may be nullptr)
+		 * @param siz	[in] Size of buf.
+		 * @return Snapshot size on success; negative errno on error. (-ENOSPC if buf is too small)
+		 */
+		virtual int snapshotSave(void *buf, size_t siz) const;
+
+		/**
+		 * Load the current state from a memory buffer.
+		 * Audio that hasn't been written by the SoundMgr yet is discarded.
+		 * The snapshot must have been saved by the same type of EmuContext.
+		 * @param buf	[in] Snapshot buffer.
+		 * @param siz	[in] Size of buf.
+		 * @return 0 on success; negative errno on error. (-EINVAL if the snapshot isn't valid)
+		 */
+		virtual int snapshotLoad(const void *buf, size_t siz);
+
 		/**
 		 * Global settings.
 		 */
@@ -168,9 +195,22 @@ class EmuContext
 		/** VDP (TODO: Make this non-public?) **/
 		Vdp *m_vdp;
 
+		/** M68K (TODO: Make this non-public?) **/
+		M68K *m_m68k;
+		M68K_Mem *m_m68kMem;
+
 		/** Z80 (TODO: Make this non-public?) **/
 		Z80 *m_z80;
 
+		/** Sound Manager (TODO: Make this non-public?) **/
+		SoundMgr *m_soundMgr;
+
+		/**
+		 * Frame profiler.
+		 * This is nullptr if GENS_ENABLE_PROFILER isn't defined.
+		 */
+		Profiler *m_profiler;
+
 		/**
 		 * Get the Rom class being used by this emulator context.
 		 * @return Rom class.
@@ -186,9 +226,6 @@ class EmuContext
 		 */
 		SysVersion m_sysVersion;
 
-		// Static pointer. Temporarily needed for SRam/EEPRom.
-		static EmuContext *m_instance;
-
 		/**
 		 * Global settings.
 		 */
@@ -196,15 +233,8 @@ class EmuContext
 		static std::string ms_PathSRam;
 		static std::string ms_TmssRomFilename;
 		static bool ms_TmssEnabled;
-
-	private:
-		static int ms_RefCount;
 };
 
-// Get the current EmuContext instance.
-inline EmuContext *EmuContext::Instance(void)
-	{ return m_instance; }
-
 /**
  * Read the system version register. (MD)
  * @return MD version register.
@@ -31,11 +31,15 @@
 
 // CPU emulators.
 #include "cpu/M68K.hpp"
+#include "cpu/M68K_Mem.hpp"
 #include "cpu/Z80.hpp"
 
 // Sound Manager.
 #include "sound/SoundMgr.hpp"
 
+// Frame profiler.
+#include "Util/Profiler.hpp"
+
 // LibGens OSD handler.
 #include "lg_osd.h"
 
@@ -57,6 +61,10 @@ namespace LibGens {
 EmuMD::EmuMD(Rom *rom, SysVersion::RegionCode_t region )
 	: EmuContext(rom, region)
 {
+	// Create the M68K and its memory map.
+	m_m68k = new M68K(this);
+	m_m68kMem = new M68K_Mem(this);
+
 	// Load the ROM image.
 	m_rom = rom;	// NOTE: This is already done in EmuContext::EmuContext()...
 	if (!m_rom) {
@@ -74,20 +82,20 @@ EmuMD::EmuMD(Rom *rom, SysVersion::RegionCode_t region )
 	}
 
 	// Load the ROM into memory.
-	M68K_Mem::ms_RomCartridge = new RomCartridgeMD(rom);
-	M68K_Mem::ms_RomCartridge->loadRom();
-	if (!M68K_Mem::ms_RomCartridge->isRomLoaded()) {
+	m_m68kMem->m_romCartridge = new RomCartridgeMD(rom, this);
+	m_m68kMem->m_romCartridge->loadRom();
+	if (!m_m68kMem->m_romCartridge->isRomLoaded()) {
 		// Error loading the ROM.
 		// TODO: Set an error code.
-		delete M68K_Mem::ms_RomCartridge;
-		M68K_Mem::ms_RomCartridge = nullptr;
+		delete m_m68kMem->m_romCartridge;
+		m_m68kMem->m_romCartridge = nullptr;
 		m_rom = nullptr;
 		return;
 	}
 
 	// Autofix the ROM checksum, if enabled.
 	if (AutoFixChecksum())
-		M68K_Mem::ms_RomCartridge->fixChecksum();
+		m_m68kMem->m_romCartridge->fixChecksum();
 
 	// Initialize TMSS.
 	// NOTE: This must be done *before* calling InitSys(), since
@@ -95,20 +103,19 @@ EmuMD::EmuMD(Rom *rom, SysVersion::RegionCode_t region )
 	initTmss();
 
 	// Initialize the M68K.
-	M68K::InitSys(M68K::SYSID_MD);
+	m_m68k->initSys(M68K::SYSID_MD);
 
 	// Initialize the Z80.
 	// Z80's initial state is RESET.
-	M68K_Mem::Z80_State = (Z80_STATE_ENABLED | Z80_STATE_RESET);	// TODO: "Sound, Z80" setting.
-	m_z80 = new Z80();
-	M68K_Mem::ms_Z80 = m_z80;	// TODO: Better way to cross-reference CPUs.
+	m_m68kMem->Z80_State = (Z80_STATE_ENABLED | Z80_STATE_RESET);	// TODO: "Sound, Z80" setting.
+	m_z80 = new Z80(this);
 
 	// Initialize the system status.
 	// TODO: Move Vdp::SysStatus to EmuContext.
 	m_vdp->SysStatus.data = 0;
 	m_vdp->SysStatus.Genesis = 1;
 	// If TMSS is disabled, initialize the VDP registers.
-	if (!M68K_Mem::tmss_reg.isTmssEnabled()) {
+	if (!m_m68kMem->tmss_reg.isTmssEnabled()) {
 		m_vdp->doFakeBootRomInit();
 	}
 
@@ -126,11 +133,11 @@ EmuMD::EmuMD(Rom *rom, SysVersion::RegionCode_t region )
 EmuMD::~EmuMD()
 {
 	// TODO: Other stuff?
-	M68K::EndSys();
+	m_m68k->endSys();
 
 	// Delete the RomCartridgeMD.
-	delete M68K_Mem::ms_RomCartridge;
-	M68K_Mem::ms_RomCartridge = nullptr;
+	delete m_m68kMem->m_romCartridge;
+	m_m68kMem->m_romCartridge = nullptr;
 }
 
 /**
@@ -143,18 +150,18 @@ int EmuMD::softReset(void)
 	// - If autofix is enabled, fix the checksum.
 	// - If autofix is disabled, restore the checksum.
 	if (AutoFixChecksum())
-		M68K_Mem::ms_RomCartridge->fixChecksum();
+		m_m68kMem->m_romCartridge->fixChecksum();
 	else
-		M68K_Mem::ms_RomCartridge->restoreChecksum();
+		m_m68kMem->m_romCartridge->restoreChecksum();
 
 	// Reset the M68K, Z80, and YM2612.
-	M68K::Reset();
+	m_m68k->reset();
 	m_z80->softReset();
-	SoundMgr::ms_Ym2612.reset();
+	m_soundMgr->m_ym2612.reset();
 
 	// Z80 state should be reset to the default value.
 	// Z80's initial state is RESET.
-	M68K_Mem::Z80_State = (Z80_STATE_ENABLED | Z80_STATE_RESET);	// TODO: "Sound, Z80" setting.
+	m_m68kMem->Z80_State = (Z80_STATE_ENABLED | Z80_STATE_RESET);	// TODO: "Sound, Z80" setting.
 
 	// TODO: Genesis Plus randomizes the restart line.
 	// See genesis.c:176.
@@ -179,21 +186,21 @@ int EmuMD::hardReset(void)
 	// - If autofix is enabled, fix the checksum.
 	// - If autofix is disabled, restore the checksum.
 	if (AutoFixChecksum())
-		M68K_Mem::ms_RomCartridge->fixChecksum();
+		m_m68kMem->m_romCartridge->fixChecksum();
 	else
-		M68K_Mem::ms_RomCartridge->restoreChecksum();
+		m_m68kMem->m_romCartridge->restoreChecksum();
 
 	// Hard-Reset the M68K, Z80, VDP, PSG, and YM2612.
 	// This includes clearing RAM.
-	M68K::InitSys(M68K::SYSID_MD);
+	m_m68k->initSys(M68K::SYSID_MD);
 	m_z80->reinit();
-	SoundMgr::ms_Psg.reset();
-	SoundMgr::ms_Ym2612.reset();
+	m_soundMgr->m_psg.reset();
+	m_soundMgr->m_ym2612.reset();
 
 	// Reset the VDP.
 	m_vdp->reset();
 	// If TMSS is disabled, initialize the VDP registers.
-	if (!M68K_Mem::tmss_reg.isTmssEnabled()) {
+	if (!m_m68kMem->tmss_reg.isTmssEnabled()) {
 		m_vdp->doFakeBootRomInit();
 	}
 	// Make sure the VDP's video mode bit is set properly.
@@ -258,16 +265,16 @@ int EmuMD::setRegion_int(SysVersion::RegionCode_t region, bool preserveState)
 	 * [Round_Double() rounds 0.5 to 0 and 1.5 to 1.] */
 	// TODO: Jorge says CPL is always 3420 master clock cycles...
 	if (m_sysVersion.isPal()) {
-		M68K_Mem::CPL_M68K = Round_Double((((double)CLOCK_PAL / 7.0) / 50.0) / 312.0);
-		M68K_Mem::CPL_Z80 = Round_Double((((double)CLOCK_PAL / 15.0) / 50.0) / 312.0);
+		m_m68kMem->CPL_M68K = Round_Double((((double)CLOCK_PAL / 7.0) / 50.0) / 312.0);
+		m_m68kMem->CPL_Z80 = Round_Double((((double)CLOCK_PAL / 15.0) / 50.0) / 312.0);
 	} else {
-		M68K_Mem::CPL_M68K = Round_Double((((double)CLOCK_NTSC / 7.0) / 60.0) / 262.0);
-		M68K_Mem::CPL_Z80 = Round_Double((((double)CLOCK_NTSC / 15.0) / 60.0) / 262.0);
+		m_m68kMem->CPL_M68K = Round_Double((((double)CLOCK_NTSC / 7.0) / 60.0) / 262.0);
+		m_m68kMem->CPL_Z80 = Round_Double((((double)CLOCK_NTSC / 15.0) / 60.0) / 262.0);
 	}
 
 	// Initialize audio.
 	// NOTE: Only set the region. Sound rate is set by the UI.
-	SoundMgr::SetRegion(m_sysVersion.isPal(), preserveState);
+	m_soundMgr->setRegion(m_sysVersion.isPal(), preserveState);
 
 	// Region set successfully.
 	return 0;
@@ -280,8 +287,8 @@ int EmuMD::setRegion_int(SysVersion::RegionCode_t region, bool preserveState)
 int EmuMD::saveData(void)
 {
 	// TODO: Call lg_osd here instead of in RomCartridgeMD().
-	if (M68K_Mem::ms_RomCartridge)
-		return M68K_Mem::ms_RomCartridge->saveData();
+	if (m_m68kMem->m_romCartridge)
+		return m_m68kMem->m_romCartridge->saveData();
 
 	// Nothing was saved.
 	return 0;
@@ -295,8 +302,8 @@ int EmuMD::saveData(void)
 int EmuMD::autoSaveData(int framesElapsed)
 {
 	// TODO: Call lg_osd here instead of in RomCartridgeMD().
-	if (M68K_Mem::ms_RomCartridge)
-		return M68K_Mem::ms_RomCartridge->autoSaveData(framesElapsed);
+	if (m_m68kMem->m_romCartridge)
+		return m_m68kMem->m_romCartridge->autoSaveData(framesElapsed);
 
 	// Nothing was saved.
 	return 0;
@@ -312,13 +319,13 @@ void EmuMD::initTmss(void)
 	// TODO: Update TMSS settings when loading a savestate?
 	// TODO: Save TMSS settings to the savestate.
 	m_sysVersion.setVersion(0);
-	if (!M68K_Mem::tmss_reg.loadTmssRom()) {
+	if (!m_m68kMem->tmss_reg.loadTmssRom()) {
 		// TMSS ROM initialized.
 		m_sysVersion.setVersion(1);
 	}
 
 	// Update the TMSS mapping.
-	M68K_Mem::UpdateTmssMapping();
+	m_m68kMem->updateTmssMapping();
 }
 
 /**
@@ -329,15 +336,19 @@ void EmuMD::initTmss(void)
 template<EmuMD::LineType_t LineType, bool VDP>
 FORCE_INLINE void EmuMD::T_execLine(void)
 {
-	int writePos = SoundMgr::GetWritePos(m_vdp->VDP_Lines.currentLine);
-	int32_t *bufL = &SoundMgr::ms_SegBufL[writePos];
-	int32_t *bufR = &SoundMgr::ms_SegBufR[writePos];
+	PROFILER_BEGIN_LINE(m_profiler, m_vdp->VDP_Lines.currentLine);
+
+	int writePos = m_soundMgr->getWritePos(m_vdp->VDP_Lines.currentLine);
+	int32_t *bufL = &m_soundMgr->m_segBufL[writePos];
+	int32_t *bufR = &m_soundMgr->m_segBufR[writePos];
 
 	// Update the sound chips.
-	int writeLen = SoundMgr::GetWriteLen(m_vdp->VDP_Lines.currentLine);
-	SoundMgr::ms_Ym2612.updateDacAndTimers(bufL, bufR, writeLen);
-	SoundMgr::ms_Ym2612.addWriteLen(writeLen);
-	SoundMgr::ms_Psg.addWriteLen(writeLen);
+	int writeLen = m_soundMgr->getWriteLen(m_vdp->VDP_Lines.currentLine);
+	PROFILER_BEGIN(m_profiler, PROF_YM2612);
+	m_soundMgr->m_ym2612.updateDacAndTimers(bufL, bufR, writeLen);
+	PROFILER_END(m_profiler, PROF_YM2612);
+	m_soundMgr->m_ym2612.addWriteLen(writeLen);
+	m_soundMgr->m_psg.addWriteLen(writeLen);
 
 	// Notify controllers that a new scanline is being drawn.
 	m_ioManager->doScanline();
@@ -346,17 +357,22 @@ FORCE_INLINE void EmuMD::T_execLine(void)
 	// These values are the "last cycle to execute".
 	// e.g. if Cycles_M68K is 5000, then we'll execute instructions
 	// until the 68000's "odometer" reaches 5000.
-	M68K_Mem::Cycles_M68K += M68K_Mem::CPL_M68K;
-	M68K_Mem::Cycles_Z80 += M68K_Mem::CPL_Z80;
+	m_m68kMem->Cycles_M68K += m_m68kMem->CPL_M68K;
+	m_m68kMem->Cycles_Z80 += m_m68kMem->CPL_Z80;
 
-	if (m_vdp->DMAT_Length)
-		M68K::AddCycles(m_vdp->updateDMA());
+	if (m_vdp->DMAT_Length) {
+		PROFILER_BEGIN(m_profiler, PROF_VDP_DMA);
+		m_m68k->addCycles(m_vdp->updateDMA());
+		PROFILER_END(m_profiler, PROF_VDP_DMA);
+	}
 
 	switch (LineType) {
 		case LINETYPE_ACTIVEDISPLAY:
 			// In visible area.
 			m_vdp->setStatusBit(VdpStatus::VDP_STATUS_HBLANK, true);	// HBlank = 1
-			M68K::Exec(M68K_Mem::Cycles_M68K - 404);
+			PROFILER_BEGIN(m_profiler, PROF_M68K);
+			m_m68k->exec(m_m68kMem->Cycles_M68K - 404);
+			PROFILER_END(m_profiler, PROF_M68K);
 			m_vdp->setStatusBit(VdpStatus::VDP_STATUS_HBLANK, false);	// HBlank = 0
 
 			// Decrement the HInt counter.
@@ -384,8 +400,12 @@ FORCE_INLINE void EmuMD::T_execLine(void)
 			if (m_vdp->VDP_Lines.NTSC_V30.VBlank_Div != 0)
 				m_vdp->setStatusBit(VdpStatus::VDP_STATUS_VBLANK, false);
 
-			M68K::Exec(M68K_Mem::Cycles_M68K - 360);
+			PROFILER_BEGIN(m_profiler, PROF_M68K);
+			m_m68k->exec(m_m68kMem->Cycles_M68K - 360);
+			PROFILER_END(m_profiler, PROF_M68K);
+			PROFILER_BEGIN(m_profiler, PROF_Z80);
 			m_z80->exec(168);
+			PROFILER_END(m_profiler, PROF_Z80);
 #if 0
 			// TODO: Congratulations! (LibGens)
 			CONGRATULATIONS_POSTCHECK();
@@ -412,11 +432,19 @@ FORCE_INLINE void EmuMD::T_execLine(void)
 
 	if (VDP) {
 		// VDP needs to be updated.
+		PROFILER_BEGIN(m_profiler, PROF_VDP_RENDER);
 		m_vdp->renderLine();
+		PROFILER_END(m_profiler, PROF_VDP_RENDER);
 	}
 
-	M68K::Exec(M68K_Mem::Cycles_M68K);
+	PROFILER_BEGIN(m_profiler, PROF_M68K);
+	m_m68k->exec(m_m68kMem->Cycles_M68K);
+	PROFILER_END(m_profiler, PROF_M68K);
+	PROFILER_BEGIN(m_profiler, PROF_Z80);
 	m_z80->exec(0);
+	PROFILER_END(m_profiler, PROF_Z80);
+
+	PROFILER_END_LINE(m_profiler);
 }
 
 /**
@@ -426,6 +454,8 @@ FORCE_INLINE void EmuMD::T_execLine(void)
 template<bool VDP>
 FORCE_INLINE void EmuMD::T_execFrame(void)
 {
+	PROFILER_BEGIN_FRAME(m_profiler);
+
 	// Initialize Vdp::VDP_Lines.
 	// Reset the current VDP line variables for the new frame.
 	m_vdp->updateVdpLines(true);
@@ -437,13 +467,13 @@ FORCE_INLINE void EmuMD::T_execFrame(void)
 	//m_ioManager->update();
 
 	// Reset the sound chip buffer pointers and write length.
-	SoundMgr::ResetPtrsAndLens();
+	m_soundMgr->resetPtrsAndLens();
 
 	// Clear all of the cycle counters.
-	M68K_Mem::Cycles_M68K = 0;
-	M68K_Mem::Cycles_Z80 = 0;
-	M68K_Mem::Last_BUS_REQ_Cnt = -1000;
-	M68K::TripOdometer();
+	m_m68kMem->Cycles_M68K = 0;
+	m_m68kMem->Cycles_Z80 = 0;
+	m_m68kMem->Last_BUS_REQ_Cnt = -1000;
+	m_m68k->tripOdometer();
 	m_z80->clearOdometer();
 
 	// TODO: MDP. (LibGens)
@@ -487,16 +517,13 @@ FORCE_INLINE void EmuMD::T_execFrame(void)
 	} while (m_vdp->VDP_Lines.currentLine < m_vdp->VDP_Lines.totalDisplayLines);
 
 	// Update the PSG and YM2612 output.
-	SoundMgr::SpecialUpdate();
+	PROFILER_BEGIN(m_profiler, PROF_SOUND_UPDATE);
+	m_soundMgr->specialUpdate();
+	PROFILER_END(m_profiler, PROF_SOUND_UPDATE);
 
-#if 0
-	// If WAV or GYM is being dumped, update the WAV or GYM.
-	// TODO: VGM dumping
-	if (WAV_Dumping)
-		wav_dump_update();
-	if (GYM_Dumping)
-		gym_dump_update(0, 0, 0);
-#endif
+	// End the frame in the sound capture.
+	// (Audio output is captured when the frontend reads it.)
+	m_soundMgr->captureEndFrame(m_vdp->VDP_Lines.totalDisplayLines);
 
 	// TODO: MDP. (LibGens)
 #if 0
@@ -518,6 +545,8 @@ FORCE_INLINE void EmuMD::T_execFrame(void)
 
 	EventMgr::RaiseEvent(MDP_EVENT_POST_FRAME, &post_frame);
 #endif
+
+	PROFILER_END_FRAME(m_profiler);
 }
 
 void EmuMD::execFrame(void)
@@ -39,6 +39,7 @@
 
 // ZOMG save structs.
 #include "libzomg/Zomg.hpp"
+#include "libzomg/ZomgMem.hpp"
 #include "libzomg/Metadata.hpp"
 #include "libzomg/zomg_vdp.h"
 #include "libzomg/zomg_psg.h"
@@ -104,99 +105,8 @@ int EmuMD::zomgLoad(const char *filename)
 	if (!zomg.isOpen())
 		return -EIO;
 
-	// TODO: Check error codes from the ZOMG functions.
-	// TODO: Load everything first, *then* copy it to LibGens.
-
-	/** VDP **/
-	m_vdp->zomgRestoreMD(&zomg);
-
-	/** Audio **/
-
-	// Load the PSG state.
-	Zomg_PsgSave_t psg_save;
-	zomg.loadPsgReg(&psg_save);
-	SoundMgr::ms_Psg.zomgRestore(&psg_save);
-
-	/** Audio: MD-specific **/
-
-	// Load the YM2612 register state.
-	Zomg_Ym2612Save_t ym2612_save;
-	zomg.loadMD_YM2612_reg(&ym2612_save);
-	SoundMgr::ms_Ym2612.zomgRestore(&ym2612_save);
-
-	/** Z80 **/
-
-	// Load the Z80 memory.
-	// TODO: Use the correct size based on system.
-	zomg.loadZ80Mem(m_z80->m_ramZ80, 8192);
-
-	// Load the Z80 registers.
-	Zomg_Z80RegSave_t z80_reg_save;
-	zomg.loadZ80Reg(&z80_reg_save);
-	m_z80->zomgRestoreReg(&z80_reg_save);
-
-	/** MD: M68K **/
-
-	// Load the M68K memory.
-	zomg.loadM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
-
-	// Load the M68K registers.
-	Zomg_M68KRegSave_t m68k_reg_save;
-	zomg.loadM68KReg(&m68k_reg_save);
-	M68K::ZomgRestoreReg(&m68k_reg_save);
-
-	/** MD: Other **/
-
-	// Load the I/O registers. ($A10001-$A1001F, odd bytes)
-	// TODO: Create/use the version register function in M68K_Mem.cpp.
-	Zomg_MD_IoSave_t md_io_save;
-	zomg.loadMD_IO(&md_io_save);
-	m_ioManager->zomgRestoreMD(&md_io_save);
-
-	// TODO: Set MD version register.
-	//md_io.version_reg = ((M68K_Mem::ms_Region.region() << 6) | 0x20);
-	//md_io_save.version_reg = readVersionRegister_MD();
-
-	// Load the Z80 control registers.
-	Zomg_MD_Z80CtrlSave_t md_z80_ctrl_save;
-	zomg.loadMD_Z80Ctrl(&md_z80_ctrl_save);
-
-	M68K_Mem::Z80_State &= Z80_STATE_ENABLED;
-	if (!md_z80_ctrl_save.busreq)
-		M68K_Mem::Z80_State |= Z80_STATE_BUSREQ;
-	if (!md_z80_ctrl_save.reset)
-		M68K_Mem::Z80_State |= Z80_STATE_RESET;
-	m_z80->m_bankZ80 = ((md_z80_ctrl_save.m68k_bank & 0x1FF) << 15);
-
-	// Load the cartridge data.
-	// This includes:
-	// - MD /TIME registers. (SRAM control, etc.)
-	// - SRAM data.
-	// - EEPROM control and data.
 	// TODO: Make the 'loadSaveData' parameter user-configurable.
-	M68K_Mem::ms_RomCartridge->zomgRestore(&zomg, false);
-
-	// TODO: Does this need to be loaded before
-	// M68K registers are restored?
-	if (M68K_Mem::tmss_reg.isTmssEnabled()) {
-		// TMSS is enabled.
-		// Load the MD TMSS registers.
-		Zomg_MD_TMSS_reg_t tmss;
-		int ret = zomg.loadMD_TMSS_reg(&tmss);
-		if (ret <= 0) {
-			// This savestate doesn't have the TMSS registers.
-			// Assume TMSS is set up properly.
-			M68K_Mem::tmss_reg.a14000.d = 0x53454741; // 'SEGA'
-			M68K_Mem::tmss_reg.n_cart_ce = 1;
-		} else {
-			// Loaded the TMSS registers.
-			// TODO: Wordswapping.
-			M68K_Mem::tmss_reg.a14000.d = tmss.a14000;
-			M68K_Mem::tmss_reg.n_cart_ce = (tmss.n_cart_ce & 1);
-		}
-		// TODO: Only if cart_ce has changed?
-		M68K_Mem::UpdateTmssMapping();
-	}
+	restoreState(&zomg, false, true);
 
 	// Close the savestate.
 	zomg.close();
@@ -250,47 +160,143 @@ int EmuMD::zomgSave(const char *filename) const
 	Screenshot::toZomg(&zomg, fb, m_rom);
 	fb->unref();
 
+	// Save the system state.
+	saveState(&zomg);
+
+	// Close the savestate.
+	zomg.close();
+	
+	// Savestate saved.
+	return 0;
+}
+
+
+/**
+ * Save the current state to a memory buffer.
+ * @param buf	[out] Snapshot buffer.
+ * @param siz	[in] Size of buf.
+ * @return Snapshot size on success; negative errno on error.
+ */
+int EmuMD::snapshotSave(void *buf, size_t siz) const
+{
+	LibZomg::ZomgMem zomg(buf, siz, LibZomg::ZomgMem::ZOMG_SAVE, LibZomg::ZomgMem::SYSTEM_MD);
+	if (!zomg.isOpen())
+		return zomg.lastError();
+
+	// Save the system state.
+	saveState(&zomg);
+
+	// Save the internal state that isn't part of ZOMG.
+	m_vdp->snapshotSave(&zomg);
+	m_soundMgr->m_psg.snapshotSave(&zomg);
+	m_soundMgr->m_ym2612.snapshotSave(&zomg);
+	m_m68k->snapshotSave(&zomg);
+
+	// Check for errors, e.g. -ENOSPC.
+	int ret = zomg.lastError();
+	if (ret != 0)
+		return ret;
+
+	// Close the snapshot.
+	zomg.close();
+	return (int)zomg.size();
+}
+
+/**
+ * Load the current state from a memory buffer.
+ * @param buf	[in] Snapshot buffer.
+ * @param siz	[in] Size of buf.
+ * @return 0 on success; negative errno on error.
+ */
+int EmuMD::snapshotLoad(const void *buf, size_t siz)
+{
+	// NOTE: ZomgMem doesn't write to the buffer in ZOMG_LOAD mode.
+	LibZomg::ZomgMem zomg(const_cast<void*>(buf), siz, LibZomg::ZomgMem::ZOMG_LOAD, LibZomg::ZomgMem::SYSTEM_MD);
+	if (!zomg.isOpen())
+		return zomg.lastError();
+
+	// Restore the system state.
+	// SRAM/EEPROM data is always restored, since the
+	// snapshot is a point in the current session.
+	// The audio ICs are restored separately.
+	restoreState(&zomg, true, false);
+
+	// Restore the internal state that isn't part of ZOMG.
+	m_vdp->snapshotRestore(&zomg);
+	m_m68k->snapshotRestore(&zomg);
+
+	// Restore the audio ICs directly from their internal state.
+	// Replaying the register writes is slower, and it would be
+	// logged by sound capture. If the internal state can't be
+	// used, e.g. because the sample rate changed, replay the
+	// ZOMG registers instead.
+	if (m_soundMgr->m_psg.snapshotRestore(&zomg) != 0) {
+		Zomg_PsgSave_t psg_save;
+		zomg.loadPsgReg(&psg_save);
+		m_soundMgr->m_psg.zomgRestore(&psg_save);
+	}
+	if (m_soundMgr->m_ym2612.snapshotRestore(&zomg) != 0) {
+		Zomg_Ym2612Save_t ym2612_save;
+		zomg.loadMD_YM2612_reg(&ym2612_save);
+		m_soundMgr->m_ym2612.zomgRestore(&ym2612_save);
+	}
+
+	// Discard audio that was rendered after the snapshot was taken.
+	m_soundMgr->clearSegment();
+
+	// Close the snapshot.
+	zomg.close();
+	return 0;
+}
+
+/**
+ * Save the system state to a savestate.
+ * Used by both zomgSave() and snapshotSave().
+ * @param zomg Savestate.
+ */
+void EmuMD::saveState(LibZomg::ZomgBase *zomg) const
+{
 	// TODO: This is MD only!
 	// TODO: Check error codes from the ZOMG functions.
 	// TODO: Load everything first, *then* copy it to LibGens.
 	
 	/** VDP **/
-	m_vdp->zomgSaveMD(&zomg);
+	m_vdp->zomgSaveMD(zomg);
 	
 	/** Audio **/
 	
 	// Save the PSG state.
 	Zomg_PsgSave_t psg_save;
-	SoundMgr::ms_Psg.zomgSave(&psg_save);
-	zomg.savePsgReg(&psg_save);
+	m_soundMgr->m_psg.zomgSave(&psg_save);
+	zomg->savePsgReg(&psg_save);
 	
 	/** Audio: MD-specific **/
 	
 	// Save the YM2612 register state.
 	Zomg_Ym2612Save_t ym2612_save;
-	SoundMgr::ms_Ym2612.zomgSave(&ym2612_save);
-	zomg.saveMD_YM2612_reg(&ym2612_save);
+	m_soundMgr->m_ym2612.zomgSave(&ym2612_save);
+	zomg->saveMD_YM2612_reg(&ym2612_save);
 	
 	/** Z80 **/
 	
 	// Save the Z80 memory.
 	// TODO: Use the correct size based on system.
-	zomg.saveZ80Mem(m_z80->m_ramZ80, 8192);
+	zomg->saveZ80Mem(m_z80->m_ramZ80, 8192);
 	
 	// Save the Z80 registers.
 	Zomg_Z80RegSave_t z80_reg_save;
 	m_z80->zomgSaveReg(&z80_reg_save);
-	zomg.saveZ80Reg(&z80_reg_save);
+	zomg->saveZ80Reg(&z80_reg_save);
 	
 	/** MD: M68K **/
 	
 	// Save the M68K memory.
-	zomg.saveM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
+	zomg->saveM68KMem(m_m68kMem->Ram_68k.u16, sizeof(m_m68kMem->Ram_68k.u16), ZOMG_BYTEORDER_16H);
 	
 	// Save the M68K registers.
 	Zomg_M68KRegSave_t m68k_reg_save;
-	M68K::ZomgSaveReg(&m68k_reg_save);
-	zomg.saveM68KReg(&m68k_reg_save);
+	m_m68k->zomgSaveReg(&m68k_reg_save);
+	zomg->saveM68KReg(&m68k_reg_save);
 	
 	/** MD: Other **/
 	
@@ -299,40 +305,139 @@ int EmuMD::zomgSave(const char *filename) const
 	Zomg_MD_IoSave_t md_io_save;
 	m_ioManager->zomgSaveMD(&md_io_save);
 	md_io_save.version_reg = readVersionRegister_MD();
-	zomg.saveMD_IO(&md_io_save);
+	zomg->saveMD_IO(&md_io_save);
 
 	// Save the Z80 control registers.
 	Zomg_MD_Z80CtrlSave_t md_z80_ctrl_save;
-	md_z80_ctrl_save.busreq    = !(M68K_Mem::Z80_State & Z80_STATE_BUSREQ);
-	md_z80_ctrl_save.reset     = !(M68K_Mem::Z80_State & Z80_STATE_RESET);
+	md_z80_ctrl_save.busreq    = !(m_m68kMem->Z80_State & Z80_STATE_BUSREQ);
+	md_z80_ctrl_save.reset     = !(m_m68kMem->Z80_State & Z80_STATE_RESET);
 	md_z80_ctrl_save.m68k_bank = ((m_z80->m_bankZ80 >> 15) & 0x1FF);
-	zomg.saveMD_Z80Ctrl(&md_z80_ctrl_save);
+	zomg->saveMD_Z80Ctrl(&md_z80_ctrl_save);
 	
 	// Save the cartridge data.
 	// This includes:
 	// - MD /TIME registers. (SRAM control, etc.)
 	// - SRAM data.
 	// - EEPROM control and data.
-	M68K_Mem::ms_RomCartridge->zomgSave(&zomg);
+	m_m68kMem->m_romCartridge->zomgSave(zomg);
 
-	if (M68K_Mem::tmss_reg.isTmssEnabled()) {
+	if (m_m68kMem->tmss_reg.isTmssEnabled()) {
 		// TMSS is enabled.
 		// Save the MD TMSS registers.
 		Zomg_MD_TMSS_reg_t tmss;
 		// TODO: Wordswapping.
 		tmss.header = ZOMG_MD_TMSS_REG_HEADER;
-		tmss.a14000 = M68K_Mem::tmss_reg.a14000.d;
-		tmss.n_cart_ce = M68K_Mem::tmss_reg.n_cart_ce & 1;
-		zomg.saveMD_TMSS_reg(&tmss);
+		tmss.a14000 = m_m68kMem->tmss_reg.a14000.d;
+		tmss.n_cart_ce = m_m68kMem->tmss_reg.n_cart_ce & 1;
+		zomg->saveMD_TMSS_reg(&tmss);
 	} else {
 		// TODO: Delete MD/TMSS_reg.bin from the savestate?
 	}
+}
 
-	// Close the savestate.
-	zomg.close();
-	
-	// Savestate saved.
-	return 0;
+/**
+ * Restore the system state from a savestate.
+ * Used by both zomgLoad() and snapshotLoad().
+ * @param zomg Savestate.
+ * @param loadSaveData If true, load SRAM/EEPROM data.
+ * @param restoreAudio If true, restore the audio ICs from the ZOMG registers.
+ */
+void EmuMD::restoreState(LibZomg::ZomgBase *zomg, bool loadSaveData, bool restoreAudio)
+{
+	// TODO: Check error codes from the ZOMG functions.
+	// TODO: Load everything first, *then* copy it to LibGens.
+
+	/** VDP **/
+	m_vdp->zomgRestoreMD(zomg);
+
+	/** Audio **/
+
+	if (restoreAudio) {
+		// Load the PSG state.
+		Zomg_PsgSave_t psg_save;
+		zomg->loadPsgReg(&psg_save);
+		m_soundMgr->m_psg.zomgRestore(&psg_save);
+
+		/** Audio: MD-specific **/
+
+		// Load the YM2612 register state.
+		Zomg_Ym2612Save_t ym2612_save;
+		zomg->loadMD_YM2612_reg(&ym2612_save);
+		m_soundMgr->m_ym2612.zomgRestore(&ym2612_save);
+	}
+
+	/** Z80 **/
+
+	// Load the Z80 memory.
+	// TODO: Use the correct size based on system.
+	zomg->loadZ80Mem(m_z80->m_ramZ80, 8192);
+
+	// Load the Z80 registers.
+	Zomg_Z80RegSave_t z80_reg_save;
+	zomg->loadZ80Reg(&z80_reg_save);
+	m_z80->zomgRestoreReg(&z80_reg_save);
+
+	/** MD: M68K **/
+
+	// Load the M68K memory.
+	zomg->loadM68KMem(m_m68kMem->Ram_68k.u16, sizeof(m_m68kMem->Ram_68k.u16), ZOMG_BYTEORDER_16H);
+
+	// Load the M68K registers.
+	Zomg_M68KRegSave_t m68k_reg_save;
+	zomg->loadM68KReg(&m68k_reg_save);
+	m_m68k->zomgRestoreReg(&m68k_reg_save);
+
+	/** MD: Other **/
+
+	// Load the I/O registers. ($A10001-$A1001F, odd bytes)
+	// TODO: Create/use the version register function in M68K_Mem.cpp.
+	Zomg_MD_IoSave_t md_io_save;
+	zomg->loadMD_IO(&md_io_save);
+	m_ioManager->zomgRestoreMD(&md_io_save);
+
+	// TODO: Set MD version register.
+	//md_io.version_reg = ((M68K_Mem::ms_Region.region() << 6) | 0x20);
+	//md_io_save.version_reg = readVersionRegister_MD();
+
+	// Load the Z80 control registers.
+	Zomg_MD_Z80CtrlSave_t md_z80_ctrl_save;
+	zomg->loadMD_Z80Ctrl(&md_z80_ctrl_save);
+
+	m_m68kMem->Z80_State &= Z80_STATE_ENABLED;
+	if (!md_z80_ctrl_save.busreq)
+		m_m68kMem->Z80_State |= Z80_STATE_BUSREQ;
+	if (!md_z80_ctrl_save.reset)
+		m_m68kMem->Z80_State |= Z80_STATE_RESET;
+	m_z80->m_bankZ80 = ((md_z80_ctrl_save.m68k_bank & 0x1FF) << 15);
+
+	// Load the cartridge data.
+	// This includes:
+	// - MD /TIME registers. (SRAM control, etc.)
+	// - SRAM data.
+	// - EEPROM control and data.
+	m_m68kMem->m_romCartridge->zomgRestore(zomg, loadSaveData);
+
+	// TODO: Does this need to be loaded before
+	// M68K registers are restored?
+	if (m_m68kMem->tmss_reg.isTmssEnabled()) {
+		// TMSS is enabled.
+		// Load the MD TMSS registers.
+		Zomg_MD_TMSS_reg_t tmss;
+		int ret = zomg->loadMD_TMSS_reg(&tmss);
+		if (ret <= 0) {
+			// This savestate doesn't have the TMSS registers.
+			// Assume TMSS is set up properly.
+			m_m68kMem->tmss_reg.a14000.d = 0x53454741; // 'SEGA'
+			m_m68kMem->tmss_reg.n_cart_ce = 1;
+		} else {
+			// Loaded the TMSS registers.
+			// TODO: Wordswapping.
+			m_m68kMem->tmss_reg.a14000.d = tmss.a14000;
+			m_m68kMem->tmss_reg.n_cart_ce = (tmss.n_cart_ce & 1);
+		}
+		// TODO: Only if cart_ce has changed?
+		m_m68kMem->updateTmssMapping();
+	}
 }
 
 }
@@ -63,6 +63,10 @@ namespace LibGens {
 EmuPico::EmuPico(Rom *rom, SysVersion::RegionCode_t region )
 	: EmuContext(rom, region)
 {
+	// Create the M68K and its memory map.
+	m_m68k = new M68K(this);
+	m_m68kMem = new M68K_Mem(this);
+
 	// Load the ROM image.
 	m_rom = rom;	// NOTE: This is already done in EmuContext::EmuContext()...
 	if (!m_rom) {
@@ -80,23 +84,23 @@ EmuPico::EmuPico(Rom *rom, SysVersion::RegionCode_t region )
 	}
 
 	// Load the ROM into memory.
-	M68K_Mem::ms_RomCartridge = new RomCartridgeMD(rom);
-	M68K_Mem::ms_RomCartridge->loadRom();
-	if (!M68K_Mem::ms_RomCartridge->isRomLoaded()) {
+	m_m68kMem->m_romCartridge = new RomCartridgeMD(rom, this);
+	m_m68kMem->m_romCartridge->loadRom();
+	if (!m_m68kMem->m_romCartridge->isRomLoaded()) {
 		// Error loading the ROM.
 		// TODO: Set an error code.
-		delete M68K_Mem::ms_RomCartridge;
-		M68K_Mem::ms_RomCartridge = nullptr;
+		delete m_m68kMem->m_romCartridge;
+		m_m68kMem->m_romCartridge = nullptr;
 		m_rom = nullptr;
 		return;
 	}
 
 	// Autofix the ROM checksum, if enabled.
 	if (AutoFixChecksum())
-		M68K_Mem::ms_RomCartridge->fixChecksum();
+		m_m68kMem->m_romCartridge->fixChecksum();
 
 	// Initialize the M68K.
-	M68K::InitSys(M68K::SYSID_PICO);
+	m_m68k->initSys(M68K::SYSID_PICO);
 
 	// Initialize the system status.
 	// TODO: Move Vdp::SysStatus to EmuContext.
@@ -104,7 +108,7 @@ EmuPico::EmuPico(Rom *rom, SysVersion::RegionCode_t region )
 	m_vdp->SysStatus.Genesis = 1;
 
 	// Pico doesn't use MD-style TMSS.
-	M68K_Mem::tmss_reg.clearTmssRom();
+	m_m68kMem->tmss_reg.clearTmssRom();
 
 	// Reset the controllers.
 	m_ioManager->reset();
@@ -121,11 +125,11 @@ EmuPico::EmuPico(Rom *rom, SysVersion::RegionCode_t region )
 EmuPico::~EmuPico()
 {
 	// TODO: Other stuff?
-	M68K::EndSys();
+	m_m68k->endSys();
 
 	// Delete the RomCartridgeMD.
-	delete M68K_Mem::ms_RomCartridge;
-	M68K_Mem::ms_RomCartridge = nullptr;
+	delete m_m68kMem->m_romCartridge;
+	m_m68kMem->m_romCartridge = nullptr;
 }
 
 /**
@@ -138,12 +142,12 @@ int EmuPico::softReset(void)
 	// - If autofix is enabled, fix the checksum.
 	// - If autofix is disabled, restore the checksum.
 	if (AutoFixChecksum())
-		M68K_Mem::ms_RomCartridge->fixChecksum();
+		m_m68kMem->m_romCartridge->fixChecksum();
 	else
-		M68K_Mem::ms_RomCartridge->restoreChecksum();
+		m_m68kMem->m_romCartridge->restoreChecksum();
 
 	// Reset the M68K.
-	M68K::Reset();
+	m_m68k->reset();
 
 	// TODO: Genesis Plus randomizes the restart line.
 	// See genesis.c:176.
@@ -163,14 +167,14 @@ int EmuPico::hardReset(void)
 	// - If autofix is enabled, fix the checksum.
 	// - If autofix is disabled, restore the checksum.
 	if (AutoFixChecksum())
-		M68K_Mem::ms_RomCartridge->fixChecksum();
+		m_m68kMem->m_romCartridge->fixChecksum();
 	else
-		M68K_Mem::ms_RomCartridge->restoreChecksum();
+		m_m68kMem->m_romCartridge->restoreChecksum();
 
 	// Hard-Reset the M68K, Z80, VDP, PSG, and YM2612.
 	// This includes clearing RAM.
-	M68K::InitSys(M68K::SYSID_PICO);
-	SoundMgr::ms_Psg.reset();
+	m_m68k->initSys(M68K::SYSID_PICO);
+	m_soundMgr->m_psg.reset();
 
 	// Reset the VDP.
 	m_vdp->reset();
@@ -236,18 +240,18 @@ int EmuPico::setRegion_int(SysVersion::RegionCode_t region, bool preserveState)
 	 * [Round_Double() rounds 0.5 to 0 and 1.5 to 1.] */
 	// TODO: Jorge says CPL is always 3420 master clock cycles...
 	if (m_sysVersion.isPal()) {
-		M68K_Mem::CPL_M68K = Round_Double((((double)CLOCK_PAL / 7.0) / 50.0) / 312.0);
+		m_m68kMem->CPL_M68K = Round_Double((((double)CLOCK_PAL / 7.0) / 50.0) / 312.0);
 	} else {
-		M68K_Mem::CPL_M68K = Round_Double((((double)CLOCK_NTSC / 7.0) / 60.0) / 262.0);
+		m_m68kMem->CPL_M68K = Round_Double((((double)CLOCK_NTSC / 7.0) / 60.0) / 262.0);
 	}
 
 	// No Z80 here...
-	M68K_Mem::CPL_Z80 = 0;
+	m_m68kMem->CPL_Z80 = 0;
 
 	// Initialize audio.
 	// NOTE: Only set the region. Sound rate is set by the UI.
 	// TODO: Don't initialize YM2612?
-	SoundMgr::SetRegion(m_sysVersion.isPal(), preserveState);
+	m_soundMgr->setRegion(m_sysVersion.isPal(), preserveState);
 
 	// Region set successfully.
 	return 0;
@@ -260,8 +264,8 @@ int EmuPico::setRegion_int(SysVersion::RegionCode_t region, bool preserveState)
 int EmuPico::saveData(void)
 {
 	// TODO: Call lg_osd here instead of in RomCartridgeMD().
-	if (M68K_Mem::ms_RomCartridge)
-		return M68K_Mem::ms_RomCartridge->saveData();
+	if (m_m68kMem->m_romCartridge)
+		return m_m68kMem->m_romCartridge->saveData();
 
 	// Nothing was saved.
 	return 0;
@@ -275,8 +279,8 @@ int EmuPico::saveData(void)
 int EmuPico::autoSaveData(int framesElapsed)
 {
 	// TODO: Call lg_osd here instead of in RomCartridgeMD().
-	if (M68K_Mem::ms_RomCartridge)
-		return M68K_Mem::ms_RomCartridge->autoSaveData(framesElapsed);
+	if (m_m68kMem->m_romCartridge)
+		return m_m68kMem->m_romCartridge->autoSaveData(framesElapsed);
 
 	// Nothing was saved.
 	return 0;
@@ -291,8 +295,8 @@ template<EmuPico::LineType_t LineType, bool VDP>
 FORCE_INLINE void EmuPico::T_execLine(void)
 {
 	// Update the sound chips.
-	int writeLen = SoundMgr::GetWriteLen(m_vdp->VDP_Lines.currentLine);
-	SoundMgr::ms_Psg.addWriteLen(writeLen);
+	int writeLen = m_soundMgr->getWriteLen(m_vdp->VDP_Lines.currentLine);
+	m_soundMgr->m_psg.addWriteLen(writeLen);
 
 	// Notify controllers that a new scanline is being drawn.
 	m_ioManager->doScanline();
@@ -301,16 +305,16 @@ FORCE_INLINE void EmuPico::T_execLine(void)
 	// These values are the "last cycle to execute".
 	// e.g. if Cycles_M68K is 5000, then we'll execute instructions
 	// until the 68000's "odometer" reaches 5000.
-	M68K_Mem::Cycles_M68K += M68K_Mem::CPL_M68K;
+	m_m68kMem->Cycles_M68K += m_m68kMem->CPL_M68K;
 
 	if (m_vdp->DMAT_Length)
-		M68K::AddCycles(m_vdp->updateDMA());
+		m_m68k->addCycles(m_vdp->updateDMA());
 
 	switch (LineType) {
 		case LINETYPE_ACTIVEDISPLAY:
 			// In visible area.
 			m_vdp->setStatusBit(VdpStatus::VDP_STATUS_HBLANK, true);	// HBlank = 1
-			M68K::Exec(M68K_Mem::Cycles_M68K - 404);
+			m_m68k->exec(m_m68kMem->Cycles_M68K - 404);
 			m_vdp->setStatusBit(VdpStatus::VDP_STATUS_HBLANK, false);	// HBlank = 0
 
 			// Decrement the HInt counter.
@@ -338,7 +342,7 @@ FORCE_INLINE void EmuPico::T_execLine(void)
 			if (m_vdp->VDP_Lines.NTSC_V30.VBlank_Div != 0)
 				m_vdp->setStatusBit(VdpStatus::VDP_STATUS_VBLANK, false);
 
-			M68K::Exec(M68K_Mem::Cycles_M68K - 360);
+			m_m68k->exec(m_m68kMem->Cycles_M68K - 360);
 #if 0
 			// TODO: Congratulations! (LibGens)
 			CONGRATULATIONS_POSTCHECK();
@@ -363,7 +367,7 @@ FORCE_INLINE void EmuPico::T_execLine(void)
 		m_vdp->renderLine();
 	}
 
-	M68K::Exec(M68K_Mem::Cycles_M68K);
+	m_m68k->exec(m_m68kMem->Cycles_M68K);
 }
 
 /**
@@ -384,13 +388,13 @@ FORCE_INLINE void EmuPico::T_execFrame(void)
 	//m_ioManager->update();
 
 	// Reset the sound chip buffer pointers and write length.
-	SoundMgr::ResetPtrsAndLens();
+	m_soundMgr->resetPtrsAndLens();
 
 	// Clear all of the cycle counters.
-	M68K_Mem::Cycles_M68K = 0;
-	M68K_Mem::Cycles_Z80 = 0;
-	M68K_Mem::Last_BUS_REQ_Cnt = -1000;
-	M68K::TripOdometer();
+	m_m68kMem->Cycles_M68K = 0;
+	m_m68kMem->Cycles_Z80 = 0;
+	m_m68kMem->Last_BUS_REQ_Cnt = -1000;
+	m_m68k->tripOdometer();
 
 	// TODO: MDP . (LibGens)
 #if 0
@@ -429,16 +433,11 @@ FORCE_INLINE void EmuPico::T_execFrame(void)
 	} while (m_vdp->VDP_Lines.currentLine < m_vdp->VDP_Lines.totalDisplayLines);
 
 	// Update the PSG and YM2612 output.
-	SoundMgr::SpecialUpdate();
+	m_soundMgr->specialUpdate();
 
-#if 0
-	// If WAV or GYM is being dumped, update the WAV or GYM.
-	// TODO: VGM dumping
-	if (WAV_Dumping)
-		wav_dump_update();
-	if (GYM_Dumping)
-		gym_dump_update(0, 0, 0);
-#endif
+	// End the frame in the sound capture.
+	// (Audio output is captured when the frontend reads it.)
+	m_soundMgr->captureEndFrame(m_vdp->VDP_Lines.totalDisplayLines);
 
 	// TODO: MDP . (LibGens)
 #if 0
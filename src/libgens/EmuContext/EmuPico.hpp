@@ -29,6 +29,10 @@
 // Needed for FORCE_INLINE.
 #include "../macros/common.h"
 
+namespace LibZomg {
+	class ZomgBase;
+}
+
 namespace LibGens {
 
 class EmuPico : public EmuContext
@@ -96,6 +100,22 @@ class EmuPico : public EmuContext
 		 */
 		virtual int zomgSave(const char *filename) const final;
 
+		/**
+		 * Save the current state to a memory buffer.
+		 * @param buf	[out] Snapshot buffer. (may be nullptr)
+		 * @param siz	[in] Size of buf.
+		 * @return Snapshot size on success; negative errno on error.
+		 */
+		virtual int snapshotSave(void *buf, size_t siz) const final;
+
+		/**
+		 * Load the current state from a memory buffer.
+		 * @param buf	[in] Snapshot buffer.
+		 * @param siz	[in] Size of buf.
+		 * @return 0 on success; negative errno on error.
+		 */
+		virtual int snapshotLoad(const void *buf, size_t siz) final;
+
 	protected:
 		/**
 		 * Line types.
@@ -119,6 +139,22 @@ class EmuPico : public EmuContext
 		 * @return 0 on success; non-zero on error.
 		 */
 		int setRegion_int(SysVersion::RegionCode_t region, bool preserveState);
+
+		/**
+		 * Save the system state to a savestate.
+		 * Used by both zomgSave() and snapshotSave().
+		 * @param zomg Savestate.
+		 */
+		void saveState(LibZomg::ZomgBase *zomg) const;
+
+		/**
+		 * Restore the system state from a savestate.
+		 * Used by both zomgLoad() and snapshotLoad().
+		 * @param zomg Savestate.
+		 * @param loadSaveData If true, load SRAM/EEPROM data.
+		 * @param restoreAudio If true, restore the audio ICs from the ZOMG registers.
+		 */
+		void restoreState(LibZomg::ZomgBase *zomg, bool loadSaveData, bool restoreAudio);
 };
 
 }
@@ -38,6 +38,7 @@
 
 // ZOMG save structs.
 #include "libzomg/Zomg.hpp"
+#include "libzomg/ZomgMem.hpp"
 #include "libzomg/Metadata.hpp"
 #include "libzomg/zomg_vdp.h"
 #include "libzomg/zomg_psg.h"
@@ -98,41 +99,8 @@ int EmuPico::zomgLoad(const char *filename)
 	if (!zomg.isOpen())
 		return -EIO;
 
-	// TODO: Check error codes from the ZOMG functions.
-	// TODO: Load everything first, *then* copy it to LibGens.
-
-	/** VDP **/
-	m_vdp->zomgRestoreMD(&zomg);
-
-	/** Audio **/
-
-	// Load the PSG state.
-	Zomg_PsgSave_t psg_save;
-	zomg.loadPsgReg(&psg_save);
-	SoundMgr::ms_Psg.zomgRestore(&psg_save);
-
-	/** MD: M68K **/
-
-	// Load the M68K memory.
-	zomg.loadM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
-
-	// Load the M68K registers.
-	Zomg_M68KRegSave_t m68k_reg_save;
-	zomg.loadM68KReg(&m68k_reg_save);
-	M68K::ZomgRestoreReg(&m68k_reg_save);
-
-	/* TODO: Pico-specific registers. ($800000) */
-
-	// Load the cartridge data.
-	// This includes:
-	// - MD /TIME registers. (SRAM control, etc.)
-	// - SRAM data.
-	// - EEPROM control and data.
 	// TODO: Make the 'loadSaveData' parameter user-configurable.
-	M68K_Mem::ms_RomCartridge->zomgRestore(&zomg, false);
-
-	// TODO: Load TMSS.
-	// Pico TMSS only has one register, the 'SEGA' register.
+	restoreState(&zomg, false, true);
 
 	// Close the savestate.
 	zomg.close();
@@ -187,28 +155,117 @@ int EmuPico::zomgSave(const char *filename) const
 	Screenshot::toZomg(&zomg, fb, m_rom);
 	fb->unref();
 
+	// Save the system state.
+	saveState(&zomg);
+
+	// Close the savestate.
+	zomg.close();
+	
+	// Savestate saved.
+	return 0;
+}
+
+/**
+ * Save the current state to a memory buffer.
+ * @param buf	[out] Snapshot buffer. (may be nullptr)
+ * @param siz	[in] Size of buf.
+ * @return Snapshot size on success; negative errno on error.
+ */
+int EmuPico::snapshotSave(void *buf, size_t siz) const
+{
+	LibZomg::ZomgMem zomg(buf, siz, LibZomg::ZomgMem::ZOMG_SAVE, LibZomg::ZomgMem::SYSTEM_PICO);
+	if (!zomg.isOpen())
+		return zomg.lastError();
+
+	// Save the system state.
+	saveState(&zomg);
+
+	// Save the internal state that isn't part of ZOMG.
+	m_vdp->snapshotSave(&zomg);
+	m_soundMgr->m_psg.snapshotSave(&zomg);
+	m_m68k->snapshotSave(&zomg);
+
+	// Check for errors, e.g. -ENOSPC.
+	int ret = zomg.lastError();
+	if (ret != 0)
+		return ret;
+
+	// Close the snapshot.
+	zomg.close();
+	return (int)zomg.size();
+}
+
+/**
+ * Load the current state from a memory buffer.
+ * @param buf	[in] Snapshot buffer.
+ * @param siz	[in] Size of buf.
+ * @return 0 on success; negative errno on error.
+ */
+int EmuPico::snapshotLoad(const void *buf, size_t siz)
+{
+	// NOTE: ZomgMem doesn't write to the buffer in ZOMG_LOAD mode.
+	LibZomg::ZomgMem zomg(const_cast<void*>(buf), siz, LibZomg::ZomgMem::ZOMG_LOAD, LibZomg::ZomgMem::SYSTEM_PICO);
+	if (!zomg.isOpen())
+		return zomg.lastError();
+
+	// Restore the system state.
+	// SRAM/EEPROM data is always restored, since the
+	// snapshot is a point in the current session.
+	// The audio ICs are restored separately.
+	restoreState(&zomg, true, false);
+
+	// Restore the internal state that isn't part of ZOMG.
+	m_vdp->snapshotRestore(&zomg);
+	m_m68k->snapshotRestore(&zomg);
+
+	// Restore the audio ICs directly from their internal state.
+	// Replaying the register writes is slower, and it would be
+	// logged by sound capture. If the internal state can't be
+	// used, e.g. because the sample rate changed, replay the
+	// ZOMG registers instead.
+	if (m_soundMgr->m_psg.snapshotRestore(&zomg) != 0) {
+		Zomg_PsgSave_t psg_save;
+		zomg.loadPsgReg(&psg_save);
+		m_soundMgr->m_psg.zomgRestore(&psg_save);
+	}
+
+	// Discard audio that was rendered after the snapshot was taken.
+	m_soundMgr->clearSegment();
+
+	// Close the snapshot.
+	zomg.close();
+	return 0;
+}
+
+/**
+ * Save the system state to a savestate.
+ * Used by both zomgSave() and snapshotSave().
+ * @param zomg Savestate.
+ */
+void EmuPico::saveState(LibZomg::ZomgBase *zomg) const
+{
 	// TODO: Check error codes from the ZOMG functions.
 	// TODO: Load everything first, *then* copy it to LibGens.
 
 	/** VDP **/
-	m_vdp->zomgSaveMD(&zomg);
+	m_vdp->zomgSaveMD(zomg);
 
 	/** Audio **/
 
 	// Save the PSG state.
 	Zomg_PsgSave_t psg_save;
-	SoundMgr::ms_Psg.zomgSave(&psg_save);
-	zomg.savePsgReg(&psg_save);
+	m_soundMgr->m_psg.zomgSave(&psg_save);
+	zomg->savePsgReg(&psg_save);
 
 	/** MD: M68K **/
 
 	// Save the M68K memory.
-	zomg.saveM68KMem(Ram_68k.u16, sizeof(Ram_68k.u16), ZOMG_BYTEORDER_16H);
+	zomg->saveM68KMem(m_m68kMem->Ram_68k.u16, sizeof(m_m68kMem->Ram_68k.u16), ZOMG_BYTEORDER_16H);
 
 	// Save the M68K registers.
 	Zomg_M68KRegSave_t m68k_reg_save;
-	M68K::ZomgSaveReg(&m68k_reg_save);
-	zomg.saveM68KReg(&m68k_reg_save);
+	m_m68k->zomgSaveReg(&m68k_reg_save);
+	zomg->saveM68KReg(&m68k_reg_save);
 
 	/* TODO: Pico-specific registers. ($800000) */
 
@@ -217,16 +274,57 @@ int EmuPico::zomgSave(const char *filename) const
 	// - MD /TIME registers. (SRAM control, etc.)
 	// - SRAM data.
 	// - EEPROM control and data.
-	M68K_Mem::ms_RomCartridge->zomgSave(&zomg);
+	m_m68kMem->m_romCartridge->zomgSave(zomg);
 
 	// TODO: Save TMSS.
 	// Pico TMSS only has one register, the 'SEGA' register.
+}
 
-	// Close the savestate.
-	zomg.close();
-	
-	// Savestate saved.
-	return 0;
+/**
+ * Restore the system state from a savestate.
+ * Used by both zomgLoad() and snapshotLoad().
+ * @param zomg Savestate.
+ * @param loadSaveData If true, load SRAM/EEPROM data.
+ * @param restoreAudio If true, restore the audio ICs from the ZOMG registers.
+ */
+void EmuPico::restoreState(LibZomg::ZomgBase *zomg, bool loadSaveData, bool restoreAudio)
+{
+	// TODO: Check error codes from the ZOMG functions.
+	// TODO: Load everything first, *then* copy it to LibGens.
+
+	/** VDP **/
+	m_vdp->zomgRestoreMD(zomg);
+
+	/** Audio **/
+
+	if (restoreAudio) {
+		// Load the PSG state.
+		Zomg_PsgSave_t psg_save;
+		zomg->loadPsgReg(&psg_save);
+		m_soundMgr->m_psg.zomgRestore(&psg_save);
+	}
+
+	/** MD: M68K **/
+
+	// Load the M68K memory.
+	zomg->loadM68KMem(m_m68kMem->Ram_68k.u16, sizeof(m_m68kMem->Ram_68k.u16), ZOMG_BYTEORDER_16H);
+
+	// Load the M68K registers.
+	Zomg_M68KRegSave_t m68k_reg_save;
+	zomg->loadM68KReg(&m68k_reg_save);
+	m_m68k->zomgRestoreReg(&m68k_reg_save);
+
+	/* TODO: Pico-specific registers. ($800000) */
+
+	// Load the cartridge data.
+	// This includes:
+	// - MD /TIME registers. (SRAM control, etc.)
+	// - SRAM data.
+	// - EEPROM control and data.
+	m_m68kMem->m_romCartridge->zomgRestore(zomg, loadSaveData);
+
+	// TODO: Load TMSS.
+	// Pico TMSS only has one register, the 'SEGA' register.
 }
 
 }
@@ -32,6 +32,8 @@ using LibGensFile::ArchiveFactory;
 using LibGensFile::MemFake;
 
 // C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <cctype>
 #include <cstdio>
@@ -138,10 +140,34 @@ class RomPrivate
 		 */
 		void DecodeSMDBlock(uint8_t *dest, const uint8_t *src);
 
+		/**
+		 * ROM loading state for Archive::readFileStream().
+		 */
+		struct LoadStream_t {
+			RomPrivate *d;
+			uint8_t *smd_block;	// Temporary SMD block buffer. (nullptr if not SMD)
+			uLong crc;		// CRC32 of the data processed so far.
+			size_t crc_len;		// Number of bytes included in crc.
+		};
+
+		/**
+		 * Process a chunk of the ROM while it's being read.
+		 * SMD blocks are deinterleaved, and the CRC32 is updated.
+		 * @param param LoadStream_t.
+		 * @param data Chunk data. (Multiple of 16 KB, except for the last chunk.)
+		 * @param len Length of data.
+		 * @return 0 on success.
+		 */
+		static int LoadStreamFn(void *param, uint8_t *data, size_t len);
+
 		/** ROM header functions. **/
 		int loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmtOverride);
+		void parseRomHeader(uint8_t *header, size_t header_size);
 		void readHeaderMD(const uint8_t *header, size_t header_size);
 
+		// Size of the ROM header buffer used for detection.
+		static const size_t ROM_HEADER_SIZE = 65536+512;
+
 		/**
 		 * Mega Drive ROM header.
 		 * This matches the MD ROM header format exactly.
@@ -528,30 +554,37 @@ int RomPrivate::DetectRegionCodeMD(const char countryCodes[16])
 void RomPrivate::DecodeSMDBlock(uint8_t *dest, const uint8_t *src)
 {
 	// First 8 KB of the source block is ODD bytes.
-	const uint8_t *end_block = src + 8192;
-	for (uint8_t *odd = dest + 1; src < end_block; odd += 16, src += 8) {
-		*(odd +  0) = *(src + 0);
-		*(odd +  2) = *(src + 1);
-		*(odd +  4) = *(src + 2);
-		*(odd +  6) = *(src + 3);
-		*(odd +  8) = *(src + 4);
-		*(odd + 10) = *(src + 5);
-		*(odd + 12) = *(src + 6);
-		*(odd + 14) = *(src + 7);
-	}
-
 	// Second 8 KB of the source block is EVEN bytes.
-	end_block = src + 8192;
-	for (uint8_t *even = dest; src < end_block; even += 16, src += 8) {
-		*(even +  0) = *(src + 0);
-		*(even +  2) = *(src + 1);
-		*(even +  4) = *(src + 2);
-		*(even +  6) = *(src + 3);
-		*(even +  8) = *(src + 4);
-		*(even + 10) = *(src + 5);
-		*(even + 12) = *(src + 6);
-		*(even + 14) = *(src + 7);
+	__byte_interleave_16_array(dest, src + 8192, src, 8192);
+}
+
+/**
+ * Process a chunk of the ROM while it's being read.
+ * SMD blocks are deinterleaved, and the CRC32 is updated.
+ * @param param LoadStream_t.
+ * @param data Chunk data. (Multiple of 16 KB, except for the last chunk.)
+ * @param len Length of data.
+ * @return 0 on success.
+ */
+int RomPrivate::LoadStreamFn(void *param, uint8_t *data, size_t len)
+{
+	LoadStream_t *const ls = static_cast<LoadStream_t*>(param);
+
+	if (ls->smd_block) {
+		// Process 16 KB blocks.
+		// NOTE: If the ROM size isn't a multiple of 16 KB,
+		// the last block will not be decoded properly.
+		uint8_t *p = data;
+		for (size_t remain = len; remain >= 16384; remain -= 16384, p += 16384) {
+			memcpy(ls->smd_block, p, 16384);
+			ls->d->DecodeSMDBlock(p, ls->smd_block);
+		}
 	}
+
+	// Update the CRC32.
+	ls->crc = crc32(ls->crc, data, (uInt)len);
+	ls->crc_len += len;
+	return 0;
 }
 
 /**
@@ -577,7 +610,6 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 	romSize = z_entry_sel->filesize;
 
 	// Load the ROM header for detection purposes.
-	static const size_t ROM_HEADER_SIZE = 65536+512;
 	uint8_t *header = (uint8_t*)malloc(ROM_HEADER_SIZE);
 	if (!header) {
 		// Memory allocation error.
@@ -602,6 +634,21 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 		memset(&header[header_size], 0x00, (ROM_HEADER_SIZE - header_size));
 	}
 
+	// Parse the ROM header.
+	parseRomHeader(header, header_size);
+	free(header);
+	return 0;
+}
+
+/**
+ * Detect the ROM format and system ID, and read the ROM header.
+ * romSize, sysId, and romFormat must be set by the caller.
+ * If sysId or romFormat is unknown, it will be detected.
+ * @param header ROM header. (ROM_HEADER_SIZE bytes; zero-padded if the ROM is smaller.)
+ * @param header_size ROM header size. (Amount of valid data.)
+ */
+void RomPrivate::parseRomHeader(uint8_t *header, size_t header_size)
+{
 	// Detect the ROM format first.
 	if (romFormat == Rom::RFMT_UNKNOWN) {
 		romFormat = DetectFormat(header, header_size, romSize);
@@ -619,17 +666,16 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 				romSize -= 512;
 			}
 
-			// Deinterleave the ROM header.
+			// Deinterleave the ROM header in place.
 			// Note that the actual SMD data starts at byte 512.
 			static const size_t BIN_HEADER_SIZE = 65536;
-			uint8_t *smd_header = header;
-			header = (uint8_t*)malloc(BIN_HEADER_SIZE);
+			uint8_t smd_block[16384];
 			header_size = BIN_HEADER_SIZE;
 			// TODO: Use pointer arithmetic?
 			for (size_t i = 0; i < BIN_HEADER_SIZE; i += 16384) {
-				DecodeSMDBlock(&header[i], &smd_header[i + 512]);
+				DecodeSMDBlock(smd_block, &header[i + 512]);
+				memcpy(&header[i], smd_block, sizeof(smd_block));
 			}
-			free(smd_header);
 		}
 
 		case Rom::RFMT_MGD:
@@ -652,9 +698,53 @@ int RomPrivate::loadRomHeader(Rom::MDP_SYSTEM_ID sysOverride, Rom::RomFormat fmt
 
 	// Load the ROM header information.
 	readHeaderMD(header, header_size);
+}
 
-	// ROM header loaded.
-	free(header);
+/**
+ * Identify a ROM from its header.
+ * This is used as the LibraryScanner's identify function,
+ * and uses the same detection code as loading a ROM.
+ * @param header	[in]  First HEADER_SIZE bytes of the ROM. (zero-padded)
+ * @param header_size	[in]  Amount of valid data in header.
+ * @param file_size	[in]  Size of the ROM file.
+ * @param info		[out] ROM header information.
+ * @return 0 on success; non-zero on error.
+ */
+int Rom::IdentifyHeader(const uint8_t *header, size_t header_size,
+	int64_t file_size, LibGensFile::LibraryScanner::HeaderInfo *info)
+{
+	static_assert(LibGensFile::LibraryScanner::HEADER_SIZE == RomPrivate::ROM_HEADER_SIZE,
+		"LibraryScanner::HEADER_SIZE doesn't match RomPrivate::ROM_HEADER_SIZE.");
+	if (!header || !info || header_size == 0 || file_size <= 0)
+		return -EINVAL;
+	if (header_size > RomPrivate::ROM_HEADER_SIZE) {
+		header_size = RomPrivate::ROM_HEADER_SIZE;
+	}
+
+	// parseRomHeader() deinterleaves SMD headers in place,
+	// so it needs a writable copy of the header.
+	uint8_t *buf = (uint8_t*)malloc(RomPrivate::ROM_HEADER_SIZE);
+	if (!buf)
+		return -ENOMEM;
+	memcpy(buf, header, header_size);
+	if (header_size < RomPrivate::ROM_HEADER_SIZE) {
+		memset(&buf[header_size], 0x00, (RomPrivate::ROM_HEADER_SIZE - header_size));
+	}
+
+	// No file is opened if the filename is nullptr.
+	RomPrivate d(nullptr, (const char*)nullptr,
+		MDP_SYSTEM_UNKNOWN, RFMT_UNKNOWN);
+	d.romSize = (file_size > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned int)file_size);
+	d.parseRomHeader(buf, header_size);
+	free(buf);
+
+	info->sysId = d.sysId;
+	info->romFormat = d.romFormat;
+	info->regionCode = d.regionCode;
+	info->checksum = d.m_mdHeader.checksum;
+	info->romNameJP = d.romNameJP;
+	info->romNameUS = d.romNameUS;
+	info->serial = string(d.m_mdHeader.serialNumber, sizeof(d.m_mdHeader.serialNumber));
 	return 0;
 }
 
@@ -771,13 +861,23 @@ int Rom::loadRom(void *buf, size_t siz)
 	}
 
 	// Load the ROM image.
+	// If the file has to be decompressed, SMD deinterleaving
+	// and the CRC32 are pipelined with decompression.
 	// TODO: Error handling.
 	int ret = -1;
 	Archive::file_offset_t ret_siz = 0;
+	RomPrivate::LoadStream_t ls;
+	ls.d = d;
+	ls.smd_block = nullptr;
+	ls.crc = crc32(0, nullptr, 0);
+	ls.crc_len = 0;
 	switch (d->romFormat) {
 		case Rom::RFMT_BINARY:
 			// Plain binary ROM file.
- 			ret = d->archive->readFile(d->z_entry_sel, buf, siz, &ret_siz);
+			ret = d->archive->readFileStream(d->z_entry_sel, 0,
+				std::min(static_cast<Archive::file_offset_t>(d->z_entry_sel->filesize),
+					 static_cast<Archive::file_offset_t>(siz)),
+				buf, siz, 16384, RomPrivate::LoadStreamFn, &ls, &ret_siz);
 			break;
 
 		case RFMT_SMD:
@@ -787,31 +887,19 @@ int Rom::loadRom(void *buf, size_t siz)
 
 			// Read the SMD data.
 			// (Skip the 512-byte header.)
-			ret = d->archive->readFile(d->z_entry_sel, 512, d->romSize, buf, siz, &ret_siz);
+			// 16 KB blocks are decoded by LoadStreamFn()
+			// while the rest of the file is being read.
+			// FIXME: What do we do if the ROM size isn't a multiple of 16 KB?
+			// TODO: Verify that the SMD code works with the Archive skip parameter.
+			ls.smd_block = (uint8_t*)malloc(16384);
+			ret = d->archive->readFileStream(d->z_entry_sel, 512, d->romSize,
+				buf, siz, 16384, RomPrivate::LoadStreamFn, &ls, &ret_siz);
+			free(ls.smd_block);
 			if (ret != 0 || ret_siz == 0 || ret_siz > (Archive::file_offset_t)siz) {
 				// Read error.
+				ret = -1;
 				ret_siz = 0;
-				break;
-			}
-
-			// Temporary SMD block buffer.
-			uint8_t *smd_block = (uint8_t*)malloc(16384);
-
-			// Process 16 KB blocks.
-			// NOTE: If ret_siz isn't a multiple of 16 KB,
-			// the last block will not be decoded properly.
-			Archive::file_offset_t remain = ret_siz;
-			const uint8_t *buf_read = reinterpret_cast<const uint8_t*>(buf);
-			uint8_t *buf_write = reinterpret_cast<uint8_t*>(buf);
-			for (; remain >= 16384; remain -= 16384, buf_read += 16384, buf_write += 16384) {
-				memcpy(smd_block, buf_read, 16384);
-				d->DecodeSMDBlock(buf_write, smd_block);
 			}
-
-			// FIXME: What do we do if remain > 0?
-			// TODO: Verify that the SMD code works with the Archive skip parameter.
-			free(smd_block);
-			ret = 0;
 			break;
 		}
 
@@ -827,8 +915,10 @@ int Rom::loadRom(void *buf, size_t siz)
 	}
 
 	// Calculate the CRC32.
+	// If the ROM was streamed, part of the buffer has
+	// already been checksummed by LoadStreamFn().
 	// TODO: Also MD5?
-	d->rom_crc32 = crc32(0, (const Bytef*)buf, siz);
+	d->rom_crc32 = crc32(ls.crc, (const Bytef*)buf + ls.crc_len, (uInt)(siz - ls.crc_len));
 
 	// Return the number of bytes read.
 	// TODO: Change return value to Archive::file_offset_t?
@@ -33,6 +33,8 @@
 // Archive subsystem. (for mdp_z_entry_t)
 // TODO: Move to MDP headers.
 #include "libgensfile/Archive.hpp"
+// ROM library scanner. (for IdentifyHeader())
+#include "libgensfile/LibraryScanner.hpp"
 
 namespace LibGens {
 
@@ -249,6 +251,21 @@ class Rom
 		 * @return True if a ROM has been selected.
 		 */
 		bool isRomSelected(void) const;
+
+		/** ROM library scanning. **/
+
+		/**
+		 * Identify a ROM from its header.
+		 * This is used as the LibraryScanner's identify function,
+		 * and uses the same detection code as loading a ROM.
+		 * @param header	[in]  First HEADER_SIZE bytes of the ROM. (zero-padded)
+		 * @param header_size	[in]  Amount of valid data in header.
+		 * @param file_size	[in]  Size of the ROM file.
+		 * @param info		[out] ROM header information.
+		 * @return 0 on success; non-zero on error.
+		 */
+		static int IdentifyHeader(const uint8_t *header, size_t header_size,
+			int64_t file_size, LibGensFile::LibraryScanner::HeaderInfo *info);
 };
 
 }
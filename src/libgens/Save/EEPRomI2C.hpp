@@ -30,7 +30,7 @@
 
 // ZOMG
 namespace LibZomg {
-	class Zomg;
+	class ZomgBase;
 }
 
 namespace LibGens {
@@ -99,6 +99,15 @@ class EEPRomI2C
 		inline bool isWriteBytePort(uint32_t address) const;
 		inline bool isWriteWordPort(uint32_t address) const;
 
+		/**
+		 * Check if the read port is within the specified address range.
+		 * This is used to determine if a page of ROM can be mapped directly.
+		 * @param start Starting address.
+		 * @param end Ending address. (inclusive)
+		 * @return True if the read port is in the range.
+		 */
+		inline bool isReadPortInRange(uint32_t start, uint32_t end) const;
+
 		/**
 		 * Check if the EEPRom is dirty.
 		 * @return True if EEPRom has been modified since the last save; false otherwise.
@@ -138,8 +147,8 @@ class EEPRomI2C
 		int autoSave(int framesElapsed);
 
 		/** ZOMG functions. **/
-		int zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData);
-		int zomgSave(LibZomg::Zomg *zomg) const;
+		int zomgRestore(LibZomg::ZomgBase *zomg, bool loadSaveData);
+		int zomgSave(LibZomg::ZomgBase *zomg) const;
 
 	public:
 		// Super secret debug stuff!
@@ -235,6 +244,12 @@ bool EEPRomI2C::isWriteWordPort(uint32_t address) const
 		(address == (eprMapper.sda_in_adr | 1)));
 }
 
+bool EEPRomI2C::isReadPortInRange(uint32_t start, uint32_t end) const
+{
+	return ((eprMapper.sda_out_adr | 1) >= start &&
+		(eprMapper.sda_out_adr & ~1) <= end);
+}
+
 }
 
 #endif /* __LIBGENS_SAVE_EEPROMI2C_HPP__ */
@@ -32,7 +32,7 @@
 #endif
 
 // ZOMG
-#include "libzomg/Zomg.hpp"
+#include "libzomg/ZomgBase.hpp"
 #include "libzomg/zomg_eeprom.h"
 
 // C includes. (C++ namespace)
@@ -209,10 +209,67 @@ int EEPRomI2C::autoSave(int framesElapsed)
  * @param loadData If true, load the save data in addition to the state.
  * @return 0 on success; non-zero on error.
  */
-int EEPRomI2C::zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData)
+int EEPRomI2C::zomgRestore(LibZomg::ZomgBase *zomg, bool loadSaveData)
 {
-	// TODO
-	return -1;
+	// Load the EEPROM state.
+	// NOTE: LibZomg verifies that the header is correct.
+	Zomg_EPR_ctrl_t ctrl;
+	int ret = zomg->loadEEPRomCtrl(&ctrl);
+	if (ret <= 0)
+		return -1;
+	if (ctrl.epr_type != ZOMG_EPR_TYPE_I2C)
+		return -2;
+
+	// TODO: Verify that the I2C configuration matches eprChip?
+	if (ctrl.i2c.state > EEPRomI2CPrivate::EPR_MODE3_WORD_ADDRESS_HIGH)
+		return -3;
+
+	// I2C state.
+	d->state	= (EEPRomI2CPrivate::EEPRomState_t)ctrl.i2c.state;
+	d->scl		= (ctrl.i2c.i2c_lines & 1);
+	d->sda_in	= ((ctrl.i2c.i2c_lines >> 1) & 1);
+	d->sda_out	= ((ctrl.i2c.i2c_lines >> 2) & 1);
+	d->scl_prev	= (ctrl.i2c.i2c_prev & 1);
+	d->sda_in_prev	= ((ctrl.i2c.i2c_prev >> 1) & 1);
+	d->sda_out_prev	= ((ctrl.i2c.i2c_prev >> 2) & 1);
+	d->counter	= ctrl.i2c.counter;
+	d->address	= (ctrl.i2c.address & d->eprChip.sz_mask);
+	d->data_buf	= ctrl.i2c.data_buf;
+	d->rw		= ctrl.i2c.rw;
+	// shift_rw isn't saved, but the EEPROM
+	// only shifts data out in EPR_READ_DATA.
+	d->shift_rw = (d->state == EEPRomI2CPrivate::EPR_READ_DATA);
+
+	// Load the EEPROM page cache.
+	if (d->state == EEPRomI2CPrivate::EPR_WRITE_DATA) {
+		// Page cache is valid.
+		zomg->loadEEPRomCache(d->page_cache, d->eprChip.pg_mask+1);
+	}
+
+	// Load the EEPROM data.
+	if (loadSaveData) {
+		int size = d->eprChip.sz_mask + 1;
+		if (size > (int)sizeof(d->eeprom))
+			size = (int)sizeof(d->eeprom);
+		uint8_t eeprom[sizeof(d->eeprom)];
+		ret = zomg->loadEEPRom(eeprom, size);
+		if (ret > 0) {
+			// If the data is less than the size of the EEPROM,
+			// set the rest of the EEPROM to 0xFF.
+			if (ret < size) {
+				memset(&eeprom[ret], 0xFF, size - ret);
+			}
+
+			// Only mark the EEPROM as dirty if the data changed.
+			// (See SRam::zomgRestore().)
+			if (memcmp(d->eeprom, eeprom, size) != 0) {
+				memcpy(d->eeprom, eeprom, size);
+				d->setDirty();
+			}
+		}
+	}
+
+	return 0;
 }
 
 
@@ -221,7 +278,7 @@ int EEPRomI2C::zomgRestore(LibZomg::Zomg *zomg, bool loadSaveData)
  * @param zomg ZOMG savestate.
  * @return 0 on success; non-zero on error.
  */
-int EEPRomI2C::zomgSave(LibZomg::Zomg *zomg) const
+int EEPRomI2C::zomgSave(LibZomg::ZomgBase *zomg) const
 {
 	// Save the EEPROM state.
 	Zomg_EPR_ctrl_t ctrl;
@@ -32,7 +32,7 @@
 #endif
 
 // ZOMG
-#include "libzomg/Zomg.hpp"
+#include "libzomg/ZomgBase.hpp"
 
 // C includes. (C++ namespace)
 #include <climits>
@@ -109,7 +109,20 @@ SRamPrivate::SRamPrivate(SRam *q)
  */
 int SRamPrivate::getUsedSize(void) const
 {
-	int i = (sizeof(q->m_sram) - 1);
+	// Skip unused 0xFF bytes 8 at a time.
+	// This is called for every snapshot, and most
+	// games only use a small portion of the SRam.
+	int i = sizeof(q->m_sram);
+	while (i >= 8) {
+		uint64_t qword;
+		memcpy(&qword, &q->m_sram[i - 8], sizeof(qword));
+		if (qword != ~0ULL)
+			break;
+		i -= 8;
+	}
+
+	// Find the last used byte.
+	i--;
 	while (i > 0 && q->m_sram[i] == 0xFF) {
 		i--;
 	}
@@ -358,13 +371,20 @@ int SRam::autoSave(int framesElapsed)
  * @param zomg ZOMG savestate.
  * @return 0 on success; non-zero on error.
  */
-int SRam::zomgRestore(LibZomg::Zomg *zomg)
+int SRam::zomgRestore(LibZomg::ZomgBase *zomg)
 {
-	// Load the SRam.
-	int ret = zomg->loadSRam(m_sram, sizeof(m_sram));
+	// Load the SRam into a temporary buffer first.
+	// If the data didn't change, the autosave timer is
+	// left alone. This prevents in-memory snapshots
+	// (e.g. run-ahead) from delaying autosave forever.
+	uint8_t sram[sizeof(m_sram)];
+	int ret = zomg->loadSRam(sram, sizeof(sram));
 	if (ret > 0) {
 		// SRam loaded.
-		setDirty();
+		if (memcmp(m_sram, sram, sizeof(m_sram)) != 0) {
+			memcpy(m_sram, sram, sizeof(m_sram));
+			setDirty();
+		}
 		return 0;
 	}
 
@@ -378,7 +398,7 @@ int SRam::zomgRestore(LibZomg::Zomg *zomg)
  * @param zomg ZOMG savestate.
  * @return 0 on success; non-zero on error.
  */
-int SRam::zomgSave(LibZomg::Zomg *zomg) const
+int SRam::zomgSave(LibZomg::ZomgBase *zomg) const
 {
 	// Determine how much of the SRam is currently in use.
 	int bytesUsed = d->getUsedSize();
@@ -28,6 +28,7 @@
 #include <cstring>
 #include <stdint.h>
 
+#include <atomic>
 #include <vector>
 
 namespace LibGens {
@@ -42,7 +43,10 @@ class MdFb
 
 	protected:
 		~MdFb();
-		mutable int m_refcnt;	// Allow ref()/unref() even for const MdFb.
+		// Allow ref()/unref() even for const MdFb.
+		// Atomic, since a frontend may share an MdFb between
+		// an emulation thread and a presentation thread.
+		mutable std::atomic<int> m_refcnt;
 
 	private:
 		// Q_DISABLE_COPY() equivalent.
@@ -141,6 +145,20 @@ class MdFb
 		void setImgXStart(int imgXStart);
 		void setImgYStart(int imgYStart);
 
+		/**
+		 * Copy the color depth and image parameters from another MdFb.
+		 * The framebuffer contents are not copied.
+		 * @param other Source MdFb.
+		 */
+		void copyParams(const MdFb *other);
+
+		/**
+		 * Copy the color depth, image parameters,
+		 * and framebuffer contents from another MdFb.
+		 * @param other Source MdFb.
+		 */
+		void copyFrom(const MdFb *other);
+
 		/** Convenience functions. **/
 
 		/**
@@ -224,17 +242,14 @@ class MdFb
 
 inline MdFb* MdFb::ref(void) const
 {
-	// TODO: Use atomic access?
 	m_refcnt++;
 	return (MdFb*)this;
 }
 
 inline void MdFb::unref(void) const
 {
-	// TODO: Use atomic access?
 	assert(m_refcnt > 0);
-	m_refcnt--;
-	if (m_refcnt <= 0)
+	if (--m_refcnt <= 0)
 		delete this;
 }
 
@@ -400,6 +415,33 @@ inline void MdFb::setImgYStart(int imgYStart)
 	m_imgYStart = imgYStart;
 }
 
+/**
+ * Copy the color depth and image parameters from another MdFb.
+ * The framebuffer contents are not copied.
+ * @param other Source MdFb.
+ */
+inline void MdFb::copyParams(const MdFb *other)
+{
+	m_bpp = other->m_bpp;
+	m_imgWidth = other->m_imgWidth;
+	m_imgHeight = other->m_imgHeight;
+	m_imgXStart = other->m_imgXStart;
+	m_imgYStart = other->m_imgYStart;
+}
+
+/**
+ * Copy the color depth, image parameters,
+ * and framebuffer contents from another MdFb.
+ * @param other Source MdFb.
+ */
+inline void MdFb::copyFrom(const MdFb *other)
+{
+	// All MdFbs currently have the same geometry.
+	assert(m_fb_sz == other->m_fb_sz);
+	copyParams(other);
+	memcpy(m_fb, other->m_fb, (m_fb_sz < other->m_fb_sz ? m_fb_sz : other->m_fb_sz));
+}
+
 }
 
 #endif /* __LIBGENS_UTIL_TIMING_HPP__ */
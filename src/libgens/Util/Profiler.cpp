@@ -0,0 +1,69 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Profiler.cpp: Per-subsystem frame profiler.                             *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "Profiler.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstring>
+
+namespace LibGens {
+
+Profiler::Profiler()
+	: m_frameStart(0)
+	, m_lineStart(0)
+	, m_line(0)
+{
+	memset(m_subsystemStart, 0, sizeof(m_subsystemStart));
+	memset(&m_curFrame, 0, sizeof(m_curFrame));
+	memset(m_curLineNs, 0, sizeof(m_curLineNs));
+	memset(&m_lastFrame, 0, sizeof(m_lastFrame));
+	memset(m_lastLineNs, 0, sizeof(m_lastLineNs));
+	memset(&m_total, 0, sizeof(m_total));
+}
+
+Profiler::~Profiler()
+{ }
+
+/**
+ * Get the name of a subsystem.
+ * @param subsystem Subsystem.
+ * @return Subsystem name. (ASCII)
+ */
+const char *Profiler::SubsystemName(Subsystem_t subsystem)
+{
+	static const char *const names[PROF_MAX] = {
+		"M68K", "Z80", "VDP", "DMA", "YM2612", "Sound"
+	};
+
+	assert(subsystem >= PROF_M68K && subsystem < PROF_MAX);
+	return names[subsystem];
+}
+
+/**
+ * Reset the accumulated statistics.
+ */
+void Profiler::reset(void)
+{
+	memset(&m_total, 0, sizeof(m_total));
+}
+
+}
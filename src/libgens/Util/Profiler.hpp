@@ -0,0 +1,257 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Profiler.hpp: Per-subsystem frame profiler.                             *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_PROFILER_HPP__
+#define __LIBGENS_UTIL_PROFILER_HPP__
+
+#include <libgens/config.libgens.h>
+
+#include "Timing.hpp"
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+/**
+ * Per-subsystem frame profiler.
+ *
+ * The emulation loop brackets each subsystem call with
+ * begin()/end(), each scanline with beginLine()/endLine(),
+ * and each frame with beginFrame()/endFrame().
+ *
+ * The hooks are only compiled in if GENS_ENABLE_PROFILER
+ * is defined. Use the PROFILER_*() macros instead of calling
+ * the functions directly so the hooks have zero cost when
+ * the profiler is disabled.
+ *
+ * NOTE: Times are inclusive. If the M68K writes to a register
+ * that causes the Z80 or YM2612 to catch up, that time is
+ * counted as M68K time.
+ */
+class Profiler
+{
+	public:
+		Profiler();
+		~Profiler();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		Profiler(const Profiler &);
+		Profiler &operator=(const Profiler &);
+
+	public:
+		/**
+		 * Profiled subsystems.
+		 */
+		enum Subsystem_t {
+			PROF_M68K = 0,		// M68K::exec()
+			PROF_Z80,		// Z80::exec()
+			PROF_VDP_RENDER,	// Vdp::renderLine()
+			PROF_VDP_DMA,		// Vdp::updateDMA()
+			PROF_YM2612,		// Ym2612::updateDacAndTimers()
+			PROF_SOUND_UPDATE,	// SoundMgr::specialUpdate()
+
+			PROF_MAX
+		};
+
+		// Maximum number of lines per frame. (PAL)
+		static const int MAX_LINES = 313;
+
+		/**
+		 * Get the name of a subsystem.
+		 * @param subsystem Subsystem.
+		 * @return Subsystem name. (ASCII)
+		 */
+		static const char *SubsystemName(Subsystem_t subsystem);
+
+		/**
+		 * Accumulated timing statistics.
+		 */
+		struct Stats {
+			uint64_t subsystemNs[PROF_MAX];	// Time spent in each subsystem.
+			uint64_t frameNs;		// Wall time of all frames.
+			unsigned int frames;		// Number of frames.
+			unsigned int lines;		// Number of lines.
+		};
+
+		/** Instrumentation hooks. **/
+		/** Use the PROFILER_*() macros instead of calling these directly. **/
+
+		inline void beginFrame(void);
+		inline void endFrame(void);
+		inline void beginLine(int line);
+		inline void endLine(void);
+		inline void begin(Subsystem_t subsystem);
+		inline void end(Subsystem_t subsystem);
+
+		/** Results. **/
+
+		/**
+		 * Get the statistics for the last completed frame.
+		 * @return Last frame's statistics.
+		 */
+		inline const Stats &lastFrame(void) const
+			{ return m_lastFrame; }
+
+		/**
+		 * Get the per-line wall time for the last completed frame.
+		 * Only the first lastFrame().lines entries are valid.
+		 * @return Array of MAX_LINES line times, in nanoseconds.
+		 */
+		inline const uint32_t *lastFrameLineNs(void) const
+			{ return m_lastLineNs; }
+
+		/**
+		 * Get the statistics accumulated since the last reset().
+		 * @return Accumulated statistics.
+		 */
+		inline const Stats &total(void) const
+			{ return m_total; }
+
+		/**
+		 * Reset the accumulated statistics.
+		 */
+		void reset(void);
+
+	protected:
+		Timing m_timing;
+
+		// Start times.
+		uint64_t m_subsystemStart[PROF_MAX];
+		uint64_t m_frameStart;
+		uint64_t m_lineStart;
+		int m_line;
+
+		// Current frame.
+		Stats m_curFrame;
+		uint32_t m_curLineNs[MAX_LINES];
+
+		// Last completed frame.
+		Stats m_lastFrame;
+		uint32_t m_lastLineNs[MAX_LINES];
+
+		// Accumulated since reset().
+		Stats m_total;
+};
+
+/**
+ * Start profiling a frame.
+ */
+inline void Profiler::beginFrame(void)
+{
+	for (int i = 0; i < PROF_MAX; i++) {
+		m_curFrame.subsystemNs[i] = 0;
+	}
+	m_curFrame.frames = 1;
+	m_curFrame.lines = 0;
+	m_frameStart = m_timing.getTimeNs();
+}
+
+/**
+ * Finish profiling a frame.
+ */
+inline void Profiler::endFrame(void)
+{
+	m_curFrame.frameNs = m_timing.getTimeNs() - m_frameStart;
+
+	// Save the frame statistics.
+	m_lastFrame = m_curFrame;
+	const int lines = (m_curFrame.lines < (unsigned int)MAX_LINES
+			? m_curFrame.lines : MAX_LINES);
+	for (int i = 0; i < lines; i++) {
+		m_lastLineNs[i] = m_curLineNs[i];
+	}
+
+	// Accumulate the totals.
+	for (int i = 0; i < PROF_MAX; i++) {
+		m_total.subsystemNs[i] += m_curFrame.subsystemNs[i];
+	}
+	m_total.frameNs += m_curFrame.frameNs;
+	m_total.frames++;
+	m_total.lines += m_curFrame.lines;
+}
+
+/**
+ * Start profiling a line.
+ * @param line Line number.
+ */
+inline void Profiler::beginLine(int line)
+{
+	m_line = line;
+	m_lineStart = m_timing.getTimeNs();
+}
+
+/**
+ * Finish profiling a line.
+ */
+inline void Profiler::endLine(void)
+{
+	if (m_line >= 0 && m_line < MAX_LINES) {
+		m_curLineNs[m_line] = (uint32_t)(m_timing.getTimeNs() - m_lineStart);
+	}
+	m_curFrame.lines++;
+}
+
+/**
+ * Start profiling a subsystem call.
+ * @param subsystem Subsystem.
+ */
+inline void Profiler::begin(Subsystem_t subsystem)
+{
+	m_subsystemStart[subsystem] = m_timing.getTimeNs();
+}
+
+/**
+ * Finish profiling a subsystem call.
+ * @param subsystem Subsystem.
+ */
+inline void Profiler::end(Subsystem_t subsystem)
+{
+	m_curFrame.subsystemNs[subsystem] +=
+		(m_timing.getTimeNs() - m_subsystemStart[subsystem]);
+}
+
+}
+
+/**
+ * Profiler hook macros.
+ * @param prof Profiler*.
+ * @param subsystem Subsystem, without the Profiler:: prefix.
+ */
+#ifdef GENS_ENABLE_PROFILER
+#define PROFILER_BEGIN_FRAME(prof)		(prof)->beginFrame()
+#define PROFILER_END_FRAME(prof)		(prof)->endFrame()
+#define PROFILER_BEGIN_LINE(prof, line)		(prof)->beginLine(line)
+#define PROFILER_END_LINE(prof)			(prof)->endLine()
+#define PROFILER_BEGIN(prof, subsystem)		(prof)->begin(LibGens::Profiler::subsystem)
+#define PROFILER_END(prof, subsystem)		(prof)->end(LibGens::Profiler::subsystem)
+#else /* !GENS_ENABLE_PROFILER */
+#define PROFILER_BEGIN_FRAME(prof)		do { } while (0)
+#define PROFILER_END_FRAME(prof)		do { } while (0)
+#define PROFILER_BEGIN_LINE(prof, line)		do { } while (0)
+#define PROFILER_END_LINE(prof)			do { } while (0)
+#define PROFILER_BEGIN(prof, subsystem)		do { } while (0)
+#define PROFILER_END(prof, subsystem)		do { } while (0)
+#endif /* GENS_ENABLE_PROFILER */
+
+#endif /* __LIBGENS_UTIL_PROFILER_HPP__ */
@@ -0,0 +1,420 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * RewindBuffer.cpp: Rewind buffer.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "RewindBuffer.hpp"
+#include "EmuContext/EmuContext.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstring>
+
+// C++ includes.
+#include <deque>
+#include <vector>
+using std::deque;
+using std::vector;
+
+namespace LibGens {
+
+class RewindBufferPrivate
+{
+	public:
+		RewindBufferPrivate(size_t bufSize);
+		~RewindBufferPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		RewindBufferPrivate(const RewindBufferPrivate &);
+		RewindBufferPrivate &operator=(const RewindBufferPrivate &);
+
+	public:
+		/**
+		 * History entry.
+		 * Offsets and sizes are in 64-bit words.
+		 */
+		struct Entry {
+			size_t offset;		// Offset in the ring buffer.
+			size_t size;		// Size of the encoded data.
+			size_t stateSize;	// Size of the decoded state, in bytes.
+			bool keyframe;		// If true, this is a raw state, not a delta.
+		};
+
+		// Ring buffer.
+		uint64_t *ring;
+		size_t ringSize;	// in 64-bit words
+		size_t ringUsed;	// in 64-bit words
+
+		// History entries, oldest first.
+		deque<Entry> entries;
+
+		// Newest state. (uncompressed)
+		// Stored as 64-bit words so the snapshot is aligned.
+		vector<uint64_t> cur;
+		size_t curSize;		// in bytes; 0 if no state is saved.
+
+		// Next state. Swapped with cur after encoding.
+		vector<uint64_t> next;
+
+		// Scratch buffer for encoding deltas.
+		vector<uint64_t> scratch;
+
+		/**
+		 * Encode the XOR delta between two states.
+		 * Format: {zeroWords, literalWords} header word,
+		 * followed by literalWords words of XOR data.
+		 * @param dest Destination buffer. (must have room for the worst case)
+		 * @param a First state.
+		 * @param b Second state.
+		 * @param words Size of each state, in 64-bit words.
+		 * @return Size of the encoded delta, in 64-bit words.
+		 */
+		static size_t encodeDelta(uint64_t *dest,
+			const uint64_t *a, const uint64_t *b, size_t words);
+
+		/**
+		 * Apply an encoded XOR delta to a state.
+		 * @param state State to modify.
+		 * @param words Size of the state, in 64-bit words.
+		 * @param delta Encoded delta.
+		 * @param deltaWords Size of the encoded delta, in 64-bit words.
+		 */
+		static void applyDelta(uint64_t *state, size_t words,
+			const uint64_t *delta, size_t deltaWords);
+
+		/**
+		 * Allocate space for an entry in the ring buffer.
+		 * The oldest entries are discarded if necessary.
+		 * @param size Size of the entry, in 64-bit words.
+		 * @return Offset of the entry, or ~0 if the entry is too big.
+		 */
+		size_t alloc(size_t size);
+
+		/**
+		 * Get the number of words used by a state.
+		 * @param bytes State size, in bytes.
+		 * @return State size, in 64-bit words.
+		 */
+		static inline size_t toWords(size_t bytes)
+			{ return (bytes + 7) / 8; }
+};
+
+/** RewindBufferPrivate **/
+
+RewindBufferPrivate::RewindBufferPrivate(size_t bufSize)
+	: ringSize(bufSize / 8)
+	, ringUsed(0)
+	, curSize(0)
+{
+	ring = (ringSize > 0 ? new uint64_t[ringSize] : nullptr);
+}
+
+RewindBufferPrivate::~RewindBufferPrivate()
+{
+	delete[] ring;
+}
+
+/**
+ * Encode the XOR delta between two states.
+ * Format: {zeroWords, literalWords} header word,
+ * followed by literalWords words of XOR data.
+ * @param dest Destination buffer. (must have room for the worst case)
+ * @param a First state.
+ * @param b Second state.
+ * @param words Size of each state, in 64-bit words.
+ * @return Size of the encoded delta, in 64-bit words.
+ */
+size_t RewindBufferPrivate::encodeDelta(uint64_t *dest,
+	const uint64_t *a, const uint64_t *b, size_t words)
+{
+	uint64_t *p = dest;
+	size_t i = 0;
+	while (i < words) {
+		// Count unchanged words.
+		const size_t zeroStart = i;
+		while (i < words && a[i] == b[i])
+			i++;
+		if (i == words)
+			break;
+
+		// Count changed words.
+		// Single unchanged words are included in the literal,
+		// since a new header would take up just as much space.
+		const size_t litStart = i;
+		while (i < words && (a[i] != b[i] ||
+		       (i + 1 < words && a[i+1] != b[i+1]))) {
+			i++;
+		}
+
+		*p++ = ((uint64_t)(litStart - zeroStart) << 32) | (uint64_t)(i - litStart);
+		for (size_t j = litStart; j < i; j++) {
+			*p++ = a[j] ^ b[j];
+		}
+	}
+
+	return (p - dest);
+}
+
+/**
+ * Apply an encoded XOR delta to a state.
+ * @param state State to modify.
+ * @param words Size of the state, in 64-bit words.
+ * @param delta Encoded delta.
+ * @param deltaWords Size of the encoded delta, in 64-bit words.
+ */
+void RewindBufferPrivate::applyDelta(uint64_t *state, size_t words,
+	const uint64_t *delta, size_t deltaWords)
+{
+	const uint64_t *const end = delta + deltaWords;
+	uint64_t *p = state;
+	uint64_t *const pEnd = state + words;
+	while (delta < end) {
+		const uint64_t hdr = *delta++;
+		p += (size_t)(hdr >> 32);
+		size_t lit = (size_t)(hdr & 0xFFFFFFFF);
+		if (lit > (size_t)(end - delta) || lit > (size_t)(pEnd - p)) {
+			// Corrupted delta. Shouldn't happen...
+			break;
+		}
+		for (; lit > 0; lit--) {
+			*p++ ^= *delta++;
+		}
+	}
+}
+
+/**
+ * Allocate space for an entry in the ring buffer.
+ * The oldest entries are discarded if necessary.
+ * @param size Size of the entry, in 64-bit words.
+ * @return Offset of the entry, or ~0 if the entry is too big.
+ */
+size_t RewindBufferPrivate::alloc(size_t size)
+{
+	if (size > ringSize)
+		return ~(size_t)0;
+
+	// New entries are written after the newest entry.
+	// If there isn't enough room at the end of the
+	// ring buffer, wrap around to the beginning.
+	size_t offset = 0;
+	if (!entries.empty()) {
+		const Entry &newest = entries.back();
+		offset = newest.offset + newest.size;
+		if (offset + size > ringSize) {
+			// Any entries between the newest entry and the end
+			// of the ring buffer are the oldest entries.
+			// Discard them so the ring order is preserved.
+			while (!entries.empty() && entries.front().offset >= offset) {
+				ringUsed -= entries.front().size;
+				entries.pop_front();
+			}
+			offset = 0;
+		}
+	}
+
+	// Discard the oldest entries until the new entry fits.
+	// Entries are stored in ring order, so the region after
+	// the newest entry always runs into the oldest entry first.
+	while (!entries.empty()) {
+		const Entry &oldest = entries.front();
+		if (oldest.offset >= offset + size ||
+		    oldest.offset + oldest.size <= offset)
+		{
+			// No overlap.
+			break;
+		}
+		ringUsed -= oldest.size;
+		entries.pop_front();
+	}
+
+	return offset;
+}
+
+/** RewindBuffer **/
+
+/**
+ * Create a rewind buffer.
+ * @param bufSize Maximum size of the history, in bytes.
+ */
+RewindBuffer::RewindBuffer(size_t bufSize)
+	: d(new RewindBufferPrivate(bufSize))
+{ }
+
+RewindBuffer::~RewindBuffer()
+{
+	delete d;
+}
+
+/**
+ * Save the current state of an emulation context.
+ * If the buffer is full, the oldest states are discarded.
+ * @param context Emulation context.
+ * @return 0 on success; negative errno on error.
+ */
+int RewindBuffer::push(const EmuContext *context)
+{
+	if (d->next.empty()) {
+		// Allocate the snapshot buffer.
+		int reqSize = context->snapshotSave(nullptr, 0);
+		if (reqSize < 0)
+			return reqSize;
+		d->next.resize(RewindBufferPrivate::toWords(reqSize));
+	}
+
+	int size;
+	while ((size = context->snapshotSave(d->next.data(), d->next.size() * 8)) == -ENOSPC) {
+		// Snapshot buffer is too small.
+		d->next.resize(d->next.size() * 2);
+	}
+	if (size < 0)
+		return size;
+
+	if (d->curSize > 0) {
+		// Store the previous state as a delta against the new state.
+		const size_t curWords = RewindBufferPrivate::toWords(d->curSize);
+		RewindBufferPrivate::Entry entry;
+		entry.stateSize = d->curSize;
+		const uint64_t *data;
+		if (d->curSize == (size_t)size && (d->curSize % 8) == 0) {
+			// Worst case: one header word for every two literal words.
+			const size_t maxWords = curWords + (curWords / 2) + 1;
+			if (d->scratch.size() < maxWords)
+				d->scratch.resize(maxWords);
+			entry.size = RewindBufferPrivate::encodeDelta(d->scratch.data(),
+					d->cur.data(), d->next.data(), curWords);
+			entry.keyframe = false;
+			data = d->scratch.data();
+		} else {
+			// Snapshot size changed. Store a keyframe.
+			entry.size = curWords;
+			entry.keyframe = true;
+			data = d->cur.data();
+		}
+
+		entry.offset = d->alloc(entry.size);
+		if (entry.offset == ~(size_t)0) {
+			// Entry is too big for the ring buffer.
+			// Older states can't be reconstructed anymore.
+			d->entries.clear();
+			d->ringUsed = 0;
+		} else {
+			if (entry.size > 0) {
+				memcpy(&d->ring[entry.offset], data, entry.size * 8);
+			}
+			d->entries.push_back(entry);
+			d->ringUsed += entry.size;
+		}
+	}
+
+	// The new state is now the newest state.
+	d->cur.swap(d->next);
+	d->curSize = size;
+	if (d->next.size() < d->cur.size())
+		d->next.resize(d->cur.size());
+	return 0;
+}
+
+/**
+ * Restore the most recently saved state and remove it
+ * from the buffer. The oldest state is never removed,
+ * so popping an otherwise empty buffer restores the
+ * same state again.
+ * @param context Emulation context.
+ * @return 0 on success; negative errno on error. (-ENOENT if the buffer is empty)
+ */
+int RewindBuffer::pop(EmuContext *context)
+{
+	if (d->curSize == 0)
+		return -ENOENT;
+
+	int ret = context->snapshotLoad(d->cur.data(), d->curSize);
+	if (ret != 0)
+		return ret;
+
+	if (d->entries.empty()) {
+		// Oldest state. Keep it.
+		return 0;
+	}
+
+	// Reconstruct the previous state.
+	const RewindBufferPrivate::Entry &entry = d->entries.back();
+	const uint64_t *data = &d->ring[entry.offset];
+	if (entry.keyframe) {
+		const size_t words = RewindBufferPrivate::toWords(entry.stateSize);
+		if (d->cur.size() < words)
+			d->cur.resize(words);
+		memcpy(d->cur.data(), data, entry.size * 8);
+	} else {
+		RewindBufferPrivate::applyDelta(d->cur.data(),
+			RewindBufferPrivate::toWords(entry.stateSize),
+			data, entry.size);
+	}
+	d->curSize = entry.stateSize;
+
+	d->ringUsed -= entry.size;
+	d->entries.pop_back();
+	return 0;
+}
+
+/**
+ * Discard all saved states.
+ */
+void RewindBuffer::clear(void)
+{
+	d->entries.clear();
+	d->ringUsed = 0;
+	d->curSize = 0;
+}
+
+/**
+ * Get the number of saved states.
+ * @return Number of saved states.
+ */
+int RewindBuffer::count(void) const
+{
+	if (d->curSize == 0)
+		return 0;
+	return (int)d->entries.size() + 1;
+}
+
+/**
+ * Get the maximum size of the history.
+ * @return Maximum size of the history, in bytes.
+ */
+size_t RewindBuffer::bufSize(void) const
+{
+	return d->ringSize * 8;
+}
+
+/**
+ * Get the amount of memory used by the history.
+ * This does not include the uncompressed newest state.
+ * @return Amount of memory used, in bytes.
+ */
+size_t RewindBuffer::bufUsed(void) const
+{
+	return d->ringUsed * 8;
+}
+
+}
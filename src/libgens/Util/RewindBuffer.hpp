@@ -0,0 +1,112 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * RewindBuffer.hpp: Rewind buffer.                                        *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_REWINDBUFFER_HPP__
+#define __LIBGENS_UTIL_REWINDBUFFER_HPP__
+
+// C includes. (C++ namespace)
+#include <cstddef>
+
+namespace LibGens {
+
+class EmuContext;
+
+class RewindBufferPrivate;
+/**
+ * Rewind buffer.
+ *
+ * Stores a history of in-memory snapshots in a fixed-size
+ * ring buffer. The newest state is kept uncompressed; older
+ * states are stored as run-length encoded XOR deltas against
+ * the state that follows them. Since each delta only depends
+ * on a newer state, the oldest states can be discarded at
+ * any time without invalidating the rest of the history.
+ *
+ * If the snapshot size changes between two frames (e.g. the
+ * game started using more SRam), the older state is stored
+ * as a keyframe instead of a delta.
+ */
+class RewindBuffer
+{
+	public:
+		/**
+		 * Create a rewind buffer.
+		 * @param bufSize Maximum size of the history, in bytes.
+		 */
+		RewindBuffer(size_t bufSize);
+		~RewindBuffer();
+
+	private:
+		friend class RewindBufferPrivate;
+		RewindBufferPrivate *const d;
+
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		RewindBuffer(const RewindBuffer &);
+		RewindBuffer &operator=(const RewindBuffer &);
+
+	public:
+		/**
+		 * Save the current state of an emulation context.
+		 * If the buffer is full, the oldest states are discarded.
+		 * @param context Emulation context.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int push(const EmuContext *context);
+
+		/**
+		 * Restore the most recently saved state and remove it
+		 * from the buffer. The oldest state is never removed,
+		 * so popping an otherwise empty buffer restores the
+		 * same state again.
+		 * @param context Emulation context.
+		 * @return 0 on success; negative errno on error. (-ENOENT if the buffer is empty)
+		 */
+		int pop(EmuContext *context);
+
+		/**
+		 * Discard all saved states.
+		 */
+		void clear(void);
+
+		/**
+		 * Get the number of saved states.
+		 * @return Number of saved states.
+		 */
+		int count(void) const;
+
+		/**
+		 * Get the maximum size of the history.
+		 * @return Maximum size of the history, in bytes.
+		 */
+		size_t bufSize(void) const;
+
+		/**
+		 * Get the amount of memory used by the history.
+		 * This does not include the uncompressed newest state.
+		 * @return Amount of memory used, in bytes.
+		 */
+		size_t bufUsed(void) const;
+};
+
+}
+
+#endif /* __LIBGENS_UTIL_REWINDBUFFER_HPP__ */
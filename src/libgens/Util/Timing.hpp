@@ -99,6 +99,14 @@ class Timing
 		 */
 		uint64_t getTime(void);
 
+		/**
+		 * Get the elapsed time in nanoseconds.
+		 * This is intended for profiling short intervals.
+		 * Actual resolution depends on the timing method.
+		 * @return Elapsed time, in nanoseconds.
+		 */
+		uint64_t getTimeNs(void);
+
 	protected:
 		TimingMethod m_tMethod;
 
@@ -124,4 +124,27 @@ uint64_t Timing::getTime(void)
 #endif
 }
 
+/**
+ * Get the elapsed time in nanoseconds.
+ * This is intended for profiling short intervals.
+ * Actual resolution depends on the timing method.
+ * @return Elapsed time, in nanoseconds.
+ */
+uint64_t Timing::getTimeNs(void)
+{
+#if defined(HAVE_CLOCK_GETTIME)
+	// Use clock_gettime().
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec -= m_timer_base;
+	return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+#else
+	// Fall back to gettimeofday().
+	struct timeval tv;
+	gettimeofday(&tv, nullptr);
+	tv.tv_sec -= m_timer_base;
+	return ((tv.tv_sec * 1000000000ULL) + (tv.tv_usec * 1000));
+#endif
+}
+
 }
@@ -0,0 +1,868 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VideoCapture.cpp: Lossless AVI video capture.                           *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "VideoCapture.hpp"
+#include "MdFb.hpp"
+
+// LibZomg
+#include "libzomg/PngWriter.hpp"
+#include "libzomg/Metadata.hpp"
+#include "libzomg/img_data.h"
+using LibZomg::PngWriter;
+using LibZomg::Metadata;
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::condition_variable;
+using std::deque;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+namespace LibGens {
+
+class VideoCapturePrivate
+{
+	public:
+		VideoCapturePrivate();
+		~VideoCapturePrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VideoCapturePrivate(const VideoCapturePrivate &);
+		VideoCapturePrivate &operator=(const VideoCapturePrivate &);
+
+	public:
+		// Slot pool.
+		// 16 slots is about 1/4 second of video at 60 fps.
+		static const unsigned int SLOT_COUNT = 16;
+		// Maximum number of encoder threads.
+		static const int MAX_WORKERS = 4;
+
+		/**
+		 * Frame slot.
+		 */
+		struct Slot {
+			MdFb *fb;		// Framebuffer copy.
+			bool hasFrame;		// False to repeat the previous frame.
+			unsigned int nullFrames;	// Dropped frames preceding this frame.
+			uint64_t seq;		// Sequence number.
+			vector<uint8_t> png;	// Encoded frame.
+			vector<int16_t> audio;	// Audio samples. (interleaved)
+		};
+		vector<Slot> pool;
+
+		// Free slots. (stack)
+		// Protected by mtx.
+		vector<Slot*> freeList;
+
+		// Slots waiting to be encoded. (FIFO)
+		// Protected by mtx.
+		deque<Slot*> encodeQueue;
+
+		// Encoded slots, indexed by (seq % SLOT_COUNT).
+		// Protected by mtx.
+		Slot *ready[SLOT_COUNT];
+
+		// Sequence numbers.
+		// Protected by mtx.
+		uint64_t nextSeq;	// Next slot to be queued.
+		uint64_t writeSeq;	// Next slot to be written.
+
+		// Threads.
+		vector<thread> workers;
+		thread writer;
+		mutex mtx;
+		condition_variable encodeCond;	// Slot queued for encoding.
+		condition_variable writeCond;	// Slot ready for writing.
+		condition_variable freeCond;	// Slot returned to the pool.
+		bool quitWorkers;	// Protected by mtx.
+		bool quitWriter;	// Protected by mtx.
+
+		// Capture parameters.
+		FILE *f;
+		bool isPal;
+		int audioRate;
+		int audioChannels;
+		VideoCapture::QueuePolicy policy;
+		int width;
+		int height;
+
+		// Audio and dropped frames that haven't been assigned a slot.
+		// Emulation thread only.
+		vector<int16_t> pendingAudio;
+		unsigned int pendingNull;
+
+		// File state.
+		// Writer thread only. (and start()/stop())
+		uint32_t moviBytes;	// Bytes in the 'movi' list, not including the list type.
+		uint32_t videoFrames;	// Video chunks written.
+		uint32_t audioSamples;	// Audio samples written, per channel.
+		uint32_t maxChunk;	// Largest chunk written.
+		bool full;		// File size limit was reached.
+		int writeError;		// First write error. (negative errno)
+		vector<uint8_t> index;	// 'idx1' entries.
+
+		// Statistics.
+		// Protected by mtx.
+		VideoCapture::Stats stats;
+
+		/**
+		 * Encoder thread function.
+		 */
+		void workerFunc(void);
+
+		/**
+		 * Writer thread function.
+		 */
+		void writerFunc(void);
+
+		/**
+		 * Fill a slot and queue it for encoding.
+		 * Audio from dropped frames is added to the slot.
+		 * @param slot Slot.
+		 * @param fb MD framebuffer, or nullptr to repeat the previous frame.
+		 * @param samples Audio samples, or nullptr for silence.
+		 * @param count Number of samples per channel.
+		 */
+		void queueSlot(Slot *slot, const MdFb *fb, const int16_t *samples, int count);
+
+		/**
+		 * Append audio samples to a buffer.
+		 * @param buf Buffer.
+		 * @param samples Audio samples, or nullptr for silence.
+		 * @param count Number of samples per channel.
+		 */
+		inline void appendAudio(vector<int16_t> &buf, const int16_t *samples, int count) const;
+
+		/**
+		 * Write a slot to the file.
+		 * Called by the writer thread without mtx held.
+		 * @param slot Slot.
+		 * @return Number of video frames dropped because the file is full.
+		 */
+		unsigned int writeSlot(const Slot *slot);
+
+		/**
+		 * Write a 'movi' chunk and add it to the index.
+		 * If the write fails, writeError is set.
+		 * @param fourCC Chunk ID.
+		 * @param data Chunk data.
+		 * @param len Length of data.
+		 */
+		void writeChunk(const char *fourCC, const void *data, uint32_t len);
+
+		/**
+		 * Write the AVI file headers.
+		 * @param f AVI file, positioned at the start.
+		 * @return True on success; false on error.
+		 */
+		bool writeHeaders(FILE *f) const;
+
+		// Header size, up to and including the 'movi' list type.
+		static const unsigned int HEADER_SIZE = 326;
+
+		// Maximum file size.
+		// AVI 1.0 files are limited to 2 GB by many readers.
+		static const uint32_t MAX_FILE_SIZE = 0x7FF00000;
+
+		// AVI flags.
+		static const uint32_t AVIF_HASINDEX = 0x10;
+		static const uint32_t AVIF_ISINTERLEAVED = 0x100;
+		static const uint32_t AVIIF_KEYFRAME = 0x10;
+};
+
+/**
+ * Store a 16-bit little-endian value.
+ * @param p Destination.
+ * @param val Value.
+ */
+static inline void putLE16(uint8_t *p, uint16_t val)
+{
+	p[0] = (uint8_t)(val & 0xFF);
+	p[1] = (uint8_t)(val >> 8);
+}
+
+/**
+ * Store a 32-bit little-endian value.
+ * @param p Destination.
+ * @param val Value.
+ */
+static inline void putLE32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)(val & 0xFF);
+	p[1] = (uint8_t)((val >> 8) & 0xFF);
+	p[2] = (uint8_t)((val >> 16) & 0xFF);
+	p[3] = (uint8_t)(val >> 24);
+}
+
+/** VideoCapturePrivate **/
+
+VideoCapturePrivate::VideoCapturePrivate()
+	: nextSeq(0)
+	, writeSeq(0)
+	, quitWorkers(false)
+	, quitWriter(false)
+	, f(nullptr)
+	, isPal(false)
+	, audioRate(0)
+	, audioChannels(0)
+	, policy(VideoCapture::QUEUE_DROP)
+	, width(0)
+	, height(0)
+	, pendingNull(0)
+	, moviBytes(0)
+	, videoFrames(0)
+	, audioSamples(0)
+	, maxChunk(0)
+	, full(false)
+	, writeError(0)
+{
+	memset(ready, 0, sizeof(ready));
+	memset(&stats, 0, sizeof(stats));
+}
+
+VideoCapturePrivate::~VideoCapturePrivate()
+{
+	assert(workers.empty());
+	assert(!writer.joinable());
+}
+
+/**
+ * Encoder thread function.
+ */
+void VideoCapturePrivate::workerFunc(void)
+{
+	PngWriter pngWriter;
+
+	unique_lock<mutex> lock(mtx);
+	while (true) {
+		while (encodeQueue.empty() && !quitWorkers) {
+			encodeCond.wait(lock);
+		}
+		if (encodeQueue.empty()) {
+			// Quit was requested, and all slots were encoded.
+			break;
+		}
+
+		Slot *const slot = encodeQueue.front();
+		encodeQueue.pop_front();
+
+		// Don't hold the lock while encoding.
+		lock.unlock();
+		if (slot->hasFrame) {
+			// Encode the full framebuffer.
+			const MdFb *fb = slot->fb;
+			Zomg_Img_Data_t img_data;
+			memset(&img_data, 0, sizeof(img_data));
+			img_data.w = fb->pxPerLine();
+			img_data.h = fb->numLines();
+			const MdFb::ColorDepth bpp = fb->bpp();
+			if (bpp == MdFb::BPP_32) {
+				img_data.data = (void*)fb->lineBuf32(0);
+				img_data.pitch = (fb->pxPitch() * sizeof(uint32_t));
+				img_data.bpp = 32;
+			} else {
+				img_data.data = (void*)fb->lineBuf16(0);
+				img_data.pitch = (fb->pxPitch() * sizeof(uint16_t));
+				img_data.bpp = (bpp == MdFb::BPP_16 ? 16 : 15);
+			}
+
+			// If encoding fails, the PNG buffer is empty,
+			// and an empty frame is written instead.
+			pngWriter.writeToMemory(&img_data, slot->png,
+					nullptr, Metadata::MF_None);
+		} else {
+			slot->png.clear();
+		}
+
+		// AVI files are little-endian.
+		cpu_to_le16_array((uint16_t*)slot->audio.data(),
+				  slot->audio.size() * sizeof(int16_t));
+		lock.lock();
+
+		ready[slot->seq % SLOT_COUNT] = slot;
+		if (slot->seq == writeSeq) {
+			writeCond.notify_one();
+		}
+	}
+}
+
+/**
+ * Writer thread function.
+ */
+void VideoCapturePrivate::writerFunc(void)
+{
+	unique_lock<mutex> lock(mtx);
+	while (true) {
+		Slot *slot;
+		while (!(slot = ready[writeSeq % SLOT_COUNT]) &&
+		       !(quitWriter && writeSeq == nextSeq))
+		{
+			writeCond.wait(lock);
+		}
+		if (!slot) {
+			// Quit was requested, and all slots were written.
+			break;
+		}
+
+		assert(slot->seq == writeSeq);
+		ready[writeSeq % SLOT_COUNT] = nullptr;
+
+		// Don't hold the lock while writing.
+		lock.unlock();
+		const unsigned int dropped = writeSlot(slot);
+		lock.lock();
+
+		stats.frames = videoFrames;
+		stats.dropped += dropped;
+		writeSeq++;
+		freeList.push_back(slot);
+		freeCond.notify_one();
+	}
+}
+
+/**
+ * Append audio samples to a buffer.
+ * @param buf Buffer.
+ * @param samples Audio samples, or nullptr for silence.
+ * @param count Number of samples per channel.
+ */
+inline void VideoCapturePrivate::appendAudio(vector<int16_t> &buf, const int16_t *samples, int count) const
+{
+	const size_t len = (size_t)count * audioChannels;
+	if (samples) {
+		buf.insert(buf.end(), samples, samples + len);
+	} else {
+		buf.resize(buf.size() + len, 0);
+	}
+}
+
+/**
+ * Fill a slot and queue it for encoding.
+ * Audio from dropped frames is added to the slot.
+ * @param slot Slot.
+ * @param fb MD framebuffer, or nullptr to repeat the previous frame.
+ * @param samples Audio samples, or nullptr for silence.
+ * @param count Number of samples per channel.
+ */
+void VideoCapturePrivate::queueSlot(Slot *slot, const MdFb *fb, const int16_t *samples, int count)
+{
+	// Copy the frame.
+	slot->hasFrame = (fb != nullptr);
+	if (fb) {
+		slot->fb->copyFrom(fb);
+	}
+
+	// Copy the audio, including audio from dropped frames.
+	slot->nullFrames = pendingNull;
+	slot->audio.swap(pendingAudio);
+	appendAudio(slot->audio, samples, count);
+	pendingAudio.clear();
+	pendingNull = 0;
+
+	{
+		std::lock_guard<mutex> lock(mtx);
+		slot->seq = nextSeq++;
+		encodeQueue.push_back(slot);
+
+		const unsigned int queued = (unsigned int)(nextSeq - writeSeq);
+		if (queued > stats.maxQueued) {
+			stats.maxQueued = queued;
+		}
+	}
+	encodeCond.notify_one();
+}
+
+/**
+ * Write a 'movi' chunk and add it to the index.
+ * If the write fails, writeError is set.
+ * @param fourCC Chunk ID.
+ * @param data Chunk data.
+ * @param len Length of data.
+ */
+void VideoCapturePrivate::writeChunk(const char *fourCC, const void *data, uint32_t len)
+{
+	if (writeError != 0)
+		return;
+
+	uint8_t hdr[8];
+	memcpy(&hdr[0], fourCC, 4);
+	putLE32(&hdr[4], len);
+	bool ok = (fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr));
+	if (ok && len > 0) {
+		ok = (fwrite(data, 1, len, f) == len);
+	}
+	if (ok && (len & 1)) {
+		// Chunks are padded to an even length.
+		static const uint8_t pad = 0;
+		ok = (fwrite(&pad, 1, 1, f) == 1);
+	}
+	if (!ok) {
+		// Write error. Stop writing; stop() returns the error.
+		writeError = (errno != 0 ? -errno : -EIO);
+		return;
+	}
+
+	// Index entry.
+	// The offset is relative to the 'movi' list type.
+	uint8_t entry[16];
+	memcpy(&entry[0], fourCC, 4);
+	putLE32(&entry[4], AVIIF_KEYFRAME);
+	putLE32(&entry[8], 4 + moviBytes);
+	putLE32(&entry[12], len);
+	index.insert(index.end(), entry, entry + sizeof(entry));
+
+	moviBytes += 8 + ((len + 1) & ~1);
+	if (len > maxChunk) {
+		maxChunk = len;
+	}
+}
+
+/**
+ * Write a slot to the file.
+ * Called by the writer thread without mtx held.
+ * @param slot Slot.
+ * @return Number of video frames dropped because the file is full.
+ */
+unsigned int VideoCapturePrivate::writeSlot(const Slot *slot)
+{
+	const uint32_t pngLen = (uint32_t)slot->png.size();
+	const uint32_t audioLen = (uint32_t)(slot->audio.size() * sizeof(int16_t));
+	const unsigned int frames = slot->nullFrames + 1;
+
+	if (!full) {
+		// Check if this slot will fit.
+		// Each chunk has an 8-byte header, a pad byte,
+		// and a 16-byte index entry.
+		const uint64_t size = (uint64_t)HEADER_SIZE + moviBytes +
+			8 + index.size() + (frames + 1) * (8 + 1 + 16) +
+			pngLen + audioLen;
+		if (size > MAX_FILE_SIZE) {
+			full = true;
+		}
+	}
+	if (full || writeError != 0) {
+		// File is full, or a write failed. Drop everything.
+		return frames;
+	}
+
+	// Empty frames for dropped frames.
+	for (unsigned int i = 0; i < slot->nullFrames; i++) {
+		writeChunk("00dc", nullptr, 0);
+	}
+
+	// Video frame.
+	// An empty chunk repeats the previous frame.
+	writeChunk("00dc", slot->png.data(), pngLen);
+	videoFrames += frames;
+
+	// Audio.
+	if (audioLen > 0) {
+		writeChunk("01wb", slot->audio.data(), audioLen);
+		audioSamples += (uint32_t)(slot->audio.size() / audioChannels);
+	}
+
+	return 0;
+}
+
+/**
+ * Write the AVI file headers.
+ * @param f AVI file, positioned at the start.
+ * @return True on success; false on error.
+ */
+bool VideoCapturePrivate::writeHeaders(FILE *f) const
+{
+	// Reference: https://docs.microsoft.com/en-us/windows/win32/directshow/avi-riff-file-reference
+	const unsigned int fps = (isPal ? 50 : 60);
+	const unsigned int blockAlign = audioChannels * 2;
+	const uint32_t riffSize = HEADER_SIZE - 8 + moviBytes +
+			(!index.empty() ? 8 + (uint32_t)index.size() : 0);
+
+	uint8_t hdr[HEADER_SIZE];
+	memset(hdr, 0, sizeof(hdr));
+	uint8_t *p = hdr;
+
+	// RIFF header.
+	memcpy(&p[0], "RIFF", 4);
+	putLE32(&p[4], riffSize);
+	memcpy(&p[8], "AVI ", 4);
+	p += 12;
+
+	// Header list.
+	memcpy(&p[0], "LIST", 4);
+	putLE32(&p[4], HEADER_SIZE - 12 - 12 - 8);
+	memcpy(&p[8], "hdrl", 4);
+	p += 12;
+
+	// Main AVI header.
+	memcpy(&p[0], "avih", 4);
+	putLE32(&p[4], 56);
+	putLE32(&p[8], 1000000 / fps);			// Microseconds per frame
+	putLE32(&p[12], maxChunk * fps);		// Maximum bytes per second (approx.)
+	putLE32(&p[20], AVIF_HASINDEX | AVIF_ISINTERLEAVED);
+	putLE32(&p[24], videoFrames);			// Total frames
+	putLE32(&p[32], 2);				// Number of streams
+	putLE32(&p[36], maxChunk + 8);			// Suggested buffer size
+	putLE32(&p[40], width);
+	putLE32(&p[44], height);
+	p += 8 + 56;
+
+	// Video stream list.
+	memcpy(&p[0], "LIST", 4);
+	putLE32(&p[4], 4 + (8 + 56) + (8 + 40));
+	memcpy(&p[8], "strl", 4);
+	p += 12;
+
+	memcpy(&p[0], "strh", 4);
+	putLE32(&p[4], 56);
+	memcpy(&p[8], "vids", 4);
+	memcpy(&p[12], "MPNG", 4);			// Handler
+	putLE32(&p[28], 1);				// Scale
+	putLE32(&p[32], fps);				// Rate
+	putLE32(&p[40], videoFrames);			// Length
+	putLE32(&p[44], maxChunk + 8);			// Suggested buffer size
+	putLE32(&p[48], 0xFFFFFFFF);			// Quality (default)
+	putLE16(&p[60], width);				// Frame rectangle
+	putLE16(&p[62], height);
+	p += 8 + 56;
+
+	memcpy(&p[0], "strf", 4);
+	putLE32(&p[4], 40);
+	putLE32(&p[8], 40);				// BITMAPINFOHEADER size
+	putLE32(&p[12], width);
+	putLE32(&p[16], height);
+	putLE16(&p[20], 1);				// Planes
+	putLE16(&p[22], 24);				// Bits per pixel
+	memcpy(&p[24], "MPNG", 4);			// Compression
+	putLE32(&p[28], width * height * 3);		// Image size
+	p += 8 + 40;
+
+	// Audio stream list.
+	memcpy(&p[0], "LIST", 4);
+	putLE32(&p[4], 4 + (8 + 56) + (8 + 18));
+	memcpy(&p[8], "strl", 4);
+	p += 12;
+
+	memcpy(&p[0], "strh", 4);
+	putLE32(&p[4], 56);
+	memcpy(&p[8], "auds", 4);
+	putLE32(&p[28], 1);				// Scale
+	putLE32(&p[32], audioRate);			// Rate
+	putLE32(&p[40], audioSamples);			// Length
+	putLE32(&p[44], (audioRate / fps + 1) * blockAlign);	// Suggested buffer size
+	putLE32(&p[48], 0xFFFFFFFF);			// Quality (default)
+	putLE32(&p[52], blockAlign);			// Sample size
+	p += 8 + 56;
+
+	memcpy(&p[0], "strf", 4);
+	putLE32(&p[4], 18);
+	putLE16(&p[8], 1);				// PCM
+	putLE16(&p[10], audioChannels);
+	putLE32(&p[12], audioRate);
+	putLE32(&p[16], audioRate * blockAlign);	// Bytes per second
+	putLE16(&p[20], blockAlign);			// Block alignment
+	putLE16(&p[22], 16);				// Bits per sample
+	p += 8 + 18;
+
+	// Movie list.
+	memcpy(&p[0], "LIST", 4);
+	putLE32(&p[4], 4 + moviBytes);
+	memcpy(&p[8], "movi", 4);
+	p += 12;
+
+	assert(p == &hdr[HEADER_SIZE]);
+	return (fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr));
+}
+
+/** VideoCapture **/
+
+VideoCapture::VideoCapture()
+	: d(new VideoCapturePrivate())
+{ }
+
+VideoCapture::~VideoCapture()
+{
+	stop();
+	delete d;
+}
+
+/**
+ * Start capturing.
+ * @param filename AVI filename.
+ * @param isPal If true, record at 50 fps; otherwise, record at 60 fps.
+ * @param audioRate Audio sampling rate, in Hz.
+ * @param audioChannels Number of audio channels. (1 or 2)
+ * @param policy Queue policy.
+ * @param workers Number of encoder threads. (0 for automatic)
+ * @return 0 on success; negative errno on error.
+ */
+int VideoCapture::start(const char *filename, bool isPal,
+			int audioRate, int audioChannels,
+			QueuePolicy policy, int workers)
+{
+	if (isRunning())
+		return -EBUSY;
+	if (!filename || !filename[0])
+		return -EINVAL;
+	if (audioRate <= 0 || audioChannels < 1 || audioChannels > 2)
+		return -EINVAL;
+	if (policy < QUEUE_DROP || policy >= QUEUE_MAX)
+		return -EINVAL;
+
+	// Open the file.
+	// A placeholder header is written here,
+	// and the real header is written by stop().
+	d->f = fopen(filename, "wb");
+	if (!d->f)
+		return -errno;
+
+	// Reset the capture state.
+	d->isPal = isPal;
+	d->audioRate = audioRate;
+	d->audioChannels = audioChannels;
+	d->policy = policy;
+	d->pendingAudio.clear();
+	d->pendingNull = 0;
+	d->moviBytes = 0;
+	d->videoFrames = 0;
+	d->audioSamples = 0;
+	d->maxChunk = 0;
+	d->full = false;
+	d->writeError = 0;
+	d->index.clear();
+	memset(&d->stats, 0, sizeof(d->stats));
+
+	// Allocate the slot pool.
+	d->pool.resize(VideoCapturePrivate::SLOT_COUNT);
+	d->freeList.clear();
+	for (unsigned int i = 0; i < VideoCapturePrivate::SLOT_COUNT; i++) {
+		VideoCapturePrivate::Slot *const slot = &d->pool[i];
+		slot->fb = new MdFb();
+		slot->hasFrame = false;
+		slot->nullFrames = 0;
+		slot->seq = 0;
+		d->freeList.push_back(slot);
+	}
+	d->encodeQueue.clear();
+	memset(d->ready, 0, sizeof(d->ready));
+	d->nextSeq = 0;
+	d->writeSeq = 0;
+
+	// All MdFbs have the same geometry.
+	d->width = d->pool[0].fb->pxPerLine();
+	d->height = d->pool[0].fb->numLines();
+	if (!d->writeHeaders(d->f)) {
+		const int err = (errno != 0 ? -errno : -EIO);
+		fclose(d->f);
+		d->f = nullptr;
+		for (size_t i = 0; i < d->pool.size(); i++) {
+			d->pool[i].fb->unref();
+		}
+		d->pool.clear();
+		d->freeList.clear();
+		return err;
+	}
+
+	// Start the encoder threads.
+	// Leave one CPU for the emulation thread.
+	if (workers <= 0) {
+		workers = (int)thread::hardware_concurrency() - 1;
+	}
+	if (workers < 1) {
+		workers = 1;
+	} else if (workers > VideoCapturePrivate::MAX_WORKERS) {
+		workers = VideoCapturePrivate::MAX_WORKERS;
+	}
+	d->quitWorkers = false;
+	d->quitWriter = false;
+	for (int i = 0; i < workers; i++) {
+		d->workers.push_back(thread(&VideoCapturePrivate::workerFunc, d));
+	}
+
+	// Start the writer thread.
+	d->writer = thread(&VideoCapturePrivate::writerFunc, d);
+	return 0;
+}
+
+/**
+ * Stop capturing.
+ * Queued frames are written, and the file headers are finalized.
+ * @return 0 on success; negative errno if a write failed.
+ */
+int VideoCapture::stop(void)
+{
+	if (!isRunning())
+		return 0;
+
+	if (d->pendingNull > 0 || !d->pendingAudio.empty()) {
+		// Write the remaining audio with a repeated frame.
+		// Wait for a slot regardless of the queue policy.
+		VideoCapturePrivate::Slot *slot;
+		{
+			unique_lock<mutex> lock(d->mtx);
+			while (d->freeList.empty()) {
+				d->freeCond.wait(lock);
+			}
+			slot = d->freeList.back();
+			d->freeList.pop_back();
+		}
+		d->queueSlot(slot, nullptr, nullptr, 0);
+	}
+
+	// Wait for the encoder threads, then the writer thread.
+	{
+		std::lock_guard<mutex> lock(d->mtx);
+		d->quitWorkers = true;
+	}
+	d->encodeCond.notify_all();
+	for (size_t i = 0; i < d->workers.size(); i++) {
+		d->workers[i].join();
+	}
+	d->workers.clear();
+
+	{
+		std::lock_guard<mutex> lock(d->mtx);
+		d->quitWriter = true;
+	}
+	d->writeCond.notify_one();
+	d->writer.join();
+
+	// Write the index and the final header.
+	// If the data couldn't be written, the file is left as-is.
+	int err = d->writeError;
+	if (err == 0 && !d->index.empty()) {
+		uint8_t hdr[8];
+		memcpy(&hdr[0], "idx1", 4);
+		putLE32(&hdr[4], (uint32_t)d->index.size());
+		if (fwrite(hdr, 1, sizeof(hdr), d->f) != sizeof(hdr) ||
+		    fwrite(d->index.data(), 1, d->index.size(), d->f) != d->index.size())
+		{
+			err = (errno != 0 ? -errno : -EIO);
+		}
+	}
+	if (err == 0) {
+		if (fseek(d->f, 0, SEEK_SET) != 0 ||
+		    !d->writeHeaders(d->f))
+		{
+			err = (errno != 0 ? -errno : -EIO);
+		}
+	}
+	if (fclose(d->f) != 0 && err == 0) {
+		err = (errno != 0 ? -errno : -EIO);
+	}
+	d->f = nullptr;
+
+	// Free the slot pool.
+	for (size_t i = 0; i < d->pool.size(); i++) {
+		d->pool[i].fb->unref();
+	}
+	d->pool.clear();
+	d->freeList.clear();
+	d->index.clear();
+	d->index.shrink_to_fit();
+	return err;
+}
+
+/**
+ * Is a capture running?
+ * @return True if a capture is running; false if not.
+ */
+bool VideoCapture::isRunning(void) const
+{
+	return (d->f != nullptr);
+}
+
+/**
+ * Record a frame.
+ * @param fb MD framebuffer, or nullptr to repeat the previous frame.
+ * @param samples Audio samples for this frame, or nullptr for silence. (16-bit, host-endian, interleaved)
+ * @param count Number of samples per channel.
+ * @return 0 on success; -EAGAIN if the video frame was dropped; other negative errno on error.
+ */
+int VideoCapture::pushFrame(const MdFb *fb, const int16_t *samples, int count)
+{
+	if (!isRunning())
+		return -EBADF;
+	if (count < 0)
+		return -EINVAL;
+
+	// Get a free slot.
+	VideoCapturePrivate::Slot *slot = nullptr;
+	{
+		unique_lock<mutex> lock(d->mtx);
+		if (d->freeList.empty()) {
+			if (d->policy == QUEUE_DROP) {
+				// Drop the video frame.
+				// The audio is written with the next frame.
+				d->stats.dropped++;
+				lock.unlock();
+				d->pendingNull++;
+				d->appendAudio(d->pendingAudio, samples, count);
+				return -EAGAIN;
+			}
+
+			// Wait for a slot.
+			const std::chrono::steady_clock::time_point begin =
+				std::chrono::steady_clock::now();
+			while (d->freeList.empty()) {
+				d->freeCond.wait(lock);
+			}
+			d->stats.stalls++;
+			d->stats.stallTime += std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - begin).count();
+		}
+		slot = d->freeList.back();
+		d->freeList.pop_back();
+	}
+
+	d->queueSlot(slot, fb, samples, count);
+	return 0;
+}
+
+/**
+ * Get the capture statistics.
+ * The statistics are reset by start().
+ * @param stats [out] Capture statistics.
+ */
+void VideoCapture::stats(Stats *stats) const
+{
+	std::lock_guard<mutex> lock(d->mtx);
+	*stats = d->stats;
+}
+
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VideoCapture.hpp: Lossless AVI video capture.                           *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_UTIL_VIDEOCAPTURE_HPP__
+#define __LIBGENS_UTIL_VIDEOCAPTURE_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class MdFb;
+
+class VideoCapturePrivate;
+/**
+ * Lossless video capture.
+ *
+ * Frames are recorded to an AVI file with one PNG image
+ * per video frame ('MPNG') and 16-bit PCM audio.
+ * The full framebuffer is recorded, so the frame size
+ * doesn't change if the display mode changes.
+ *
+ * pushFrame() copies the framebuffer into one of a fixed
+ * pool of MdFbs that is allocated by start(). The copies
+ * are encoded by a pool of worker threads, and a writer
+ * thread writes the encoded frames to the file in order.
+ *
+ * If all pool slots are in use, the queue policy determines
+ * what happens: QUEUE_DROP drops the video frame, and
+ * QUEUE_STALL blocks the emulation thread until a slot is
+ * available. Audio is never dropped; the audio for a dropped
+ * frame is written with the next frame that is recorded, and
+ * the dropped frame is written as an empty frame so the audio
+ * stays in sync.
+ */
+class VideoCapture
+{
+	public:
+		VideoCapture();
+		~VideoCapture();
+
+	private:
+		friend class VideoCapturePrivate;
+		VideoCapturePrivate *const d;
+
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VideoCapture(const VideoCapture &);
+		VideoCapture &operator=(const VideoCapture &);
+
+	public:
+		/**
+		 * Queue policy if all pool slots are in use.
+		 */
+		enum QueuePolicy {
+			QUEUE_DROP,	// Drop the video frame.
+			QUEUE_STALL,	// Wait for a slot.
+
+			QUEUE_MAX
+		};
+
+		/**
+		 * Start capturing.
+		 * @param filename AVI filename.
+		 * @param isPal If true, record at 50 fps; otherwise, record at 60 fps.
+		 * @param audioRate Audio sampling rate, in Hz.
+		 * @param audioChannels Number of audio channels. (1 or 2)
+		 * @param policy Queue policy.
+		 * @param workers Number of encoder threads. (0 for automatic)
+		 * @return 0 on success; negative errno on error.
+		 */
+		int start(const char *filename, bool isPal,
+			  int audioRate, int audioChannels,
+			  QueuePolicy policy, int workers = 0);
+
+		/**
+		 * Stop capturing.
+		 * Queued frames are written, and the file headers are finalized.
+		 * @return 0 on success; negative errno if a write failed.
+		 */
+		int stop(void);
+
+		/**
+		 * Is a capture running?
+		 * @return True if a capture is running; false if not.
+		 */
+		bool isRunning(void) const;
+
+		/**
+		 * Record a frame.
+		 * @param fb MD framebuffer, or nullptr to repeat the previous frame.
+		 * @param samples Audio samples for this frame, or nullptr for silence. (16-bit, host-endian, interleaved)
+		 * @param count Number of samples per channel.
+		 * @return 0 on success; -EAGAIN if the video frame was dropped; other negative errno on error.
+		 */
+		int pushFrame(const MdFb *fb, const int16_t *samples, int count);
+
+		/**
+		 * Capture statistics.
+		 */
+		struct Stats {
+			unsigned int frames;	// Frames written, including empty frames.
+			unsigned int dropped;	// Video frames dropped.
+			unsigned int stalls;	// Number of times pushFrame() waited for a slot.
+			uint64_t stallTime;	// Total time spent waiting, in microseconds.
+			unsigned int maxQueued;	// Maximum number of frames in flight.
+		};
+
+		/**
+		 * Get the capture statistics.
+		 * The statistics are reset by start().
+		 * @param stats [out] Capture statistics.
+		 */
+		void stats(Stats *stats) const;
+};
+
+}
+
+#endif /* __LIBGENS_UTIL_VIDEOCAPTURE_HPP__ */
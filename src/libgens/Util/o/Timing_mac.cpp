@@ -110,4 +110,22 @@ uint64_t Timing::getTime(void)
 	return (uint64_t)(d_abs_time / 1000.0);
 }
 
+/**
+ * Get the elapsed time in nanoseconds.
+ * This is intended for profiling short intervals.
+ * Actual resolution depends on the timing method.
+ * @return Elapsed time, in nanoseconds.
+ */
+uint64_t Timing::getTimeNs(void)
+{
+	// Mach absolute time. (Mac OS X)
+	// The timebase is usually 1/1, so use integer math
+	// to keep full precision for short intervals.
+	uint64_t abs_time = mach_absolute_time() - m_timer_base;
+	if (d->timebase_info.numer == d->timebase_info.denom)
+		return abs_time;
+	return (abs_time / d->timebase_info.denom) * d->timebase_info.numer +
+	       ((abs_time % d->timebase_info.denom) * d->timebase_info.numer) / d->timebase_info.denom;
+}
+
 }
@@ -206,4 +206,41 @@ uint64_t Timing::getTime(void)
 	return timer;
 }
 
+/**
+ * Get the elapsed time in nanoseconds.
+ * This is intended for profiling short intervals.
+ * Actual resolution depends on the timing method.
+ * @return Elapsed time, in nanoseconds.
+ */
+uint64_t Timing::getTimeNs(void)
+{
+	uint64_t timer;
+	switch (m_tMethod) {
+		case TM_GETTICKCOUNT:
+		default:
+			// FIXME: Prevent overflow.
+			timer = (uint64_t)(GetTickCount() - m_timer_base) * 1000000;
+			break;
+
+		case TM_GETTICKCOUNT64:
+			timer = (d->pGetTickCount64() - m_timer_base) * 1000000;
+			break;
+
+		case TM_QUERYPERFORMANCECOUNTER: {
+			// Convert whole seconds and the remainder separately.
+			// Multiplying the tick count by 10^9 first would
+			// overflow after a few hours at common frequencies.
+			LARGE_INTEGER perf_ctr;
+			QueryPerformanceCounter(&perf_ctr);
+			const uint64_t ticks = (uint64_t)(perf_ctr.QuadPart - m_timer_base);
+			const uint64_t freq = (uint64_t)d->perfFreq.QuadPart;
+			timer = ((ticks / freq) * 1000000000ULL) +
+				(((ticks % freq) * 1000000000ULL) / freq);
+			break;
+		}
+	}
+
+	return timer;
+}
+
 }
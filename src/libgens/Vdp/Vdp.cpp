@@ -27,10 +27,12 @@
 #include "macros/common.h"
 
 // C includes. (C++ namespace)
+#include <cassert>
 #include <cstring>
 
 // ZOMG
-#include "libzomg/Zomg.hpp"
+#include "libzomg/ZomgBase.hpp"
+#include "libzomg/ZomgMem.hpp"
 
 // VDP includes.
 #include "VdpPalette.hpp"
@@ -57,10 +59,18 @@ const VdpTypes::VdpEmuOptions_t VdpPrivate::def_vdpEmuOptions = {
 	true,				// enableInterlacedMode
 };
 
-VdpPrivate::VdpPrivate(Vdp *q)
+VdpPrivate::VdpPrivate(Vdp *q, EmuContext *context)
 	: q(q)
+	, context(context)
 	, VDP_Model(VdpTypes::VDP_MODEL_MD)	// TODO: Add support for more models.
+	, planeCache(nullptr)
+	, patternCache(nullptr)
+	, lineSkip(nullptr)
+	, vramGen(0)
+	, vsramGen(0)
+	, regGen(0)
 	, VRam_Mask(0xFFFF)	// Always ensure this mask is valid.
+	, dmaBulk(true)
 	, d_err(new VdpRend_Err_Private(q))
 {
 	// TODO: Initialize all private variables.
@@ -86,6 +96,9 @@ VdpPrivate::VdpPrivate(Vdp *q)
 VdpPrivate::~VdpPrivate()
 {
 	delete d_err;
+	delete planeCache;
+	delete patternCache;
+	delete lineSkip;
 }
 
 /** Vdp **/
@@ -93,9 +106,10 @@ VdpPrivate::~VdpPrivate()
 /**
  * Initialize the VDP subsystem.
  * @param fb Existing MdFb to use. (If nullptr, allocate a new MdFb.)
+ * @param context Emulation context. (If nullptr, the VDP can't access the M68K.)
  */
-Vdp::Vdp(MdFb *fb)
-	: d(new VdpPrivate(this))
+Vdp::Vdp(MdFb *fb, EmuContext *context)
+	: d(new VdpPrivate(this, context))
 	, options(VdpPrivate::def_vdpEmuOptions)
 	, DMAT_Length(0)
 	, MD_Screen(fb ? fb->ref() : new MdFb())
@@ -123,6 +137,28 @@ Vdp::~Vdp(void)
 	MD_Screen->unref();
 }
 
+/**
+ * Set the MD framebuffer.
+ * Rendering continues in the new framebuffer starting
+ * with the next line. Image parameters are NOT copied;
+ * use MdFb::copyParams() first if necessary.
+ * @param fb New framebuffer. (Will be ref()'d.)
+ */
+void Vdp::setMdScreen(MdFb *fb)
+{
+	assert(fb != nullptr);
+	if (fb == MD_Screen)
+		return;
+
+	fb->ref();
+	MD_Screen->unref();
+	MD_Screen = fb;
+
+	// The error renderer only draws when the VDP mode changes,
+	// so force it to redraw into the new framebuffer.
+	d->d_err->lastVdpMode = ~0;
+}
+
 /**
  * Reset the VDP.
  */
@@ -134,11 +170,17 @@ void Vdp::reset(void)
 	// Clear VRam and VSRam.
 	memset(&d->VRam, 0, sizeof(d->VRam));
 	memset(&d->VSRam, 0, sizeof(d->VSRam));
+	d->vramReloaded();
+	if (d->lineSkip) {
+		// rend_reset() cleared MD_Screen.
+		d->lineSkip->invalidate();
+	}
 	// Clear the Sprite Attribute Table cache.
 	memset(&d->SprAttrTbl_m5.b, 0, sizeof(d->SprAttrTbl_m5.b));
 	// Clear the sprite line cache.
 	memset(d->sprLineCache, 0, sizeof(d->sprLineCache));
 	memset(d->sprCountCache, 0, sizeof(d->sprCountCache));
+	memset(d->sprLineCacheSig, 0, sizeof(d->sprLineCacheSig));
 
 	// Reset the palette. (Includes CRam.)
 	d->palette.reset();
@@ -200,6 +242,174 @@ int Vdp::getHPixBegin(void) const
 int Vdp::getVPix(void) const
 	{ return VDP_Lines.totalVisibleLines; }
 
+/**
+ * Enable or disable the Mode 5 scroll plane row cache.
+ * If enabled, nametable words and pattern lines for unchanged
+ * plane rows are reused instead of being fetched from VRAM
+ * again. Rendering is bit-exact either way.
+ * @param enable True to enable; false to disable.
+ * @return 0 on success; non-zero on error.
+ */
+int Vdp::setPlaneCache(bool enable)
+{
+	if (enable == (d->planeCache != nullptr)) {
+		// No change.
+		return 0;
+	}
+
+	if (enable) {
+		d->planeCache = new VdpPlaneCache();
+	} else {
+		delete d->planeCache;
+		d->planeCache = nullptr;
+	}
+	return 0;
+}
+
+/**
+ * Is the Mode 5 scroll plane row cache enabled?
+ * @return True if enabled; false if not.
+ */
+bool Vdp::isPlaneCacheEnabled(void) const
+{
+	return (d->planeCache != nullptr);
+}
+
+/**
+ * Get the scroll plane row cache statistics, and reset them.
+ * If the cache is disabled, all statistics are 0.
+ * @param stats Stats.
+ */
+void Vdp::takePlaneCacheStats(VdpPlaneCache::Stats *stats)
+{
+	if (d->planeCache) {
+		d->planeCache->takeStats(stats);
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
+/**
+ * Enable or disable the pattern cache.
+ * If enabled, pattern lines are decoded into normal and
+ * H-flipped versions when VRAM is written, instead of
+ * being H-flipped while rendering. Rendering is bit-exact
+ * either way.
+ * @param enable True to enable; false to disable.
+ * @return 0 on success; non-zero on error.
+ */
+int Vdp::setPatternCache(bool enable)
+{
+	if (enable == (d->patternCache != nullptr)) {
+		// No change.
+		return 0;
+	}
+
+	if (enable) {
+		// The new cache is decoded from VRAM on the next update.
+		d->patternCache = new VdpCache();
+	} else {
+		delete d->patternCache;
+		d->patternCache = nullptr;
+	}
+	return 0;
+}
+
+/**
+ * Is the pattern cache enabled?
+ * @return True if enabled; false if not.
+ */
+bool Vdp::isPatternCacheEnabled(void) const
+{
+	return (d->patternCache != nullptr);
+}
+
+/**
+ * Get the pattern cache statistics, and reset them.
+ * If the cache is disabled, all statistics are 0.
+ * @param stats Stats.
+ */
+void Vdp::takePatternCacheStats(VdpCache::Stats *stats)
+{
+	if (d->patternCache) {
+		d->patternCache->takeStats(stats);
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
+/**
+ * Enable or disable the bulk DMA paths.
+ * If enabled, contiguous 68K->VRAM transfers and
+ * VRAM fills are copied in spans instead of one word
+ * or byte at a time. The result is bit-exact either way.
+ * This is enabled by default.
+ * @param enable True to enable; false to disable.
+ * @return 0 on success; non-zero on error.
+ */
+int Vdp::setDmaBulk(bool enable)
+{
+	d->dmaBulk = enable;
+	return 0;
+}
+
+/**
+ * Are the bulk DMA paths enabled?
+ * @return True if enabled; false if not.
+ */
+bool Vdp::isDmaBulkEnabled(void) const
+{
+	return d->dmaBulk;
+}
+
+/**
+ * Enable or disable skip-unchanged-line rendering. (Mode 5)
+ * If enabled, lines whose inputs haven't changed since they
+ * were last rendered into the same framebuffer are skipped.
+ * NOTE: MD_Screen must not be modified outside of the VDP
+ * while this is enabled, e.g. by applying effects in place.
+ * @param enable True to enable; false to disable.
+ * @return 0 on success; non-zero on error.
+ */
+int Vdp::setLineSkip(bool enable)
+{
+	if (enable == (d->lineSkip != nullptr)) {
+		// No change.
+		return 0;
+	}
+
+	if (enable) {
+		d->lineSkip = new VdpLineSkip();
+	} else {
+		delete d->lineSkip;
+		d->lineSkip = nullptr;
+	}
+	return 0;
+}
+
+/**
+ * Is skip-unchanged-line rendering enabled?
+ * @return True if enabled; false if not.
+ */
+bool Vdp::isLineSkipEnabled(void) const
+{
+	return (d->lineSkip != nullptr);
+}
+
+/**
+ * Get the skip-unchanged-line statistics, and reset them.
+ * If line skipping is disabled, all statistics are 0.
+ * @param stats Stats.
+ */
+void Vdp::takeLineSkipStats(VdpLineSkip::Stats *stats)
+{
+	if (d->lineSkip) {
+		d->lineSkip->takeStats(stats);
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
 /**
  * Update VDP_Lines based on CPU and VDP mode settings.
  * @param resetCurrent If true, reset VDP_Lines.Display.Current and VDP_Lines.Visible.Current.
@@ -375,7 +585,7 @@ void Vdp::decrementHIntCounter(bool reload)
  * Save the VDP state. (MD mode)
  * @param zomg ZOMG savestate object to save to.
  */
-void Vdp::zomgSaveMD(LibZomg::Zomg *zomg) const
+void Vdp::zomgSaveMD(LibZomg::ZomgBase *zomg) const
 {
 	// NOTE: This is MD only.
 	// TODO: Assert if called when not emulating MD VDP.
@@ -386,7 +596,10 @@ void Vdp::zomgSaveMD(LibZomg::Zomg *zomg) const
 	zomg->saveVdpReg(d->VDP_Reg.reg, 24);
 
 	// Save the internal registers.
+	// NOTE: ctrl_reg is zeroed so fields that aren't
+	// implemented yet, e.g. dma_TBD, are deterministic.
 	Zomg_VDP_ctrl_16_t ctrl_reg;
+	memset(&ctrl_reg, 0, sizeof(ctrl_reg));
 	ctrl_reg.header		= ZOMG_VDPCTRL_16_HEADER;
 	ctrl_reg.ctrl_latch	= !!(d->VDP_Ctrl.ctrl_latch);
 	const uint8_t ctrl_mask = (d->is128KB() ? 0x07 : 0x03);
@@ -401,10 +614,6 @@ void Vdp::zomgSaveMD(LibZomg::Zomg *zomg) const
 	ctrl_reg.data_fifo_count = 0;
 	ctrl_reg.data_read_buffer = 0;
 
-	// Make sure reserved fields are zero.
-	ctrl_reg.reserved1 = 0;
-	ctrl_reg.reserved2 = 0;
-
 	zomg->saveVdpCtrl_16(&ctrl_reg);
 
 	// TODO: Save DMA status.
@@ -442,7 +651,7 @@ void Vdp::zomgSaveMD(LibZomg::Zomg *zomg) const
  * Restore the VDP state. (MD mode)
  * @param zomg ZOMG savestate object to restore from.
  */
-void Vdp::zomgRestoreMD(LibZomg::Zomg *zomg)
+void Vdp::zomgRestoreMD(LibZomg::ZomgBase *zomg)
 {
 	// NOTE: This is MD only.
 	// TODO: Assert if called when not emulating MD VDP.
@@ -485,6 +694,7 @@ void Vdp::zomgRestoreMD(LibZomg::Zomg *zomg)
 
 	// Load VRam.
 	zomg->loadVRam(d->VRam.u16, sizeof(d->VRam.u16), ZOMG_BYTEORDER_16H);
+	d->vramReloaded();
 
 	// Load CRam.
 	Zomg_CRam_t cram;
@@ -548,4 +758,70 @@ void Vdp::zomgRestoreMD(LibZomg::Zomg *zomg)
 	}
 }
 
+/**
+ * Internal VDP state for snapshots.
+ */
+struct VdpSnapshot_t {
+	int VDP_Int;
+	int HInt_Counter;
+	int DMAT_Length;
+	int DMAT_Type;
+	uint16_t status;
+	uint16_t testReg;
+	uint8_t DMA_Mode;
+	uint8_t data_latch;
+	uint8_t sprDotOverflow;
+	uint8_t reserved;
+};
+
+/**
+ * Save the internal VDP state to a snapshot.
+ * This includes state that isn't stored by zomgSaveMD(),
+ * e.g. pending interrupts and DMA status.
+ * @param zomg Snapshot to save to.
+ */
+void Vdp::snapshotSave(LibZomg::ZomgMem *zomg) const
+{
+	VdpSnapshot_t snap;
+	snap.VDP_Int		= d->VDP_Int;
+	snap.HInt_Counter	= d->HInt_Counter;
+	snap.DMAT_Length	= DMAT_Length;
+	snap.DMAT_Type		= d->DMAT_Type;
+	snap.status		= d->Reg_Status.read_raw();
+	snap.testReg		= d->testReg;
+	snap.DMA_Mode		= d->VDP_Ctrl.DMA_Mode;
+	snap.data_latch		= d->VDP_Ctrl.data_latch;
+	snap.sprDotOverflow	= d->sprDotOverflow;
+	snap.reserved		= 0;
+	zomg->saveBlock(LibZomg::ZomgMem::BLOCK_INT_VDP, &snap, sizeof(snap));
+}
+
+/**
+ * Restore the internal VDP state from a snapshot.
+ * This should be called after zomgRestoreMD().
+ * @param zomg Snapshot to restore from.
+ */
+void Vdp::snapshotRestore(LibZomg::ZomgMem *zomg)
+{
+	VdpSnapshot_t snap;
+	int ret = zomg->loadBlock(LibZomg::ZomgMem::BLOCK_INT_VDP, &snap, sizeof(snap));
+	if (ret != (int)sizeof(snap))
+		return;
+
+	d->VDP_Int		= snap.VDP_Int;
+	d->HInt_Counter		= snap.HInt_Counter;
+	DMAT_Length		= snap.DMAT_Length;
+	d->DMAT_Type		= (VdpPrivate::DMAT_Type_t)snap.DMAT_Type;
+	// zomgRestoreMD() modifies the status register
+	// while recaching sprites, so restore it here.
+	// The NTSC/PAL bit is kept as-is.
+	uint16_t status = d->Reg_Status.read_raw() & VdpStatus::VDP_STATUS_PAL;
+	status |= snap.status & ~VdpStatus::VDP_STATUS_PAL;
+	d->Reg_Status.write_raw(status);
+	d->testReg		= snap.testReg;
+	d->VDP_Ctrl.DMA_Mode	= snap.DMA_Mode;
+	d->VDP_Ctrl.data_latch	= snap.data_latch;
+	d->sprDotOverflow	= !!snap.sprDotOverflow;
+}
+
 }
@@ -34,19 +34,25 @@
 #include "VdpStatus.hpp"
 #include "../Util/MdFb.hpp"
 #include "VdpPalette.hpp"
+#include "VdpPlaneCache.hpp"
+#include "VdpCache.hpp"
+#include "VdpLineSkip.hpp"
 
 namespace LibZomg {
-	class Zomg;
+	class ZomgBase;
+	class ZomgMem;
 }
 
 namespace LibGens {
 
+class EmuContext;
+
 class VdpPrivate;
 class Vdp
 {
 	public:
 		// TODO: Remove MdFb.
-		Vdp(MdFb *fb = nullptr);
+		Vdp(MdFb *fb = nullptr, EmuContext *context = nullptr);
 		~Vdp();
 
 	protected:
@@ -92,6 +98,94 @@ class Vdp
 		// TODO: Make private, and add accessor/mutator?
 		VdpTypes::VdpEmuOptions_t options;
 
+		/**
+		 * Enable or disable the Mode 5 scroll plane row cache.
+		 * If enabled, nametable words and pattern lines for unchanged
+		 * plane rows are reused instead of being fetched from VRAM
+		 * again. Rendering is bit-exact either way.
+		 * @param enable True to enable; false to disable.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int setPlaneCache(bool enable);
+
+		/**
+		 * Is the Mode 5 scroll plane row cache enabled?
+		 * @return True if enabled; false if not.
+		 */
+		bool isPlaneCacheEnabled(void) const;
+
+		/**
+		 * Get the scroll plane row cache statistics, and reset them.
+		 * If the cache is disabled, all statistics are 0.
+		 * @param stats Stats.
+		 */
+		void takePlaneCacheStats(VdpPlaneCache::Stats *stats);
+
+		/**
+		 * Enable or disable the pattern cache.
+		 * If enabled, pattern lines are decoded into normal and
+		 * H-flipped versions when VRAM is written, instead of
+		 * being H-flipped while rendering. Rendering is bit-exact
+		 * either way.
+		 * @param enable True to enable; false to disable.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int setPatternCache(bool enable);
+
+		/**
+		 * Is the pattern cache enabled?
+		 * @return True if enabled; false if not.
+		 */
+		bool isPatternCacheEnabled(void) const;
+
+		/**
+		 * Get the pattern cache statistics, and reset them.
+		 * If the cache is disabled, all statistics are 0.
+		 * @param stats Stats.
+		 */
+		void takePatternCacheStats(VdpCache::Stats *stats);
+
+		/**
+		 * Enable or disable the bulk DMA paths.
+		 * If enabled, contiguous 68K->VRAM transfers and
+		 * VRAM fills are copied in spans instead of one word
+		 * or byte at a time. The result is bit-exact either way.
+		 * This is enabled by default.
+		 * @param enable True to enable; false to disable.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int setDmaBulk(bool enable);
+
+		/**
+		 * Are the bulk DMA paths enabled?
+		 * @return True if enabled; false if not.
+		 */
+		bool isDmaBulkEnabled(void) const;
+
+		/**
+		 * Enable or disable skip-unchanged-line rendering. (Mode 5)
+		 * If enabled, lines whose inputs haven't changed since they
+		 * were last rendered into the same framebuffer are skipped.
+		 * NOTE: MD_Screen must not be modified outside of the VDP
+		 * while this is enabled, e.g. by applying effects in place.
+		 * @param enable True to enable; false to disable.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int setLineSkip(bool enable);
+
+		/**
+		 * Is skip-unchanged-line rendering enabled?
+		 * @return True if enabled; false if not.
+		 */
+		bool isLineSkipEnabled(void) const;
+
+		/**
+		 * Get the skip-unchanged-line statistics, and reset them.
+		 * If line skipping is disabled, all statistics are 0.
+		 * @param stats Stats.
+		 */
+		void takeLineSkipStats(VdpLineSkip::Stats *stats);
+
 	public:
 		/** Main VDP functions. **/
 		uint8_t Int_Ack(void);
@@ -202,13 +296,28 @@ class Vdp
 		 * Save the VDP state. (MD mode)
 		 * @param zomg ZOMG savestate object to save to.
 		 */
-		void zomgSaveMD(LibZomg::Zomg *zomg) const;
+		void zomgSaveMD(LibZomg::ZomgBase *zomg) const;
 
 		/**
 		 * Restore the VDP state. (MD mode)
 		 * @param zomg ZOMG savestate object to restore from.
 		 */
-		void zomgRestoreMD(LibZomg::Zomg *zomg);
+		void zomgRestoreMD(LibZomg::ZomgBase *zomg);
+
+		/**
+		 * Save the internal VDP state to a snapshot.
+		 * This includes state that isn't stored by zomgSaveMD(),
+		 * e.g. pending interrupts and DMA status.
+		 * @param zomg Snapshot to save to.
+		 */
+		void snapshotSave(LibZomg::ZomgMem *zomg) const;
+
+		/**
+		 * Restore the internal VDP state from a snapshot.
+		 * This should be called after zomgRestoreMD().
+		 * @param zomg Snapshot to restore from.
+		 */
+		void snapshotRestore(LibZomg::ZomgMem *zomg);
 
 	public:
 		// TODO: Move to private class.
@@ -219,6 +328,15 @@ class Vdp
 		// passed to renderLine().
 		MdFb *MD_Screen;
 
+		/**
+		 * Set the MD framebuffer.
+		 * Rendering continues in the new framebuffer starting
+		 * with the next line. Image parameters are NOT copied;
+		 * use MdFb::copyParams() first if necessary.
+		 * @param fb New framebuffer. (Will be ref()'d.)
+		 */
+		void setMdScreen(MdFb *fb);
+
 		// VDP line counters.
 		// NOTE: Gens/GS currently uses 312 lines for PAL. It should use 313!
 		VdpTypes::VdpLines_t VDP_Lines;
@@ -31,14 +31,18 @@ using namespace LibGens::VdpTypes;
 namespace LibGens {
 
 VdpCache::VdpCache()
-	: dirty_idx(0)
+	: m_mode(CACHE_MODE_NONE)
+	, dirty_idx(0)
 {
 	// Clear the pattern cache and dirty flags.
+	memset(&m_stats, 0, sizeof(m_stats));
 	memset(&cache, 0, sizeof(cache));
 	memset(dirty_flags, 0, sizeof(dirty_flags));
 
 	// Dirty list can be left alone, since it's
 	// only checked if dirty_idx > 0.
+	// NOTE: The cache doesn't match VRAM yet, but m_mode is
+	// CACHE_MODE_NONE, so the first update will invalidate it.
 
 	// Initialize the Mode 4 lookup table.
 	init_m4_lut();
@@ -106,6 +110,38 @@ void VdpCache::invalidate(void)
 		dirty_flags[i] = 0xFF;
 		dirty_list[i] = i;
 	}
+	m_stats.invalidations++;
+}
+
+/**
+ * Notify the cache of a VRAM write to a range of addresses.
+ * @param address First VRAM address.
+ * @param len Length, in bytes. Must not wrap around the end of VRAM.
+ */
+void VdpCache::vramWriteRange(uint32_t address, uint32_t len)
+{
+	if (len == 0)
+		return;
+
+	// TODO: 128 KB support.
+	const uint32_t end = address + len - 1;	// inclusive
+	for (uint32_t tile = (address >> 5); tile <= (end >> 5); tile++) {
+		// Only the first and last tiles may be partial.
+		const uint32_t tile_addr = (tile << 5);
+		const unsigned int first = (address > tile_addr ? ((address - tile_addr) >> 2) : 0);
+		const unsigned int last = (end < tile_addr + 31 ? ((end - tile_addr) >> 2) : 7);
+		markDirty(tile & 0x7FF, (0xFF >> (7 - last)) & (0xFF << first));
+	}
+}
+
+/**
+ * Get the cache statistics, and reset them.
+ * @param stats Stats.
+ */
+void VdpCache::takeStats(Stats *stats)
+{
+	*stats = m_stats;
+	memset(&m_stats, 0, sizeof(m_stats));
 }
 
 /**
@@ -142,12 +178,50 @@ inline uint32_t VdpCache::H_flip(uint32_t src)
 	return src;
 }
 
+/**
+ * Convert a pattern line between VRAM order and natural order.
+ * Natural order has the leftmost pixel in the high nybble.
+ * VRAM order is a 32-bit read from VdpTypes::VRam_t.
+ * (This is its own inverse.)
+ * @param src Source pattern line.
+ * @return Converted pattern line.
+ */
+inline uint32_t VdpCache::native_order(uint32_t src)
+{
+#if SYS_BYTEORDER == SYS_LIL_ENDIAN
+	// VRAM is stored as host-endian 16-bit words,
+	// so the two words are swapped in a 32-bit read.
+	return (src << 16) | (src >> 16);
+#else /* SYS_BYTEORDER == SYS_BIG_ENDIAN */
+	return src;
+#endif
+}
+
+/**
+ * Update a pattern line in both H-flip caches.
+ * @param tile Tile number.
+ * @param y Line number.
+ * @param src Pattern line, in natural order.
+ */
+inline void VdpCache::store_line(unsigned int tile, int y, uint32_t src)
+{
+	cache.x8[0][tile][y] = native_order(src);
+	cache.x8[1][tile][y] = native_order(H_flip(src));
+	m_stats.lines++;
+}
+
 /**
  * Update the pattern cache. (Mode 4)
  * @param vram VRAM source data.
  */
 void VdpCache::update_m4(const VRam_t *vram)
 {
+	if (m_mode != CACHE_MODE_M4) {
+		// Cache has Mode 5 patterns.
+		invalidate();
+		m_mode = CACHE_MODE_M4;
+	}
+
 	for (int i = dirty_idx - 1; i >= 0; i--) {
 		// Get the tile VRAM address.
 		uint16_t tile = dirty_list[i];
@@ -159,14 +233,7 @@ void VdpCache::update_m4(const VRam_t *vram)
 				// Line is dirty.
 				// TODO: Combine with update_m5, since this function is
 				// nearly identical except for the pattern retrieval code?
-				uint32_t src = m4_lookup(vram_src[y*2], vram_src[y*2+1]);
-
-				// Update the normal cache.
-				cache.x8[0][tile][y] = src;
-
-				// Update the H-flip cache.
-				src = H_flip(src);
-				cache.x8[1][tile][y] = src;
+				store_line(tile, y, m4_lookup(vram_src[y*2], vram_src[y*2+1]));
 			}
 		}
 
@@ -184,6 +251,12 @@ void VdpCache::update_m4(const VRam_t *vram)
  */
 void VdpCache::update_m5(const VRam_t *vram)
 {
+	if (m_mode != CACHE_MODE_M5) {
+		// Cache has Mode 4 patterns.
+		invalidate();
+		m_mode = CACHE_MODE_M5;
+	}
+
 	for (int i = dirty_idx - 1; i >= 0; i--) {
 		// Get the tile VRAM address.
 		// Note that we're assuming 8x8 tiles.
@@ -197,18 +270,7 @@ void VdpCache::update_m5(const VRam_t *vram)
 				// Line is dirty.
 				// TODO: Combine with update_m4, since this function is
 				// nearly identical except for the pattern retrieval code?
-				uint32_t src = vram_src[y];
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-				// Rotate the source data into the correct order.
-				src = (src << 16) | (src >> 16);
-#endif
-
-				// Update the normal cache.
-				cache.x8[0][tile][y] = src;
-
-				// Update the H-flip cache.
-				src = H_flip(src);
-				cache.x8[1][tile][y] = src;
+				store_line(tile, y, native_order(vram_src[y]));
 			}
 		}
 
@@ -23,6 +23,11 @@
 // with the various 'flip' options, e.g. Hflip, Vflip, and Hflip+Vflip.
 // In addition, a lookup table is used to convert Mode 4 planar patterns
 // to Mode 5 packed patterns.
+//
+// Cached pattern lines are stored in the same format as the Mode 5
+// renderer reads from VRAM, so an H-flipped pattern line can be drawn
+// as a normal pattern line. VRAM writes mark the affected pattern
+// lines as dirty; they're decoded on the next update_m4()/update_m5().
 
 #ifndef __LIBGENS_MD_VDPCACHE_HPP__
 #define __LIBGENS_MD_VDPCACHE_HPP__
@@ -40,10 +45,9 @@ namespace VdpTypes {
 }
 
 class VdpCache {
-	// NOTE: This class isn't currently in use.
-	private:
+	public:
 		VdpCache();
-		~VdpCache();
+		~VdpCache() { }
 
 	private:
 		// Q_DISABLE_COPY() equivalent.
@@ -59,6 +63,19 @@ class VdpCache {
 		 */
 		void invalidate(void);
 
+		/**
+		 * Notify the cache of a VRAM write.
+		 * @param address VRAM address.
+		 */
+		inline void vramWrite(uint32_t address);
+
+		/**
+		 * Notify the cache of a VRAM write to a range of addresses.
+		 * @param address First VRAM address.
+		 * @param len Length, in bytes. Must not wrap around the end of VRAM.
+		 */
+		void vramWriteRange(uint32_t address, uint32_t len);
+
 		/**
 		 * Update the pattern cache. (Mode 4)
 		 * @param vram VRAM source data.
@@ -113,6 +130,30 @@ class VdpCache {
 		 */
 		inline uint32_t pattern_line_m5_spr_8x16(uint16_t attr, int y);
 
+		/**
+		 * Get a pattern line by VRAM address.
+		 * Interlaced mode doesn't need special handling,
+		 * since the address already includes the line number.
+		 * @param hflip If true, get the H-flipped pattern line.
+		 * @param address VRAM address of the pattern line.
+		 * @return Pattern line.
+		 */
+		inline uint32_t pattern_line(bool hflip, uint32_t address) const;
+
+		/**
+		 * Cache statistics.
+		 */
+		struct Stats {
+			uint64_t lines;		// Pattern lines decoded.
+			uint64_t invalidations;	// Full cache invalidations.
+		};
+
+		/**
+		 * Get the cache statistics, and reset them.
+		 * @param stats Stats.
+		 */
+		void takeStats(Stats *stats);
+
 	protected:
 		/**
 		 * Mode 4 lookup table.
@@ -145,12 +186,50 @@ class VdpCache {
 		 */
 		static inline uint32_t H_flip(uint32_t src);
 
+		/**
+		 * Mark pattern lines as dirty.
+		 * @param tile Tile number.
+		 * @param lines Bitfield of dirty lines.
+		 */
+		inline void markDirty(unsigned int tile, uint8_t lines);
+
+		/**
+		 * Convert a pattern line between VRAM order and natural order.
+		 * Natural order has the leftmost pixel in the high nybble.
+		 * VRAM order is a 32-bit read from VdpTypes::VRam_t.
+		 * (This is its own inverse.)
+		 * @param src Source pattern line.
+		 * @return Converted pattern line.
+		 */
+		static inline uint32_t native_order(uint32_t src);
+
+		/**
+		 * Update a pattern line in both H-flip caches.
+		 * @param tile Tile number.
+		 * @param y Line number.
+		 * @param src Pattern line, in natural order.
+		 */
+		inline void store_line(unsigned int tile, int y, uint32_t src);
+
+		/**
+		 * Decoded VDP mode.
+		 * Switching between update_m4() and update_m5()
+		 * invalidates the cache.
+		 */
+		enum CacheMode {
+			CACHE_MODE_NONE = 0,
+			CACHE_MODE_M4,
+			CACHE_MODE_M5,
+		};
+		CacheMode m_mode;
+
+		// Statistics.
+		Stats m_stats;
+
 		/**
 		 * Pattern cache for Mode 4 and Mode 5.
-		 * Internal data is packed Mode 5 format.
-		 *
-		 * TODO: Store the data "reversed"?
-		 * i.e. left pixel is low nybble for no-flip
+		 * Internal data is packed Mode 5 format, in VRAM order.
+		 * (See native_order().)
 		 */
 		union {
 			/**
@@ -186,6 +265,46 @@ class VdpCache {
 		unsigned int dirty_idx;
 };
 
+/**
+ * Notify the cache of a VRAM write.
+ * @param address VRAM address.
+ */
+inline void VdpCache::vramWrite(uint32_t address)
+{
+	// TODO: 128 KB support.
+	markDirty((address >> 5) & 0x7FF, (1 << ((address >> 2) & 7)));
+}
+
+/**
+ * Mark pattern lines as dirty.
+ * @param tile Tile number.
+ * @param lines Bitfield of dirty lines.
+ */
+inline void VdpCache::markDirty(unsigned int tile, uint8_t lines)
+{
+	if (!dirty_flags[tile]) {
+		// Tile wasn't dirty yet.
+		// NOTE: If the cache was invalidated, all tiles
+		// are dirty, so the list can't overflow.
+		dirty_list[dirty_idx++] = tile;
+	}
+	dirty_flags[tile] |= lines;
+}
+
+/**
+ * Get a pattern line by VRAM address.
+ * Interlaced mode doesn't need special handling,
+ * since the address already includes the line number.
+ * @param hflip If true, get the H-flipped pattern line.
+ * @param address VRAM address of the pattern line.
+ * @return Pattern line.
+ */
+inline uint32_t VdpCache::pattern_line(bool hflip, uint32_t address) const
+{
+	// TODO: 128 KB support.
+	return cache.d[hflip][(address & 0xFFFF) >> 2];
+}
+
 /**
  * Get a pattern line. (Mode 4, nametable, 8x8 cell)
  * @param attr Nametable attribute word.
@@ -177,6 +177,7 @@ int Vdp::dbg_writeVRam_16(uint32_t address, const uint16_t *vram, int length)
 	}
 
 	memcpy(&d->VRam.u16[address>>1], vram, length);
+	d->vramReloaded();
 
 	// Check if the VRAM write overlaps the Sprite Attribute Table.
 	// TODO: Optimize this into a few calculations and a memcpy.
@@ -240,6 +241,7 @@ int Vdp::dbg_writeVSRam_16(uint8_t address, const uint16_t *vsram, int length)
 	}
 
 	memcpy(&d->VSRam.u16[address>>1], vsram, length);
+	d->vsramGen++;
 	return 0;
 }
 
@@ -33,6 +33,13 @@
 #include "cpu/M68K_Mem.hpp"
 #include "Cartridge/RomCartridgeMD.hpp"
 
+// Emulation Context.
+#include "EmuContext/EmuContext.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstring>
+
 namespace LibGens {
 
 /** VdpPrivate **/
@@ -69,19 +76,37 @@ void VdpPrivate::DMA_Fill(uint16_t data)
 	// TODO: Do DMA FILL line-by-line instead of all at once.
 	const uint8_t fill_hi = (data >> 8) & 0xFF;
 	switch (VDP_Ctrl.code & VdpTypes::CD_DEST_MODE_MASK) {
-		case VdpTypes::CD_DEST_VRAM_WRITE:
+		case VdpTypes::CD_DEST_VRAM_WRITE: {
 			// Write to VRAM.
+			// NOTE: length == 0 is 65536 bytes.
+			const uint32_t len = (length != 0 ? length : 0x10000);
+			if (dmaBulk && VRam_Mask == 0xFFFF && VDP_Reg.m5.Auto_Inc == 1 &&
+			    !(address & 1) && !(len & 1) && (address + len) <= 0x10000)
+			{
+				// Contiguous fill of whole words.
+				// Each word is written in two steps, but the result
+				// is the same as filling both bytes at once.
+				DMA_Fill_VRam_Span(address, len, fill_hi);
+				address += len;
+				break;
+			}
+
 			do {
 				// NOTE: DMA FILL writes to the adjacent byte.
-				VRam.u8[address ^ 1 ^ U16DATA_U8_INVERT] = fill_hi;
+				if (VRam.u8[address ^ 1 ^ U16DATA_U8_INVERT] != fill_hi) {
+					VRam.u8[address ^ 1 ^ U16DATA_U8_INVERT] = fill_hi;
+					vramChanged(address);
+				}
 				if ((address & Spr_Tbl_Mask) == Spr_Tbl_Addr) {
 					// Sprite Attribute Table.
 					SprAttrTbl_m5.b[(address & ~Spr_Tbl_Mask) ^ U16DATA_U8_INVERT] = fill_hi;
+					vramGen++;
 				}
 				address += VDP_Reg.m5.Auto_Inc;
 				address &= VRam_Mask;
 			} while (--length != 0);
 			break;
+		}
 
 		case VdpTypes::CD_DEST_CRAM_WRITE:
 			// Write to CRAM.
@@ -101,6 +126,7 @@ void VdpPrivate::DMA_Fill(uint16_t data)
 				address += VDP_Reg.m5.Auto_Inc;
 				address &= VRam_Mask;
 			} while (--length != 0);
+			vsramGen++;
 			break;
 
 		default:
@@ -119,6 +145,158 @@ void VdpPrivate::DMA_Fill(uint16_t data)
 	inc_DMA_Src_Adr(q->DMAT_Length);
 }
 
+/**
+ * Write a span of words to VRAM for DMA.
+ * Handles cache invalidation and the Sprite Attribute Table cache.
+ * @param src Source words. (host-endian)
+ * @param address Even VRAM address.
+ * @param words Number of words. Must not wrap around the end of VRAM.
+ */
+void VdpPrivate::DMA_Write_VRam_Span(const uint16_t *src, uint32_t address, unsigned int words)
+{
+	assert(!(address & 1));
+	assert(address + (words * 2) <= 0x10000);
+
+	// Only the words that actually changed are marked as changed.
+	uint16_t *const dest = &VRam.u16[address >> 1];
+	unsigned int first = 0, last = words;
+	while (first < words && dest[first] == src[first]) {
+		first++;
+	}
+	if (first < words) {
+		while (dest[last - 1] == src[last - 1]) {
+			last--;
+		}
+		memcpy(&dest[first], &src[first], (last - first) * 2);
+		vramChangedRange(address + (first * 2), (last - first) * 2);
+	}
+
+	// Check if the span overlaps the Sprite Attribute Table.
+	// NOTE: The SAT cache may differ from VRAM
+	// if the SAT address was changed.
+	const uint32_t sat_size = ((~Spr_Tbl_Mask & 0xFFFF) + 1);
+	const uint32_t sat_start = (address > Spr_Tbl_Addr ? address : Spr_Tbl_Addr);
+	const uint32_t span_end = address + (words * 2);
+	const uint32_t sat_end = (span_end < Spr_Tbl_Addr + sat_size ? span_end : Spr_Tbl_Addr + sat_size);
+	if (sat_start < sat_end) {
+		uint8_t *const sat = &SprAttrTbl_m5.b[sat_start - Spr_Tbl_Addr];
+		const uint8_t *const sat_src = reinterpret_cast<const uint8_t*>(src) + (sat_start - address);
+		if (memcmp(sat, sat_src, sat_end - sat_start) != 0) {
+			memcpy(sat, sat_src, sat_end - sat_start);
+			vramGen++;
+		}
+	}
+}
+
+/**
+ * Fill a span of VRAM for DMA FILL.
+ * Handles cache invalidation and the Sprite Attribute Table cache.
+ * @param address Even VRAM address.
+ * @param len Even length, in bytes. Must not wrap around the end of VRAM.
+ * @param fill Fill byte.
+ */
+void VdpPrivate::DMA_Fill_VRam_Span(uint32_t address, uint32_t len, uint8_t fill)
+{
+	assert(!(address & 1) && !(len & 1));
+	assert(address + len <= 0x10000);
+
+	// Only the words that actually changed are marked as changed.
+	// NOTE: Whole words are filled, so byteswapping doesn't matter.
+	uint8_t *const dest = &VRam.u8[address];
+	uint32_t first = 0, last = len;
+	while (first < len && dest[first] == fill) {
+		first++;
+	}
+	if (first < len) {
+		while (dest[last - 1] == fill) {
+			last--;
+		}
+		// Round to whole words.
+		first &= ~1;
+		last = (last + 1) & ~1;
+		memset(&dest[first], fill, last - first);
+		vramChangedRange(address + first, last - first);
+	}
+
+	// Check if the span overlaps the Sprite Attribute Table.
+	const uint32_t sat_size = ((~Spr_Tbl_Mask & 0xFFFF) + 1);
+	const uint32_t sat_start = (address > Spr_Tbl_Addr ? address : Spr_Tbl_Addr);
+	const uint32_t sat_end = (address + len < Spr_Tbl_Addr + sat_size ? address + len : Spr_Tbl_Addr + sat_size);
+	if (sat_start < sat_end) {
+		memset(&SprAttrTbl_m5.b[sat_start - Spr_Tbl_Addr], fill, sat_end - sat_start);
+		vramGen++;
+	}
+}
+
+/**
+ * Mem-to-VRAM DMA: Copy a contiguous span of words, if possible.
+ * Requires auto-increment 2, an even VRAM address,
+ * and a source that can be accessed directly.
+ * @param src_component Source component.
+ * @param src_word_address Source word address.
+ * @param src_base_address Source base address, for 128 KB wrapping.
+ * @param length Number of words left.
+ * @return Number of words copied. (0 if the word-by-word path must be used)
+ */
+template<VdpPrivate::DMA_Src_t src_component>
+inline unsigned int VdpPrivate::T_DMA_Bulk_VRam(uint16_t src_word_address,
+	unsigned int src_base_address, unsigned int length)
+{
+	// TODO: 128 KB support.
+	const uint32_t address = VDP_Ctrl.address & VRam_Mask;
+	if (!dmaBulk || VRam_Mask != 0xFFFF ||
+	    VDP_Reg.m5.Auto_Inc != 2 || (address & 1))
+	{
+		// Bulk copy isn't possible.
+		return 0;
+	}
+
+	// Words left before the end of VRAM.
+	unsigned int words = ((0x10000 - address) >> 1);
+
+	// Get a direct pointer to the source data.
+	// Both ROM and 68K RAM are stored as host-endian words,
+	// same as VRAM, so no byteswapping is needed.
+	M68K_Mem *const m68kMem = context->m_m68kMem;
+	const uint16_t *src;
+	unsigned int src_words;
+	switch (src_component) {
+		case DMA_SRC_ROM: {
+			// NOTE: Mapper and SRAM pages can't be accessed directly.
+			const uint32_t req_addr = ((src_word_address | src_base_address) << 1);
+			const uint8_t *const page = m68kMem->m_romCartridge->readPagePtr(req_addr);
+			if (!page)
+				return 0;
+			src = reinterpret_cast<const uint16_t*>(page + (req_addr & 0xFFFF));
+			// Words left before the end of the 64 KB page.
+			// This also handles 128 KB wrapping.
+			src_words = ((0x10000 - (req_addr & 0xFFFF)) >> 1);
+			break;
+		}
+
+		case DMA_SRC_M68K_RAM: {
+			// 68K RAM is mirrored every 64 KB.
+			const unsigned int idx = (src_word_address & 0x7FFF);
+			src = &m68kMem->Ram_68k.u16[idx];
+			// Words left before the end of 68K RAM.
+			src_words = (0x8000 - idx);
+			break;
+		}
+
+		default:
+			return 0;
+	}
+
+	if (words > src_words)
+		words = src_words;
+	if (words > length)
+		words = length;
+
+	DMA_Write_VRam_Span(src, address, words);
+	VDP_Ctrl.address = ((address + (words * 2)) & VRam_Mask);
+	return words;
+}
+
 /**
  * Mem-to-DMA loop.
  * @param src_component Source component.
@@ -127,6 +305,9 @@ void VdpPrivate::DMA_Fill(uint16_t data)
 template<VdpPrivate::DMA_Src_t src_component, VdpPrivate::DMA_Dest_t dest_component>
 inline void VdpPrivate::T_DMA_Loop(void)
 {
+	// M68K memory map.
+	M68K_Mem *const m68kMem = context->m_m68kMem;
+
 	// Get the DMA source address.
 	// NOTE: DMA_Src_Adr is the source address / 2.
 	uint32_t src_address = DMA_Src_Adr() * 2;
@@ -211,7 +392,18 @@ inline void VdpPrivate::T_DMA_Loop(void)
 	unsigned int src_base_address = ((src_address & 0xFE0000) >> 1);
 
 	// TODO: Do DMA MEM-to-VRAM line-by-line instead of all at once.
-	do {
+	while (length > 0) {
+		if (dest_component == DMA_DEST_VRAM) {
+			// Copy a contiguous span directly, if possible.
+			const unsigned int words = T_DMA_Bulk_VRam<src_component>(
+				src_word_address, src_base_address, length);
+			if (words > 0) {
+				src_word_address += words;
+				length -= words;
+				continue;
+			}
+		}
+
 		// Get the word.
 		uint16_t w;
 		switch (src_component) {
@@ -219,13 +411,13 @@ inline void VdpPrivate::T_DMA_Loop(void)
 				// TODO: Banking is done in 512 KB segments.
 				// Optimize this by getting a pointer to the segment?
 				const uint32_t req_addr = ((src_word_address | src_base_address) << 1);
-				w = M68K_Mem::ms_RomCartridge->readWord(req_addr);
+				w = m68kMem->m_romCartridge->readWord(req_addr);
 				break;
 			}
 
 			case DMA_SRC_M68K_RAM:
-				//w = M68K_Mem::Ram_68k.u16[src_word_address];
-				w = Ram_68k.u16[src_word_address];
+				// 68K RAM is mirrored every 64 KB.
+				w = m68kMem->Ram_68k.u16[src_word_address & 0x7FFF];
 				break;
 
 			// TODO: Port to LibGens.
@@ -275,7 +467,8 @@ inline void VdpPrivate::T_DMA_Loop(void)
 		// Write the word.
 		// TODO: Might not work if Auto_Inc is odd...
 		vdpDataWrite_int(w);
-	} while (--length != 0);
+		length--;
+	}
 
 	// DMA is done.
 	VDP_Ctrl.code &= ~VdpTypes::CD_DMA_ENABLE;
@@ -299,7 +492,7 @@ inline void VdpPrivate::T_DMA_Loop(void)
 
 	// Update DMA.
 	int cycles = q->updateDMA();
-	M68K::ReleaseCycles(cycles);
+	context->m_m68k->releaseCycles(cycles);
 }
 
 /**
@@ -368,10 +561,14 @@ void VdpPrivate::processDmaCtrlWrite(void)
 		// TODO: Do DMA COPY line-by-line instead of all at once.
 		do {
 			uint8_t src = VRam.u8[src_address];
-			VRam.u8[dest_address] = src;
+			if (VRam.u8[dest_address] != src) {
+				VRam.u8[dest_address] = src;
+				vramChanged(dest_address);
+			}
 			if ((dest_address & Spr_Tbl_Mask) == Spr_Tbl_Addr) {
 				// Sprite Attribute Table.
 				SprAttrTbl_m5.b[(dest_address & ~Spr_Tbl_Mask) ^ U16DATA_U8_INVERT] = src;
+				vramGen++;
 			}
 
 			// Increment the addresses.
@@ -607,7 +804,7 @@ unsigned int Vdp::updateDMA(void)
 	}
 
 	// Cycles elapsed is based on M68K cycles per line.
-	unsigned int cycles = M68K_Mem::CPL_M68K;
+	unsigned int cycles = d->context->m_m68kMem->CPL_M68K;
 
 	// DMA timing table.
 	static const uint8_t DMA_Timing_Table[4][4] = {
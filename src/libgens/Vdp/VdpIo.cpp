@@ -39,26 +39,6 @@
 // Emulation Context.
 #include "EmuContext/EmuContext.hpp"
 
-// C wrapper functions for Starscream.
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-uint8_t VDP_Int_Ack(void)
-{
-	// TODO: This won't work with multiple contexts...
-	LibGens::EmuContext *instance = LibGens::EmuContext::Instance();
-	if (instance != nullptr)
-		return instance->m_vdp->Int_Ack();
-
-	// TODO: What should we return here?
-	return 0;
-}
-
-#ifdef __cplusplus
-}
-#endif
-
 namespace LibGens {
 
 /**
@@ -95,22 +75,27 @@ void Vdp::updateIRQLine(int interrupt)
 {
 	// 'interrupt' contains a new interrupt value.
 	d->VDP_Int |= interrupt;
+	M68K *const m68k = (d->context ? d->context->m_m68k : nullptr);
+	if (!m68k) {
+		// No M68K. Can't trigger any interrupts.
+		return;
+	}
 
 	// TODO: HBlank interrupt should take priority over VBlank interrupt.
 	if ((d->VDP_Reg.m5.Set2 & VDP_REG_M5_SET2_IE0) && (d->VDP_Int & 0x08)) {
 		// VBlank interrupt.
-		M68K::Interrupt(6, -1);
+		m68k->interrupt(6, -1);
 		return;
 	} else if ((d->VDP_Reg.m5.Set1 & VDP_REG_M5_SET1_IE1) && (d->VDP_Int & 0x04)) {
 		// HBlank interrupt.
-		M68K::Interrupt(4, -1);
+		m68k->interrupt(4, -1);
 		return;
 	}
 
 	// No VDP interrupts.
 	// TODO: Move to M68K class.
 #ifdef GENS_ENABLE_EMULATION
-	M68K::Interrupt(0, -1);
+	m68k->interrupt(0, -1);
 	//main68k_context.interrupts[0] &= 0xF0;
 #endif /* GENS_ENABLE_EMULATION */
 }
@@ -121,9 +106,13 @@ void Vdp::updateIRQLine(int interrupt)
  */
 uint8_t Vdp::readHCounter(void)
 {
-	unsigned int odo_68K = M68K::ReadOdometer();
-	odo_68K -= (M68K_Mem::Cycles_M68K - M68K_Mem::CPL_M68K);
-	odo_68K &= 0x1FF;
+	unsigned int odo_68K = 0;
+	if (d->context && d->context->m_m68k) {
+		const M68K_Mem *const m68kMem = d->context->m_m68kMem;
+		odo_68K = d->context->m_m68k->readOdometer();
+		odo_68K -= (m68kMem->Cycles_M68K - m68kMem->CPL_M68K);
+		odo_68K &= 0x1FF;
+	}
 
 	// H_Counter_Table[][0] == H32.
 	// H_Counter_Table[][1] == H40.
@@ -140,9 +129,13 @@ uint8_t Vdp::readHCounter(void)
  */
 uint8_t Vdp::readVCounter(void)
 {
-	unsigned int odo_68K = M68K::ReadOdometer();
-	odo_68K -= (M68K_Mem::Cycles_M68K - M68K_Mem::CPL_M68K);
-	odo_68K &= 0x1FF;
+	unsigned int odo_68K = 0;
+	if (d->context && d->context->m_m68k) {
+		const M68K_Mem *const m68kMem = d->context->m_m68kMem;
+		odo_68K = d->context->m_m68k->readOdometer();
+		odo_68K -= (m68kMem->Cycles_M68K - m68kMem->CPL_M68K);
+		odo_68K &= 0x1FF;
+	}
 
 	unsigned int H_Counter;
 	uint8_t bl, bh;		// TODO: Figure out what this actually means.
@@ -382,10 +375,19 @@ void VdpPrivate::vdpDataWrite_int(uint16_t data)
 				// Data is written normally.
 				tmp_data = data;
 			}
-			VRam.u16[address>>1] = tmp_data;
+			if (VRam.u16[address>>1] != tmp_data) {
+				VRam.u16[address>>1] = tmp_data;
+				vramChanged(address);
+			}
 			if ((address & Spr_Tbl_Mask) == Spr_Tbl_Addr) {
 				// Sprite Attribute Table.
-				SprAttrTbl_m5.w[(address & ~Spr_Tbl_Mask) >> 1] = tmp_data;
+				// NOTE: The SAT cache may differ from VRAM
+				// if the SAT address was changed.
+				uint16_t *const sat = &SprAttrTbl_m5.w[(address & ~Spr_Tbl_Mask) >> 1];
+				if (*sat != tmp_data) {
+					*sat = tmp_data;
+					vramGen++;
+				}
 			}
 			break;
 		}
@@ -418,7 +420,10 @@ void VdpPrivate::vdpDataWrite_int(uint16_t data)
 			// VSRam is 80 bytes. (40 words)
 			// TODO: VSRam is 80 bytes, but we're allowing a maximum of 128 bytes here...
 			// TODO: Mask off high bits? (Only 10/11 bits are present.)
-			VSRam.u16[(address & 0x7E) >> 1] = data;
+			if (VSRam.u16[(address & 0x7E) >> 1] != data) {
+				VSRam.u16[(address & 0x7E) >> 1] = data;
+				vsramGen++;
+			}
 			break;
 
 		default:
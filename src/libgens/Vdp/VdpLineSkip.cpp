@@ -0,0 +1,128 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VdpLineSkip.cpp: VDP skip-unchanged-line state.                         *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "VdpLineSkip.hpp"
+#include "../Util/MdFb.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+namespace LibGens {
+
+VdpLineSkip::VdpLineSkip()
+	: m_curSlot(nullptr)
+	, m_useCounter(0)
+{
+	memset(&stats, 0, sizeof(stats));
+	for (int i = 0; i < FB_SLOTS; i++) {
+		m_slots[i].fb = nullptr;
+		m_slots[i].lastUse = 0;
+		invalidateSlot(&m_slots[i]);
+	}
+}
+
+VdpLineSkip::~VdpLineSkip()
+{
+	for (int i = 0; i < FB_SLOTS; i++) {
+		if (m_slots[i].fb) {
+			m_slots[i].fb->unref();
+		}
+	}
+}
+
+/**
+ * Invalidate all line records in a slot.
+ * @param slot Slot.
+ */
+void VdpLineSkip::invalidateSlot(Slot *slot)
+{
+	for (int i = 0; i < MAX_LINES; i++) {
+		slot->lines[i].valid = false;
+	}
+}
+
+/**
+ * Get the line record for a framebuffer line.
+ * If the framebuffer isn't tracked yet, the least
+ * recently used slot is reassigned to it.
+ * @param fb Framebuffer.
+ * @param line Line number in the framebuffer.
+ * @return Line record, or nullptr if the line is out of range.
+ */
+VdpLineSkip::Line *VdpLineSkip::line(MdFb *fb, int line)
+{
+	if (line < 0 || line >= MAX_LINES || line >= fb->numLines())
+		return nullptr;
+
+	if (!m_curSlot || m_curSlot->fb != fb) {
+		// Find the slot for this framebuffer.
+		Slot *slot = nullptr;
+		Slot *lru = &m_slots[0];
+		for (int i = 0; i < FB_SLOTS; i++) {
+			if (m_slots[i].fb == fb) {
+				slot = &m_slots[i];
+				break;
+			}
+			if (m_slots[i].lastUse < lru->lastUse) {
+				lru = &m_slots[i];
+			}
+		}
+
+		if (!slot) {
+			// Reassign the least recently used slot.
+			slot = lru;
+			if (slot->fb) {
+				slot->fb->unref();
+			}
+			slot->fb = fb->ref();
+			invalidateSlot(slot);
+		}
+
+		slot->lastUse = ++m_useCounter;
+		m_curSlot = slot;
+	}
+
+	return &m_curSlot->lines[line];
+}
+
+/**
+ * Invalidate all line records.
+ * This must be called if a framebuffer is modified
+ * outside of VdpPrivate::renderLine_m5().
+ */
+void VdpLineSkip::invalidate(void)
+{
+	for (int i = 0; i < FB_SLOTS; i++) {
+		invalidateSlot(&m_slots[i]);
+	}
+}
+
+/**
+ * Get the statistics, and reset them.
+ * @param stats Stats.
+ */
+void VdpLineSkip::takeStats(Stats *stats)
+{
+	*stats = this->stats;
+	memset(&this->stats, 0, sizeof(this->stats));
+}
+
+}
@@ -0,0 +1,168 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VdpLineSkip.hpp: VDP skip-unchanged-line state.                         *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Static screens (menus, paused games) render the same lines every frame.
+// If none of a line's inputs have changed since the line was last drawn
+// into the same framebuffer, the line can be left as-is.
+//
+// A line's inputs are tracked with generation counters that are only
+// incremented if the contents actually change:
+// - VRAM, including the Sprite Attribute Table cache.
+// - VSRAM.
+// - VDP registers 0-18. (19-23 are only used for DMA.)
+// - The active palette.
+// If none of the counters have changed since the line was drawn, then
+// nothing has changed in between, so other derived state is unchanged.
+// The sprite line cache is filled in one line before it's used, so the
+// counters are also saved when the sprite line cache is updated.
+
+#ifndef __LIBGENS_MD_VDPLINESKIP_HPP__
+#define __LIBGENS_MD_VDPLINESKIP_HPP__
+
+// C includes.
+#include <stdint.h>
+
+#include "VdpTypes.hpp"
+
+namespace LibGens {
+
+class MdFb;
+
+class VdpLineSkip
+{
+	public:
+		VdpLineSkip();
+		~VdpLineSkip();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VdpLineSkip(const VdpLineSkip &);
+		VdpLineSkip &operator=(const VdpLineSkip &);
+
+	public:
+		// Number of framebuffers to track.
+		// Triple-buffered frontends rotate between three.
+		static const int FB_SLOTS = 4;
+		// Maximum number of lines per framebuffer.
+		static const int MAX_LINES = 240;
+
+		/**
+		 * Sprite line cache signature.
+		 * Saved when a sprite line cache is updated, since
+		 * that happens one line before the cache is used.
+		 */
+		struct SprSig {
+			uint32_t vramGen;	// VRAM generation.
+			uint32_t regGen;	// Register generation.
+			int32_t line;		// Line number, adjusted for IM2.
+			uint32_t spriteLimits;	// Sprite limits option.
+		};
+
+		/**
+		 * Line signature.
+		 * This must be cleared with memset() before
+		 * filling it in, since it's compared with memcmp().
+		 */
+		struct Sig {
+			uint32_t vramGen;	// VRAM generation.
+			uint32_t vsramGen;	// VSRAM generation.
+			uint32_t regGen;	// Register generation.
+			uint32_t palGen;	// Active palette generation.
+			int vdpLine;		// VDP line number.
+			unsigned int layers;	// VDP_Layers.
+			uint16_t status;	// Status register: PAL and ODD bits.
+			uint8_t bpp;		// Framebuffer color depth.
+			uint8_t sprDotOverflow;	// Sprite dot overflow from the previous line.
+			SprSig spr[2];		// Sprite line cache signatures.
+			VdpTypes::VdpEmuOptions_t options;	// Copied with memcpy().
+		};
+
+		/**
+		 * Line record.
+		 */
+		struct Line {
+			Sig sig;		// Signature of the drawn line.
+			bool valid;		// True if sig is valid.
+			// Side effects of rendering the line.
+			bool collision;		// Sprite collision.
+			bool sprDotOverflow;	// Sprite dot overflow.
+		};
+
+		/**
+		 * Statistics.
+		 */
+		struct Stats {
+			uint64_t rendered;	// Lines rendered.
+			uint64_t skipped;	// Lines skipped.
+		};
+
+		/**
+		 * Get the line record for a framebuffer line.
+		 * If the framebuffer isn't tracked yet, the least
+		 * recently used slot is reassigned to it.
+		 * @param fb Framebuffer.
+		 * @param line Line number in the framebuffer.
+		 * @return Line record, or nullptr if the line is out of range.
+		 */
+		Line *line(MdFb *fb, int line);
+
+		/**
+		 * Invalidate all line records.
+		 * This must be called if a framebuffer is modified
+		 * outside of VdpPrivate::renderLine_m5().
+		 */
+		void invalidate(void);
+
+		/**
+		 * Get the statistics, and reset them.
+		 * @param stats Stats.
+		 */
+		void takeStats(Stats *stats);
+
+		// Statistics.
+		Stats stats;
+
+	private:
+		/**
+		 * Framebuffer slot.
+		 * The framebuffer is ref()'d so its address
+		 * can't be reused by a new framebuffer.
+		 */
+		struct Slot {
+			MdFb *fb;
+			unsigned int lastUse;
+			Line lines[MAX_LINES];
+		};
+		Slot m_slots[FB_SLOTS];
+		Slot *m_curSlot;
+		unsigned int m_useCounter;
+
+		/**
+		 * Invalidate all line records in a slot.
+		 * @param slot Slot.
+		 */
+		static void invalidateSlot(Slot *slot);
+};
+
+}
+
+#endif /* __LIBGENS_MD_VDPLINESKIP_HPP__ */
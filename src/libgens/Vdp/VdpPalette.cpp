@@ -97,8 +97,11 @@ VdpPalette::VdpPalette()
 	: d(new VdpPalettePrivate(this))
 	, cram_addr_mask(0x7F)
 	, m_bpp(MdFb::BPP_32)
+	, m_dirtyColors(0)
+	, m_activeGen(0)
 {
 	// Set the dirty flags.
+	m_dirty.data = 0;
 	m_dirty.active = true;
 	m_dirty.full = true;
 
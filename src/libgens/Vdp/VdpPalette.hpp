@@ -74,6 +74,13 @@ class VdpPalette
 		 */
 		bool isDirty(void) const;
 
+		/**
+		 * Get the active palette generation.
+		 * This is incremented whenever the active palette is recalculated.
+		 * @return Active palette generation.
+		 */
+		uint32_t activeGen(void) const;
+
 		/** CRam functions. **/
 
 		/**
@@ -232,10 +239,27 @@ class VdpPalette
 			struct {
 				bool active	:1;
 				bool full	:1;
+				bool cram	:1;	// Only m_dirtyColors changed.
 				// TODO: Add a separate bit for 32X CRAM.
 			};
 		} m_dirty;
 
+		/**
+		 * Per-color dirty flags for the 64 MD CRAM entries.
+		 * Used if only CRAM has changed since the last update,
+		 * so raster effects don't recalculate the whole palette.
+		 */
+		uint64_t m_dirtyColors;
+
+		/**
+		 * Mark a CRam entry as dirty.
+		 * @param address CRam address.
+		 */
+		inline void markCRamDirty(uint8_t address);
+
+		// Active palette generation.
+		uint32_t m_activeGen;
+
 		/** Active palette recalculation functions. **/
 
 		template<typename pixel>
@@ -247,6 +271,10 @@ class VdpPalette
 					const pixel *palFullMD,
 					const pixel *palFullSMS);
 
+		template<typename pixel>
+		FORCE_INLINE void T_update_MD_dirty(pixel *palActiveMD,
+					const pixel *palFullMD);
+
 		// TODO: Needs testing.
 		template<typename pixel>
 		FORCE_INLINE void T_update_32X(pixel *palActive32X,
@@ -272,8 +300,26 @@ class VdpPalette
 inline bool VdpPalette::isDirty(void) const
 	{ return !!(m_dirty.data); }
 
+/**
+ * Get the active palette generation.
+ * This is incremented whenever the active palette is recalculated.
+ * @return Active palette generation.
+ */
+inline uint32_t VdpPalette::activeGen(void) const
+	{ return m_activeGen; }
+
 /** CRam functions. **/
 
+/**
+ * Mark a CRam entry as dirty.
+ * @param address CRam address.
+ */
+inline void VdpPalette::markCRamDirty(uint8_t address)
+{
+	m_dirtyColors |= (1ULL << ((address >> 1) & 0x3F));
+	m_dirty.cram = true;
+}
+
 /**
  * Read 8-bit data from CRam.
  * @param address CRam address.
@@ -311,9 +357,10 @@ inline void VdpPalette::writeCRam_8(uint8_t address, uint8_t data)
 {
 	address &= cram_addr_mask;
 	// FIXME: Use U16DATA_U8_INVERT?
+	if (m_cram.u8[address] == data)
+		return;
 	m_cram.u8[address] = data;
-	// TODO: Per-color dirty flag?
-	m_dirty.active = true;
+	markCRamDirty(address);
 }
 
 /**
@@ -327,9 +374,10 @@ inline void VdpPalette::writeCRam_16(uint8_t address, uint16_t data)
 	assert((address & 1) == 0);
 
 	address &= cram_addr_mask;
+	if (m_cram.u16[address >> 1] == data)
+		return;
 	m_cram.u16[address >> 1] = data;
-	// TODO: Per-color dirty flag?
-	m_dirty.active = true;
+	markCRamDirty(address);
 }
 
 /** 32X CRam functions. **/
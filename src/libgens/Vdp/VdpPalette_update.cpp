@@ -160,6 +160,53 @@ FORCE_INLINE void VdpPalette::T_update_MD(pixel *palActiveMD,
 	}
 }
 
+/**
+ * Recalculate dirty entries in the active palette. (Mega Drive, Mode 5)
+ * Only the entries in m_dirtyColors are updated, along with
+ * the background color. The result is identical to T_update_MD().
+ * @param palActiveMD Active MD palette. (Must have 0x100 entries!)
+ * @param palFullMD Full MD palette. (Must have 0x1000 entries!)
+ */
+template<typename pixel>
+FORCE_INLINE void VdpPalette::T_update_MD_dirty(pixel *palActiveMD,
+					  const pixel *palFullMD)
+{
+	assert((d->m5m4bits & 0x02) != 0);
+	const uint16_t mdColorMask = ((d->m5m4bits & 0x01) ? 0xEEE : 0x222);
+	const bool sh = d->mdShadowHighlight;
+
+	// Update the dirty colors, 8 at a time.
+	// NOTE: Color 0 is only visible as the background color.
+	for (int i = 0; i < 64; i += 8) {
+		uint8_t bits = ((m_dirtyColors >> i) & 0xFF);
+		for (int j = i; bits != 0; j++, bits >>= 1) {
+			if (!(bits & 1) || j == 0)
+				continue;
+
+			const uint16_t color_raw = (m_cram.u16[j] & mdColorMask);
+			palActiveMD[j] = palFullMD[color_raw];
+			if (sh) {
+				// Shadow, highlight, and shadow+highlight colors.
+				const uint16_t shadow_raw = (color_raw >> 1);
+				palActiveMD[j + 64]  = palFullMD[shadow_raw];
+				palActiveMD[j + 128] = palFullMD[(0x888 | shadow_raw) - 0x111];
+				palActiveMD[j + 192] = palActiveMD[j];
+			}
+		}
+	}
+
+	// Update the background color.
+	// This is cheaper than checking if it changed.
+	const uint16_t bg_raw = (m_cram.u16[d->maskedBgColorIdx] & mdColorMask);
+	palActiveMD[0] = palFullMD[bg_raw];
+	if (sh) {
+		const uint16_t shadow_raw = (bg_raw >> 1);
+		palActiveMD[64]  = palFullMD[shadow_raw];
+		palActiveMD[128] = palFullMD[(0x888 | shadow_raw) - 0x111];
+		palActiveMD[192] = palActiveMD[0];
+	}
+}
+
 /**
  * Recalculate the active palette. (32X)
  * TODO: Needs testing.
@@ -321,15 +368,30 @@ FORCE_INLINE void VdpPalette::T_update_TMS9918A(pixel *palActiveTMS,
  */
 void VdpPalette::update(void)
 {
-	if (m_dirty.full)
+	if (m_dirty.full) {
 		d->recalcFull();
-	if (!m_dirty.active)
+		// App-based OS palettes are copied to the
+		// active palette by recalcFull().
+		m_activeGen++;
+	}
+	if (!m_dirty.active && !m_dirty.cram)
 		return;
 	if (d->isAppOs)
 		return;
 
-	// TODO: Add an AND to each switch() for optimization?
-	if (m_bpp != MdFb::BPP_32) {
+	if (!m_dirty.active &&
+	    (d->palMode == PALMODE_MD || d->palMode == PALMODE_32X) &&
+	    (d->m5m4bits & 0x02))
+	{
+		// Only some MD CRAM entries have changed. (Mode 5)
+		// NOTE: The 32X palette is marked dirty separately.
+		if (m_bpp != MdFb::BPP_32) {
+			T_update_MD_dirty<uint16_t>(m_palActive.u16, d->palFullMD.u16);
+		} else {
+			T_update_MD_dirty<uint32_t>(m_palActive.u32, d->palFullMD.u32);
+		}
+	} else if (m_bpp != MdFb::BPP_32) {
+		// TODO: Add an AND to each switch() for optimization?
 		switch (d->palMode) {
 			case PALMODE_32X:
 				T_update_32X<uint16_t>(m_palActive32X.u16, d->palFull32X.u16);
@@ -381,8 +443,11 @@ void VdpPalette::update(void)
 		}
 	}
 
-	// Clear the active palette dirty bit.
+	// Clear the active palette dirty bits.
 	m_dirty.active = false;
+	m_dirty.cram = false;
+	m_dirtyColors = 0;
+	m_activeGen++;
 }
 
 // TODO: Port to LibGens: T_update_32X()
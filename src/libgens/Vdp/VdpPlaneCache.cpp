@@ -0,0 +1,161 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VdpPlaneCache.cpp: VDP Mode 5 scroll plane row cache.                   *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "VdpPlaneCache.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+namespace LibGens {
+
+VdpPlaneCache::VdpPlaneCache()
+{
+	memset(&stats, 0, sizeof(stats));
+	for (int i = 0; i < 2; i++) {
+		Plane *const p = &m_planes[i];
+		// No registers have been checked yet.
+		// checkPlane() will initialize these.
+		p->tblAddr = 0;
+		p->tblSize = 0;
+		p->cmul = 0;
+		p->vmask = 0;
+		p->rowShift = 0;
+	}
+	invalidate();
+}
+
+/**
+ * Invalidate the entire cache.
+ * This must be called if VRAM is modified without
+ * going through vramWrite(), e.g. on reset and
+ * when loading a savestate.
+ */
+void VdpPlaneCache::invalidate(void)
+{
+	invalidatePlane(0);
+	invalidatePlane(1);
+}
+
+/**
+ * Invalidate a plane.
+ * @param plane Plane index. (0 == Scroll B; 1 == Scroll A)
+ */
+void VdpPlaneCache::invalidatePlane(int plane)
+{
+	Plane *const p = &m_planes[plane];
+	for (unsigned int i = 0; i < ROW_COUNT; i++) {
+		p->rows[i].key = ROW_INVALID;
+	}
+
+	// Clear this plane's pattern references.
+	const uint8_t mask = ~(1 << plane);
+	for (unsigned int i = 0; i < sizeof(m_patRefs); i++) {
+		m_patRefs[i] &= mask;
+	}
+
+	stats.invalidations++;
+}
+
+/**
+ * Invalidate all planes that reference a VRAM block.
+ * @param refs Plane reference bits.
+ */
+void VdpPlaneCache::invalidateRefs(uint8_t refs)
+{
+	if (refs & 1)
+		invalidatePlane(0);
+	if (refs & 2)
+		invalidatePlane(1);
+}
+
+/**
+ * Invalidate the pixel rows for a range of nametable cell rows.
+ * @param plane Plane index. (0 == Scroll B; 1 == Scroll A)
+ * @param first First nametable offset, in bytes.
+ * @param last Last nametable offset, in bytes. (inclusive)
+ */
+void VdpPlaneCache::invalidateCellRows(int plane, uint32_t first, uint32_t last)
+{
+	Plane *const p = &m_planes[plane];
+	const unsigned int key_start = (((first >> 1) >> p->cmul) << p->rowShift);
+	const unsigned int key_end = ((((last >> 1) >> p->cmul) + 1) << p->rowShift);
+	for (unsigned int key = key_start; key < key_end; key++) {
+		Row *const r = &p->rows[key & (ROW_COUNT - 1)];
+		if (r->key == key) {
+			r->key = ROW_INVALID;
+		}
+	}
+}
+
+/**
+ * Notify the cache of a VRAM write to a range of addresses.
+ * @param address First VRAM address.
+ * @param len Length, in bytes. Must not wrap around the end of VRAM.
+ */
+void VdpPlaneCache::vramWriteRange(uint32_t address, uint32_t len)
+{
+	if (len == 0)
+		return;
+	address &= 0xFFFF;
+	const uint32_t end = address + len - 1;	// inclusive
+
+	// Check for cached pattern lines.
+	uint8_t refs = 0;
+	for (uint32_t block = (address >> 5); block <= (end >> 5); block++) {
+		refs |= m_patRefs[block];
+	}
+	if (refs != 0) {
+		invalidateRefs(refs);
+	}
+
+	// Check for cached nametable words.
+	for (int i = 0; i < 2; i++) {
+		const Plane *const p = &m_planes[i];
+		if (p->tblSize == 0)
+			continue;
+
+		// NOTE: The nametable wraps around at the end of VRAM,
+		// so the written range may be split into two parts.
+		const uint32_t first = (address - p->tblAddr) & 0xFFFF;
+		const uint32_t last = first + len - 1;
+		if (first < p->tblSize) {
+			invalidateCellRows(i, first,
+				(last < p->tblSize ? last : p->tblSize - 1));
+		}
+		if (last > 0xFFFF) {
+			const uint32_t wrap_last = (last & 0xFFFF);
+			invalidateCellRows(i, 0,
+				(wrap_last < p->tblSize ? wrap_last : p->tblSize - 1));
+		}
+	}
+}
+
+/**
+ * Get the cache statistics, and reset them.
+ * @param stats Stats.
+ */
+void VdpPlaneCache::takeStats(Stats *stats)
+{
+	*stats = this->stats;
+	memset(&this->stats, 0, sizeof(this->stats));
+}
+
+}
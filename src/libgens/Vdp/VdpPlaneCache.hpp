@@ -0,0 +1,282 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * VdpPlaneCache.hpp: VDP Mode 5 scroll plane row cache.                   *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Scroll planes are mostly static from one line to the next, and from
+// one frame to the next. This cache stores the nametable word and the
+// (V-flipped) pattern line for each cell of a plane pixel row, so an
+// unchanged row doesn't have to be fetched from VRAM again.
+//
+// Cached data is invalidated by:
+// - VRAM writes to the plane's nametable. (only the affected cell row)
+// - VRAM writes to a pattern referenced by a cached row. (entire plane)
+// - Changes to the nametable address, plane size, or interlaced mode.
+//
+// H-flip and priority are still applied when the row is composed,
+// since the layer options can change at any time.
+
+#ifndef __LIBGENS_MD_VDPPLANECACHE_HPP__
+#define __LIBGENS_MD_VDPPLANECACHE_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class VdpPlaneCache
+{
+	public:
+		VdpPlaneCache();
+		~VdpPlaneCache() { }
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		VdpPlaneCache(const VdpPlaneCache &);
+		VdpPlaneCache &operator=(const VdpPlaneCache &);
+
+	public:
+		// Number of cached rows per plane.
+		// Rows are direct-mapped by plane pixel row.
+		// 256 rows covers a full non-interlaced screen.
+		static const unsigned int ROW_COUNT = 256;
+		// Maximum number of cells per plane row. (H128)
+		static const unsigned int ROW_CELLS = 128;
+		// Key for an empty row.
+		static const uint16_t ROW_INVALID = 0xFFFF;
+
+		/**
+		 * Cached plane pixel row.
+		 */
+		struct Row {
+			uint16_t key;		// Plane pixel row, or ROW_INVALID.
+			uint64_t valid[ROW_CELLS / 64];	// Valid cells.
+			uint16_t nametable[ROW_CELLS];	// Nametable words.
+			uint32_t pattern[ROW_CELLS];	// Pattern lines. (V-flip applied)
+		};
+
+		/**
+		 * Cache statistics.
+		 */
+		struct Stats {
+			uint64_t hits;		// Cells read from the cache.
+			uint64_t misses;	// Cells read from VRAM.
+			uint64_t invalidations;	// Full plane invalidations.
+		};
+
+		/**
+		 * Invalidate the entire cache.
+		 * This must be called if VRAM is modified without
+		 * going through vramWrite(), e.g. on reset and
+		 * when loading a savestate.
+		 */
+		void invalidate(void);
+
+		/**
+		 * Make sure a plane's cached rows match the current registers.
+		 * If they don't match, the plane is invalidated.
+		 * @param plane True for Scroll A; false for Scroll B.
+		 * @param tblAddr Nametable address.
+		 * @param cmul H_Scroll_CMul.
+		 * @param vmask V_Scroll_CMask.
+		 * @param interlaced True for interlaced mode.
+		 */
+		inline void checkPlane(bool plane, uint32_t tblAddr,
+			uint8_t cmul, uint8_t vmask, bool interlaced);
+
+		/**
+		 * Look up a plane row.
+		 * If the row isn't cached, its slot is reclaimed.
+		 * @param plane True for Scroll A; false for Scroll B.
+		 * @param key Plane pixel row.
+		 * @return Row.
+		 */
+		inline Row *row(bool plane, unsigned int key);
+
+		/**
+		 * Mark a VRAM pattern line as referenced by a plane.
+		 * @param plane True for Scroll A; false for Scroll B.
+		 * @param address VRAM address of the pattern line.
+		 */
+		inline void addPatternRef(bool plane, uint32_t address);
+
+		/**
+		 * Notify the cache of a VRAM write.
+		 * @param address VRAM address.
+		 */
+		inline void vramWrite(uint32_t address);
+
+		/**
+		 * Notify the cache of a VRAM write to a range of addresses.
+		 * @param address First VRAM address.
+		 * @param len Length, in bytes. Must not wrap around the end of VRAM.
+		 */
+		void vramWriteRange(uint32_t address, uint32_t len);
+
+		/**
+		 * Get the cache statistics, and reset them.
+		 * @param stats Stats.
+		 */
+		void takeStats(Stats *stats);
+
+		// Statistics.
+		Stats stats;
+
+	private:
+		/**
+		 * Invalidate a plane.
+		 * @param plane Plane index. (0 == Scroll B; 1 == Scroll A)
+		 */
+		void invalidatePlane(int plane);
+
+		/**
+		 * Invalidate all planes that reference a VRAM block.
+		 * @param refs Plane reference bits.
+		 */
+		void invalidateRefs(uint8_t refs);
+
+		/**
+		 * Invalidate the pixel rows for a range of nametable cell rows.
+		 * @param plane Plane index. (0 == Scroll B; 1 == Scroll A)
+		 * @param first First nametable offset, in bytes.
+		 * @param last Last nametable offset, in bytes. (inclusive)
+		 */
+		void invalidateCellRows(int plane, uint32_t first, uint32_t last);
+
+		/**
+		 * Cached plane.
+		 * Index 0 is Scroll B; index 1 is Scroll A.
+		 */
+		struct Plane {
+			// Register values the cached rows were fetched with.
+			uint32_t tblAddr;	// Nametable address.
+			uint32_t tblSize;	// Nametable size, in bytes.
+			uint8_t cmul;		// H_Scroll_CMul.
+			uint8_t vmask;		// V_Scroll_CMask.
+			uint8_t rowShift;	// Cell row to pixel row shift. (3 or 4)
+
+			Row rows[ROW_COUNT];
+		};
+		Plane m_planes[2];
+
+		// Pattern reference bits for each 32-byte VRAM block.
+		// Bit 0 is Scroll B; bit 1 is Scroll A.
+		uint8_t m_patRefs[0x10000 / 32];
+};
+
+/**
+ * Make sure a plane's cached rows match the current registers.
+ * If they don't match, the plane is invalidated.
+ * @param plane True for Scroll A; false for Scroll B.
+ * @param tblAddr Nametable address.
+ * @param cmul H_Scroll_CMul.
+ * @param vmask V_Scroll_CMask.
+ * @param interlaced True for interlaced mode.
+ */
+inline void VdpPlaneCache::checkPlane(bool plane, uint32_t tblAddr,
+	uint8_t cmul, uint8_t vmask, bool interlaced)
+{
+	Plane *const p = &m_planes[plane];
+	const uint8_t rowShift = (interlaced ? 4 : 3);
+	if (p->tblAddr == tblAddr && p->cmul == cmul &&
+	    p->vmask == vmask && p->rowShift == rowShift)
+	{
+		// Registers haven't changed.
+		return;
+	}
+
+	invalidatePlane(plane);
+	p->tblAddr = tblAddr;
+	p->tblSize = ((vmask + 1) << cmul) * 2;
+	p->cmul = cmul;
+	p->vmask = vmask;
+	p->rowShift = rowShift;
+}
+
+/**
+ * Look up a plane row.
+ * If the row isn't cached, its slot is reclaimed.
+ * @param plane True for Scroll A; false for Scroll B.
+ * @param key Plane pixel row.
+ * @return Row.
+ */
+inline VdpPlaneCache::Row *VdpPlaneCache::row(bool plane, unsigned int key)
+{
+	Row *const r = &m_planes[plane].rows[key & (ROW_COUNT - 1)];
+	if (r->key != key) {
+		// Different row. Reclaim the slot.
+		// NOTE: Pattern references from the old row are kept.
+		// This may cause an extra invalidation later, but
+		// it's cheaper than tracking references per row.
+		r->key = key;
+		r->valid[0] = 0;
+		r->valid[1] = 0;
+	}
+	return r;
+}
+
+/**
+ * Mark a VRAM pattern line as referenced by a plane.
+ * @param plane True for Scroll A; false for Scroll B.
+ * @param address VRAM address of the pattern line.
+ */
+inline void VdpPlaneCache::addPatternRef(bool plane, uint32_t address)
+{
+	m_patRefs[(address & 0xFFFF) >> 5] |= (1 << plane);
+}
+
+/**
+ * Notify the cache of a VRAM write.
+ * @param address VRAM address.
+ */
+inline void VdpPlaneCache::vramWrite(uint32_t address)
+{
+	address &= 0xFFFF;
+
+	// Check for cached pattern lines.
+	const uint8_t refs = m_patRefs[address >> 5];
+	if (refs != 0) {
+		invalidateRefs(refs);
+	}
+
+	// Check for cached nametable words.
+	for (int i = 0; i < 2; i++) {
+		Plane *const p = &m_planes[i];
+		// NOTE: The nametable wraps around at the end of VRAM.
+		const uint32_t offset = (address - p->tblAddr) & 0xFFFF;
+		if (offset >= p->tblSize)
+			continue;
+
+		// Invalidate the pixel rows for this cell row.
+		const unsigned int cell_y = (offset >> 1) >> p->cmul;
+		const unsigned int rows = (1 << p->rowShift);
+		const unsigned int key_start = (cell_y << p->rowShift);
+		for (unsigned int key = key_start; key < key_start + rows; key++) {
+			Row *const r = &p->rows[key & (ROW_COUNT - 1)];
+			if (r->key == key) {
+				r->key = ROW_INVALID;
+			}
+		}
+	}
+}
+
+}
+
+#endif /* __LIBGENS_MD_VDPPLANECACHE_HPP__ */
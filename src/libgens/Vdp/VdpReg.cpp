@@ -264,6 +264,11 @@ void VdpPrivate::setReg(int reg_num, uint8_t val)
 	// Check what bits have changed.
 	// Used to optimize away some recalculations.
 	const uint8_t diff = (VDP_Reg.reg[reg_num] ^ val);
+	if (diff != 0 && reg_num <= 18) {
+		// Registers 19-23 are only used for DMA,
+		// so they don't affect rendering.
+		regGen++;
+	}
 
 	// Save the new register value.
 	// NOTE: Cannot optimize away write if the value is
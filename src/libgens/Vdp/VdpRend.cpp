@@ -72,6 +72,7 @@ void VdpPrivate::rend_reset(void)
 	// Sprite line cache.
 	memset(sprLineCache, 0, sizeof(sprLineCache));
 	memset(sprCountCache, 0, sizeof(sprCountCache));
+	memset(sprLineCacheSig, 0, sizeof(sprLineCacheSig));
 
 	// Sprite dot overflow flag.
 	sprDotOverflow = false;
@@ -33,6 +33,9 @@
 // ARRAY_SIZE(x)
 #include "macros/common.h"
 
+// CPU flags.
+#include "libcompat/cpuflags.h"
+
 // TODO: Maybe move these to class enum constants?
 #define LINEBUF_HIGH_B	0x80	/* Highlighted. */
 #define LINEBUF_SHAD_B	0x40	/* Shadowed. */
@@ -90,6 +93,14 @@
 // Vdp private class.
 #include "Vdp_p.hpp"
 
+// SIMD intrinsics.
+#ifdef VDP_RENDER_HAS_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef VDP_RENDER_HAS_AVX2
+#include <immintrin.h>
+#endif
+
 namespace LibGens {
 
 /**
@@ -333,6 +344,13 @@ FORCE_INLINE void VdpPrivate::T_PutLine_P0(int disp_pixnum, uint32_t pattern, in
 	if (pattern == 0)
 		return;
 
+#ifdef VDP_RENDER_HAS_SSE2
+	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		T_PutLine_P0_SSE2<plane, h_s, flip>(disp_pixnum, pattern, palette);
+		return;
+	}
+#endif /* VDP_RENDER_HAS_SSE2 */
+
 	// Put the pixels.
 	if (!flip) {
 		// No flip.
@@ -399,6 +417,13 @@ FORCE_INLINE void VdpPrivate::T_PutLine_P1(int disp_pixnum, uint32_t pattern, in
 	if (pattern == 0)
 		return;
 
+#ifdef VDP_RENDER_HAS_SSE2
+	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		T_PutLine_P1_SSE2<plane, flip>(disp_pixnum, pattern, palette);
+		return;
+	}
+#endif /* VDP_RENDER_HAS_SSE2 */
+
 	// Put the pixels.
 	if (!flip) {
 		// No flip.
@@ -444,6 +469,13 @@ FORCE_INLINE void VdpPrivate::T_PutLine_Sprite(int disp_pixnum, uint32_t pattern
 		return;
 	}
 
+#ifdef VDP_RENDER_HAS_SSE2
+	if (CPU_Flags & MDP_CPUFLAG_X86_SSE2) {
+		T_PutLine_Sprite_SSE2<priority, h_s, flip>(disp_pixnum, pattern, palette);
+		return;
+	}
+#endif /* VDP_RENDER_HAS_SSE2 */
+
 	// Put the sprite pixels.
 	uint8_t status = 0;
 	if (!flip) {
@@ -473,6 +505,231 @@ FORCE_INLINE void VdpPrivate::T_PutLine_Sprite(int disp_pixnum, uint32_t pattern
 		Reg_Status.setBit(VdpStatus::VDP_STATUS_COLLISION, true);
 }
 
+/**
+ * Put a line from the sprite pattern generator in the sprite layer.
+ * If the pattern cache is enabled, the pre-flipped
+ * pattern line is used instead of flipping it here.
+ * @param priority	[in] Sprite priority. (false == low, true == high)
+ * @param h_s		[in] Highlight/Shadow enable.
+ * @param flip		[in] True to flip the line horizontally.
+ * @param disp_pixnum	[in] Display pixel nmber.
+ * @param offset	[in] Pattern line offset in the sprite pattern generator.
+ * @param palette	[in] Palette number * 16.
+ */
+template<bool priority, bool h_s, bool flip>
+FORCE_INLINE void VdpPrivate::T_PutLine_Sprite_Gen(int disp_pixnum, uint32_t offset, int palette)
+{
+	if (flip && patternCache) {
+		const uint32_t pattern = patternCache->pattern_line(true, Spr_Gen_Addr + offset);
+		T_PutLine_Sprite<priority, h_s, false>(disp_pixnum, pattern, palette);
+	} else {
+		// NOTE: Unflipped cache lines are identical to VRAM.
+		T_PutLine_Sprite<priority, h_s, flip>(disp_pixnum, Spr_Gen_Addr_u32(offset), palette);
+	}
+}
+
+#ifdef VDP_RENDER_HAS_SSE2
+/** SSE2 layer compositor. **/
+
+// NOTE: The SSE2 functions operate on eight 16-bit LineBuf
+// entries at once, i.e. one full pattern line. Each lane is
+// handled exactly like the corresponding T_PutPixel_*()
+// function, using masks instead of branches.
+// x86 is always little-endian, so each 16-bit lane has
+// the pixel in the low byte and the layer in the high byte.
+
+/**
+ * Expand a pattern line into eight 16-bit pixels. (SSE2)
+ * @param flip		[in] True to flip the line horizontally.
+ * @param pattern	[in] Pattern data.
+ * @return Pixels 0-7, one per 16-bit lane. (0x0-0xF)
+ */
+template<bool flip>
+static FORCE_INLINE __m128i T_Expand_Pattern_SSE2(uint32_t pattern)
+{
+	// Pixels 0-3 are in the low word; pixels 4-7 are in the high word.
+	// Broadcast each word to four lanes, then use multiplication
+	// to shift each pixel into the high nybble of its lane.
+	const __m128i px = _mm_cvtsi32_si128((int)pattern);
+	const __m128i lo = _mm_shufflelo_epi16(px, _MM_SHUFFLE(0,0,0,0));
+	const __m128i hi = _mm_shufflelo_epi16(px, _MM_SHUFFLE(1,1,1,1));
+
+	__m128i ret;
+	if (!flip) {
+		// No flip.
+		ret = _mm_unpacklo_epi64(lo, hi);
+		ret = _mm_mullo_epi16(ret, _mm_set_epi16(4096, 256, 16, 1, 4096, 256, 16, 1));
+	} else {
+		// Horizontal flip.
+		ret = _mm_unpacklo_epi64(hi, lo);
+		ret = _mm_mullo_epi16(ret, _mm_set_epi16(1, 16, 256, 4096, 1, 16, 256, 4096));
+	}
+	return _mm_srli_epi16(ret, 12);
+}
+
+/**
+ * Put a line in background graphics layer 0. (low-priority) (SSE2)
+ * @param plane		[in] True for Scroll A; false for Scroll B.
+ * @param h_s		[in] Highlight/Shadow enable.
+ * @param flip		[in] True to flip the line horizontally.
+ * @param disp_pixnum	[in] Display pixel nmber.
+ * @param pattern	[in] Pattern data.
+ * @param palette	[in] Palette number * 16.
+ */
+template<bool plane, bool h_s, bool flip>
+FORCE_INLINE void VdpPrivate::T_PutLine_P0_SSE2(int disp_pixnum, uint32_t pattern, int palette)
+{
+	__m128i *const pLineBuf = reinterpret_cast<__m128i*>(&LineBuf.u16[disp_pixnum]);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lb = _mm_loadu_si128(pLineBuf);
+	const __m128i px = T_Expand_Pattern_SSE2<flip>(pattern);
+
+	// Pixels that are kept: transparent pixels, and for
+	// Scroll A, high-priority and window pixels.
+	__m128i keep = _mm_cmpeq_epi16(px, zero);
+	if (plane) {
+		const __m128i masked = _mm_and_si128(lb, _mm_set1_epi16(LINEBUF_PRIO_W | LINEBUF_WIN_W));
+		keep = _mm_or_si128(keep, _mm_cmpgt_epi16(masked, zero));
+	}
+
+	// Apply palette data.
+	__m128i pat = _mm_or_si128(px, _mm_set1_epi16(palette));
+
+	// If Highlight/Shadow is enabled, adjust the shadow flags.
+	if (h_s) {
+		// Scroll A: Mark as shadow if the layer is marked as shadow.
+		// Scroll B: Always mark as shadow.
+		if (plane) {
+			const __m128i layer = _mm_srli_epi16(lb, 8);
+			pat = _mm_or_si128(pat, _mm_and_si128(layer, _mm_set1_epi16(LINEBUF_SHAD_B)));
+		} else {
+			pat = _mm_or_si128(pat, _mm_set1_epi16(LINEBUF_SHAD_B));
+		}
+	}
+
+	// Only the pixel byte is written; the layer byte is kept.
+	pat = _mm_or_si128(pat, _mm_and_si128(lb, _mm_set1_epi16((short)0xFF00)));
+	pat = _mm_or_si128(_mm_and_si128(keep, lb), _mm_andnot_si128(keep, pat));
+	_mm_storeu_si128(pLineBuf, pat);
+}
+
+/**
+ * Put a line in background graphics layer 1. (high-priority) (SSE2)
+ * @param plane		[in] True for Scroll A; false for Scroll B.
+ * @param flip		[in] True to flip the line horizontally.
+ * @param disp_pixnum	[in] Display pixel nmber.
+ * @param pattern	[in] Pattern data.
+ * @param palette	[in] Palette number * 16.
+ */
+template<bool plane, bool flip>
+FORCE_INLINE void VdpPrivate::T_PutLine_P1_SSE2(int disp_pixnum, uint32_t pattern, int palette)
+{
+	__m128i *const pLineBuf = reinterpret_cast<__m128i*>(&LineBuf.u16[disp_pixnum]);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lb = _mm_loadu_si128(pLineBuf);
+	const __m128i px = T_Expand_Pattern_SSE2<flip>(pattern);
+
+	// Pixels that are kept: transparent pixels, and for
+	// Scroll A, window pixels.
+	__m128i keep = _mm_cmpeq_epi16(px, zero);
+	if (plane) {
+		const __m128i win = _mm_and_si128(lb, _mm_set1_epi16(LINEBUF_WIN_W));
+		keep = _mm_or_si128(keep, _mm_cmpgt_epi16(win, zero));
+	}
+
+	// Add palette information and mark the pixels as priority.
+	const __m128i pat = _mm_or_si128(px, _mm_set1_epi16(palette | LINEBUF_PRIO_W));
+	_mm_storeu_si128(pLineBuf,
+		_mm_or_si128(_mm_and_si128(keep, lb), _mm_andnot_si128(keep, pat)));
+}
+
+/**
+ * Put a line in the sprite layer. (SSE2)
+ * @param priority	[in] Sprite priority. (false == low, true == high)
+ * @param h_s		[in] Highlight/Shadow enable.
+ * @param flip		[in] True to flip the line horizontally.
+ * @param disp_pixnum	[in] Display pixel nmber.
+ * @param pattern	[in] Pattern data.
+ * @param palette	[in] Palette number * 16.
+ */
+template<bool priority, bool h_s, bool flip>
+FORCE_INLINE void VdpPrivate::T_PutLine_Sprite_SSE2(int disp_pixnum, uint32_t pattern, int palette)
+{
+	// If the pattern is empty, nothing is drawn,
+	// and there's no sprite collision.
+	if (pattern == 0)
+		return;
+
+	__m128i *const pLineBuf = reinterpret_cast<__m128i*>(&LineBuf.u16[disp_pixnum + 8]);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lb = _mm_loadu_si128(pLineBuf);
+	const __m128i px = T_Expand_Pattern_SSE2<flip>(pattern);
+	const __m128i transparent = _mm_cmpeq_epi16(px, zero);
+
+	// Check for sprite collision.
+	// An opaque sprite pixel on top of another sprite pixel
+	// is always a collision, regardless of priority.
+	const __m128i spr = _mm_cmpeq_epi16(_mm_and_si128(lb, _mm_set1_epi16(LINEBUF_SPR_W)), zero);
+	if (_mm_movemask_epi8(_mm_andnot_si128(_mm_or_si128(transparent, spr), _mm_set1_epi16(-1))) != 0)
+		Reg_Status.setBit(VdpStatus::VDP_STATUS_COLLISION, true);
+
+	// Masked pixels: a high-priority pixel or another sprite pixel.
+	// (For high-priority sprites, only another sprite pixel.)
+	const uint16_t mask_w = (uint16_t)(((LINEBUF_PRIO_B | LINEBUF_SPR_B) - priority) << 8);
+	const __m128i unmasked = _mm_cmpeq_epi16(_mm_and_si128(lb, _mm_set1_epi16(mask_w)), zero);
+	__m128i draw = _mm_andnot_si128(transparent, unmasked);
+
+	__m128i ret = lb;
+	if (!priority) {
+		// Set the sprite bit for masked pixels.
+		const __m128i masked = _mm_andnot_si128(_mm_or_si128(transparent, unmasked), _mm_set1_epi16(-1));
+		ret = _mm_or_si128(ret, _mm_and_si128(masked, _mm_set1_epi16(LINEBUF_SPR_W)));
+	}
+
+	// Apply the palette.
+	__m128i pat = _mm_or_si128(px, _mm_set1_epi16(palette));
+
+	if (h_s) {
+		// A sprite shadow/highlight operator has already been applied.
+		// These pixels are masked.
+		draw = _mm_and_si128(draw, _mm_cmpeq_epi16(
+			_mm_and_si128(lb, _mm_set1_epi16(LINEBUF_SPRSH_W)), zero));
+
+		// Palette 3, colors 14 and 15: Highlight and Shadow operators.
+		// (Sprite pixel doesn't show up.)
+		const __m128i op_high = _mm_and_si128(draw, _mm_cmpeq_epi16(pat, _mm_set1_epi16(0x3E)));
+		const __m128i op_shad = _mm_and_si128(draw, _mm_cmpeq_epi16(pat, _mm_set1_epi16(0x3F)));
+		draw = _mm_andnot_si128(_mm_or_si128(op_high, op_shad), draw);
+		ret = _mm_or_si128(ret, _mm_and_si128(op_high, _mm_set1_epi16(LINEBUF_HIGH_W | LINEBUF_SPRSH_W)));
+		ret = _mm_or_si128(ret, _mm_and_si128(op_shad, _mm_set1_epi16(LINEBUF_SHAD_W | LINEBUF_SPRSH_W)));
+
+		// Apply highlight/shadow based on priority.
+		const __m128i layer = _mm_srli_epi16(lb, 8);
+		__m128i layer_bits;
+		if (!priority) {
+			// Low priority. Pixel can be normal, shadowed, or highlighted.
+			layer_bits = _mm_and_si128(layer, _mm_set1_epi16(LINEBUF_SHAD_B | LINEBUF_HIGH_B));
+
+			// Color 14 in palettes 0-2 are never shadowed.
+			const __m128i c14 = _mm_cmpeq_epi16(
+				_mm_and_si128(pat, _mm_set1_epi16(0x0F)), _mm_set1_epi16(0x0E));
+			layer_bits = _mm_andnot_si128(_mm_and_si128(c14, _mm_set1_epi16(LINEBUF_SHAD_B)), layer_bits);
+		} else {
+			// High priority. Pixel can either be normal or highlighted.
+			layer_bits = _mm_and_si128(layer, _mm_set1_epi16(LINEBUF_HIGH_B));
+		}
+		pat = _mm_or_si128(pat, layer_bits);
+	}
+
+	// Mark the pixels as sprite pixels.
+	pat = _mm_or_si128(pat, _mm_set1_epi16(LINEBUF_SPR_W));
+
+	// Save the pixels in the linebuffer.
+	ret = _mm_or_si128(_mm_andnot_si128(draw, ret), _mm_and_si128(draw, pat));
+	_mm_storeu_si128(pLineBuf, ret);
+}
+#endif /* VDP_RENDER_HAS_SSE2 */
+
 /**
  * Get the X offset for the line. (Horizontal Scroll Table)
  * @param plane True for Scroll A; false for Scroll B.
@@ -625,14 +882,14 @@ FORCE_INLINE uint16_t VdpPrivate::T_Get_Nametable_Word(unsigned int x, unsigned
 }
 
 /**
- * Get pattern data for a given tile for the current line.
+ * Get the VRAM address of a given tile's pattern line.
  * @param interlaced True for interlaced; false for non-interlaced.
  * @param pattern Pattern info.
  * @param y_fine_offset Y fine offset.
- * @return Pattern data.
+ * @return VRAM address of the pattern line.
  */
 template<bool interlaced>
-FORCE_INLINE uint32_t VdpPrivate::T_Get_Pattern_Data(uint16_t pattern, unsigned int y_fine_offset)
+FORCE_INLINE unsigned int VdpPrivate::T_Get_Pattern_Addr(uint16_t pattern, unsigned int y_fine_offset)
 {
 	// Get the tile address.
 	unsigned int TileAddr;
@@ -653,9 +910,85 @@ FORCE_INLINE uint32_t VdpPrivate::T_Get_Pattern_Data(uint16_t pattern, unsigned
 		}
 	}
 
-	// Return the pattern data.
 	// FIXME: Rebase to upper 64 KB if necessary. (128 KB VRAM mode)
-	return VRam.u32[(TileAddr + (y_fine_offset * 4)) >> 2];
+	return (TileAddr + (y_fine_offset * 4));
+}
+
+/**
+ * Get pattern data for a given tile for the current line.
+ * @param interlaced True for interlaced; false for non-interlaced.
+ * @param pattern Pattern info.
+ * @param y_fine_offset Y fine offset.
+ * @return Pattern data.
+ */
+template<bool interlaced>
+FORCE_INLINE uint32_t VdpPrivate::T_Get_Pattern_Data(uint16_t pattern, unsigned int y_fine_offset)
+{
+	// Return the pattern data.
+	return VRam.u32[T_Get_Pattern_Addr<interlaced>(pattern, y_fine_offset) >> 2];
+}
+
+/**
+ * Get pattern data for a given tile for the current line
+ * using the pattern cache.
+ * patternCache must not be nullptr, and update_m5()
+ * must have been called for the current line.
+ * The pattern data is already H-flipped, so the
+ * H-flip bit is cleared in the pattern info.
+ * @param interlaced True for interlaced; false for non-interlaced.
+ * @param pattern [in/out] Pattern info.
+ * @param y_fine_offset Y fine offset.
+ * @return Pattern data.
+ */
+template<bool interlaced>
+FORCE_INLINE uint32_t VdpPrivate::T_Get_Pattern_Data_Cached(uint16_t *pattern, unsigned int y_fine_offset)
+{
+	const uint16_t pattern_info = *pattern;
+	*pattern = (pattern_info & ~0x0800);
+	return patternCache->pattern_line(!!(pattern_info & 0x0800),
+		T_Get_Pattern_Addr<interlaced>(pattern_info, y_fine_offset));
+}
+
+/**
+ * Get the nametable word and pattern data for a given cell
+ * using the scroll plane row cache.
+ * planeCache must not be nullptr, and checkPlane()
+ * must have been called for the current line.
+ * @param plane True for Scroll A; false for Scroll B.
+ * @param interlaced True for interlaced; false for non-interlaced.
+ * @param x X tile number.
+ * @param y_cell_offset Y tile number.
+ * @param y_fine_offset Y fine offset.
+ * @param nametable_word [out] Nametable word.
+ * @return Pattern data.
+ */
+template<bool plane, bool interlaced>
+FORCE_INLINE uint32_t VdpPrivate::T_Get_Cell_Cached(unsigned int x, unsigned int y_cell_offset,
+	unsigned int y_fine_offset, uint16_t *nametable_word)
+{
+	const unsigned int key = (y_cell_offset << (interlaced ? 4 : 3)) | y_fine_offset;
+	VdpPlaneCache::Row *const row = planeCache->row(plane, key);
+
+	const uint64_t bit = (1ULL << (x & 63));
+	if (row->valid[x >> 6] & bit) {
+		// Cell is cached.
+		planeCache->stats.hits++;
+		*nametable_word = row->nametable[x];
+		return row->pattern[x];
+	}
+
+	// Cell isn't cached. Fetch it from VRAM.
+	planeCache->stats.misses++;
+	const uint16_t nt = T_Get_Nametable_Word<plane>(x, y_cell_offset);
+	const unsigned int pat_addr = T_Get_Pattern_Addr<interlaced>(nt, y_fine_offset);
+	const uint32_t pattern_data = VRam.u32[pat_addr >> 2];
+	planeCache->addPatternRef(plane, pat_addr);
+
+	row->nametable[x] = nt;
+	row->pattern[x] = pattern_data;
+	row->valid[x >> 6] |= bit;
+	*nametable_word = nt;
+	return pattern_data;
 }
 
 /**
@@ -705,6 +1038,15 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_Scroll(int cell_start, int cell_leng
 	// (Rendering starts from 0 to 7 px off the left side of the screen.)
 	int VSRam_Cell = ((x_cell_offset & 1) - 2);
 
+	// Scroll plane row cache.
+	VdpPlaneCache *const cache = planeCache;
+	if (cache) {
+		// Make sure the cached rows are still valid
+		// for the current register values.
+		cache->checkPlane(plane, (plane ? ScrA_Tbl_Addr : ScrB_Tbl_Addr),
+			H_Scroll_CMul, V_Scroll_CMask, interlaced);
+	}
+
 	// Initialize the Y offset.
 	unsigned int y_offset, y_cell_offset, y_fine_offset;
 	if (!vscroll) {
@@ -729,27 +1071,28 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_Scroll(int cell_start, int cell_leng
 			y_fine_offset = T_Get_Y_Fine_Offset<interlaced>(y_offset);
 		}
 
-		// Get the nametable word for the current tile.
+		// Get the cell number for the current tile.
+		unsigned int x_cell = x_cell_offset;
+		if (plane && LeftWindowBugCnt > 0) {
+			// Scroll A: Left Window bug applies.
+			LeftWindowBugCnt--;
+			x_cell = ((x_cell_offset + 2) & H_Scroll_CMask);
+		}
+
+		// Get the nametable word and pattern data for the current tile.
 		uint16_t nametable_word;
-		if (!plane) {
-			// Scroll B.
-			nametable_word = T_Get_Nametable_Word<plane>(x_cell_offset, y_cell_offset);
+		uint32_t pattern_data;
+		if (cache) {
+			pattern_data = T_Get_Cell_Cached<plane, interlaced>(
+				x_cell, y_cell_offset, y_fine_offset, &nametable_word);
+		} else if (patternCache) {
+			nametable_word = T_Get_Nametable_Word<plane>(x_cell, y_cell_offset);
+			pattern_data = T_Get_Pattern_Data_Cached<interlaced>(&nametable_word, y_fine_offset);
 		} else {
-			// Scroll A. Check if we need to emulate the Left Window bug.
-			if (LeftWindowBugCnt <= 0) {
-				// Left Window bug doesn't apply or has already been emulated.
-				nametable_word = T_Get_Nametable_Word<plane>(x_cell_offset, y_cell_offset);
-			} else {
-				// Left Window bug applies.
-				LeftWindowBugCnt--;
-				const unsigned int TmpXCell = ((x_cell_offset + 2) & H_Scroll_CMask);
-				nametable_word = T_Get_Nametable_Word<plane>(TmpXCell, y_cell_offset);
-			}
+			nametable_word = T_Get_Nametable_Word<plane>(x_cell, y_cell_offset);
+			pattern_data = T_Get_Pattern_Data<interlaced>(nametable_word, y_fine_offset);
 		}
 
-		// Get the pattern data for the current tile.
-		uint32_t pattern_data = T_Get_Pattern_Data<interlaced>(nametable_word, y_fine_offset);
-
 		// Extract the palette number.
 		// Resulting number is palette * 16.
 		unsigned int palette = (nametable_word >> 9) & 0x30;
@@ -856,8 +1199,13 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_ScrollA_Window(void)
 		// Loop through the cells.
 		for (int x = Win_Length; x > 0; x--, disp_pixnum += 8) {
 			// Get the pattern info and data for the current tile.
-			register uint16_t pattern_info = *Win_Row_Addr++;
-			uint32_t pattern_data = T_Get_Pattern_Data<interlaced>(pattern_info, y_fine_offset);
+			uint16_t pattern_info = *Win_Row_Addr++;
+			uint32_t pattern_data;
+			if (patternCache) {
+				pattern_data = T_Get_Pattern_Data_Cached<interlaced>(&pattern_info, y_fine_offset);
+			} else {
+				pattern_data = T_Get_Pattern_Data<interlaced>(pattern_info, y_fine_offset);
+			}
 
 			// Extract the palette number.
 			// Resulting number is palette * 16.
@@ -980,6 +1328,15 @@ unsigned int VdpPrivate::T_Update_Sprite_Line_Cache_m5(int line)
 	SprLineCache_t *cache = &sprLineCache[cacheId][0];
 	uint8_t count = 0;
 
+	if (lineSkip) {
+		// Save the inputs for this sprite line cache.
+		VdpLineSkip::SprSig *sig = &sprLineCacheSig[cacheId];
+		sig->vramGen = vramGen;
+		sig->regGen = regGen;
+		sig->line = line;
+		sig->spriteLimits = q->options.spriteLimits;
+	}
+
 	/**
 	 * The following values are read from the cached
 	 * Sprite Attribute Table instead of VRAM:
@@ -1204,15 +1561,13 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_Sprite(void)
 			if ((VDP_Layers & VdpTypes::VDP_LAYER_SPRITE_ALWAYSONTOP) || (spr_info & 0x8000)) {
 				// High priority.
 				for (; H_Pos_Max >= H_Pos_Min; H_Pos_Max -= 8) {
-					uint32_t pattern = Spr_Gen_Addr_u32(tile_num);
-					T_PutLine_Sprite<true, h_s, true>(H_Pos_Max, pattern, palette);
+					T_PutLine_Sprite_Gen<true, h_s, true>(H_Pos_Max, tile_num, palette);
 					tile_num += Y_cell_size;
 				}
 			} else {
 				// Low priority.
 				for (; H_Pos_Max >= H_Pos_Min; H_Pos_Max -= 8) {
-					uint32_t pattern = Spr_Gen_Addr_u32(tile_num);
-					T_PutLine_Sprite<false, h_s, true>(H_Pos_Max, pattern, palette);
+					T_PutLine_Sprite_Gen<false, h_s, true>(H_Pos_Max, tile_num, palette);
 					tile_num += Y_cell_size;
 				}
 			}
@@ -1230,15 +1585,13 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_Sprite(void)
 			if ((VDP_Layers & VdpTypes::VDP_LAYER_SPRITE_ALWAYSONTOP) || (spr_info & 0x8000)) {
 				// High priority.
 				for (; H_Pos_Min < H_Pos_Max; H_Pos_Min += 8) {
-					uint32_t pattern = Spr_Gen_Addr_u32(tile_num);
-					T_PutLine_Sprite<true, h_s, false>(H_Pos_Min, pattern, palette);
+					T_PutLine_Sprite_Gen<true, h_s, false>(H_Pos_Min, tile_num, palette);
 					tile_num += Y_cell_size;
 				}
 			} else {
 				// Low priority.
 				for (; H_Pos_Min < H_Pos_Max; H_Pos_Min += 8) {
-					uint32_t pattern = Spr_Gen_Addr_u32(tile_num);
-					T_PutLine_Sprite<false, h_s, false>(H_Pos_Min, pattern, palette);
+					T_PutLine_Sprite_Gen<false, h_s, false>(H_Pos_Min, tile_num, palette);
 					tile_num += Y_cell_size;
 				}
 			}
@@ -1278,6 +1631,67 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_m5(void)
 	T_Render_Line_Sprite<interlaced, h_s>();
 }
 
+#ifdef VDP_RENDER_HAS_AVX2
+/**
+ * Render line buffer pixels to the destination surface. (AVX2, 32-bit color)
+ * @param dest Destination surface.
+ * @param src Line buffer.
+ * @param md_palette MD palette buffer. (256 entries)
+ * @param count Number of pixels. (Must be a multiple of 16.)
+ */
+__attribute__((target("avx2")))
+static void Render_LineBuf_AVX2(uint32_t *dest, const uint16_t *src,
+				const uint32_t *md_palette, int count)
+{
+	const __m256i px_mask = _mm256_set1_epi32(0xFF);
+	for (; count > 0; count -= 16, dest += 16, src += 16) {
+		const __m256i idx0 = _mm256_and_si256(px_mask,
+			_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+		const __m256i idx1 = _mm256_and_si256(px_mask,
+			_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+8))));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest),
+			_mm256_i32gather_epi32(reinterpret_cast<const int*>(md_palette), idx0, 4));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest+8),
+			_mm256_i32gather_epi32(reinterpret_cast<const int*>(md_palette), idx1, 4));
+	}
+}
+
+/**
+ * Render line buffer pixels to the destination surface. (AVX2, 16-bit color)
+ * @param dest Destination surface.
+ * @param src Line buffer.
+ * @param md_palette MD palette buffer. (256 entries)
+ * @param count Number of pixels. (Must be a multiple of 16.)
+ */
+__attribute__((target("avx2")))
+static void Render_LineBuf_AVX2(uint16_t *dest, const uint16_t *src,
+				const uint16_t *md_palette, int count)
+{
+	// NOTE: The gather loads 32 bits per pixel, so the last palette
+	// entry reads 2 bytes past the end of the 16-bit palette.
+	// VdpPalette::m_palActive is a union with the 32-bit palette,
+	// so this is still within the palette buffer.
+	const __m256i px_mask = _mm256_set1_epi32(0xFF);
+	const __m256i color_mask = _mm256_set1_epi32(0xFFFF);
+	for (; count > 0; count -= 16, dest += 16, src += 16) {
+		const __m256i idx0 = _mm256_and_si256(px_mask,
+			_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+		const __m256i idx1 = _mm256_and_si256(px_mask,
+			_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+8))));
+		const __m256i c0 = _mm256_and_si256(color_mask,
+			_mm256_i32gather_epi32(reinterpret_cast<const int*>(md_palette), idx0, 2));
+		const __m256i c1 = _mm256_and_si256(color_mask,
+			_mm256_i32gather_epi32(reinterpret_cast<const int*>(md_palette), idx1, 2));
+
+		// packus works within 128-bit lanes, so the
+		// 64-bit blocks have to be reordered afterwards.
+		const __m256i packed = _mm256_permute4x64_epi64(
+			_mm256_packus_epi32(c0, c1), _MM_SHUFFLE(3,1,2,0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), packed);
+	}
+}
+#endif /* VDP_RENDER_HAS_AVX2 */
+
 /**
  * Render the line buffer to the destination surface.
  * @param pixel Type of pixel.
@@ -1287,20 +1701,28 @@ FORCE_INLINE void VdpPrivate::T_Render_Line_m5(void)
 template<typename pixel>
 FORCE_INLINE void VdpPrivate::T_Render_LineBuf(pixel *dest, pixel *md_palette)
 {
-	const LineBuf_t::LineBuf_px_t *src = &LineBuf.px[8];
-
 	// Render the line buffer to the destination surface.
 	dest += H_Pix_Begin;
-	const pixel *dest_end = dest + H_Pix;
-	for (; dest < dest_end; dest += 8, src += 8) {
-		*(dest+0) = md_palette[src->pixel];
-		*(dest+1) = md_palette[(src+1)->pixel];
-		*(dest+2) = md_palette[(src+2)->pixel];
-		*(dest+3) = md_palette[(src+3)->pixel];
-		*(dest+4) = md_palette[(src+4)->pixel];
-		*(dest+5) = md_palette[(src+5)->pixel];
-		*(dest+6) = md_palette[(src+6)->pixel];
-		*(dest+7) = md_palette[(src+7)->pixel];
+#ifdef VDP_RENDER_HAS_AVX2
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		// AVX2: Look up 16 pixels at a time.
+		Render_LineBuf_AVX2(dest, &LineBuf.u16[8], md_palette, H_Pix);
+		dest += H_Pix;
+	} else
+#endif /* VDP_RENDER_HAS_AVX2 */
+	{
+		const LineBuf_t::LineBuf_px_t *src = &LineBuf.px[8];
+		const pixel *dest_end = dest + H_Pix;
+		for (; dest < dest_end; dest += 8, src += 8) {
+			*(dest+0) = md_palette[src->pixel];
+			*(dest+1) = md_palette[(src+1)->pixel];
+			*(dest+2) = md_palette[(src+2)->pixel];
+			*(dest+3) = md_palette[(src+3)->pixel];
+			*(dest+4) = md_palette[(src+4)->pixel];
+			*(dest+5) = md_palette[(src+5)->pixel];
+			*(dest+6) = md_palette[(src+6)->pixel];
+			*(dest+7) = md_palette[(src+7)->pixel];
+		}
 	}
 
 	if (H_Pix_Begin == 0)
@@ -1316,7 +1738,7 @@ FORCE_INLINE void VdpPrivate::T_Render_LineBuf(pixel *dest, pixel *md_palette)
 	// Left border.
 	dest -= H_Pix_Begin;
 	dest -= H_Pix;
-	dest_end = dest + H_Pix_Begin;
+	const pixel *dest_end = dest + H_Pix_Begin;
 	for (; dest < dest_end; dest += 8) {
 		*(dest+0) = border_color;
 		*(dest+1) = border_color;
@@ -1435,10 +1857,55 @@ void VdpPrivate::renderLine_m5(void)
 				(q->MD_Screen->pxPerLine() * sizeof(uint32_t)));
 		}
 
+		if (lineSkip) {
+			// This line wasn't rendered normally.
+			VdpLineSkip::Line *rec = lineSkip->line(q->MD_Screen, lineNum);
+			if (rec) {
+				rec->valid = false;
+			}
+		}
+
 		// ...and we're done here.
 		return;
 	}
 
+	// Update the active palette.
+	// NOTE: The line buffer doesn't depend on the palette,
+	// so this is done before rendering for VdpLineSkip.
+	// FIXME: If palette is locked and bpp is changed, convert it.
+	if (!(VDP_Layers & VdpTypes::VDP_LAYER_PALETTE_LOCK)) {
+		if (!q->options.updatePaletteInVBlankOnly || in_border) {
+			if (palette.bpp() != q->MD_Screen->bpp())
+				palette.setBpp(q->MD_Screen->bpp());
+			else
+				palette.update();
+		}
+	}
+
+	// Check if this line can be skipped.
+	VdpLineSkip::Line *rec = nullptr;
+	VdpLineSkip::Sig sig;
+	bool skip = false;
+	if (lineSkip) {
+		rec = lineSkip->line(q->MD_Screen, lineNum);
+		if (rec) {
+			memset(&sig, 0, sizeof(sig));
+			sig.vramGen = vramGen;
+			sig.vsramGen = vsramGen;
+			sig.regGen = regGen;
+			sig.palGen = palette.activeGen();
+			sig.vdpLine = q->VDP_Lines.currentLine;
+			sig.layers = VDP_Layers;
+			sig.status = Reg_Status.read_raw() &
+				(VdpStatus::VDP_STATUS_PAL | VdpStatus::VDP_STATUS_ODD);
+			sig.bpp = (uint8_t)q->MD_Screen->bpp();
+			sig.sprDotOverflow = sprDotOverflow;
+			memcpy(sig.spr, sprLineCacheSig, sizeof(sig.spr));
+			memcpy(&sig.options, &q->options, sizeof(sig.options));
+			skip = (rec->valid && !memcmp(&rec->sig, &sig, sizeof(sig)));
+		}
+	}
+
 	// Check if the VDP is enabled.
 	if (!(VDP_Reg.m5.Set2 & VDP_REG_M5_SET2_DISP) || in_border) {
 		// VDP is disabled, or this is the border region.
@@ -1446,36 +1913,67 @@ void VdpPrivate::renderLine_m5(void)
 
 		// NOTE: S/H is ignored if the VDP is disabled or if
 		// we're in the border region.
-		memset(LineBuf.u8, 0x00, sizeof(LineBuf.u8));
+		if (!skip) {
+			memset(LineBuf.u8, 0x00, sizeof(LineBuf.u8));
+		}
 
 		// Clear the sprite dot overflow variable.
 		sprDotOverflow = false;
 	} else {
 		// VDP is enabled.
+		if (skip) {
+			// Line hasn't changed.
+			// Replay the side effects of rendering it.
+			if (rec->collision) {
+				Reg_Status.setBit(VdpStatus::VDP_STATUS_COLLISION, true);
+			}
+			sprDotOverflow = rec->sprDotOverflow;
+		} else {
+			// Clear the collision flag so the line's own
+			// collision can be saved for VdpLineSkip.
+			const uint16_t collision = (Reg_Status.read_raw() & VdpStatus::VDP_STATUS_COLLISION);
+			if (rec) {
+				Reg_Status.setBit(VdpStatus::VDP_STATUS_COLLISION, false);
+			}
 
-		// Determine how to render the image.
-		int RenderMode = ((VDP_Reg.m5.Set4 & VDP_REG_M5_SET4_STE) >> 2);	// Shadow/Highlight
-		RenderMode |= !!im2_flag;						// Interlaced.
-		switch (RenderMode & 3) {
-			case 0:
-				// H/S disabled; normal display.
-				T_Render_Line_m5<false, false>();
-				break;
-			case 1:
-				// H/S disabled: Interlaced Mode 2.
-				T_Render_Line_m5<true, false>();
-				break;
-			case 2:
-				// H/S enabled; normal display.
-				T_Render_Line_m5<false, true>();
-				break;
-			case 3:
-				// H/S enabled: Interlaced Mode 2.
-				T_Render_Line_m5<true, true>();
-				break;
-			default:
-				// to make gcc shut up
-				break;
+			if (patternCache) {
+				// Decode pattern lines that changed since the last line.
+				patternCache->update_m5(&VRam);
+			}
+
+			// Determine how to render the image.
+			int RenderMode = ((VDP_Reg.m5.Set4 & VDP_REG_M5_SET4_STE) >> 2);	// Shadow/Highlight
+			RenderMode |= !!im2_flag;						// Interlaced.
+			switch (RenderMode & 3) {
+				case 0:
+					// H/S disabled; normal display.
+					T_Render_Line_m5<false, false>();
+					break;
+				case 1:
+					// H/S disabled: Interlaced Mode 2.
+					T_Render_Line_m5<true, false>();
+					break;
+				case 2:
+					// H/S enabled; normal display.
+					T_Render_Line_m5<false, true>();
+					break;
+				case 3:
+					// H/S enabled: Interlaced Mode 2.
+					T_Render_Line_m5<true, true>();
+					break;
+				default:
+					// to make gcc shut up
+					break;
+			}
+
+			if (rec) {
+				// Save the side effects.
+				rec->collision = !!(Reg_Status.read_raw() & VdpStatus::VDP_STATUS_COLLISION);
+				rec->sprDotOverflow = sprDotOverflow;
+				if (collision) {
+					Reg_Status.setBit(VdpStatus::VDP_STATUS_COLLISION, true);
+				}
+			}
 		}
 
 		// Update the sprite line cache for the next line.
@@ -1489,15 +1987,10 @@ void VdpPrivate::renderLine_m5(void)
 		}
 	}
 
-	// Update the active palette.
-	// FIXME: If palette is locked and bpp is changed, convert it.
-	if (!(VDP_Layers & VdpTypes::VDP_LAYER_PALETTE_LOCK)) {
-		if (!q->options.updatePaletteInVBlankOnly || in_border) {
-			if (palette.bpp() != q->MD_Screen->bpp())
-				palette.setBpp(q->MD_Screen->bpp());
-			else
-				palette.update();
-		}
+	if (skip) {
+		// Line is unchanged. Keep the existing image.
+		lineSkip->stats.skipped++;
+		return;
 	}
 
 	// Render the image.
@@ -1523,6 +2016,13 @@ void VdpPrivate::renderLine_m5(void)
 				(q->options.borderColorEmulation ? palette.m_palActive.u32[0] : 0));
 		}
 	}
+
+	if (rec) {
+		// Save the line signature.
+		memcpy(&rec->sig, &sig, sizeof(rec->sig));
+		rec->valid = true;
+		lineSkip->stats.rendered++;
+	}
 }
 
 // TODO: 32X stuff.
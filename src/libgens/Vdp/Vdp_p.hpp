@@ -26,6 +26,8 @@
 
 #include <stdint.h>
 #include "libcompat/byteorder.h"
+// Needed for LIBCOMPAT_HAS_X86_TARGET_INTRINSICS.
+#include "libcompat/cpuflags.h"
 
 // Needed for FORCE_INLINE.
 #include "../macros/common.h"
@@ -36,16 +38,37 @@
 #include "VdpPalette.hpp"
 #include "VdpStatus.hpp"
 #include "VdpStructs.hpp"
+#include "VdpPlaneCache.hpp"
+#include "VdpCache.hpp"
+#include "VdpLineSkip.hpp"
 
 #include "VdpRend_Err_p.hpp"
 
+// SSE2-optimized Mode 5 layer compositor.
+// SSE2 intrinsics are inlined into the renderer,
+// so this requires a compiler that targets SSE2.
+// (Always the case on amd64.)
+// The x86 CPU flags are checked at runtime.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VDP_RENDER_HAS_SSE2 1
+#endif
+
+// AVX2-optimized line buffer palette lookup.
+// This uses function-level target attributes,
+// so it doesn't require compiling with -mavx2.
+#ifdef LIBCOMPAT_HAS_X86_TARGET_INTRINSICS
+#define VDP_RENDER_HAS_AVX2 1
+#endif
+
 namespace LibGens {
 
 class Vdp;
+class EmuContext;
 class VdpPrivate
 {
 	public:
-		VdpPrivate(Vdp *q);
+		VdpPrivate(Vdp *q, EmuContext *context);
 		~VdpPrivate();
 
 	protected:
@@ -58,6 +81,10 @@ class VdpPrivate
 		VdpPrivate &operator=(const VdpPrivate &);
 
 	public:
+		// Emulation context this VDP belongs to.
+		// May be nullptr if the VDP is used standalone.
+		EmuContext *const context;
+
 		// Default VDP emulation options.
 		static const VdpTypes::VdpEmuOptions_t def_vdpEmuOptions;
 
@@ -149,6 +176,72 @@ class VdpPrivate
 		VdpTypes::VRam_t VRam;
 		VdpTypes::VSRam_t VSRam;
 
+		// Mode 5 scroll plane row cache.
+		// nullptr if the cache is disabled.
+		VdpPlaneCache *planeCache;
+
+		// Pattern cache. (pre-H-flipped pattern lines)
+		// nullptr if the cache is disabled.
+		VdpCache *patternCache;
+
+		// Skip-unchanged-line state.
+		// nullptr if line skipping is disabled.
+		VdpLineSkip *lineSkip;
+
+		/**
+		 * Generation counters.
+		 * These are incremented whenever the contents change.
+		 * Writes that don't change anything are ignored.
+		 * Used by VdpLineSkip.
+		 */
+		uint32_t vramGen;	// VRAM and SAT cache.
+		uint32_t vsramGen;	// VSRAM.
+		uint32_t regGen;	// Registers 0-18.
+
+		/**
+		 * VRAM contents have changed.
+		 * This must be called after writing a different value to VRAM.
+		 * @param address VRAM address.
+		 */
+		inline void vramChanged(uint32_t address)
+		{
+			vramGen++;
+			if (planeCache)
+				planeCache->vramWrite(address);
+			if (patternCache)
+				patternCache->vramWrite(address);
+		}
+
+		/**
+		 * A range of VRAM has changed.
+		 * This must be called after writing different values to VRAM.
+		 * @param address First VRAM address.
+		 * @param len Length, in bytes. Must not wrap around the end of VRAM.
+		 */
+		inline void vramChangedRange(uint32_t address, uint32_t len)
+		{
+			vramGen++;
+			if (planeCache)
+				planeCache->vramWriteRange(address, len);
+			if (patternCache)
+				patternCache->vramWriteRange(address, len);
+		}
+
+		/**
+		 * VRAM was modified without vramChanged(),
+		 * e.g. on reset or when loading a savestate.
+		 */
+		inline void vramReloaded(void)
+		{
+			vramGen++;
+			vsramGen++;
+			regGen++;
+			if (planeCache)
+				planeCache->invalidate();
+			if (patternCache)
+				patternCache->invalidate();
+		}
+
 		int HInt_Counter;	// Horizontal Interrupt Counter.
 		int VDP_Int;		// VDP interrupt state.
 		VdpStatus Reg_Status;	// VDP status register.
@@ -409,6 +502,44 @@ class VdpPrivate
 		template<DMA_Src_t src_component, DMA_Dest_t dest_component>
 		inline void T_DMA_Loop(void);
 
+		/**
+		 * Use the bulk DMA paths if possible?
+		 * This is only disabled for comparison testing.
+		 */
+		bool dmaBulk;
+
+		/**
+		 * Mem-to-VRAM DMA: Copy a contiguous span of words, if possible.
+		 * Requires auto-increment 2, an even VRAM address,
+		 * and a source that can be accessed directly.
+		 * @param src_component Source component.
+		 * @param src_word_address Source word address.
+		 * @param src_base_address Source base address, for 128 KB wrapping.
+		 * @param length Number of words left.
+		 * @return Number of words copied. (0 if the word-by-word path must be used)
+		 */
+		template<DMA_Src_t src_component>
+		inline unsigned int T_DMA_Bulk_VRam(uint16_t src_word_address,
+			unsigned int src_base_address, unsigned int length);
+
+		/**
+		 * Write a span of words to VRAM for DMA.
+		 * Handles cache invalidation and the Sprite Attribute Table cache.
+		 * @param src Source words. (host-endian)
+		 * @param address Even VRAM address.
+		 * @param words Number of words. Must not wrap around the end of VRAM.
+		 */
+		void DMA_Write_VRam_Span(const uint16_t *src, uint32_t address, unsigned int words);
+
+		/**
+		 * Fill a span of VRAM for DMA FILL.
+		 * Handles cache invalidation and the Sprite Attribute Table cache.
+		 * @param address Even VRAM address.
+		 * @param len Even length, in bytes. Must not wrap around the end of VRAM.
+		 * @param fill Fill byte.
+		 */
+		void DMA_Fill_VRam_Span(uint32_t address, uint32_t len, uint8_t fill);
+
 		void processDmaCtrlWrite(void);
 
 	/*!**************************************************************
@@ -509,6 +640,9 @@ class VdpPrivate
 		 */
 		SprLineCache_t sprLineCache[2][80];
 
+		// Sprite line cache signatures. (Used by VdpLineSkip.)
+		VdpLineSkip::SprSig sprLineCacheSig[2];
+
 		// Sprite count cache.
 		// Includes both the current line and the next line.
 		uint8_t sprCountCache[2];
@@ -543,6 +677,22 @@ class VdpPrivate
 		template<bool priority, bool h_s, bool flip>
 		FORCE_INLINE void T_PutLine_Sprite(int disp_pixnum, uint32_t pattern, int palette);
 
+		template<bool priority, bool h_s, bool flip>
+		FORCE_INLINE void T_PutLine_Sprite_Gen(int disp_pixnum, uint32_t offset, int palette);
+
+#ifdef VDP_RENDER_HAS_SSE2
+		// SSE2 versions of the line functions.
+		// These process all eight pixels of a pattern line at once.
+		template<bool plane, bool h_s, bool flip>
+		FORCE_INLINE void T_PutLine_P0_SSE2(int disp_pixnum, uint32_t pattern, int palette);
+
+		template<bool plane, bool flip>
+		FORCE_INLINE void T_PutLine_P1_SSE2(int disp_pixnum, uint32_t pattern, int palette);
+
+		template<bool priority, bool h_s, bool flip>
+		FORCE_INLINE void T_PutLine_Sprite_SSE2(int disp_pixnum, uint32_t pattern, int palette);
+#endif /* VDP_RENDER_HAS_SSE2 */
+
 		template<bool plane>
 		FORCE_INLINE uint16_t T_Get_X_Offset(void);
 
@@ -558,9 +708,19 @@ class VdpPrivate
 		template<bool plane>
 		FORCE_INLINE uint16_t T_Get_Nametable_Word(unsigned int x, unsigned int y);
 
+		template<bool interlaced>
+		FORCE_INLINE unsigned int T_Get_Pattern_Addr(uint16_t pattern, unsigned int y_fine_offset);
+
 		template<bool interlaced>
 		FORCE_INLINE uint32_t T_Get_Pattern_Data(uint16_t pattern, unsigned int y_fine_offset);
 
+		template<bool interlaced>
+		FORCE_INLINE uint32_t T_Get_Pattern_Data_Cached(uint16_t *pattern, unsigned int y_fine_offset);
+
+		template<bool plane, bool interlaced>
+		FORCE_INLINE uint32_t T_Get_Cell_Cached(unsigned int x, unsigned int y_cell_offset,
+			unsigned int y_fine_offset, uint16_t *nametable_word);
+
 		template<bool plane, bool interlaced, bool vscroll, bool h_s>
 		FORCE_INLINE void T_Render_Line_Scroll(int cell_start, int cell_length);
 
@@ -33,6 +33,9 @@
 /* Define to 1 if CPU emulation code should be enabled. */
 #define GENS_ENABLE_EMULATION 1
 
+/* Define to 1 if the frame profiler should be enabled. */
+/* #undef GENS_ENABLE_PROFILER */
+
 /* CMake version macros. */
 #define VERSION_MAJOR 0
 #define VERSION_MINOR 0
@@ -29,43 +29,42 @@
 #include "macros/common.h"
 #include "Cartridge/RomCartridgeMD.hpp"
 
+// EmuContext.
+// Needed for the VDP interrupt acknowledge.
+#include "EmuContext/EmuContext.hpp"
+#include "Vdp/Vdp.hpp"
+
+// ZOMG
+#include "libzomg/ZomgMem.hpp"
+
 // C includes. (C++ namespace)
 #include <cstring>
 
 namespace LibGens {
 
-m68ki_cpu_core M68K::ms_Context;
-int M68K::m_cycleCnt;
-int M68K::m_intVectors[8];
-
-// Last system ID.
-M68K::SysID M68K::ms_LastSysID = SYSID_NONE;
-
-
 // C wrapper functions for Starscream.
+// param == M68K_Mem*
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 static unsigned int Gens_M68K_RB(void *param, unsigned int address)
 {
-	return LibGens::M68K_Mem::M68K_RB(address);
+	return ((LibGens::M68K_Mem*)param)->M68K_RB(address);
 }
 static unsigned int Gens_M68K_RW(void *param, unsigned int address)
 {
-	return LibGens::M68K_Mem::M68K_RW(address);
+	return ((LibGens::M68K_Mem*)param)->M68K_RW(address);
 }
 static void Gens_M68K_WB(void *param, unsigned int address, unsigned int data)
 {
-	LibGens::M68K_Mem::M68K_WB(address, data);
+	((LibGens::M68K_Mem*)param)->M68K_WB(address, data);
 }
 static void Gens_M68K_WW(void *param, unsigned int address, unsigned int data)
 {
-	LibGens::M68K_Mem::M68K_WW(address, data);
+	((LibGens::M68K_Mem*)param)->M68K_WW(address, data);
 }
 
-uint8_t VDP_Int_Ack(void);
-
 #ifdef __cplusplus
 }
 #endif
@@ -81,11 +80,13 @@ void M68K::M68K_Reset_Handler(m68ki_cpu_core *cpu)
 
 int M68K::M68K_Int_Ack(m68ki_cpu_core *cpu, int int_level)
 {
+	// cpu->device == M68K*
+	M68K *const m68k = (M68K*)cpu->device;
 	if ( (int_level == 4) || (int_level == 6) )
-		VDP_Int_Ack();
+		m68k->m_context->m_vdp->Int_Ack();
 
 	m68k_set_irq(cpu, int_level, RESET_LINE);
-	return m_intVectors[int_level];
+	return m68k->m_intVectors[int_level];
 }
 
 static unsigned int dummy_read(void *param, unsigned int address)
@@ -103,7 +104,7 @@ static void dummy_write(void *param, unsigned int address, unsigned int data)
 }
 
 
-void M68K::SetFetch(unsigned low_addr, unsigned high_addr, void *base)
+void M68K::setFetch(unsigned low_addr, unsigned high_addr, void *base)
 {
 	unsigned i;
 
@@ -112,48 +113,48 @@ void M68K::SetFetch(unsigned low_addr, unsigned high_addr, void *base)
 	{
 		if ( i >= 256 )
 			return;
-		ms_Context.memory_map[i].base = (unsigned char *)base;
+		m_core.memory_map[i].base = (unsigned char *)base;
 		base += 0x10000;
 	}
 }
 
-void M68K::SetMemReadFunc(unsigned low_addr, unsigned high_addr,
+void M68K::setMemReadFunc(unsigned low_addr, unsigned high_addr,
 	unsigned int (*read8)(void *param, unsigned int address),
 	unsigned int (*read16)(void *param, unsigned int address))
 {
 	int i;
 	for ( i = (low_addr >> 16); i <= (high_addr >> 16); i ++ )
 	{
-		ms_Context.memory_map[i].read8 = read8;
-		ms_Context.memory_map[i].read16 = read16;
+		m_core.memory_map[i].read8 = read8;
+		m_core.memory_map[i].read16 = read16;
 	}
 }
 
-void M68K::SetMemWriteFunc(unsigned low_addr, unsigned high_addr,
+void M68K::setMemWriteFunc(unsigned low_addr, unsigned high_addr,
 	void (*write8)(void *param, unsigned int address, unsigned int data),
 	void (*write16)(void *param, unsigned int address, unsigned int data))
 {
 	int i;
 	for ( i = (low_addr >> 16); i <= (high_addr >> 16); i ++ )
 	{
-		ms_Context.memory_map[i].write8 = write8;
-		ms_Context.memory_map[i].write16 = write16;
+		m_core.memory_map[i].write8 = write8;
+		m_core.memory_map[i].write16 = write16;
 	}
 }
 
 /**
  * Initialize the M68K CPU emulator.
+ * This builds the Musashi opcode tables, which are
+ * shared by all M68K instances.
  */
 void M68K::Init(void)
 {
-	// Clear the 68000 context.
-	memset( &ms_Context, 0, sizeof(ms_Context) );
-	
-	m68k_init(&ms_Context);
-	
-	ms_Context.reset_instr_callback = M68K_Reset_Handler;
-	
-	ms_Context.int_ack_callback = M68K_Int_Ack;
+	// m68k_init() builds the opcode tables on first use.
+	// Do it here so multiple emulation contexts don't
+	// race to build them later.
+	m68ki_cpu_core core;
+	memset(&core, 0, sizeof(core));
+	m68k_init(&core);
 }
 
 /**
@@ -164,70 +165,101 @@ void M68K::End(void)
 	// TODO
 }
 
+/**
+ * Initialize an M68K CPU.
+ * @param context Emulation context this CPU belongs to.
+ */
+M68K::M68K(EmuContext *context)
+	: m_context(context)
+	, m_cycleCnt(0)
+	, m_lastSysID(SYSID_NONE)
+{
+	// Clear the 68000 context.
+	memset(&m_core, 0, sizeof(m_core));
+	memset(m_intVectors, 0, sizeof(m_intVectors));
+
+	m68k_init(&m_core);
+
+	m_core.reset_instr_callback = M68K_Reset_Handler;
+
+	m_core.int_ack_callback = M68K_Int_Ack;
+	m_core.device = this;
+}
+
+M68K::~M68K()
+{
+	// Free the decoded instruction cache.
+	m68k_set_decode_cache(&m_core, 0);
+}
+
 /**
  * Initialize a specific system for the M68K CPU emulator.
  * @param system System ID.
  */
-void M68K::InitSys(SysID system)
+void M68K::initSys(SysID system)
 {
 	m_cycleCnt = 0;
 	
 	// TODO: This is not 64-bit clean!
-	ms_LastSysID = system;
+	m_lastSysID = system;
 
 	// Clear M68K RAM.
-	memset(Ram_68k.u8, 0x00, sizeof(Ram_68k.u8));
-	
+	M68K_Mem *const m68kMem = m_context->m_m68kMem;
+	memset(m68kMem->Ram_68k.u8, 0x00, sizeof(m68kMem->Ram_68k.u8));
+
 	// Initialize the memory handlers.
-	SetMemReadFunc(0x000000, 0xFEFFFF, Gens_M68K_RB, Gens_M68K_RW);
-	SetMemWriteFunc(0x000000, 0xFEFFFF, Gens_M68K_WB, Gens_M68K_WW);
-	SetFetch(0xFF0000, 0xFFFFFF, Ram_68k.u8);
+	for (int i = 0; i < ARRAY_SIZE(m_core.memory_map); i++) {
+		m_core.memory_map[i].param = m68kMem;
+	}
+	setMemReadFunc(0x000000, 0xFEFFFF, Gens_M68K_RB, Gens_M68K_RW);
+	setMemWriteFunc(0x000000, 0xFEFFFF, Gens_M68K_WB, Gens_M68K_WW);
+	setFetch(0xFF0000, 0xFFFFFF, m68kMem->Ram_68k.u8);
 
 	// Initialize the M68K memory handlers.
-	M68K_Mem::InitSys(system);
+	m68kMem->initSys(system);
 
 	// Initialize M68K RAM handlers.
 	for (int i = 0; i < 32; i++) {
 		uint32_t ram_addr = (0xE00000 | (i << 16));
-		SetFetch(ram_addr, ram_addr | 0xFFFF, Ram_68k.u8);
+		setFetch(ram_addr, ram_addr | 0xFFFF, m68kMem->Ram_68k.u8);
 	}
 
 	// Update the system-specific banking setup.
-	UpdateSysBanking();
+	updateSysBanking();
 
 	// Reset the M68K CPU.
-	Reset();
+	reset();
 }
 
 /**
  * Shut down M68K emulation.
  */
-void M68K::EndSys(void)
+void M68K::endSys(void)
 {
 	/*for (int i = 0; i < 256; i++) {
-		ms_Context.memory_map[i].base = NULL;
-		ms_Context.memory_map[i].read8 = dummy_read;
-		ms_Context.memory_map[i].read16 = dummy_read;
-		ms_Context.memory_map[i].write8 = dummy_write;
-		ms_Context.memory_map[i].write16 = dummy_write;
+		m_core.memory_map[i].base = NULL;
+		m_core.memory_map[i].read8 = dummy_read;
+		m_core.memory_map[i].read16 = dummy_read;
+		m_core.memory_map[i].write8 = dummy_write;
+		m_core.memory_map[i].write16 = dummy_write;
 	}*/
-	memset( ms_Context.memory_map, 0, sizeof(ms_Context.memory_map) );
+	memset( m_core.memory_map, 0, sizeof(m_core.memory_map) );
 }
 
 /**
  * Update system-specific memory banking.
- * Uses the last system initialized via InitSys().
+ * Uses the last system initialized via initSys().
  */
-void M68K::UpdateSysBanking(void)
+void M68K::updateSysBanking(void)
 {
 	// Start at M68K_Fetch[0x20].
 	int cur_fetch = 0x20;
-	switch (ms_LastSysID) {
+	switch (m_lastSysID) {
 		case SYSID_MD:
 		case SYSID_PICO:
 			// Sega Genesis / Mega Drive.
 			// Also Pico. (This only adds cartridge ROM.)
-			cur_fetch += M68K_Mem::UpdateSysBanking(10);
+			cur_fetch += m_context->m_m68kMem->updateSysBanking(10);
 			break;
 
 		case SYSID_MCD:
@@ -270,32 +302,82 @@ void M68K::UpdateSysBanking(void)
 
 	// FIXME: Make sure Starscream's internal program counter
 	// is updated to reflect the updated M68K_Fetch[].
+
+	// Fetch pointers may have changed.
+	updateDecodePages();
+}
+
+/**
+ * Enable or disable the decoded instruction cache.
+ * If enabled, opcode handlers for ROM and RAM are
+ * cached by PC, so straight-line code isn't decoded
+ * again on every pass. Emulation is bit-exact either way.
+ * @param enable True to enable; false to disable.
+ * @return 0 on success; non-zero on error.
+ */
+int M68K::setDecodeCache(bool enable)
+{
+	int ret = m68k_set_decode_cache(&m_core, enable);
+	if (ret != 0)
+		return ret;
+
+	updateDecodePages();
+	return 0;
+}
+
+/**
+ * Update the decoded instruction cache page types.
+ * This also flushes the cache.
+ * Must be called whenever the fetch pointers change.
+ */
+void M68K::updateDecodePages(void)
+{
+	const unsigned char *const ram = m_context->m_m68kMem->Ram_68k.u8;
+	const unsigned char *const ram_end = ram + sizeof(m_context->m_m68kMem->Ram_68k.u8);
+
+	for (int i = 0; i < ARRAY_SIZE(m_core.memory_map); i++) {
+		const unsigned char *const base = m_core.memory_map[i].base;
+		int type;
+		if (!base) {
+			// Nothing is mapped here.
+			type = M68K_DECODE_PAGE_NONE;
+		} else if (base >= ram && base < ram_end) {
+			// M68K RAM. Code may be modified.
+			type = M68K_DECODE_PAGE_RAM;
+		} else {
+			// ROM. (cartridge or TMSS)
+			type = M68K_DECODE_PAGE_ROM;
+		}
+		m68k_set_decode_page(&m_core, i, type);
+	}
+
+	m68k_flush_decode_cache(&m_core);
 }
 
 /** ZOMG savestate functions. **/
 
 /**
- * ZomgSaveReg(): Save the M68K registers.
+ * Save the M68K registers.
  * @param state Zomg_M68KRegSave_t struct to save to.
  */
-void M68K::ZomgSaveReg(Zomg_M68KRegSave_t *state)
+void M68K::zomgSaveReg(Zomg_M68KRegSave_t *state)
 {
 	// NOTE: Byteswapping is done in libzomg.
 	int i;
 	
 	// Save the main registers.
 	for (i = 0; i < 8; i++)
-		state->dreg[i] = m68k_get_reg(&ms_Context, (m68k_register_t)(M68K_REG_D0 + i));
+		state->dreg[i] = m68k_get_reg(&m_core, (m68k_register_t)(M68K_REG_D0 + i));
 	for (i = 0; i < 7; i++)
-		state->areg[i] = m68k_get_reg(&ms_Context, (m68k_register_t)(M68K_REG_A0 + i));
+		state->areg[i] = m68k_get_reg(&m_core, (m68k_register_t)(M68K_REG_A0 + i));
 	
 	// Save the stack pointers.
-	state->ssp = ms_Context.s_flag ? ms_Context.dar[15] : ms_Context.sp[0];
-	state->usp = m68k_get_reg(&ms_Context, M68K_REG_USP);
+	state->ssp = m_core.s_flag ? m_core.dar[15] : m_core.sp[0];
+	state->usp = m68k_get_reg(&m_core, M68K_REG_USP);
 
 	// Other registers.
-	state->pc = m68k_get_reg(&ms_Context, M68K_REG_PC);
-	state->sr = m68k_get_reg(&ms_Context, M68K_REG_SR);
+	state->pc = m68k_get_reg(&m_core, M68K_REG_PC);
+	state->sr = m68k_get_reg(&m_core, M68K_REG_SR);
 
 	// Reserved fields.
 	state->reserved1 = 0;
@@ -307,26 +389,78 @@ void M68K::ZomgSaveReg(Zomg_M68KRegSave_t *state)
  * Restore the M68K registers.
  * @param state Zomg_M68KRegSave_t struct to restore from.
  */
-void M68K::ZomgRestoreReg(const Zomg_M68KRegSave_t *state)
+void M68K::zomgRestoreReg(const Zomg_M68KRegSave_t *state)
 {
 	int i;
 	
 	// Load the main registers.
 	for (i = 0; i < 8; i++)
-		m68k_set_reg(&ms_Context, (m68k_register_t)(M68K_REG_D0 + i), state->dreg[i]);
+		m68k_set_reg(&m_core, (m68k_register_t)(M68K_REG_D0 + i), state->dreg[i]);
 	for (i = 0; i < 7; i++)
-		m68k_set_reg(&ms_Context, (m68k_register_t)(M68K_REG_A0 + i), state->areg[i]);
+		m68k_set_reg(&m_core, (m68k_register_t)(M68K_REG_A0 + i), state->areg[i]);
 
 	// Other registers.
-	m68k_set_reg(&ms_Context, M68K_REG_PC, state->pc);
-	m68k_set_reg(&ms_Context, M68K_REG_SR, state->sr);
+	m68k_set_reg(&m_core, M68K_REG_PC, state->pc);
+	m68k_set_reg(&m_core, M68K_REG_SR, state->sr);
 
 	// Load the stack pointers.
-	m68k_set_reg(&ms_Context, M68K_REG_USP, state->usp);
-	if ( ms_Context.s_flag )
-		ms_Context.dar[15] = state->ssp;
+	m68k_set_reg(&m_core, M68K_REG_USP, state->usp);
+	if ( m_core.s_flag )
+		m_core.dar[15] = state->ssp;
 	else
-		ms_Context.sp[0] = state->ssp;
+		m_core.sp[0] = state->ssp;
+}
+
+/**
+ * Internal M68K state for snapshots.
+ */
+struct M68KSnapshot_t {
+	unsigned int int_level;
+	unsigned int stopped;
+	unsigned int virq_state;
+	unsigned int nmi_pending;
+	unsigned int irq_latency;
+	cpu_idle_t poll;
+	int intVectors[8];
+};
+
+/**
+ * Save the internal M68K state to a snapshot.
+ * This should be called after zomgSaveReg().
+ * @param zomg Snapshot.
+ */
+void M68K::snapshotSave(LibZomg::ZomgMem *zomg) const
+{
+	M68KSnapshot_t snap;
+	snap.int_level = m_core.int_level;
+	snap.stopped = m_core.stopped;
+	snap.virq_state = m_core.virq_state;
+	snap.nmi_pending = m_core.nmi_pending;
+	snap.irq_latency = m_core.irq_latency;
+	snap.poll = m_core.poll;
+	memcpy(snap.intVectors, m_intVectors, sizeof(snap.intVectors));
+	zomg->saveBlock(LibZomg::ZomgMem::BLOCK_INT_M68K, &snap, sizeof(snap));
+}
+
+/**
+ * Restore the internal M68K state from a snapshot.
+ * This should be called after zomgRestoreReg().
+ * @param zomg Snapshot.
+ */
+void M68K::snapshotRestore(LibZomg::ZomgMem *zomg)
+{
+	M68KSnapshot_t snap;
+	int ret = zomg->loadBlock(LibZomg::ZomgMem::BLOCK_INT_M68K, &snap, sizeof(snap));
+	if (ret != (int)sizeof(snap))
+		return;
+
+	m_core.int_level = snap.int_level;
+	m_core.stopped = snap.stopped;
+	m_core.virq_state = snap.virq_state;
+	m_core.nmi_pending = snap.nmi_pending;
+	m_core.irq_latency = snap.irq_latency;
+	m_core.poll = snap.poll;
+	memcpy(m_intVectors, snap.intVectors, sizeof(m_intVectors));
 }
 
 }
@@ -35,15 +35,31 @@
 #define CLOCK_NTSC 53693175
 #define CLOCK_PAL  53203424
 
+namespace LibZomg {
+	class ZomgMem;
+}
+
 namespace LibGens
 {
 
+class EmuContext;
+
 class M68K
 {
+	public:
+		M68K(EmuContext *context);
+		~M68K();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		M68K(const M68K &);
+		M68K &operator=(const M68K &);
+
 	public:
 		static void Init(void);
 		static void End(void);
-		
+
 		/**
 		 * @name System IDs
 		 * TODO: Use MDP system IDs?
@@ -60,54 +76,88 @@ class M68K
 
 			SYSID_MAX
 		};
-		
-		static void InitSys(SysID system);
-		static void EndSys(void);
-		static void UpdateSysBanking(void);
-		
+
+		void initSys(SysID system);
+		void endSys(void);
+		void updateSysBanking(void);
+
+		/**
+		 * Enable or disable the decoded instruction cache.
+		 * If enabled, opcode handlers for ROM and RAM are
+		 * cached by PC, so straight-line code isn't decoded
+		 * again on every pass. Emulation is bit-exact either way.
+		 * @param enable True to enable; false to disable.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int setDecodeCache(bool enable);
+
+		/**
+		 * Is the decoded instruction cache enabled?
+		 * @return True if enabled; false if not.
+		 */
+		inline bool isDecodeCacheEnabled(void) const
+			{ return (m_core.decode_cache != nullptr); }
+
 		/** ZOMG savestate functions. **/
-		static void ZomgSaveReg(Zomg_M68KRegSave_t *state);
-		static void ZomgRestoreReg(const Zomg_M68KRegSave_t *state);
-		
+		void zomgSaveReg(Zomg_M68KRegSave_t *state);
+		void zomgRestoreReg(const Zomg_M68KRegSave_t *state);
+
+		/**
+		 * Snapshot functions.
+		 * These save the internal state that isn't stored
+		 * by zomgSaveReg(), e.g. interrupt lines and STOP.
+		 */
+		void snapshotSave(LibZomg::ZomgMem *zomg) const;
+		void snapshotRestore(LibZomg::ZomgMem *zomg);
+
 		/** BEGIN: Starscream wrapper functions. **/
-		static inline void Reset(void);
-		static inline int Interrupt(int level, int vector);
-		static inline unsigned int ReadOdometer(void);
-		static inline void ReleaseCycles(int cycles);
-		static inline void AddCycles(int cycles);
-		static inline unsigned int Exec(int n);
-		static inline unsigned int TripOdometer(void);
-		static void SetFetch(unsigned low_addr, unsigned high_addr, void *base);
-		static void SetMemReadFunc(unsigned low_addr, unsigned high_addr,
+		inline void reset(void);
+		inline int interrupt(int level, int vector);
+		inline unsigned int readOdometer(void) const;
+		inline void releaseCycles(int cycles);
+		inline void addCycles(int cycles);
+		inline unsigned int exec(int n);
+		inline unsigned int tripOdometer(void);
+		void setFetch(unsigned low_addr, unsigned high_addr, void *base);
+		void setMemReadFunc(unsigned low_addr, unsigned high_addr,
 			unsigned int (*read8)(void *param, unsigned int address),
 			unsigned int (*read16)(void *param, unsigned int address));
-		static void SetMemWriteFunc(unsigned low_addr, unsigned high_addr,
+		void setMemWriteFunc(unsigned low_addr, unsigned high_addr,
 			void (*write8)(void *param, unsigned int address, unsigned int data),
 			void (*write16)(void *param, unsigned int address, unsigned int data));
 		/** END: Starscream wrapper functions. **/
-	
+
 	protected:
-		static m68ki_cpu_core ms_Context;
-		static int m_cycleCnt;		// Cycles currently run.
-		static int m_intVectors[8];
-		
+		// Emulation context this CPU belongs to.
+		EmuContext *const m_context;
+
+		m68ki_cpu_core m_core;
+		int m_cycleCnt;		// Cycles currently run.
+		int m_intVectors[8];
+
+		// Last system ID.
+		SysID m_lastSysID;
+
+		/**
+		 * Update the decoded instruction cache page types.
+		 * This also flushes the cache.
+		 * Must be called whenever the fetch pointers change.
+		 */
+		void updateDecodePages(void);
+
 		// TODO: What does the Reset Handler function do?
 		static void M68K_Reset_Handler(m68ki_cpu_core *cpu);
 		static int M68K_Int_Ack(m68ki_cpu_core *cpu, int int_level);
-	
-	private:
-		M68K() { }
-		~M68K() { }
-
-		static SysID ms_LastSysID;
 };
 
 /**
  * Reset the emulated CPU.
  */
-inline void M68K::Reset(void)
+inline void M68K::reset(void)
 {
-	m68k_pulse_reset(&ms_Context);
+	// ROM data may have changed. (checksum fixup)
+	m68k_flush_decode_cache(&m_core);
+	m68k_pulse_reset(&m_core);
 }
 
 /**
@@ -116,10 +166,10 @@ inline void M68K::Reset(void)
  * @param vector Interrupt vector. (???)
  * @return ???
  */
-inline int M68K::Interrupt(int level, int vector)
+inline int M68K::interrupt(int level, int vector)
 {
 	m_intVectors[level] = vector;
-	m68k_set_irq(&ms_Context, level, ASSERT_LINE);
+	m68k_set_irq(&m_core, level, ASSERT_LINE);
 	return 0;
 }
 
@@ -127,7 +177,7 @@ inline int M68K::Interrupt(int level, int vector)
  * Read the M68K odometer.
  * @return M68K odometer.
  */
-inline unsigned int M68K::ReadOdometer(void)
+inline unsigned int M68K::readOdometer(void) const
 {
 	return m_cycleCnt;
 }
@@ -136,7 +186,7 @@ inline unsigned int M68K::ReadOdometer(void)
 * Release cycles.
 * @param cycles Cycles to release.
 */
-inline void M68K::ReleaseCycles(int cycles)
+inline void M68K::releaseCycles(int cycles)
 {
 	//main68k_releaseCycles(cycles);
 }
@@ -145,7 +195,7 @@ inline void M68K::ReleaseCycles(int cycles)
  * Add cycles to the M68K odometer.
  * @param cycles Number of cycles to add.
  */
-inline void M68K::AddCycles(int cycles)
+inline void M68K::addCycles(int cycles)
 {
 	//main68k_addCycles(cycles);
 }
@@ -155,7 +205,7 @@ inline void M68K::AddCycles(int cycles)
  * @param n Number of cycles to execute.
  * @return ???
  */
-inline unsigned int M68K::Exec(int n)
+inline unsigned int M68K::exec(int n)
 {
 	int cyclesToRun = n - m_cycleCnt;
 	int ret;
@@ -163,7 +213,7 @@ inline unsigned int M68K::Exec(int n)
 	if (cyclesToRun <= 0)
 		return 0;
 
-	ret = m68k_execute(&ms_Context, cyclesToRun);
+	ret = m68k_execute(&m_core, cyclesToRun);
 
 	if (ret >= 0)
 		m_cycleCnt += ret;
@@ -177,7 +227,7 @@ inline unsigned int M68K::Exec(int n)
 * Clear the M68K odometer.
 * @return ???
 */
-inline unsigned int M68K::TripOdometer(void)
+inline unsigned int M68K::tripOdometer(void)
 {
 	m_cycleCnt = 0;
 	return 0;
@@ -44,54 +44,19 @@
 // Sound Manager.
 #include "sound/SoundMgr.hpp"
 
-// TODO: Starscream accesses Ram_68k directly.
-// Move Ram_68k back to M68K once Starscream is updated.
-Ram_68k_t Ram_68k;
-
 // EmuContext
 #include "EmuContext/EmuContext.hpp"
 
 // Miscellaneous.
 #include "libcompat/byteswap.h"
+#include "macros/common.h"
 #include "macros/log_msg.h"
 
 namespace LibGens {
 
-/** ROM and RAM variables. **/
-//M68K_Mem::Ram_68k_t M68K_Mem::Ram_68k;	// TODO: Fix Starscream!
-
-// Z80 emulator.
-Z80 *M68K_Mem::ms_Z80 = nullptr;
-
-// ROM cartridge.
-RomCartridgeMD *M68K_Mem::ms_RomCartridge = nullptr;
-
-// TMSS registers.
-TmssReg M68K_Mem::tmss_reg;
-
 /** Z80/M68K cycle table. **/
 int M68K_Mem::Z80_M68K_Cycle_Tab[512];
 
-// M68K static variables.
-// TODO: Improve some of these, especially the cycle counters!
-unsigned int M68K_Mem::Z80_State;
-int M68K_Mem::Last_BUS_REQ_Cnt;
-int M68K_Mem::Last_BUS_REQ_St;
-int M68K_Mem::Bank_M68K;
-int M68K_Mem::Fake_Fetch;
-
-int M68K_Mem::CPL_M68K;
-int M68K_Mem::CPL_Z80;
-int M68K_Mem::Cycles_M68K;
-int M68K_Mem::Cycles_Z80;
-
-/**
- * M68K bank type identifiers.
- * These type identifiers indicate what's mapped to each virtual bank.
- * Banks are 2 MB each, for a total of 8 banks.
- */
-uint8_t M68K_Mem::ms_M68KBank_Type[8];
-
 /**
  * Default M68K bank type IDs for MD.
  */
@@ -144,6 +109,33 @@ void M68K_Mem::Init(void)
 void M68K_Mem::End(void)
 { }
 
+/**
+ * Initialize an M68K memory map.
+ * @param context Emulation context this memory map belongs to.
+ */
+M68K_Mem::M68K_Mem(EmuContext *context)
+	: m_romCartridge(nullptr)
+	, Z80_State(0)
+	, Last_BUS_REQ_Cnt(0)
+	, Last_BUS_REQ_St(0)
+	, Bank_M68K(0)
+	, Fake_Fetch(0)
+	, CPL_M68K(0)
+	, CPL_Z80(0)
+	, Cycles_M68K(0)
+	, Cycles_Z80(0)
+	, m_context(context)
+	, m_pageMapEnabled(true)
+{
+	memset(&Ram_68k, 0x00, sizeof(Ram_68k));
+	memset(m_M68KBank_Type, 0x00, sizeof(m_M68KBank_Type));
+	memset(m_pageRead, 0, sizeof(m_pageRead));
+	memset(m_pageWrite, 0, sizeof(m_pageWrite));
+}
+
+M68K_Mem::~M68K_Mem()
+{ }
+
 
 /** Read Byte functions. **/
 
@@ -180,7 +172,7 @@ inline uint8_t M68K_Mem::M68K_Read_Byte_Misc(uint32_t address)
 
 		// Call the Z80 Read Byte function.
 		// TODO: CPU lockup on accessing 0x7Fxx or >=0x8000.
-		return ms_Z80->Z80_MD_ReadB(address & 0xFFFF);
+		return m_context->m_z80->Z80_MD_ReadB(address & 0xFFFF);
 	} else if (address >= 0xA20000) {
 		// Invalid address.
 		// TODO: Fake Fetch?
@@ -209,7 +201,7 @@ inline uint8_t M68K_Mem::M68K_Read_Byte_Misc(uint32_t address)
 			}
 
 			// Z80 is not running.
-			int odo68k = M68K::ReadOdometer();
+			int odo68k = m_context->m_m68k->readOdometer();
 			odo68k -= Last_BUS_REQ_Cnt;
 			if (odo68k <= CYCLE_FOR_TAKE_Z80_BUS_GENESIS)
 				return ((Last_BUS_REQ_St | 0x80) & 0xFF);
@@ -225,7 +217,7 @@ inline uint8_t M68K_Mem::M68K_Read_Byte_Misc(uint32_t address)
 
 		case 0x30:
 			// 0xA130xx: /TIME registers.
-			return ms_RomCartridge->readByte_TIME(address & 0xFF);
+			return m_romCartridge->readByte_TIME(address & 0xFF);
 
 		case 0x40: {
 			// 0xA14000: TMSS ('SEGA' register)
@@ -291,13 +283,11 @@ inline uint8_t M68K_Mem::M68K_Read_Byte_Misc(uint32_t address)
 			// NOTE: Reads from even addresses are handled the same as odd addresses.
 			// (Least-significant bit is ignored.)
 			uint8_t ret = 0xFF;
-			const LibGens::IoManager *const ioManager = EmuContext::m_ioManager;
+			const LibGens::IoManager *const ioManager = m_context->m_ioManager;
 			switch (address & 0x1E) {
 				case 0x00: {
 					// 0xA10001: Genesis version register.
-					EmuContext *context = EmuContext::Instance();
-					if (context)
-						ret = context->readVersionRegister_MD();
+					ret = m_context->readVersionRegister_MD();
 					break;
 				}
 
@@ -354,13 +344,8 @@ inline uint8_t M68K_Mem::M68K_Read_Byte_VDP(uint32_t address)
 		return 0x00;
 	}
 
-	// TODO: Don't use EmuContext here...
-	EmuContext *context = EmuContext::Instance();
-	if (!context)
-		return 0;
-
 	// Check the VDP address.
-	Vdp *vdp = context->m_vdp;
+	Vdp *vdp = m_context->m_vdp;
 	uint8_t ret = 0; // TODO: Default to prefetched data?
 	switch (address & 0xFD) {
 		case 0x00:
@@ -442,7 +427,7 @@ inline uint8_t M68K_Mem::M68K_Read_Byte_Pico_IO(uint32_t address)
 		return 0xFF;
 	}
 
-	LibGens::IoManager *const ioManager = EmuContext::m_ioManager;
+	LibGens::IoManager *const ioManager = m_context->m_ioManager;
 	uint8_t ret = 0xFF; // TODO: Default to prefetched data?
 
 	switch (address & 0x1F) {
@@ -523,7 +508,7 @@ inline uint16_t M68K_Mem::M68K_Read_Word_Misc(uint32_t address)
 		// Call the Z80 Read Byte function.
 		// TODO: CPU lockup on accessing 0x7Fxx or >=0x8000.
 		// Genesis Plus duplicates the byte in both halves of the M68K word.
-		uint8_t ret = ms_Z80->Z80_MD_ReadB(address & 0xFFFF);
+		uint8_t ret = m_context->m_z80->Z80_MD_ReadB(address & 0xFFFF);
 		return (ret | (ret << 8));
 	} else if (address >= 0xA20000) {
 		// Invalid address.
@@ -550,7 +535,7 @@ inline uint16_t M68K_Mem::M68K_Read_Word_Misc(uint32_t address)
 			}
 
 			// Z80 is not running.
-			int odo68k = M68K::ReadOdometer();
+			int odo68k = m_context->m_m68k->readOdometer();
 			odo68k -= Last_BUS_REQ_Cnt;
 			if (odo68k <= CYCLE_FOR_TAKE_Z80_BUS_GENESIS) {
 				// bus not taken yet
@@ -577,7 +562,7 @@ inline uint16_t M68K_Mem::M68K_Read_Word_Misc(uint32_t address)
 
 		case 0x30:
 			// 0xA130xx: /TIME registers.
-			return ms_RomCartridge->readWord_TIME(address & 0xFF);
+			return m_romCartridge->readWord_TIME(address & 0xFF);
 
 		case 0x40: {
 			// 0xA14101: TMSS ('SEGA' register)
@@ -643,13 +628,11 @@ inline uint16_t M68K_Mem::M68K_Read_Word_Misc(uint32_t address)
 			 * 0xA1001F: Control Port 3: Serial Control.
 			 */
 			uint8_t ret = 0xFF;
-			const LibGens::IoManager *const ioManager = EmuContext::m_ioManager;
+			const LibGens::IoManager *const ioManager = m_context->m_ioManager;
 			switch (address & 0x1E) {
 				case 0x00: {
 					// 0xA10001: Genesis version register.
-					EmuContext *context = EmuContext::Instance();
-					if (context)
-						ret = context->readVersionRegister_MD();
+					ret = m_context->readVersionRegister_MD();
 					break;
 				}
 
@@ -708,13 +691,8 @@ inline uint16_t M68K_Mem::M68K_Read_Word_VDP(uint32_t address)
 		return 0x0000;
 	}
 
-	// TODO: Don't use EmuContext here...
-	EmuContext *context = EmuContext::Instance();
-	if (!context)
-		return 0;
-
 	// Check the VDP address.
-	Vdp *vdp = context->m_vdp;
+	Vdp *vdp = m_context->m_vdp;
 	uint16_t ret = 0; // TODO: Default to prefetched data?
 	switch (address & 0xFC) {
 		case 0x00:
@@ -775,7 +753,7 @@ inline uint16_t M68K_Mem::M68K_Read_Word_Pico_IO(uint32_t address)
 		return 0xFFFF;
 	}
 
-	LibGens::IoManager *const ioManager = EmuContext::m_ioManager;
+	LibGens::IoManager *const ioManager = m_context->m_ioManager;
 	uint16_t ret = 0xFFFF; // TODO: Default to prefetched data?
 	switch (address & 0x1E) {
 		case 0x00:
@@ -867,7 +845,7 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 
 		// Call the Z80 Write Byte function.
 		// TODO: CPU lockup on accessing 0x7Fxx or >=0x8000.
-		ms_Z80->Z80_MD_WriteB(address & 0xFFFF, data);
+		m_context->m_z80->Z80_MD_WriteB(address & 0xFFFF, data);
 		return;
 	} else if (address >= 0xA20000) {
 		// Invalid address.
@@ -890,7 +868,7 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 			if (data & 0x01) {
 				// M68K requests the bus.
 				// Disable the Z80.
-				Last_BUS_REQ_Cnt = M68K::ReadOdometer();
+				Last_BUS_REQ_Cnt = m_context->m_m68k->readOdometer();
 				Last_BUS_REQ_St = (Z80_State & Z80_STATE_BUSREQ);
 
 				if (Z80_State & Z80_STATE_BUSREQ) {
@@ -903,7 +881,7 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 					
 					int edx = Cycles_Z80;
 					edx -= ebx;
-					ms_Z80->exec(edx);
+					m_context->m_z80->exec(edx);
 				}
 			} else {
 				// M68K releases the bus.
@@ -914,14 +892,14 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 					
 					// TODO: Rework this.
 					int ebx = Cycles_M68K;
-					ebx -= M68K::ReadOdometer();
+					ebx -= m_context->m_m68k->readOdometer();
 					
 					int edx = Cycles_Z80;
 					ebx = Z80_M68K_Cycle_Tab[ebx];
 					edx -= ebx;
 					
 					// Set the Z80 odometer.
-					ms_Z80->setOdometer((unsigned int)edx);
+					m_context->m_z80->setOdometer((unsigned int)edx);
 				}
 			}
 
@@ -938,17 +916,17 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 				Z80_State &= ~Z80_STATE_RESET;
 			} else {
 				// RESET is low. Stop the Z80.
-				ms_Z80->softReset();
+				m_context->m_z80->softReset();
 				Z80_State |= Z80_STATE_RESET;
 
 				// YM2612's RESET line is tied to the Z80's RESET line.
-				SoundMgr::ms_Ym2612.reset();
+				m_context->m_soundMgr->m_ym2612.reset();
 			}
 			break;
 
 		case 0x30:
 			// 0xA130xx: /TIME registers.
-			ms_RomCartridge->writeByte_TIME(address & 0xFF, data);
+			m_romCartridge->writeByte_TIME(address & 0xFF, data);
 			break;
 
 		case 0x40: {
@@ -982,7 +960,7 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 			tmss_reg.n_cart_ce = (data & 1);
 
 			// Update TMSS mapping.
-			UpdateTmssMapping();
+			updateTmssMapping();
 			break;
 		}
 
@@ -1009,7 +987,7 @@ inline void M68K_Mem::M68K_Write_Byte_Misc(uint32_t address, uint8_t data)
 			 * 0xA1001F: Control Port 3: Serial Control.
 			 */
 			// TODO: Do byte writes to even addresses (e.g. 0xA10002) work?
-			LibGens::IoManager *const ioManager = EmuContext::m_ioManager;
+			LibGens::IoManager *const ioManager = m_context->m_ioManager;
 			switch (address & 0x1E) {
 				default:
 				case 0x00: /// 0xA10001: Genesis version register.
@@ -1060,13 +1038,8 @@ inline void M68K_Mem::M68K_Write_Byte_VDP(uint32_t address, uint8_t data)
 		return;
 	}
 
-	// TODO: Don't use EmuContext here...
-	EmuContext *context = EmuContext::Instance();
-	if (!context)
-		return;
-
 	// Check the VDP address.
-	Vdp *vdp = context->m_vdp;
+	Vdp *vdp = m_context->m_vdp;
 	switch (address & 0xFC) {
 		case 0x00:
 			// VDP data port.
@@ -1079,7 +1052,7 @@ inline void M68K_Mem::M68K_Write_Byte_VDP(uint32_t address, uint8_t data)
 		case 0x10: case 0x14:
 			// PSG control port. (Odd addresses only)
 			if (address & 1) {
-				SoundMgr::ms_Psg.write(data);
+				m_context->m_soundMgr->m_psg.write(data);
 			}
 			break;
 		case 0x18:
@@ -1171,7 +1144,7 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 		// TODO: CPU lockup on accessing 0x7Fxx or >=0x8000.
 		// Genesis Plus writes the high byte of the M68K word.
 		// NOTE: Gunstar Heroes uses word write access to the Z80 area on startup.
-		ms_Z80->Z80_MD_WriteB(address & 0xFFFF, (data >> 8) & 0xFF);
+		m_context->m_z80->Z80_MD_WriteB(address & 0xFFFF, (data >> 8) & 0xFF);
 		return;
 	} else if (address >= 0xA20000) {
 		// Invalid address.
@@ -1193,7 +1166,7 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 			if (data & 0x0100) {
 				// M68K requests the bus.
 				// Disable the Z80.
-				Last_BUS_REQ_Cnt = M68K::ReadOdometer();
+				Last_BUS_REQ_Cnt = m_context->m_m68k->readOdometer();
 				Last_BUS_REQ_St = (Z80_State & Z80_STATE_BUSREQ);
 
 				if (Z80_State & Z80_STATE_BUSREQ) {
@@ -1206,7 +1179,7 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 
 					int edx = Cycles_Z80;
 					edx -= ebx;
-					ms_Z80->exec(edx);
+					m_context->m_z80->exec(edx);
 				}
 			} else {
 				// M68K releases the bus.
@@ -1217,14 +1190,14 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 
 					// TODO: Rework this.
 					int ebx = Cycles_M68K;
-					ebx -= M68K::ReadOdometer();
+					ebx -= m_context->m_m68k->readOdometer();
 
 					int edx = Cycles_Z80;
 					ebx = Z80_M68K_Cycle_Tab[ebx];
 					edx -= ebx;
 
 					// Set the Z80 odometer.
-					ms_Z80->setOdometer((unsigned int)edx);
+					m_context->m_z80->setOdometer((unsigned int)edx);
 				}
 			}
 
@@ -1240,18 +1213,18 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 				Z80_State &= ~Z80_STATE_RESET;
 			} else {
 				// RESET is low. Stop the Z80.
-				ms_Z80->softReset();
+				m_context->m_z80->softReset();
 				Z80_State |= Z80_STATE_RESET;
 
 				// YM2612's RESET line is tied to the Z80's RESET line.
-				SoundMgr::ms_Ym2612.reset();
+				m_context->m_soundMgr->m_ym2612.reset();
 			}
 
 			break;
 
 		case 0x30:
 			// 0xA130xx: /TIME registers.
-			ms_RomCartridge->writeWord_TIME(address & 0xFF, data);
+			m_romCartridge->writeWord_TIME(address & 0xFF, data);
 			break;
 
 		case 0x40: {
@@ -1285,7 +1258,7 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 			tmss_reg.n_cart_ce = (data & 1);
 
 			// Update TMSS mapping.
-			UpdateTmssMapping();
+			updateTmssMapping();
 			break;
 		}
 
@@ -1313,7 +1286,7 @@ inline void M68K_Mem::M68K_Write_Word_Misc(uint32_t address, uint16_t data)
 			 */
 			// TODO: Is there special handling for word writes,
 			// or is it just "LSB is written"?
-			LibGens::IoManager *const ioManager = EmuContext::m_ioManager;
+			LibGens::IoManager *const ioManager = m_context->m_ioManager;
 			switch (address & 0x1E) {
 				default:
 				case 0x00: /// 0xA10001: Genesis version register.
@@ -1364,13 +1337,8 @@ inline void M68K_Mem::M68K_Write_Word_VDP(uint32_t address, uint16_t data)
 		return;
 	}
 
-	// TODO: Don't use EmuContext here...
-	EmuContext *context = EmuContext::Instance();
-	if (!context)
-		return;
-
 	// Check the VDP address.
-	Vdp *vdp = context->m_vdp;
+	Vdp *vdp = m_context->m_vdp;
 	switch (address & 0xFC) {
 		case 0x00:
 			// VDP data port.
@@ -1382,7 +1350,7 @@ inline void M68K_Mem::M68K_Write_Word_VDP(uint32_t address, uint16_t data)
 			break;
 		case 0x10: case 0x14:
 			// PSG control port.
-			SoundMgr::ms_Psg.write(data & 0xFF);
+			m_context->m_soundMgr->m_psg.write(data & 0xFF);
 			break;
 		case 0x18:
 			// Unused write address.
@@ -1441,28 +1409,28 @@ inline void M68K_Mem::M68K_Write_Word_Pico_IO(uint32_t address, uint16_t data)
 /**
  * Update the TMSS mapping.
  */
-void M68K_Mem::UpdateTmssMapping(void)
+void M68K_Mem::updateTmssMapping(void)
 {
 	if (!tmss_reg.isTmssMapped()) {
 		// TMSS is disabled, or
 		// TMSS is enabled and cartridge is mapped.
-		ms_M68KBank_Type[0] = M68K_BANK_CARTRIDGE;
-		ms_M68KBank_Type[1] = M68K_BANK_CARTRIDGE;
+		m_M68KBank_Type[0] = M68K_BANK_CARTRIDGE;
+		m_M68KBank_Type[1] = M68K_BANK_CARTRIDGE;
 	} else {
 		// TMSS is enabled.
-		ms_M68KBank_Type[0] = M68K_BANK_TMSS_ROM;
-		ms_M68KBank_Type[1] = M68K_BANK_TMSS_ROM;
+		m_M68KBank_Type[0] = M68K_BANK_TMSS_ROM;
+		m_M68KBank_Type[1] = M68K_BANK_TMSS_ROM;
 	}
 
 	// TODO: Better way to update Starscream?
-	M68K::UpdateSysBanking();
+	m_context->m_m68k->updateSysBanking();
 }
 
 /**
  * Initialize the M68K memory handler.
  * @param system System ID.
  */
-void M68K_Mem::InitSys(M68K::SysID system)
+void M68K_Mem::initSys(M68K::SysID system)
 {
 	// Reset the TMSS registers.
 	tmss_reg.reset();
@@ -1470,19 +1438,19 @@ void M68K_Mem::InitSys(M68K::SysID system)
 	// Initialize the M68K bank type identifiers.
 	switch (system) {
 		case M68K::SYSID_MD:
-			memcpy(ms_M68KBank_Type, msc_M68KBank_Def_MD, sizeof(ms_M68KBank_Type));
-			UpdateTmssMapping();
+			memcpy(m_M68KBank_Type, msc_M68KBank_Def_MD, sizeof(m_M68KBank_Type));
+			updateTmssMapping();
 			break;
 
 		case M68K::SYSID_PICO:
-			memcpy(ms_M68KBank_Type, msc_M68KBank_Def_Pico, sizeof(ms_M68KBank_Type));
+			memcpy(m_M68KBank_Type, msc_M68KBank_Def_Pico, sizeof(m_M68KBank_Type));
 			break;
 
 		default:
 			// Unknown system ID.
 			LOG_MSG(68k, LOG_MSG_LEVEL_ERROR,
 				"Unknown system ID: %d", system);
-			memset(ms_M68KBank_Type, 0x00, sizeof(ms_M68KBank_Type));
+			memset(m_M68KBank_Type, 0x00, sizeof(m_M68KBank_Type));
 			break;
 	}
 }
@@ -1493,22 +1461,74 @@ void M68K_Mem::InitSys(M68K::SysID system)
  * @param banks Maximum number of banks to update.
  * @return Number of banks updated.
  */
-int M68K_Mem::UpdateSysBanking(int banks)
+int M68K_Mem::updateSysBanking(int banks)
 {
+	// Bank mappings may have changed.
+	updatePageMap();
+
 	// Mapping depends on if TMSS is mapped.
 	int cur_fetch = 0;
 	if (!tmss_reg.isTmssMapped()) {
 		// TMSS is not mapped.
 		// Update banking using RomCartridgeMD.
-		cur_fetch += ms_RomCartridge->updateSysBanking(banks);
+		cur_fetch += m_romCartridge->updateSysBanking(m_context->m_m68k, banks);
 	} else {
 		// TMSS is mapped.
-		cur_fetch += tmss_reg.updateSysBanking(banks);
+		cur_fetch += tmss_reg.updateSysBanking(m_context->m_m68k, banks);
 	}
 
 	return cur_fetch;
 }
 
+/**
+ * Rebuild the direct page map.
+ * Called whenever the system banking changes.
+ */
+void M68K_Mem::updatePageMap(void)
+{
+	memset(m_pageRead, 0, sizeof(m_pageRead));
+	memset(m_pageWrite, 0, sizeof(m_pageWrite));
+	if (!m_pageMapEnabled)
+		return;
+
+	for (int page = 0; page < ARRAY_SIZE(m_pageRead); page++) {
+		// Each M68K bank has 32 pages.
+		switch (m_M68KBank_Type[page >> 5]) {
+			case M68K_BANK_CARTRIDGE:
+				// ROM cartridge.
+				// RomCartridgeMD returns nullptr for pages that
+				// may contain SRAM, EEPROM, or mapper registers.
+				// Writes always go through RomCartridgeMD.
+				if (m_romCartridge) {
+					m_pageRead[page] = m_romCartridge->readPagePtr(page << 16);
+				}
+				break;
+
+			case M68K_BANK_RAM:
+				// RAM. (64 KB mirroring)
+				m_pageRead[page] = Ram_68k.u8;
+				m_pageWrite[page] = Ram_68k.u8;
+				break;
+
+			default:
+				// I/O, VDP, and TMSS ROM use the bank handlers.
+				break;
+		}
+	}
+}
+
+/**
+ * Enable or disable the direct page map.
+ * If disabled, all accesses go through the bank handlers.
+ * This is mostly useful for benchmarking and debugging.
+ * @param enable True to enable; false to disable.
+ */
+void M68K_Mem::setPageMapEnabled(bool enable)
+{
+	m_pageMapEnabled = enable;
+	updatePageMap();
+}
+
 
 /**
  * Read a byte from the M68K address space.
@@ -1517,18 +1537,24 @@ int M68K_Mem::UpdateSysBanking(int banks)
  */
 uint8_t M68K_Mem::M68K_RB(uint32_t address)
 {
+	// Check the direct page map first.
+	const uint8_t *const page = m_pageRead[(address >> 16) & 0xFF];
+	if (page) {
+		return page[(address & 0xFFFF) ^ U16DATA_U8_INVERT];
+	}
+
 	// TODO: This is MD only. Add MCD/32X later.
 	address &= 0xFFFFFF;
 	const uint8_t bank = ((address >> 21) & 0x7);
 
 	// TODO: Optimize the switch using a bitwise AND.
-	switch (ms_M68KBank_Type[bank]) {
+	switch (m_M68KBank_Type[bank]) {
 		default:
 		case M68K_BANK_UNUSED:	return 0xFF;
 
 		// ROM cartridge.
 		case M68K_BANK_CARTRIDGE:
-			return ms_RomCartridge->readByte(address);
+			return m_romCartridge->readByte(address);
 
 		// Other MD banks.
 		case M68K_BANK_MD_IO:		return M68K_Read_Byte_Misc(address);
@@ -1549,18 +1575,24 @@ uint8_t M68K_Mem::M68K_RB(uint32_t address)
  */
 uint16_t M68K_Mem::M68K_RW(uint32_t address)
 {
+	// Check the direct page map first.
+	const uint8_t *const page = m_pageRead[(address >> 16) & 0xFF];
+	if (page) {
+		return reinterpret_cast<const uint16_t*>(page)[(address & 0xFFFF) >> 1];
+	}
+
 	// TODO: This is MD only. Add MCD/32X later.
 	address &= 0xFFFFFF;
 	const uint8_t bank = ((address >> 21) & 0x7);
 
 	// TODO: Optimize the switch using a bitwise AND.
-	switch (ms_M68KBank_Type[bank]) {
+	switch (m_M68KBank_Type[bank]) {
 		default:
 		case M68K_BANK_UNUSED:	return 0xFFFF;
 		
 		// ROM cartridge.
 		case M68K_BANK_CARTRIDGE:
-			return ms_RomCartridge->readWord(address);
+			return m_romCartridge->readWord(address);
 
 		// Other MD banks.
 		case M68K_BANK_MD_IO:		return M68K_Read_Word_Misc(address);
@@ -1582,12 +1614,19 @@ uint16_t M68K_Mem::M68K_RW(uint32_t address)
  */
 void M68K_Mem::M68K_WB(uint32_t address, uint8_t data)
 {
+	// Check the direct page map first.
+	uint8_t *const page = m_pageWrite[(address >> 16) & 0xFF];
+	if (page) {
+		page[(address & 0xFFFF) ^ U16DATA_U8_INVERT] = data;
+		return;
+	}
+
 	// TODO: This is MD only. Add MCD/32X later.
 	address &= 0xFFFFFF;
 	const uint8_t bank = ((address >> 21) & 0x7);
 
 	// TODO: Optimize the switch using a bitwise AND.
-	switch (ms_M68KBank_Type[bank]) {
+	switch (m_M68KBank_Type[bank]) {
 		default:
 		case M68K_BANK_UNUSED:
 		case M68K_BANK_TMSS_ROM:
@@ -1595,7 +1634,7 @@ void M68K_Mem::M68K_WB(uint32_t address, uint8_t data)
 
 		// ROM cartridge.
 		case M68K_BANK_CARTRIDGE:
-			ms_RomCartridge->writeByte(address, data);
+			m_romCartridge->writeByte(address, data);
 			break;
 
 		// Other MD banks.
@@ -1614,12 +1653,19 @@ void M68K_Mem::M68K_WB(uint32_t address, uint8_t data)
  */
 void M68K_Mem::M68K_WW(uint32_t address, uint16_t data)
 {
+	// Check the direct page map first.
+	uint8_t *const page = m_pageWrite[(address >> 16) & 0xFF];
+	if (page) {
+		reinterpret_cast<uint16_t*>(page)[(address & 0xFFFF) >> 1] = data;
+		return;
+	}
+
 	// TODO: This is MD only. Add MCD/32X later.
 	address &= 0xFFFFFF;
 	const uint8_t bank = ((address >> 21) & 0x7);
 
 	// TODO: Optimize the switch using a bitwise AND.
-	switch (ms_M68KBank_Type[bank]) {
+	switch (m_M68KBank_Type[bank]) {
 		default:
 		case M68K_BANK_UNUSED:
 		case M68K_BANK_TMSS_ROM:
@@ -1627,7 +1673,7 @@ void M68K_Mem::M68K_WW(uint32_t address, uint16_t data)
 
 		// ROM cartridge.
 		case M68K_BANK_CARTRIDGE:
-			ms_RomCartridge->writeWord(address, data);
+			m_romCartridge->writeWord(address, data);
 			break;
 
 		// Other MD banks.
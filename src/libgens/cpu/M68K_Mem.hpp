@@ -26,21 +26,6 @@
 
 #include <stdint.h>
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-// TODO: Starscream accesses Ram_68k directly.
-// Move Ram_68k back to M68K once Starscream is updated.
-typedef union {
-	uint8_t  u8[64*1024];
-	uint16_t u16[(64*1024)>>1];
-	uint32_t u32[(64*1024)>>2];
-} Ram_68k_t;
-extern Ram_68k_t Ram_68k;
-#ifdef __cplusplus
-}
-#endif
-
 #include "M68K.hpp"
 
 // ZOMG TIME_reg structs.
@@ -51,59 +36,64 @@ extern Ram_68k_t Ram_68k;
 
 namespace LibGens {
 
+class EmuContext;
 class RomCartridgeMD;
-class Z80;
 
 class M68K_Mem
 {
+	public:
+		M68K_Mem(EmuContext *context);
+		~M68K_Mem();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		M68K_Mem(const M68K_Mem &);
+		M68K_Mem &operator=(const M68K_Mem &);
+
 	public:
 		static void Init(void);
 		static void End(void);
 
-#if 0
-		// TODO: Starscream accesses Ram_68k directly.
-		// Move Ram_68k back here once Starscream is updated.
+		// M68K RAM.
 		union Ram_68k_t {
 			uint8_t  u8[64*1024];
 			uint16_t u16[(64*1024)>>1];
 			uint32_t u32[(64*1024)>>2];
 		};
-		static Ram_68k_t Ram_68k;
-#endif
-		// Z80 emulator.
-		static Z80 *ms_Z80;
+		Ram_68k_t Ram_68k;
 
 		// ROM cartridge.
-		static RomCartridgeMD *ms_RomCartridge;
+		RomCartridgeMD *m_romCartridge;
 
 		/**
 		 * TMSS registers.
 		 * NOTE: Only effective if system version != 0.
 		 */
-		static TmssReg tmss_reg;
+		TmssReg tmss_reg;
 
 		/** Z80 state. **/
 		#define Z80_STATE_ENABLED	(1 << 0)
 		#define Z80_STATE_BUSREQ	(1 << 1)
 		#define Z80_STATE_RESET		(1 << 2)
 
-		static unsigned int Z80_State;
-		static int Last_BUS_REQ_Cnt;
-		static int Last_BUS_REQ_St;
-		static int Bank_M68K; // NOTE: This is for Sega CD, not Z80!
-		static int Fake_Fetch;
+		unsigned int Z80_State;
+		int Last_BUS_REQ_Cnt;
+		int Last_BUS_REQ_St;
+		int Bank_M68K; // NOTE: This is for Sega CD, not Z80!
+		int Fake_Fetch;
 
 		// Cycles per line.
 		// TODO: Replace with 3420 machine cycles per line.
-		static int CPL_M68K;
-		static int CPL_Z80;
-		static int Cycles_M68K;
-		static int Cycles_Z80;
+		int CPL_M68K;
+		int CPL_Z80;
+		int Cycles_M68K;
+		int Cycles_Z80;
 
 		/** System initialization functions. **/
 	public:
-		static void UpdateTmssMapping(void);	// FIXME: Needs to be private?
-		static void InitSys(M68K::SysID system);
+		void updateTmssMapping(void);	// FIXME: Needs to be private?
+		void initSys(M68K::SysID system);
 
 		/**
 		 * Update M68K CPU program access structs for bankswitching purposes.
@@ -111,15 +101,33 @@ class M68K_Mem
 		 * @param banks Maximum number of banks to update.
 		 * @return Number of banks updated.
 		 */
-		static int UpdateSysBanking(int banks);
+		int updateSysBanking(int banks);
+
+		/**
+		 * Enable or disable the direct page map.
+		 * If disabled, all accesses go through the bank handlers.
+		 * This is mostly useful for benchmarking and debugging.
+		 * @param enable True to enable; false to disable.
+		 */
+		void setPageMapEnabled(bool enable);
+
+		/**
+		 * Is the direct page map enabled?
+		 * @return True if enabled; false if not.
+		 */
+		inline bool isPageMapEnabled(void) const
+			{ return m_pageMapEnabled; }
 
 		/** Public read/write functions. **/
-		static uint8_t M68K_RB(uint32_t address);
-		static uint16_t M68K_RW(uint32_t address);
-		static void M68K_WB(uint32_t address, uint8_t data);
-		static void M68K_WW(uint32_t address, uint16_t data);
+		uint8_t M68K_RB(uint32_t address);
+		uint16_t M68K_RW(uint32_t address);
+		void M68K_WB(uint32_t address, uint8_t data);
+		void M68K_WW(uint32_t address, uint16_t data);
 		
 	private:
+		// Emulation context this memory map belongs to.
+		EmuContext *const m_context;
+
 		/** Z80/M68K cycle table. **/
 		static int Z80_M68K_Cycle_Tab[512];
 
@@ -156,7 +164,7 @@ class M68K_Mem
 		 * These type identifiers indicate what's mapped to each virtual bank.
 		 * Banks are 2 MB each, for a total of 8 banks.
 		 */
-		static uint8_t ms_M68KBank_Type[8];
+		uint8_t m_M68KBank_Type[8];
 
 		/**
 		 * Default M68K bank type IDs for MD.
@@ -168,31 +176,48 @@ class M68K_Mem
 		 */
 		static const uint8_t msc_M68KBank_Def_Pico[8];
 
+		/**
+		 * Direct page map.
+		 * Each entry covers 64 KB of the M68K address space
+		 * and points to byteswapped host memory. (ROM or RAM)
+		 * nullptr indicates that the bank handlers must be used.
+		 * This is checked before the bank type switch.
+		 */
+		const uint8_t *m_pageRead[256];
+		uint8_t *m_pageWrite[256];
+		bool m_pageMapEnabled;
+
+		/**
+		 * Rebuild the direct page map.
+		 * Called whenever the system banking changes.
+		 */
+		void updatePageMap(void);
+
 		/** Read Byte functions. **/
-		static uint8_t M68K_Read_Byte_Ram(uint32_t address);
-		static uint8_t M68K_Read_Byte_Misc(uint32_t address);
-		static uint8_t M68K_Read_Byte_VDP(uint32_t address);
-		static uint8_t M68K_Read_Byte_TMSS_Rom(uint32_t address);
-		static uint8_t M68K_Read_Byte_Pico_IO(uint32_t address);
+		uint8_t M68K_Read_Byte_Ram(uint32_t address);
+		uint8_t M68K_Read_Byte_Misc(uint32_t address);
+		uint8_t M68K_Read_Byte_VDP(uint32_t address);
+		uint8_t M68K_Read_Byte_TMSS_Rom(uint32_t address);
+		uint8_t M68K_Read_Byte_Pico_IO(uint32_t address);
 
 		/** Read Word functions. **/
-		static uint16_t M68K_Read_Word_Ram(uint32_t address);
-		static uint16_t M68K_Read_Word_Misc(uint32_t address);
-		static uint16_t M68K_Read_Word_VDP(uint32_t address);
-		static uint16_t M68K_Read_Word_TMSS_Rom(uint32_t address);
-		static uint16_t M68K_Read_Word_Pico_IO(uint32_t address);
+		uint16_t M68K_Read_Word_Ram(uint32_t address);
+		uint16_t M68K_Read_Word_Misc(uint32_t address);
+		uint16_t M68K_Read_Word_VDP(uint32_t address);
+		uint16_t M68K_Read_Word_TMSS_Rom(uint32_t address);
+		uint16_t M68K_Read_Word_Pico_IO(uint32_t address);
 
 		/** Write Byte functions. **/
-		static void M68K_Write_Byte_Ram(uint32_t address, uint8_t data);
-		static void M68K_Write_Byte_Misc(uint32_t address, uint8_t data);
-		static void M68K_Write_Byte_VDP(uint32_t address, uint8_t data);
-		static void M68K_Write_Byte_Pico_IO(uint32_t address, uint8_t data);
+		void M68K_Write_Byte_Ram(uint32_t address, uint8_t data);
+		void M68K_Write_Byte_Misc(uint32_t address, uint8_t data);
+		void M68K_Write_Byte_VDP(uint32_t address, uint8_t data);
+		void M68K_Write_Byte_Pico_IO(uint32_t address, uint8_t data);
 
 		/** Write Word functions. **/
-		static void M68K_Write_Word_Ram(uint32_t address, uint16_t data);
-		static void M68K_Write_Word_Misc(uint32_t address, uint16_t data);
-		static void M68K_Write_Word_VDP(uint32_t address, uint16_t data);
-		static void M68K_Write_Word_Pico_IO(uint32_t address, uint16_t data);
+		void M68K_Write_Word_Ram(uint32_t address, uint16_t data);
+		void M68K_Write_Word_Misc(uint32_t address, uint16_t data);
+		void M68K_Write_Word_VDP(uint32_t address, uint16_t data);
+		void M68K_Write_Word_Pico_IO(uint32_t address, uint16_t data);
 };
 
 }
@@ -31,6 +31,7 @@
 
 // M68K_Mem is needed for Z80_State.
 #include "M68K_Mem.hpp"
+#include "../EmuContext/EmuContext.hpp"
 
 // C includes.
 #include <stdint.h>
@@ -41,10 +42,23 @@ namespace LibGens {
 class Z80
 {
 	public:
-		Z80();
+		Z80(EmuContext *context);
 		~Z80();
 
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		Z80(const Z80 &);
+		Z80 &operator=(const Z80 &);
+
 	public:
+		/**
+		 * Initialize the Z80 CPU emulator.
+		 * Per-instance state is freed by ~Z80(), and the
+		 * shared flag tables are static, so no End() is needed.
+		 */
+		static void Init(void);
+
 		/**
 		 * Reinitialize the Z80.
 		 * This function should be called when starting emulation.
@@ -65,6 +79,9 @@ class Z80
 		/** END: Cz80 wrapper functions. **/
 
 	protected:
+		// Emulation context this CPU belongs to.
+		EmuContext *const m_context;
+
 		cz80_struc *m_z80;
 
 		// Cz80 uses "run xxx cycles" instead of an odometer.
@@ -141,14 +158,15 @@ inline void Z80::exec(int cyclesSubtract)
 	// M68K_Mem::Cycles_Z80 has the total number of cycles that should be run up to this point.
 	// cyclesSubtract is the number of cycles to save.
 	// cyclesTarget is the destination cycle count.
-	int cyclesTarget = (M68K_Mem::Cycles_Z80 - cyclesSubtract);
+	const M68K_Mem *const m68kMem = m_context->m_m68kMem;
+	int cyclesTarget = (m68kMem->Cycles_Z80 - cyclesSubtract);
 	// cyclesToRun is the number of cycles to run right now.
 	int cyclesToRun = cyclesTarget - m_cycleCnt;
 	if (cyclesToRun <= 0)
 		return;
 
 	// Only run the Z80 if it's enabled and it has the bus.
-	if (M68K_Mem::Z80_State == (Z80_STATE_ENABLED | Z80_STATE_BUSREQ)) {
+	if (m68kMem->Z80_State == (Z80_STATE_ENABLED | Z80_STATE_BUSREQ)) {
 		int ret = Cz80_Exec(m_z80, cyclesToRun);
 		if (ret >= 0) {
 			// ret == number of cycles run.
@@ -54,11 +54,11 @@ inline uint8_t Z80::Z80_MD_ReadB_YM2612(uint16_t address)
 
 	// The YM2612's RESET line is tied to the Z80's RESET line.
 	// TODO: Determine the correct return value.
-	if (M68K_Mem::Z80_State & Z80_STATE_RESET)
+	if (m_context->m_m68kMem->Z80_State & Z80_STATE_RESET)
 		return 0xFF;
 
 	// Return the YM2612 status register.
-	return SoundMgr::ms_Ym2612.read();
+	return m_context->m_soundMgr->m_ym2612.read();
 }
 
 /**
@@ -74,12 +74,7 @@ inline uint8_t Z80::Z80_MD_ReadB_VDP(uint16_t address)
 		return 0;
 	}
 
-	// TODO: Don't use EmuContext here...
-	EmuContext *context = EmuContext::Instance();
-	if (!context)
-		return 0;
-
-	Vdp *vdp = context->m_vdp;
+	Vdp *vdp = m_context->m_vdp;
 	uint8_t ret = 0; // TODO: Default to 0xFF?
 	switch (address & 0xFD) {
 		case 0x00:
@@ -147,7 +142,7 @@ inline uint8_t Z80::Z80_MD_ReadB_68K_Rom(uint16_t address)
 
 	uint32_t M68K_addr = address & 0x7FFF;
 	M68K_addr |= m_bankZ80;
-	return M68K_Mem::M68K_RB(M68K_addr);
+	return m_context->m_m68kMem->M68K_RB(M68K_addr);
 }
 
 /** Z80 Write Byte functions. **/
@@ -177,11 +172,11 @@ inline void Z80::Z80_MD_WriteB_Bank(uint16_t address, uint8_t data)
 inline void Z80::Z80_MD_WriteB_YM2612(uint16_t address, uint8_t data)
 {
 	// The YM2612's RESET line is tied to the Z80's RESET line.
-	if (M68K_Mem::Z80_State & Z80_STATE_RESET)
+	if (m_context->m_m68kMem->Z80_State & Z80_STATE_RESET)
 		return;
 
 	// Write to the YM2612.
-	SoundMgr::ms_Ym2612.write(address & 0x03, data);
+	m_context->m_soundMgr->m_ym2612.write(address & 0x03, data);
 }
 
 /**
@@ -197,12 +192,7 @@ inline void Z80::Z80_MD_WriteB_VDP(uint16_t address, uint8_t data)
 		return;
 	}
 
-	// TODO: Don't use EmuContext here...
-	EmuContext *context = EmuContext::Instance();
-	if (!context)
-		return;
-
-	Vdp *vdp = context->m_vdp;
+	Vdp *vdp = m_context->m_vdp;
 	switch (address & 0xFC) {
 		case 0x00:
 			// VDP data port.
@@ -215,7 +205,7 @@ inline void Z80::Z80_MD_WriteB_VDP(uint16_t address, uint8_t data)
 		case 0x10: case 0x14:
 			// PSG control port. (Odd addresses only)
 			if (address & 1) {
-				SoundMgr::ms_Psg.write(data);
+				m_context->m_soundMgr->m_psg.write(data);
 			}
 			break;
 		case 0x18:
@@ -245,7 +235,7 @@ inline void Z80::Z80_MD_WriteB_68K_Rom(uint16_t address, uint8_t data)
 	// Reference: http://gendev.spritesmind.net/forum/viewtopic.php?t=985
 	uint32_t M68K_addr = address & 0x7FFF;
 	M68K_addr |= m_bankZ80;
-	M68K_Mem::M68K_WB(M68K_addr, data);
+	m_context->m_m68kMem->M68K_WB(M68K_addr, data);
 }
 
 /** Z80 General Read/Write functions. **/
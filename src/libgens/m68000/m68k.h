@@ -243,6 +243,26 @@ typedef struct
 
 struct _m68ki_cpu_core;
 typedef struct _m68ki_cpu_core m68ki_cpu_core;
+
+/* Gens: Decoded instruction cache.
+ * Caches the opcode handler and cycle count for each PC,
+ * so straight-line code doesn't have to be decoded again.
+ * Extension words are still read by the opcode handlers,
+ * so only the opcode itself needs to be checked.
+ */
+#define M68K_DECODE_CACHE_SIZE  8192  /* number of entries; must be a power of two */
+
+#define M68K_DECODE_PAGE_NONE   0     /* page is not cached */
+#define M68K_DECODE_PAGE_ROM    1     /* page never changes; cached entries are used as-is */
+#define M68K_DECODE_PAGE_RAM    2     /* page may be written; opcode is verified before use */
+
+typedef struct
+{
+  uint tag;                                  /* PC + 1 (0 == invalid) */
+  unsigned short ir;                         /* Opcode */
+  unsigned short cycles;                     /* Base cycle count */
+  void (*handler)(m68ki_cpu_core *m68k);     /* Opcode handler */
+} m68ki_decode_entry;
 struct _m68ki_cpu_core
 {
   void *device;
@@ -326,6 +346,10 @@ struct _m68ki_cpu_core
   const unsigned char* cyc_instruction;
   const unsigned char* cyc_exception;
 
+  /* Gens: Decoded instruction cache (NULL if disabled) */
+  m68ki_decode_entry *decode_cache;
+  unsigned char decode_page[256];            /* M68K_DECODE_PAGE_* for each 64 KB page */
+
   /* Callbacks to host */
 #if M68K_EMULATE_INT_ACK
   int  (*int_ack_callback)(m68ki_cpu_core *cpu, int int_line);           /* Interrupt Acknowledge */
@@ -445,6 +469,24 @@ extern unsigned int m68k_get_reg(m68ki_cpu_core *, m68k_register_t reg);
 /* Poke values into the internals of the currently running CPU context */
 extern void m68k_set_reg(m68ki_cpu_core *, m68k_register_t reg, unsigned int value);
 
+/* Gens: Enable or disable the decoded instruction cache.
+ * The cache is allocated on enable and freed on disable.
+ * Call with enable == 0 before discarding the CPU context.
+ * Returns 0 on success, or -1 if the cache could not be allocated.
+ */
+extern int m68k_set_decode_cache(m68ki_cpu_core *, int enable);
+
+/* Gens: Invalidate all decoded instruction cache entries.
+ * This must be called whenever memory_map[].base changes
+ * or ROM data is modified.
+ */
+extern void m68k_flush_decode_cache(m68ki_cpu_core *);
+
+/* Gens: Set the decoded instruction cache type for a 64 KB page.
+ * type is one of M68K_DECODE_PAGE_*.
+ */
+extern void m68k_set_decode_page(m68ki_cpu_core *, unsigned int page, int type);
+
 
 /* ======================================================================== */
 /* ============================== END OF FILE ============================= */
@@ -34,6 +34,8 @@ static const char copyright_notice[] =
 /* ======================================================================== */
 
 #include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
 #include "m68kconf.h"
 #include "m68kcpu.h"
 #include "m68kops.h"
@@ -682,6 +684,39 @@ static int m68k_translate( m68ki_cpu_core *m68k, unsigned int *address )
 	return TRUE;
 }
 
+/* Gens: Execute one instruction using the decoded instruction cache */
+INLINE void m68ki_execute_cached(m68ki_cpu_core *m68k)
+{
+	const uint pc = REG_PC;
+	const uint type = m68k->decode_page[(pc >> 16) & 0xff];
+	m68ki_decode_entry *entry;
+
+	if (type == M68K_DECODE_PAGE_NONE)
+	{
+		/* Page isn't cached. Decode normally. */
+		m68k->ir = m68ki_read_imm_16(m68k);
+		m68ki_instruction_jump_table[m68k->ir](m68k);
+		m68k->remaining_cycles -= m68k->cyc_instruction[m68k->ir];
+		return;
+	}
+
+	entry = &m68k->decode_cache[(pc >> 1) & (M68K_DECODE_CACHE_SIZE - 1)];
+	if (entry->tag != pc + 1 ||
+	    (type == M68K_DECODE_PAGE_RAM && entry->ir != m68k_read_immediate_16(m68k, pc)))
+	{
+		/* Cache miss, or the opcode was overwritten. */
+		entry->tag = pc + 1;
+		entry->ir = m68k_read_immediate_16(m68k, pc);
+		entry->cycles = m68k->cyc_instruction[entry->ir];
+		entry->handler = m68ki_instruction_jump_table[entry->ir];
+	}
+
+	REG_PC = pc + 2;
+	m68k->ir = entry->ir;
+	entry->handler(m68k);
+	m68k->remaining_cycles -= entry->cycles;
+}
+
 /* Execute some instructions until we use up cycles clock cycles */
 int m68k_execute(m68ki_cpu_core *m68k, unsigned int cycles)
 {
@@ -708,6 +743,18 @@ int m68k_execute(m68ki_cpu_core *m68k, unsigned int cycles)
 		/* Return point if we had an address error */
 		m68ki_set_address_error_trap(m68k); /* auto-disable (see m68kcpu.h) */
 
+		if (m68k->decode_cache)
+		{
+			/* Gens: Main loop, using the decoded instruction cache. */
+			do
+			{
+				m68ki_trace_t1(); /* auto-disable (see m68kcpu.h) */
+				REG_PPC = REG_PC;
+				m68ki_execute_cached(m68k);
+				m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
+			} while (m68k->remaining_cycles > 0);
+		}
+		else
 		/* Main loop.  Keep going until we run out of clock cycles */
 		do
 		{
@@ -736,6 +783,40 @@ int m68k_execute(m68ki_cpu_core *m68k, unsigned int cycles)
 	return m68k->initial_cycles - m68k->remaining_cycles;
 }
 
+/* Gens: Enable or disable the decoded instruction cache */
+int m68k_set_decode_cache(m68ki_cpu_core *m68k, int enable)
+{
+	if (!enable)
+	{
+		free(m68k->decode_cache);
+		m68k->decode_cache = NULL;
+		return 0;
+	}
+
+	if (!m68k->decode_cache)
+	{
+		/* calloc() zeroes the tags, so all entries start out invalid. */
+		m68k->decode_cache = (m68ki_decode_entry*)calloc(M68K_DECODE_CACHE_SIZE, sizeof(m68ki_decode_entry));
+		if (!m68k->decode_cache)
+			return -1;
+	}
+	return 0;
+}
+
+/* Gens: Invalidate all decoded instruction cache entries */
+void m68k_flush_decode_cache(m68ki_cpu_core *m68k)
+{
+	if (m68k->decode_cache)
+		memset(m68k->decode_cache, 0, M68K_DECODE_CACHE_SIZE * sizeof(m68ki_decode_entry));
+}
+
+/* Gens: Set the decoded instruction cache type for a 64 KB page */
+void m68k_set_decode_page(m68ki_cpu_core *m68k, unsigned int page, int type)
+{
+	if (page < sizeof(m68k->decode_page))
+		m68k->decode_page[page] = (unsigned char)type;
+}
+
 static void m68k_init_internal(m68ki_cpu_core *m68k)
 {
 	static UINT32 emulation_initialized = 0;
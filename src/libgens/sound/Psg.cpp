@@ -39,14 +39,14 @@
 // C includes.
 #include <stdint.h>
 // C includes. (C++ namespace)
+#include <cerrno>
 #include <cstring>
 
 // Sound Manager.
 #include "SoundMgr.hpp"
-#include "Vdp/Vdp.hpp"
 
-// TODO: Get rid of EmuContext.
-#include "EmuContext/EmuContext.hpp"
+// ZOMG
+#include "libzomg/ZomgMem.hpp"
 
 /* Message logging. */
 #include "macros/log_msg.h"
@@ -82,6 +82,9 @@ PsgPrivate::PsgPrivate(Psg *q)
 	: q(q)
 	, writeLen(0)
 	, enabled(true)	// TODO: Make this customizable.
+	, bufPtrL(nullptr)
+	, bufPtrR(nullptr)
+	, soundMgr(nullptr)
 {
 	// TODO: Move this here?
 	// (It's currently initialized in the Psg constructors.)
@@ -269,10 +272,10 @@ void Psg::reInit(int clock, int rate)
  */
 void Psg::write(uint8_t data)
 {
-#if 0 // TODO: GYM
-	if (GYM_Dumping)
-		gym_dump_update(3, (uint8_t)data, 0);
-#endif
+	// Log the data write for sound capture.
+	if (d->soundMgr) {
+		d->soundMgr->capturePsg(data);
+	}
 
 	// TODO: Combine the masking used in both cases.
 	if (data & 0x80) {
@@ -408,6 +411,70 @@ void Psg::zomgRestore(const Zomg_PsgSave_t *state)
 	// TODO: Implement Game Gear stereo.
 }
 
+/**
+ * Internal PSG state for snapshots.
+ * Volumes and counter steps aren't saved, since they
+ * depend on the sample rate. They're recalculated from
+ * the registers by snapshotRestore().
+ */
+struct PsgSnapshot_t {
+	int curChan;
+	int curReg;
+	unsigned int reg[8];
+	unsigned int counter[4];
+	unsigned int lfsr;
+};
+
+/**
+ * Save the internal PSG state to a snapshot.
+ * This should be called after zomgSave().
+ * @param zomg Snapshot.
+ */
+void Psg::snapshotSave(LibZomg::ZomgMem *zomg) const
+{
+	PsgSnapshot_t snap;
+	snap.curChan = d->curChan;
+	snap.curReg = d->curReg;
+	memcpy(snap.reg, d->reg, sizeof(snap.reg));
+	memcpy(snap.counter, d->counter, sizeof(snap.counter));
+	snap.lfsr = d->lfsr;
+	zomg->saveBlock(LibZomg::ZomgMem::BLOCK_INT_PSG, &snap, sizeof(snap));
+}
+
+/**
+ * Restore the complete PSG state from a snapshot.
+ * This replaces zomgRestore(); no register writes are replayed.
+ * @param zomg Snapshot.
+ * @return 0 on success; negative errno on error.
+ * If an error occurs, the PSG state is not modified.
+ */
+int Psg::snapshotRestore(LibZomg::ZomgMem *zomg)
+{
+	PsgSnapshot_t snap;
+	int ret = zomg->loadBlock(LibZomg::ZomgMem::BLOCK_INT_PSG, &snap, sizeof(snap));
+	if (ret != (int)sizeof(snap))
+		return (ret < 0 ? ret : -EINVAL);
+
+	d->curChan = snap.curChan;
+	d->curReg = snap.curReg;
+	memcpy(d->reg, snap.reg, sizeof(d->reg));
+	memcpy(d->counter, snap.counter, sizeof(d->counter));
+	d->lfsr = snap.lfsr;
+
+	// Recalculate the volumes and counter steps.
+	// This matches what write() does for each register.
+	for (int i = 0; i < 4; i++) {
+		d->volume[i] = d->volumeTable[d->reg[(i*2)+1] & 0x0F];
+	}
+	for (int i = 0; i < 3; i++) {
+		d->cntStep[i] = d->stepTable[d->reg[i*2] & 0x3FF];
+	}
+	d->noiseStepTable[3] = (d->cntStep[2] >> 1);
+	d->cntStep[3] = d->noiseStepTable[d->reg[6] & 3];
+	d->lfsrMask = ((d->reg[6] & 4) ? d->LFSR_MASK_WHITE : d->LFSR_MASK_PERIODIC);
+	return 0;
+}
+
 /** Gens-specific code **/
 
 /**
@@ -415,26 +482,20 @@ void Psg::zomgRestore(const Zomg_PsgSave_t *state)
  */
 void Psg::specialUpdate(void)
 {
-	if (d->writeLen <= 0 || !d->enabled)
+	if (d->writeLen <= 0 || !d->enabled || !d->soundMgr)
 		return;
 
 	// Update the sound buffer.
 	d->update(d->bufPtrL, d->bufPtrR, d->writeLen);
 	d->writeLen = 0;
 
-	// TODO: Don't use EmuContext here...
-	int line_num = 1;
-	EmuContext *context = EmuContext::Instance();
-	if (context != nullptr) {
-		line_num = (context->m_vdp->VDP_Lines.currentLine + 1);
-	}
-
 	// Determine the new starting position.
-	int writePos = SoundMgr::GetWritePos(line_num);
+	SoundMgr *const soundMgr = d->soundMgr;
+	int writePos = soundMgr->getWritePos(soundMgr->currentLine() + 1);
 
 	// Update the PSG buffer pointers.
-	d->bufPtrL = &SoundMgr::ms_SegBufL[writePos];
-	d->bufPtrR = &SoundMgr::ms_SegBufR[writePos];
+	d->bufPtrL = &soundMgr->m_segBufL[writePos];
+	d->bufPtrR = &soundMgr->m_segBufR[writePos];
 }
 
 /** PSG write length. **/
@@ -454,8 +515,26 @@ void Psg::clearWriteLen(void)
  */
 void Psg::resetBufferPtrs(void)
 {
-	d->bufPtrL = &SoundMgr::ms_SegBufL[0];
-	d->bufPtrR = &SoundMgr::ms_SegBufR[0];
+	if (!d->soundMgr) {
+		// No Sound Manager.
+		d->bufPtrL = nullptr;
+		d->bufPtrR = nullptr;
+		return;
+	}
+
+	d->bufPtrL = &d->soundMgr->m_segBufL[0];
+	d->bufPtrR = &d->soundMgr->m_segBufR[0];
+}
+
+/**
+ * Set the Sound Manager that owns this PSG.
+ * The PSG writes its output to the Sound Manager's segment buffers.
+ * @param soundMgr Sound Manager. (If nullptr, PSG output is not buffered.)
+ */
+void Psg::setSoundMgr(SoundMgr *soundMgr)
+{
+	d->soundMgr = soundMgr;
+	resetBufferPtrs();
 }
 
 // TODO: Eliminate the GSXv7 stuff.
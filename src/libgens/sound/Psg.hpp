@@ -31,9 +31,14 @@
 #include "../macros/common.h"
 
 struct _Zomg_PsgSave_t;
+namespace LibZomg {
+	class ZomgMem;
+}
 
 namespace LibGens {
 
+class SoundMgr;
+
 class PsgPrivate;
 class Psg
 {
@@ -68,6 +73,17 @@ class Psg
 		/** ZOMG savestate functions. **/
 		void zomgSave(_Zomg_PsgSave_t *state);
 		void zomgRestore(const _Zomg_PsgSave_t *state);
+
+		/**
+		 * Snapshot functions.
+		 * These save the internal state that isn't
+		 * stored by zomgSave(), e.g. tone counters.
+		 * snapshotRestore() restores the complete state
+		 * without zomgRestore(), and returns 0 on success
+		 * or a negative errno on error.
+		 */
+		void snapshotSave(LibZomg::ZomgMem *zomg) const;
+		int snapshotRestore(LibZomg::ZomgMem *zomg);
 		
 		/** Gens-specific code. */
 		void specialUpdate(void);
@@ -81,6 +97,9 @@ class Psg
 		// Reset buffer pointers.
 		void resetBufferPtrs(void);
 
+		// Set the Sound Manager.
+		void setSoundMgr(SoundMgr *soundMgr);
+
 	public:
 		// Super secret debug stuff!
 		// For use by MDP plugins and test suites.
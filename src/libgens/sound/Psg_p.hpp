@@ -121,6 +121,9 @@ class PsgPrivate
 		// TODO: Figure out how to get rid of these!
 		int32_t *bufPtrL;
 		int32_t *bufPtrR;
+
+		// Sound Manager that owns this PSG.
+		SoundMgr *soundMgr;
 };
 
 }
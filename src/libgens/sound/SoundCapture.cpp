@@ -0,0 +1,738 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SoundCapture.cpp: VGM/GYM/WAV sound capture.                            *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "SoundCapture.hpp"
+
+// M68K.hpp has CLOCK_NTSC and CLOCK_PAL #defines.
+#include "cpu/M68K.hpp"
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::condition_variable;
+using std::deque;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+namespace LibGens {
+
+class SoundCapturePrivate
+{
+	public:
+		SoundCapturePrivate();
+		~SoundCapturePrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SoundCapturePrivate(const SoundCapturePrivate &);
+		SoundCapturePrivate &operator=(const SoundCapturePrivate &);
+
+	public:
+		// Buffer pool.
+		// 16 x 64 KB is about 6 seconds of 48 kHz stereo audio.
+		// The register log can grow the pool past BLOCK_COUNT.
+		static const unsigned int BLOCK_SIZE = 64*1024;
+		static const unsigned int BLOCK_COUNT = 16;
+
+		struct Block {
+			FILE *f;		// Destination file.
+			unsigned int len;	// Number of bytes used.
+			uint8_t data[BLOCK_SIZE];
+		};
+		// All allocated blocks.
+		// Only accessed by the emulation thread.
+		vector<Block*> pool;
+
+		// Free blocks. (stack)
+		// Protected by mtx.
+		vector<Block*> freeList;
+
+		// Blocks waiting to be written. (FIFO)
+		// Protected by mtx.
+		deque<Block*> queue;
+
+		// Writer thread.
+		thread writer;
+		mutex mtx;
+		condition_variable cond;
+		bool quit;		// Protected by mtx.
+		int writeError;		// Negative errno. (Protected by mtx.)
+
+		/**
+		 * Output stream.
+		 */
+		struct Stream {
+			FILE *f;		// nullptr if not open.
+			Block *cur;		// Block being filled.
+			uint32_t bytes;		// Bytes written, not including the header.
+			bool canDrop;		// If true, data may be dropped if no block is free.
+		};
+		Stream reg;	// Register log.
+		Stream wav;	// Audio output.
+
+		// Register log.
+		SoundCapture::RegFormat regFormat;
+		bool isPal;
+		uint64_t lineBase;	// Lines before the current frame.
+		uint64_t vgmSample;	// Samples covered by VGM wait commands.
+
+		// Audio output format.
+		int wavChannels;
+		int wavRate;
+
+		// Number of dropped audio output segments.
+		unsigned int dropped;
+
+		/**
+		 * Writer thread function.
+		 */
+		void writerFunc(void);
+
+		/**
+		 * Free the buffer pool.
+		 */
+		void freePool(void);
+
+		/**
+		 * Append data to a stream.
+		 * If no buffer is available, the pool is grown, or the
+		 * data is dropped if the stream allows it.
+		 * @param s Stream.
+		 * @param data Data.
+		 * @param len Length of data. (must be <= BLOCK_SIZE)
+		 * @return True if the data was appended; false if it was dropped or a write failed.
+		 */
+		bool append(Stream &s, const void *data, unsigned int len);
+
+		/**
+		 * Queue a stream's current block for writing.
+		 * @param s Stream.
+		 */
+		void flush(Stream &s);
+
+		/**
+		 * Convert a line count to a VGM sample count.
+		 * @param lines Lines since the start of the capture.
+		 * @return Sample count, in 44,100 Hz samples.
+		 */
+		inline uint64_t linesToSamples(uint64_t lines) const;
+
+		/**
+		 * Write VGM wait commands up to the specified sample.
+		 * @param sample Sample count, in 44,100 Hz samples.
+		 */
+		void vgmWait(uint64_t sample);
+
+		/**
+		 * Write the VGM file header.
+		 * @param f VGM file, positioned at the start.
+		 * @return True on success; false on error.
+		 */
+		bool writeVgmHeader(FILE *f) const;
+
+		/**
+		 * Write the WAV file header.
+		 * @param f WAV file, positioned at the start.
+		 * @return True on success; false on error.
+		 */
+		bool writeWavHeader(FILE *f) const;
+
+		// Header sizes.
+		static const unsigned int VGM_HEADER_SIZE = 0x40;
+		static const unsigned int WAV_HEADER_SIZE = 44;
+
+		// VGM sample rate.
+		static const unsigned int VGM_RATE = 44100;
+		// Master clock cycles per VDP line.
+		static const unsigned int CYCLES_PER_LINE = 3420;
+};
+
+/** SoundCapturePrivate **/
+
+SoundCapturePrivate::SoundCapturePrivate()
+	: quit(false)
+	, writeError(0)
+	, regFormat(SoundCapture::REGFMT_VGM)
+	, isPal(false)
+	, lineBase(0)
+	, vgmSample(0)
+	, wavChannels(0)
+	, wavRate(0)
+	, dropped(0)
+{
+	memset(&reg, 0, sizeof(reg));
+	memset(&wav, 0, sizeof(wav));
+	wav.canDrop = true;
+}
+
+SoundCapturePrivate::~SoundCapturePrivate()
+{
+	assert(!writer.joinable());
+	freePool();
+}
+
+/**
+ * Writer thread function.
+ */
+void SoundCapturePrivate::writerFunc(void)
+{
+	unique_lock<mutex> lock(mtx);
+	while (true) {
+		while (queue.empty() && !quit) {
+			cond.wait(lock);
+		}
+		if (queue.empty()) {
+			// Quit was requested, and all blocks were written.
+			break;
+		}
+
+		Block *const block = queue.front();
+		queue.pop_front();
+
+		if (writeError == 0) {
+			// Don't hold the lock while writing.
+			lock.unlock();
+			int err = 0;
+			if (fwrite(block->data, 1, block->len, block->f) != block->len) {
+				err = (errno != 0 ? -errno : -EIO);
+			}
+			lock.lock();
+
+			if (err != 0) {
+				// Write error. Stop writing; the remaining
+				// blocks are returned to the pool unwritten.
+				writeError = err;
+			}
+		}
+
+		freeList.push_back(block);
+	}
+}
+
+/**
+ * Free the buffer pool.
+ */
+void SoundCapturePrivate::freePool(void)
+{
+	for (size_t i = 0; i < pool.size(); i++) {
+		delete pool[i];
+	}
+	vector<Block*>().swap(pool);
+	vector<Block*>().swap(freeList);
+	queue.clear();
+}
+
+/**
+ * Append data to a stream.
+ * If no buffer is available, the pool is grown, or the
+ * data is dropped if the stream allows it.
+ * @param s Stream.
+ * @param data Data.
+ * @param len Length of data. (must be <= BLOCK_SIZE)
+ * @return True if the data was appended; false if it was dropped or a write failed.
+ */
+bool SoundCapturePrivate::append(Stream &s, const void *data, unsigned int len)
+{
+	assert(len <= BLOCK_SIZE);
+	if (s.cur && s.cur->len + len > BLOCK_SIZE) {
+		flush(s);
+	}
+
+	if (!s.cur) {
+		// Get a free block.
+		{
+			std::lock_guard<mutex> lock(mtx);
+			if (writeError != 0) {
+				// The capture has failed.
+				// Don't bother queueing more data.
+				return false;
+			}
+			if (!freeList.empty()) {
+				s.cur = freeList.back();
+				freeList.pop_back();
+			}
+		}
+		if (!s.cur) {
+			if (s.canDrop) {
+				// No free blocks. Drop the data.
+				dropped++;
+				return false;
+			}
+
+			// No free blocks. Grow the pool.
+			s.cur = new Block;
+			pool.push_back(s.cur);
+		}
+		s.cur->f = s.f;
+		s.cur->len = 0;
+	}
+
+	memcpy(&s.cur->data[s.cur->len], data, len);
+	s.cur->len += len;
+	s.bytes += len;
+	return true;
+}
+
+/**
+ * Queue a stream's current block for writing.
+ * @param s Stream.
+ */
+void SoundCapturePrivate::flush(Stream &s)
+{
+	if (!s.cur)
+		return;
+
+	{
+		std::lock_guard<mutex> lock(mtx);
+		queue.push_back(s.cur);
+	}
+	cond.notify_one();
+	s.cur = nullptr;
+}
+
+/**
+ * Convert a line count to a VGM sample count.
+ * @param lines Lines since the start of the capture.
+ * @return Sample count, in 44,100 Hz samples.
+ */
+inline uint64_t SoundCapturePrivate::linesToSamples(uint64_t lines) const
+{
+	// Computed from the total line count instead of
+	// accumulating per-line lengths so rounding errors
+	// don't build up over a long capture.
+	const uint64_t clock = (isPal ? CLOCK_PAL : CLOCK_NTSC);
+	return (lines * VGM_RATE * CYCLES_PER_LINE) / clock;
+}
+
+/**
+ * Write VGM wait commands up to the specified sample.
+ * @param sample Sample count, in 44,100 Hz samples.
+ */
+void SoundCapturePrivate::vgmWait(uint64_t sample)
+{
+	while (vgmSample < sample) {
+		uint64_t wait = sample - vgmSample;
+		if (wait > 0xFFFF)
+			wait = 0xFFFF;
+
+		uint8_t cmd[3];
+		unsigned int len;
+		if (wait == 735) {
+			// Wait 1/60 second.
+			cmd[0] = 0x62;
+			len = 1;
+		} else if (wait == 882) {
+			// Wait 1/50 second.
+			cmd[0] = 0x63;
+			len = 1;
+		} else if (wait <= 16) {
+			// Short wait.
+			cmd[0] = 0x70 | (uint8_t)(wait - 1);
+			len = 1;
+		} else {
+			// Wait n samples.
+			cmd[0] = 0x61;
+			cmd[1] = (uint8_t)(wait & 0xFF);
+			cmd[2] = (uint8_t)(wait >> 8);
+			len = 3;
+		}
+
+		if (!append(reg, cmd, len))
+			return;	// Write error.
+		vgmSample += wait;
+	}
+}
+
+/**
+ * Store a 16-bit little-endian value.
+ * @param p Destination.
+ * @param val Value.
+ */
+static inline void putLE16(uint8_t *p, uint16_t val)
+{
+	p[0] = (uint8_t)(val & 0xFF);
+	p[1] = (uint8_t)(val >> 8);
+}
+
+/**
+ * Store a 32-bit little-endian value.
+ * @param p Destination.
+ * @param val Value.
+ */
+static inline void putLE32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)(val & 0xFF);
+	p[1] = (uint8_t)((val >> 8) & 0xFF);
+	p[2] = (uint8_t)((val >> 16) & 0xFF);
+	p[3] = (uint8_t)(val >> 24);
+}
+
+/**
+ * Write the VGM file header.
+ * @param f VGM file, positioned at the start.
+ * @return True on success; false on error.
+ */
+bool SoundCapturePrivate::writeVgmHeader(FILE *f) const
+{
+	// Reference: http://vgmrips.net/wiki/VGM_Specification
+	const unsigned int clock = (isPal ? CLOCK_PAL : CLOCK_NTSC);
+
+	uint8_t hdr[VGM_HEADER_SIZE];
+	memset(hdr, 0, sizeof(hdr));
+	memcpy(&hdr[0x00], "Vgm ", 4);
+	putLE32(&hdr[0x04], VGM_HEADER_SIZE + reg.bytes - 4);	// EOF offset
+	putLE32(&hdr[0x08], 0x150);				// Version
+	putLE32(&hdr[0x0C], clock / 15);			// SN76489 clock
+	putLE32(&hdr[0x18], (uint32_t)vgmSample);		// Total samples
+	putLE32(&hdr[0x24], (isPal ? 50 : 60));			// Rate
+	putLE16(&hdr[0x28], 0x0009);				// SN76489 feedback
+	hdr[0x2A] = 16;						// SN76489 shift register width
+	putLE32(&hdr[0x2C], clock / 7);				// YM2612 clock
+	putLE32(&hdr[0x34], VGM_HEADER_SIZE - 0x34);		// VGM data offset
+	return (fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr));
+}
+
+/**
+ * Write the WAV file header.
+ * @param f WAV file, positioned at the start.
+ * @return True on success; false on error.
+ */
+bool SoundCapturePrivate::writeWavHeader(FILE *f) const
+{
+	// Default to 44,100 Hz stereo if no audio was written.
+	const unsigned int channels = (wavChannels > 0 ? wavChannels : 2);
+	const unsigned int rate = (wavRate > 0 ? wavRate : 44100);
+
+	uint8_t hdr[WAV_HEADER_SIZE];
+	memcpy(&hdr[0], "RIFF", 4);
+	putLE32(&hdr[4], WAV_HEADER_SIZE - 8 + wav.bytes);
+	memcpy(&hdr[8], "WAVEfmt ", 8);
+	putLE32(&hdr[16], 16);				// fmt chunk size
+	putLE16(&hdr[20], 1);				// PCM
+	putLE16(&hdr[22], channels);
+	putLE32(&hdr[24], rate);
+	putLE32(&hdr[28], rate * channels * 2);		// Bytes per second
+	putLE16(&hdr[32], channels * 2);		// Block alignment
+	putLE16(&hdr[34], 16);				// Bits per sample
+	memcpy(&hdr[36], "data", 4);
+	putLE32(&hdr[40], wav.bytes);
+	return (fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr));
+}
+
+/** SoundCapture **/
+
+SoundCapture::SoundCapture()
+	: d(new SoundCapturePrivate())
+{ }
+
+SoundCapture::~SoundCapture()
+{
+	stop();
+	delete d;
+}
+
+/**
+ * Start capturing.
+ * @param regFilename Register log filename, or nullptr to not log registers.
+ * @param regFormat Register log format.
+ * @param wavFilename WAV filename, or nullptr to not capture audio output.
+ * @return 0 on success; negative errno on error.
+ */
+int SoundCapture::start(const char *regFilename, RegFormat regFormat, const char *wavFilename)
+{
+	if (isRunning())
+		return -EBUSY;
+	if (!regFilename && !wavFilename)
+		return -EINVAL;
+	if (regFormat < REGFMT_VGM || regFormat >= REGFMT_MAX)
+		return -EINVAL;
+
+	// Open the files.
+	// Placeholder headers are written here, and
+	// the real headers are written by stop().
+	int err = 0;
+	if (regFilename) {
+		d->reg.f = fopen(regFilename, "wb");
+		if (!d->reg.f) {
+			err = -errno;
+		} else if (regFormat == REGFMT_VGM && !d->writeVgmHeader(d->reg.f)) {
+			err = (errno != 0 ? -errno : -EIO);
+		}
+	}
+	if (err == 0 && wavFilename) {
+		d->wav.f = fopen(wavFilename, "wb");
+		if (!d->wav.f) {
+			err = -errno;
+		} else if (!d->writeWavHeader(d->wav.f)) {
+			err = (errno != 0 ? -errno : -EIO);
+		}
+	}
+	if (err != 0) {
+		if (d->reg.f) {
+			fclose(d->reg.f);
+			d->reg.f = nullptr;
+		}
+		if (d->wav.f) {
+			fclose(d->wav.f);
+			d->wav.f = nullptr;
+		}
+		return err;
+	}
+
+	// Reset the capture state.
+	d->regFormat = regFormat;
+	d->reg.bytes = 0;
+	d->wav.bytes = 0;
+	d->lineBase = 0;
+	d->vgmSample = 0;
+	d->wavChannels = 0;
+	d->wavRate = 0;
+	d->dropped = 0;
+
+	// Allocate the buffer pool.
+	d->pool.resize(SoundCapturePrivate::BLOCK_COUNT);
+	for (unsigned int i = 0; i < SoundCapturePrivate::BLOCK_COUNT; i++) {
+		d->pool[i] = new SoundCapturePrivate::Block;
+	}
+	d->freeList = d->pool;
+
+	// Start the writer thread.
+	d->quit = false;
+	d->writeError = 0;
+	d->writer = thread(&SoundCapturePrivate::writerFunc, d);
+	return 0;
+}
+
+/**
+ * Stop capturing.
+ * Queued data is written, and the file headers are finalized.
+ * @return 0 on success; negative errno if a write failed.
+ */
+int SoundCapture::stop(void)
+{
+	if (!isRunning())
+		return 0;
+
+	if (d->reg.f && d->regFormat == REGFMT_VGM) {
+		// Wait until the end of the last frame,
+		// then end the VGM data.
+		d->vgmWait(d->linesToSamples(d->lineBase));
+		static const uint8_t vgmEnd = 0x66;
+		d->append(d->reg, &vgmEnd, 1);
+	}
+
+	// Write the remaining data.
+	d->flush(d->reg);
+	d->flush(d->wav);
+	{
+		std::lock_guard<mutex> lock(d->mtx);
+		d->quit = true;
+	}
+	d->cond.notify_one();
+	d->writer.join();
+
+	// Write the real headers.
+	// If the data couldn't be written, the headers are left as-is.
+	int err = d->writeError;
+	if (d->reg.f) {
+		if (err == 0 && d->regFormat == REGFMT_VGM) {
+			if (fseek(d->reg.f, 0, SEEK_SET) != 0 ||
+			    !d->writeVgmHeader(d->reg.f))
+			{
+				err = (errno != 0 ? -errno : -EIO);
+			}
+		}
+		if (fclose(d->reg.f) != 0 && err == 0) {
+			err = (errno != 0 ? -errno : -EIO);
+		}
+		d->reg.f = nullptr;
+	}
+	if (d->wav.f) {
+		if (err == 0) {
+			if (fseek(d->wav.f, 0, SEEK_SET) != 0 ||
+			    !d->writeWavHeader(d->wav.f))
+			{
+				err = (errno != 0 ? -errno : -EIO);
+			}
+		}
+		if (fclose(d->wav.f) != 0 && err == 0) {
+			err = (errno != 0 ? -errno : -EIO);
+		}
+		d->wav.f = nullptr;
+	}
+
+	// Free the buffer pool.
+	d->freePool();
+	return err;
+}
+
+/**
+ * Is a capture running?
+ * @return True if a capture is running; false if not.
+ */
+bool SoundCapture::isRunning(void) const
+{
+	return d->writer.joinable();
+}
+
+/**
+ * Get the number of writes dropped because no buffer was available.
+ * Audio output is counted once per dropped segment.
+ * @return Number of dropped writes.
+ */
+unsigned int SoundCapture::dropped(void) const
+{
+	return d->dropped;
+}
+
+/**
+ * Set the system region.
+ * This determines the chip clocks and the line rate.
+ * @param isPal If true, system is PAL.
+ */
+void SoundCapture::setRegion(bool isPal)
+{
+	if (d->isPal == isPal)
+		return;
+
+	// Keep the timestamps continuous across the change.
+	// lineBase is rescaled to the equivalent number of
+	// lines in the new region.
+	const uint64_t sample = d->linesToSamples(d->lineBase);
+	d->isPal = isPal;
+	const uint64_t clock = (isPal ? CLOCK_PAL : CLOCK_NTSC);
+	d->lineBase = (sample * clock) /
+		(SoundCapturePrivate::VGM_RATE * SoundCapturePrivate::CYCLES_PER_LINE);
+}
+
+/**
+ * Log a YM2612 data write.
+ * @param port Register bank. (0 or 1)
+ * @param reg Register number.
+ * @param data Data value.
+ * @param line Current VDP line.
+ */
+void SoundCapture::logYm2612(int port, uint8_t reg, uint8_t data, int line)
+{
+	if (!d->reg.f)
+		return;
+
+	assert(port == 0 || port == 1);
+	uint8_t cmd[3];
+	if (d->regFormat == REGFMT_VGM) {
+		d->vgmWait(d->linesToSamples(d->lineBase + line));
+		cmd[0] = 0x52 + port;
+	} else {
+		cmd[0] = 0x01 + port;
+	}
+	cmd[1] = reg;
+	cmd[2] = data;
+	d->append(d->reg, cmd, sizeof(cmd));
+}
+
+/**
+ * Log a PSG data write.
+ * @param data Data value.
+ * @param line Current VDP line.
+ */
+void SoundCapture::logPsg(uint8_t data, int line)
+{
+	if (!d->reg.f)
+		return;
+
+	uint8_t cmd[2];
+	if (d->regFormat == REGFMT_VGM) {
+		d->vgmWait(d->linesToSamples(d->lineBase + line));
+		cmd[0] = 0x50;
+	} else {
+		cmd[0] = 0x03;
+	}
+	cmd[1] = data;
+	d->append(d->reg, cmd, sizeof(cmd));
+}
+
+/**
+ * End the current frame.
+ * @param lines Number of lines in the frame.
+ */
+void SoundCapture::endFrame(int lines)
+{
+	if (!d->reg.f)
+		return;
+
+	if (d->regFormat == REGFMT_GYM) {
+		// GYM: Wait one frame.
+		static const uint8_t gymWait = 0x00;
+		d->append(d->reg, &gymWait, 1);
+	}
+	d->lineBase += lines;
+}
+
+/**
+ * Write audio output.
+ * The WAV format is set by the first call.
+ * @param samples Audio samples. (16-bit, host-endian, interleaved)
+ * @param count Number of samples per channel.
+ * @param channels Number of channels. (1 or 2)
+ * @param rate Sampling rate, in Hz.
+ */
+void SoundCapture::writePcm(const int16_t *samples, int count, int channels, int rate)
+{
+	if (!d->wav.f || count <= 0)
+		return;
+
+	if (d->wavChannels == 0) {
+		// First write. Set the WAV format.
+		d->wavChannels = channels;
+		d->wavRate = rate;
+	} else if (channels != d->wavChannels || rate != d->wavRate) {
+		// Format changed. This can't be stored in the WAV file.
+		d->dropped++;
+		return;
+	}
+
+	// A segment is at most 960 stereo samples,
+	// so it always fits in a single block.
+	const unsigned int len = count * channels * sizeof(int16_t);
+	SoundCapturePrivate::Stream &s = d->wav;
+	if (!d->append(s, samples, len))
+		return;
+
+	// WAV files are little-endian.
+	cpu_to_le16_array((uint16_t*)&s.cur->data[s.cur->len - len], len);
+}
+
+}
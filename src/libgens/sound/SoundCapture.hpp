@@ -0,0 +1,156 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * SoundCapture.hpp: VGM/GYM/WAV sound capture.                            *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_SOUND_SOUNDCAPTURE_HPP__
+#define __LIBGENS_SOUND_SOUNDCAPTURE_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class SoundCapturePrivate;
+/**
+ * Sound capture.
+ *
+ * Logs YM2612 and PSG register writes to a VGM or GYM file,
+ * and/or the mixed audio output to a WAV file.
+ *
+ * Data is encoded on the emulation thread into a pool of
+ * buffers that is allocated by start(). Full buffers are
+ * written to disk by a background thread. If the writer falls
+ * behind and no buffer is available, the pool is grown for
+ * the register log, since a missing register write would
+ * corrupt the rest of the log. Audio output is dropped and
+ * counted instead, so the pool can't grow without bound.
+ *
+ * If a write fails, the writer thread stops writing, and
+ * the error is returned by stop().
+ *
+ * VGM timestamps are derived from the VDP line the write
+ * occurred on, since that's the granularity of the emulated
+ * audio. GYM files have one timestamp per frame.
+ *
+ * Attach a running capture to a SoundMgr using
+ * SoundMgr::setCapture(). start() and stop() must not be
+ * called while the SoundMgr is emulating a frame.
+ */
+class SoundCapture
+{
+	public:
+		SoundCapture();
+		~SoundCapture();
+
+	private:
+		friend class SoundCapturePrivate;
+		SoundCapturePrivate *const d;
+
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SoundCapture(const SoundCapture &);
+		SoundCapture &operator=(const SoundCapture &);
+
+	public:
+		/**
+		 * Register log format.
+		 */
+		enum RegFormat {
+			REGFMT_VGM,	// VGM v1.50, 44,100 Hz timestamps.
+			REGFMT_GYM,	// GYM, one frame per timestamp.
+
+			REGFMT_MAX
+		};
+
+		/**
+		 * Start capturing.
+		 * @param regFilename Register log filename, or nullptr to not log registers.
+		 * @param regFormat Register log format.
+		 * @param wavFilename WAV filename, or nullptr to not capture audio output.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int start(const char *regFilename, RegFormat regFormat, const char *wavFilename);
+
+		/**
+		 * Stop capturing.
+		 * Queued data is written, and the file headers are finalized.
+		 * @return 0 on success; negative errno if a write failed.
+		 */
+		int stop(void);
+
+		/**
+		 * Is a capture running?
+		 * @return True if a capture is running; false if not.
+		 */
+		bool isRunning(void) const;
+
+		/**
+		 * Get the number of audio output segments that were dropped.
+		 * Register writes are never dropped.
+		 * @return Number of dropped audio output segments.
+		 */
+		unsigned int dropped(void) const;
+
+		/** Emulation thread functions. **/
+		// These are called by SoundMgr.
+
+		/**
+		 * Set the system region.
+		 * This determines the chip clocks and the line rate.
+		 * @param isPal If true, system is PAL.
+		 */
+		void setRegion(bool isPal);
+
+		/**
+		 * Log a YM2612 data write.
+		 * @param port Register bank. (0 or 1)
+		 * @param reg Register number.
+		 * @param data Data value.
+		 * @param line Current VDP line.
+		 */
+		void logYm2612(int port, uint8_t reg, uint8_t data, int line);
+
+		/**
+		 * Log a PSG data write.
+		 * @param data Data value.
+		 * @param line Current VDP line.
+		 */
+		void logPsg(uint8_t data, int line);
+
+		/**
+		 * End the current frame.
+		 * @param lines Number of lines in the frame.
+		 */
+		void endFrame(int lines);
+
+		/**
+		 * Write audio output.
+		 * The WAV format is set by the first call.
+		 * @param samples Audio samples. (16-bit, host-endian, interleaved)
+		 * @param count Number of samples per channel.
+		 * @param channels Number of channels. (1 or 2)
+		 * @param rate Sampling rate, in Hz.
+		 */
+		void writePcm(const int16_t *samples, int count, int channels, int rate);
+};
+
+}
+
+#endif /* __LIBGENS_SOUND_SOUNDCAPTURE_HPP__ */
@@ -39,18 +39,16 @@
 #include "libzomg/zomg_psg.h"
 #include "libzomg/zomg_ym2612.h"
 
-// ALIGN()
-#include "libcompat/aligned_malloc.h"
+// EmuContext.
+// Needed to get the current VDP line.
+#include "EmuContext/EmuContext.hpp"
+#include "Vdp/Vdp.hpp"
 
 #include "SoundMgr_p.hpp"
 namespace LibGens {
 
 /** SoundManagerPrivate **/
 
-// Audio settings.
-int SoundMgrPrivate::rate = 44100;
-bool SoundMgrPrivate::isPal = false;
-
 /**
  * Calculate the segment length.
  * @param rate Sound rate, in Hz.
@@ -79,25 +77,6 @@ int SoundMgrPrivate::CalcSegLength(int rate, bool isPal)
 
 /** SoundMgr **/
 
-// Segment buffer.
-// Stores up to 882 32-bit stereo samples.
-// (32-bit instead of 16-bit to handle oversaturation properly.)
-// TODO: Convert to interleaved stereo.
-// TODO: Make SoundMgr non-static and allocate this using aligned_malloc().
-int32_t ALIGN(16) SoundMgr::ms_SegBufL[MAX_SEGMENT_SIZE];
-int32_t ALIGN(16) SoundMgr::ms_SegBufR[MAX_SEGMENT_SIZE];
-
-// Audio ICs.
-Psg SoundMgr::ms_Psg;
-Ym2612 SoundMgr::ms_Ym2612;
-
-// Static variable initialization.
-int SoundMgr::ms_SegLength = 0;
-
-// Line extrapolation values. [312 + extra room to prevent overflows]
-// Index 0 == start; Index 1 == length
-unsigned int SoundMgr::ms_Extrapol[312+8][2];
-
 void SoundMgr::Init(void)
 {
 	// TODO
@@ -108,71 +87,125 @@ void SoundMgr::End(void)
 	// TODO
 }
 
+/**
+ * Initialize a Sound Manager.
+ * @param context Emulation context this Sound Manager belongs to. (may be nullptr)
+ */
+SoundMgr::SoundMgr(EmuContext *context)
+	: m_context(context)
+	, m_rate(44100)
+	, m_isPal(false)
+	, m_segLength(0)
+	, m_capture(nullptr)
+{
+	memset(m_segBufL, 0x00, sizeof(m_segBufL));
+	memset(m_segBufR, 0x00, sizeof(m_segBufR));
+	memset(m_extrapol, 0x00, sizeof(m_extrapol));
+
+	// Attach the audio ICs to this Sound Manager.
+	m_psg.setSoundMgr(this);
+	m_ym2612.setSoundMgr(this);
+}
+
+SoundMgr::~SoundMgr()
+{ }
+
+/**
+ * Get the current VDP line.
+ * Used by the audio ICs to determine the write position.
+ * @return Current VDP line, or 0 if no VDP is available.
+ */
+int SoundMgr::currentLine(void) const
+{
+	if (!m_context || !m_context->m_vdp)
+		return 0;
+	return m_context->m_vdp->VDP_Lines.currentLine;
+}
+
 /**
  * Reinitialize the Sound Manager.
  * @param rate Sound rate, in Hz.
  * @param isPal If true, system is PAL.
  * @param preserveState If true, save the PSG/YM state before reinitializing them.
  */
-void SoundMgr::ReInit(int rate, bool isPal, bool preserveState)
+void SoundMgr::reInit(int rate, bool isPal, bool preserveState)
 {
-	SoundMgrPrivate::rate = rate;
-	SoundMgrPrivate::isPal = isPal;
+	m_rate = rate;
+	m_isPal = isPal;
 
 	// Calculate the segment length.
-	ms_SegLength = SoundMgrPrivate::CalcSegLength(rate, isPal);
+	m_segLength = SoundMgrPrivate::CalcSegLength(rate, isPal);
 
 	// Build the sound extrapolation table.
 	const int lines = (isPal ? 312 : 262);
 	for (int i = 0; i < lines; i++) {
-		ms_Extrapol[i][0] = ((ms_SegLength * i) / lines);
-		ms_Extrapol[i][1] = (((ms_SegLength * (i+1)) / lines) - ms_Extrapol[i][0]);
+		m_extrapol[i][0] = ((m_segLength * i) / lines);
+		m_extrapol[i][1] = (((m_segLength * (i+1)) / lines) - m_extrapol[i][0]);
 	}
 	// Copy the last extrapolation value to 8 more lines.
 	// This may help at the end of the frame.
 	for (int i = lines; i < lines+8; i++) {
-		ms_Extrapol[i][0] = ms_Extrapol[lines-1][0];
-		ms_Extrapol[i][1] = ms_Extrapol[lines-1][1];
+		m_extrapol[i][0] = m_extrapol[lines-1][0];
+		m_extrapol[i][1] = m_extrapol[lines-1][1];
 	}
 
 	// Clear the segment buffers.
-	memset(ms_SegBufL, 0x00, sizeof(ms_SegBufL));
-	memset(ms_SegBufR, 0x00, sizeof(ms_SegBufR));
+	memset(m_segBufL, 0x00, sizeof(m_segBufL));
+	memset(m_segBufR, 0x00, sizeof(m_segBufR));
 
 	// If requested, save the PSG/YM state.
 	Zomg_PsgSave_t psgState;
 	Zomg_Ym2612Save_t ym2612State;
 	if (preserveState) {
-		ms_Psg.zomgSave(&psgState);
-		ms_Ym2612.zomgSave(&ym2612State);
+		m_psg.zomgSave(&psgState);
+		m_ym2612.zomgSave(&ym2612State);
 	}
 
 	// Initialize the PSG and YM2612.
 	if (isPal) {
-		ms_Psg.reInit((int)((double)CLOCK_PAL / 15.0), rate);
-		ms_Ym2612.reInit((int)((double)CLOCK_PAL / 7.0), rate);
+		m_psg.reInit((int)((double)CLOCK_PAL / 15.0), rate);
+		m_ym2612.reInit((int)((double)CLOCK_PAL / 7.0), rate);
 	} else {
-		ms_Psg.reInit((int)((double)CLOCK_NTSC / 15.0), rate);
-		ms_Ym2612.reInit((int)((double)CLOCK_NTSC / 7.0), rate);
+		m_psg.reInit((int)((double)CLOCK_NTSC / 15.0), rate);
+		m_ym2612.reInit((int)((double)CLOCK_NTSC / 7.0), rate);
 	}
 
 	// If requested, restore the PSG/YM state.
 	if (preserveState) {
-		ms_Psg.zomgRestore(&psgState);
-		ms_Ym2612.zomgRestore(&ym2612State);
+		m_psg.zomgRestore(&psgState);
+		m_ym2612.zomgRestore(&ym2612State);
+	}
+
+	// Update the sound capture's region.
+	if (m_capture) {
+		m_capture->setRegion(isPal);
+	}
+}
+
+/**
+ * Attach a sound capture.
+ * The capture should be started before it's attached,
+ * and detached before it's stopped.
+ * @param capture Sound capture, or nullptr to detach.
+ */
+void SoundMgr::setCapture(SoundCapture *capture)
+{
+	m_capture = capture;
+	if (capture) {
+		capture->setRegion(m_isPal);
 	}
 }
 
-/** ReInit() wrappers. **/
+/** reInit() wrappers. **/
 
-void SoundMgr::SetRate(int rate, bool preserveState)
+void SoundMgr::setRate(int rate, bool preserveState)
 {
-	ReInit(rate, SoundMgrPrivate::isPal, preserveState);
+	reInit(rate, m_isPal, preserveState);
 }
 
-void SoundMgr::SetRegion(bool isPal, bool preserveState)
+void SoundMgr::setRegion(bool isPal, bool preserveState)
 {
-	ReInit(SoundMgrPrivate::rate, isPal, preserveState);
+	reInit(m_rate, isPal, preserveState);
 }
 
 }
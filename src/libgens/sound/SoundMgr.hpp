@@ -30,28 +30,54 @@
 
 // C includes. (C++ namespace)
 #include <cassert>
+#include <cstring>
+
+// ALIGN()
+#include "libcompat/aligned_malloc.h"
 
 // Audio ICs.
 #include "../sound/Psg.hpp"
 #include "../sound/Ym2612.hpp"
 
+// Sound capture.
+#include "../sound/SoundCapture.hpp"
+
 namespace LibGens {
 
+class EmuContext;
+
 class SoundMgr
 {
+	public:
+		SoundMgr(EmuContext *context = nullptr);
+		~SoundMgr();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SoundMgr(const SoundMgr &);
+		SoundMgr &operator=(const SoundMgr &);
+
 	public:
 		static void Init(void);
 		static void End(void);
 
-		static void ReInit(int rate, bool isPal, bool preserveState = false);
-		static void SetRate(int rate, bool preserveState = true);
-		static void SetRegion(bool isPal, bool preserveState = true);
+		void reInit(int rate, bool isPal, bool preserveState = false);
+		void setRate(int rate, bool preserveState = true);
+		void setRegion(bool isPal, bool preserveState = true);
 
-		static inline int GetSegLength(void);
+		inline int getSegLength(void) const;
 
 		// TODO: Bounds checking.
-		static inline int GetWritePos(int line);
-		static inline int GetWriteLen(int line);
+		inline int getWritePos(int line) const;
+		inline int getWriteLen(int line) const;
+
+		/**
+		 * Get the current VDP line.
+		 * Used by the audio ICs to determine the write position.
+		 * @return Current VDP line, or 0 if no VDP is available.
+		 */
+		int currentLine(void) const;
 
 		// Maximum sampling rate and segment size.
 		static const int MAX_SAMPLING_RATE = 48000;
@@ -62,32 +88,32 @@ class SoundMgr
 		// (Samples are actually 32-bit in order to handle oversaturation properly.)
 		// TODO: Call the write functions from SoundMgr so this doesn't need to be public.
 		// TODO: Convert to interleaved stereo.
-		static int32_t ms_SegBufL[MAX_SEGMENT_SIZE];
-		static int32_t ms_SegBufR[MAX_SEGMENT_SIZE];
+		int32_t ALIGN(16) m_segBufL[MAX_SEGMENT_SIZE];
+		int32_t ALIGN(16) m_segBufR[MAX_SEGMENT_SIZE];
 
 		// Audio ICs.
 		// TODO: Add wrapper functions?
-		static Psg ms_Psg;
-		static Ym2612 ms_Ym2612;
+		Psg m_psg;
+		Ym2612 m_ym2612;
 
 		/**
 		 * Reset buffer pointers and lengths.
 		 */
-		static inline void ResetPtrsAndLens(void)
+		inline void resetPtrsAndLens(void)
 		{
-			ms_Ym2612.resetBufferPtrs();
-			ms_Ym2612.clearWriteLen();
-			ms_Psg.resetBufferPtrs();
-			ms_Psg.clearWriteLen();
+			m_ym2612.resetBufferPtrs();
+			m_ym2612.clearWriteLen();
+			m_psg.resetBufferPtrs();
+			m_psg.clearWriteLen();
 		}
 
 		/**
 		 * Run the specialUpdate() functions.
 		 */
-		static inline void SpecialUpdate(void)
+		inline void specialUpdate(void)
 		{
-			ms_Psg.specialUpdate();
-			ms_Ym2612.specialUpdate();
+			m_psg.specialUpdate();
+			m_ym2612.specialUpdate();
 		}
 
 		/**
@@ -97,7 +123,7 @@ class SoundMgr
 		 * @param samples Number of samples in the buffer. (1 sample == 4 bytes)
 		 * @return Number of samples written.
 		 */
-		static int writeStereo(int16_t *dest, int samples);
+		int writeStereo(int16_t *dest, int samples);
 
 		/**
 		 * Write monaural audio to a buffer.
@@ -106,45 +132,123 @@ class SoundMgr
 		 * @param samples Number of samples in the buffer. (1 sample == 2 bytes)
 		 * @return Number of samples written.
 		 */
-		static int writeMono(int16_t *dest, int samples);
+		int writeMono(int16_t *dest, int samples);
+
+		/**
+		 * Clear the internal audio buffer without writing it.
+		 * Used to discard audio after loading a snapshot.
+		 */
+		inline void clearSegment(void)
+		{
+			memset(m_segBufL, 0, m_segLength * sizeof(m_segBufL[0]));
+			memset(m_segBufR, 0, m_segLength * sizeof(m_segBufR[0]));
+		}
+
+		/** Sound capture. **/
+
+		/**
+		 * Get the attached sound capture.
+		 * @return Sound capture, or nullptr if none is attached.
+		 */
+		inline SoundCapture *capture(void) const;
+
+		/**
+		 * Attach a sound capture.
+		 * The capture should be started before it's attached,
+		 * and detached before it's stopped.
+		 * @param capture Sound capture, or nullptr to detach.
+		 */
+		void setCapture(SoundCapture *capture);
+
+		/**
+		 * Log a YM2612 data write to the sound capture, if any.
+		 * @param port Register bank. (0 or 1)
+		 * @param reg Register number.
+		 * @param data Data value.
+		 */
+		inline void captureYm2612(int port, uint8_t reg, uint8_t data);
+
+		/**
+		 * Log a PSG data write to the sound capture, if any.
+		 * @param data Data value.
+		 */
+		inline void capturePsg(uint8_t data);
+
+		/**
+		 * End the current frame in the sound capture, if any.
+		 * @param lines Number of lines in the frame.
+		 */
+		inline void captureEndFrame(int lines);
 
 	protected:
 		// TODO: Move these into the private class.
 
+		// Emulation context this Sound Manager belongs to.
+		// May be nullptr if the Sound Manager is used standalone.
+		EmuContext *const m_context;
+
+		// Audio settings.
+		int m_rate;
+		bool m_isPal;
+
 		// Segment length.
-		static int ms_SegLength;
+		int m_segLength;
 
 		// Line extrapolation values. [312 + extra room to prevent overflows]
 		// Index 0 == start; Index 1 == length
-		static unsigned int ms_Extrapol[312+8][2];
+		unsigned int m_extrapol[312+8][2];
 
-	private:
-		SoundMgr() { }
-		~SoundMgr() { }
+		// Sound capture. (nullptr if not capturing)
+		SoundCapture *m_capture;
 };
 
 /** Inline functions **/
 
-inline int SoundMgr::GetSegLength(void)
+inline int SoundMgr::getSegLength(void) const
 {
-	return ms_SegLength;
+	return m_segLength;
 }
 
 // TODO: Bounds checking.
-inline int SoundMgr::GetWritePos(int line)
+inline int SoundMgr::getWritePos(int line) const
 {
 	// NOTE: Line might be 263 or 313 at the end of the frame.
 	// TODO: Figure out why.
 	assert(line >= 0 && line <= 313);
-	return ms_Extrapol[line][0];
+	return m_extrapol[line][0];
 }
 
-inline int SoundMgr::GetWriteLen(int line)
+inline int SoundMgr::getWriteLen(int line) const
 {
 	// NOTE: Line might be 263 or 313 at the end of the frame.
 	// TODO: Figure out why.
 	assert(line >= 0 && line <= 313);
-	return ms_Extrapol[line][1];
+	return m_extrapol[line][1];
+}
+
+/** Sound capture. **/
+
+inline SoundCapture *SoundMgr::capture(void) const
+{
+	return m_capture;
+}
+
+inline void SoundMgr::captureYm2612(int port, uint8_t reg, uint8_t data)
+{
+	if (m_capture)
+		m_capture->logYm2612(port, reg, data, currentLine());
+}
+
+inline void SoundMgr::capturePsg(uint8_t data)
+{
+	if (m_capture)
+		m_capture->logPsg(data, currentLine());
+}
+
+inline void SoundMgr::captureEndFrame(int lines)
+{
+	if (m_capture)
+		m_capture->endFrame(lines);
 }
 
 }
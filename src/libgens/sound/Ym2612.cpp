@@ -40,6 +40,7 @@
 #include <stdint.h>
 
 // C includes. (C++ namespace)
+#include <cerrno>
 #include <cstdio>
 #include <cmath>
 #include <cstring>
@@ -50,10 +51,9 @@
 
 // Sound Manager.
 #include "SoundMgr.hpp"
-#include "Vdp/Vdp.hpp"
 
-// TODO: Get rid of EmuContext.
-#include "EmuContext/EmuContext.hpp"
+// CPU flags.
+#include "libcompat/cpuflags.h"
 
 #if 0
 // GSX v7 savestate functionality.
@@ -63,18 +63,22 @@
 
 // ZOMG YM2612 struct.
 #include "libzomg/zomg_ym2612.h"
+#include "libzomg/ZomgMem.hpp"
 
 namespace LibGens {
 
 /** Ym2612Private **/
 
 // Static variables.
-bool Ym2612Private::isInit = false;
 int *Ym2612Private::SIN_TAB[SIN_LENGTH];			// SINUS TABLE (pointer on TL TABLE)
 int Ym2612Private::TL_TAB[TL_LENGTH * 2];			// TOTAL LEVEL TABLE (plus and minus)
 unsigned int Ym2612Private::ENV_TAB[2 * ENV_LENGTH * 8];	// ENV CURVE TABLE (attack & decay)
 //unsigned int Ym2612Private::ATTACK_TO_DECAY[ENV_LENGTH];	// Conversion from attack to decay phase
 unsigned int Ym2612Private::DECAY_TO_ATTACK[ENV_LENGTH];	// Conversion from decay to attack phase
+#ifdef YM2612_HAS_AVX2
+int16_t Ym2612Private::SIN_SIMD_TAB[SIN_LENGTH + 1];	// SIN_TAB as TL_SIMD_TAB offsets
+int Ym2612Private::TL_SIMD_TAB[PG_CUT_OFF + 1];		// TL_TAB, positive half only
+#endif /* YM2612_HAS_AVX2 */
 
 // Next Enveloppe phase functions pointer table
 const Ym2612Private::Env_Event Ym2612Private::ENV_NEXT_EVENT[8] = {
@@ -147,11 +151,11 @@ int Ym2612Private::LFO_FREQ_TAB[LFO_LENGTH];	// LFO FMS TABLE
 Ym2612Private::Ym2612Private(Ym2612 *q)
 	: q(q)
 {
-	if (!isInit) {
-		// Initialize the static tables.
-		isInit = true;
-		doStaticInit();
-	}
+	// Initialize the static tables.
+	// NOTE: Function-local static initialization is thread-safe,
+	// so multiple emulation contexts can be created concurrently.
+	static const bool isInit = (doStaticInit(), true);
+	((void)isInit);
 }
 
 void Ym2612Private::doStaticInit(void)
@@ -268,6 +272,24 @@ void Ym2612Private::doStaticInit(void)
 			i, TL_TAB[i], TL_LENGTH + i, TL_TAB[TL_LENGTH + i]);
 	}
 
+#ifdef YM2612_HAS_AVX2
+	// Compact SIN/TL tables for the vectorized update.
+	for (int i = 0; i < PG_CUT_OFF; i++) {
+		TL_SIMD_TAB[i] = TL_TAB[i];
+	}
+	TL_SIMD_TAB[PG_CUT_OFF] = 0;
+
+	for (int i = 0; i < SIN_LENGTH; i++) {
+		int offset = (int)(SIN_TAB[i] - &TL_TAB[0]);
+		if (offset >= TL_LENGTH) {
+			// Negative half.
+			offset = (offset - TL_LENGTH) | 0x8000;
+		}
+		SIN_SIMD_TAB[i] = (int16_t)offset;
+	}
+	SIN_SIMD_TAB[SIN_LENGTH] = 0;
+#endif /* YM2612_HAS_AVX2 */
+
 	// NULL frequency rate table.
 	// It's always 0.
 	memset(NULL_RATE, 0, sizeof(NULL_RATE));
@@ -539,6 +561,35 @@ int Ym2612Private::SLOT_SET(int address, uint8_t data)
 	return 0;
 }
 
+/**
+ * Recalculate the slot table pointers from the registers.
+ * The pointers point into per-instance tables, so they
+ * can't be restored directly from a snapshot.
+ */
+void Ym2612Private::fixupSlotPointers(void)
+{
+	for (int part = 0; part < 2; part++) {
+		const uint8_t *REG = state.REG[part];
+		for (int address = 0x30; address < 0x40; address++) {
+			const int nch = address & 3;
+			if (nch == 3)
+				continue;
+			channel_t *CH = &state.CHANNEL[nch + (part * 3)];
+			slot_t *SL = &CH->_SLOT[(address >> 2) & 3];
+
+			// See SLOT_SET() for the table calculations.
+			SL->DT = DT_TAB[(REG[address] >> 4) & 7];
+			uint8_t data = (REG[address + 0x20] & 0x1F);
+			SL->AR = (data ? &AR_TAB[data << 1] : &NULL_RATE[0]);
+			data = (REG[address + 0x30] & 0x1F);
+			SL->DR = (data ? &DR_TAB[data << 1] : &NULL_RATE[0]);
+			data = (REG[address + 0x40] & 0x1F);
+			SL->SR = (data ? &DR_TAB[data << 1] : &NULL_RATE[0]);
+			SL->RR = &DR_TAB[((REG[address + 0x50] & 0xF) << 2) + 2];
+		}
+	}
+}
+
 /**
  * Set a value for a channel.
  * @param address Register address.
@@ -1485,6 +1536,9 @@ Ym2612::Ym2612()
 	m_enabled = true;	// TODO: Make this customizable.
 	m_dacEnabled = true;	// TODO: Make this customizable.
 	m_improved = true;	// TODO: Make this customizable.
+	m_bufPtrL = nullptr;
+	m_bufPtrR = nullptr;
+	m_soundMgr = nullptr;
 }
 
 Ym2612::Ym2612(int clock, int rate)
@@ -1495,6 +1549,9 @@ Ym2612::Ym2612(int clock, int rate)
 	m_enabled = true;	// TODO: Make this customizable.
 	m_dacEnabled = true;	// TODO: Make this customizable.
 	m_improved = true;	// TODO: Make this customizable.
+	m_bufPtrL = nullptr;
+	m_bufPtrR = nullptr;
+	m_soundMgr = nullptr;
 	
 	reInit(clock, rate);
 }
@@ -1739,6 +1796,16 @@ int Ym2612::write(unsigned int address, uint8_t data)
 	 * - 3: Bank 1 data.
 	 */
 
+	if ((address & 1) && m_soundMgr) {
+		// Log the data write for sound capture.
+		// This is done before the register checks below,
+		// since DAC writes and redundant writes are still
+		// part of the register stream.
+		const int port = ((address >> 1) & 1);
+		m_soundMgr->captureYm2612(port,
+			(uint8_t)(port ? d->state.OPNBadr : d->state.OPNAadr), data);
+	}
+
 	int reg_num;
 	switch (address & 0x03) {
 		case 0:
@@ -1762,11 +1829,6 @@ int Ym2612::write(unsigned int address, uint8_t data)
 				}
 				d->state.REG[0][d->state.OPNAadr] = data;
 
-				/* TODO: Reimplement GYM dumping support in LibGens.
-				if (GYM_Dumping)
-					gym_dump_update(1, (uint8_t)d->state.OPNAadr, data);
-				*/
-
 				if (reg_num < 0xA0) {
 					d->SLOT_SET(d->state.OPNAadr, data);
 				} else {
@@ -1776,16 +1838,6 @@ int Ym2612::write(unsigned int address, uint8_t data)
 				// YM2612 control registers.
 				d->state.REG[0][d->state.OPNAadr] = data;
 
-				/* TODO: Reimplement GYM dumping support in LibGens.
-				if ((GYM_Dumping) &&
-				    ((d->state.OPNAadr == 0x22) ||
-				     (d->state.OPNAadr == 0x27) ||
-				     (d->state.OPNAadr == 0x28)))
-				{
-					gym_dump_update(1, (uint8_t)d->state.OPNAadr, data);
-				}
-				*/
-
 				d->YM_SET(d->state.OPNAadr, data);
 			}
 			break;
@@ -1806,11 +1858,6 @@ int Ym2612::write(unsigned int address, uint8_t data)
 				}
 				d->state.REG[1][d->state.OPNBadr] = data;
 
-				/* TODO: Reimplement GYM dumping support in LibGens.
-				if (GYM_Dumping)
-					gym_dump_update(2, (uint8_t)d->state.OPNBadr, data);
-				*/
-				
 				if (reg_num < 0xA0) {
 					d->SLOT_SET(d->state.OPNBadr + 0x100, data);
 				} else {
@@ -1914,14 +1961,22 @@ void Ym2612::update(int32_t *bufL, int32_t *bufR, int length)
 		algo_type |= 8;
 	}
 
-	d->Update_Chan((d->state.CHANNEL[0].ALGO + algo_type), &(d->state.CHANNEL[0]), bufL, bufR, length);
-	d->Update_Chan((d->state.CHANNEL[1].ALGO + algo_type), &(d->state.CHANNEL[1]), bufL, bufR, length);
-	d->Update_Chan((d->state.CHANNEL[2].ALGO + algo_type), &(d->state.CHANNEL[2]), bufL, bufR, length);
-	d->Update_Chan((d->state.CHANNEL[3].ALGO + algo_type), &(d->state.CHANNEL[3]), bufL, bufR, length);
-	d->Update_Chan((d->state.CHANNEL[4].ALGO + algo_type), &(d->state.CHANNEL[4]), bufL, bufR, length);
-	if (!(d->state.DAC)) {
-		// Update channel 6 only if DAC is disabled.
-		d->Update_Chan((d->state.CHANNEL[5].ALGO + algo_type), &(d->state.CHANNEL[5]), bufL, bufR, length);
+#ifdef YM2612_HAS_AVX2
+	if (CPU_Flags & MDP_CPUFLAG_X86_AVX2) {
+		// AVX2: Update all channels in parallel.
+		d->Update_All_Chan_AVX2(algo_type, bufL, bufR, length);
+	} else
+#endif /* YM2612_HAS_AVX2 */
+	{
+		d->Update_Chan((d->state.CHANNEL[0].ALGO + algo_type), &(d->state.CHANNEL[0]), bufL, bufR, length);
+		d->Update_Chan((d->state.CHANNEL[1].ALGO + algo_type), &(d->state.CHANNEL[1]), bufL, bufR, length);
+		d->Update_Chan((d->state.CHANNEL[2].ALGO + algo_type), &(d->state.CHANNEL[2]), bufL, bufR, length);
+		d->Update_Chan((d->state.CHANNEL[3].ALGO + algo_type), &(d->state.CHANNEL[3]), bufL, bufR, length);
+		d->Update_Chan((d->state.CHANNEL[4].ALGO + algo_type), &(d->state.CHANNEL[4]), bufL, bufR, length);
+		if (!(d->state.DAC)) {
+			// Update channel 6 only if DAC is disabled.
+			d->Update_Chan((d->state.CHANNEL[5].ALGO + algo_type), &(d->state.CHANNEL[5]), bufL, bufR, length);
+		}
 	}
 
 	d->state.Inter_Cnt = d->int_cnt;
@@ -1964,6 +2019,43 @@ void Ym2612::zomgRestore(const Zomg_Ym2612Save_t *state)
 	// TODO: Restore other counters and stuff!
 }
 
+/**
+ * Save the internal YM2612 state to a snapshot.
+ * This should be called after zomgSave().
+ * @param zomg Snapshot.
+ */
+void Ym2612::snapshotSave(LibZomg::ZomgMem *zomg) const
+{
+	// NOTE: The slot table pointers are saved as-is.
+	// They're recalculated by snapshotRestore().
+	zomg->saveBlock(LibZomg::ZomgMem::BLOCK_INT_YM2612, &d->state, sizeof(d->state));
+}
+
+/**
+ * Restore the complete YM2612 state from a snapshot.
+ * This replaces zomgRestore(); no register writes are replayed.
+ * @param zomg Snapshot.
+ * @return 0 on success; negative errno on error.
+ * If an error occurs, the YM2612 state is not modified.
+ */
+int Ym2612::snapshotRestore(LibZomg::ZomgMem *zomg)
+{
+	Ym2612Private::state_t state;
+	int ret = zomg->loadBlock(LibZomg::ZomgMem::BLOCK_INT_YM2612, &state, sizeof(state));
+	if (ret != (int)sizeof(state))
+		return (ret < 0 ? ret : -EINVAL);
+
+	// If the clock or sample rate changed since the snapshot
+	// was taken, the step values are no longer valid.
+	// The caller has to use zomgRestore() in that case.
+	if (state.Clock != d->state.Clock || state.Rate != d->state.Rate)
+		return -EINVAL;
+
+	d->state = state;
+	d->fixupSlotPointers();
+	return 0;
+}
+
 // TODO: Eliminate the GSXv7 stuff.
 // TODO: Add the YM timer state (and other important stuff) to the ZOMG save format.
 #if 0
@@ -2292,25 +2384,19 @@ void Ym2612::updateDacAndTimers(int32_t *bufL, int32_t *bufR, int length)
  */
 void Ym2612::specialUpdate(void)
 {
-	if (!(m_writeLen > 0 && m_enabled))
+	if (!(m_writeLen > 0 && m_enabled && m_soundMgr))
 		return;
 
 	// Update the sound buffer.
 	update(m_bufPtrL, m_bufPtrR, m_writeLen);
 	m_writeLen = 0;
 
-	// TODO: Don't use EmuContext here...
-	int line_num = 1;
-	EmuContext *context = EmuContext::Instance();
-	if (context != nullptr)
-		line_num = (context->m_vdp->VDP_Lines.currentLine + 1);
-
 	// Determine the new starting position.
-	int writePos = SoundMgr::GetWritePos(line_num);
+	int writePos = m_soundMgr->getWritePos(m_soundMgr->currentLine() + 1);
 
 	// Update the PSG buffer pointers.
-	m_bufPtrL = &SoundMgr::ms_SegBufL[writePos];
-	m_bufPtrR = &SoundMgr::ms_SegBufR[writePos];
+	m_bufPtrL = &m_soundMgr->m_segBufL[writePos];
+	m_bufPtrR = &m_soundMgr->m_segBufR[writePos];
 }
 
 /**
@@ -2331,8 +2417,26 @@ int Ym2612::getReg(int regID) const
  */
 void Ym2612::resetBufferPtrs(void)
 {
-	m_bufPtrL = &SoundMgr::ms_SegBufL[0];
-	m_bufPtrR = &SoundMgr::ms_SegBufR[0];
+	if (!m_soundMgr) {
+		// No Sound Manager.
+		m_bufPtrL = nullptr;
+		m_bufPtrR = nullptr;
+		return;
+	}
+
+	m_bufPtrL = &m_soundMgr->m_segBufL[0];
+	m_bufPtrR = &m_soundMgr->m_segBufR[0];
+}
+
+/**
+ * Set the Sound Manager that owns this YM2612.
+ * The YM2612 writes its output to the Sound Manager's segment buffers.
+ * @param soundMgr Sound Manager. (If nullptr, YM2612 output is not buffered.)
+ */
+void Ym2612::setSoundMgr(SoundMgr *soundMgr)
+{
+	m_soundMgr = soundMgr;
+	resetBufferPtrs();
 }
 
 /* end */
@@ -27,9 +27,14 @@
 #include <stdint.h>
 
 struct _Zomg_Ym2612Save_t;
+namespace LibZomg {
+	class ZomgMem;
+}
 
 namespace LibGens {
 
+class SoundMgr;
+
 class Ym2612Private;
 class Ym2612
 {
@@ -65,6 +70,17 @@ class Ym2612
 		void zomgSave(_Zomg_Ym2612Save_t *state) const;
 		void zomgRestore(const _Zomg_Ym2612Save_t *state);
 
+		/**
+		 * Snapshot functions.
+		 * These save the internal state that isn't
+		 * stored by zomgSave(), e.g. envelopes and timers.
+		 * snapshotRestore() restores the complete state
+		 * without zomgRestore(), and returns 0 on success
+		 * or a negative errno on error.
+		 */
+		void snapshotSave(LibZomg::ZomgMem *zomg) const;
+		int snapshotRestore(LibZomg::ZomgMem *zomg);
+
 		/** Gens-specific code. **/
 		void updateDacAndTimers(int32_t *bufL, int32_t *bufR, int length);
 		void specialUpdate(void);
@@ -79,6 +95,9 @@ class Ym2612
 		// Reset buffer pointers.
 		void resetBufferPtrs(void);
 
+		// Set the Sound Manager.
+		void setSoundMgr(SoundMgr *soundMgr);
+
 	protected:
 		// PSG write length. (for audio output)
 		int m_writeLen;
@@ -90,6 +109,9 @@ class Ym2612
 		// TODO: Figure out how to get rid of these!
 		int32_t *m_bufPtrL;
 		int32_t *m_bufPtrR;
+
+		// Sound Manager that owns this YM2612.
+		SoundMgr *m_soundMgr;
 };
 
 /* Gens */
@@ -0,0 +1,488 @@
+/***************************************************************************
+ * libgens: Gens Emulation Library.                                        *
+ * Ym2612_avx2.cpp: Yamaha YM2612 FM synthesis chip emulator. (AVX2)       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "Ym2612.hpp"
+#include "Ym2612_p.hpp"
+
+#ifdef YM2612_HAS_AVX2
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// AVX2 intrinsics.
+#include <immintrin.h>
+
+namespace LibGens {
+
+#define R(x) (1 << Ym2612Private::ROUTE_##x)
+const uint16_t Ym2612Private::ALGO_ROUTE[8] = {
+	// Algorithm 0: S0 -> S1 -> S2 -> S3
+	R(S0_IN1) | R(S1_IN2) | R(S2_IN3),
+	// Algorithm 1: (S0 + S1) -> S2 -> S3
+	R(S0_IN2) | R(S1_IN2) | R(S2_IN3),
+	// Algorithm 2: (S0 + (S1 -> S2)) -> S3
+	R(S1_IN2) | R(S0_IN3) | R(S2_IN3),
+	// Algorithm 3: ((S0 -> S1) + S2) -> S3
+	R(S0_IN1) | R(S1_IN3) | R(S2_IN3),
+	// Algorithm 4: (S0 -> S1) + (S2 -> S3)
+	R(S0_IN1) | R(S2_IN3) | R(S1_OUT) | R(LIMIT),
+	// Algorithm 5: S0 -> (S1 + S2 + S3)
+	R(S0_IN1) | R(S0_IN2) | R(S0_IN3) | R(S1_OUT) | R(S2_OUT) | R(LIMIT),
+	// Algorithm 6: (S0 -> S1) + S2 + S3
+	R(S0_IN1) | R(S1_OUT) | R(S2_OUT) | R(LIMIT),
+	// Algorithm 7: S0 + S1 + S2 + S3
+	R(S0_OUT) | R(S1_OUT) | R(S2_OUT) | R(LIMIT),
+};
+#undef R
+
+/**
+ * Check if a channel needs to be updated.
+ * This is the same check as in T_Update_Chan().
+ * @param CH Channel.
+ * @return True if any of the channel's carriers are still running.
+ */
+bool Ym2612Private::Chan_Is_Active(const channel_t *CH)
+{
+	int not_end = (CH->_SLOT[S3].Ecnt - ENV_END);
+
+	// Special cases.
+	// Copied from Game_Music_Emu v0.5.2.
+	if (CH->ALGO == 7)
+		not_end |= (CH->_SLOT[S0].Ecnt - ENV_END);
+	if (CH->ALGO >= 5)
+		not_end |= (CH->_SLOT[S2].Ecnt - ENV_END);
+	if (CH->ALGO >= 4)
+		not_end |= (CH->_SLOT[S1].Ecnt - ENV_END);
+
+	return (not_end != 0);
+}
+
+/**
+ * Load the channel state into the SIMD working set.
+ * Inactive lanes are zeroed, which makes them silent.
+ * @param active Bitfield of channels to update.
+ */
+void Ym2612Private::SIMD_Load(int active)
+{
+	memset(&simd, 0, sizeof(simd));
+
+	for (int nch = 0; nch < 6; nch++) {
+		if (!(active & (1 << nch)))
+			continue;
+
+		const channel_t *CH = &state.CHANNEL[nch];
+		for (int nsl = 0; nsl < 4; nsl++) {
+			const slot_t *SL = &CH->_SLOT[nsl];
+			simd.Fcnt[nsl][nch] = SL->Fcnt;
+			simd.Finc[nsl][nch] = SL->Finc;
+			simd.Ecnt[nsl][nch] = SL->Ecnt;
+			simd.Einc[nsl][nch] = SL->Einc;
+			simd.Ecmp[nsl][nch] = SL->Ecmp;
+			simd.TLL[nsl][nch]  = SL->TLL;
+			simd.AMS[nsl][nch]  = SL->AMS;
+		}
+
+		simd.S0_OUT[0][nch] = CH->S0_OUT[0];
+		simd.S0_OUT[1][nch] = CH->S0_OUT[1];
+		simd.Old_OUTd[nch] = CH->Old_OUTd;
+		simd.OUTd[nch] = CH->OUTd;
+		simd.LEFT[nch] = CH->LEFT;
+		simd.RIGHT[nch] = CH->RIGHT;
+		simd.FB[nch] = CH->FB;
+		simd.FMS[nch] = CH->FMS;
+
+		const int route = ALGO_ROUTE[CH->ALGO & 7];
+		for (int r = 0; r < ROUTE_MAX; r++) {
+			simd.route[r][nch] = ((route & (1 << r)) ? ~0 : 0);
+		}
+	}
+}
+
+/**
+ * Store the SIMD working set back into the channel state.
+ * @param active Bitfield of channels that were updated.
+ */
+void Ym2612Private::SIMD_Store(int active)
+{
+	for (int nch = 0; nch < 6; nch++) {
+		if (!(active & (1 << nch)))
+			continue;
+
+		channel_t *CH = &state.CHANNEL[nch];
+		for (int nsl = 0; nsl < 4; nsl++) {
+			slot_t *SL = &CH->_SLOT[nsl];
+			SL->Fcnt = simd.Fcnt[nsl][nch];
+			SL->Ecnt = simd.Ecnt[nsl][nch];
+			SL->Einc = simd.Einc[nsl][nch];
+			SL->Ecmp = simd.Ecmp[nsl][nch];
+		}
+
+		CH->S0_OUT[0] = simd.S0_OUT[0][nch];
+		CH->S0_OUT[1] = simd.S0_OUT[1][nch];
+		CH->Old_OUTd = simd.Old_OUTd[nch];
+		CH->OUTd = simd.OUTd[nch];
+	}
+}
+
+__attribute__((target("avx2")))
+static inline __m256i Load_AVX2(const int *src)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+}
+
+__attribute__((target("avx2")))
+static inline void Store_AVX2(int *dest, __m256i v)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), v);
+}
+
+/**
+ * Calculate an operator's output for all channels.
+ * Equivalent to SIN_TAB[(in >> SIN_LBITS) & SIN_MASK][en].
+ * @param in Phase.
+ * @param en Envelope.
+ * @return Operator output.
+ */
+__attribute__((target("avx2")))
+static inline __m256i Op_AVX2(__m256i in, __m256i en)
+{
+	const __m256i phase = _mm256_and_si256(_mm256_srai_epi32(in, SIN_LBITS),
+				_mm256_set1_epi32(Ym2612Private::SIN_MASK));
+
+	// SIN_SIMD_TAB[] is 16-bit, so sign-extend the low half of each gathered dword.
+	__m256i offset = _mm256_i32gather_epi32(
+		reinterpret_cast<const int*>(Ym2612Private::SIN_SIMD_TAB), phase, 2);
+	offset = _mm256_srai_epi32(_mm256_slli_epi32(offset, 16), 16);
+	const __m256i sign = _mm256_srai_epi32(offset, 31);
+
+	const __m256i idx = _mm256_min_epi32(_mm256_set1_epi32(Ym2612Private::PG_CUT_OFF),
+		_mm256_add_epi32(en, _mm256_and_si256(offset, _mm256_set1_epi32(0x7FFF))));
+	const __m256i tl = _mm256_i32gather_epi32(Ym2612Private::TL_SIMD_TAB, idx, 4);
+
+	// Negate if the offset was in the negative half.
+	return _mm256_sub_epi32(_mm256_xor_si256(tl, sign), sign);
+}
+
+/**
+ * Calculate an operator's output for all channels using scalar loads.
+ * Gathers have high latency, so this is faster if the
+ * result is needed immediately, e.g. for feedback.
+ * @param in Phase.
+ * @param en Envelope.
+ * @return Operator output.
+ */
+__attribute__((target("avx2")))
+static inline __m256i Op_Scalar_AVX2(__m256i in, __m256i en)
+{
+	const __m256i phase = _mm256_and_si256(_mm256_srai_epi32(in, SIN_LBITS),
+				_mm256_set1_epi32(Ym2612Private::SIN_MASK));
+	int p[8], e[8];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), phase);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(e), en);
+
+	// Lanes 6 and 7 are padding.
+	int * const *const SIN_TAB = Ym2612Private::SIN_TAB;
+	return _mm256_setr_epi32(
+		SIN_TAB[p[0]][e[0]], SIN_TAB[p[1]][e[1]], SIN_TAB[p[2]][e[2]],
+		SIN_TAB[p[3]][e[3]], SIN_TAB[p[4]][e[4]], SIN_TAB[p[5]][e[5]], 0, 0);
+}
+
+/**
+ * Add the output of all channels to the sound buffers.
+ * @param out Channel output.
+ * @param left LEFT enable masks.
+ * @param right RIGHT enable masks.
+ * @param bufL Left sample.
+ * @param bufR Right sample.
+ */
+__attribute__((target("avx2")))
+static inline void Output_AVX2(__m256i out, __m256i left, __m256i right,
+			       int32_t *bufL, int32_t *bufR)
+{
+	__m256i sum = _mm256_hadd_epi32(_mm256_and_si256(out, left),
+					_mm256_and_si256(out, right));
+	sum = _mm256_hadd_epi32(sum, sum);
+	const __m128i lr = _mm_add_epi32(_mm256_castsi256_si128(sum),
+					 _mm256_extracti128_si256(sum, 1));
+	*bufL += _mm_cvtsi128_si32(lr);
+	*bufR += _mm_extract_epi32(lr, 1);
+}
+
+/**
+ * Update all active channels. (AVX2)
+ * Each lane corresponds to a channel. The operator pipeline
+ * is identical for all algorithms; the routing masks select
+ * which operators modulate each other.
+ *
+ * YM2612 samples are processed in blocks, one operator at a time.
+ * Only S0 depends on its own previous output (feedback), so S1,
+ * S2, and S3 can be calculated for the entire block without
+ * waiting for the previous sample's gathers to complete.
+ *
+ * @param lfo If true, LFO is enabled.
+ * @param interp If true, interpolated output is enabled.
+ * @param active Bitfield of channels to update.
+ * @param bufL Left audio buffer.
+ * @param bufR Right audio buffer.
+ * @param length Length of the audio buffers, in samples.
+ */
+template<bool lfo, bool interp>
+__attribute__((target("avx2")))
+void Ym2612Private::T_Update_All_Chan_AVX2(int active, int32_t *bufL, int32_t *bufR, int length)
+{
+	// Channel parameters don't change during an update.
+	const __m256i vLEFT = Load_AVX2(simd.LEFT);
+	const __m256i vRIGHT = Load_AVX2(simd.RIGHT);
+	const __m256i vFB = Load_AVX2(simd.FB);
+	const __m256i vFMS = Load_AVX2(simd.FMS);
+	const __m256i vLimitHi = _mm256_set1_epi32(LIMIT_CH_OUT);
+	const __m256i vLimitLo = _mm256_set1_epi32(-LIMIT_CH_OUT);
+
+	__m256i vS0_OUT0 = Load_AVX2(simd.S0_OUT[0]);
+	__m256i vS0_OUT1 = Load_AVX2(simd.S0_OUT[1]);
+	__m256i vOld_OUTd = Load_AVX2(simd.Old_OUTd);
+	__m256i vOUTd = Load_AVX2(simd.OUTd);
+
+	// Block buffers.
+	__m256i in[4][SIMD_BLOCK_LEN];		// current phase calculation
+	__m256i en[4][SIMD_BLOCK_LEN];		// current envelope calculation
+	__m256i out0[SIMD_BLOCK_LEN];		// S0 output
+	__m256i out1[SIMD_BLOCK_LEN];		// S1 output
+	__m256i out2[SIMD_BLOCK_LEN];		// S2 output
+	__m256i out3d[SIMD_BLOCK_LEN];		// channel output
+	int blk_i[SIMD_BLOCK_LEN];		// output sample index
+	int blk_cnt[SIMD_BLOCK_LEN];		// interpolation counter, or -1 if no output
+
+	int cnt = state.Inter_Cnt;
+	int i = 0;
+	while (i < length) {
+		// Determine which output samples are in this block.
+		// With interpolation, there's usually more than one
+		// YM2612 sample per output sample.
+		int n = 0;
+		for (; n < SIMD_BLOCK_LEN && i < length; n++) {
+			blk_i[n] = i;
+			if (interp) {
+				// DO_OUTPUT_INT()
+				if ((cnt += state.Inter_Step) & 0x04000) {
+					cnt &= 0x3FFF;
+					blk_cnt[n] = cnt;
+					i++;
+				} else {
+					blk_cnt[n] = -1;
+				}
+			} else {
+				// DO_OUTPUT()
+				blk_cnt[n] = 0;
+				i++;
+			}
+		}
+
+		// GET_CURRENT_PHASE(), UPDATE_PHASE(),
+		// GET_CURRENT_ENV(), UPDATE_ENV()
+		for (int nsl = 0; nsl < 4; nsl++) {
+			__m256i fcnt = Load_AVX2(simd.Fcnt[nsl]);
+			const __m256i finc = Load_AVX2(simd.Finc[nsl]);
+			__m256i ecnt = Load_AVX2(simd.Ecnt[nsl]);
+			__m256i einc = Load_AVX2(simd.Einc[nsl]);
+			__m256i ecmp = Load_AVX2(simd.Ecmp[nsl]);
+			const __m256i tll = Load_AVX2(simd.TLL[nsl]);
+			const __m256i ams = Load_AVX2(simd.AMS[nsl]);
+
+			for (int j = 0; j < n; j++) {
+				in[nsl][j] = fcnt;
+				if (lfo) {
+					// NOTE: If freq_LFO is 0, the LFO term is 0,
+					// so UPDATE_PHASE_LFO() doesn't need a branch here.
+					const __m256i freq_LFO = _mm256_srai_epi32(_mm256_mullo_epi32(vFMS,
+						_mm256_set1_epi32(LFO_FREQ_UP[blk_i[j]])), LFO_HBITS - 1);
+					fcnt = _mm256_add_epi32(fcnt, _mm256_add_epi32(finc, _mm256_srai_epi32(
+						_mm256_mullo_epi32(finc, freq_LFO), LFO_FMS_LBITS)));
+				} else {
+					fcnt = _mm256_add_epi32(fcnt, finc);
+				}
+
+				__m256i e = _mm256_add_epi32(tll,
+					_mm256_i32gather_epi32(reinterpret_cast<const int*>(ENV_TAB),
+						_mm256_srai_epi32(ecnt, ENV_LBITS), 4));
+				if (lfo) {
+					e = _mm256_add_epi32(e, _mm256_srav_epi32(
+						_mm256_set1_epi32(LFO_ENV_UP[blk_i[j]]), ams));
+				}
+				en[nsl][j] = e;
+
+				// Check for Ecnt >= Ecmp.
+				// Envelope events are only processed for active channels.
+				ecnt = _mm256_add_epi32(ecnt, einc);
+				unsigned int events = ~_mm256_movemask_ps(_mm256_castsi256_ps(
+					_mm256_cmpgt_epi32(ecmp, ecnt))) & active;
+				if (events) {
+					// Envelope phase change.
+					// This is rare, so use the scalar event handlers.
+					Store_AVX2(simd.Ecnt[nsl], ecnt);
+					do {
+						const int nch = __builtin_ctz(events);
+						events &= (events - 1);
+
+						slot_t *SL = &state.CHANNEL[nch]._SLOT[nsl];
+						SL->Ecnt = simd.Ecnt[nsl][nch];
+						ENV_NEXT_EVENT[SL->Ecurp](SL);
+						simd.Ecnt[nsl][nch] = SL->Ecnt;
+						simd.Einc[nsl][nch] = SL->Einc;
+						simd.Ecmp[nsl][nch] = SL->Ecmp;
+					} while (events);
+					ecnt = Load_AVX2(simd.Ecnt[nsl]);
+					einc = Load_AVX2(simd.Einc[nsl]);
+					ecmp = Load_AVX2(simd.Ecmp[nsl]);
+				}
+			}
+
+			Store_AVX2(simd.Fcnt[nsl], fcnt);
+			Store_AVX2(simd.Ecnt[nsl], ecnt);
+		}
+
+		// DO_FEEDBACK()
+		// This is the only loop-carried dependency, so it's latency-bound.
+		// Scalar loads have much lower latency than gathers.
+		for (int j = 0; j < n; j++) {
+			const __m256i in0 = _mm256_add_epi32(in[S0][j], _mm256_srav_epi32(
+					_mm256_add_epi32(vS0_OUT0, vS0_OUT1), vFB));
+			vS0_OUT1 = vS0_OUT0;
+			vS0_OUT0 = Op_Scalar_AVX2(in0, en[S0][j]);
+			out0[j] = vS0_OUT0;
+		}
+
+		// DO_ALGO_x()
+		// Each operator is calculated for the entire block before
+		// moving on to the next one, so the gathers don't depend
+		// on each other within a loop.
+		{
+			const __m256i s0_in1 = Load_AVX2(simd.route[ROUTE_S0_IN1]);
+			for (int j = 0; j < n; j++) {
+				out1[j] = Op_AVX2(_mm256_add_epi32(in[S1][j],
+						_mm256_and_si256(out0[j], s0_in1)), en[S1][j]);
+			}
+		}
+		{
+			const __m256i s0_in2 = Load_AVX2(simd.route[ROUTE_S0_IN2]);
+			const __m256i s1_in2 = Load_AVX2(simd.route[ROUTE_S1_IN2]);
+			for (int j = 0; j < n; j++) {
+				out2[j] = Op_AVX2(_mm256_add_epi32(in[S2][j], _mm256_add_epi32(
+						_mm256_and_si256(out0[j], s0_in2),
+						_mm256_and_si256(out1[j], s1_in2))), en[S2][j]);
+			}
+		}
+		{
+			const __m256i s0_in3 = Load_AVX2(simd.route[ROUTE_S0_IN3]);
+			const __m256i s1_in3 = Load_AVX2(simd.route[ROUTE_S1_IN3]);
+			const __m256i s2_in3 = Load_AVX2(simd.route[ROUTE_S2_IN3]);
+			const __m256i s0_out = Load_AVX2(simd.route[ROUTE_S0_OUT]);
+			const __m256i s1_out = Load_AVX2(simd.route[ROUTE_S1_OUT]);
+			const __m256i s2_out = Load_AVX2(simd.route[ROUTE_S2_OUT]);
+			const __m256i limit = Load_AVX2(simd.route[ROUTE_LIMIT]);
+
+			for (int j = 0; j < n; j++) {
+				const __m256i out3 = Op_AVX2(_mm256_add_epi32(in[S3][j], _mm256_add_epi32(
+						_mm256_and_si256(out0[j], s0_in3), _mm256_add_epi32(
+							_mm256_and_si256(out1[j], s1_in3),
+							_mm256_and_si256(out2[j], s2_in3)))), en[S3][j]);
+
+				__m256i outd = _mm256_add_epi32(out3, _mm256_add_epi32(
+						_mm256_and_si256(out0[j], s0_out), _mm256_add_epi32(
+							_mm256_and_si256(out1[j], s1_out),
+							_mm256_and_si256(out2[j], s2_out))));
+				outd = _mm256_srai_epi32(outd, OUT_SHIFT);
+
+				// DO_LIMIT()
+				const __m256i limited = _mm256_min_epi32(_mm256_max_epi32(outd, vLimitLo), vLimitHi);
+				out3d[j] = _mm256_blendv_epi8(outd, limited, limit);
+			}
+		}
+
+		// DO_OUTPUT(), DO_OUTPUT_INT()
+		for (int j = 0; j < n; j++) {
+			vOUTd = out3d[j];
+			if (interp) {
+				if (blk_cnt[j] >= 0) {
+					const int c = blk_cnt[j];
+					vOld_OUTd = _mm256_srai_epi32(_mm256_add_epi32(
+						_mm256_mullo_epi32(_mm256_set1_epi32(c ^ 0x3FFF), vOUTd),
+						_mm256_mullo_epi32(_mm256_set1_epi32(c), vOld_OUTd)), 14);
+					Output_AVX2(vOld_OUTd, vLEFT, vRIGHT, &bufL[blk_i[j]], &bufR[blk_i[j]]);
+				}
+				vOld_OUTd = vOUTd;
+			} else {
+				Output_AVX2(vOUTd, vLEFT, vRIGHT, &bufL[blk_i[j]], &bufR[blk_i[j]]);
+			}
+		}
+	}
+
+	Store_AVX2(simd.S0_OUT[0], vS0_OUT0);
+	Store_AVX2(simd.S0_OUT[1], vS0_OUT1);
+	Store_AVX2(simd.Old_OUTd, vOld_OUTd);
+	Store_AVX2(simd.OUTd, vOUTd);
+
+	if (interp) {
+		int_cnt = cnt;
+	}
+}
+
+/**
+ * Update all channels. (AVX2)
+ * Replaces the per-channel Update_Chan() calls in Ym2612::update().
+ * @param algo_type Algorithm type flags. (ALGO is ignored)
+ * @param bufL Left audio buffer.
+ * @param bufR Right audio buffer.
+ * @param length Length of the audio buffers, in samples.
+ */
+void Ym2612Private::Update_All_Chan_AVX2(int algo_type, int32_t *bufL, int32_t *bufR, int length)
+{
+	int active = 0;
+	for (int nch = 0; nch < 6; nch++) {
+		if (nch == 5 && state.DAC) {
+			// Channel 6 is only updated if DAC is disabled.
+			break;
+		}
+		if (Chan_Is_Active(&state.CHANNEL[nch])) {
+			active |= (1 << nch);
+		}
+	}
+
+	if (active == 0) {
+		// Nothing to update.
+		return;
+	}
+
+	SIMD_Load(active);
+	switch (algo_type & 0x18) {
+		case 0x00:	T_Update_All_Chan_AVX2<false, false>(active, bufL, bufR, length);	break;
+		case 0x08:	T_Update_All_Chan_AVX2<true,  false>(active, bufL, bufR, length);	break;
+		case 0x10:	T_Update_All_Chan_AVX2<false, true >(active, bufL, bufR, length);	break;
+		case 0x18:	T_Update_All_Chan_AVX2<true,  true >(active, bufL, bufR, length);	break;
+		default:
+			break;
+	}
+	SIMD_Store(active);
+}
+
+}
+
+#endif /* YM2612_HAS_AVX2 */
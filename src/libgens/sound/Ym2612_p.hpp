@@ -30,6 +30,17 @@
 #define PI 3.14159265358979323846
 #endif
 
+// Needed for LIBCOMPAT_HAS_X86_TARGET_INTRINSICS.
+#include "libcompat/cpuflags.h"
+
+// AVX2-optimized channel update.
+// This uses function-level target attributes,
+// so it doesn't require compiling with -mavx2.
+// The x86 CPU flags are checked at runtime.
+#ifdef LIBCOMPAT_HAS_X86_TARGET_INTRINSICS
+#define YM2612_HAS_AVX2 1
+#endif
+
 namespace LibGens {
 
 class Ym2612;
@@ -236,12 +247,21 @@ class Ym2612Private
 		};
 
 		// Static tables.
-		static bool isInit;	// True if the static tables have been initialized.
 		static int *SIN_TAB[SIN_LENGTH];			// SINUS TABLE (pointer on TL TABLE)
 		static int TL_TAB[TL_LENGTH * 2];			// TOTAL LEVEL TABLE (plus and minus)
 		static unsigned int ENV_TAB[2 * ENV_LENGTH * 8];	// ENV CURVE TABLE (attack & decay)
 		//static unsigned int ATTACK_TO_DECAY[ENV_LENGTH];	// Conversion from attack to decay phase
 		static unsigned int DECAY_TO_ATTACK[ENV_LENGTH];	// Conversion from decay to attack phase
+#ifdef YM2612_HAS_AVX2
+		// Compact tables for the vectorized update.
+		// TL_TAB's negative half is the positive half negated,
+		// and everything past PG_CUT_OFF is 0, so SIN_TAB can be
+		// stored as a 16-bit offset (bit 15 == negative) into
+		// the positive half, clamped to PG_CUT_OFF.
+		// Both tables fit in L1 cache, unlike TL_TAB.
+		static int16_t SIN_SIMD_TAB[SIN_LENGTH + 1];	// +1 for 32-bit gathers.
+		static int TL_SIMD_TAB[PG_CUT_OFF + 1];
+#endif /* YM2612_HAS_AVX2 */
 
 		// Member tables.
 		unsigned int FINC_TAB[2048];		// Frequency step table
@@ -301,6 +321,7 @@ class Ym2612Private
 		void CSM_Key_Control(void);
 
 		int SLOT_SET(int address, uint8_t data);
+		void fixupSlotPointers(void);
 		int CHANNEL_SET(int address, uint8_t data);
 		int YM_SET(int address, uint8_t data);
 
@@ -318,6 +339,72 @@ class Ym2612Private
 		inline void T_Update_Chan_LFO_Int(channel_t *CH, int32_t *bufL, int32_t *bufR, int length);
 
 		void Update_Chan(int algo_type, channel_t *CH, int32_t *bufL, int32_t *bufR, int length);
+
+#ifdef YM2612_HAS_AVX2
+		/** Vectorized update. **/
+
+		// Operator routing for the vectorized update.
+		// Each algorithm is described as a set of connections
+		// between S0 (with feedback), S1, S2, and S3.
+		// ALGO_ROUTE[] has one bit per AlgoRoute value.
+		enum AlgoRoute {
+			ROUTE_S0_IN1	= 0,	// S0 modulates S1.
+			ROUTE_S0_IN2	= 1,	// S0 modulates S2.
+			ROUTE_S1_IN2	= 2,	// S1 modulates S2.
+			ROUTE_S0_IN3	= 3,	// S0 modulates S3.
+			ROUTE_S1_IN3	= 4,	// S1 modulates S3.
+			ROUTE_S2_IN3	= 5,	// S2 modulates S3.
+			ROUTE_S0_OUT	= 6,	// S0 is a carrier.
+			ROUTE_S1_OUT	= 7,	// S1 is a carrier.
+			ROUTE_S2_OUT	= 8,	// S2 is a carrier.
+			ROUTE_LIMIT	= 9,	// Channel output is limited.
+
+			ROUTE_MAX
+		};
+		static const uint16_t ALGO_ROUTE[8];
+
+		/**
+		 * Structure-of-arrays copy of the channel state.
+		 * Slot arrays are indexed as [slot][channel], using the
+		 * same slot order as channel_t::_SLOT[]. Lanes 6 and 7
+		 * are padding so each array fills an AVX2 register.
+		 *
+		 * state.CHANNEL[] remains authoritative, since register
+		 * writes and savestates operate on it. The working set
+		 * is loaded before each update and stored afterwards.
+		 */
+		struct simd_state_t {
+			int Fcnt[4][8];
+			int Finc[4][8];
+			int Ecnt[4][8];
+			int Einc[4][8];
+			int Ecmp[4][8];
+			int TLL[4][8];
+			int AMS[4][8];
+
+			int S0_OUT[2][8];
+			int Old_OUTd[8];
+			int OUTd[8];
+			int LEFT[8];
+			int RIGHT[8];
+			int FB[8];
+			int FMS[8];
+			int route[ROUTE_MAX][8];	// Routing masks. (0 or ~0)
+		};
+		simd_state_t simd;
+
+		// Number of YM2612 samples processed per block.
+		static const int SIMD_BLOCK_LEN = 32;
+
+		static bool Chan_Is_Active(const channel_t *CH);
+		void SIMD_Load(int active);
+		void SIMD_Store(int active);
+
+		template<bool lfo, bool interp>
+		void T_Update_All_Chan_AVX2(int active, int32_t *bufL, int32_t *bufR, int length);
+
+		void Update_All_Chan_AVX2(int algo_type, int32_t *bufL, int32_t *bufR, int length);
+#endif /* YM2612_HAS_AVX2 */
 };
 
 }
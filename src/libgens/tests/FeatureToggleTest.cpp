@@ -0,0 +1,162 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * FeatureToggleTest.cpp: Feature on/off comparison test fixture.          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "FeatureToggleTest.hpp"
+
+// LibGens.
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Set up the emulation contexts for the synthetic ROM.
+ */
+void FeatureToggleTest::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(GetParam());
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen()) << "Synthetic ROM could not be opened.";
+
+	for (int i = 0; i < 2; i++) {
+		m_context[i] = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+		ASSERT_TRUE(m_context[i]->isRomOpened()) << "Synthetic ROM could not be loaded.";
+		m_context[i]->m_vdp->MD_Screen->setBpp(MdFb::BPP_32);
+	}
+	m_rom->close();
+
+	ASSERT_EQ(0, setFeature(m_context[0], false));
+	EXPECT_FALSE(isFeatureEnabled(m_context[0]));
+	ASSERT_EQ(0, setFeature(m_context[1], true));
+	EXPECT_TRUE(isFeatureEnabled(m_context[1]));
+}
+
+/**
+ * Tear down the emulation contexts.
+ */
+void FeatureToggleTest::TearDown(void)
+{
+	for (int i = 0; i < 2; i++) {
+		delete m_context[i];
+		m_context[i] = nullptr;
+	}
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Compare the state of both contexts.
+ * The default implementation compares the framebuffers.
+ * @param what Description, for error messages.
+ */
+void FeatureToggleTest::checkState(const char *what)
+{
+	const MdFb *fb0 = m_context[0]->m_vdp->MD_Screen;
+	const MdFb *fb1 = m_context[1]->m_vdp->MD_Screen;
+	for (int y = 0; y < fb0->numLines(); y++) {
+		ASSERT_EQ(0, memcmp(fb0->lineBuf32(y), fb1->lineBuf32(y),
+			fb0->pxPerLine() * sizeof(uint32_t)))
+			<< "Line " << y << " differs: " << what;
+	}
+}
+
+/**
+ * Run a frame in both contexts and compare them.
+ * @param frame Frame number, for error messages.
+ */
+void FeatureToggleTest::runAndCheck(int frame)
+{
+	m_context[0]->execFrame();
+	m_context[1]->execFrame();
+
+	char what[32];
+	snprintf(what, sizeof(what), "frame %d", frame);
+	ASSERT_NO_FATAL_FAILURE(checkState(what));
+}
+
+/**
+ * Write to the VDP in both contexts using the data port.
+ * @param ctrl1 First control word.
+ * @param ctrl2 Second control word.
+ * @param data Data.
+ * @param words Number of words in data.
+ */
+void FeatureToggleTest::writeData(uint16_t ctrl1, uint16_t ctrl2, const uint16_t *data, int words)
+{
+	for (int i = 0; i < 2; i++) {
+		Vdp *const vdp = m_context[i]->m_vdp;
+		// Auto-increment by one word.
+		vdp->writeCtrlMD(0x8F02);
+		vdp->writeCtrlMD(ctrl1);
+		vdp->writeCtrlMD(ctrl2);
+		for (int j = 0; j < words; j++) {
+			vdp->writeDataMD(data[j]);
+		}
+	}
+}
+
+/**
+ * Write to VRAM in both contexts using the data port.
+ * @param address VRAM address.
+ * @param data Data.
+ * @param words Number of words in data.
+ */
+void FeatureToggleTest::writeVRam(uint16_t address, const uint16_t *data, int words)
+{
+	// VRAM write command.
+	writeData(0x4000 | (address & 0x3FFF), address >> 14, data, words);
+}
+
+/**
+ * Run the synthetic ROM in both contexts.
+ * Both contexts must be identical after every frame.
+ */
+void FeatureToggleTest::testBitExact(void)
+{
+	for (int frame = 0; frame < TEST_FRAMES; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+	checkStats();
+}
+
+/**
+ * Toggle the feature while the ROM is running.
+ */
+void FeatureToggleTest::testToggle(void)
+{
+	for (int frame = 0; frame < TEST_FRAMES; frame++) {
+		if (frame % 7 == 0) {
+			EmuMD *const context = m_context[1];
+			ASSERT_EQ(0, setFeature(context, !isFeatureEnabled(context)));
+		}
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+}
+
+} }
@@ -0,0 +1,167 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * FeatureToggleTest.hpp: Feature on/off comparison test fixture.          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_TESTS_FEATURETOGGLETEST_HPP__
+#define __LIBGENS_TESTS_FEATURETOGGLETEST_HPP__
+
+// Google Test
+#include "gtest/gtest.h"
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens {
+
+class EmuMD;
+class Rom;
+
+namespace Tests {
+
+/**
+ * Feature on/off comparison test fixture.
+ *
+ * Runs a synthetic ROM in two emulation contexts, one with
+ * an optional emulation feature disabled and one with it
+ * enabled, and compares the contexts after every frame.
+ *
+ * Subclasses implement setFeature() and isFeatureEnabled(),
+ * and can extend checkState() to compare more state.
+ * Use FEATURE_TOGGLE_TESTS() to add the common tests.
+ */
+class FeatureToggleTest : public ::testing::TestWithParam<SyntheticRom::RomType_t>
+{
+	protected:
+		FeatureToggleTest()
+			: ::testing::TestWithParam<SyntheticRom::RomType_t>()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+		{
+			m_context[0] = nullptr;
+			m_context[1] = nullptr;
+		}
+		virtual ~FeatureToggleTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+		/**
+		 * Enable or disable the feature being tested.
+		 * @param context Emulation context.
+		 * @param enable If true, enable the feature.
+		 * @return 0 on success; negative errno on error.
+		 */
+		virtual int setFeature(EmuMD *context, bool enable) = 0;
+
+		/**
+		 * Is the feature being tested enabled?
+		 * @param context Emulation context.
+		 * @return True if enabled; false if not.
+		 */
+		virtual bool isFeatureEnabled(EmuMD *context) = 0;
+
+		/**
+		 * Compare the state of both contexts.
+		 * The default implementation compares the framebuffers.
+		 * @param what Description, for error messages.
+		 */
+		virtual void checkState(const char *what);
+
+		/**
+		 * Check the feature's statistics at the end of testBitExact().
+		 * The default implementation does nothing.
+		 */
+		virtual void checkStats(void) { }
+
+		/**
+		 * Run a frame in both contexts and compare them.
+		 * @param frame Frame number, for error messages.
+		 */
+		void runAndCheck(int frame);
+
+		/**
+		 * Write to the VDP in both contexts using the data port.
+		 * @param ctrl1 First control word.
+		 * @param ctrl2 Second control word.
+		 * @param data Data.
+		 * @param words Number of words in data.
+		 */
+		void writeData(uint16_t ctrl1, uint16_t ctrl2, const uint16_t *data, int words);
+
+		/**
+		 * Write to VRAM in both contexts using the data port.
+		 * @param address VRAM address.
+		 * @param data Data.
+		 * @param words Number of words in data.
+		 */
+		void writeVRam(uint16_t address, const uint16_t *data, int words);
+
+		/**
+		 * Run the synthetic ROM in both contexts.
+		 * Both contexts must be identical after every frame.
+		 */
+		void testBitExact(void);
+
+		/**
+		 * Toggle the feature while the ROM is running.
+		 */
+		void testToggle(void);
+
+	protected:
+		// Number of frames to compare.
+		static const int TEST_FRAMES = 120;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+
+		// [0] == feature disabled
+		// [1] == feature enabled
+		EmuMD *m_context[2];
+};
+
+} }
+
+/**
+ * Add the common tests for a FeatureToggleTest subclass,
+ * and instantiate them for the synthetic ROMs.
+ * @param fixture Test fixture class.
+ */
+#define FEATURE_TOGGLE_TESTS(fixture) \
+	TEST_P(fixture, bitExact) \
+	{ \
+		testBitExact(); \
+	} \
+	TEST_P(fixture, toggle) \
+	{ \
+		testToggle(); \
+	} \
+	INSTANTIATE_TEST_CASE_P(SyntheticRoms, fixture, \
+		::testing::Values( \
+			SyntheticRom::ROM_SPRITES, \
+			SyntheticRom::ROM_SCROLL, \
+			SyntheticRom::ROM_DMA, \
+			SyntheticRom::ROM_YM2612, \
+			SyntheticRom::ROM_Z80 \
+	))
+
+#endif /* __LIBGENS_TESTS_FEATURETOGGLETEST_HPP__ */
@@ -0,0 +1,496 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * FrameBenchmark.cpp: Frame throughput benchmark.                         *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+#include "Util/Timing.hpp"
+#include "Util/Profiler.hpp"
+#include "sound/SoundMgr.hpp"
+#include "cpu/M68K_Mem.hpp"
+
+// aligned_malloc()
+#include "libcompat/aligned_malloc.h"
+
+// Synthetic test ROMs.
+#include "SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// ZLib. (for crc32())
+#include <zlib.h>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Timing results for a single frame execution mode.
+ */
+struct FrameBenchmark_result
+{
+	uint64_t execTime;	// Time spent in execFrame(), in microseconds.
+	uint64_t audioTime;	// Time spent in writeStereo(), in microseconds.
+	int frames;		// Number of frames run.
+	int lines;		// Number of scanlines run.
+
+	FrameBenchmark_result()
+		: execTime(0)
+		, audioTime(0)
+		, frames(0)
+		, lines(0) { }
+
+	/**
+	 * Frames per second, including audio output.
+	 * @return Frames per second.
+	 */
+	double fps(void) const
+	{
+		const uint64_t total = execTime + audioTime;
+		return (total > 0 ? (frames * 1000000.0 / total) : 0.0);
+	}
+
+	/**
+	 * Nanoseconds per scanline, excluding audio output.
+	 * @return Nanoseconds per scanline.
+	 */
+	double nsPerLine(void) const
+	{
+		return (lines > 0 ? (execTime * 1000.0 / lines) : 0.0);
+	}
+};
+
+class FrameBenchmark : public ::testing::TestWithParam<SyntheticRom::RomType_t>
+{
+	protected:
+		FrameBenchmark()
+			: ::testing::TestWithParam<SyntheticRom::RomType_t>()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+			, m_context(nullptr)
+			, m_audioBuf(nullptr) { }
+		virtual ~FrameBenchmark() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of frames to run before measuring.
+		// This lets each ROM finish its initialization.
+		static const int WARMUP_FRAMES;
+
+		// Number of frames to measure for each execution mode.
+		static const int BENCHMARK_FRAMES;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+		EmuMD *m_context;
+		int16_t *m_audioBuf;
+
+		/**
+		 * Calculate the CRC32 of the current frame.
+		 * @return CRC32 of the current frame.
+		 */
+		uint32_t fbCrc32(void) const;
+
+		/**
+		 * Write the current audio segment to m_audioBuf.
+		 * @return True if any samples were non-zero.
+		 */
+		bool writeAudio(void);
+
+		/**
+		 * Run frames and measure the elapsed time.
+		 * @param VDP If true, use execFrame(); otherwise, use execFrameFast().
+		 * @param frames Number of frames to run.
+		 * @param result [out] Timing results.
+		 */
+		template<bool VDP>
+		void T_runFrames(int frames, FrameBenchmark_result *result);
+
+		/**
+		 * Print the profiler's per-subsystem breakdown.
+		 * @param romName ROM name.
+		 * @param mode Execution mode name.
+		 * @param stats Profiler statistics.
+		 */
+		static void printProfile(const char *romName, const char *mode,
+					 const Profiler::Stats &stats);
+};
+
+const int FrameBenchmark::WARMUP_FRAMES = 60;
+const int FrameBenchmark::BENCHMARK_FRAMES = 300;
+
+/**
+ * Set up the emulation context for the synthetic ROM.
+ */
+void FrameBenchmark::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(GetParam());
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen()) << "Synthetic ROM could not be opened.";
+
+	m_context = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+	ASSERT_TRUE(m_context->isRomOpened()) << "Synthetic ROM could not be loaded.";
+	m_rom->close();
+
+	m_context->m_vdp->MD_Screen->setBpp(MdFb::BPP_32);
+	m_audioBuf = (int16_t*)aligned_malloc(16, SoundMgr::MAX_SEGMENT_SIZE * 2 * sizeof(int16_t));
+
+	// Let the ROM initialize the VDP and sound hardware.
+	for (int i = 0; i < WARMUP_FRAMES; i++) {
+		m_context->execFrame();
+		writeAudio();
+	}
+}
+
+/**
+ * Tear down the emulation context.
+ */
+void FrameBenchmark::TearDown(void)
+{
+	aligned_free(m_audioBuf);
+	m_audioBuf = nullptr;
+	delete m_context;
+	m_context = nullptr;
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Calculate the CRC32 of the current frame.
+ * @return CRC32 of the current frame.
+ */
+uint32_t FrameBenchmark::fbCrc32(void) const
+{
+	const MdFb *fb = m_context->m_vdp->MD_Screen;
+	uLong crc = crc32(0, nullptr, 0);
+	for (int y = 0; y < fb->numLines(); y++) {
+		crc = crc32(crc, (const Bytef*)fb->lineBuf32(y),
+			    fb->pxPerLine() * sizeof(uint32_t));
+	}
+	return (uint32_t)crc;
+}
+
+/**
+ * Write the current audio segment to m_audioBuf.
+ * @return True if any samples were non-zero.
+ */
+bool FrameBenchmark::writeAudio(void)
+{
+	SoundMgr *soundMgr = m_context->m_soundMgr;
+	const int samples = soundMgr->writeStereo(m_audioBuf, soundMgr->getSegLength());
+	for (int i = 0; i < samples * 2; i++) {
+		if (m_audioBuf[i] != 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Run frames and measure the elapsed time.
+ * @param VDP If true, use execFrame(); otherwise, use execFrameFast().
+ * @param frames Number of frames to run.
+ * @param result [out] Timing results.
+ */
+template<bool VDP>
+void FrameBenchmark::T_runFrames(int frames, FrameBenchmark_result *result)
+{
+	*result = FrameBenchmark_result();
+
+	if (m_context->m_profiler) {
+		m_context->m_profiler->reset();
+	}
+
+	Timing timing;
+	SoundMgr *soundMgr = m_context->m_soundMgr;
+	for (int i = 0; i < frames; i++) {
+		const uint64_t t0 = timing.getTime();
+		if (VDP) {
+			m_context->execFrame();
+		} else {
+			m_context->execFrameFast();
+		}
+		const uint64_t t1 = timing.getTime();
+		soundMgr->writeStereo(m_audioBuf, soundMgr->getSegLength());
+		const uint64_t t2 = timing.getTime();
+
+		result->execTime += (t1 - t0);
+		result->audioTime += (t2 - t1);
+		result->frames++;
+		result->lines += m_context->m_vdp->VDP_Lines.totalDisplayLines;
+	}
+}
+
+/**
+ * Print the profiler's per-subsystem breakdown.
+ * @param romName ROM name.
+ * @param mode Execution mode name.
+ * @param stats Profiler statistics.
+ */
+void FrameBenchmark::printProfile(const char *romName, const char *mode,
+				  const Profiler::Stats &stats)
+{
+	if (stats.frames == 0)
+		return;
+
+	const double frameUs = (double)stats.frameNs / stats.frames / 1000.0;
+	printf("[ FrameBenchmark ] %-7s %s profile: %.1f us/frame",
+		romName, mode, frameUs);
+	for (int i = 0; i < Profiler::PROF_MAX; i++) {
+		const double subUs = (double)stats.subsystemNs[i] / stats.frames / 1000.0;
+		printf(", %s %.1f us", Profiler::SubsystemName((Profiler::Subsystem_t)i), subUs);
+	}
+	printf("\n");
+}
+
+/**
+ * Verify that each synthetic ROM exercises the subsystem it's meant to.
+ * Otherwise, the benchmark numbers are meaningless.
+ */
+TEST_P(FrameBenchmark, workload)
+{
+	const SyntheticRom::RomType_t romType = GetParam();
+
+	// Video must change every frame, except for the YM2612 ROM.
+	m_context->execFrame();
+	writeAudio();
+	const uint32_t crc1 = fbCrc32();
+	m_context->execFrame();
+	const bool hasAudio = writeAudio();
+	const uint32_t crc2 = fbCrc32();
+
+	if (romType != SyntheticRom::ROM_YM2612) {
+		EXPECT_NE(crc1, crc2) << "Frame output did not change.";
+	}
+
+	switch (romType) {
+		case SyntheticRom::ROM_YM2612:
+			EXPECT_TRUE(hasAudio) << "YM2612 did not produce any audio.";
+			break;
+		case SyntheticRom::ROM_Z80:
+			EXPECT_EQ((unsigned int)(Z80_STATE_ENABLED | Z80_STATE_BUSREQ), m_context->m_m68kMem->Z80_State)
+				<< "Z80 is not running.";
+			EXPECT_TRUE(hasAudio) << "Z80 did not produce any audio.";
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Measure execFrame() and execFrameFast() throughput.
+ *
+ * The per-subsystem breakdown is derived from the two modes:
+ * - VDP rendering: execFrame() - execFrameFast()
+ * - CPUs, DMA, and audio ICs: execFrameFast()
+ * - Audio output: SoundMgr::writeStereo()
+ *
+ * If the profiler is enabled (GENS_ENABLE_PROFILER), the
+ * profiler's per-subsystem times are printed as well.
+ */
+TEST_P(FrameBenchmark, throughput)
+{
+	// If the profiler is enabled, its statistics
+	// are saved after each run.
+	Profiler *const profiler = m_context->m_profiler;
+	Profiler::Stats fullProfile, fastProfile;
+
+	FrameBenchmark_result full, fast;
+	T_runFrames<true>(BENCHMARK_FRAMES, &full);
+	if (profiler) {
+		fullProfile = profiler->total();
+	}
+	T_runFrames<false>(BENCHMARK_FRAMES, &fast);
+	if (profiler) {
+		fastProfile = profiler->total();
+	}
+	ASSERT_EQ(BENCHMARK_FRAMES, full.frames);
+	ASSERT_EQ(BENCHMARK_FRAMES, fast.frames);
+
+	const char *const romName = SyntheticRom::RomTypeName(GetParam());
+	printf("[ FrameBenchmark ] %-7s execFrame:     %9.1f fps, %8.1f ns/line\n",
+		romName, full.fps(), full.nsPerLine());
+	printf("[ FrameBenchmark ] %-7s execFrameFast: %9.1f fps, %8.1f ns/line\n",
+		romName, fast.fps(), fast.nsPerLine());
+
+	// Per-subsystem breakdown, per frame.
+	const double fullFrame = (double)(full.execTime + full.audioTime) / full.frames;
+	double render = (double)full.execTime / full.frames - (double)fast.execTime / fast.frames;
+	if (render < 0)
+		render = 0;
+	const double core = (double)fast.execTime / fast.frames;
+	const double audio = (double)full.audioTime / full.frames;
+	if (fullFrame > 0) {
+		printf("[ FrameBenchmark ] %-7s breakdown: VDP render %7.1f us (%4.1f%%), "
+			"CPU/DMA/sound %7.1f us (%4.1f%%), audio out %5.1f us (%4.1f%%)\n",
+			romName,
+			render, render * 100.0 / fullFrame,
+			core, core * 100.0 / fullFrame,
+			audio, audio * 100.0 / fullFrame);
+	}
+
+	if (profiler) {
+		// Detailed per-subsystem breakdown.
+		EXPECT_EQ((unsigned int)BENCHMARK_FRAMES, fullProfile.frames);
+		EXPECT_EQ((unsigned int)full.lines, fullProfile.lines);
+		EXPECT_EQ(0ULL, (unsigned long long)fastProfile.subsystemNs[Profiler::PROF_VDP_RENDER])
+			<< "execFrameFast() should not render any lines.";
+		printProfile(romName, "execFrame", fullProfile);
+		printProfile(romName, "execFrameFast", fastProfile);
+	}
+	fflush(stdout);
+}
+
+/**
+ * Measure execFrame() throughput with and without
+ * skip-unchanged-line rendering.
+ * VdpLineSkipTest verifies that the output is identical.
+ */
+TEST_P(FrameBenchmark, lineSkip)
+{
+	Vdp *const vdp = m_context->m_vdp;
+
+	FrameBenchmark_result normal, skip;
+	T_runFrames<true>(BENCHMARK_FRAMES, &normal);
+	ASSERT_EQ(0, vdp->setLineSkip(true));
+	T_runFrames<true>(BENCHMARK_FRAMES, &skip);
+	VdpLineSkip::Stats stats;
+	vdp->takeLineSkipStats(&stats);
+	ASSERT_EQ(0, vdp->setLineSkip(false));
+	ASSERT_EQ(BENCHMARK_FRAMES, normal.frames);
+	ASSERT_EQ(BENCHMARK_FRAMES, skip.frames);
+
+	const uint64_t total = stats.rendered + stats.skipped;
+	EXPECT_GT(total, 0U);
+	const double skipPct = (total > 0 ? (stats.skipped * 100.0 / total) : 0.0);
+
+	const char *const romName = SyntheticRom::RomTypeName(GetParam());
+	printf("[ FrameBenchmark ] %-7s line skip off: %9.1f fps, %8.1f ns/line\n",
+		romName, normal.fps(), normal.nsPerLine());
+	printf("[ FrameBenchmark ] %-7s line skip on:  %9.1f fps, %8.1f ns/line (%.1f%% of lines skipped)\n",
+		romName, skip.fps(), skip.nsPerLine(), skipPct);
+	fflush(stdout);
+}
+
+/**
+ * Measure execFrame() throughput with and without
+ * the pattern cache.
+ * VdpPatternCacheTest verifies that the output is identical.
+ */
+TEST_P(FrameBenchmark, patternCache)
+{
+	Vdp *const vdp = m_context->m_vdp;
+
+	FrameBenchmark_result normal, cached;
+	T_runFrames<true>(BENCHMARK_FRAMES, &normal);
+	ASSERT_EQ(0, vdp->setPatternCache(true));
+	T_runFrames<true>(BENCHMARK_FRAMES, &cached);
+	VdpCache::Stats stats;
+	vdp->takePatternCacheStats(&stats);
+	ASSERT_EQ(0, vdp->setPatternCache(false));
+	ASSERT_EQ(BENCHMARK_FRAMES, normal.frames);
+	ASSERT_EQ(BENCHMARK_FRAMES, cached.frames);
+
+	// Render time per frame is the time spent in execFrame()
+	// minus the time spent in execFrameFast().
+	FrameBenchmark_result fast;
+	T_runFrames<false>(BENCHMARK_FRAMES, &fast);
+	ASSERT_EQ(BENCHMARK_FRAMES, fast.frames);
+	const double core = (double)fast.execTime / fast.frames;
+	double renderNormal = (double)normal.execTime / normal.frames - core;
+	double renderCached = (double)cached.execTime / cached.frames - core;
+	if (renderNormal < 0)
+		renderNormal = 0;
+	if (renderCached < 0)
+		renderCached = 0;
+
+	const char *const romName = SyntheticRom::RomTypeName(GetParam());
+	printf("[ FrameBenchmark ] %-7s pattern cache off: %9.1f fps, VDP render %7.1f us/frame\n",
+		romName, normal.fps(), renderNormal);
+	printf("[ FrameBenchmark ] %-7s pattern cache on:  %9.1f fps, VDP render %7.1f us/frame "
+		"(%.1f lines decoded/frame)\n",
+		romName, cached.fps(), renderCached,
+		(double)stats.lines / cached.frames);
+	fflush(stdout);
+}
+
+/**
+ * Measure execFrameFast() throughput with and without
+ * bulk DMA. DMA is done in execFrameFast(), so this
+ * isn't affected by rendering.
+ * VdpDmaBulkTest verifies that the output is identical.
+ */
+TEST_P(FrameBenchmark, dmaBulk)
+{
+	Vdp *const vdp = m_context->m_vdp;
+
+	FrameBenchmark_result word, bulk;
+	ASSERT_EQ(0, vdp->setDmaBulk(false));
+	T_runFrames<false>(BENCHMARK_FRAMES, &word);
+	ASSERT_EQ(0, vdp->setDmaBulk(true));
+	T_runFrames<false>(BENCHMARK_FRAMES, &bulk);
+	ASSERT_EQ(BENCHMARK_FRAMES, word.frames);
+	ASSERT_EQ(BENCHMARK_FRAMES, bulk.frames);
+
+	const char *const romName = SyntheticRom::RomTypeName(GetParam());
+	printf("[ FrameBenchmark ] %-7s bulk DMA off: %9.1f fps, %7.1f us/frame\n",
+		romName, word.fps(), (double)word.execTime / word.frames);
+	printf("[ FrameBenchmark ] %-7s bulk DMA on:  %9.1f fps, %7.1f us/frame\n",
+		romName, bulk.fps(), (double)bulk.execTime / bulk.frames);
+	fflush(stdout);
+}
+
+INSTANTIATE_TEST_CASE_P(SyntheticRoms, FrameBenchmark,
+	::testing::Values(
+		SyntheticRom::ROM_SPRITES,
+		SyntheticRom::ROM_SCROLL,
+		SyntheticRom::ROM_DMA,
+		SyntheticRom::ROM_YM2612,
+		SyntheticRom::ROM_Z80,
+		SyntheticRom::ROM_RASTER
+));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Frame throughput benchmark.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
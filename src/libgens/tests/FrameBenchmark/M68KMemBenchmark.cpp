@@ -0,0 +1,264 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * M68KMemBenchmark.cpp: M68K memory access benchmark.                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Util/Timing.hpp"
+#include "cpu/M68K_Mem.hpp"
+
+// U16DATA_U8_INVERT
+#include "libcompat/byteswap.h"
+
+// Synthetic test ROMs.
+#include "SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+namespace LibGens { namespace Tests {
+
+class M68KMemBenchmark : public ::testing::Test
+{
+	protected:
+		M68KMemBenchmark()
+			: ::testing::Test()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+			, m_context(nullptr)
+			, m_mem(nullptr) { }
+		virtual ~M68KMemBenchmark() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of times each 64 KB page is accessed
+		// for each throughput measurement.
+		static const int BENCHMARK_PASSES;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+		EmuMD *m_context;
+		M68K_Mem *m_mem;
+
+		enum AccessType_t {
+			ACCESS_RB,
+			ACCESS_RW,
+			ACCESS_WB,
+			ACCESS_WW,
+		};
+
+		/**
+		 * Access a 64 KB page repeatedly and measure the elapsed time.
+		 * @param type Access type.
+		 * @param base Base address of the page.
+		 * @param passes Number of passes over the page.
+		 * @return Nanoseconds per access.
+		 */
+		double measure(AccessType_t type, uint32_t base, int passes);
+
+		/**
+		 * Measure an access type with and without the page map.
+		 * @param name Description of the access.
+		 * @param type Access type.
+		 * @param base Base address of the page.
+		 */
+		void compare(const char *name, AccessType_t type, uint32_t base);
+};
+
+const int M68KMemBenchmark::BENCHMARK_PASSES = 64;
+
+/**
+ * Set up the emulation context for the synthetic ROM.
+ */
+void M68KMemBenchmark::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(SyntheticRom::ROM_SPRITES);
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen()) << "Synthetic ROM could not be opened.";
+
+	m_context = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+	ASSERT_TRUE(m_context->isRomOpened()) << "Synthetic ROM could not be loaded.";
+	m_rom->close();
+
+	m_mem = m_context->m_m68kMem;
+	ASSERT_TRUE(m_mem->isPageMapEnabled());
+}
+
+/**
+ * Tear down the emulation context.
+ */
+void M68KMemBenchmark::TearDown(void)
+{
+	if (m_mem) {
+		m_mem->setPageMapEnabled(true);
+		m_mem = nullptr;
+	}
+	delete m_context;
+	m_context = nullptr;
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Access a 64 KB page repeatedly and measure the elapsed time.
+ * @param type Access type.
+ * @param base Base address of the page.
+ * @param passes Number of passes over the page.
+ * @return Nanoseconds per access.
+ */
+double M68KMemBenchmark::measure(AccessType_t type, uint32_t base, int passes)
+{
+	Timing timing;
+	unsigned int sum = 0;
+	unsigned int accesses = 0;
+
+	const uint64_t t0 = timing.getTimeNs();
+	for (int pass = 0; pass < passes; pass++) {
+		switch (type) {
+			case ACCESS_RB:
+				for (uint32_t addr = 0; addr < 0x10000; addr++)
+					sum += m_mem->M68K_RB(base | addr);
+				accesses += 0x10000;
+				break;
+			case ACCESS_RW:
+				for (uint32_t addr = 0; addr < 0x10000; addr += 2)
+					sum += m_mem->M68K_RW(base | addr);
+				accesses += 0x8000;
+				break;
+			case ACCESS_WB:
+				for (uint32_t addr = 0; addr < 0x10000; addr++)
+					m_mem->M68K_WB(base | addr, (uint8_t)(addr + pass));
+				accesses += 0x10000;
+				break;
+			case ACCESS_WW:
+				for (uint32_t addr = 0; addr < 0x10000; addr += 2)
+					m_mem->M68K_WW(base | addr, (uint16_t)(addr + pass));
+				accesses += 0x8000;
+				break;
+		}
+	}
+	const uint64_t t1 = timing.getTimeNs();
+
+	// Make sure the reads aren't optimized out.
+	static volatile unsigned int sink;
+	sink = sum;
+	((void)sink);
+
+	return (accesses > 0 ? ((double)(t1 - t0) / accesses) : 0.0);
+}
+
+/**
+ * Measure an access type with and without the page map.
+ * @param name Description of the access.
+ * @param type Access type.
+ * @param base Base address of the page.
+ */
+void M68KMemBenchmark::compare(const char *name, AccessType_t type, uint32_t base)
+{
+	m_mem->setPageMapEnabled(false);
+	const double nsBanked = measure(type, base, BENCHMARK_PASSES);
+	m_mem->setPageMapEnabled(true);
+	const double nsPaged = measure(type, base, BENCHMARK_PASSES);
+
+	printf("[ M68KMemBenchmark ] %-18s bank handlers: %6.2f ns/access, "
+		"page map: %6.2f ns/access (%.2fx)\n",
+		name, nsBanked, nsPaged,
+		(nsPaged > 0 ? (nsBanked / nsPaged) : 0.0));
+	fflush(stdout);
+}
+
+/**
+ * Verify that the page map returns the same data as the bank handlers.
+ */
+TEST_F(M68KMemBenchmark, consistency)
+{
+	// ROM is 64 KB, so $010000 is past the end of the ROM.
+	// RAM is mirrored throughout $E00000-$FFFFFF.
+	static const uint32_t readPages[] = {0x000000, 0x010000, 0xE00000, 0xFF0000};
+
+	// Fill RAM with a pattern.
+	for (uint32_t addr = 0; addr < 0x10000; addr += 2) {
+		m_mem->M68K_WW(0xFF0000 | addr, (uint16_t)(addr * 0x9E37));
+	}
+
+	for (size_t i = 0; i < sizeof(readPages)/sizeof(readPages[0]); i++) {
+		const uint32_t base = readPages[i];
+		for (uint32_t addr = 0; addr < 0x10000; addr++) {
+			m_mem->setPageMapEnabled(false);
+			const uint8_t b_banked = m_mem->M68K_RB(base | addr);
+			const uint16_t w_banked = m_mem->M68K_RW(base | (addr & ~1));
+			m_mem->setPageMapEnabled(true);
+			const uint8_t b_paged = m_mem->M68K_RB(base | addr);
+			const uint16_t w_paged = m_mem->M68K_RW(base | (addr & ~1));
+
+			ASSERT_EQ(b_banked, b_paged) << "Byte mismatch at $" << std::hex << (base | addr);
+			ASSERT_EQ(w_banked, w_paged) << "Word mismatch at $" << std::hex << (base | addr);
+		}
+	}
+
+	// Writes through the page map must be visible to the bank handlers.
+	m_mem->M68K_WB(0xE01235, 0x5A);
+	m_mem->M68K_WW(0xFF4320, 0x1234);
+	m_mem->setPageMapEnabled(false);
+	EXPECT_EQ(0x5A, m_mem->M68K_RB(0xFF1235));
+	EXPECT_EQ(0x12, m_mem->M68K_RB(0xE04320));
+	EXPECT_EQ(0x34, m_mem->M68K_RB(0xE04321));
+	EXPECT_EQ(0x5A, m_mem->Ram_68k.u8[0x1235 ^ U16DATA_U8_INVERT]);
+}
+
+/**
+ * Measure ROM and RAM access times with and without the page map.
+ */
+TEST_F(M68KMemBenchmark, throughput)
+{
+	compare("ROM read byte", ACCESS_RB, 0x000000);
+	compare("ROM read word", ACCESS_RW, 0x000000);
+	compare("RAM read byte", ACCESS_RB, 0xFF0000);
+	compare("RAM read word", ACCESS_RW, 0xFF0000);
+	compare("RAM write byte", ACCESS_WB, 0xFF0000);
+	compare("RAM write word", ACCESS_WW, 0xFF0000);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: M68K memory access benchmark.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
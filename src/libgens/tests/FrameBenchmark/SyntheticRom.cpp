@@ -0,0 +1,671 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * SyntheticRom.cpp: Synthetic test ROM generator.                         *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * ROM layout:
+ * - $000000: Vector table.
+ * - $000100: ROM header.
+ * - $000200: Program code.
+ * - $004000: Data tables. (YM2612 register tables, Z80 program)
+ * - $008000: Pseudo-random data. (DMA source, Z80 bank reads)
+ */
+#define ROM_CODE_ADDR		0x0200
+#define ROM_YM_PART0_ADDR	0x4000
+#define ROM_YM_PART1_ADDR	0x4100
+#define ROM_YM_KEY_ADDR		0x4200
+#define ROM_Z80_PROG_ADDR	0x4800
+#define ROM_RANDOM_ADDR		0x8000
+
+SyntheticRom::SyntheticRom(RomType_t romType)
+	: m_romType(romType)
+	, m_rom((uint8_t*)malloc(ROM_SIZE))
+	, m_pc(ROM_CODE_ADDR)
+{
+	assert(romType >= ROM_SPRITES && romType < ROM_MAX);
+
+	// Unused areas are filled with 0xFF, like an erased EPROM.
+	memset(m_rom, 0xFF, ROM_SIZE);
+
+	// Pseudo-random data. (xorshift32)
+	uint32_t x = 0x2545F491;
+	for (unsigned int i = ROM_RANDOM_ADDR; i < ROM_SIZE; i++) {
+		x ^= (x << 13);
+		x ^= (x >> 17);
+		x ^= (x << 5);
+		m_rom[i] = (uint8_t)(x >> 24);
+	}
+
+	buildHeader();
+	buildInit();
+
+	switch (romType) {
+		case ROM_SPRITES:	buildSprites(); break;
+		case ROM_SCROLL:	buildScroll(); break;
+		case ROM_DMA:		buildDMA(); break;
+		case ROM_YM2612:	buildYM2612(); break;
+		case ROM_Z80:		buildZ80(); break;
+		case ROM_RASTER:	buildRaster(); break;
+		default:		assert(!"Invalid ROM type."); break;
+	}
+
+	// Make sure the code didn't overflow into the data tables.
+	assert(m_pc <= ROM_YM_PART0_ADDR);
+}
+
+SyntheticRom::~SyntheticRom()
+{
+	free(m_rom);
+}
+
+/**
+ * Get the name of a ROM type.
+ * @param romType ROM type.
+ * @return ROM type name. (ASCII)
+ */
+const char *SyntheticRom::RomTypeName(RomType_t romType)
+{
+	static const char *const names[ROM_MAX] = {
+		"Sprites", "Scroll", "DMA", "YM2612", "Z80", "Raster"
+	};
+
+	assert(romType >= ROM_SPRITES && romType < ROM_MAX);
+	return names[romType];
+}
+
+/** Code emitters. **/
+
+/**
+ * Write a big-endian word at the current code address.
+ * @param w Word.
+ */
+void SyntheticRom::w16(uint16_t w)
+{
+	m_rom[m_pc++] = (w >> 8) & 0xFF;
+	m_rom[m_pc++] = w & 0xFF;
+}
+
+/**
+ * Write a big-endian longword at the current code address.
+ * @param l Longword.
+ */
+void SyntheticRom::w32(uint32_t l)
+{
+	w16(l >> 16);
+	w16(l & 0xFFFF);
+}
+
+/**
+ * Emit a Bcc instruction.
+ * Bcc.S is used if the target is in range; otherwise, Bcc.W is used.
+ * @param opcode Bcc opcode with a zero displacement. (e.g. 0x6600 for BNE)
+ * @param target Target address.
+ */
+void SyntheticRom::bcc_s(uint16_t opcode, unsigned int target)
+{
+	const int disp = (int)target - (int)(m_pc + 2);
+	if (disp >= -128 && disp <= 127 && disp != 0) {
+		w16(opcode | (disp & 0xFF));
+	} else {
+		w16(opcode);
+		w16((uint16_t)disp);
+	}
+}
+
+/**
+ * Emit a DBF instruction.
+ * @param dn Data register.
+ * @param target Target address.
+ */
+void SyntheticRom::dbf(int dn, unsigned int target)
+{
+	const int disp = (int)target - (int)(m_pc + 2);
+	w16(0x51C8 | dn);
+	w16((uint16_t)disp);
+}
+
+/**
+ * Emit a VDP register write. (move.w #$8000|(reg<<8)|val,(a0))
+ * @param reg VDP register.
+ * @param val Register value.
+ */
+void SyntheticRom::vdpReg(uint8_t reg, uint8_t val)
+{
+	w16(0x30BC);
+	w16(0x8000 | (reg << 8) | val);
+}
+
+/**
+ * Emit a VDP control port longword write. (move.l #ctrl,(a0))
+ * @param ctrl Control word.
+ */
+void SyntheticRom::vdpCtrl(uint32_t ctrl)
+{
+	w16(0x20BC);
+	w32(ctrl);
+}
+
+/**
+ * Emit a loop that writes pseudo-random words to the VDP data port.
+ * The VDP address must have been set up beforehand.
+ * Uses d2; d5 and d6 hold the generator state.
+ * @param count Number of words to write.
+ */
+void SyntheticRom::vdpFillRandom(unsigned int count)
+{
+	assert(count > 0 && count <= 0x10000);
+	w16(0x343C); w16(count - 1);	// move.w #count-1,d2
+	const unsigned int loop = m_pc;
+	w16(0x3285);			// move.w d5,(a1)
+	w16(0xDA46);			// add.w d6,d5
+	w16(0xE75E);			// rol.w #3,d6
+	w16(0xBB46);			// eor.w d5,d6
+	dbf(2, loop);			// dbf d2,loop
+}
+
+/**
+ * Emit a loop that waits for the start of VBlank.
+ * Uses d7.
+ */
+void SyntheticRom::waitVBlank(void)
+{
+	// Wait for the current VBlank to end.
+	const unsigned int loop1 = m_pc;
+	w16(0x3E10);			// move.w (a0),d7
+	w16(0x0807); w16(0x0003);	// btst #3,d7
+	bcc_s(0x6600, loop1);		// bne.s loop1
+
+	// Wait for the next VBlank to start.
+	const unsigned int loop2 = m_pc;
+	w16(0x3E10);			// move.w (a0),d7
+	w16(0x0807); w16(0x0003);	// btst #3,d7
+	bcc_s(0x6700, loop2);		// beq.s loop2
+}
+
+/**
+ * Emit a loop that waits for a VDP DMA operation to finish.
+ * Uses d7.
+ */
+void SyntheticRom::waitDMA(void)
+{
+	const unsigned int loop = m_pc;
+	w16(0x3E10);			// move.w (a0),d7
+	w16(0x0807); w16(0x0001);	// btst #1,d7
+	bcc_s(0x6600, loop);		// bne.s loop
+}
+
+/**
+ * Emit a loop that waits for the start of HBlank.
+ * Uses d7.
+ */
+void SyntheticRom::waitHBlank(void)
+{
+	// Wait for the current HBlank to end.
+	const unsigned int loop1 = m_pc;
+	w16(0x3E10);			// move.w (a0),d7
+	w16(0x0807); w16(0x0002);	// btst #2,d7
+	bcc_s(0x6600, loop1);		// bne.s loop1
+
+	// Wait for the next HBlank to start.
+	const unsigned int loop2 = m_pc;
+	w16(0x3E10);			// move.w (a0),d7
+	w16(0x0807); w16(0x0002);	// btst #2,d7
+	bcc_s(0x6700, loop2);		// beq.s loop2
+}
+
+/**
+ * Emit a loop that copies a block of bytes from ROM to
+ * the Z80 address space. (68000 must own the Z80 bus.)
+ * Uses d2, a2, and a3.
+ * @param src ROM address of the data.
+ * @param z80addr Z80 address.
+ * @param len Length, in bytes.
+ */
+void SyntheticRom::copyToZ80(unsigned int src, uint16_t z80addr, unsigned int len)
+{
+	w16(0x45F9); w32(src);			// lea src,a2
+	w16(0x47F9); w32(0xA00000 | z80addr);	// lea $A00000+z80addr,a3
+	w16(0x343C); w16(len - 1);		// move.w #len-1,d2
+	const unsigned int loop = m_pc;
+	w16(0x16DA);				// move.b (a2)+,(a3)+
+	dbf(2, loop);				// dbf d2,loop
+}
+
+/**
+ * Emit a loop that writes a table of YM2612 registers.
+ * Table entries are two bytes: register, value.
+ * Uses d2, a2, and a3. a3 is left pointing to the YM2612 part.
+ * @param part YM2612 part. (0 or 1)
+ * @param table ROM address of the table.
+ * @param count Number of table entries.
+ */
+void SyntheticRom::ymWriteTable(int part, unsigned int table, unsigned int count)
+{
+	w16(0x45F9); w32(table);		// lea table,a2
+	w16(0x47F9); w32(0xA04000 + (part * 2));// lea $A04000+(part*2),a3
+	w16(0x343C); w16(count - 1);		// move.w #count-1,d2
+	const unsigned int loop = m_pc;
+	w16(0x169A);				// move.b (a2)+,(a3)
+	w16(0x175A); w16(0x0001);		// move.b (a2)+,1(a3)
+	dbf(2, loop);				// dbf d2,loop
+}
+
+/** ROM builders. **/
+
+/**
+ * Build the vector table and ROM header.
+ */
+void SyntheticRom::buildHeader(void)
+{
+	// Vector table: initial SSP and PC.
+	// The remaining vectors point to an infinite loop
+	// at the end of the header area.
+	static const uint8_t vectors[8] = {
+		0x00, 0xFF, 0xFE, 0x00,	// SSP: $FFFE00
+		0x00, 0x00, 0x02, 0x00,	// PC:  $000200
+	};
+	memcpy(&m_rom[0x000], vectors, sizeof(vectors));
+	for (unsigned int i = 8; i < 0x100; i += 4) {
+		m_rom[i+0] = 0x00;
+		m_rom[i+1] = 0x00;
+		m_rom[i+2] = 0x01;
+		m_rom[i+3] = 0xFE;
+	}
+
+	// ROM header.
+	memset(&m_rom[0x100], ' ', 0x100);
+	static const char sysName[] = "SEGA MEGA DRIVE ";
+	memcpy(&m_rom[0x100], sysName, sizeof(sysName)-1);
+	static const char romName[] = "GENS/GS II SYNTHETIC BENCHMARK";
+	memcpy(&m_rom[0x120], romName, sizeof(romName)-1);
+	memcpy(&m_rom[0x150], romName, sizeof(romName)-1);
+	m_rom[0x1F0] = 'U';
+
+	// Exception handler: bra.s *
+	m_rom[0x1FE] = 0x60;
+	m_rom[0x1FF] = 0xFE;
+}
+
+/**
+ * Build the common initialization code.
+ * - a0: VDP control port.
+ * - a1: VDP data port.
+ * - d0: Frame counter.
+ */
+void SyntheticRom::buildInit(void)
+{
+	m_pc = ROM_CODE_ADDR;
+	w16(0x46FC); w16(0x2700);	// move.w #$2700,sr
+	w16(0x41F9); w32(0xC00004);	// lea $C00004,a0
+	w16(0x43F9); w32(0xC00000);	// lea $C00000,a1
+	w16(0x7000);			// moveq #0,d0
+	w16(0x3A3C); w16(0x1234);	// move.w #$1234,d5
+	w16(0x3C3C); w16(0xACE1);	// move.w #$ACE1,d6
+
+	// VDP registers.
+	vdpReg(0x00, 0x04);	// HInt off
+	vdpReg(0x01, 0x54);	// Display on, VInt off, DMA on, Mode 5
+	vdpReg(0x02, 0x30);	// Scroll A: $C000
+	vdpReg(0x03, 0x34);	// Window: $D000
+	vdpReg(0x04, 0x07);	// Scroll B: $E000
+	vdpReg(0x05, 0x78);	// Sprites: $F000
+	vdpReg(0x07, 0x00);	// Background color
+	vdpReg(0x0B, 0x00);	// Full-screen scrolling
+	vdpReg(0x0C, 0x81);	// H40
+	vdpReg(0x0D, 0x3F);	// HScroll: $FC00
+	vdpReg(0x0F, 0x02);	// Auto-increment: 2
+	vdpReg(0x10, 0x01);	// Scroll size: 64x32
+	vdpReg(0x11, 0x00);	// Window H position
+	vdpReg(0x12, 0x00);	// Window V position
+
+	// Fill VRAM, CRAM, and VSRAM with pseudo-random data.
+	vdpCtrl(0x40000000);
+	vdpFillRandom(0x8000);
+	vdpCtrl(0xC0000000);
+	vdpFillRandom(64);
+	vdpCtrl(0x40000010);
+	vdpFillRandom(40);
+}
+
+/**
+ * Sprite-heavy ROM.
+ * Rewrites 80 32x32 sprites every frame. The sprites are
+ * packed vertically so the per-line sprite and dot limits
+ * are reached on most lines.
+ */
+void SyntheticRom::buildSprites(void)
+{
+	const unsigned int frame = m_pc;
+	waitVBlank();
+
+	vdpCtrl(0x70000003);		// VRAM write: $F000
+	w16(0x7600);			// moveq #0,d3
+	w16(0x343C); w16(79);		// move.w #79,d2
+	const unsigned int loop = m_pc;
+
+	// Y position: ((d3 * 2) + d0) & 0xFF) + 128
+	w16(0x3803);			// move.w d3,d4
+	w16(0xE34C);			// lsl.w #1,d4
+	w16(0xD840);			// add.w d0,d4
+	w16(0x0244); w16(0x00FF);	// andi.w #$FF,d4
+	w16(0x0644); w16(0x0080);	// addi.w #$80,d4
+	w16(0x3284);			// move.w d4,(a1)
+
+	// Size: 4x4; Link: d3 + 1, or 0 for the last sprite.
+	w16(0x3803);			// move.w d3,d4
+	w16(0x5244);			// addq.w #1,d4
+	w16(0x0C44); w16(80);		// cmpi.w #80,d4
+	w16(0x6602);			// bne.s +2
+	w16(0x7800);			// moveq #0,d4
+	w16(0x0044); w16(0x0F00);	// ori.w #$0F00,d4
+	w16(0x3284);			// move.w d4,(a1)
+
+	// Tile: d3 * 16
+	w16(0x3803);			// move.w d3,d4
+	w16(0xE94C);			// lsl.w #4,d4
+	w16(0x3284);			// move.w d4,(a1)
+
+	// X position: ((d3 * 8) - d0) & 0x1FF
+	w16(0x3803);			// move.w d3,d4
+	w16(0xE74C);			// lsl.w #3,d4
+	w16(0x9840);			// sub.w d0,d4
+	w16(0x0244); w16(0x01FF);	// andi.w #$1FF,d4
+	w16(0x3284);			// move.w d4,(a1)
+
+	w16(0x5243);			// addq.w #1,d3
+	dbf(2, loop);			// dbf d2,loop
+
+	w16(0x5240);			// addq.w #1,d0
+	bcc_s(0x6000, frame);		// bra frame
+}
+
+/**
+ * Scroll-heavy ROM.
+ * Per-line horizontal scrolling and 2-cell vertical scrolling,
+ * with both tables rewritten every frame.
+ */
+void SyntheticRom::buildScroll(void)
+{
+	vdpReg(0x0B, 0x07);		// Line HScroll, 2-cell VScroll
+
+	const unsigned int frame = m_pc;
+	waitVBlank();
+
+	// HScroll table.
+	vdpCtrl(0x7C000003);		// VRAM write: $FC00
+	w16(0x7600);			// moveq #0,d3
+	w16(0x343C); w16(223);		// move.w #223,d2
+	const unsigned int hloop = m_pc;
+	w16(0x3803);			// move.w d3,d4
+	w16(0xD840);			// add.w d0,d4
+	w16(0x3284);			// move.w d4,(a1)
+	w16(0x3800);			// move.w d0,d4
+	w16(0x9843);			// sub.w d3,d4
+	w16(0x3284);			// move.w d4,(a1)
+	w16(0x5243);			// addq.w #1,d3
+	dbf(2, hloop);			// dbf d2,hloop
+
+	// VScroll table.
+	vdpCtrl(0x40000010);		// VSRAM write: $00
+	w16(0x7600);			// moveq #0,d3
+	w16(0x343C); w16(39);		// move.w #39,d2
+	const unsigned int vloop = m_pc;
+	w16(0x3803);			// move.w d3,d4
+	w16(0xE54C);			// lsl.w #2,d4
+	w16(0xD840);			// add.w d0,d4
+	w16(0x3284);			// move.w d4,(a1)
+	w16(0x5243);			// addq.w #1,d3
+	dbf(2, vloop);			// dbf d2,vloop
+
+	w16(0x5240);			// addq.w #1,d0
+	bcc_s(0x6000, frame);		// bra frame
+}
+
+/**
+ * DMA-heavy ROM.
+ * Every frame: 4 KB 68K->VRAM, 128 bytes 68K->CRAM,
+ * 2 KB VRAM fill, and 2 KB VRAM copy. This is about
+ * as much DMA as fits in the NTSC VBlank period.
+ */
+void SyntheticRom::buildDMA(void)
+{
+	const unsigned int frame = m_pc;
+	waitVBlank();
+
+	// 68K->VRAM: 2,048 words from ROM_RANDOM_ADDR to VRAM $0000.
+	vdpReg(0x13, 0x00);
+	vdpReg(0x14, 0x08);
+	vdpReg(0x15, (ROM_RANDOM_ADDR >> 1) & 0xFF);
+	vdpReg(0x16, (ROM_RANDOM_ADDR >> 9) & 0xFF);
+	vdpReg(0x17, (ROM_RANDOM_ADDR >> 17) & 0x7F);
+	vdpCtrl(0x40000080);
+
+	// 68K->CRAM: 64 words from ROM_RANDOM_ADDR+$4000 to CRAM $00.
+	vdpReg(0x13, 0x40);
+	vdpReg(0x14, 0x00);
+	vdpReg(0x15, ((ROM_RANDOM_ADDR + 0x4000) >> 1) & 0xFF);
+	vdpReg(0x16, ((ROM_RANDOM_ADDR + 0x4000) >> 9) & 0xFF);
+	vdpReg(0x17, ((ROM_RANDOM_ADDR + 0x4000) >> 17) & 0x7F);
+	vdpCtrl(0xC0000080);
+
+	// VRAM fill: 2 KB at $8000, using the frame counter.
+	// NOTE: VRAM fill uses the high byte of the data word.
+	vdpReg(0x0F, 0x01);
+	vdpReg(0x13, 0x00);
+	vdpReg(0x14, 0x08);
+	vdpReg(0x17, 0x80);
+	vdpCtrl(0x40000082);
+	w16(0x3800);			// move.w d0,d4
+	w16(0xE15C);			// rol.w #8,d4
+	w16(0x3284);			// move.w d4,(a1)
+	waitDMA();
+
+	// VRAM copy: 2 KB from $8000 to $C000.
+	vdpReg(0x13, 0x00);
+	vdpReg(0x14, 0x08);
+	vdpReg(0x15, 0x00);
+	vdpReg(0x16, 0x80);
+	vdpReg(0x17, 0xC0);
+	vdpCtrl(0x000000C3);
+	waitDMA();
+	vdpReg(0x0F, 0x02);
+
+	w16(0x5240);			// addq.w #1,d0
+	bcc_s(0x6000, frame);		// bra frame
+}
+
+/**
+ * YM2612-heavy ROM.
+ * Every frame, all six FM channels are fully reprogrammed
+ * and keyed off/on, and the channel 0 frequency is changed.
+ */
+void SyntheticRom::buildYM2612(void)
+{
+	// Operator register values. (DT/MUL, TL, RS/AR, AM/D1R, D2R, D1L/RR, SSG-EG)
+	static const uint8_t opRegs[7][2] = {
+		{0x30, 0x71}, {0x40, 0x10}, {0x50, 0x1F}, {0x60, 0x0A},
+		{0x70, 0x05}, {0x80, 0x2F}, {0x90, 0x00},
+	};
+	// Channel register values. (FB/ALG, L/R/AMS/FMS, Freq MSB, Freq LSB)
+	static const uint8_t chRegs[4][2] = {
+		{0xB0, 0x32}, {0xB4, 0xC0}, {0xA4, 0x22}, {0xA0, 0x69},
+	};
+
+	// Build the register tables.
+	unsigned int count[2];
+	for (int part = 0; part < 2; part++) {
+		uint8_t *p = &m_rom[part == 0 ? ROM_YM_PART0_ADDR : ROM_YM_PART1_ADDR];
+		uint8_t *const start = p;
+		if (part == 0) {
+			// Global registers: LFO off, Ch3 normal mode, DAC off.
+			*p++ = 0x22; *p++ = 0x00;
+			*p++ = 0x27; *p++ = 0x00;
+			*p++ = 0x2B; *p++ = 0x00;
+		}
+		for (int ch = 0; ch < 3; ch++) {
+			for (int op = 0; op < 4; op++) {
+				for (int r = 0; r < 7; r++) {
+					*p++ = opRegs[r][0] + (op * 4) + ch;
+					*p++ = opRegs[r][1] + (op * 4);
+				}
+			}
+			for (int r = 0; r < 4; r++) {
+				*p++ = chRegs[r][0] + ch;
+				*p++ = chRegs[r][1];
+			}
+		}
+		count[part] = (unsigned int)(p - start) / 2;
+	}
+
+	// Key off, then key on, all six channels.
+	static const uint8_t keyChannels[6] = {0, 1, 2, 4, 5, 6};
+	uint8_t *p = &m_rom[ROM_YM_KEY_ADDR];
+	for (int on = 0; on < 2; on++) {
+		for (int ch = 0; ch < 6; ch++) {
+			*p++ = 0x28;
+			*p++ = (on ? 0xF0 : 0x00) | keyChannels[ch];
+		}
+	}
+
+	// Release the Z80 reset so the YM2612 is active.
+	// The 68000 keeps the Z80 bus, so the Z80 never runs.
+	w16(0x33FC); w16(0x0100); w32(0xA11200);	// move.w #$0100,$A11200
+
+	const unsigned int frame = m_pc;
+	waitVBlank();
+
+	ymWriteTable(0, ROM_YM_PART0_ADDR, count[0]);
+	ymWriteTable(1, ROM_YM_PART1_ADDR, count[1]);
+	ymWriteTable(0, ROM_YM_KEY_ADDR, 12);
+
+	// Channel 0 frequency LSB: frame counter.
+	w16(0x16BC); w16(0x00A0);	// move.b #$A0,(a3)
+	w16(0x1740); w16(0x0001);	// move.b d0,1(a3)
+
+	w16(0x5240);			// addq.w #1,d0
+	bcc_s(0x6000, frame);		// bra frame
+}
+
+/**
+ * Z80-heavy ROM.
+ * The Z80 runs a tight loop that streams RAM data to the
+ * YM2612 DAC and PSG while reading from the 68000 bank.
+ * The 68000 only waits for VBlank.
+ */
+void SyntheticRom::buildZ80(void)
+{
+	static const uint8_t z80prog[] = {
+		0xF3,			// 0000: di
+		0x31, 0x00, 0x20,	// 0001: ld sp,$2000
+		0x21, 0x00, 0x40,	// 0004: ld hl,$4000
+		0x36, 0x2B,		// 0007: ld (hl),$2B
+		0x23,			// 0009: inc hl
+		0x36, 0x80,		// 000A: ld (hl),$80	; DAC on
+		0x2B,			// 000C: dec hl
+		0x36, 0x2A,		// 000D: ld (hl),$2A	; DAC data
+		0x11, 0x00, 0x10,	// 000F: ld de,$1000
+		0x0E, 0x00,		// 0012: ld c,0
+		// loop:
+		0x1A,			// 0014: ld a,(de)
+		0x81,			// 0015: add a,c
+		0x4F,			// 0016: ld c,a
+		0x32, 0x01, 0x40,	// 0017: ld ($4001),a
+		0xE6, 0x0F,		// 001A: and $0F
+		0xF6, 0x90,		// 001C: or $90	; PSG ch0 volume
+		0x32, 0x11, 0x7F,	// 001E: ld ($7F11),a
+		0x3A, 0x00, 0x80,	// 0021: ld a,($8000)
+		0x81,			// 0024: add a,c
+		0x4F,			// 0025: ld c,a
+		0x13,			// 0026: inc de
+		0x7A,			// 0027: ld a,d
+		0xE6, 0x17,		// 0028: and $17	; de = $1000-$17FF
+		0x57,			// 002A: ld d,a
+		0xC3, 0x14, 0x00,	// 002B: jp loop
+	};
+	memcpy(&m_rom[ROM_Z80_PROG_ADDR], z80prog, sizeof(z80prog));
+
+	// Release the Z80 reset. The 68000 still has the bus.
+	w16(0x33FC); w16(0x0100); w32(0xA11200);	// move.w #$0100,$A11200
+
+	// Load the Z80 program and 2 KB of data.
+	copyToZ80(ROM_Z80_PROG_ADDR, 0x0000, sizeof(z80prog));
+	copyToZ80(ROM_RANDOM_ADDR, 0x1000, 0x800);
+
+	// Release the Z80 bus.
+	w16(0x33FC); w16(0x0000); w32(0xA11100);	// move.w #$0000,$A11100
+
+	const unsigned int frame = m_pc;
+	waitVBlank();
+
+	// Background color: frame counter.
+	vdpCtrl(0xC0000000);		// CRAM write: $00
+	w16(0x3280);			// move.w d0,(a1)
+
+	w16(0x5240);			// addq.w #1,d0
+	bcc_s(0x6000, frame);		// bra frame
+}
+
+/**
+ * Raster palette ROM.
+ * Two colors in palette line 0 are rewritten during
+ * every HBlank in the active display area, like the
+ * gradient and water effects used in many games.
+ */
+void SyntheticRom::buildRaster(void)
+{
+	const unsigned int frame = m_pc;
+	waitVBlank();
+
+	// Wait for VBlank to end.
+	const unsigned int vloop = m_pc;
+	w16(0x3E10);			// move.w (a0),d7
+	w16(0x0807); w16(0x0003);	// btst #3,d7
+	bcc_s(0x6600, vloop);		// bne.s vloop
+
+	w16(0x7600);			// moveq #0,d3
+	w16(0x343C); w16(223);		// move.w #223,d2
+	const unsigned int line = m_pc;
+	waitHBlank();
+
+	// Colors 1 and 2: (d3 + d0), then shifted left by 3.
+	vdpCtrl(0xC0020000);		// CRAM write: $02
+	w16(0x3803);			// move.w d3,d4
+	w16(0xD840);			// add.w d0,d4
+	w16(0x3284);			// move.w d4,(a1)
+	w16(0xE74C);			// lsl.w #3,d4
+	w16(0x3284);			// move.w d4,(a1)
+
+	w16(0x5243);			// addq.w #1,d3
+	dbf(2, line);			// dbf d2,line
+
+	w16(0x5240);			// addq.w #1,d0
+	bcc_s(0x6000, frame);		// bra frame
+}
+
+} }
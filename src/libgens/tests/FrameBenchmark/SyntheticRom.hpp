@@ -0,0 +1,197 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * SyntheticRom.hpp: Synthetic test ROM generator.                         *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#ifndef __LIBGENS_TESTS_FRAMEBENCHMARK_SYNTHETICROM_HPP__
+#define __LIBGENS_TESTS_FRAMEBENCHMARK_SYNTHETICROM_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Synthetic test ROM generator.
+ *
+ * Each ROM initializes the VDP in Mode 5 (H40), fills VRAM/CRAM/VSRAM
+ * with pseudo-random data, and then runs a per-frame workload that
+ * stresses one emulation subsystem. Frames are paced by polling the
+ * VDP's VBlank status bit, so no interrupts are used.
+ *
+ * The generated ROMs are deterministic and self-contained;
+ * no external ROM images are needed for benchmarking.
+ */
+class SyntheticRom
+{
+	public:
+		enum RomType_t {
+			ROM_SPRITES	= 0,	// 80 large sprites, updated every frame.
+			ROM_SCROLL	= 1,	// Per-line HScroll and 2-cell VScroll.
+			ROM_DMA		= 2,	// 68K->VRAM/CRAM DMA, VRAM fill, VRAM copy.
+			ROM_YM2612	= 3,	// Rewrite all YM2612 registers every frame.
+			ROM_Z80		= 4,	// Z80 running a DAC/PSG loop.
+			ROM_RASTER	= 5,	// Per-line CRAM writes. (raster palette effects)
+
+			ROM_MAX
+		};
+
+		SyntheticRom(RomType_t romType);
+		~SyntheticRom();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		SyntheticRom(const SyntheticRom &);
+		SyntheticRom &operator=(const SyntheticRom &);
+
+	public:
+		// ROM size. (64 KB)
+		static const unsigned int ROM_SIZE = 0x10000;
+
+		/**
+		 * Get the ROM type.
+		 * @return ROM type.
+		 */
+		inline RomType_t romType(void) const
+			{ return m_romType; }
+
+		/**
+		 * Get the ROM image.
+		 * @return ROM image. (ROM_SIZE bytes)
+		 */
+		inline const uint8_t *data(void) const
+			{ return m_rom; }
+
+		/**
+		 * Get the ROM image size.
+		 * @return ROM image size.
+		 */
+		inline unsigned int size(void) const
+			{ return ROM_SIZE; }
+
+		/**
+		 * Get the name of a ROM type.
+		 * @param romType ROM type.
+		 * @return ROM type name. (ASCII)
+		 */
+		static const char *RomTypeName(RomType_t romType);
+
+	protected:
+		RomType_t m_romType;
+		uint8_t *m_rom;
+
+		// Current code address.
+		unsigned int m_pc;
+
+		/** Code emitters. **/
+
+		/**
+		 * Write a big-endian word at the current code address.
+		 * @param w Word.
+		 */
+		void w16(uint16_t w);
+
+		/**
+		 * Write a big-endian longword at the current code address.
+		 * @param l Longword.
+		 */
+		void w32(uint32_t l);
+
+		/**
+		 * Emit a Bcc.S instruction.
+		 * @param opcode Bcc opcode with a zero displacement. (e.g. 0x6600 for BNE)
+		 * @param target Target address.
+		 */
+		void bcc_s(uint16_t opcode, unsigned int target);
+
+		/**
+		 * Emit a DBF instruction.
+		 * @param dn Data register.
+		 * @param target Target address.
+		 */
+		void dbf(int dn, unsigned int target);
+
+		/**
+		 * Emit a VDP register write. (move.w #$8000|(reg<<8)|val,(a0))
+		 * @param reg VDP register.
+		 * @param val Register value.
+		 */
+		void vdpReg(uint8_t reg, uint8_t val);
+
+		/**
+		 * Emit a VDP control port longword write. (move.l #ctrl,(a0))
+		 * @param ctrl Control word.
+		 */
+		void vdpCtrl(uint32_t ctrl);
+
+		/**
+		 * Emit a loop that writes pseudo-random words to the VDP data port.
+		 * The VDP address must have been set up beforehand.
+		 * @param count Number of words to write.
+		 */
+		void vdpFillRandom(unsigned int count);
+
+		/**
+		 * Emit a loop that waits for the start of VBlank.
+		 */
+		void waitVBlank(void);
+
+		/**
+		 * Emit a loop that waits for a VDP DMA operation to finish.
+		 */
+		void waitDMA(void);
+
+		/**
+		 * Emit a loop that waits for the start of HBlank.
+		 */
+		void waitHBlank(void);
+
+		/**
+		 * Emit a loop that copies a block of bytes from ROM to
+		 * the Z80 address space. (68000 must own the Z80 bus.)
+		 * @param src ROM address of the data.
+		 * @param z80addr Z80 address.
+		 * @param len Length, in bytes.
+		 */
+		void copyToZ80(unsigned int src, uint16_t z80addr, unsigned int len);
+
+		/**
+		 * Emit a loop that writes a table of YM2612 registers.
+		 * Table entries are two bytes: register, value.
+		 * @param part YM2612 part. (0 or 1)
+		 * @param table ROM address of the table.
+		 * @param count Number of table entries.
+		 */
+		void ymWriteTable(int part, unsigned int table, unsigned int count);
+
+		/** ROM builders. **/
+		void buildHeader(void);
+		void buildInit(void);
+		void buildSprites(void);
+		void buildScroll(void);
+		void buildDMA(void);
+		void buildYM2612(void);
+		void buildZ80(void);
+		void buildRaster(void);
+};
+
+} }
+
+#endif /* __LIBGENS_TESTS_FRAMEBENCHMARK_SYNTHETICROM_HPP__ */
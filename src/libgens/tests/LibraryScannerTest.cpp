@@ -0,0 +1,531 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * LibraryScannerTest.cpp: ROM library scanner tests.                      *
+ *                                                                         *
+ * Copyright (c) 2016 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "libgensfile/LibraryScanner.hpp"
+using LibGensFile::LibraryScanner;
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// ZLib. (for gzopen() and crc32())
+#include <zlib.h>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * ROM library scanner tests.
+ *
+ * A small directory tree is created with plain and
+ * gzipped synthetic ROMs, plus a file that should be
+ * ignored. Rom::IdentifyHeader() is used to identify
+ * the ROMs.
+ */
+class LibraryScannerTest : public ::testing::Test
+{
+	protected:
+		LibraryScannerTest()
+			: ::testing::Test() { }
+		virtual ~LibraryScannerTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Temporary directory tree.
+		string m_root;
+		string m_subdir;
+		string m_indexFilename;
+
+		// Files in the directory tree.
+		string m_binFilename;	// ROM_SPRITES, plain binary.
+		string m_genFilename;	// ROM_SCROLL, plain binary. (in subdir)
+		string m_gzFilename;	// ROM_DMA, gzipped.
+		string m_txtFilename;	// Not a ROM; should be ignored.
+
+		/**
+		 * Write a synthetic ROM to a file.
+		 * @param filename Filename.
+		 * @param romType Synthetic ROM type.
+		 * @param gzip If true, compress the ROM with gzip.
+		 * @param extra Number of extra zero bytes to append.
+		 */
+		void writeRom(const string &filename, SyntheticRom::RomType_t romType,
+			      bool gzip, unsigned int extra = 0);
+
+		/**
+		 * Check an indexed file against a synthetic ROM.
+		 * @param scanner Library scanner.
+		 * @param filename Filename.
+		 * @param romType Synthetic ROM type.
+		 */
+		void checkFile(const LibraryScanner &scanner, const string &filename,
+			       SyntheticRom::RomType_t romType);
+
+		/**
+		 * Compare two indexes.
+		 * @param a First index.
+		 * @param b Second index.
+		 */
+		void compareIndex(const LibraryScanner &a, const LibraryScanner &b);
+};
+
+/**
+ * Set up the test.
+ */
+void LibraryScannerTest::SetUp(void)
+{
+	m_root = "LibraryScannerTest.tmp";
+	m_subdir = m_root + "/sub";
+	m_indexFilename = "LibraryScannerTest.idx";
+	m_binFilename = m_root + "/sprites.bin";
+	m_genFilename = m_subdir + "/scroll.gen";
+	m_gzFilename = m_root + "/dma.gz";
+	m_txtFilename = m_root + "/readme.txt";
+
+	ASSERT_EQ(0, mkdir(m_root.c_str(), 0755));
+	ASSERT_EQ(0, mkdir(m_subdir.c_str(), 0755));
+
+	writeRom(m_binFilename, SyntheticRom::ROM_SPRITES, false);
+	writeRom(m_genFilename, SyntheticRom::ROM_SCROLL, false);
+	writeRom(m_gzFilename, SyntheticRom::ROM_DMA, true);
+
+	FILE *f = fopen(m_txtFilename.c_str(), "w");
+	ASSERT_TRUE(f != nullptr);
+	fputs("Not a ROM image.\n", f);
+	fclose(f);
+}
+
+/**
+ * Tear down the test.
+ */
+void LibraryScannerTest::TearDown(void)
+{
+	remove(m_binFilename.c_str());
+	remove(m_genFilename.c_str());
+	remove(m_gzFilename.c_str());
+	remove(m_txtFilename.c_str());
+	rmdir(m_subdir.c_str());
+	rmdir(m_root.c_str());
+	remove(m_indexFilename.c_str());
+}
+
+/**
+ * Write a synthetic ROM to a file.
+ * @param filename Filename.
+ * @param romType Synthetic ROM type.
+ * @param gzip If true, compress the ROM with gzip.
+ * @param extra Number of extra zero bytes to append.
+ */
+void LibraryScannerTest::writeRom(const string &filename, SyntheticRom::RomType_t romType,
+				  bool gzip, unsigned int extra)
+{
+	SyntheticRom synthRom(romType);
+	vector<uint8_t> data(synthRom.data(), synthRom.data() + synthRom.size());
+	data.resize(data.size() + extra);
+
+	if (gzip) {
+		gzFile gzf = gzopen(filename.c_str(), "wb");
+		ASSERT_TRUE(gzf != nullptr);
+		EXPECT_EQ((int)data.size(), gzwrite(gzf, data.data(), (unsigned int)data.size()));
+		gzclose(gzf);
+	} else {
+		FILE *f = fopen(filename.c_str(), "wb");
+		ASSERT_TRUE(f != nullptr);
+		EXPECT_EQ(data.size(), fwrite(data.data(), 1, data.size(), f));
+		fclose(f);
+	}
+}
+
+/**
+ * Check an indexed file against a synthetic ROM.
+ * @param scanner Library scanner.
+ * @param filename Filename.
+ * @param romType Synthetic ROM type.
+ */
+void LibraryScannerTest::checkFile(const LibraryScanner &scanner, const string &filename,
+				   SyntheticRom::RomType_t romType)
+{
+	const LibraryScanner::File *file = scanner.findFile(filename);
+	ASSERT_TRUE(file != nullptr) << "File not indexed: " << filename;
+	EXPECT_EQ(0, file->error);
+	ASSERT_EQ(1U, file->entries.size());
+
+	SyntheticRom synthRom(romType);
+	const LibraryScanner::Entry &entry = file->entries[0];
+	EXPECT_EQ((int64_t)synthRom.size(), entry.filesize);
+
+	// CRC32 must match zlib's crc32() of the entire ROM.
+	const uint32_t crc = (uint32_t)crc32(0, synthRom.data(), synthRom.size());
+	EXPECT_TRUE(entry.hasCrc32);
+	EXPECT_EQ(crc, entry.crc32);
+
+	// Header must match what Rom detects.
+	Rom rom(synthRom.data(), synthRom.size());
+	ASSERT_TRUE(entry.hasHeader);
+	EXPECT_EQ(Rom::MDP_SYSTEM_MD, entry.header.sysId);
+	EXPECT_EQ(Rom::RFMT_BINARY, entry.header.romFormat);
+	EXPECT_EQ(rom.regionCode(), entry.header.regionCode);
+	EXPECT_EQ(rom.checksum(), entry.header.checksum);
+	EXPECT_EQ(rom.romNameJP(), entry.header.romNameJP);
+	EXPECT_EQ(rom.romNameUS(), entry.header.romNameUS);
+	EXPECT_EQ(rom.rom_serial(), entry.header.serial);
+}
+
+/**
+ * Compare two indexes.
+ * @param a First index.
+ * @param b Second index.
+ */
+void LibraryScannerTest::compareIndex(const LibraryScanner &a, const LibraryScanner &b)
+{
+	const vector<LibraryScanner::File> &fa = a.files();
+	const vector<LibraryScanner::File> &fb = b.files();
+	ASSERT_EQ(fa.size(), fb.size());
+	for (size_t i = 0; i < fa.size(); i++) {
+		EXPECT_EQ(fa[i].filename, fb[i].filename);
+		EXPECT_EQ(fa[i].mtime, fb[i].mtime);
+		EXPECT_EQ(fa[i].size, fb[i].size);
+		EXPECT_EQ(fa[i].error, fb[i].error);
+		ASSERT_EQ(fa[i].entries.size(), fb[i].entries.size());
+		for (size_t j = 0; j < fa[i].entries.size(); j++) {
+			const LibraryScanner::Entry &ea = fa[i].entries[j];
+			const LibraryScanner::Entry &eb = fb[i].entries[j];
+			EXPECT_EQ(ea.z_filename, eb.z_filename);
+			EXPECT_EQ(ea.filesize, eb.filesize);
+			EXPECT_EQ(ea.crc32, eb.crc32);
+			EXPECT_EQ(ea.hasCrc32, eb.hasCrc32);
+			EXPECT_EQ(ea.hasHeader, eb.hasHeader);
+			EXPECT_EQ(ea.identified, eb.identified);
+			EXPECT_EQ(ea.header.sysId, eb.header.sysId);
+			EXPECT_EQ(ea.header.romFormat, eb.header.romFormat);
+			EXPECT_EQ(ea.header.regionCode, eb.header.regionCode);
+			EXPECT_EQ(ea.header.checksum, eb.header.checksum);
+			EXPECT_EQ(ea.header.romNameJP, eb.header.romNameJP);
+			EXPECT_EQ(ea.header.romNameUS, eb.header.romNameUS);
+			EXPECT_EQ(ea.header.serial, eb.header.serial);
+		}
+	}
+}
+
+/**
+ * Scan the directory tree.
+ */
+TEST_F(LibraryScannerTest, scan)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, scanner.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(3U, stats.files);
+	EXPECT_EQ(3U, stats.scanned);
+	EXPECT_EQ(0U, stats.unchanged);
+	EXPECT_EQ(0U, stats.removed);
+	EXPECT_EQ(0U, stats.errors);
+
+	EXPECT_EQ(3U, scanner.files().size());
+	EXPECT_TRUE(scanner.findFile(m_txtFilename) == nullptr);
+	checkFile(scanner, m_binFilename, SyntheticRom::ROM_SPRITES);
+	checkFile(scanner, m_genFilename, SyntheticRom::ROM_SCROLL);
+	checkFile(scanner, m_gzFilename, SyntheticRom::ROM_DMA);
+}
+
+/**
+ * Scan the directory tree with one thread and with four threads.
+ * Both scans must produce identical indexes.
+ */
+TEST_F(LibraryScannerTest, threadCount)
+{
+	LibraryScanner scanner1;
+	scanner1.setIdentifyFn(Rom::IdentifyHeader);
+	scanner1.setThreadCount(1);
+	ASSERT_EQ(0, scanner1.scan(m_root.c_str()));
+
+	LibraryScanner scanner4;
+	scanner4.setIdentifyFn(Rom::IdentifyHeader);
+	scanner4.setThreadCount(4);
+	ASSERT_EQ(0, scanner4.scan(m_root.c_str()));
+
+	compareIndex(scanner1, scanner4);
+}
+
+/**
+ * Scan the directory tree again without changing anything.
+ * No files should be scanned.
+ */
+TEST_F(LibraryScannerTest, rescanUnchanged)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, scanner.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(3U, stats.files);
+	EXPECT_EQ(0U, stats.scanned);
+	EXPECT_EQ(3U, stats.unchanged);
+	EXPECT_EQ(0U, stats.removed);
+	checkFile(scanner, m_binFilename, SyntheticRom::ROM_SPRITES);
+}
+
+/**
+ * Modify a file, then scan the directory tree again.
+ * Only the modified file should be scanned.
+ */
+TEST_F(LibraryScannerTest, rescanModified)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+
+	// Change the file size so the file is detected as
+	// modified even if the mtime doesn't change.
+	writeRom(m_binFilename, SyntheticRom::ROM_Z80, false, 16384);
+
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, scanner.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(3U, stats.files);
+	EXPECT_EQ(1U, stats.scanned);
+	EXPECT_EQ(2U, stats.unchanged);
+	EXPECT_EQ(0U, stats.removed);
+
+	const LibraryScanner::File *file = scanner.findFile(m_binFilename);
+	ASSERT_TRUE(file != nullptr);
+	ASSERT_EQ(1U, file->entries.size());
+	EXPECT_EQ((int64_t)(SyntheticRom::ROM_SIZE + 16384), file->entries[0].filesize);
+}
+
+/**
+ * Delete a file, then scan the directory tree again.
+ * The file should be removed from the index.
+ */
+TEST_F(LibraryScannerTest, rescanRemoved)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+
+	ASSERT_EQ(0, remove(m_genFilename.c_str()));
+
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, scanner.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(2U, stats.files);
+	EXPECT_EQ(0U, stats.scanned);
+	EXPECT_EQ(2U, stats.unchanged);
+	EXPECT_EQ(1U, stats.removed);
+	EXPECT_EQ(2U, scanner.files().size());
+	EXPECT_TRUE(scanner.findFile(m_genFilename) == nullptr);
+}
+
+/**
+ * Scan a subdirectory of an indexed tree.
+ * Indexed files outside of the subdirectory must be kept.
+ */
+TEST_F(LibraryScannerTest, rescanSubdir)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, scanner.scan((m_subdir + "/").c_str(), &stats));
+	EXPECT_EQ(1U, stats.files);
+	EXPECT_EQ(0U, stats.scanned);
+	EXPECT_EQ(1U, stats.unchanged);
+	EXPECT_EQ(0U, stats.removed);
+	EXPECT_EQ(3U, scanner.files().size());
+}
+
+/**
+ * Files indexed without an identify function
+ * are scanned again once one is set.
+ */
+TEST_F(LibraryScannerTest, rescanIdentify)
+{
+	LibraryScanner scanner;
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+	const LibraryScanner::File *file = scanner.findFile(m_binFilename);
+	ASSERT_TRUE(file != nullptr);
+	ASSERT_EQ(1U, file->entries.size());
+	EXPECT_TRUE(file->entries[0].hasCrc32);
+	EXPECT_FALSE(file->entries[0].hasHeader);
+
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, scanner.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(3U, stats.scanned);
+	EXPECT_EQ(0U, stats.unchanged);
+	checkFile(scanner, m_binFilename, SyntheticRom::ROM_SPRITES);
+}
+
+/**
+ * Files that can't be read or identified, e.g. empty or
+ * truncated files, shouldn't be scanned again if they
+ * haven't changed.
+ */
+TEST_F(LibraryScannerTest, rescanUnidentified)
+{
+	const string emptyFilename = m_root + "/empty.bin";
+	FILE *f = fopen(emptyFilename.c_str(), "wb");
+	ASSERT_TRUE(f != nullptr);
+	fclose(f);
+
+	// Truncate a gzipped ROM. The file list can be read,
+	// but the file can't be decompressed.
+	const string badFilename = m_root + "/truncated.gz";
+	writeRom(badFilename, SyntheticRom::ROM_DMA, true);
+	struct stat st;
+	ASSERT_EQ(0, stat(badFilename.c_str(), &st));
+	ASSERT_EQ(0, truncate(badFilename.c_str(), st.st_size / 2));
+
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	EXPECT_EQ(0, scanner.scan(m_root.c_str()));
+	const LibraryScanner::File *file = scanner.findFile(badFilename);
+	EXPECT_TRUE(file != nullptr);
+	if (file) {
+		EXPECT_NE(0, file->error);
+		for (size_t i = 0; i < file->entries.size(); i++) {
+			EXPECT_FALSE(file->entries[i].hasHeader);
+			EXPECT_TRUE(file->entries[i].identified);
+		}
+	}
+
+	LibraryScanner::Stats stats;
+	EXPECT_EQ(0, scanner.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(5U, stats.files);
+	EXPECT_EQ(0U, stats.scanned);
+	EXPECT_EQ(5U, stats.unchanged);
+
+	remove(emptyFilename.c_str());
+	remove(badFilename.c_str());
+}
+
+/**
+ * Files larger than maxCrcSize() only have their headers read.
+ * Smaller files still get a CRC32.
+ */
+TEST_F(LibraryScannerTest, maxCrcSize)
+{
+	// Make one ROM larger than the header.
+	writeRom(m_binFilename, SyntheticRom::ROM_SPRITES, false, 131072);
+
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	scanner.setMaxCrcSize(SyntheticRom::ROM_SIZE);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+
+	const vector<LibraryScanner::File> &files = scanner.files();
+	ASSERT_EQ(3U, files.size());
+	for (size_t i = 0; i < files.size(); i++) {
+		EXPECT_EQ(0, files[i].error);
+		ASSERT_EQ(1U, files[i].entries.size());
+		EXPECT_EQ(files[i].filename != m_binFilename, files[i].entries[0].hasCrc32);
+		EXPECT_TRUE(files[i].entries[0].hasHeader);
+		EXPECT_EQ(Rom::MDP_SYSTEM_MD, files[i].entries[0].header.sysId);
+	}
+}
+
+/**
+ * Save the index, then load it into another scanner.
+ * Loaded files shouldn't be scanned again.
+ */
+TEST_F(LibraryScannerTest, saveLoadIndex)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+	ASSERT_EQ(0, scanner.saveIndex(m_indexFilename.c_str()));
+
+	LibraryScanner loaded;
+	loaded.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, loaded.loadIndex(m_indexFilename.c_str()));
+	compareIndex(scanner, loaded);
+
+	LibraryScanner::Stats stats;
+	ASSERT_EQ(0, loaded.scan(m_root.c_str(), &stats));
+	EXPECT_EQ(0U, stats.scanned);
+	EXPECT_EQ(3U, stats.unchanged);
+	compareIndex(scanner, loaded);
+}
+
+/**
+ * Load a truncated index.
+ * The load should fail, and the current index shouldn't change.
+ */
+TEST_F(LibraryScannerTest, loadTruncatedIndex)
+{
+	LibraryScanner scanner;
+	scanner.setIdentifyFn(Rom::IdentifyHeader);
+	ASSERT_EQ(0, scanner.scan(m_root.c_str()));
+	ASSERT_EQ(0, scanner.saveIndex(m_indexFilename.c_str()));
+
+	// Truncate the index.
+	struct stat st;
+	ASSERT_EQ(0, stat(m_indexFilename.c_str(), &st));
+	ASSERT_EQ(0, truncate(m_indexFilename.c_str(), st.st_size - 5));
+
+	EXPECT_EQ(-EINVAL, scanner.loadIndex(m_indexFilename.c_str()));
+	EXPECT_EQ(3U, scanner.files().size());
+	checkFile(scanner, m_binFilename, SyntheticRom::ROM_SPRITES);
+
+	// Nonexistent index.
+	EXPECT_EQ(-ENOENT, scanner.loadIndex("LibraryScannerTest.nonexistent"));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: ROM library scanner tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,219 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * M68KDecodeCacheTest.cpp: M68K decoded instruction cache tests.          *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "cpu/M68K.hpp"
+#include "cpu/M68K_Mem.hpp"
+#include "cpu/Z80.hpp"
+
+// Feature on/off comparison test fixture.
+#include "FeatureToggleTest.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+class M68KDecodeCacheTest : public FeatureToggleTest
+{
+	protected:
+		M68KDecodeCacheTest()
+			: FeatureToggleTest() { }
+		virtual ~M68KDecodeCacheTest() { }
+
+		virtual int setFeature(EmuMD *context, bool enable) override
+			{ return context->m_m68k->setDecodeCache(enable); }
+		virtual bool isFeatureEnabled(EmuMD *context) override
+			{ return context->m_m68k->isDecodeCacheEnabled(); }
+
+		/**
+		 * Check that both contexts have identical state.
+		 * @param what Description, for error messages.
+		 */
+		virtual void checkState(const char *what) override;
+
+		/**
+		 * Run code from M68K RAM in both contexts.
+		 * @param code Code to copy to $FF0000.
+		 * @param words Number of words in code.
+		 */
+		void loadRamCode(const uint16_t *code, int words);
+
+		/**
+		 * Run the M68K in both contexts.
+		 * @param cycles Number of cycles to run.
+		 */
+		void execM68K(int cycles);
+
+		/**
+		 * Check that both contexts have identical M68K registers.
+		 * @param regs [out] M68K registers from the cached context.
+		 */
+		void checkRegs(Zomg_M68KRegSave_t *regs);
+};
+
+/**
+ * Check that both contexts have identical state.
+ * @param what Description, for error messages.
+ */
+void M68KDecodeCacheTest::checkState(const char *what)
+{
+	// NOTE: Snapshots can't be compared directly, since
+	// some chips save host-specific data.
+
+	// M68K registers and odometer.
+	Zomg_M68KRegSave_t regs[2];
+	for (int i = 0; i < 2; i++) {
+		memset(&regs[i], 0, sizeof(regs[i]));
+		m_context[i]->m_m68k->zomgSaveReg(&regs[i]);
+	}
+	ASSERT_EQ(0, memcmp(&regs[0], &regs[1], sizeof(regs[0])))
+		<< "M68K registers differ: " << what;
+	ASSERT_EQ(m_context[0]->m_m68k->readOdometer(), m_context[1]->m_m68k->readOdometer())
+		<< "M68K odometer differs: " << what;
+
+	// M68K and Z80 RAM.
+	const M68K_Mem *mem0 = m_context[0]->m_m68kMem;
+	const M68K_Mem *mem1 = m_context[1]->m_m68kMem;
+	ASSERT_EQ(0, memcmp(mem0->Ram_68k.u8, mem1->Ram_68k.u8, sizeof(mem0->Ram_68k.u8)))
+		<< "M68K RAM differs: " << what;
+	ASSERT_EQ(mem0->Z80_State, mem1->Z80_State)
+		<< "Z80 state differs: " << what;
+	ASSERT_EQ(0, memcmp(m_context[0]->m_z80->m_ramZ80, m_context[1]->m_z80->m_ramZ80,
+		sizeof(m_context[0]->m_z80->m_ramZ80)))
+		<< "Z80 RAM differs: " << what;
+
+	// Compare the framebuffers.
+	ASSERT_NO_FATAL_FAILURE(FeatureToggleTest::checkState(what));
+}
+
+/**
+ * Run code from M68K RAM in both contexts.
+ * @param code Code to copy to $FF0000.
+ * @param words Number of words in code.
+ */
+void M68KDecodeCacheTest::loadRamCode(const uint16_t *code, int words)
+{
+	for (int i = 0; i < 2; i++) {
+		// RAM is stored in host-endian 16-bit words.
+		M68K_Mem *const m68kMem = m_context[i]->m_m68kMem;
+		for (int j = 0; j < words; j++) {
+			m68kMem->Ram_68k.u16[j] = code[j];
+		}
+
+		// Jump to $FF0000.
+		Zomg_M68KRegSave_t regs;
+		m_context[i]->m_m68k->zomgSaveReg(&regs);
+		regs.pc = 0xFF0000;
+		m_context[i]->m_m68k->zomgRestoreReg(&regs);
+		m_context[i]->m_m68k->tripOdometer();
+	}
+}
+
+/**
+ * Run the M68K in both contexts.
+ * @param cycles Number of cycles to run.
+ */
+void M68KDecodeCacheTest::execM68K(int cycles)
+{
+	for (int i = 0; i < 2; i++) {
+		M68K *const m68k = m_context[i]->m_m68k;
+		m68k->exec(m68k->readOdometer() + cycles);
+	}
+	EXPECT_EQ(m_context[0]->m_m68k->readOdometer(),
+		  m_context[1]->m_m68k->readOdometer());
+}
+
+/**
+ * Check that both contexts have identical M68K registers.
+ * @param regs [out] M68K registers from the cached context.
+ */
+void M68KDecodeCacheTest::checkRegs(Zomg_M68KRegSave_t *regs)
+{
+	Zomg_M68KRegSave_t regs0;
+	m_context[0]->m_m68k->zomgSaveReg(&regs0);
+	m_context[1]->m_m68k->zomgSaveReg(regs);
+	EXPECT_EQ(0, memcmp(&regs0, regs, sizeof(regs0)));
+}
+
+FEATURE_TOGGLE_TESTS(M68KDecodeCacheTest);
+
+/**
+ * Self-modifying code in M68K RAM.
+ * The modified opcode must be used on the next pass.
+ */
+TEST_P(M68KDecodeCacheTest, selfModifyingCode)
+{
+	static const uint16_t code[] = {
+		0x7001,				// $FF0000: moveq #1,d0
+		0x5281,				// $FF0002: addq.l #1,d1
+		0x33FC, 0x7002, 0x00FF, 0x0000,	// $FF0004: move.w #$7002,($FF0000).l
+		0x60F2,				// $FF000C: bra.s $FF0000
+	};
+	loadRamCode(code, sizeof(code)/sizeof(code[0]));
+
+	// First pass: moveq #1,d0, then patch it to moveq #2,d0.
+	// The cache already has moveq #1,d0 for $FF0000.
+	execM68K(1000);
+	Zomg_M68KRegSave_t regs;
+	checkRegs(&regs);
+	EXPECT_EQ(2U, regs.dreg[0]);
+	EXPECT_GT(regs.dreg[1], 1U);
+
+	// Patch the code from outside of the M68K, e.g. DMA or a savestate.
+	// $FF0000: moveq #3,d0
+	for (int i = 0; i < 2; i++) {
+		m_context[i]->m_m68kMem->Ram_68k.u16[0] = 0x7003;
+	}
+	// $FF0004: nop; nop; nop; nop
+	for (int i = 0; i < 2; i++) {
+		for (int j = 2; j < 6; j++) {
+			m_context[i]->m_m68kMem->Ram_68k.u16[j] = 0x4E71;
+		}
+	}
+	execM68K(1000);
+	checkRegs(&regs);
+	EXPECT_EQ(3U, regs.dreg[0]);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: M68K decoded instruction cache tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
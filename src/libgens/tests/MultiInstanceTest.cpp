@@ -0,0 +1,421 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * MultiInstanceTest.cpp: Multiple emulation context test.                 *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+
+// LibGens emulation context.
+#include "EmuContext/EmuMD.hpp"
+#include "Rom.hpp"
+
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+#include "sound/SoundMgr.hpp"
+
+// aligned_malloc()
+#include "libcompat/aligned_malloc.h"
+
+// Test ROM data.
+#include "VdpFIFOTesting_data.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <cstdlib>
+
+// C++ includes.
+#include <thread>
+
+// ZLib.
+#define CHUNK 4096
+#include <zlib.h>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Output checksums for a single emulation run.
+ */
+struct MultiInstanceTest_result
+{
+	uint32_t fbCrc;		// CRC32 of every rendered frame.
+	uint32_t audioCrc;	// CRC32 of every audio segment.
+	int frames;		// Number of frames actually run.
+
+	MultiInstanceTest_result()
+		: fbCrc(0)
+		, audioCrc(0)
+		, frames(0) { }
+
+	bool operator==(const MultiInstanceTest_result &other) const
+	{
+		return (fbCrc == other.fbCrc &&
+			audioCrc == other.audioCrc &&
+			frames == other.frames);
+	}
+};
+
+/**
+ * Formatting function for MultiInstanceTest_result.
+ */
+inline ::std::ostream& operator<<(::std::ostream& os, const MultiInstanceTest_result& result) {
+	return os << "fb=" << std::hex << result.fbCrc
+		<< ", audio=" << result.audioCrc
+		<< ", frames=" << std::dec << result.frames;
+};
+
+class MultiInstanceTest : public ::testing::Test
+{
+	protected:
+		MultiInstanceTest()
+			: ::testing::Test()
+			, m_fifoRom(nullptr)
+			, m_fifoRomSize(0) { }
+		virtual ~MultiInstanceTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of frames to run for each ROM.
+		static const int FRAMES;
+
+		// VDP FIFO Testing ROM. (decompressed)
+		uint8_t *m_fifoRom;
+		unsigned int m_fifoRomSize;
+
+		// Synthetic ROM.
+		static uint8_t ms_synthRom[0x800];
+
+		/**
+		 * Decompress the VDP FIFO Testing ROM.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int loadFifoRom(void);
+
+		/**
+		 * Build the synthetic ROM.
+		 * This ROM cycles the backdrop color and writes
+		 * to the PSG in a tight loop, so every frame
+		 * has unique video and audio output.
+		 */
+		static void buildSynthRom(void);
+
+	public:
+		/**
+		 * Run a ROM image in a new emulation context.
+		 * This function may be called from multiple threads.
+		 * @param rom_data	[in] ROM image.
+		 * @param rom_size	[in] Size of rom_data.
+		 * @param frames	[in] Number of frames to run.
+		 * @param result	[out] Output checksums.
+		 */
+		static void runRom(const uint8_t *rom_data, unsigned int rom_size,
+				   int frames, MultiInstanceTest_result *result);
+};
+
+const int MultiInstanceTest::FRAMES = 300;
+uint8_t MultiInstanceTest::ms_synthRom[0x800];
+
+/**
+ * Set up the ROM images for testing.
+ */
+void MultiInstanceTest::SetUp(void)
+{
+	ASSERT_EQ(0, loadFifoRom()) << "Cannot continue without the VDP FIFO Testing ROM.";
+	buildSynthRom();
+}
+
+/**
+ * Tear down the test.
+ */
+void MultiInstanceTest::TearDown(void)
+{
+	free(m_fifoRom);
+	m_fifoRom = nullptr;
+	m_fifoRomSize = 0;
+}
+
+/**
+ * Decompress the VDP FIFO Testing ROM.
+ * @return 0 on success; non-zero on error.
+ */
+int MultiInstanceTest::loadFifoRom(void)
+{
+	// Based on zlib example code:
+	// http://www.zlib.net/zlib_how.html
+	int ret;
+	z_stream strm;
+
+	// ROM buffer. (slightly more than 512 KB)
+	const unsigned int buf_siz = test_vdpfifotesting_rom_sz;
+	const unsigned int out_len = buf_siz + 64;
+	uint8_t *out = (uint8_t*)malloc(out_len);
+	unsigned int out_pos = 0;
+
+	// Data to decode.
+	const uint8_t *in = test_vdpfifotesting_rom;
+	unsigned int in_len = sizeof(test_vdpfifotesting_rom);
+	unsigned int in_pos = 0;
+
+	// Allocate the zlib inflate state.
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	strm.avail_in = 0;
+	strm.next_in = Z_NULL;
+	ret = inflateInit2(&strm, 15+16);
+	if (ret != Z_OK) {
+		free(out);
+		return ret;
+	}
+
+	// Decompress the stream.
+	unsigned int avail_out_before;
+	unsigned int avail_out_after;
+	do {
+		if (in_pos >= in_len)
+			break;
+		strm.avail_in = (in_len - in_pos);
+		strm.next_in = &in[in_pos];
+
+		// Run inflate() on input until the output buffer is not full.
+		do {
+			avail_out_before = (out_len - out_pos);
+			strm.avail_out = avail_out_before;
+			strm.next_out = &out[out_pos];
+
+			ret = inflate(&strm, Z_NO_FLUSH);
+			assert(ret != Z_STREAM_ERROR);	// make sure the state isn't clobbered
+			switch (ret) {
+				case Z_NEED_DICT:
+					ret = Z_DATA_ERROR;
+					// fall through
+				case Z_DATA_ERROR:
+				case Z_MEM_ERROR:
+				case Z_STREAM_ERROR:
+					// Error occurred while decoding the stream.
+					inflateEnd(&strm);
+					fprintf(stderr, "ERR: %d\n", ret);
+					free(out);
+					return ret;
+				default:
+					break;
+			}
+
+			// Increase the output position.
+			avail_out_after = (avail_out_before - strm.avail_out);
+			out_pos += avail_out_after;
+		} while (strm.avail_out == 0 && avail_out_after > 0);
+	} while (ret != Z_STREAM_END && avail_out_after > 0);
+
+	// Close the stream.
+	inflateEnd(&strm);
+
+	// If we didn't actually finish reading the compressed data, something went wrong.
+	if (ret != Z_STREAM_END || out_pos != buf_siz) {
+		free(out);
+		return Z_DATA_ERROR;
+	}
+
+	// Patch the controller check out of the ROM.
+	// At address $000F46, write: 70 00 4E 71
+	static const uint8_t patch[4] = {0x70, 0x00, 0x4E, 0x71};
+	memcpy(&out[0xF46], patch, sizeof(patch));
+
+	m_fifoRom = out;
+	m_fifoRomSize = out_pos;
+	return 0;
+}
+
+/**
+ * Build the synthetic ROM.
+ * This ROM cycles the backdrop color and writes
+ * to the PSG in a tight loop, so every frame
+ * has unique video and audio output.
+ */
+void MultiInstanceTest::buildSynthRom(void)
+{
+	memset(ms_synthRom, 0xFF, sizeof(ms_synthRom));
+
+	// Vector table: initial SSP and PC.
+	static const uint8_t vectors[8] = {
+		0x00, 0xFF, 0xFE, 0x00,	// SSP: $FFFE00
+		0x00, 0x00, 0x02, 0x00,	// PC:  $000200
+	};
+	memcpy(&ms_synthRom[0x000], vectors, sizeof(vectors));
+
+	// ROM header.
+	static const char sysName[] = "SEGA MEGA DRIVE ";
+	memcpy(&ms_synthRom[0x100], sysName, sizeof(sysName)-1);
+
+	// Program code.
+	static const uint8_t code[] = {
+		0x41, 0xF9, 0x00, 0xC0, 0x00, 0x04,	// lea	$C00004,a0
+		0x43, 0xF9, 0x00, 0xC0, 0x00, 0x00,	// lea	$C00000,a1
+		0x30, 0xBC, 0x80, 0x04,			// move.w #$8004,(a0)
+		0x30, 0xBC, 0x81, 0x44,			// move.w #$8144,(a0)
+		0x30, 0xBC, 0x8F, 0x00,			// move.w #$8F00,(a0)
+		0x20, 0xBC, 0xC0, 0x00, 0x00, 0x00,	// move.l #$C0000000,(a0)
+		0x70, 0x00,				// moveq	#0,d0
+		// loop:
+		0x32, 0x80,				// move.w d0,(a1)
+		0x13, 0xC0, 0x00, 0xC0, 0x00, 0x11,	// move.b d0,$C00011
+		0x52, 0x40,				// addq.w #1,d0
+		0x60, 0xF4,				// bra.s	loop
+	};
+	memcpy(&ms_synthRom[0x200], code, sizeof(code));
+}
+
+/**
+ * Run a ROM image in a new emulation context.
+ * This function may be called from multiple threads.
+ * @param rom_data	[in] ROM image.
+ * @param rom_size	[in] Size of rom_data.
+ * @param frames	[in] Number of frames to run.
+ * @param result	[out] Output checksums.
+ */
+void MultiInstanceTest::runRom(const uint8_t *rom_data, unsigned int rom_size,
+			       int frames, MultiInstanceTest_result *result)
+{
+	*result = MultiInstanceTest_result();
+
+	Rom *rom = new Rom(rom_data, rom_size);
+	if (!rom->isOpen()) {
+		delete rom;
+		return;
+	}
+
+	EmuMD *context = new EmuMD(rom, SysVersion::REGION_US_NTSC);
+	rom->close();
+	if (!context->isRomOpened()) {
+		delete context;
+		delete rom;
+		return;
+	}
+
+	MdFb *fb = context->m_vdp->MD_Screen;
+	fb->setBpp(MdFb::BPP_32);
+
+	SoundMgr *soundMgr = context->m_soundMgr;
+	int16_t *audioBuf = (int16_t*)aligned_malloc(16, SoundMgr::MAX_SEGMENT_SIZE * 2 * sizeof(int16_t));
+
+	uLong fbCrc = crc32(0, nullptr, 0);
+	uLong audioCrc = crc32(0, nullptr, 0);
+	for (int i = 0; i < frames; i++) {
+		context->execFrame();
+
+		for (int y = 0; y < fb->numLines(); y++) {
+			fbCrc = crc32(fbCrc, (const Bytef*)fb->lineBuf32(y),
+				      fb->pxPerLine() * sizeof(uint32_t));
+		}
+
+		const int samples = soundMgr->writeStereo(audioBuf, soundMgr->getSegLength());
+		audioCrc = crc32(audioCrc, (const Bytef*)audioBuf,
+				 samples * 2 * sizeof(int16_t));
+		result->frames++;
+	}
+
+	aligned_free(audioBuf);
+	delete context;
+	delete rom;
+
+	result->fbCrc = (uint32_t)fbCrc;
+	result->audioCrc = (uint32_t)audioCrc;
+}
+
+/**
+ * Run two different ROMs concurrently, each in its own
+ * emulation context and thread, and verify that the output
+ * is bit-identical to running each ROM by itself.
+ */
+TEST_F(MultiInstanceTest, concurrentMatchesSolo)
+{
+	// Solo runs.
+	MultiInstanceTest_result soloFifo, soloSynth;
+	runRom(m_fifoRom, m_fifoRomSize, FRAMES, &soloFifo);
+	runRom(ms_synthRom, sizeof(ms_synthRom), FRAMES, &soloSynth);
+	ASSERT_EQ(FRAMES, soloFifo.frames) << "VDP FIFO Testing ROM failed to load.";
+	ASSERT_EQ(FRAMES, soloSynth.frames) << "Synthetic ROM failed to load.";
+
+	// The two ROMs must not produce the same output.
+	// Otherwise, crosstalk between contexts can't be detected.
+	EXPECT_NE(soloFifo.fbCrc, soloSynth.fbCrc);
+	EXPECT_NE(soloFifo.audioCrc, soloSynth.audioCrc);
+
+	// Concurrent runs.
+	MultiInstanceTest_result concFifo, concSynth;
+	std::thread thrFifo(runRom, m_fifoRom, m_fifoRomSize, FRAMES, &concFifo);
+	std::thread thrSynth(runRom, ms_synthRom, (unsigned int)sizeof(ms_synthRom), FRAMES, &concSynth);
+	thrFifo.join();
+	thrSynth.join();
+
+	EXPECT_EQ(soloFifo, concFifo);
+	EXPECT_EQ(soloSynth, concSynth);
+}
+
+/**
+ * Run several copies of the same ROM concurrently
+ * and verify that all of them match a solo run.
+ */
+TEST_F(MultiInstanceTest, concurrentSameRom)
+{
+	static const int THREADS = 4;
+
+	MultiInstanceTest_result solo;
+	runRom(ms_synthRom, sizeof(ms_synthRom), FRAMES, &solo);
+	ASSERT_EQ(FRAMES, solo.frames) << "Synthetic ROM failed to load.";
+
+	MultiInstanceTest_result conc[THREADS];
+	std::thread thr[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		thr[i] = std::thread(runRom, ms_synthRom,
+			(unsigned int)sizeof(ms_synthRom), FRAMES, &conc[i]);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		thr[i].join();
+	}
+
+	for (int i = 0; i < THREADS; i++) {
+		EXPECT_EQ(solo, conc[i]) << "Thread " << i;
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Multiple emulation context test.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,226 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * RewindBufferTest.cpp: Rewind buffer test.                               *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+#include "Util/RewindBuffer.hpp"
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+// ZLib. (for crc32())
+#include <zlib.h>
+
+namespace LibGens { namespace Tests {
+
+class RewindBufferTest : public ::testing::TestWithParam<SyntheticRom::RomType_t>
+{
+	protected:
+		RewindBufferTest()
+			: ::testing::TestWithParam<SyntheticRom::RomType_t>()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+			, m_context(nullptr) { }
+		virtual ~RewindBufferTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of frames to save.
+		static const int TEST_FRAMES = 120;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+		EmuMD *m_context;
+
+		/**
+		 * Calculate the CRC32 of the current state.
+		 * @return CRC32 of the current snapshot.
+		 */
+		uint32_t stateCrc(void);
+};
+
+/**
+ * Set up the emulation context.
+ */
+void RewindBufferTest::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(GetParam());
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen());
+	m_context = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+	m_context->m_vdp->MD_Screen->setBpp(MdFb::BPP_32);
+}
+
+/**
+ * Tear down the emulation context.
+ */
+void RewindBufferTest::TearDown(void)
+{
+	delete m_context;
+	m_context = nullptr;
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Calculate the CRC32 of the current state.
+ * @return CRC32 of the current snapshot.
+ */
+uint32_t RewindBufferTest::stateCrc(void)
+{
+	vector<uint8_t> buf(m_context->snapshotSave(nullptr, 0));
+	int size = m_context->snapshotSave(buf.data(), buf.size());
+	EXPECT_GT(size, 0);
+	if (size <= 0)
+		return 0;
+	return (uint32_t)crc32(0, (const Bytef*)buf.data(), size);
+}
+
+/**
+ * The same state must always serialize to the same bytes,
+ * regardless of the previous buffer contents.
+ * Otherwise, restored states can't be compared, and the
+ * deltas carry garbage.
+ */
+TEST_P(RewindBufferTest, deterministic)
+{
+	for (int i = 0; i < 8; i++) {
+		m_context->execFrame();
+	}
+
+	const size_t bufSize = m_context->snapshotSave(nullptr, 0);
+	vector<uint8_t> buf0(bufSize, 0x00);
+	vector<uint8_t> buf1(bufSize, 0xFF);
+	const int size = m_context->snapshotSave(buf0.data(), buf0.size());
+	ASSERT_GT(size, 0);
+	ASSERT_EQ(size, m_context->snapshotSave(buf1.data(), buf1.size()));
+	EXPECT_EQ(0, memcmp(buf0.data(), buf1.data(), size));
+
+	// Save -> load -> save.
+	ASSERT_EQ(0, m_context->snapshotLoad(buf0.data(), size));
+	memset(buf1.data(), 0x55, buf1.size());
+	ASSERT_EQ(size, m_context->snapshotSave(buf1.data(), buf1.size()));
+	EXPECT_EQ(0, memcmp(buf0.data(), buf1.data(), size));
+}
+
+/**
+ * Popping states must restore them in reverse order.
+ */
+TEST_P(RewindBufferTest, pushPop)
+{
+	RewindBuffer rewind(16*1024*1024);
+	EXPECT_EQ(-ENOENT, rewind.pop(m_context));
+
+	uint32_t crc[TEST_FRAMES];
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		m_context->execFrame();
+		crc[i] = stateCrc();
+		ASSERT_EQ(0, rewind.push(m_context));
+	}
+	EXPECT_EQ((int)TEST_FRAMES, rewind.count());
+	EXPECT_LE(rewind.bufUsed(), rewind.bufSize());
+
+	for (int i = TEST_FRAMES-1; i >= 0; i--) {
+		ASSERT_EQ(0, rewind.pop(m_context));
+		EXPECT_EQ(crc[i], stateCrc()) << "Frame " << i << ": state mismatch";
+	}
+
+	// The oldest state is kept.
+	EXPECT_EQ(1, rewind.count());
+	ASSERT_EQ(0, rewind.pop(m_context));
+	EXPECT_EQ(crc[0], stateCrc());
+
+	rewind.clear();
+	EXPECT_EQ(0, rewind.count());
+	EXPECT_EQ(-ENOENT, rewind.pop(m_context));
+}
+
+/**
+ * A small buffer must discard the oldest states
+ * without corrupting the newer states.
+ */
+TEST_P(RewindBufferTest, eviction)
+{
+	RewindBuffer rewind(64*1024);
+
+	uint32_t crc[TEST_FRAMES];
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		m_context->execFrame();
+		crc[i] = stateCrc();
+		ASSERT_EQ(0, rewind.push(m_context));
+		EXPECT_LE(rewind.bufUsed(), rewind.bufSize());
+	}
+
+	const int count = rewind.count();
+	ASSERT_GT(count, 0);
+	ASSERT_LE(count, (int)TEST_FRAMES);
+	for (int i = TEST_FRAMES-1; i >= TEST_FRAMES-count; i--) {
+		ASSERT_EQ(0, rewind.pop(m_context));
+		EXPECT_EQ(crc[i], stateCrc()) << "Frame " << i << ": state mismatch";
+	}
+}
+
+INSTANTIATE_TEST_CASE_P(SyntheticRoms, RewindBufferTest,
+	::testing::Values(
+		SyntheticRom::ROM_SPRITES,
+		SyntheticRom::ROM_SCROLL,
+		SyntheticRom::ROM_DMA,
+		SyntheticRom::ROM_YM2612,
+		SyntheticRom::ROM_Z80
+));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Rewind buffer test.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,386 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * RomLoadTest.cpp: ROM loading tests.                                     *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// ZLib. (for gzopen() and crc32())
+#include <zlib.h>
+
+// LibGensFile.
+#include "libgensfile/Archive.hpp"
+#include "libgensfile/ArchiveFactory.hpp"
+using LibGensFile::Archive;
+using LibGensFile::ArchiveFactory;
+
+namespace LibGens { namespace Tests {
+
+/**
+ * ROM loading tests.
+ *
+ * ROM images are loaded using Archive::readFileStream(),
+ * from memory, from plain files, and from gzipped files.
+ * All of them must produce identical ROM data.
+ */
+class RomLoadTest : public ::testing::Test
+{
+	protected:
+		RomLoadTest()
+			: ::testing::Test()
+			, m_synthRom(nullptr) { }
+		virtual ~RomLoadTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		SyntheticRom *m_synthRom;
+
+		// ROM data. (plain binary)
+		vector<uint8_t> m_romData;
+
+		// Temporary filename.
+		string m_filename;
+
+		/**
+		 * Encode the ROM data in SMD format.
+		 * @return SMD-format ROM image.
+		 */
+		vector<uint8_t> encodeSMD(void) const;
+
+		/**
+		 * Make a large ROM image, so it's streamed in multiple chunks.
+		 * The synthetic ROM is used as the first 64 KB.
+		 */
+		void makeLargeRom(void);
+
+		/**
+		 * Write data to the temporary file.
+		 * @param data Data.
+		 * @param gzip If true, compress the data with gzip.
+		 */
+		void writeFile(const vector<uint8_t> &data, bool gzip);
+
+		/**
+		 * Load a ROM and compare it to the ROM data.
+		 * @param rom Opened ROM.
+		 * @param romFormat Expected ROM format.
+		 */
+		void checkRom(Rom *rom, Rom::RomFormat romFormat);
+};
+
+/**
+ * Set up the test.
+ */
+void RomLoadTest::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(SyntheticRom::ROM_SPRITES);
+	m_romData.assign(m_synthRom->data(), m_synthRom->data() + m_synthRom->size());
+	m_filename = "RomLoadTest.tmp";
+}
+
+/**
+ * Tear down the test.
+ */
+void RomLoadTest::TearDown(void)
+{
+	remove(m_filename.c_str());
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Encode the ROM data in SMD format.
+ * @return SMD-format ROM image.
+ */
+vector<uint8_t> RomLoadTest::encodeSMD(void) const
+{
+	const uint8_t *bin = m_romData.data();
+	const unsigned int bin_size = (unsigned int)m_romData.size();
+	vector<uint8_t> smd(512 + bin_size);
+
+	// SMD header.
+	smd[0x00] = (uint8_t)(bin_size / 16384);
+	smd[0x01] = 0x03;
+	smd[0x08] = 0xAA;
+	smd[0x09] = 0xBB;
+	smd[0x0A] = 0x06;
+
+	// Each 16 KB block has the odd bytes first,
+	// followed by the even bytes.
+	for (unsigned int blk = 0; blk < bin_size; blk += 16384) {
+		uint8_t *dest = &smd[512 + blk];
+		for (unsigned int i = 0; i < 8192; i++) {
+			dest[i] = bin[blk + (i * 2) + 1];
+			dest[i + 8192] = bin[blk + (i * 2)];
+		}
+	}
+
+	return smd;
+}
+
+/**
+ * Make a large ROM image, so it's streamed in multiple chunks.
+ * The synthetic ROM is used as the first 64 KB.
+ */
+void RomLoadTest::makeLargeRom(void)
+{
+	// 4 MB, filled with a simple LCG so the
+	// data doesn't repeat every 16 KB.
+	m_romData.resize(4*1024*1024);
+	uint32_t lcg = 0x12345678;
+	for (size_t i = m_synthRom->size(); i < m_romData.size(); i++) {
+		lcg = (lcg * 1103515245) + 12345;
+		m_romData[i] = (uint8_t)(lcg >> 16);
+	}
+}
+
+/**
+ * Write data to the temporary file.
+ * @param data Data.
+ * @param gzip If true, compress the data with gzip.
+ */
+void RomLoadTest::writeFile(const vector<uint8_t> &data, bool gzip)
+{
+	if (gzip) {
+		gzFile gzf = gzopen(m_filename.c_str(), "wb");
+		ASSERT_TRUE(gzf != nullptr);
+		EXPECT_EQ((int)data.size(), gzwrite(gzf, data.data(), (unsigned int)data.size()));
+		gzclose(gzf);
+	} else {
+		FILE *f = fopen(m_filename.c_str(), "wb");
+		ASSERT_TRUE(f != nullptr);
+		EXPECT_EQ(data.size(), fwrite(data.data(), 1, data.size(), f));
+		fclose(f);
+	}
+}
+
+/**
+ * Load a ROM and compare it to the ROM data.
+ * @param rom Opened ROM.
+ * @param romFormat Expected ROM format.
+ */
+void RomLoadTest::checkRom(Rom *rom, Rom::RomFormat romFormat)
+{
+	ASSERT_TRUE(rom->isOpen());
+	EXPECT_EQ(romFormat, rom->romFormat());
+	ASSERT_EQ((int)m_romData.size(), rom->romSize());
+
+	// Use a larger buffer, like RomCartridgeMD does.
+	vector<uint8_t> buf(m_romData.size() * 2);
+	int ret = rom->loadRom(buf.data(), buf.size());
+	ASSERT_EQ((int)m_romData.size(), ret);
+	EXPECT_EQ(0, memcmp(buf.data(), m_romData.data(), m_romData.size()));
+
+	// The CRC32 covers the entire buffer.
+	EXPECT_EQ((uint32_t)crc32(0, buf.data(), (uInt)buf.size()), rom->rom_crc32());
+}
+
+/**
+ * Load a plain binary ROM image from memory.
+ */
+TEST_F(RomLoadTest, binaryMemory)
+{
+	Rom rom(m_synthRom->data(), m_synthRom->size());
+	checkRom(&rom, Rom::RFMT_BINARY);
+}
+
+/**
+ * Load an SMD-format ROM image from memory.
+ */
+TEST_F(RomLoadTest, smdMemory)
+{
+	vector<uint8_t> smd = encodeSMD();
+	Rom rom(smd.data(), (unsigned int)smd.size());
+	checkRom(&rom, Rom::RFMT_SMD);
+}
+
+/**
+ * Load an uncompressed plain binary ROM image from a file.
+ */
+TEST_F(RomLoadTest, binaryFile)
+{
+	vector<uint8_t> bin(m_synthRom->data(), m_synthRom->data() + m_synthRom->size());
+	writeFile(bin, false);
+	Rom rom(m_filename.c_str());
+	checkRom(&rom, Rom::RFMT_BINARY);
+}
+
+/**
+ * Load an uncompressed SMD-format ROM image from a file.
+ */
+TEST_F(RomLoadTest, smdFile)
+{
+	writeFile(encodeSMD(), false);
+	Rom rom(m_filename.c_str());
+	checkRom(&rom, Rom::RFMT_SMD);
+}
+
+/**
+ * Load a gzipped plain binary ROM image from a file.
+ */
+TEST_F(RomLoadTest, binaryGzip)
+{
+	vector<uint8_t> bin(m_synthRom->data(), m_synthRom->data() + m_synthRom->size());
+	writeFile(bin, true);
+	Rom rom(m_filename.c_str());
+	checkRom(&rom, Rom::RFMT_BINARY);
+}
+
+/**
+ * Load a gzipped SMD-format ROM image from a file.
+ */
+TEST_F(RomLoadTest, smdGzip)
+{
+	writeFile(encodeSMD(), true);
+	Rom rom(m_filename.c_str());
+	checkRom(&rom, Rom::RFMT_SMD);
+}
+
+/**
+ * Load a large gzipped plain binary ROM image from a file.
+ * The ROM is streamed in multiple chunks.
+ */
+TEST_F(RomLoadTest, binaryGzipLarge)
+{
+	makeLargeRom();
+	writeFile(m_romData, true);
+	Rom rom(m_filename.c_str());
+	checkRom(&rom, Rom::RFMT_BINARY);
+}
+
+/**
+ * Load a large gzipped SMD-format ROM image from a file.
+ * The ROM is streamed in multiple chunks.
+ */
+TEST_F(RomLoadTest, smdGzipLarge)
+{
+	makeLargeRom();
+	writeFile(encodeSMD(), true);
+	Rom rom(m_filename.c_str());
+	checkRom(&rom, Rom::RFMT_SMD);
+}
+
+/**
+ * readFileStream() chunk state.
+ */
+struct StreamChunks_t {
+	const uint8_t *buf;	// Start of the read buffer.
+	size_t pos;		// Expected position of the next chunk.
+	unsigned int count;	// Number of chunks processed.
+	unsigned int cancelAfter; // Cancel after this many chunks. (0 == never)
+	bool misaligned;	// True if a chunk other than the last was misaligned.
+	size_t lastLen;		// Length of the last chunk.
+};
+
+static int StreamChunksFn(void *param, uint8_t *data, size_t len)
+{
+	StreamChunks_t *const sc = static_cast<StreamChunks_t*>(param);
+	EXPECT_EQ(sc->buf + sc->pos, data);
+	if (sc->lastLen % 16384 != 0) {
+		// Only the last chunk may be misaligned.
+		sc->misaligned = true;
+	}
+	sc->pos += len;
+	sc->lastLen = len;
+	sc->count++;
+	if (sc->cancelAfter > 0 && sc->count >= sc->cancelAfter)
+		return -ECANCELED;
+	return 0;
+}
+
+/**
+ * Read a file with Archive::readFileStream().
+ * Chunks must be contiguous and aligned.
+ */
+TEST_F(RomLoadTest, readFileStream)
+{
+	makeLargeRom();
+	// Make the size not a multiple of the alignment.
+	m_romData.resize(m_romData.size() - 100);
+	writeFile(m_romData, true);
+
+	Archive *archive = ArchiveFactory::openArchive(m_filename.c_str());
+	ASSERT_TRUE(archive != nullptr);
+	mdp_z_entry_t *z_entry_list = nullptr;
+	ASSERT_EQ(0, archive->getFileInfo(&z_entry_list));
+	ASSERT_TRUE(z_entry_list != nullptr);
+
+	vector<uint8_t> buf(m_romData.size());
+	StreamChunks_t sc;
+	memset(&sc, 0, sizeof(sc));
+	sc.buf = buf.data();
+	Archive::file_offset_t ret_siz = 0;
+	EXPECT_EQ(0, archive->readFileStream(z_entry_list, 0, buf.size(),
+		buf.data(), buf.size(), 16384, StreamChunksFn, &sc, &ret_siz));
+	EXPECT_EQ((Archive::file_offset_t)buf.size(), ret_siz);
+	EXPECT_EQ(buf.size(), sc.pos);
+	EXPECT_GT(sc.count, 1U);
+	EXPECT_FALSE(sc.misaligned);
+	EXPECT_EQ(0, memcmp(buf.data(), m_romData.data(), m_romData.size()));
+
+	// Cancel the read after the first chunk.
+	memset(&sc, 0, sizeof(sc));
+	sc.buf = buf.data();
+	sc.cancelAfter = 1;
+	EXPECT_EQ(-ECANCELED, archive->readFileStream(z_entry_list, 0, buf.size(),
+		buf.data(), buf.size(), 16384, StreamChunksFn, &sc, &ret_siz));
+	EXPECT_EQ(1U, sc.count);
+
+	Archive::z_entry_t_free(z_entry_list);
+	delete archive;
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: ROM loading tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,253 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * SnapshotTest.cpp: In-memory snapshot test.                              *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "EmuContext/EmuPico.hpp"
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+#include "sound/SoundMgr.hpp"
+
+// aligned_malloc()
+#include "libcompat/aligned_malloc.h"
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+// ZLib. (for crc32())
+#include <zlib.h>
+
+namespace LibGens { namespace Tests {
+
+class SnapshotTest : public ::testing::TestWithParam<SyntheticRom::RomType_t>
+{
+	protected:
+		SnapshotTest()
+			: ::testing::TestWithParam<SyntheticRom::RomType_t>()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+			, m_context(nullptr)
+			, m_audioBuf(nullptr) { }
+		virtual ~SnapshotTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of frames to run before taking a snapshot.
+		static const int WARMUP_FRAMES = 60;
+
+		// Number of frames to run after taking a snapshot.
+		static const int TEST_FRAMES = 20;
+
+		// Snapshot buffer size.
+		static const unsigned int SNAPSHOT_BUF_SIZE = 512*1024;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+		EmuMD *m_context;
+		int16_t *m_audioBuf;
+		vector<uint8_t> m_snapshot;
+
+		/**
+		 * Run a frame and calculate checksums.
+		 * @param fbCrc [out] CRC32 of the frame.
+		 * @param audioCrc [out] CRC32 of the audio segment.
+		 */
+		void runFrame(uint32_t *fbCrc, uint32_t *audioCrc);
+};
+
+/**
+ * Set up the emulation context.
+ */
+void SnapshotTest::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(GetParam());
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen());
+	m_context = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+	m_context->m_vdp->MD_Screen->setBpp(MdFb::BPP_32);
+
+	// Audio buffer. (stereo, 16-bit)
+	m_audioBuf = (int16_t*)aligned_malloc(16, SoundMgr::MAX_SEGMENT_SIZE * 2 * sizeof(int16_t));
+	ASSERT_TRUE(m_audioBuf != nullptr);
+
+	m_snapshot.resize(SNAPSHOT_BUF_SIZE);
+}
+
+/**
+ * Tear down the emulation context.
+ */
+void SnapshotTest::TearDown(void)
+{
+	delete m_context;
+	m_context = nullptr;
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+	aligned_free(m_audioBuf);
+	m_audioBuf = nullptr;
+}
+
+/**
+ * Run a frame and calculate checksums.
+ * @param fbCrc [out] CRC32 of the frame.
+ * @param audioCrc [out] CRC32 of the audio segment.
+ */
+void SnapshotTest::runFrame(uint32_t *fbCrc, uint32_t *audioCrc)
+{
+	m_context->execFrame();
+
+	const MdFb *fb = m_context->m_vdp->MD_Screen;
+	uLong crc = crc32(0, nullptr, 0);
+	for (int line = 0; line < fb->numLines(); line++) {
+		crc = crc32(crc, (const Bytef*)fb->lineBuf32(line), fb->pxPerLine() * sizeof(uint32_t));
+	}
+	*fbCrc = (uint32_t)crc;
+
+	SoundMgr *const soundMgr = m_context->m_soundMgr;
+	int samples = soundMgr->writeStereo(m_audioBuf, soundMgr->getSegLength());
+	*audioCrc = (uint32_t)crc32(0, (const Bytef*)m_audioBuf, samples * 2 * sizeof(int16_t));
+}
+
+/**
+ * Restoring a snapshot must produce the exact same
+ * video and audio output as the original run.
+ */
+TEST_P(SnapshotTest, deterministic)
+{
+	for (int i = 0; i < WARMUP_FRAMES; i++) {
+		uint32_t fbCrc, audioCrc;
+		runFrame(&fbCrc, &audioCrc);
+	}
+
+	int size = m_context->snapshotSave(m_snapshot.data(), m_snapshot.size());
+	ASSERT_GT(size, 0);
+
+	uint32_t fbCrc[TEST_FRAMES], audioCrc[TEST_FRAMES];
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		runFrame(&fbCrc[i], &audioCrc[i]);
+	}
+
+	// Restore the snapshot and run the same frames again.
+	ASSERT_EQ(0, m_context->snapshotLoad(m_snapshot.data(), size));
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		uint32_t fbCrc_new, audioCrc_new;
+		runFrame(&fbCrc_new, &audioCrc_new);
+		EXPECT_EQ(fbCrc[i], fbCrc_new) << "Frame " << i << ": video mismatch";
+		EXPECT_EQ(audioCrc[i], audioCrc_new) << "Frame " << i << ": audio mismatch";
+	}
+}
+
+/**
+ * A buffer that's too small must be rejected.
+ */
+TEST_P(SnapshotTest, bufferTooSmall)
+{
+	m_context->execFrame();
+	int size = m_context->snapshotSave(m_snapshot.data(), m_snapshot.size());
+	ASSERT_GT(size, 0);
+	EXPECT_EQ(-ENOSPC, m_context->snapshotSave(m_snapshot.data(), size - 1));
+}
+
+/**
+ * A nullptr buffer returns the required size.
+ */
+TEST_P(SnapshotTest, sizeQuery)
+{
+	m_context->execFrame();
+	int reqSize = m_context->snapshotSave(nullptr, 0);
+	ASSERT_GT(reqSize, 0);
+	EXPECT_EQ(reqSize, m_context->snapshotSave(m_snapshot.data(), reqSize));
+}
+
+/**
+ * Snapshots from a different system must be rejected.
+ */
+TEST_P(SnapshotTest, wrongSystem)
+{
+	m_context->execFrame();
+	int size = m_context->snapshotSave(m_snapshot.data(), m_snapshot.size());
+	ASSERT_GT(size, 0);
+
+	EmuPico *pico = new EmuPico(m_rom, SysVersion::REGION_US_NTSC);
+	EXPECT_EQ(-EINVAL, pico->snapshotLoad(m_snapshot.data(), size));
+	delete pico;
+}
+
+/**
+ * Invalid snapshot data must be rejected.
+ */
+TEST_P(SnapshotTest, invalidData)
+{
+	m_context->execFrame();
+	int size = m_context->snapshotSave(m_snapshot.data(), m_snapshot.size());
+	ASSERT_GT(size, 0);
+
+	// Truncated header.
+	EXPECT_EQ(-EINVAL, m_context->snapshotLoad(m_snapshot.data(), 4));
+
+	// Bad magic number.
+	m_snapshot[0] ^= 0xFF;
+	EXPECT_EQ(-EINVAL, m_context->snapshotLoad(m_snapshot.data(), size));
+}
+
+INSTANTIATE_TEST_CASE_P(SyntheticRoms, SnapshotTest,
+	::testing::Values(
+		SyntheticRom::ROM_SPRITES,
+		SyntheticRom::ROM_SCROLL,
+		SyntheticRom::ROM_DMA,
+		SyntheticRom::ROM_YM2612,
+		SyntheticRom::ROM_Z80
+));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: In-memory snapshot test.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
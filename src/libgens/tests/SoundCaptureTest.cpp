@@ -0,0 +1,490 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * SoundCaptureTest.cpp: Sound capture tests.                              *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "sound/SoundMgr.hpp"
+#include "sound/SoundCapture.hpp"
+
+// ZOMG
+#include "libzomg/zomg_psg.h"
+#include "libzomg/zomg_ym2612.h"
+
+// M68K.hpp has CLOCK_NTSC and CLOCK_PAL #defines.
+#include "cpu/M68K.hpp"
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class SoundCaptureTest : public ::testing::TestWithParam<SyntheticRom::RomType_t>
+{
+	protected:
+		SoundCaptureTest()
+			: ::testing::TestWithParam<SyntheticRom::RomType_t>()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+			, m_context(nullptr)
+		{ }
+		virtual ~SoundCaptureTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of frames to capture.
+		static const int TEST_FRAMES = 120;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+		EmuMD *m_context;
+		SoundCapture m_capture;
+
+		// Capture filenames.
+		string m_regFilename;
+		string m_wavFilename;
+
+		// Audio output read from the SoundMgr.
+		vector<int16_t> m_pcm;
+
+		/**
+		 * Run frames with the capture attached, then stop the capture.
+		 * Audio output is appended to m_pcm.
+		 * @param frames Number of frames.
+		 */
+		void runCapture(int frames);
+
+		/**
+		 * Read a file.
+		 * @param filename Filename.
+		 * @return File contents.
+		 */
+		static vector<uint8_t> readFile(const string &filename);
+
+		/**
+		 * Compare the register state of replayed audio ICs
+		 * against the emulation context's audio ICs.
+		 * @param ym2612 Replayed YM2612.
+		 * @param psg Replayed PSG.
+		 */
+		void checkRegs(Ym2612 &ym2612, Psg &psg);
+
+		static inline uint32_t le32(const uint8_t *p)
+		{
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+
+		static inline uint16_t le16(const uint8_t *p)
+		{
+			return p[0] | (p[1] << 8);
+		}
+};
+
+/**
+ * Set up the emulation context for the synthetic ROM.
+ */
+void SoundCaptureTest::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(GetParam());
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen()) << "Synthetic ROM could not be opened.";
+
+	m_context = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+	ASSERT_TRUE(m_context->isRomOpened()) << "Synthetic ROM could not be loaded.";
+	m_rom->close();
+	m_context->m_soundMgr->setRate(44100, false);
+
+	m_regFilename = "SoundCaptureTest.reg.tmp";
+	m_wavFilename = "SoundCaptureTest.wav.tmp";
+}
+
+/**
+ * Tear down the emulation context.
+ */
+void SoundCaptureTest::TearDown(void)
+{
+	if (m_context) {
+		m_context->m_soundMgr->setCapture(nullptr);
+	}
+	m_capture.stop();
+	remove(m_regFilename.c_str());
+	remove(m_wavFilename.c_str());
+
+	delete m_context;
+	m_context = nullptr;
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Run frames with the capture attached, then stop the capture.
+ * Audio output is appended to m_pcm.
+ * @param frames Number of frames.
+ */
+void SoundCaptureTest::runCapture(int frames)
+{
+	SoundMgr *const soundMgr = m_context->m_soundMgr;
+	soundMgr->setCapture(&m_capture);
+
+	int16_t segBuffer[SoundMgr::MAX_SEGMENT_SIZE * 2] ALIGN(16);
+	for (int i = 0; i < frames; i++) {
+		m_context->execFrame();
+		const int samples = soundMgr->writeStereo(segBuffer, soundMgr->getSegLength());
+		m_pcm.insert(m_pcm.end(), segBuffer, segBuffer + (samples * 2));
+	}
+
+	soundMgr->setCapture(nullptr);
+	EXPECT_EQ(0, m_capture.stop());
+	EXPECT_EQ(0U, m_capture.dropped());
+}
+
+/**
+ * Read a file.
+ * @param filename Filename.
+ * @return File contents.
+ */
+vector<uint8_t> SoundCaptureTest::readFile(const string &filename)
+{
+	vector<uint8_t> data;
+	FILE *f = fopen(filename.c_str(), "rb");
+	if (!f)
+		return data;
+
+	uint8_t buf[4096];
+	size_t size;
+	while ((size = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data.insert(data.end(), buf, buf + size);
+	}
+	fclose(f);
+	return data;
+}
+
+/**
+ * Compare the register state of replayed audio ICs
+ * against the emulation context's audio ICs.
+ * @param ym2612 Replayed YM2612.
+ * @param psg Replayed PSG.
+ */
+void SoundCaptureTest::checkRegs(Ym2612 &ym2612, Psg &psg)
+{
+	Zomg_Ym2612Save_t ymExpected, ymActual;
+	m_context->m_soundMgr->m_ym2612.zomgSave(&ymExpected);
+	ym2612.zomgSave(&ymActual);
+	EXPECT_EQ(0, memcmp(ymExpected.reg, ymActual.reg, sizeof(ymExpected.reg)))
+		<< "YM2612 registers don't match the register log.";
+
+	Zomg_PsgSave_t psgExpected, psgActual;
+	m_context->m_soundMgr->m_psg.zomgSave(&psgExpected);
+	psg.zomgSave(&psgActual);
+	EXPECT_EQ(0, memcmp(psgExpected.tone_reg, psgActual.tone_reg, sizeof(psgExpected.tone_reg)))
+		<< "PSG tone registers don't match the register log.";
+	EXPECT_EQ(0, memcmp(psgExpected.vol_reg, psgActual.vol_reg, sizeof(psgExpected.vol_reg)))
+		<< "PSG volume registers don't match the register log.";
+}
+
+/**
+ * Capture a VGM file and replay it.
+ * The replayed registers must match the emulated registers,
+ * and the total wait time must match the emulated time.
+ */
+TEST_P(SoundCaptureTest, vgm)
+{
+	ASSERT_EQ(0, m_capture.start(m_regFilename.c_str(), SoundCapture::REGFMT_VGM, nullptr));
+	EXPECT_TRUE(m_capture.isRunning());
+	ASSERT_NO_FATAL_FAILURE(runCapture(TEST_FRAMES));
+	EXPECT_FALSE(m_capture.isRunning());
+
+	const vector<uint8_t> vgm = readFile(m_regFilename);
+	ASSERT_GE(vgm.size(), 0x41U);
+
+	// Check the header.
+	const uint8_t *const hdr = vgm.data();
+	ASSERT_EQ(0, memcmp(hdr, "Vgm ", 4));
+	EXPECT_EQ(vgm.size() - 4, le32(&hdr[0x04]));
+	EXPECT_EQ(0x150U, le32(&hdr[0x08]));
+	EXPECT_EQ((uint32_t)(CLOCK_NTSC / 15), le32(&hdr[0x0C]));
+	EXPECT_EQ(60U, le32(&hdr[0x24]));
+	EXPECT_EQ((uint32_t)(CLOCK_NTSC / 7), le32(&hdr[0x2C]));
+	ASSERT_EQ(0x0CU, le32(&hdr[0x34]));
+
+	// Expected length: TEST_FRAMES frames of 262 lines.
+	const uint64_t lines = (uint64_t)TEST_FRAMES * 262;
+	const uint32_t expectedSamples = (uint32_t)((lines * 44100 * 3420) / CLOCK_NTSC);
+	EXPECT_EQ(expectedSamples, le32(&hdr[0x18]));
+
+	// Replay the register writes.
+	Ym2612 ym2612;
+	ym2612.reInit((int)((double)CLOCK_NTSC / 7.0), 44100);
+	Psg psg;
+	psg.reInit((int)((double)CLOCK_NTSC / 15.0), 44100);
+
+	uint32_t samples = 0;
+	unsigned int ymWrites = 0, psgWrites = 0;
+	size_t pos = 0x40;
+	bool end = false;
+	while (!end && pos < vgm.size()) {
+		const uint8_t cmd = vgm[pos];
+		switch (cmd) {
+			case 0x50:
+				ASSERT_LE(pos + 2, vgm.size());
+				psg.write(vgm[pos+1]);
+				psgWrites++;
+				pos += 2;
+				break;
+			case 0x52:
+			case 0x53:
+				ASSERT_LE(pos + 3, vgm.size());
+				ym2612.write((cmd & 1) << 1, vgm[pos+1]);
+				ym2612.write(((cmd & 1) << 1) | 1, vgm[pos+2]);
+				ymWrites++;
+				pos += 3;
+				break;
+			case 0x61:
+				ASSERT_LE(pos + 3, vgm.size());
+				samples += le16(&vgm[pos+1]);
+				pos += 3;
+				break;
+			case 0x62:
+				samples += 735;
+				pos++;
+				break;
+			case 0x63:
+				samples += 882;
+				pos++;
+				break;
+			case 0x66:
+				end = true;
+				pos++;
+				break;
+			default:
+				ASSERT_EQ(0x70, cmd & 0xF0) << "Unexpected VGM command at offset " << pos;
+				samples += (cmd & 0x0F) + 1;
+				pos++;
+				break;
+		}
+	}
+	EXPECT_TRUE(end) << "VGM end command is missing.";
+	EXPECT_EQ(vgm.size(), pos) << "Data after the VGM end command.";
+	EXPECT_EQ(expectedSamples, samples);
+	EXPECT_GT(ymWrites + psgWrites, 0U);
+
+	checkRegs(ym2612, psg);
+}
+
+/**
+ * Capture a GYM file and replay it.
+ * The replayed registers must match the emulated registers,
+ * and there must be one wait command per frame.
+ */
+TEST_P(SoundCaptureTest, gym)
+{
+	ASSERT_EQ(0, m_capture.start(m_regFilename.c_str(), SoundCapture::REGFMT_GYM, nullptr));
+	ASSERT_NO_FATAL_FAILURE(runCapture(TEST_FRAMES));
+
+	const vector<uint8_t> gym = readFile(m_regFilename);
+
+	// Replay the register writes.
+	Ym2612 ym2612;
+	ym2612.reInit((int)((double)CLOCK_NTSC / 7.0), 44100);
+	Psg psg;
+	psg.reInit((int)((double)CLOCK_NTSC / 15.0), 44100);
+
+	int frames = 0;
+	size_t pos = 0;
+	while (pos < gym.size()) {
+		const uint8_t cmd = gym[pos];
+		switch (cmd) {
+			case 0x00:
+				frames++;
+				pos++;
+				break;
+			case 0x01:
+			case 0x02:
+				ASSERT_LE(pos + 3, gym.size());
+				ym2612.write((cmd - 1) << 1, gym[pos+1]);
+				ym2612.write(((cmd - 1) << 1) | 1, gym[pos+2]);
+				pos += 3;
+				break;
+			case 0x03:
+				ASSERT_LE(pos + 2, gym.size());
+				psg.write(gym[pos+1]);
+				pos += 2;
+				break;
+			default:
+				FAIL() << "Unexpected GYM command at offset " << pos;
+		}
+	}
+	EXPECT_EQ((int)TEST_FRAMES, frames);
+
+	checkRegs(ym2612, psg);
+}
+
+/**
+ * Capture a WAV file.
+ * The sample data must match the audio output.
+ */
+TEST_P(SoundCaptureTest, wav)
+{
+	ASSERT_EQ(0, m_capture.start(nullptr, SoundCapture::REGFMT_VGM, m_wavFilename.c_str()));
+	ASSERT_NO_FATAL_FAILURE(runCapture(TEST_FRAMES));
+	ASSERT_EQ((size_t)(TEST_FRAMES * 735 * 2), m_pcm.size());
+
+	const vector<uint8_t> wav = readFile(m_wavFilename);
+	const uint32_t dataSize = (uint32_t)(m_pcm.size() * sizeof(int16_t));
+	ASSERT_EQ(44 + dataSize, wav.size());
+
+	// Check the header.
+	const uint8_t *const hdr = wav.data();
+	EXPECT_EQ(0, memcmp(&hdr[0], "RIFF", 4));
+	EXPECT_EQ(36 + dataSize, le32(&hdr[4]));
+	EXPECT_EQ(0, memcmp(&hdr[8], "WAVEfmt ", 8));
+	EXPECT_EQ(16U, le32(&hdr[16]));
+	EXPECT_EQ(1U, le16(&hdr[20]));		// PCM
+	EXPECT_EQ(2U, le16(&hdr[22]));		// Channels
+	EXPECT_EQ(44100U, le32(&hdr[24]));	// Rate
+	EXPECT_EQ(44100U * 4, le32(&hdr[28]));	// Bytes per second
+	EXPECT_EQ(4U, le16(&hdr[32]));		// Block alignment
+	EXPECT_EQ(16U, le16(&hdr[34]));		// Bits per sample
+	EXPECT_EQ(0, memcmp(&hdr[36], "data", 4));
+	EXPECT_EQ(dataSize, le32(&hdr[40]));
+
+	// Check the sample data.
+	for (size_t i = 0; i < m_pcm.size(); i++) {
+		const int16_t sample = (int16_t)le16(&wav[44 + (i * 2)]);
+		ASSERT_EQ(m_pcm[i], sample) << "Sample " << i << " doesn't match.";
+	}
+}
+
+/**
+ * Capture both a register log and a WAV file,
+ * then start a second capture with the same object.
+ */
+TEST_P(SoundCaptureTest, restart)
+{
+	ASSERT_EQ(0, m_capture.start(m_regFilename.c_str(), SoundCapture::REGFMT_VGM, m_wavFilename.c_str()));
+	EXPECT_EQ(-EBUSY, m_capture.start(m_regFilename.c_str(), SoundCapture::REGFMT_VGM, nullptr));
+	ASSERT_NO_FATAL_FAILURE(runCapture(TEST_FRAMES / 2));
+
+	const vector<uint8_t> wav1 = readFile(m_wavFilename);
+	ASSERT_EQ((size_t)(44 + (TEST_FRAMES / 2) * 735 * 4), wav1.size());
+
+	// Second capture. Timestamps restart at 0.
+	ASSERT_EQ(0, m_capture.start(m_regFilename.c_str(), SoundCapture::REGFMT_VGM, m_wavFilename.c_str()));
+	ASSERT_NO_FATAL_FAILURE(runCapture(TEST_FRAMES / 2));
+
+	const vector<uint8_t> vgm = readFile(m_regFilename);
+	ASSERT_GE(vgm.size(), 0x41U);
+	const uint64_t lines = (uint64_t)(TEST_FRAMES / 2) * 262;
+	EXPECT_EQ((uint32_t)((lines * 44100 * 3420) / CLOCK_NTSC), le32(&vgm[0x18]));
+
+	const vector<uint8_t> wav2 = readFile(m_wavFilename);
+	EXPECT_EQ(wav1.size(), wav2.size());
+
+	// Nothing to capture.
+	EXPECT_EQ(-EINVAL, m_capture.start(nullptr, SoundCapture::REGFMT_VGM, nullptr));
+	EXPECT_FALSE(m_capture.isRunning());
+}
+
+/**
+ * Log more register writes than fit in the initial buffer pool
+ * without giving the writer thread a chance to catch up.
+ * Register writes must never be dropped.
+ */
+TEST_P(SoundCaptureTest, regNoDrop)
+{
+	// 16 x 64 KB blocks hold about 350,000 GYM YM2612 writes.
+	static const unsigned int WRITES = 1000000;
+	ASSERT_EQ(0, m_capture.start(m_regFilename.c_str(), SoundCapture::REGFMT_GYM, nullptr));
+	for (unsigned int i = 0; i < WRITES; i++) {
+		m_capture.logYm2612(i & 1, (uint8_t)(0x30 + (i % 0x80)), (uint8_t)i, 0);
+	}
+	EXPECT_EQ(0, m_capture.stop());
+	EXPECT_EQ(0U, m_capture.dropped());
+
+	const vector<uint8_t> gym = readFile(m_regFilename);
+	ASSERT_EQ((size_t)(WRITES * 3), gym.size());
+	for (unsigned int i = 0; i < WRITES; i++) {
+		const uint8_t *const cmd = &gym[i * 3];
+		ASSERT_EQ(0x01 + (i & 1), cmd[0]) << "Write " << i << " doesn't match.";
+		ASSERT_EQ((uint8_t)(0x30 + (i % 0x80)), cmd[1]) << "Write " << i << " doesn't match.";
+		ASSERT_EQ((uint8_t)i, cmd[2]) << "Write " << i << " doesn't match.";
+	}
+}
+
+#ifdef __linux__
+/**
+ * Capture to a device that's always full.
+ * The write error must be returned by stop().
+ */
+TEST_P(SoundCaptureTest, writeError)
+{
+	// Log enough writes to fill several blocks.
+	ASSERT_EQ(0, m_capture.start("/dev/full", SoundCapture::REGFMT_GYM, nullptr));
+	for (unsigned int i = 0; i < 100000; i++) {
+		m_capture.logPsg((uint8_t)i, 0);
+	}
+	EXPECT_EQ(-ENOSPC, m_capture.stop());
+	EXPECT_FALSE(m_capture.isRunning());
+}
+#endif /* __linux__ */
+
+INSTANTIATE_TEST_CASE_P(SyntheticRoms, SoundCaptureTest,
+	::testing::Values(
+		SyntheticRom::ROM_YM2612,
+		SyntheticRom::ROM_Z80
+));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Sound capture tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
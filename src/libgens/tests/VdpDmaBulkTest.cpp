@@ -0,0 +1,302 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VdpDmaBulkTest.cpp: VDP bulk DMA tests.                                 *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+#include "cpu/M68K_Mem.hpp"
+
+// Feature on/off comparison test fixture.
+#include "FeatureToggleTest.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Bulk DMA tests.
+ * The plane and pattern caches are enabled in the
+ * bulk DMA context to check span invalidation.
+ */
+class VdpDmaBulkTest : public FeatureToggleTest
+{
+	protected:
+		VdpDmaBulkTest()
+			: FeatureToggleTest() { }
+		virtual ~VdpDmaBulkTest() { }
+
+		virtual void SetUp(void) override;
+
+		virtual int setFeature(EmuMD *context, bool enable) override
+			{ return context->m_vdp->setDmaBulk(enable); }
+		virtual bool isFeatureEnabled(EmuMD *context) override
+			{ return context->m_vdp->isDmaBulkEnabled(); }
+
+		/**
+		 * Compare the framebuffers and VRAM of both contexts.
+		 * @param what Description, for error messages.
+		 */
+		virtual void checkState(const char *what) override;
+
+		/**
+		 * Run a 68K->VRAM DMA in both contexts.
+		 * @param src Source address. (68K address space)
+		 * @param dest Destination VRAM address.
+		 * @param words Length, in words.
+		 * @param autoInc Auto-increment value.
+		 */
+		void dmaVRam(uint32_t src, uint16_t dest, uint16_t words, uint8_t autoInc);
+
+		/**
+		 * Run a DMA FILL to VRAM in both contexts.
+		 * @param dest Destination VRAM address.
+		 * @param length Length, in bytes. (0 == 65536)
+		 * @param data Fill data.
+		 * @param autoInc Auto-increment value.
+		 */
+		void dmaFill(uint16_t dest, uint16_t length, uint16_t data, uint8_t autoInc);
+};
+
+/**
+ * Set up the emulation contexts for the synthetic ROM.
+ */
+void VdpDmaBulkTest::SetUp(void)
+{
+	ASSERT_NO_FATAL_FAILURE(FeatureToggleTest::SetUp());
+
+	Vdp *const vdp1 = m_context[1]->m_vdp;
+	ASSERT_EQ(0, vdp1->setPlaneCache(true));
+	ASSERT_EQ(0, vdp1->setPatternCache(true));
+
+	// Fill 68K RAM with a pattern for RAM->VRAM DMA.
+	for (int i = 0; i < 2; i++) {
+		M68K_Mem *const m68kMem = m_context[i]->m_m68kMem;
+		for (unsigned int j = 0; j < ARRAY_SIZE(m68kMem->Ram_68k.u16); j++) {
+			m68kMem->Ram_68k.u16[j] = (uint16_t)((j * 0x9E37) ^ (j >> 3));
+		}
+	}
+}
+
+/**
+ * Compare the framebuffers and VRAM of both contexts.
+ * @param what Description, for error messages.
+ */
+void VdpDmaBulkTest::checkState(const char *what)
+{
+	ASSERT_NO_FATAL_FAILURE(FeatureToggleTest::checkState(what));
+
+	// Read VRAM back through the data port.
+	// Snapshots can't be compared directly, since
+	// the ZOMG archive includes a timestamp.
+	vector<uint16_t> vram[2];
+	uint32_t address[2];
+	for (int i = 0; i < 2; i++) {
+		Vdp *const vdp = m_context[i]->m_vdp;
+		ASSERT_EQ(0, vdp->dbg_getAddress(&address[i]));
+		vdp->writeCtrlMD(0x8F02);
+		vdp->writeCtrlMD(0x0000);	// VRAM read, $0000
+		vdp->writeCtrlMD(0x0000);
+		vram[i].resize(0x8000);
+		for (unsigned int j = 0; j < vram[i].size(); j++) {
+			vram[i][j] = vdp->readDataMD();
+		}
+	}
+	EXPECT_EQ(address[0], address[1]) << "VDP addresses differ: " << what;
+	for (unsigned int j = 0; j < vram[0].size(); j++) {
+		ASSERT_EQ(vram[0][j], vram[1][j])
+			<< "VRAM word $" << std::hex << (j * 2) << " differs: " << what;
+	}
+}
+
+/**
+ * Run a 68K->VRAM DMA in both contexts.
+ * @param src Source address. (68K address space)
+ * @param dest Destination VRAM address.
+ * @param words Length, in words.
+ * @param autoInc Auto-increment value.
+ */
+void VdpDmaBulkTest::dmaVRam(uint32_t src, uint16_t dest, uint16_t words, uint8_t autoInc)
+{
+	for (int i = 0; i < 2; i++) {
+		Vdp *const vdp = m_context[i]->m_vdp;
+		uint8_t reg1;
+		ASSERT_EQ(0, vdp->dbg_getReg(1, &reg1));
+
+		vdp->writeCtrlMD(0x8100 | reg1 | 0x10);		// Enable DMA.
+		vdp->writeCtrlMD(0x8F00 | autoInc);
+		vdp->writeCtrlMD(0x9300 | (words & 0xFF));
+		vdp->writeCtrlMD(0x9400 | (words >> 8));
+		vdp->writeCtrlMD(0x9500 | ((src >> 1) & 0xFF));
+		vdp->writeCtrlMD(0x9600 | ((src >> 9) & 0xFF));
+		vdp->writeCtrlMD(0x9700 | ((src >> 17) & 0x7F));	// 68K->VDP.
+		vdp->writeCtrlMD(0x4000 | (dest & 0x3FFF));
+		vdp->writeCtrlMD(0x0080 | (dest >> 14));
+
+		vdp->writeCtrlMD(0x8F02);
+		vdp->writeCtrlMD(0x8100 | reg1);
+	}
+}
+
+/**
+ * Run a DMA FILL to VRAM in both contexts.
+ * @param dest Destination VRAM address.
+ * @param length Length, in bytes. (0 == 65536)
+ * @param data Fill data.
+ * @param autoInc Auto-increment value.
+ */
+void VdpDmaBulkTest::dmaFill(uint16_t dest, uint16_t length, uint16_t data, uint8_t autoInc)
+{
+	for (int i = 0; i < 2; i++) {
+		Vdp *const vdp = m_context[i]->m_vdp;
+		uint8_t reg1;
+		ASSERT_EQ(0, vdp->dbg_getReg(1, &reg1));
+
+		vdp->writeCtrlMD(0x8100 | reg1 | 0x10);		// Enable DMA.
+		vdp->writeCtrlMD(0x8F00 | autoInc);
+		vdp->writeCtrlMD(0x9300 | (length & 0xFF));
+		vdp->writeCtrlMD(0x9400 | (length >> 8));
+		vdp->writeCtrlMD(0x9780);			// DMA FILL.
+		vdp->writeCtrlMD(0x4000 | (dest & 0x3FFF));
+		vdp->writeCtrlMD(0x0080 | (dest >> 14));
+		vdp->writeDataMD(data);
+
+		vdp->writeCtrlMD(0x8F02);
+		vdp->writeCtrlMD(0x8100 | reg1);
+	}
+}
+
+FEATURE_TOGGLE_TESTS(VdpDmaBulkTest);
+
+/**
+ * 68K->VRAM DMA edge cases.
+ * Transfers that can't be copied in a single span
+ * must be split or use the word-by-word path.
+ */
+TEST_P(VdpDmaBulkTest, memToVRam)
+{
+	static const struct {
+		uint32_t src;
+		uint16_t dest;
+		uint16_t words;
+		uint8_t autoInc;
+		const char *what;
+	} tests[] = {
+		{0x000200, 0x0000, 0x0800, 2, "ROM to VRAM $0000"},
+		{0xFF0000, 0x2000, 0x1000, 2, "RAM to VRAM $2000"},
+		{0x00FF00, 0x1000, 0x0100, 2, "ROM across the end of the ROM"},
+		{0xFFFF00, 0x1800, 0x0100, 2, "RAM across the end of RAM"},
+		{0xFF8000, 0xFF00, 0x0100, 2, "VRAM wraparound"},
+		{0xFF1000, 0x0001, 0x0080, 2, "odd VRAM address"},
+		{0xFF2000, 0x3000, 0x0080, 4, "auto-increment 4"},
+		{0xFF3000, 0x0000, 0x0000, 2, "64K words"},
+	};
+
+	for (int frame = 0; frame < 4; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Include the Sprite Attribute Table in some transfers.
+	uint8_t reg5;
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(5, &reg5));
+	const uint16_t sat = (reg5 & 0x7F) << 9;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(tests); i++) {
+		dmaVRam(tests[i].src, tests[i].dest, tests[i].words, tests[i].autoInc);
+		ASSERT_NO_FATAL_FAILURE(checkState(tests[i].what));
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(i));
+	}
+
+	// Partial Sprite Attribute Table updates.
+	dmaVRam(0xFF4000, sat - 0x40, 0x40, 2);
+	ASSERT_NO_FATAL_FAILURE(runAndCheck(100));
+	dmaVRam(0xFF5000, sat + 0x100, 0x400, 2);
+	ASSERT_NO_FATAL_FAILURE(runAndCheck(101));
+
+	// Same data again: Nothing should change.
+	dmaVRam(0xFF5000, sat + 0x100, 0x400, 2);
+	ASSERT_NO_FATAL_FAILURE(runAndCheck(102));
+}
+
+/**
+ * DMA FILL edge cases.
+ */
+TEST_P(VdpDmaBulkTest, fill)
+{
+	static const struct {
+		uint16_t dest;
+		uint16_t length;
+		uint16_t data;
+		uint8_t autoInc;
+		const char *what;
+	} tests[] = {
+		{0x0000, 0x0800, 0x1122, 1, "even address, even length"},
+		{0x1001, 0x0800, 0x3344, 1, "odd address"},
+		{0x2000, 0x0801, 0x5566, 1, "odd length"},
+		{0xFF00, 0x0200, 0x7788, 1, "VRAM wraparound"},
+		{0x3000, 0x0400, 0x99AA, 2, "auto-increment 2"},
+		{0x0000, 0x0000, 0xBBCC, 1, "64 KB"},
+	};
+
+	for (int frame = 0; frame < 4; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	uint8_t reg5;
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(5, &reg5));
+	const uint16_t sat = (reg5 & 0x7F) << 9;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(tests); i++) {
+		dmaFill(tests[i].dest, tests[i].length, tests[i].data, tests[i].autoInc);
+		ASSERT_NO_FATAL_FAILURE(checkState(tests[i].what));
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(i));
+	}
+
+	// Partial Sprite Attribute Table fill.
+	dmaFill(sat + 0x20, 0x40, 0x0000, 1);
+	ASSERT_NO_FATAL_FAILURE(runAndCheck(100));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: VDP bulk DMA tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
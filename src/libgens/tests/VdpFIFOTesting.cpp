@@ -304,9 +304,8 @@ void VdpFIFOTesting::runUntilPrompt(void)
 	int promptCount = 0;
 	while (promptCount < 5) {
 		m_context->execFrame();
-		// TODO: M68K should be part of m_context, not static.
 		// TODO: Make register accessors instead of doing a whole context save.
-		M68K::ZomgSaveReg(&reg);
+		m_context->m_m68k->zomgSaveReg(&reg);
 
 		if (reg.pc >= DisplayProgressiveResultsScreenWaitForInput &&
 		    reg.pc < DisplayProgressiveResultsScreenEntriesFinished)
@@ -319,7 +318,7 @@ void VdpFIFOTesting::runUntilPrompt(void)
 
 	// Go to the next screen.
 	reg.pc = DisplayProgressiveResultsScreenEntriesFinished;
-	M68K::ZomgRestoreReg(&reg);
+	m_context->m_m68k->zomgRestoreReg(&reg);
 }
 
 /**
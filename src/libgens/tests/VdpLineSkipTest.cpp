@@ -0,0 +1,238 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VdpLineSkipTest.cpp: VDP skip-unchanged-line rendering tests.           *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+
+// Feature on/off comparison test fixture.
+#include "FeatureToggleTest.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+namespace LibGens { namespace Tests {
+
+class VdpLineSkipTest : public FeatureToggleTest
+{
+	protected:
+		VdpLineSkipTest()
+			: FeatureToggleTest() { }
+		virtual ~VdpLineSkipTest() { }
+
+		virtual int setFeature(EmuMD *context, bool enable) override
+			{ return context->m_vdp->setLineSkip(enable); }
+		virtual bool isFeatureEnabled(EmuMD *context) override
+			{ return context->m_vdp->isLineSkipEnabled(); }
+
+		/**
+		 * Compare the framebuffers and status registers.
+		 * @param what Description, for error messages.
+		 */
+		virtual void checkState(const char *what) override;
+
+		/**
+		 * Check the line skip statistics.
+		 */
+		virtual void checkStats(void) override;
+
+		/**
+		 * Write a VDP register in both contexts.
+		 * @param reg_num Register number.
+		 * @param val New value.
+		 */
+		void writeReg(int reg_num, uint8_t val);
+};
+
+/**
+ * Compare the framebuffers and status registers.
+ * @param what Description, for error messages.
+ */
+void VdpLineSkipTest::checkState(const char *what)
+{
+	ASSERT_NO_FATAL_FAILURE(FeatureToggleTest::checkState(what));
+
+	// Skipped lines must still set the sprite collision flag.
+	// NOTE: Reading the status register clears the flags
+	// in both contexts, so this is still deterministic.
+	ASSERT_EQ(m_context[0]->m_vdp->readCtrlMD(), m_context[1]->m_vdp->readCtrlMD())
+		<< "Status register differs: " << what;
+}
+
+/**
+ * Check the line skip statistics.
+ */
+void VdpLineSkipTest::checkStats(void)
+{
+	VdpLineSkip::Stats stats;
+	m_context[1]->m_vdp->takeLineSkipStats(&stats);
+	printf("Line skip: %llu rendered, %llu skipped\n",
+		(unsigned long long)stats.rendered,
+		(unsigned long long)stats.skipped);
+	EXPECT_GT(stats.rendered, 0U);
+	if (GetParam() == SyntheticRom::ROM_YM2612) {
+		// Static screen. Most lines should be skipped.
+		EXPECT_GT(stats.skipped, stats.rendered);
+	}
+
+	// Stats are reset after reading them.
+	m_context[1]->m_vdp->takeLineSkipStats(&stats);
+	EXPECT_EQ(0U, stats.rendered);
+	EXPECT_EQ(0U, stats.skipped);
+}
+
+/**
+ * Write a VDP register in both contexts.
+ * @param reg_num Register number.
+ * @param val New value.
+ */
+void VdpLineSkipTest::writeReg(int reg_num, uint8_t val)
+{
+	for (int i = 0; i < 2; i++) {
+		m_context[i]->m_vdp->writeCtrlMD(0x8000 | (reg_num << 8) | val);
+	}
+}
+
+FEATURE_TOGGLE_TESTS(VdpLineSkipTest);
+
+/**
+ * Modify CRAM, VSRAM, VDP registers, and VRAM between frames.
+ * Affected lines must be redrawn.
+ */
+TEST_P(VdpLineSkipTest, vdpWrites)
+{
+	int frame = 0;
+	for (; frame < 8; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// CRAM: Change a color in each palette line.
+	// The first write is repeated, which must not change anything.
+	for (int pass = 0; pass < 3; pass++) {
+		const uint16_t color = (pass < 2 ? 0x0E02 : 0x008E);
+		for (int pal = 0; pal < 4; pal++) {
+			writeData(0xC000 | ((pal * 16 + 1) * 2), 0x0000, &color, 1);
+		}
+		for (int end = frame + 4; frame < end; frame++) {
+			ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+		}
+	}
+
+	// VSRAM: Scroll both planes vertically.
+	const uint16_t vscroll[2] = {0x0013, 0x0027};
+	writeData(0x4000, 0x0010, vscroll, 2);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Registers: Background color, then Shadow/Highlight.
+	uint8_t reg12;
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(12, &reg12));
+	writeReg(7, 0x25);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+	writeReg(12, reg12 | 0x08);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+	writeReg(12, reg12);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Display off, then back on.
+	uint8_t reg1;
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(1, &reg1));
+	writeReg(1, reg1 & ~0x40);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+	writeReg(1, reg1);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// VRAM: Overwrite the first 64 tiles.
+	uint16_t pattern[64*16];
+	for (int i = 0; i < 64*16; i++) {
+		pattern[i] = 0x1234 + (i * 0x1111);
+	}
+	writeData(0x4000, 0x0000, pattern, 64*16);
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Sprite limits.
+	m_context[0]->m_vdp->options.spriteLimits = false;
+	m_context[1]->m_vdp->options.spriteLimits = false;
+	for (int end = frame + 4; frame < end; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+}
+
+/**
+ * Rotate between three framebuffers, like a triple-buffered frontend.
+ * Each framebuffer keeps the image from three frames earlier.
+ */
+TEST_P(VdpLineSkipTest, fbRotation)
+{
+	MdFb *fbs[3];
+	for (int i = 0; i < 3; i++) {
+		fbs[i] = new MdFb();
+		fbs[i]->setBpp(MdFb::BPP_32);
+		fbs[i]->clear();
+	}
+
+	for (int frame = 0; frame < TEST_FRAMES; frame++) {
+		MdFb *const fb = fbs[frame % 3];
+		fb->copyParams(m_context[1]->m_vdp->MD_Screen);
+		m_context[1]->m_vdp->setMdScreen(fb);
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	for (int i = 0; i < 3; i++) {
+		fbs[i]->unref();
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: VDP skip-unchanged-line rendering tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
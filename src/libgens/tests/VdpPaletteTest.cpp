@@ -0,0 +1,260 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VdpPaletteTest.cpp: VDP palette dirty entry tests.                      *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+
+// LibGens VDP.
+#include "Vdp/VdpPalette.hpp"
+#include "Util/MdFb.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+struct VdpPaletteTest_mode
+{
+	uint8_t m5m4bits;	// M5/M4 bits.
+	bool shadowHighlight;	// Shadow/Highlight.
+	MdFb::ColorDepth bpp;	// Color depth.
+
+	VdpPaletteTest_mode(uint8_t m5m4bits, bool shadowHighlight, MdFb::ColorDepth bpp)
+		: m5m4bits(m5m4bits)
+		, shadowHighlight(shadowHighlight)
+		, bpp(bpp) { }
+};
+
+/**
+ * Formatting function for VdpPaletteTest.
+ */
+inline ::std::ostream& operator<<(::std::ostream& os, const VdpPaletteTest_mode& mode) {
+	return os << "M5M4=" << (int)mode.m5m4bits
+		<< (mode.shadowHighlight ? ", S/H" : "")
+		<< ", " << MdFb::colorDepthToBpp(mode.bpp) << "bpp";
+};
+
+/**
+ * Compare per-entry active palette updates against
+ * full active palette updates.
+ */
+class VdpPaletteTest : public ::testing::TestWithParam<VdpPaletteTest_mode>
+{
+	protected:
+		VdpPaletteTest()
+			: ::testing::TestWithParam<VdpPaletteTest_mode>()
+			, m_seed(0x2545F491) { }
+		virtual ~VdpPaletteTest() { }
+
+		virtual void SetUp(void) override;
+
+	protected:
+		// [0] == per-entry updates
+		// [1] == reference; CRAM is reloaded before each
+		//        update, so the full palette is recalculated.
+		VdpPalette m_palette[2];
+
+		// Pseudo-random number generator state.
+		uint32_t m_seed;
+
+		/**
+		 * Get a pseudo-random number. (xorshift32)
+		 * @return Pseudo-random number.
+		 */
+		uint32_t rand32(void);
+
+		/**
+		 * Update both palettes and compare them.
+		 * @param iteration Iteration number, for error messages.
+		 */
+		void updateAndCheck(int iteration);
+};
+
+/**
+ * Set up the palettes.
+ */
+void VdpPaletteTest::SetUp(void)
+{
+	const VdpPaletteTest_mode &mode = GetParam();
+	for (int i = 0; i < 2; i++) {
+		VdpPalette *const palette = &m_palette[i];
+		palette->setPalMode(VdpPalette::PALMODE_MD);
+		palette->setBpp(mode.bpp);
+		palette->setM5M4bits(mode.m5m4bits);
+		palette->setMdShadowHighlight(mode.shadowHighlight);
+		for (int j = 0; j < 64; j++) {
+			palette->writeCRam_16(j * 2, (uint16_t)(j * 0x123));
+		}
+	}
+	updateAndCheck(-1);
+}
+
+/**
+ * Get a pseudo-random number. (xorshift32)
+ * @return Pseudo-random number.
+ */
+uint32_t VdpPaletteTest::rand32(void)
+{
+	m_seed ^= (m_seed << 13);
+	m_seed ^= (m_seed >> 17);
+	m_seed ^= (m_seed << 5);
+	return m_seed;
+}
+
+/**
+ * Update both palettes and compare them.
+ * @param iteration Iteration number, for error messages.
+ */
+void VdpPaletteTest::updateAndCheck(int iteration)
+{
+	// Reloading CRAM marks the entire active palette as dirty.
+	Zomg_CRam_t cram;
+	m_palette[1].zomgSaveCRam(&cram);
+	m_palette[1].zomgRestoreCRam(&cram);
+
+	for (int i = 0; i < 2; i++) {
+		m_palette[i].update();
+		EXPECT_FALSE(m_palette[i].isDirty());
+	}
+
+	// S/H entries are only valid if S/H is enabled.
+	// Mode 4 only has 32 colors.
+	int entries = (GetParam().shadowHighlight ? 256 : 64);
+	if (!(GetParam().m5m4bits & 0x02))
+		entries = 32;
+	if (GetParam().bpp == MdFb::BPP_32) {
+		for (int i = 0; i < entries; i++) {
+			ASSERT_EQ(m_palette[1].m_palActive.u32[i], m_palette[0].m_palActive.u32[i])
+				<< "Iteration " << iteration << ", entry " << i;
+		}
+	} else {
+		for (int i = 0; i < entries; i++) {
+			ASSERT_EQ(m_palette[1].m_palActive.u16[i], m_palette[0].m_palActive.u16[i])
+				<< "Iteration " << iteration << ", entry " << i;
+		}
+	}
+}
+
+/**
+ * A few CRAM writes per update, like raster effects.
+ */
+TEST_P(VdpPaletteTest, rasterWrites)
+{
+	for (int iteration = 0; iteration < 2000; iteration++) {
+		const int writes = (rand32() & 3) + 1;
+		for (int i = 0; i < writes; i++) {
+			const uint32_t r = rand32();
+			const uint8_t address = ((r >> 16) & 0x7E);
+			for (int j = 0; j < 2; j++) {
+				m_palette[j].writeCRam_16(address, (uint16_t)(r & 0xEEE));
+			}
+		}
+		ASSERT_NO_FATAL_FAILURE(updateAndCheck(iteration));
+	}
+}
+
+/**
+ * Writes to the background color entry.
+ */
+TEST_P(VdpPaletteTest, bgColor)
+{
+	for (int iteration = 0; iteration < 256; iteration++) {
+		const uint32_t r = rand32();
+		const uint8_t bgColorIdx = (r >> 24) & 0x3F;
+		for (int j = 0; j < 2; j++) {
+			if (iteration & 1) {
+				m_palette[j].setBgColorIdx(bgColorIdx);
+			}
+			// Write to the background color and to color 0.
+			m_palette[j].writeCRam_16(m_palette[j].bgColorIdx() * 2, (uint16_t)(r & 0xEEE));
+			m_palette[j].writeCRam_16(0, (uint16_t)((r >> 12) & 0xEEE));
+		}
+		ASSERT_NO_FATAL_FAILURE(updateAndCheck(iteration));
+	}
+}
+
+/**
+ * Byte writes to CRAM.
+ */
+TEST_P(VdpPaletteTest, byteWrites)
+{
+	for (int iteration = 0; iteration < 512; iteration++) {
+		const uint32_t r = rand32();
+		const uint8_t address = ((r >> 16) & 0x7F);
+		for (int j = 0; j < 2; j++) {
+			m_palette[j].writeCRam_8(address, (uint8_t)(r & 0xEE));
+		}
+		ASSERT_NO_FATAL_FAILURE(updateAndCheck(iteration));
+	}
+}
+
+/**
+ * Rewriting the same value must not dirty the palette.
+ */
+TEST_P(VdpPaletteTest, sameValue)
+{
+	const uint32_t gen = m_palette[0].activeGen();
+	m_palette[0].writeCRam_16(0x10, m_palette[0].readCRam_16(0x10));
+	EXPECT_FALSE(m_palette[0].isDirty());
+	m_palette[0].update();
+	EXPECT_EQ(gen, m_palette[0].activeGen());
+
+	// A different value must update the palette.
+	m_palette[0].writeCRam_16(0x10, m_palette[0].readCRam_16(0x10) ^ 0x00E);
+	EXPECT_TRUE(m_palette[0].isDirty());
+	m_palette[0].update();
+	EXPECT_NE(gen, m_palette[0].activeGen());
+}
+
+INSTANTIATE_TEST_CASE_P(VdpPaletteModes, VdpPaletteTest,
+	::testing::Values(
+		VdpPaletteTest_mode(0x03, false, MdFb::BPP_32),
+		VdpPaletteTest_mode(0x03, true,  MdFb::BPP_32),
+		VdpPaletteTest_mode(0x02, false, MdFb::BPP_32),
+		VdpPaletteTest_mode(0x02, true,  MdFb::BPP_32),
+		VdpPaletteTest_mode(0x03, false, MdFb::BPP_16),
+		VdpPaletteTest_mode(0x03, true,  MdFb::BPP_16),
+		VdpPaletteTest_mode(0x03, true,  MdFb::BPP_15),
+		// Mode 4 always uses the full update.
+		VdpPaletteTest_mode(0x01, false, MdFb::BPP_32)
+));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: VDP palette dirty entry tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
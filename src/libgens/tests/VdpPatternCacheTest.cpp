@@ -0,0 +1,293 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VdpPatternCacheTest.cpp: VDP pattern cache tests.                       *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+
+// Feature on/off comparison test fixture.
+#include "FeatureToggleTest.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class VdpPatternCacheTest : public FeatureToggleTest
+{
+	protected:
+		VdpPatternCacheTest()
+			: FeatureToggleTest() { }
+		virtual ~VdpPatternCacheTest() { }
+
+		virtual int setFeature(EmuMD *context, bool enable) override
+			{ return context->m_vdp->setPatternCache(enable); }
+		virtual bool isFeatureEnabled(EmuMD *context) override
+			{ return context->m_vdp->isPatternCacheEnabled(); }
+
+		/**
+		 * Check the pattern cache statistics.
+		 */
+		virtual void checkStats(void) override;
+
+	protected:
+		// Snapshot buffer size.
+		static const size_t SNAPSHOT_BUF_SIZE = 1024*1024;
+
+		/**
+		 * Run a DMA FILL to VRAM in both contexts.
+		 * @param address VRAM address.
+		 * @param length Length, in bytes.
+		 * @param data Fill data.
+		 */
+		void dmaFill(uint16_t address, uint16_t length, uint16_t data);
+
+		/**
+		 * Run a DMA COPY within VRAM in both contexts.
+		 * @param src Source VRAM address.
+		 * @param dest Destination VRAM address.
+		 * @param length Length, in bytes.
+		 */
+		void dmaCopy(uint16_t src, uint16_t dest, uint16_t length);
+
+		/**
+		 * Set the VDP address for a VRAM write.
+		 * @param vdp VDP.
+		 * @param address VRAM address.
+		 * @param dma If true, start a DMA operation.
+		 * @param copy If true, this is a DMA COPY.
+		 */
+		static void setVRamAddr(Vdp *vdp, uint16_t address, bool dma, bool copy);
+};
+
+/**
+ * Check the pattern cache statistics.
+ */
+void VdpPatternCacheTest::checkStats(void)
+{
+	VdpCache::Stats stats;
+	m_context[1]->m_vdp->takePatternCacheStats(&stats);
+	printf("Pattern cache: %llu lines decoded, %llu invalidations\n",
+		(unsigned long long)stats.lines,
+		(unsigned long long)stats.invalidations);
+	// The first update decodes the entire cache.
+	EXPECT_GE(stats.lines, 2048U * 8);
+	EXPECT_GT(stats.invalidations, 0U);
+
+	// Stats are reset after reading them.
+	m_context[1]->m_vdp->takePatternCacheStats(&stats);
+	EXPECT_EQ(0U, stats.lines);
+	EXPECT_EQ(0U, stats.invalidations);
+}
+
+/**
+ * Set the VDP address for a VRAM write.
+ * @param vdp VDP.
+ * @param address VRAM address.
+ * @param dma If true, start a DMA operation.
+ * @param copy If true, this is a DMA COPY.
+ */
+void VdpPatternCacheTest::setVRamAddr(Vdp *vdp, uint16_t address, bool dma, bool copy)
+{
+	// CD1-CD0: 01 == VRAM write; 00 == VRAM read. (DMA COPY)
+	// CD5: DMA; CD4: DMA COPY.
+	uint16_t cd_hi = (address >> 14);
+	if (dma)
+		cd_hi |= 0x80;
+	if (copy)
+		cd_hi |= 0x40;
+	vdp->writeCtrlMD((copy ? 0x0000 : 0x4000) | (address & 0x3FFF));
+	vdp->writeCtrlMD(cd_hi);
+}
+
+/**
+ * Run a DMA FILL to VRAM in both contexts.
+ * @param address VRAM address.
+ * @param length Length, in bytes.
+ * @param data Fill data.
+ */
+void VdpPatternCacheTest::dmaFill(uint16_t address, uint16_t length, uint16_t data)
+{
+	for (int i = 0; i < 2; i++) {
+		Vdp *const vdp = m_context[i]->m_vdp;
+		uint8_t reg1;
+		ASSERT_EQ(0, vdp->dbg_getReg(1, &reg1));
+
+		vdp->writeCtrlMD(0x8100 | reg1 | 0x10);		// Enable DMA.
+		vdp->writeCtrlMD(0x8F01);			// Auto-increment by one byte.
+		vdp->writeCtrlMD(0x9300 | (length & 0xFF));
+		vdp->writeCtrlMD(0x9400 | (length >> 8));
+		vdp->writeCtrlMD(0x9780);			// DMA FILL.
+		setVRamAddr(vdp, address, true, false);
+		vdp->writeDataMD(data);
+
+		vdp->writeCtrlMD(0x8F02);
+		vdp->writeCtrlMD(0x8100 | reg1);
+	}
+}
+
+/**
+ * Run a DMA COPY within VRAM in both contexts.
+ * @param src Source VRAM address.
+ * @param dest Destination VRAM address.
+ * @param length Length, in bytes.
+ */
+void VdpPatternCacheTest::dmaCopy(uint16_t src, uint16_t dest, uint16_t length)
+{
+	for (int i = 0; i < 2; i++) {
+		Vdp *const vdp = m_context[i]->m_vdp;
+		uint8_t reg1;
+		ASSERT_EQ(0, vdp->dbg_getReg(1, &reg1));
+
+		vdp->writeCtrlMD(0x8100 | reg1 | 0x10);		// Enable DMA.
+		vdp->writeCtrlMD(0x8F01);			// Auto-increment by one byte.
+		vdp->writeCtrlMD(0x9300 | (length & 0xFF));
+		vdp->writeCtrlMD(0x9400 | (length >> 8));
+		vdp->writeCtrlMD(0x9500 | (src & 0xFF));
+		vdp->writeCtrlMD(0x9600 | (src >> 8));
+		vdp->writeCtrlMD(0x97C0);			// DMA COPY.
+		setVRamAddr(vdp, dest, true, true);
+
+		vdp->writeCtrlMD(0x8F02);
+		vdp->writeCtrlMD(0x8100 | reg1);
+	}
+}
+
+FEATURE_TOGGLE_TESTS(VdpPatternCacheTest);
+
+/**
+ * Modify patterns between frames using the data port,
+ * DMA FILL, and DMA COPY. Only the modified pattern
+ * lines may be decoded again.
+ */
+TEST_P(VdpPatternCacheTest, vramWrites)
+{
+	for (int frame = 0; frame < 8; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Get the nametable addresses.
+	uint8_t reg2, reg4;
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(2, &reg2));
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(4, &reg4));
+	const uint16_t scrA = (reg2 & 0x38) << 10;
+	const uint16_t scrB = (reg4 & 0x07) << 13;
+
+	// Overwrite both nametables. (64x32)
+	// Alternate between tiles 1 and 2, with all four flip
+	// combinations and both priorities.
+	uint16_t nt[64*32];
+	for (int i = 0; i < 64*32; i++) {
+		nt[i] = ((i & 1) ? 0x0001 : 0x0002) | ((i & 6) << 10) | ((i & 8) << 12);
+	}
+	writeVRam(scrA, nt, 64*32);
+	writeVRam(scrB, nt, 64*32);
+	for (int frame = 8; frame < 16; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Overwrite tile 1 using the data port.
+	Vdp *const vdp = m_context[1]->m_vdp;
+	VdpCache::Stats stats;
+	vdp->takePatternCacheStats(&stats);
+	uint16_t pattern[16];
+	for (int i = 0; i < 16; i++) {
+		pattern[i] = 0x1234 + (i * 0x1111);
+	}
+	writeVRam(0x0020, pattern, 16);
+	ASSERT_NO_FATAL_FAILURE(runAndCheck(16));
+	vdp->takePatternCacheStats(&stats);
+	EXPECT_GE(stats.lines, 8U) << "Tile 1 was not decoded again.";
+	for (int frame = 17; frame < 24; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Overwrite part of tile 2 using DMA FILL.
+	// (Lines 2 and 3 only.)
+	dmaFill(0x0048, 8, 0x5A5A);
+	for (int frame = 24; frame < 32; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Copy tile 1 to tile 2 using DMA COPY.
+	dmaCopy(0x0020, 0x0040, 32);
+	for (int frame = 32; frame < 40; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+}
+
+/**
+ * Restore a snapshot in both contexts.
+ * The pattern cache must be invalidated.
+ */
+TEST_P(VdpPatternCacheTest, snapshot)
+{
+	for (int frame = 0; frame < 8; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	vector<uint8_t> snapshot[2];
+	int size[2];
+	for (int i = 0; i < 2; i++) {
+		snapshot[i].resize(SNAPSHOT_BUF_SIZE);
+		size[i] = m_context[i]->snapshotSave(snapshot[i].data(), snapshot[i].size());
+		ASSERT_GT(size[i], 0);
+	}
+
+	// Change all patterns, then restore the snapshot.
+	for (int frame = 8; frame < 16; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+	dmaFill(0x0000, 0x8000, 0x3C3C);
+	ASSERT_NO_FATAL_FAILURE(runAndCheck(16));
+	for (int i = 0; i < 2; i++) {
+		ASSERT_EQ(0, m_context[i]->snapshotLoad(snapshot[i].data(), size[i]));
+	}
+	for (int frame = 17; frame < 32; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: VDP pattern cache tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
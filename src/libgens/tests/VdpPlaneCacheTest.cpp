@@ -0,0 +1,148 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VdpPlaneCacheTest.cpp: VDP scroll plane row cache tests.                *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+
+// Feature on/off comparison test fixture.
+#include "FeatureToggleTest.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+namespace LibGens { namespace Tests {
+
+class VdpPlaneCacheTest : public FeatureToggleTest
+{
+	protected:
+		VdpPlaneCacheTest()
+			: FeatureToggleTest() { }
+		virtual ~VdpPlaneCacheTest() { }
+
+		virtual int setFeature(EmuMD *context, bool enable) override
+			{ return context->m_vdp->setPlaneCache(enable); }
+		virtual bool isFeatureEnabled(EmuMD *context) override
+			{ return context->m_vdp->isPlaneCacheEnabled(); }
+
+		/**
+		 * Check the plane cache statistics.
+		 */
+		virtual void checkStats(void) override;
+};
+
+/**
+ * Check the plane cache statistics.
+ */
+void VdpPlaneCacheTest::checkStats(void)
+{
+	VdpPlaneCache::Stats stats;
+	m_context[1]->m_vdp->takePlaneCacheStats(&stats);
+	printf("Plane cache: %llu hits, %llu misses, %llu invalidations\n",
+		(unsigned long long)stats.hits,
+		(unsigned long long)stats.misses,
+		(unsigned long long)stats.invalidations);
+	EXPECT_GT(stats.hits + stats.misses, 0U);
+
+	// Stats are reset after reading them.
+	m_context[1]->m_vdp->takePlaneCacheStats(&stats);
+	EXPECT_EQ(0U, stats.hits);
+	EXPECT_EQ(0U, stats.misses);
+	EXPECT_EQ(0U, stats.invalidations);
+}
+
+FEATURE_TOGGLE_TESTS(VdpPlaneCacheTest);
+
+/**
+ * Modify the nametables and patterns between frames.
+ * Cached rows must be invalidated.
+ */
+TEST_P(VdpPlaneCacheTest, vramWrites)
+{
+	for (int frame = 0; frame < 8; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Get the nametable addresses.
+	uint8_t reg2, reg4;
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(2, &reg2));
+	ASSERT_EQ(0, m_context[0]->m_vdp->dbg_getReg(4, &reg4));
+	const uint16_t scrA = (reg2 & 0x38) << 10;
+	const uint16_t scrB = (reg4 & 0x07) << 13;
+
+	// Overwrite both nametables. (64x32)
+	// Alternate between tiles 1 and 2, with flips and priority.
+	// NOTE: The initial nametables reference random tiles,
+	// including the nametables themselves, so they're
+	// rewritten twice to test nametable invalidation
+	// without pattern invalidation.
+	uint16_t nt[64*32];
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < 64*32; i++) {
+			nt[i] = ((i + pass) & 1 ? 0x0001 : 0x0002) | ((i & 6) << 10) | ((i & 8) << 12);
+		}
+		writeVRam(scrA, nt, 64*32);
+		writeVRam(scrB, nt, 64*32);
+		for (int frame = 8; frame < 16; frame++) {
+			ASSERT_NO_FATAL_FAILURE(runAndCheck((pass * 8) + frame));
+		}
+	}
+
+	// Overwrite tile 1.
+	uint16_t pattern[16];
+	for (int i = 0; i < 16; i++) {
+		pattern[i] = 0x1234 + (i * 0x1111);
+	}
+	writeVRam(0x0020, pattern, 16);
+	for (int frame = 24; frame < 32; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+
+	// Move Scroll A to Scroll B's nametable.
+	for (int i = 0; i < 2; i++) {
+		m_context[i]->m_vdp->writeCtrlMD(0x8200 | (scrB >> 10));
+	}
+	for (int frame = 32; frame < 40; frame++) {
+		ASSERT_NO_FATAL_FAILURE(runAndCheck(frame));
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: VDP scroll plane row cache tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -0,0 +1,366 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VdpRendSimdTest.cpp: VDP Mode 5 SIMD renderer tests.                    *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+
+// LibGens VDP.
+#include "Vdp/Vdp.hpp"
+#include "Util/MdFb.hpp"
+#include "libcompat/cpuflags.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+struct VdpRendSimdTest_mode
+{
+	bool h40;		// H40 instead of H32.
+	bool shadowHighlight;	// Shadow/Highlight.
+	bool interlaced;	// Interlaced Mode 2.
+	bool vscroll2Cell;	// 2-cell VScroll.
+	MdFb::ColorDepth bpp;	// Color depth.
+
+	VdpRendSimdTest_mode(bool h40, bool shadowHighlight, bool interlaced,
+			     bool vscroll2Cell, MdFb::ColorDepth bpp)
+		: h40(h40)
+		, shadowHighlight(shadowHighlight)
+		, interlaced(interlaced)
+		, vscroll2Cell(vscroll2Cell)
+		, bpp(bpp) { }
+};
+
+/**
+ * Formatting function for VdpRendSimdTest.
+ */
+inline ::std::ostream& operator<<(::std::ostream& os, const VdpRendSimdTest_mode& mode) {
+	return os << (mode.h40 ? "H40" : "H32")
+		<< (mode.shadowHighlight ? ", S/H" : "")
+		<< (mode.interlaced ? ", IM2" : "")
+		<< (mode.vscroll2Cell ? ", 2-cell VScroll" : "")
+		<< ", " << MdFb::colorDepthToBpp(mode.bpp) << "bpp";
+};
+
+/**
+ * Bit-exact comparison of the SIMD Mode 5 renderer
+ * against the scalar renderer.
+ *
+ * VRAM, CRAM, VSRAM, and the scroll tables are filled with
+ * pseudo-random data, so every pattern, priority, flip, and
+ * palette combination is exercised, along with a valid
+ * sprite list with overlapping sprites.
+ */
+class VdpRendSimdTest : public ::testing::TestWithParam<VdpRendSimdTest_mode>
+{
+	protected:
+		VdpRendSimdTest()
+			: ::testing::TestWithParam<VdpRendSimdTest_mode>()
+			, m_vdp(nullptr)
+			, m_cpuFlags_orig(0)
+			, m_seed(0) { }
+		virtual ~VdpRendSimdTest() { }
+
+		virtual void SetUp(void);
+		virtual void TearDown(void);
+
+	protected:
+		Vdp *m_vdp;
+
+		// Original CPU flags.
+		uint32_t m_cpuFlags_orig;
+
+		/**
+		 * Pseudo-random number generator. (xorshift32)
+		 * A fixed seed is used so failures are reproducible.
+		 * @return Pseudo-random number.
+		 */
+		uint32_t rand32(void);
+		uint32_t m_seed;
+
+		/**
+		 * Render two frames using the specified CPU flags.
+		 * @param cpuFlags	[in] CPU flags.
+		 * @param fb		[out] Framebuffer contents of the second frame.
+		 * @param status	[out] VDP status after each frame.
+		 */
+		void renderFrames(uint32_t cpuFlags, vector<uint8_t> &fb, uint16_t status[2]);
+
+		/**
+		 * Compare the SIMD renderer against the scalar renderer.
+		 * @param cpuFlags CPU flags for the SIMD renderer.
+		 */
+		void compareRenderers(uint32_t cpuFlags);
+};
+
+/**
+ * Set up the Vdp for testing.
+ */
+void VdpRendSimdTest::SetUp(void)
+{
+	m_cpuFlags_orig = CPU_Flags;
+	m_seed = 0x4D454741;	// "MEGA"
+
+	// Initialize the VDP.
+	m_vdp = new Vdp();
+	m_vdp->setNtsc();
+
+	// Determine the parameters for this test.
+	const VdpRendSimdTest_mode mode = GetParam();
+
+	// Set initial registers.
+	m_vdp->dbg_setReg(0x00, 0x04);	// Enable the palette. (?)
+	m_vdp->dbg_setReg(0x01, 0x44);	// Enable the display, set Mode 5.
+	m_vdp->dbg_setReg(0x02, 0x30);	// Set scroll A name table base to 0xC000.
+	m_vdp->dbg_setReg(0x03, 0x2C);	// Set the window name table base to 0xB000.
+	m_vdp->dbg_setReg(0x04, 0x05);	// Set scroll B name table base to 0xA000.
+	m_vdp->dbg_setReg(0x05, 0x70);	// Set the sprite table base to 0xE000.
+	m_vdp->dbg_setReg(0x0D, 0x3F);	// Set the HScroll table base to 0xFC00.
+	m_vdp->dbg_setReg(0x10, 0x01);	// Set the scroll size to V32 H64.
+	m_vdp->dbg_setReg(0x11, 0x88);	// Window: Right side, starting at cell 16.
+	m_vdp->dbg_setReg(0x12, 0x84);	// Window: Bottom side, starting at cell 4.
+
+	// HScroll: per-line. VScroll: full screen or 2-cell.
+	m_vdp->dbg_setReg(0x0B, (mode.vscroll2Cell ? 0x04 : 0x00) | 0x03);
+
+	// Screen mode, Shadow/Highlight, and interlaced mode.
+	uint8_t reg0C = (mode.h40 ? 0x81 : 0x00);
+	if (mode.shadowHighlight)
+		reg0C |= 0x08;
+	if (mode.interlaced)
+		reg0C |= 0x06;
+	m_vdp->dbg_setReg(0x0C, reg0C);
+
+	// FIXME: Move MD_Screen out of m_vdp.
+	m_vdp->MD_Screen->setBpp(mode.bpp);
+
+	// Initialize VRAM with random data.
+	// NOTE: This must be done after setting the registers,
+	// since the sprite table cache depends on the sprite
+	// table base address.
+	vector<uint16_t> vram(0x10000 / 2);
+	for (size_t i = 0; i < vram.size(); i++) {
+		vram[i] = (uint16_t)rand32();
+	}
+
+	// Sprite table: 80 linked sprites with random positions.
+	// Sprites are placed around the visible area, including
+	// partially off-screen positions.
+	const unsigned int max_sprites = (mode.h40 ? 80 : 64);
+	for (unsigned int i = 0; i < max_sprites; i++) {
+		uint16_t *const spr = &vram[(0xE000 / 2) + (i * 4)];
+		const unsigned int link = (i + 1 < max_sprites ? i + 1 : 0);
+		const unsigned int y_max = (mode.interlaced ? 512 : 256);
+		spr[0] = (uint16_t)(128 - 32 + (rand32() % (y_max + 32)));
+		spr[1] = (uint16_t)(((rand32() & 0x0F) << 8) | link);
+		spr[2] = (uint16_t)rand32();
+		spr[3] = (uint16_t)(128 - 32 + (rand32() % (320 + 32)));
+	}
+	ASSERT_EQ(0, m_vdp->dbg_writeVRam_16(0, vram.data(), (int)(vram.size() * 2)));
+
+	// Initialize CRAM with random data.
+	uint16_t cram[64];
+	for (int i = 0; i < 64; i++) {
+		cram[i] = (uint16_t)(rand32() & 0x0EEE);
+	}
+	ASSERT_EQ(0, m_vdp->dbg_writeCRam_16(0, cram, (int)sizeof(cram)));
+
+	// Initialize VSRAM with random data.
+	uint16_t vsram[40];
+	for (int i = 0; i < 40; i++) {
+		vsram[i] = (uint16_t)(rand32() & 0x3FF);
+	}
+	ASSERT_EQ(0, m_vdp->dbg_writeVSRam_16(0, vsram, (int)sizeof(vsram)));
+}
+
+/**
+ * Tear down the Vdp.
+ */
+void VdpRendSimdTest::TearDown(void)
+{
+	delete m_vdp;
+	m_vdp = nullptr;
+
+	// Restore the original CPU flags.
+	CPU_Flags = m_cpuFlags_orig;
+}
+
+/**
+ * Pseudo-random number generator. (xorshift32)
+ * A fixed seed is used so failures are reproducible.
+ * @return Pseudo-random number.
+ */
+uint32_t VdpRendSimdTest::rand32(void)
+{
+	m_seed ^= (m_seed << 13);
+	m_seed ^= (m_seed >> 17);
+	m_seed ^= (m_seed << 5);
+	return m_seed;
+}
+
+/**
+ * Render two frames using the specified CPU flags.
+ * @param cpuFlags	[in] CPU flags.
+ * @param fb		[out] Framebuffer contents of the second frame.
+ * @param status	[out] VDP status after each frame.
+ */
+void VdpRendSimdTest::renderFrames(uint32_t cpuFlags, vector<uint8_t> &fb, uint16_t status[2])
+{
+	CPU_Flags = cpuFlags;
+
+	// The first frame primes the sprite line cache.
+	for (int frame = 0; frame < 2; frame++) {
+		m_vdp->updateVdpLines(true);
+		for (; m_vdp->VDP_Lines.currentLine < m_vdp->VDP_Lines.totalDisplayLines;
+		     m_vdp->VDP_Lines.currentLine++)
+		{
+			m_vdp->renderLine();
+		}
+
+		// Save the status register.
+		// This includes the sprite collision flag.
+		status[frame] = m_vdp->readCtrlMD();
+	}
+
+	const MdFb *fbSrc = m_vdp->MD_Screen;
+	const size_t fbSize = fbSrc->pxPerLine() * fbSrc->numLines() *
+		(fbSrc->bpp() == MdFb::BPP_32 ? 4 : 2);
+	const uint8_t *fbData = (fbSrc->bpp() == MdFb::BPP_32
+		? reinterpret_cast<const uint8_t*>(fbSrc->fb32())
+		: reinterpret_cast<const uint8_t*>(fbSrc->fb16()));
+	fb.assign(fbData, fbData + fbSize);
+}
+
+/**
+ * Compare the SIMD renderer against the scalar renderer.
+ * @param cpuFlags CPU flags for the SIMD renderer.
+ */
+void VdpRendSimdTest::compareRenderers(uint32_t cpuFlags)
+{
+	vector<uint8_t> fb_scalar, fb_simd;
+	uint16_t status_scalar[2], status_simd[2];
+
+	renderFrames(0, fb_scalar, status_scalar);
+	renderFrames(cpuFlags, fb_simd, status_simd);
+
+	ASSERT_EQ(fb_scalar.size(), fb_simd.size());
+	for (int frame = 0; frame < 2; frame++) {
+		EXPECT_EQ(status_scalar[frame], status_simd[frame])
+			<< "VDP status mismatch in frame " << frame;
+	}
+
+	// Find the first mismatched pixel, if any.
+	const MdFb *fb = m_vdp->MD_Screen;
+	const int bytesPerPx = (fb->bpp() == MdFb::BPP_32 ? 4 : 2);
+	for (size_t i = 0; i < fb_scalar.size(); i++) {
+		if (fb_scalar[i] != fb_simd[i]) {
+			const int px = (int)(i / bytesPerPx);
+			FAIL() << "Framebuffer mismatch at line " << (px / fb->pxPerLine())
+				<< ", pixel " << (px % fb->pxPerLine());
+		}
+	}
+}
+
+/**
+ * Compare the SSE2 layer compositor against the scalar renderer.
+ */
+TEST_P(VdpRendSimdTest, sse2)
+{
+#if defined(__i386__) || defined(__amd64__) || defined(__x86_64__) || \
+    defined(_M_IX86) || defined(_M_X64)
+	if (!(m_cpuFlags_orig & MDP_CPUFLAG_X86_SSE2)) {
+		fprintf(stderr, "SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	compareRenderers(MDP_CPUFLAG_X86_SSE2);
+#else
+	fprintf(stderr, "SSE2 is not available on this architecture. Skipping test.\n");
+#endif
+}
+
+/**
+ * Compare the SSE2 layer compositor and AVX2 palette lookup
+ * against the scalar renderer.
+ */
+TEST_P(VdpRendSimdTest, avx2)
+{
+#if defined(__i386__) || defined(__amd64__) || defined(__x86_64__) || \
+    defined(_M_IX86) || defined(_M_X64)
+	if (!(m_cpuFlags_orig & MDP_CPUFLAG_X86_AVX2)) {
+		fprintf(stderr, "AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	compareRenderers(m_cpuFlags_orig & (MDP_CPUFLAG_X86_SSE2 | MDP_CPUFLAG_X86_AVX2));
+#else
+	fprintf(stderr, "AVX2 is not available on this architecture. Skipping test.\n");
+#endif
+}
+
+// Test cases.
+INSTANTIATE_TEST_CASE_P(ScreenH32, VdpRendSimdTest,
+	::testing::Values(
+		VdpRendSimdTest_mode(false, false, false, false, MdFb::BPP_32),
+		VdpRendSimdTest_mode(false, true,  false, false, MdFb::BPP_32),
+		VdpRendSimdTest_mode(false, false, true,  false, MdFb::BPP_32),
+		VdpRendSimdTest_mode(false, true,  false, true,  MdFb::BPP_16),
+		VdpRendSimdTest_mode(false, false, false, false, MdFb::BPP_15)
+		));
+
+INSTANTIATE_TEST_CASE_P(ScreenH40, VdpRendSimdTest,
+	::testing::Values(
+		VdpRendSimdTest_mode(true, false, false, false, MdFb::BPP_32),
+		VdpRendSimdTest_mode(true, true,  false, false, MdFb::BPP_32),
+		VdpRendSimdTest_mode(true, true,  true,  true,  MdFb::BPP_32),
+		VdpRendSimdTest_mode(true, false, false, true,  MdFb::BPP_16),
+		VdpRendSimdTest_mode(true, true,  true,  false, MdFb::BPP_16)
+		));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: VDP Mode 5 SIMD renderer tests.\n\n");
+
+	::testing::InitGoogleTest(&argc, argv);
+	LibGens::Init();
+	fprintf(stderr, "\n");
+	fflush(nullptr);
+
+	int ret = RUN_ALL_TESTS();
+	LibGens::End();
+	return ret;
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
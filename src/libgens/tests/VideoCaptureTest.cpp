@@ -0,0 +1,518 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * VideoCaptureTest.cpp: Video capture tests.                              *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "Rom.hpp"
+#include "EmuContext/EmuMD.hpp"
+#include "Vdp/Vdp.hpp"
+#include "sound/SoundMgr.hpp"
+#include "Util/MdFb.hpp"
+#include "Util/VideoCapture.hpp"
+
+// LibZomg
+#include "libzomg/PngWriter.hpp"
+#include "libzomg/Metadata.hpp"
+#include "libzomg/img_data.h"
+
+// Synthetic test ROMs.
+#include "FrameBenchmark/SyntheticRom.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibGens { namespace Tests {
+
+class VideoCaptureTest : public ::testing::TestWithParam<SyntheticRom::RomType_t>
+{
+	protected:
+		VideoCaptureTest()
+			: ::testing::TestWithParam<SyntheticRom::RomType_t>()
+			, m_synthRom(nullptr)
+			, m_rom(nullptr)
+			, m_context(nullptr)
+		{ }
+		virtual ~VideoCaptureTest() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of frames to capture.
+		static const int TEST_FRAMES = 60;
+
+		SyntheticRom *m_synthRom;
+		Rom *m_rom;
+		EmuMD *m_context;
+		VideoCapture m_capture;
+
+		// Capture filename.
+		string m_filename;
+
+		// Expected frames, encoded as PNG.
+		// Empty frames are repeated frames.
+		vector<vector<uint8_t> > m_frames;
+		// Audio output read from the SoundMgr.
+		vector<int16_t> m_pcm;
+
+		/**
+		 * Run a frame and record it.
+		 * The expected frame and audio are appended to
+		 * m_frames and m_pcm.
+		 * @param repeat If true, record a repeated frame.
+		 * @return pushFrame() return value.
+		 */
+		int recordFrame(bool repeat = false);
+
+		/**
+		 * Encode a framebuffer the same way VideoCapture does.
+		 * @param fb MD framebuffer.
+		 * @return PNG image.
+		 */
+		static vector<uint8_t> encodeFrame(const MdFb *fb);
+
+		/**
+		 * Parsed AVI file.
+		 */
+		struct Avi {
+			uint32_t totalFrames;	// avih
+			uint32_t width;		// avih
+			uint32_t height;	// avih
+			uint32_t videoRate;	// Video strh
+			uint32_t videoLength;	// Video strh
+			uint32_t audioRate;	// Audio strh
+			uint32_t audioLength;	// Audio strh
+			vector<vector<uint8_t> > frames;	// '00dc' chunks
+			vector<int16_t> audio;			// '01wb' chunks
+			unsigned int indexEntries;		// 'idx1' entries
+		};
+
+		/**
+		 * Read and parse the AVI file.
+		 * @param avi [out] Parsed AVI file.
+		 */
+		void readAvi(Avi &avi);
+
+		static inline uint32_t le32(const uint8_t *p)
+		{
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+};
+
+/**
+ * Set up the emulation context for the synthetic ROM.
+ */
+void VideoCaptureTest::SetUp(void)
+{
+	m_synthRom = new SyntheticRom(GetParam());
+	m_rom = new Rom(m_synthRom->data(), m_synthRom->size());
+	ASSERT_TRUE(m_rom->isOpen()) << "Synthetic ROM could not be opened.";
+
+	m_context = new EmuMD(m_rom, SysVersion::REGION_US_NTSC);
+	ASSERT_TRUE(m_context->isRomOpened()) << "Synthetic ROM could not be loaded.";
+	m_rom->close();
+	m_context->m_soundMgr->setRate(44100, false);
+
+	m_filename = "VideoCaptureTest.avi.tmp";
+}
+
+/**
+ * Tear down the emulation context.
+ */
+void VideoCaptureTest::TearDown(void)
+{
+	m_capture.stop();
+	remove(m_filename.c_str());
+
+	delete m_context;
+	m_context = nullptr;
+	delete m_rom;
+	m_rom = nullptr;
+	delete m_synthRom;
+	m_synthRom = nullptr;
+}
+
+/**
+ * Run a frame and record it.
+ * The expected frame and audio are appended to
+ * m_frames and m_pcm.
+ * @param repeat If true, record a repeated frame.
+ * @return pushFrame() return value.
+ */
+int VideoCaptureTest::recordFrame(bool repeat)
+{
+	SoundMgr *const soundMgr = m_context->m_soundMgr;
+	int16_t segBuffer[SoundMgr::MAX_SEGMENT_SIZE * 2] ALIGN(16);
+
+	m_context->execFrame();
+	const int samples = soundMgr->writeStereo(segBuffer, soundMgr->getSegLength());
+	m_pcm.insert(m_pcm.end(), segBuffer, segBuffer + (samples * 2));
+
+	const MdFb *fb = (repeat ? nullptr : m_context->m_vdp->MD_Screen);
+	int ret = m_capture.pushFrame(fb, segBuffer, samples);
+	if (ret == 0 && fb) {
+		m_frames.push_back(encodeFrame(fb));
+	} else {
+		// Repeated or dropped frame.
+		m_frames.push_back(vector<uint8_t>());
+	}
+	return ret;
+}
+
+/**
+ * Encode a framebuffer the same way VideoCapture does.
+ * @param fb MD framebuffer.
+ * @return PNG image.
+ */
+vector<uint8_t> VideoCaptureTest::encodeFrame(const MdFb *fb)
+{
+	Zomg_Img_Data_t img_data;
+	memset(&img_data, 0, sizeof(img_data));
+	img_data.w = fb->pxPerLine();
+	img_data.h = fb->numLines();
+	img_data.data = (void*)fb->lineBuf32(0);
+	img_data.pitch = fb->pxPitch() * sizeof(uint32_t);
+	img_data.bpp = 32;
+
+	vector<uint8_t> png;
+	LibZomg::PngWriter pngWriter;
+	EXPECT_EQ(0, pngWriter.writeToMemory(&img_data, png,
+			nullptr, LibZomg::Metadata::MF_None));
+	return png;
+}
+
+/**
+ * Read and parse the AVI file.
+ * @param avi [out] Parsed AVI file.
+ */
+void VideoCaptureTest::readAvi(Avi &avi)
+{
+	vector<uint8_t> data;
+	FILE *f = fopen(m_filename.c_str(), "rb");
+	ASSERT_TRUE(f != nullptr);
+	uint8_t buf[4096];
+	size_t size;
+	while ((size = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data.insert(data.end(), buf, buf + size);
+	}
+	fclose(f);
+
+	// RIFF header.
+	ASSERT_GE(data.size(), 326U);
+	ASSERT_EQ(0, memcmp(&data[0], "RIFF", 4));
+	ASSERT_EQ(data.size() - 8, le32(&data[4]));
+	ASSERT_EQ(0, memcmp(&data[8], "AVI ", 4));
+
+	// Header list.
+	ASSERT_EQ(0, memcmp(&data[12], "LIST", 4));
+	ASSERT_EQ(0, memcmp(&data[20], "hdrl", 4));
+	const uint8_t *p = &data[24];
+	ASSERT_EQ(0, memcmp(p, "avih", 4));
+	avi.totalFrames = le32(&p[8+16]);
+	avi.width = le32(&p[8+32]);
+	avi.height = le32(&p[8+36]);
+	p += 8 + 56;
+
+	// Video stream.
+	ASSERT_EQ(0, memcmp(&p[8], "strl", 4));
+	ASSERT_EQ(0, memcmp(&p[12], "strh", 4));
+	ASSERT_EQ(0, memcmp(&p[20], "vids", 4));
+	ASSERT_EQ(0, memcmp(&p[24], "MPNG", 4));
+	avi.videoRate = le32(&p[20+24]) / le32(&p[20+20]);
+	avi.videoLength = le32(&p[20+32]);
+	p += 8 + le32(&p[4]);
+
+	// Audio stream.
+	ASSERT_EQ(0, memcmp(&p[8], "strl", 4));
+	ASSERT_EQ(0, memcmp(&p[20], "auds", 4));
+	avi.audioRate = le32(&p[20+24]) / le32(&p[20+20]);
+	avi.audioLength = le32(&p[20+32]);
+	p += 8 + le32(&p[4]);
+
+	// Movie list.
+	ASSERT_EQ(0, memcmp(p, "LIST", 4));
+	ASSERT_EQ(0, memcmp(&p[8], "movi", 4));
+	const uint8_t *const movi = &p[8];
+	const uint8_t *const moviEnd = movi + le32(&p[4]);
+	ASSERT_LE(moviEnd, &data[0] + data.size());
+	for (p = movi + 4; p < moviEnd; ) {
+		const uint32_t len = le32(&p[4]);
+		ASSERT_LE(p + 8 + len, moviEnd);
+		if (!memcmp(p, "00dc", 4)) {
+			avi.frames.push_back(vector<uint8_t>(&p[8], &p[8] + len));
+		} else if (!memcmp(p, "01wb", 4)) {
+			// Audio samples are little-endian.
+			for (uint32_t i = 0; i < len; i += 2) {
+				avi.audio.push_back((int16_t)(p[8+i] | (p[8+i+1] << 8)));
+			}
+		} else {
+			FAIL() << "Unexpected chunk in 'movi' list.";
+		}
+		p += 8 + ((len + 1) & ~1);
+	}
+
+	// Index.
+	ASSERT_EQ(0, memcmp(p, "idx1", 4));
+	const uint32_t idxLen = le32(&p[4]);
+	ASSERT_EQ(0U, idxLen % 16);
+	ASSERT_EQ(&data[0] + data.size(), p + 8 + idxLen);
+	avi.indexEntries = idxLen / 16;
+
+	// Check that each index entry points to its chunk.
+	const uint8_t *entry = p + 8;
+	for (unsigned int i = 0; i < avi.indexEntries; i++, entry += 16) {
+		const uint8_t *chunk = movi + le32(&entry[8]);
+		ASSERT_LT(chunk, moviEnd);
+		EXPECT_EQ(0, memcmp(chunk, entry, 4));
+		EXPECT_EQ(le32(&chunk[4]), le32(&entry[12]));
+	}
+}
+
+/**
+ * Record frames with the stall policy.
+ * Every frame must be recorded.
+ */
+TEST_P(VideoCaptureTest, stall)
+{
+	ASSERT_EQ(0, m_capture.start(m_filename.c_str(), false, 44100, 2, VideoCapture::QUEUE_STALL));
+	EXPECT_EQ(-EBUSY, m_capture.start(m_filename.c_str(), false, 44100, 2, VideoCapture::QUEUE_STALL));
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		ASSERT_EQ(0, recordFrame());
+	}
+	EXPECT_EQ(0, m_capture.stop());
+	EXPECT_FALSE(m_capture.isRunning());
+
+	VideoCapture::Stats stats;
+	m_capture.stats(&stats);
+	EXPECT_EQ((unsigned int)TEST_FRAMES, stats.frames);
+	EXPECT_EQ(0U, stats.dropped);
+	EXPECT_GE(stats.maxQueued, 1U);
+
+	Avi avi;
+	ASSERT_NO_FATAL_FAILURE(readAvi(avi));
+	EXPECT_EQ((uint32_t)TEST_FRAMES, avi.totalFrames);
+	EXPECT_EQ(320U, avi.width);
+	EXPECT_EQ(240U, avi.height);
+	EXPECT_EQ(60U, avi.videoRate);
+	EXPECT_EQ((uint32_t)TEST_FRAMES, avi.videoLength);
+	EXPECT_EQ(44100U, avi.audioRate);
+	EXPECT_EQ((uint32_t)(m_pcm.size() / 2), avi.audioLength);
+	EXPECT_EQ((unsigned int)(TEST_FRAMES * 2), avi.indexEntries);
+
+	// Frames are written in order.
+	ASSERT_EQ(m_frames.size(), avi.frames.size());
+	static const uint8_t pngMagic[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	for (size_t i = 0; i < m_frames.size(); i++) {
+		ASSERT_GE(avi.frames[i].size(), sizeof(pngMagic)) << "Frame " << i;
+		EXPECT_EQ(0, memcmp(avi.frames[i].data(), pngMagic, sizeof(pngMagic))) << "Frame " << i;
+		EXPECT_TRUE(m_frames[i] == avi.frames[i]) << "Frame " << i;
+	}
+	EXPECT_TRUE(m_pcm == avi.audio);
+}
+
+/**
+ * Record repeated frames.
+ * Repeated frames are written as empty chunks.
+ */
+TEST_P(VideoCaptureTest, repeat)
+{
+	ASSERT_EQ(0, m_capture.start(m_filename.c_str(), false, 44100, 2, VideoCapture::QUEUE_STALL, 1));
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		ASSERT_EQ(0, recordFrame((i % 3) != 0));
+	}
+	EXPECT_EQ(0, m_capture.stop());
+
+	Avi avi;
+	ASSERT_NO_FATAL_FAILURE(readAvi(avi));
+	EXPECT_EQ((uint32_t)TEST_FRAMES, avi.totalFrames);
+	ASSERT_EQ(m_frames.size(), avi.frames.size());
+	for (size_t i = 0; i < m_frames.size(); i++) {
+		EXPECT_EQ((i % 3) == 0, !avi.frames[i].empty()) << "Frame " << i;
+		EXPECT_TRUE(m_frames[i] == avi.frames[i]) << "Frame " << i;
+	}
+	EXPECT_TRUE(m_pcm == avi.audio);
+}
+
+/**
+ * Record frames with muted audio.
+ * Silence is written so the video stays in sync.
+ */
+TEST_P(VideoCaptureTest, silence)
+{
+	ASSERT_EQ(0, m_capture.start(m_filename.c_str(), false, 44100, 1, VideoCapture::QUEUE_STALL, 1));
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		ASSERT_EQ(0, m_capture.pushFrame(m_context->m_vdp->MD_Screen, nullptr, 735));
+	}
+	EXPECT_EQ(0, m_capture.stop());
+
+	Avi avi;
+	ASSERT_NO_FATAL_FAILURE(readAvi(avi));
+	EXPECT_EQ((uint32_t)TEST_FRAMES, avi.totalFrames);
+	EXPECT_EQ((uint32_t)(TEST_FRAMES * 735), avi.audioLength);
+	EXPECT_TRUE(vector<int16_t>(TEST_FRAMES * 735, 0) == avi.audio);
+}
+
+/**
+ * Record frames with the drop policy.
+ * The same frame is pushed faster than it can be encoded,
+ * so frames will usually be dropped. Dropped frames must
+ * keep their place and their audio.
+ */
+TEST_P(VideoCaptureTest, drop)
+{
+	SoundMgr *const soundMgr = m_context->m_soundMgr;
+	int16_t segBuffer[SoundMgr::MAX_SEGMENT_SIZE * 2] ALIGN(16);
+	m_context->execFrame();
+	const int samples = soundMgr->writeStereo(segBuffer, soundMgr->getSegLength());
+	const MdFb *fb = m_context->m_vdp->MD_Screen;
+	const vector<uint8_t> png = encodeFrame(fb);
+
+	ASSERT_EQ(0, m_capture.start(m_filename.c_str(), false, 44100, 2, VideoCapture::QUEUE_DROP, 1));
+	const int pushes = TEST_FRAMES * 4;
+	unsigned int dropped = 0;
+	for (int i = 0; i < pushes; i++) {
+		const int ret = m_capture.pushFrame(fb, segBuffer, samples);
+		if (ret == -EAGAIN) {
+			dropped++;
+		} else {
+			ASSERT_EQ(0, ret);
+		}
+		m_pcm.insert(m_pcm.end(), segBuffer, segBuffer + (samples * 2));
+	}
+	EXPECT_EQ(0, m_capture.stop());
+
+	VideoCapture::Stats stats;
+	m_capture.stats(&stats);
+	EXPECT_EQ(dropped, stats.dropped);
+	EXPECT_EQ(0U, stats.stalls);
+	EXPECT_LE(stats.maxQueued, 16U);
+
+	// Trailing dropped frames are written with
+	// a repeated frame that holds their audio.
+	Avi avi;
+	ASSERT_NO_FATAL_FAILURE(readAvi(avi));
+	ASSERT_GE(avi.frames.size(), (size_t)pushes);
+	ASSERT_LE(avi.frames.size(), (size_t)(pushes + 1));
+	EXPECT_EQ(stats.frames, avi.totalFrames);
+	EXPECT_EQ(avi.frames.size(), (size_t)avi.totalFrames);
+
+	unsigned int empty = 0;
+	for (size_t i = 0; i < (size_t)pushes; i++) {
+		if (avi.frames[i].empty()) {
+			empty++;
+		} else {
+			EXPECT_TRUE(png == avi.frames[i]) << "Frame " << i;
+		}
+	}
+	EXPECT_EQ(dropped, empty);
+	EXPECT_TRUE(m_pcm == avi.audio);
+}
+
+/**
+ * Start a second capture with the same object.
+ */
+TEST_P(VideoCaptureTest, restart)
+{
+	ASSERT_EQ(0, m_capture.start(m_filename.c_str(), true, 44100, 2, VideoCapture::QUEUE_STALL));
+	for (int i = 0; i < TEST_FRAMES / 2; i++) {
+		ASSERT_EQ(0, recordFrame());
+	}
+	EXPECT_EQ(0, m_capture.stop());
+
+	Avi avi1;
+	ASSERT_NO_FATAL_FAILURE(readAvi(avi1));
+	EXPECT_EQ(50U, avi1.videoRate);
+
+	// Second capture. Statistics are reset.
+	m_frames.clear();
+	m_pcm.clear();
+	ASSERT_EQ(0, m_capture.start(m_filename.c_str(), false, 44100, 2, VideoCapture::QUEUE_STALL));
+	for (int i = 0; i < TEST_FRAMES / 2; i++) {
+		ASSERT_EQ(0, recordFrame());
+	}
+	EXPECT_EQ(0, m_capture.stop());
+
+	VideoCapture::Stats stats;
+	m_capture.stats(&stats);
+	EXPECT_EQ((unsigned int)(TEST_FRAMES / 2), stats.frames);
+
+	Avi avi2;
+	ASSERT_NO_FATAL_FAILURE(readAvi(avi2));
+	EXPECT_EQ(60U, avi2.videoRate);
+	EXPECT_EQ((uint32_t)(TEST_FRAMES / 2), avi2.totalFrames);
+	EXPECT_TRUE(m_pcm == avi2.audio);
+
+	// Not running.
+	EXPECT_EQ(-EBADF, m_capture.pushFrame(nullptr, nullptr, 0));
+	EXPECT_EQ(-EINVAL, m_capture.start(m_filename.c_str(), false, 44100, 3, VideoCapture::QUEUE_STALL));
+	EXPECT_FALSE(m_capture.isRunning());
+}
+
+#ifdef __linux__
+/**
+ * Capture to a full disk.
+ * The write error must be returned by stop().
+ */
+TEST_P(VideoCaptureTest, writeError)
+{
+	ASSERT_EQ(0, m_capture.start("/dev/full", false, 44100, 2, VideoCapture::QUEUE_STALL));
+	for (int i = 0; i < TEST_FRAMES; i++) {
+		ASSERT_EQ(0, recordFrame());
+	}
+	EXPECT_EQ(-ENOSPC, m_capture.stop());
+	EXPECT_FALSE(m_capture.isRunning());
+}
+#endif /* __linux__ */
+
+INSTANTIATE_TEST_CASE_P(SyntheticRoms, VideoCaptureTest,
+	::testing::Values(
+		SyntheticRom::ROM_SPRITES,
+		SyntheticRom::ROM_Z80
+));
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_main.inc.cpp's main().
+ */
+static int test_main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibGens test suite: Video capture tests.\n\n");
+	LibGens::Init();
+	fflush(nullptr);
+
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+#include "libcompat/tests/gtest_main.inc.cpp"
@@ -56,6 +56,7 @@ class AudioWriteTest : public ::testing::TestWithParam<AudioWriteTest_flags>
 	protected:
 		AudioWriteTest()
 			: ::testing::TestWithParam<AudioWriteTest_flags>()
+			, soundMgr(nullptr)
 			, buf(nullptr) { }
 		virtual ~AudioWriteTest() { }
 
@@ -66,6 +67,9 @@ class AudioWriteTest : public ::testing::TestWithParam<AudioWriteTest_flags>
 		static const int rate;
 		static const int samples;
 
+		// Sound Manager.
+		SoundMgr *soundMgr;
+
 		// Aligned destination buffer.
 		int16_t *buf;
 
@@ -94,14 +98,15 @@ void AudioWriteTest::SetUp(void)
 	CPU_Flags = flags.cpuFlags;
 
 	// Initialize SoundMgr.
-	SoundMgr::ReInit(rate, false);
+	soundMgr = new SoundMgr();
+	soundMgr->reInit(rate, false);
 
 	// Allocate an aligned destination buffer.
 	buf = (int16_t*)aligned_malloc(16, samples * 2 * sizeof(*buf));
 
 	// Copy the test data into SoundMgr.
-	memcpy(SoundMgr::ms_SegBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
-	memcpy(SoundMgr::ms_SegBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
+	memcpy(soundMgr->m_segBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
+	memcpy(soundMgr->m_segBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
 }
 
 /**
@@ -111,6 +116,7 @@ void AudioWriteTest::TearDown(void)
 {
 	CPU_Flags = cpuFlags_old;
 	aligned_free(buf);
+	delete soundMgr;
 }
 
 /**
@@ -118,7 +124,7 @@ void AudioWriteTest::TearDown(void)
  */
 TEST_P(AudioWriteTest, writeStereo)
 {
-	int ret = SoundMgr::writeStereo(buf, samples);
+	int ret = soundMgr->writeStereo(buf, samples);
 	ASSERT_EQ(samples, ret);
 
 	// Verify the data.
@@ -137,7 +143,7 @@ TEST_P(AudioWriteTest, writeStereo)
  */
 TEST_P(AudioWriteTest, writeMono)
 {
-	int ret = SoundMgr::writeMono(buf, samples);
+	int ret = soundMgr->writeMono(buf, samples);
 	ASSERT_EQ(samples, ret);
 
 	// Verify the data.
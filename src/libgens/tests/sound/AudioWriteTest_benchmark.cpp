@@ -56,6 +56,7 @@ class AudioWriteTest_benchmark : public ::testing::TestWithParam<AudioWriteTest_
 	protected:
 		AudioWriteTest_benchmark()
 			: ::testing::TestWithParam<AudioWriteTest_flags>()
+			, soundMgr(nullptr)
 			, buf(nullptr) { }
 		virtual ~AudioWriteTest_benchmark() { }
 
@@ -66,6 +67,9 @@ class AudioWriteTest_benchmark : public ::testing::TestWithParam<AudioWriteTest_
 		static const int rate;
 		static const int samples;
 
+		// Sound Manager.
+		SoundMgr *soundMgr;
+
 		// Aligned destination buffer.
 		int16_t *buf;
 
@@ -105,7 +109,8 @@ void AudioWriteTest_benchmark::SetUp(void)
 	CPU_Flags = flags.cpuFlags;
 
 	// Initialize SoundMgr.
-	SoundMgr::ReInit(rate, false);
+	soundMgr = new SoundMgr();
+	soundMgr->reInit(rate, false);
 
 	// Allocate an aligned destination buffer.
 	buf = (int16_t*)aligned_malloc(16, samples * 2 * sizeof(*buf));
@@ -118,6 +123,7 @@ void AudioWriteTest_benchmark::TearDown(void)
 {
 	CPU_Flags = cpuFlags_old;
 	aligned_free(buf);
+	delete soundMgr;
 }
 
 /**
@@ -130,10 +136,10 @@ TEST_P(AudioWriteTest_benchmark, writeStereo)
 		// Copy the test data into SoundMgr.
 		// Note that this has to be done here instead of in SetUp(),
 		// since the segment buffer is erased after every iteration.
-		memcpy(SoundMgr::ms_SegBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
-		memcpy(SoundMgr::ms_SegBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
+		memcpy(soundMgr->m_segBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
+		memcpy(soundMgr->m_segBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
 
-		int ret = SoundMgr::writeStereo(buf, samples);
+		int ret = soundMgr->writeStereo(buf, samples);
 		ASSERT_EQ(samples, ret);
 	}
 }
@@ -148,10 +154,10 @@ TEST_P(AudioWriteTest_benchmark, writeMono)
 		// Copy the test data into SoundMgr.
 		// Note that this has to be done here instead of in SetUp(),
 		// since the segment buffer is erased after every iteration.
-		memcpy(SoundMgr::ms_SegBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
-		memcpy(SoundMgr::ms_SegBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
+		memcpy(soundMgr->m_segBufL, AudioWriteTest_Input_L, sizeof(AudioWriteTest_Input_L));
+		memcpy(soundMgr->m_segBufR, AudioWriteTest_Input_R, sizeof(AudioWriteTest_Input_R));
 
-		int ret = SoundMgr::writeMono(buf, samples);
+		int ret = soundMgr->writeMono(buf, samples);
 		ASSERT_EQ(samples, ret);
 	}
 }
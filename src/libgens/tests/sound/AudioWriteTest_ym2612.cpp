@@ -0,0 +1,238 @@
+/***************************************************************************
+ * libgens/tests: Gens Emulation Library. (Test Suite)                     *
+ * AudioWriteTest_ym2612.cpp: YM2612 vectorized update test.               *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// LibGens.
+#include "lg_main.hpp"
+#include "libcompat/cpuflags.h"
+
+// YM2612.
+#include "sound/Ym2612.hpp"
+
+// M68K.hpp has CLOCK_NTSC.
+#include "cpu/M68K.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+
+namespace LibGens { namespace Tests {
+
+/**
+ * Compare the vectorized YM2612 update against the scalar update.
+ * Two YM2612s receive the same register writes; one is updated
+ * with no CPU flags, and the other is updated with the flags
+ * being tested. The output must be identical.
+ *
+ * Parameter: Output sample rate.
+ * NOTE: Rates below the YM2612's internal rate (~53 kHz)
+ * use interpolated output; higher rates don't.
+ */
+class AudioWriteTest_ym2612 : public ::testing::TestWithParam<int>
+{
+	protected:
+		AudioWriteTest_ym2612()
+			: ::testing::TestWithParam<int>()
+			, m_cpuFlags_orig(0)
+			, m_seed(0) { }
+		virtual ~AudioWriteTest_ym2612() { }
+
+		virtual void SetUp(void) override;
+		virtual void TearDown(void) override;
+
+	protected:
+		// Number of register write / update iterations.
+		static const int iterations = 2000;
+		// Maximum update length, in samples.
+		static const int maxLength = 512;
+
+		// Original CPU flags.
+		uint32_t m_cpuFlags_orig;
+
+		// xorshift32 state.
+		uint32_t m_seed;
+		inline uint32_t rnd(void)
+		{
+			m_seed ^= m_seed << 13;
+			m_seed ^= m_seed >> 17;
+			m_seed ^= m_seed << 5;
+			return m_seed;
+		}
+
+		/**
+		 * Write a random register value to both YM2612s.
+		 * @param ymRef Reference YM2612.
+		 * @param ymTest YM2612 being tested.
+		 */
+		void randomWrite(Ym2612 *ymRef, Ym2612 *ymTest);
+
+		/**
+		 * Compare the scalar and vectorized updates.
+		 * @param cpuFlags CPU flags to test.
+		 */
+		void compareUpdates(uint32_t cpuFlags);
+};
+
+/**
+ * Set up the test.
+ */
+void AudioWriteTest_ym2612::SetUp(void)
+{
+	m_cpuFlags_orig = CPU_Flags;
+
+	// Fixed seed so failures are reproducible.
+	m_seed = 0x2612FEEDU;
+}
+
+/**
+ * Tear down the test.
+ */
+void AudioWriteTest_ym2612::TearDown(void)
+{
+	CPU_Flags = m_cpuFlags_orig;
+}
+
+/**
+ * Write a random register value to both YM2612s.
+ * @param ymRef Reference YM2612.
+ * @param ymTest YM2612 being tested.
+ */
+void AudioWriteTest_ym2612::randomWrite(Ym2612 *ymRef, Ym2612 *ymTest)
+{
+	static const uint8_t key_ch[6] = {0, 1, 2, 4, 5, 6};
+
+	unsigned int port = 0;
+	uint8_t reg, data;
+	const uint32_t r = rnd();
+	switch (r & 7) {
+		case 0:
+			// LFO.
+			reg = 0x22;
+			data = (uint8_t)(r >> 8);
+			break;
+		case 1:
+			// Channel 3 mode.
+			// Timers and CSM are left disabled.
+			reg = 0x27;
+			data = (uint8_t)((r >> 8) & 0x40);
+			break;
+		case 2:
+			// DAC enable. (Mostly disabled.)
+			reg = 0x2B;
+			data = (((r >> 8) & 7) == 0 ? 0x80 : 0x00);
+			break;
+		case 3:
+		case 4:
+			// Key on/off.
+			reg = 0x28;
+			data = (uint8_t)((r >> 8) & 0xF0) | key_ch[(r >> 16) % 6];
+			break;
+		default: {
+			// Slot or channel register.
+			port = ((r >> 8) & 1) * 2;
+			reg = 0x30 + (uint8_t)((r >> 9) % (0xB8 - 0x30));
+			data = (uint8_t)(r >> 24);
+			if ((reg & 0xF0) == 0x40 && (r & 0x10000)) {
+				// Keep some operators audible.
+				data &= 0x1F;
+			}
+			break;
+		}
+	}
+
+	ymRef->write(port, reg);
+	ymRef->write(port + 1, data);
+	ymTest->write(port, reg);
+	ymTest->write(port + 1, data);
+}
+
+/**
+ * Compare the scalar and vectorized updates.
+ * @param cpuFlags CPU flags to test.
+ */
+void AudioWriteTest_ym2612::compareUpdates(uint32_t cpuFlags)
+{
+	const int rate = GetParam();
+	const int clock = (int)((double)CLOCK_NTSC / 7.0);
+	Ym2612 ymRef(clock, rate);
+	Ym2612 ymTest(clock, rate);
+
+	int32_t refL[maxLength], refR[maxLength];
+	int32_t testL[maxLength], testR[maxLength];
+	int nonzero = 0;
+
+	for (int iter = 0; iter < iterations; iter++) {
+		const int writes = (rnd() % 16);
+		for (int w = 0; w < writes; w++) {
+			randomWrite(&ymRef, &ymTest);
+		}
+
+		const int length = 1 + (rnd() % maxLength);
+		memset(refL, 0, sizeof(refL));
+		memset(refR, 0, sizeof(refR));
+		memset(testL, 0, sizeof(testL));
+		memset(testR, 0, sizeof(testR));
+
+		CPU_Flags = 0;
+		ymRef.update(refL, refR, length);
+		CPU_Flags = cpuFlags;
+		ymTest.update(testL, testR, length);
+		CPU_Flags = m_cpuFlags_orig;
+
+		for (int i = 0; i < length; i++) {
+			ASSERT_EQ(refL[i], testL[i]) <<
+				"Iteration " << iter << ", left sample " << i << " of " << length;
+			ASSERT_EQ(refR[i], testR[i]) <<
+				"Iteration " << iter << ", right sample " << i << " of " << length;
+			if (refL[i] != 0 || refR[i] != 0)
+				nonzero++;
+		}
+	}
+
+	// Make sure the test actually generated sound.
+	EXPECT_GT(nonzero, iterations * maxLength / 8);
+}
+
+/**
+ * Compare the AVX2 update against the scalar update.
+ */
+TEST_P(AudioWriteTest_ym2612, avx2)
+{
+#if defined(__i386__) || defined(__amd64__) || defined(__x86_64__) || \
+    defined(_M_IX86) || defined(_M_X64)
+	if (!(m_cpuFlags_orig & MDP_CPUFLAG_X86_AVX2)) {
+		fprintf(stderr, "AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	compareUpdates(MDP_CPUFLAG_X86_AVX2);
+#else
+	fprintf(stderr, "AVX2 is not available on this architecture. Skipping test.\n");
+#endif
+}
+
+// Test cases.
+INSTANTIATE_TEST_CASE_P(AudioWriteTest_ym2612_Rates, AudioWriteTest_ym2612,
+	::testing::Values(11025, 22050, 44100, 48000, 96000));
+
+} }
@@ -28,18 +28,32 @@
  * Using this class directly will effectively result in a nop.
  */
 
+#include <config.libgensfile.h>
 #include "Archive.hpp"
 
 // C includes.
 #include <stdlib.h>
 // C includes. (C++ namespace)
+#include <cerrno>
 #include <cstring>
 
+// C++ includes.
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #ifdef _WIN32
 // Win32 Unicode Translation Layer.
 // Needed for proper Unicode filename support on Windows.
 // Also required for large file support.
 #include "libcompat/W32U/W32U_mini.h"
+// File mapping. (CreateFileMapping(), MapViewOfFile())
+#include <windows.h>
+#include <io.h>
+#elif defined(HAVE_MMAP)
+// File mapping. (mmap())
+#include <sys/mman.h>
 #endif
 
 // TODO: Move this to CMake?
@@ -56,6 +70,88 @@
 
 namespace LibGensFile {
 
+/**
+ * readFileStream() state.
+ * Shared between the reader thread, which runs readFile(),
+ * and the calling thread, which processes the data.
+ */
+class ArchiveStream
+{
+	public:
+		ArchiveStream()
+			: m_written(0)
+			, m_finished(false)
+			, m_cancelled(false) { }
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		ArchiveStream(const ArchiveStream &);
+		ArchiveStream &operator=(const ArchiveStream &);
+
+	public:
+		typedef Archive::file_offset_t file_offset_t;
+
+		/**
+		 * Publish data written by the reader thread.
+		 * @param written Total number of bytes written so far.
+		 * @return 0 to continue; -ECANCELED if the read was cancelled.
+		 */
+		int publish(file_offset_t written)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mtx);
+				m_written = written;
+			}
+			m_cond.notify_one();
+			return (m_cancelled ? -ECANCELED : 0);
+		}
+
+		/**
+		 * Indicate that the reader thread is finished.
+		 */
+		void finish(void)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mtx);
+				m_finished = true;
+			}
+			m_cond.notify_one();
+		}
+
+		/**
+		 * Cancel the read.
+		 * readFile() will stop at the next streamProgress() call.
+		 */
+		void cancel(void)
+		{
+			m_cancelled = true;
+		}
+
+		/**
+		 * Wait for more data from the reader thread.
+		 * @param minWritten	[in]  Minimum number of bytes to wait for.
+		 * @param pFinished	[out] Set to true if the reader thread is finished.
+		 * @return Total number of bytes written so far.
+		 */
+		file_offset_t wait(file_offset_t minWritten, bool *pFinished)
+		{
+			std::unique_lock<std::mutex> lock(m_mtx);
+			while (!m_finished && m_written < minWritten) {
+				m_cond.wait(lock);
+			}
+			*pFinished = m_finished;
+			return m_written;
+		}
+
+	private:
+		std::mutex m_mtx;
+		std::condition_variable m_cond;
+		file_offset_t m_written;
+		bool m_finished;
+		std::atomic<bool> m_cancelled;
+};
+
 /**
  * Open a file with this archive handler.
  * Check isOpen() afterwards to see if the file was opened.
@@ -65,6 +161,9 @@ namespace LibGensFile {
 Archive::Archive(const char *filename)
 	: m_filename(filename)
 	, m_lastError(0)
+	, m_map(nullptr)
+	, m_mapSize(0)
+	, m_stream(nullptr)
 {
 	// Attempt to open the file.
 	m_file = fopen(filename, "rb");
@@ -83,6 +182,7 @@ Archive::~Archive()
 {
 	// Subclasses should have closed any other
 	// references to the file here.
+	unmapFile();
 	if (m_file) {
 		fclose(m_file);
 	}
@@ -95,6 +195,7 @@ void Archive::close(void)
 {
 	// NOTE: Subclasses should reimplement close()
 	// and close any other references to the file.
+	unmapFile();
 	if (m_file) {
 		fclose(m_file);
 		m_file = nullptr;
@@ -180,16 +281,250 @@ int Archive::readFile(const mdp_z_entry_t *z_entry,
 	fseeko(m_file, start_pos, SEEK_SET);
 
 	// Read the file into the buffer.
+	// The file is read in chunks so readFileStream()
+	// can process the data while it's being read.
 	// FIXME: 64-bit parameters for fread?
-	*ret_siz = fread(buf, 1, (size_t)read_len, m_file);
-	if (*ret_siz != read_len) {
-		// Short read. Something went wrong.
+	uint8_t *p = reinterpret_cast<uint8_t*>(buf);
+	*ret_siz = 0;
+	while (*ret_siz < read_len) {
+		const size_t len = (size_t)std::min(read_len - *ret_siz,
+				static_cast<file_offset_t>(STREAM_CHUNK_SIZE));
+		const size_t ret = fread(p, 1, len, m_file);
+		*ret_siz += ret;
+		if (ret != len) {
+			// Short read. Something went wrong.
+			m_lastError = (ferror(m_file) ? errno : EIO);
+			return -m_lastError;
+		}
+		p += ret;
+
+		int sret = streamProgress(*ret_siz);
+		if (sret != 0) {
+			m_lastError = -sret;
+			return sret;
+		}
+	}
+	return 0; // TODO: return MDP_ERR_OK;
+}
+
+/**
+ * Read all or part of a file from the archive, and process
+ * the data as it's being read.
+ *
+ * readFile() is run on a second thread. As data is written
+ * to buf, fn is called on the calling thread for each new
+ * chunk, in order, so processing (e.g. deinterleaving and
+ * checksumming) is pipelined with decompression.
+ *
+ * Each chunk is a multiple of align bytes, except for the
+ * last chunk. If fn returns an error, the read is cancelled.
+ * If readFile() fails, fn may have processed part of the file.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to extract.
+ * @param start_pos	[in]  Starting position within the file.
+ * @param read_len	[in]  Number of bytes to read.
+ * @param buf		[out] Buffer to read the file into.
+ * @param siz		[in]  Size of buf. (Must be >= read_len.)
+ * @param align		[in]  Chunk alignment, in bytes.
+ * @param fn		[in]  Stream callback.
+ * @param param		[in]  User parameter for fn.
+ * @param ret_siz	[out] Pointer to file_offset_t to store the number of bytes read.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Archive::readFileStream(const mdp_z_entry_t *z_entry,
+			    file_offset_t start_pos, file_offset_t read_len,
+			    void *buf, file_offset_t siz, size_t align,
+			    StreamFn fn, void *param, file_offset_t *ret_siz)
+{
+	if (!buf || !fn || !ret_siz || align == 0) {
+		m_lastError = EINVAL;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	} else if (m_stream) {
+		// readFileStream() is already active.
+		m_lastError = EBUSY;
+		return -m_lastError;
+	}
+
+	// Don't wake up the calling thread for tiny chunks.
+	const file_offset_t minChunk = (file_offset_t)std::max(align,
+		(STREAM_CHUNK_SIZE / align) * align);
+
+	ArchiveStream stream;
+	m_stream = &stream;
+
+	// Run readFile() on the reader thread.
+	// NOTE: Virtual readFile() is called, so the
+	// subclass's decompressor is used.
+	int readRet = 0;
+	file_offset_t readSiz = 0;
+	std::thread reader([&]() {
+		readRet = readFile(z_entry, start_pos, read_len, buf, siz, &readSiz);
+		stream.finish();
+	});
+
+	// Process chunks as they're written.
+	uint8_t *const p = reinterpret_cast<uint8_t*>(buf);
+	file_offset_t done = 0;
+	int ret = 0;
+	while (true) {
+		bool finished;
+		file_offset_t written = stream.wait(done + minChunk, &finished);
+		if (finished) {
+			// readFile() has returned. Process the rest
+			// of the data, unless an error occurred.
+			break;
+		}
+
+		// Only process complete aligned chunks.
+		written -= ((written - done) % align);
+		if (written > done) {
+			ret = fn(param, p + done, (size_t)(written - done));
+			if (ret != 0) {
+				// Cancel the read.
+				stream.cancel();
+				break;
+			}
+			done = written;
+		}
+	}
+
+	reader.join();
+	m_stream = nullptr;
+
+	if (ret == 0) {
+		ret = readRet;
+		if (ret == 0 && readSiz > done) {
+			// Process the rest of the data.
+			ret = fn(param, p + done, (size_t)(readSiz - done));
+		}
+	}
+	if (ret != 0) {
+		m_lastError = -ret;
+	}
+	*ret_siz = readSiz;
+	return ret;
+}
+
+/**
+ * Report readFile() progress to readFileStream().
+ * Subclasses should call this in readFile() whenever
+ * more data has been written to the caller's buffer.
+ * This does nothing if readFileStream() isn't active.
+ *
+ * @param written	[in] Total number of bytes written to buf so far.
+ * @return 0 to continue; -ECANCELED if the read was cancelled.
+ */
+int Archive::streamProgress(file_offset_t written)
+{
+	if (!m_stream)
+		return 0;
+	return m_stream->publish(written);
+}
+
+
+/**
+ * Map an entire file from the archive into memory. (read-only)
+ * This is only possible if the file is stored uncompressed.
+ * Archive handlers that need to decompress the file will
+ * return -ENOTSUP; use readFile() in that case.
+ *
+ * The mapping remains valid until unmapFile() or close()
+ * is called, or until the Archive object is deleted.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+ * @param ptr		[out] Pointer to the mapped file data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Archive::mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr)
+{
+	if (!z_entry || !ptr || z_entry->filesize == 0) {
+		m_lastError = EINVAL;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	} else if (!m_file) {
+		m_lastError = EBADF;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	}
+
+	// The base class handles plain files, so the
+	// file is always stored uncompressed.
+	if (m_map) {
+		if (m_mapSize == z_entry->filesize) {
+			// File is already mapped.
+			*ptr = m_map;
+			return 0;
+		}
+		unmapFile();
+	}
+
+#if defined(_WIN32)
+	// Map the file using the Win32 file mapping API.
+	// NOTE: The mapping handle can be closed as soon as the
+	// view is mapped; the view keeps the mapping alive.
+	HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(m_file));
+	if (hFile == INVALID_HANDLE_VALUE) {
+		m_lastError = EBADF;
+		return -m_lastError;
+	}
+	HANDLE hMap = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!hMap) {
+		// TODO: Convert GetLastError() to a POSIX error code.
+		m_lastError = EIO;
+		return -m_lastError;
+	}
+	void *map = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, z_entry->filesize);
+	CloseHandle(hMap);
+	if (!map) {
+		// TODO: Convert GetLastError() to a POSIX error code.
+		m_lastError = EIO;
+		return -m_lastError;
+	}
+#elif defined(HAVE_MMAP)
+	// Map the file using mmap().
+	// MAP_PRIVATE: Pages are shared with the page cache
+	// (and other processes mapping the same file) until
+	// they're written to, which we never do.
+	void *map = mmap(nullptr, z_entry->filesize, PROT_READ,
+			 MAP_PRIVATE, fileno(m_file), 0);
+	if (map == MAP_FAILED) {
 		m_lastError = errno;
 		return -m_lastError;
 	}
+#ifdef MADV_SEQUENTIAL
+	// The file is usually read from start to finish.
+	madvise(map, z_entry->filesize, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+#else /* !_WIN32 && !HAVE_MMAP */
+	// File mapping isn't supported on this system.
+	m_lastError = ENOTSUP;
+	return -m_lastError;
+#endif
+
+#if defined(_WIN32) || defined(HAVE_MMAP)
+	m_map = static_cast<const uint8_t*>(map);
+	m_mapSize = z_entry->filesize;
+	*ptr = m_map;
 	return 0; // TODO: return MDP_ERR_OK;
+#endif
 }
 
+/**
+ * Unmap the file mapped by mapFile().
+ * This does nothing if no file is mapped.
+ */
+void Archive::unmapFile(void)
+{
+	if (!m_map)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_map);
+#elif defined(HAVE_MMAP)
+	munmap(const_cast<uint8_t*>(m_map), m_mapSize);
+#endif
+
+	m_map = nullptr;
+	m_mapSize = 0;
+}
 
 /**
  * Free an allocated mdp_z_entry_t list.
@@ -72,6 +72,7 @@ typedef struct PACKED _mdp_z_entry_t {
 
 namespace LibGensFile {
 
+class ArchiveStream;
 class Archive
 {
 	public:
@@ -156,6 +157,67 @@ class Archive
 				     file_offset_t start_pos, file_offset_t read_len,
 				     void *buf, file_offset_t siz, file_offset_t *ret_siz);
 
+		/**
+		 * Stream callback for readFileStream().
+		 * The data may be modified in place.
+		 *
+		 * @param param	[in] User parameter.
+		 * @param data	[in] Chunk of the file in the caller's buffer.
+		 * @param len	[in] Length of data.
+		 * @return 0 to continue; negative POSIX error code to cancel the read.
+		 */
+		typedef int (*StreamFn)(void *param, uint8_t *data, size_t len);
+
+		/**
+		 * Read all or part of a file from the archive, and process
+		 * the data as it's being read.
+		 *
+		 * readFile() is run on a second thread. As data is written
+		 * to buf, fn is called on the calling thread for each new
+		 * chunk, in order, so processing (e.g. deinterleaving and
+		 * checksumming) is pipelined with decompression.
+		 *
+		 * Each chunk is a multiple of align bytes, except for the
+		 * last chunk. If fn returns an error, the read is cancelled.
+		 * If readFile() fails, fn may have processed part of the file.
+		 *
+		 * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to extract.
+		 * @param start_pos	[in]  Starting position within the file.
+		 * @param read_len	[in]  Number of bytes to read.
+		 * @param buf		[out] Buffer to read the file into.
+		 * @param siz		[in]  Size of buf. (Must be >= read_len.)
+		 * @param align		[in]  Chunk alignment, in bytes.
+		 * @param fn		[in]  Stream callback.
+		 * @param param		[in]  User parameter for fn.
+		 * @param ret_siz	[out] Pointer to file_offset_t to store the number of bytes read.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int readFileStream(const mdp_z_entry_t *z_entry,
+				   file_offset_t start_pos, file_offset_t read_len,
+				   void *buf, file_offset_t siz, size_t align,
+				   StreamFn fn, void *param, file_offset_t *ret_siz);
+
+		/**
+		 * Map an entire file from the archive into memory. (read-only)
+		 * This is only possible if the file is stored uncompressed.
+		 * Archive handlers that need to decompress the file will
+		 * return -ENOTSUP; use readFile() in that case.
+		 *
+		 * The mapping remains valid until unmapFile() or close()
+		 * is called, or until the Archive object is deleted.
+		 *
+		 * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+		 * @param ptr		[out] Pointer to the mapped file data.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		virtual int mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr);
+
+		/**
+		 * Unmap the file mapped by mapFile().
+		 * This does nothing if no file is mapped.
+		 */
+		void unmapFile(void);
+
 		/**
 		 * Free an allocated mdp_z_entry_t list.
 		 * @param z_entry Pointer to the first entry in the list.
@@ -173,11 +235,33 @@ class Archive
 		 */
 		int checkMagic(const uint8_t *magic, size_t siz);
 
+		/**
+		 * Report readFile() progress to readFileStream().
+		 * Subclasses should call this in readFile() whenever
+		 * more data has been written to the caller's buffer.
+		 * This does nothing if readFileStream() isn't active.
+		 *
+		 * @param written	[in] Total number of bytes written to buf so far.
+		 * @return 0 to continue; -ECANCELED if the read was cancelled.
+		 */
+		int streamProgress(file_offset_t written);
+
+		// Preferred chunk size for readFile() when streaming.
+		static const size_t STREAM_CHUNK_SIZE = 256*1024;
+
 	protected:
 		// Common variables accessible by subclasses.
 		std::string m_filename;	// Filename.
 		FILE *m_file;		// Opened file handle.
 		int m_lastError;	// Last error. (POSIX error code)
+
+	private:
+		// Memory-mapped file. (mapFile())
+		const uint8_t *m_map;
+		size_t m_mapSize;
+
+		// Active stream. (readFileStream())
+		ArchiveStream *m_stream;
 };
 
 /**
@@ -251,15 +251,56 @@ int Gzip::readFile(const mdp_z_entry_t *z_entry,
 	}
 
 	// Read the file into the buffer.
-	*ret_siz = gzread(m_gzFile, buf, (z_off_t)read_len);
-	if (*ret_siz != read_len) {
-		// Short read. Something went wrong.
-		// TODO: gzerror() returns a string...
-		// TODO: #include <errno.h> or <cerrno> in places?
-		m_lastError = EIO;
-		return -m_lastError;
+	// The file is decompressed in chunks so readFileStream()
+	// can process the data while it's being decompressed.
+	uint8_t *p = reinterpret_cast<uint8_t*>(buf);
+	*ret_siz = 0;
+	while (*ret_siz < read_len) {
+		const unsigned int len = (unsigned int)std::min(read_len - *ret_siz,
+				static_cast<file_offset_t>(STREAM_CHUNK_SIZE));
+		const int ret = gzread(m_gzFile, p, len);
+		if (ret > 0) {
+			*ret_siz += ret;
+			p += ret;
+		}
+		if (ret != (int)len) {
+			// Short read. Something went wrong.
+			// TODO: gzerror() returns a string...
+			// TODO: #include <errno.h> or <cerrno> in places?
+			m_lastError = EIO;
+			return -m_lastError;
+		}
+
+		int sret = streamProgress(*ret_siz);
+		if (sret != 0) {
+			m_lastError = -sret;
+			return sret;
+		}
 	}
 	return 0; // TODO: return MDP_ERR_OK;
 }
 
+/**
+ * Map an entire file from the archive into memory. (read-only)
+ * Only supported if the file is not gzipped.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+ * @param ptr		[out] Pointer to the mapped file data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Gzip::mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr)
+{
+	if (!m_file || !m_gzFile) {
+		m_lastError = EBADF;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	} else if (!gzdirect(m_gzFile)) {
+		// File is gzipped and must be decompressed.
+		m_lastError = ENOTSUP;
+		return -m_lastError;
+	}
+
+	// File isn't gzipped. Map it directly.
+	return Archive::mapFile(z_entry, ptr);
+}
+
 }
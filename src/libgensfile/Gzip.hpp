@@ -78,6 +78,16 @@ class Gzip : public Archive
 				     file_offset_t start_pos, file_offset_t read_len,
 				     void *buf, file_offset_t siz, file_offset_t *ret_siz) final;
 
+		/**
+		 * Map an entire file from the archive into memory. (read-only)
+		 * Only supported if the file is not gzipped.
+		 *
+		 * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+		 * @param ptr		[out] Pointer to the mapped file data.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		virtual int mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr) final;
+
 	private:
 		gzFile m_gzFile;
 };
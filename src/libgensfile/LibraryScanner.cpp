@@ -0,0 +1,862 @@
+/***************************************************************************
+ * libgensfile: Gens file handling library.                                *
+ * LibraryScanner.cpp: ROM library scanner.                                *
+ *                                                                         *
+ * Copyright (c) 2016 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include <config.libgensfile.h>
+#include "LibraryScanner.hpp"
+#include "ArchiveFactory.hpp"
+#include "Archive.hpp"
+
+// C includes.
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+// Byteswapping macros.
+#include "libcompat/byteswap.h"
+
+// ZLib. (for crc32())
+#include <zlib.h>
+
+#ifdef _WIN32
+// Win32 Unicode Translation Layer.
+// Needed for proper Unicode filename support on Windows.
+// Also required for large file support.
+#include "libcompat/W32U/W32U_mini.h"
+#endif
+
+namespace LibGensFile {
+
+class LibraryScannerPrivate
+{
+	public:
+		LibraryScannerPrivate();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		LibraryScannerPrivate(const LibraryScannerPrivate &);
+		LibraryScannerPrivate &operator=(const LibraryScannerPrivate &);
+
+	public:
+		LibraryScanner::IdentifyFn identify;
+		int threadCount;
+		int64_t maxCrcSize;
+
+		// Indexed files, sorted by filename.
+		vector<LibraryScanner::File> files;
+
+		// Index file magic and version.
+		static const char INDEX_MAGIC[8];
+		static const uint32_t INDEX_VERSION = 1;
+
+		/**
+		 * Check if a filename has a ROM or archive file extension.
+		 * @param filename Filename.
+		 * @return True if the file should be scanned; false if not.
+		 */
+		static bool isRomExtension(const string &filename);
+
+		/**
+		 * Recursively list the files in a directory tree.
+		 * Symbolic links to directories aren't followed.
+		 * @param path	[in]  Directory.
+		 * @param found	[out] Files found. (mtime and size are set)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int walk(const string &path, vector<LibraryScanner::File> *found);
+
+		/**
+		 * Scan a file.
+		 * file->filename must be set.
+		 * @param file	[in,out] File.
+		 */
+		void scanFile(LibraryScanner::File *file) const;
+
+		/**
+		 * Calculate the CRC32 of a file and identify it.
+		 * @param entry	[in,out] Entry.
+		 * @param data	[in] File data.
+		 * @param size	[in] Size of data.
+		 */
+		void identifyData(LibraryScanner::Entry *entry, const uint8_t *data, size_t size) const;
+
+		/**
+		 * Check if an indexed file needs to be scanned again.
+		 * @param indexed	[in] File from the index.
+		 * @param found		[in] File from the directory tree.
+		 * @return True if the file needs to be scanned again.
+		 */
+		bool isStale(const LibraryScanner::File &indexed, const LibraryScanner::File &found) const;
+
+		/**
+		 * Find an indexed file.
+		 * @param filename Full pathname.
+		 * @return Index in files, or -1 if it isn't indexed.
+		 */
+		int findFile(const string &filename) const;
+
+		/**
+		 * Sort the indexed files by filename.
+		 */
+		void sortFiles(void);
+};
+
+// Static constants.
+const size_t LibraryScanner::HEADER_SIZE;
+
+// Index file magic.
+const char LibraryScannerPrivate::INDEX_MAGIC[8] = {'G','E','N','S','L','I','B','\0'};
+
+LibraryScannerPrivate::LibraryScannerPrivate()
+	: identify(nullptr)
+	, threadCount(0)
+	, maxCrcSize(64*1024*1024)
+{ }
+
+/**
+ * Check if a filename has a ROM or archive file extension.
+ * @param filename Filename.
+ * @return True if the file should be scanned; false if not.
+ */
+bool LibraryScannerPrivate::isRomExtension(const string &filename)
+{
+	// TODO: Allow the caller to change the list of extensions?
+	static const char *const exts[] = {
+		// ROM images.
+		"bin", "gen", "md", "smd", "32x", "sms", "gg", "sg", "pco", "iso",
+		// Archives.
+		"zip", "7z", "rar", "gz", "xz", "lzma",
+		nullptr
+	};
+
+	size_t dot = filename.rfind('.');
+	size_t slash = filename.rfind('/');
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return false;
+
+	string ext = filename.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	for (const char *const *p = exts; *p != nullptr; p++) {
+		if (ext == *p)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Recursively list the files in a directory tree.
+ * Symbolic links to directories aren't followed.
+ * @param path	[in]  Directory.
+ * @param found	[out] Files found. (mtime and size are set)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int LibraryScannerPrivate::walk(const string &path, vector<LibraryScanner::File> *found)
+{
+#ifdef _WIN32
+	// TODO: Use FindFirstFileW() on Windows.
+	((void)path);
+	((void)found);
+	return -ENOSYS;
+#else /* !_WIN32 */
+	DIR *dir = opendir(path.c_str());
+	if (!dir)
+		return -errno;
+
+	vector<string> subdirs;
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != nullptr) {
+		if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+			continue;
+
+		string filename = path + '/' + ent->d_name;
+		struct stat st;
+		if (lstat(filename.c_str(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			// Scan subdirectories after closing this one.
+			subdirs.push_back(filename);
+			continue;
+		} else if (S_ISLNK(st.st_mode)) {
+			// Follow symbolic links to files only.
+			if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+				continue;
+		} else if (!S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		if (!isRomExtension(filename))
+			continue;
+
+		LibraryScanner::File file;
+		file.filename = filename;
+		file.mtime = (int64_t)st.st_mtime;
+		file.size = (int64_t)st.st_size;
+		found->push_back(file);
+	}
+	closedir(dir);
+
+	// Scan the subdirectories.
+	// Errors in subdirectories are ignored.
+	for (vector<string>::const_iterator iter = subdirs.begin();
+	     iter != subdirs.end(); ++iter)
+	{
+		walk(*iter, found);
+	}
+	return 0;
+#endif /* _WIN32 */
+}
+
+/**
+ * Calculate the CRC32 of a file and identify it.
+ * @param entry	[in,out] Entry.
+ * @param data	[in] File data.
+ * @param size	[in] Size of data.
+ */
+void LibraryScannerPrivate::identifyData(LibraryScanner::Entry *entry, const uint8_t *data, size_t size) const
+{
+	if ((int64_t)size == entry->filesize) {
+		// Entire file. Calculate the CRC32.
+		// zlib's crc32() uses a 32-bit length.
+		uLong crc = ::crc32(0, nullptr, 0);
+		const uint8_t *p = data;
+		for (size_t remain = size; remain > 0; ) {
+			const uInt len = (uInt)std::min(remain, (size_t)0x40000000);
+			crc = ::crc32(crc, p, len);
+			p += len;
+			remain -= len;
+		}
+		entry->crc32 = (uint32_t)crc;
+		entry->hasCrc32 = true;
+	}
+
+	if (!identify)
+		return;
+
+	// The identify function always gets HEADER_SIZE bytes.
+	const size_t header_size = std::min(size, LibraryScanner::HEADER_SIZE);
+	int ret;
+	if (header_size == LibraryScanner::HEADER_SIZE) {
+		ret = identify(data, header_size, entry->filesize, &entry->header);
+	} else {
+		vector<uint8_t> header(LibraryScanner::HEADER_SIZE);
+		memcpy(header.data(), data, header_size);
+		ret = identify(header.data(), header_size, entry->filesize, &entry->header);
+	}
+	entry->hasHeader = (ret == 0);
+}
+
+/**
+ * Scan a file.
+ * file->filename must be set.
+ * @param file	[in,out] File.
+ */
+void LibraryScannerPrivate::scanFile(LibraryScanner::File *file) const
+{
+	file->error = 0;
+	file->entries.clear();
+
+	Archive *archive = ArchiveFactory::openArchive(file->filename.c_str());
+	if (!archive) {
+		// TODO: Get the error code from ArchiveFactory.
+		file->error = -EIO;
+		return;
+	}
+
+	mdp_z_entry_t *z_entry_list;
+	int ret = archive->getFileInfo(&z_entry_list);
+	if (ret != 0) {
+		file->error = (ret < 0 ? ret : -EIO);
+		delete archive;
+		return;
+	}
+
+	vector<uint8_t> buf;
+	for (const mdp_z_entry_t *z_entry = z_entry_list;
+	     z_entry != nullptr; z_entry = z_entry->next)
+	{
+		LibraryScanner::Entry entry;
+		if (z_entry->filename) {
+			entry.z_filename = z_entry->filename;
+		}
+		entry.filesize = z_entry->filesize;
+		// NOTE: This is set even if the file can't be read,
+		// so unreadable files aren't scanned again every time.
+		entry.identified = (identify != nullptr);
+
+		if (entry.filesize <= maxCrcSize) {
+			// Try mapping the file first, so uncompressed files
+			// are checksummed without copying them into buf.
+			const uint8_t *ptr;
+			if (archive->mapFile(z_entry, &ptr) == 0) {
+				identifyData(&entry, ptr, (size_t)entry.filesize);
+				archive->unmapFile();
+			} else {
+				// Decompress the entire file.
+				Archive::file_offset_t ret_siz = 0;
+				buf.resize((size_t)entry.filesize);
+				ret = archive->readFile(z_entry, buf.data(), buf.size(), &ret_siz);
+				if (ret == 0 && ret_siz == entry.filesize) {
+					identifyData(&entry, buf.data(), buf.size());
+				} else if (file->error == 0) {
+					file->error = (ret < 0 ? ret : -EIO);
+				}
+			}
+		} else if (identify) {
+			// File is too large to check the CRC32.
+			// Only read the header.
+			Archive::file_offset_t ret_siz = 0;
+			buf.resize(LibraryScanner::HEADER_SIZE);
+			ret = archive->readFile(z_entry, buf.data(), buf.size(), &ret_siz);
+			if (ret == 0 && ret_siz > 0) {
+				identifyData(&entry, buf.data(), (size_t)ret_siz);
+			} else if (file->error == 0) {
+				file->error = (ret < 0 ? ret : -EIO);
+			}
+		}
+
+		file->entries.push_back(entry);
+	}
+
+	Archive::z_entry_t_free(z_entry_list);
+	delete archive;
+}
+
+/**
+ * Check if an indexed file needs to be scanned again.
+ * @param indexed	[in] File from the index.
+ * @param found		[in] File from the directory tree.
+ * @return True if the file needs to be scanned again.
+ */
+bool LibraryScannerPrivate::isStale(const LibraryScanner::File &indexed, const LibraryScanner::File &found) const
+{
+	if (indexed.mtime != found.mtime || indexed.size != found.size)
+		return true;
+
+	if (identify) {
+		// If the file was indexed without an identify
+		// function, it has to be scanned again.
+		// NOTE: Don't check hasHeader here. Files that aren't
+		// valid ROM images would be scanned again every time.
+		for (vector<LibraryScanner::Entry>::const_iterator iter = indexed.entries.begin();
+		     iter != indexed.entries.end(); ++iter)
+		{
+			if (!iter->identified)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Compare two files by filename.
+ * @param a First file.
+ * @param b Second file.
+ * @return True if a < b.
+ */
+static bool FileLess(const LibraryScanner::File &a, const LibraryScanner::File &b)
+{
+	return (a.filename < b.filename);
+}
+
+/**
+ * Find an indexed file.
+ * @param filename Full pathname.
+ * @return Index in files, or -1 if it isn't indexed.
+ */
+int LibraryScannerPrivate::findFile(const string &filename) const
+{
+	LibraryScanner::File key;
+	key.filename = filename;
+	vector<LibraryScanner::File>::const_iterator iter =
+		std::lower_bound(files.begin(), files.end(), key, FileLess);
+	if (iter == files.end() || iter->filename != filename)
+		return -1;
+	return (int)(iter - files.begin());
+}
+
+/**
+ * Sort the indexed files by filename.
+ */
+void LibraryScannerPrivate::sortFiles(void)
+{
+	std::sort(files.begin(), files.end(), FileLess);
+}
+
+/** LibraryScanner **/
+
+LibraryScanner::LibraryScanner()
+	: d(new LibraryScannerPrivate())
+{ }
+
+LibraryScanner::~LibraryScanner()
+{
+	delete d;
+}
+
+/**
+ * Set the identify function.
+ * Files that were indexed without an identify
+ * function will be scanned again.
+ * @param identify Identify function, or nullptr for none.
+ */
+void LibraryScanner::setIdentifyFn(IdentifyFn identify)
+{
+	d->identify = identify;
+}
+
+/**
+ * Get the number of worker threads.
+ * @return Number of worker threads. (0 == one per CPU)
+ */
+int LibraryScanner::threadCount(void) const
+{
+	return d->threadCount;
+}
+
+/**
+ * Set the number of worker threads.
+ * @param threadCount Number of worker threads. (0 == one per CPU)
+ */
+void LibraryScanner::setThreadCount(int threadCount)
+{
+	d->threadCount = (threadCount >= 0 ? threadCount : 0);
+}
+
+/**
+ * Get the maximum file size for CRC32 calculation.
+ * Larger files, e.g. CD images, only have their headers read.
+ * @return Maximum file size, in bytes.
+ */
+int64_t LibraryScanner::maxCrcSize(void) const
+{
+	return d->maxCrcSize;
+}
+
+/**
+ * Set the maximum file size for CRC32 calculation.
+ * Larger files, e.g. CD images, only have their headers read.
+ * @param maxCrcSize Maximum file size, in bytes.
+ */
+void LibraryScanner::setMaxCrcSize(int64_t maxCrcSize)
+{
+	d->maxCrcSize = maxCrcSize;
+}
+
+/**
+ * Scan a directory tree.
+ * Files that haven't changed since they were indexed are
+ * reused. Indexed files in the directory tree that no
+ * longer exist are removed from the index.
+ * @param path		[in]  Directory to scan.
+ * @param stats		[out,opt] Scan statistics.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int LibraryScanner::scan(const char *path, Stats *stats)
+{
+	Stats st;
+	memset(&st, 0, sizeof(st));
+	if (stats) {
+		*stats = st;
+	}
+
+	// Remove trailing slashes.
+	string root(path);
+	while (root.size() > 1 && root[root.size()-1] == '/') {
+		root.resize(root.size() - 1);
+	}
+
+	// List the files in the directory tree.
+	vector<File> found;
+	int ret = d->walk(root, &found);
+	if (ret != 0)
+		return ret;
+	st.files = (unsigned int)found.size();
+
+	// Reuse files that haven't changed.
+	vector<size_t> work;
+	unsigned int indexed = 0;
+	for (size_t i = 0; i < found.size(); i++) {
+		const int idx = d->findFile(found[i].filename);
+		if (idx >= 0) {
+			indexed++;
+		}
+		if (idx >= 0 && !d->isStale(d->files[idx], found[i])) {
+			found[i].error = d->files[idx].error;
+			found[i].entries = d->files[idx].entries;
+			st.unchanged++;
+		} else {
+			work.push_back(i);
+		}
+	}
+
+	// Scan the new and modified files.
+	if (!work.empty()) {
+		unsigned int threads = (unsigned int)d->threadCount;
+		if (threads == 0) {
+			threads = std::thread::hardware_concurrency();
+			if (threads == 0)
+				threads = 1;
+		}
+		threads = std::min(threads, (unsigned int)work.size());
+
+		// Each worker takes the next file from the work list.
+		std::atomic<size_t> next(0);
+		const LibraryScannerPrivate *const cd = d;
+		auto worker = [cd, &work, &found, &next]() {
+			size_t i;
+			while ((i = next++) < work.size()) {
+				cd->scanFile(&found[work[i]]);
+			}
+		};
+
+		vector<std::thread> pool;
+		for (unsigned int i = 1; i < threads; i++) {
+			pool.push_back(std::thread(worker));
+		}
+		// The calling thread is also a worker.
+		worker();
+		for (vector<std::thread>::iterator iter = pool.begin();
+		     iter != pool.end(); ++iter)
+		{
+			iter->join();
+		}
+
+		st.scanned = (unsigned int)work.size();
+		for (vector<size_t>::const_iterator iter = work.begin();
+		     iter != work.end(); ++iter)
+		{
+			if (found[*iter].error != 0)
+				st.errors++;
+		}
+	}
+
+	// Replace the indexed files in the directory tree.
+	const string prefix = root + '/';
+	vector<File> files;
+	files.reserve(d->files.size() + found.size());
+	for (vector<File>::iterator iter = d->files.begin();
+	     iter != d->files.end(); ++iter)
+	{
+		if (iter->filename.compare(0, prefix.size(), prefix) != 0) {
+			// Not in this directory tree.
+			files.push_back(*iter);
+		}
+	}
+	st.removed = (unsigned int)(d->files.size() - files.size()) - indexed;
+	files.insert(files.end(), found.begin(), found.end());
+	d->files.swap(files);
+	d->sortFiles();
+
+	if (stats) {
+		*stats = st;
+	}
+	return 0;
+}
+
+/**
+ * Get the indexed files.
+ * @return Indexed files, sorted by filename.
+ */
+const vector<LibraryScanner::File> &LibraryScanner::files(void) const
+{
+	return d->files;
+}
+
+/**
+ * Find an indexed file.
+ * @param filename Full pathname.
+ * @return File, or nullptr if it isn't indexed.
+ */
+const LibraryScanner::File *LibraryScanner::findFile(const string &filename) const
+{
+	const int idx = d->findFile(filename);
+	return (idx >= 0 ? &d->files[idx] : nullptr);
+}
+
+/**
+ * Remove all files from the index.
+ */
+void LibraryScanner::clear(void)
+{
+	d->files.clear();
+}
+
+/** Index file I/O. **/
+
+/**
+ * Index file format: (all values are little-endian)
+ * - Header: magic[8], uint32 version, uint32 file count
+ * - File: string filename, int64 mtime, int64 size,
+ *         int32 error, uint32 entry count
+ * - Entry: string z_filename, int64 filesize, uint32 crc32,
+ *          uint8 flags (bit 0: hasCrc32; bit 1: hasHeader; bit 2: identified)
+ * - Header info, if hasHeader: int32 sysId, int32 romFormat,
+ *   int32 regionCode, uint16 checksum, string romNameJP,
+ *   string romNameUS, string serial
+ * - String: uint32 length, followed by UTF-8 data.
+ */
+
+#define INDEX_FLAG_CRC32	(1 << 0)
+#define INDEX_FLAG_HEADER	(1 << 1)
+#define INDEX_FLAG_IDENTIFIED	(1 << 2)
+
+static inline void WriteU16(string &out, uint16_t val)
+{
+	val = cpu_to_le16(val);
+	out.append((const char*)&val, sizeof(val));
+}
+
+static inline void WriteU32(string &out, uint32_t val)
+{
+	val = cpu_to_le32(val);
+	out.append((const char*)&val, sizeof(val));
+}
+
+static inline void WriteU64(string &out, uint64_t val)
+{
+	WriteU32(out, (uint32_t)val);
+	WriteU32(out, (uint32_t)(val >> 32));
+}
+
+static inline void WriteString(string &out, const string &str)
+{
+	WriteU32(out, (uint32_t)str.size());
+	out.append(str);
+}
+
+/**
+ * Index file reader.
+ * Reads are bounds-checked; if any read fails,
+ * all subsequent reads fail as well.
+ */
+class IndexReader
+{
+	public:
+		IndexReader(const vector<uint8_t> &data)
+			: m_data(data)
+			, m_pos(0)
+			, m_ok(true) { }
+
+		inline bool ok(void) const
+			{ return m_ok; }
+
+		inline bool read(void *buf, size_t siz)
+		{
+			if (!m_ok || siz > m_data.size() - m_pos) {
+				m_ok = false;
+				memset(buf, 0, siz);
+				return false;
+			}
+			memcpy(buf, &m_data[m_pos], siz);
+			m_pos += siz;
+			return true;
+		}
+
+		inline uint8_t u8(void)
+			{ uint8_t val; read(&val, sizeof(val)); return val; }
+		inline uint16_t u16(void)
+			{ uint16_t val; read(&val, sizeof(val)); return le16_to_cpu(val); }
+		inline uint32_t u32(void)
+			{ uint32_t val; read(&val, sizeof(val)); return le32_to_cpu(val); }
+		inline uint64_t u64(void)
+			{ const uint64_t lo = u32(); return lo | ((uint64_t)u32() << 32); }
+
+		inline string str(void)
+		{
+			const uint32_t len = u32();
+			if (!m_ok || len > m_data.size() - m_pos) {
+				m_ok = false;
+				return string();
+			}
+			string ret((const char*)&m_data[m_pos], len);
+			m_pos += len;
+			return ret;
+		}
+
+	private:
+		const vector<uint8_t> &m_data;
+		size_t m_pos;
+		bool m_ok;
+};
+
+/**
+ * Load an index file.
+ * The current index is replaced.
+ * @param filename Index filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int LibraryScanner::loadIndex(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return -errno;
+
+	// Read the entire index file.
+	vector<uint8_t> data;
+	uint8_t buf[65536];
+	size_t siz;
+	while ((siz = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data.insert(data.end(), buf, buf + siz);
+	}
+	const bool readError = (ferror(f) != 0);
+	fclose(f);
+	if (readError)
+		return -EIO;
+
+	IndexReader rd(data);
+	char magic[8];
+	rd.read(magic, sizeof(magic));
+	if (!rd.ok() || memcmp(magic, LibraryScannerPrivate::INDEX_MAGIC, sizeof(magic)) != 0)
+		return -EINVAL;
+	if (rd.u32() != LibraryScannerPrivate::INDEX_VERSION)
+		return -EINVAL;
+
+	vector<File> files;
+	const uint32_t fileCount = rd.u32();
+	for (uint32_t i = 0; i < fileCount && rd.ok(); i++) {
+		File file;
+		file.filename = rd.str();
+		file.mtime = (int64_t)rd.u64();
+		file.size = (int64_t)rd.u64();
+		file.error = (int)rd.u32();
+
+		const uint32_t entryCount = rd.u32();
+		for (uint32_t j = 0; j < entryCount && rd.ok(); j++) {
+			Entry entry;
+			entry.z_filename = rd.str();
+			entry.filesize = (int64_t)rd.u64();
+			entry.crc32 = rd.u32();
+			const uint8_t flags = rd.u8();
+			entry.hasCrc32 = !!(flags & INDEX_FLAG_CRC32);
+			entry.hasHeader = !!(flags & INDEX_FLAG_HEADER);
+			entry.identified = !!(flags & INDEX_FLAG_IDENTIFIED);
+			if (entry.hasHeader) {
+				entry.header.sysId = (int)rd.u32();
+				entry.header.romFormat = (int)rd.u32();
+				entry.header.regionCode = (int)rd.u32();
+				entry.header.checksum = rd.u16();
+				entry.header.romNameJP = rd.str();
+				entry.header.romNameUS = rd.str();
+				entry.header.serial = rd.str();
+			}
+			file.entries.push_back(entry);
+		}
+		files.push_back(file);
+	}
+
+	if (!rd.ok()) {
+		// Index file is truncated.
+		return -EINVAL;
+	}
+
+	d->files.swap(files);
+	d->sortFiles();
+	return 0;
+}
+
+/**
+ * Save the index to a file.
+ * @param filename Index filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int LibraryScanner::saveIndex(const char *filename) const
+{
+	string out;
+	out.append(LibraryScannerPrivate::INDEX_MAGIC, sizeof(LibraryScannerPrivate::INDEX_MAGIC));
+	WriteU32(out, LibraryScannerPrivate::INDEX_VERSION);
+	WriteU32(out, (uint32_t)d->files.size());
+
+	for (vector<File>::const_iterator file = d->files.begin();
+	     file != d->files.end(); ++file)
+	{
+		WriteString(out, file->filename);
+		WriteU64(out, (uint64_t)file->mtime);
+		WriteU64(out, (uint64_t)file->size);
+		WriteU32(out, (uint32_t)file->error);
+		WriteU32(out, (uint32_t)file->entries.size());
+
+		for (vector<Entry>::const_iterator entry = file->entries.begin();
+		     entry != file->entries.end(); ++entry)
+		{
+			WriteString(out, entry->z_filename);
+			WriteU64(out, (uint64_t)entry->filesize);
+			WriteU32(out, entry->crc32);
+			uint8_t flags = 0;
+			if (entry->hasCrc32)
+				flags |= INDEX_FLAG_CRC32;
+			if (entry->hasHeader)
+				flags |= INDEX_FLAG_HEADER;
+			if (entry->identified)
+				flags |= INDEX_FLAG_IDENTIFIED;
+			out.append(1, (char)flags);
+			if (entry->hasHeader) {
+				WriteU32(out, (uint32_t)entry->header.sysId);
+				WriteU32(out, (uint32_t)entry->header.romFormat);
+				WriteU32(out, (uint32_t)entry->header.regionCode);
+				WriteU16(out, entry->header.checksum);
+				WriteString(out, entry->header.romNameJP);
+				WriteString(out, entry->header.romNameUS);
+				WriteString(out, entry->header.serial);
+			}
+		}
+	}
+
+	// Write to a temporary file first, so an interrupted
+	// save doesn't corrupt the existing index.
+	const string tmpFilename = string(filename) + ".tmp";
+	FILE *f = fopen(tmpFilename.c_str(), "wb");
+	if (!f)
+		return -errno;
+	const size_t written = fwrite(out.data(), 1, out.size(), f);
+	if (fclose(f) != 0 || written != out.size()) {
+		remove(tmpFilename.c_str());
+		return -EIO;
+	}
+	if (rename(tmpFilename.c_str(), filename) != 0) {
+		// Windows can't rename over an existing file.
+		remove(filename);
+		if (rename(tmpFilename.c_str(), filename) != 0) {
+			int err = -errno;
+			remove(tmpFilename.c_str());
+			return err;
+		}
+	}
+	return 0;
+}
+
+}
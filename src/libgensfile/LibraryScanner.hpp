@@ -0,0 +1,230 @@
+/***************************************************************************
+ * libgensfile: Gens file handling library.                                *
+ * LibraryScanner.hpp: ROM library scanner.                                *
+ *                                                                         *
+ * Copyright (c) 2016 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+/**
+ * ROM library scanner.
+ *
+ * Walks a directory tree, lists the files in each archive,
+ * and calculates the CRC32 of each file. The first part of
+ * each file can be passed to an identify function, e.g.
+ * LibGens::Rom::IdentifyHeader(), to read the ROM header.
+ *
+ * Files are scanned by a pool of worker threads.
+ * The results can be saved to an index file; if the index
+ * is loaded before scanning, files with the same size and
+ * modification time aren't opened again.
+ */
+
+#ifndef __LIBGENSFILE_LIBRARYSCANNER_HPP__
+#define __LIBGENSFILE_LIBRARYSCANNER_HPP__
+
+// C includes.
+#include <stdint.h>
+#include <stddef.h>
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+namespace LibGensFile {
+
+class LibraryScannerPrivate;
+class LibraryScanner
+{
+	public:
+		LibraryScanner();
+		~LibraryScanner();
+
+	private:
+		friend class LibraryScannerPrivate;
+		LibraryScannerPrivate *const d;
+
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibGens-specific version of Q_DISABLE_COPY().
+		LibraryScanner(const LibraryScanner &);
+		LibraryScanner &operator=(const LibraryScanner &);
+
+	public:
+		// Number of bytes passed to the identify function.
+		// This is the same size that Rom uses for detection.
+		static const size_t HEADER_SIZE = 65536+512;
+
+		/**
+		 * ROM header information.
+		 * Filled in by the identify function.
+		 */
+		struct HeaderInfo {
+			int sysId;		// System ID. (LibGens::Rom::MDP_SYSTEM_ID)
+			int romFormat;		// ROM format. (LibGens::Rom::RomFormat)
+			int regionCode;		// Region code. (MD hex format)
+			uint16_t checksum;	// Checksum from the ROM header.
+			std::string romNameJP;	// Domestic name. (UTF-8)
+			std::string romNameUS;	// Overseas name. (UTF-8)
+			std::string serial;	// Serial number.
+
+			HeaderInfo()
+				: sysId(0)
+				, romFormat(0)
+				, regionCode(0)
+				, checksum(0) { }
+		};
+
+		/**
+		 * Identify function.
+		 * @param header	[in]  First HEADER_SIZE bytes of the file. (zero-padded)
+		 * @param header_size	[in]  Number of valid bytes in header.
+		 * @param file_size	[in]  File size.
+		 * @param info		[out] ROM header information.
+		 * @return 0 on success; non-zero on error.
+		 */
+		typedef int (*IdentifyFn)(const uint8_t *header, size_t header_size,
+					  int64_t file_size, HeaderInfo *info);
+
+		/**
+		 * File within an archive.
+		 * Plain files are treated as an archive with one file.
+		 */
+		struct Entry {
+			std::string z_filename;	// Filename within the archive.
+			int64_t filesize;	// Uncompressed file size.
+			uint32_t crc32;		// CRC32 of the file as stored. (not deinterleaved)
+			bool hasCrc32;		// False if the file is larger than maxCrcSize().
+			bool hasHeader;		// True if header is valid.
+			bool identified;	// True if the identify function was run.
+			HeaderInfo header;	// ROM header information.
+
+			Entry()
+				: filesize(0)
+				, crc32(0)
+				, hasCrc32(false)
+				, hasHeader(false)
+				, identified(false) { }
+		};
+
+		/**
+		 * Archive or plain file on disk.
+		 */
+		struct File {
+			std::string filename;	// Full pathname.
+			int64_t mtime;		// Modification time, in seconds.
+			int64_t size;		// File size on disk.
+			int error;		// 0 on success; negative POSIX error code on error.
+			std::vector<Entry> entries;
+
+			File()
+				: mtime(0)
+				, size(0)
+				, error(0) { }
+		};
+
+		/**
+		 * Scan statistics.
+		 */
+		struct Stats {
+			unsigned int files;	// Files found in the directory tree.
+			unsigned int scanned;	// Files that were opened and scanned.
+			unsigned int unchanged;	// Files reused from the index.
+			unsigned int removed;	// Files removed from the index.
+			unsigned int errors;	// Files that couldn't be scanned.
+		};
+
+		/**
+		 * Set the identify function.
+		 * Files that were indexed without an identify
+		 * function will be scanned again.
+		 * @param identify Identify function, or nullptr for none.
+		 */
+		void setIdentifyFn(IdentifyFn identify);
+
+		/**
+		 * Get the number of worker threads.
+		 * @return Number of worker threads. (0 == one per CPU)
+		 */
+		int threadCount(void) const;
+
+		/**
+		 * Set the number of worker threads.
+		 * @param threadCount Number of worker threads. (0 == one per CPU)
+		 */
+		void setThreadCount(int threadCount);
+
+		/**
+		 * Get the maximum file size for CRC32 calculation.
+		 * Larger files, e.g. CD images, only have their headers read.
+		 * @return Maximum file size, in bytes.
+		 */
+		int64_t maxCrcSize(void) const;
+
+		/**
+		 * Set the maximum file size for CRC32 calculation.
+		 * Larger files, e.g. CD images, only have their headers read.
+		 * @param maxCrcSize Maximum file size, in bytes.
+		 */
+		void setMaxCrcSize(int64_t maxCrcSize);
+
+		/**
+		 * Scan a directory tree.
+		 * Files that haven't changed since they were indexed are
+		 * reused. Indexed files in the directory tree that no
+		 * longer exist are removed from the index.
+		 * @param path		[in]  Directory to scan.
+		 * @param stats		[out,opt] Scan statistics.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int scan(const char *path, Stats *stats = nullptr);
+
+		/**
+		 * Get the indexed files.
+		 * @return Indexed files, sorted by filename.
+		 */
+		const std::vector<File> &files(void) const;
+
+		/**
+		 * Find an indexed file.
+		 * @param filename Full pathname.
+		 * @return File, or nullptr if it isn't indexed.
+		 */
+		const File *findFile(const std::string &filename) const;
+
+		/**
+		 * Remove all files from the index.
+		 */
+		void clear(void);
+
+		/**
+		 * Load an index file.
+		 * The current index is replaced.
+		 * @param filename Index filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int loadIndex(const char *filename);
+
+		/**
+		 * Save the index to a file.
+		 * @param filename Index filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int saveIndex(const char *filename) const;
+};
+
+}
+
+#endif /* __LIBGENSFILE_LIBRARYSCANNER_HPP__ */
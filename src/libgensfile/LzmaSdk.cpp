@@ -54,8 +54,18 @@ using std::u16string;
 
 namespace LibGensFile {
 
-// Set to true if the LZMA SDK CRC tables have been initialized.
-bool LzmaSdk::ms_CrcInit = false;
+// Initializes the LZMA SDK CRC tables once.
+std::once_flag LzmaSdk::ms_CrcInit;
+
+/**
+ * Generate the LZMA SDK CRC tables.
+ * Called by std::call_once().
+ */
+void LzmaSdk::crcInit(void)
+{
+	CrcGenerateTable();
+	Crc64GenerateTable();
+}
 
 /**
  * Open a file with this archive handler.
@@ -147,11 +157,7 @@ int LzmaSdk::lzmaInit(void)
 	LookToRead_Init(&m_lookStream);
 
 	// Generate the CRC tables.
-	if (!ms_CrcInit) {
-		CrcGenerateTable();
-		Crc64GenerateTable();
-		ms_CrcInit = true;
-	}
+	std::call_once(ms_CrcInit, crcInit);
 
 	// LZMA SDK is initialized.
 	// Subclass must open the archive using Sz, Xz, or LZMA functions.
@@ -226,4 +232,22 @@ int LzmaSdk::readFile(const mdp_z_entry_t *z_entry,
 	return -m_lastError;	// TODO: MDP error code?
 }
 
+/**
+ * Map an entire file from the archive into memory. (read-only)
+ * Not supported for LZMA SDK archives; this always returns -ENOTSUP.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+ * @param ptr		[out] Pointer to the mapped file data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int LzmaSdk::mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr)
+{
+	// Files in LZMA SDK archives must be decompressed.
+	// TODO: Map stored (uncompressed) files?
+	((void)z_entry);
+	((void)ptr);
+	m_lastError = ENOTSUP;
+	return -m_lastError;
+}
+
 }
@@ -30,6 +30,9 @@
 
 #include "Archive.hpp"
 
+// C++ includes.
+#include <mutex>
+
 // LZMA SDK includes.
 #include "lzma/Alloc.h"
 #include "lzma/7zFile.h"
@@ -85,6 +88,16 @@ class LzmaSdk : public Archive
 				     file_offset_t start_pos, file_offset_t read_len,
 				     void *buf, file_offset_t siz, file_offset_t *ret_siz) override;
 
+		/**
+		 * Map an entire file from the archive into memory. (read-only)
+		 * Not supported for LZMA SDK archives; this always returns -ENOTSUP.
+		 *
+		 * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+		 * @param ptr		[out] Pointer to the mapped file data.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		virtual int mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr) override;
+
 	protected:
 		/**
 		 * Initialize the LZMA SDK.
@@ -99,8 +112,15 @@ class LzmaSdk : public Archive
 		int lzmaInit(void);
 
 	private:
-		// Set to true if the LZMA SDK CRC tables has been initialized.
-		static bool ms_CrcInit;
+		// Initializes the LZMA SDK CRC tables once.
+		// Archives may be opened from multiple threads.
+		static std::once_flag ms_CrcInit;
+
+		/**
+		 * Generate the LZMA SDK CRC tables.
+		 * Called by std::call_once().
+		 */
+		static void crcInit(void);
 
 	protected:
 		// Memory allocators.
@@ -156,4 +156,28 @@ int MemFake::readFile(const mdp_z_entry_t *z_entry,
 	return 0; // TODO: return MDP_ERR_OK;
 }
 
+/**
+ * Map an entire file from the archive into memory. (read-only)
+ * The memory area is returned directly; nothing is copied.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+ * @param ptr		[out] Pointer to the mapped file data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int MemFake::mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr)
+{
+	if (!z_entry || !ptr) {
+		m_lastError = EINVAL;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	} else if (!m_rom_data) {
+		// Note that m_file is not checked since we're not using a file.
+		m_lastError = EBADF;
+		return -m_lastError; // TODO: return -MDP_ERR_INVALID_PARAMETERS;
+	}
+
+	// The ROM data is already in memory.
+	*ptr = m_rom_data;
+	return 0; // TODO: return MDP_ERR_OK;
+}
+
 }
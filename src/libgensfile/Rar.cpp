@@ -505,6 +505,24 @@ int Rar::readFile(const mdp_z_entry_t *z_entry,
 	return 0; // TODO: return MDP_ERR_OK;
 }
 
+/**
+ * Map an entire file from the archive into memory. (read-only)
+ * Not supported for RAR archives; this always returns -ENOTSUP.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+ * @param ptr		[out] Pointer to the mapped file data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Rar::mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr)
+{
+	// Files in RAR archives must be decompressed.
+	// TODO: Map stored (uncompressed) files?
+	((void)z_entry);
+	((void)ptr);
+	m_lastError = ENOTSUP;
+	return -m_lastError;
+}
+
 /**
  * Win32 UnRAR.dll callback function. [STATIC]
  */
@@ -543,6 +561,12 @@ int CALLBACK Rar::RarCallback(UINT msg, LPARAM UserData, LPARAM P1, LPARAM P2)
 			// Copy the data.
 			memcpy(&pRarState->buf[pRarState->pos], buf, siz);
 			pRarState->pos += siz;
+
+			// Let readFileStream() process the new data.
+			if (pRarState->owner->streamProgress(pRarState->pos) != 0) {
+				// Read was cancelled.
+				return -1;
+			}
 			break;
 		}
 	}
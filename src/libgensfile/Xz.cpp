@@ -327,6 +327,13 @@ int Xz::readFile(const mdp_z_entry_t *z_entry,
 			outPos = 0;
 		}
 
+		// Let readFileStream() process the new data.
+		int sret = streamProgress(*ret_siz);
+		if (sret != 0) {
+			m_lastError = -sret;
+			return sret;
+		}
+
 		if (buf_spc_rem <= 0) {
 			// Out of space in the buffer.
 			// TODO: Error?
@@ -254,13 +254,36 @@ int Zip::readFile(const mdp_z_entry_t *z_entry,
 		}
 	}
 
+	*ret_siz = 0;
 	if (zResult == UNZ_OK) {
 		// Decompress the ROM data.
+		// The file is decompressed in chunks so readFileStream()
+		// can process the data while it's being decompressed.
 		// TODO: 64-bit MiniZip functions.
-		zResult = unzReadCurrentFile(m_unzFile, buf, (unsigned int)read_len);
+		uint8_t *p = reinterpret_cast<uint8_t*>(buf);
+		while (*ret_siz < read_len) {
+			const unsigned int len = (unsigned int)std::min(read_len - *ret_siz,
+					static_cast<file_offset_t>(STREAM_CHUNK_SIZE));
+			zResult = unzReadCurrentFile(m_unzFile, p, len);
+			if (zResult <= 0)
+				break;
+			*ret_siz += zResult;
+			p += zResult;
+
+			int sret = streamProgress(*ret_siz);
+			if (sret != 0) {
+				m_lastError = -sret;
+				return sret;
+			}
+
+			if (zResult < (int)len) {
+				// End of file.
+				break;
+			}
+		}
 	}
 
-	if (zResult <= 0) {
+	if (zResult < 0 || *ret_siz == 0) {
 		// An error occurred...
 		const char *zip_err;
 
@@ -299,8 +322,25 @@ int Zip::readFile(const mdp_z_entry_t *z_entry,
 	}
 
 	// File extracted successfully.
-	*ret_siz = (file_offset_t)zResult;
 	return 0; // TODO: return MDP_ERR_OK;
 }
 
+/**
+ * Map an entire file from the archive into memory. (read-only)
+ * Not supported for Zip archives; this always returns -ENOTSUP.
+ *
+ * @param z_entry	[in]  Pointer to mdp_z_entry_t describing the file to map.
+ * @param ptr		[out] Pointer to the mapped file data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Zip::mapFile(const mdp_z_entry_t *z_entry, const uint8_t **ptr)
+{
+	// Files in Zip archives must be decompressed.
+	// TODO: Map stored (uncompressed) files?
+	((void)z_entry);
+	((void)ptr);
+	m_lastError = ENOTSUP;
+	return -m_lastError;
+}
+
 }
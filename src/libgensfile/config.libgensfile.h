@@ -33,4 +33,7 @@
 /* Define to 1 if LibGens is built with LZMA support using the included LZMA SDK. */
 #define HAVE_LZMA 1
 
+/* Define to 1 if you have the `mmap` function. */
+#define HAVE_MMAP 1
+
 #endif /* __LIBGENS_CONFIG_LIBGENSFILE_H__ */
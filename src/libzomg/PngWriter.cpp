@@ -121,6 +121,14 @@ class PngWriterPrivate
 		 */
 		static void png_io_minizip_flush(png_structp png_ptr);
 
+		/**
+		 * PNG memory buffer write function.
+		 * @param png_ptr PNG pointer.
+		 * @param buf Data to write.
+		 * @param len Size of buf.
+		 */
+		static void png_io_vector_write(png_structp png_ptr, png_bytep buf, png_size_t len);
+
 		/**
 		 * Internal PNG write function.
 		 * @param png_ptr	[in] PNG pointer.
@@ -218,6 +226,22 @@ void PngWriterPrivate::png_io_minizip_flush(png_structp png_ptr)
         ((void)png_ptr);
 }
 
+/**
+ * PNG memory buffer write function.
+ * @param png_ptr PNG pointer.
+ * @param buf Data to write.
+ * @param len Size of buf.
+ */
+void PngWriterPrivate::png_io_vector_write(png_structp png_ptr, png_bytep buf, png_size_t len)
+{
+	// Assuming io_ptr is a vector<uint8_t>.
+	vector<uint8_t> *vec = reinterpret_cast<vector<uint8_t>*>(png_get_io_ptr(png_ptr));
+	if (!vec)
+		return;
+
+	vec->insert(vec->end(), buf, buf + len);
+}
+
 /**
  * Internal PNG write function.
  * @param png_ptr	[in] PNG pointer.
@@ -312,7 +336,7 @@ int PngWriterPrivate::writeToPng(png_structp png_ptr, png_infop info_ptr,
 	// PNG metadata.
 	if (metadata) {
 		metadata->toPngData(png_ptr, info_ptr, metaFlags);
-	} else {
+	} else if (metaFlags != Metadata::MF_None) {
 		// No metadata specified.
 		// Use a blank Metadata object, which is basically CreationTime only.
 		Metadata metadata_default;
@@ -538,4 +562,67 @@ int PngWriter::writeToZip(const Zomg_Img_Data_t *img_data,
 	return ret;
 }
 
+/**
+ * Write an image to a PNG file in memory.
+ * The buffer is cleared first, but its capacity is retained,
+ * so reusing the same buffer avoids reallocation.
+ * @param img_data	[in] Image data.
+ * @param buf		[out] Buffer for the PNG file.
+ * @param metadata	[in, opt] Extra metadata.
+ * @param metaFlags	[in, opt] Metadata flags. (MF_None to skip metadata.)
+ * @return 0 on success; negative errno on error.
+ */
+int PngWriter::writeToMemory(const Zomg_Img_Data_t *img_data,
+			     vector<uint8_t> &buf,
+			     const Metadata *metadata,
+			     int metaFlags)
+{
+	buf.clear();
+	if (!img_data || !img_data->data ||
+	    img_data->w <= 0 || img_data->h <= 0 ||
+	    (img_data->bpp != 15 && img_data->bpp != 16 && img_data->bpp != 32)) {
+		// Invalid parameters.
+		return -EINVAL;
+	}
+
+	// Set some sane limits for image size.
+	if (img_data->w > 16384 || img_data->h > 16384) {
+		// Image is too big.
+		return -ENOMEM;
+	}
+
+	// Calculate the minimum pitch.
+	const unsigned int min_pitch = img_data->w * (img_data->bpp == 32 ? 4 : 2);
+	if (img_data->pitch < min_pitch) {
+		// Invalid parameters.
+		return -EINVAL;
+	}
+
+	png_structp png_ptr;
+	png_infop info_ptr;
+
+	// Initialize libpng.
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (!png_ptr) {
+		return -ENOMEM;
+	}
+	info_ptr = png_create_info_struct(png_ptr);
+	if (!info_ptr) {
+		png_destroy_write_struct(&png_ptr, nullptr);
+		return -ENOMEM;
+	}
+
+	// Initialize the custom I/O handler for the memory buffer.
+	png_set_write_fn(png_ptr, &buf, d->png_io_vector_write, d->png_io_minizip_flush);
+
+	// Write to PNG.
+	int ret = d->writeToPng(png_ptr, info_ptr, img_data, metadata, metaFlags);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	if (ret != 0) {
+		// Don't leave a partial image in the buffer.
+		buf.clear();
+	}
+	return ret;
+}
+
 }
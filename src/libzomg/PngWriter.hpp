@@ -24,6 +24,12 @@
 
 #include "minizip/zip.h"
 
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+
 // Image data struct.
 extern "C" struct _Zomg_Img_Data_t;
 
@@ -91,6 +97,21 @@ class PngWriter
 			       zipFile zfile,
 			       const Metadata *metadata,
 			       int metaFlags);
+
+		/**
+		 * Write an image to a PNG file in memory.
+		 * The buffer is cleared first, but its capacity is retained,
+		 * so reusing the same buffer avoids reallocation.
+		 * @param img_data	[in] Image data.
+		 * @param buf		[out] Buffer for the PNG file.
+		 * @param metadata	[in, opt] Extra metadata.
+		 * @param metaFlags	[in, opt] Metadata flags. (MF_None to skip metadata.)
+		 * @return 0 on success; negative errno on error.
+		 */
+		int writeToMemory(const _Zomg_Img_Data_t *img_data,
+				  std::vector<uint8_t> &buf,
+				  const Metadata *metadata,
+				  int metaFlags);
 };
 
 }
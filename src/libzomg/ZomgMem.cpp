@@ -0,0 +1,514 @@
+/***************************************************************************
+ * libzomg: Zipped Original Memory from Genesis.                           *
+ * ZomgMem.cpp: In-memory savestate handler.                               *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+#include "ZomgMem.hpp"
+
+// ZOMG save structs.
+#include "zomg_vdp.h"
+#include "zomg_psg.h"
+#include "zomg_ym2612.h"
+#include "zomg_m68k.h"
+#include "zomg_z80.h"
+#include "zomg_md_io.h"
+#include "zomg_md_z80_ctrl.h"
+#include "zomg_md_time_reg.h"
+#include "zomg_md_tmss_reg.h"
+#include "zomg_eeprom.h"
+
+// C includes. (C++ namespace)
+#include <cstring>
+#include <cerrno>
+
+namespace LibZomg {
+
+/**
+ * ZomgMem buffer layout:
+ * - ZomgMemHeader
+ * - Blocks: ZomgMemBlock, followed by the block data,
+ *   padded to a multiple of 8 bytes.
+ * All fields are host-endian.
+ */
+#define ZOMGMEM_MAGIC	0x5A4D454D	/* 'ZMEM' */
+#define ZOMGMEM_VERSION	2
+#define ZOMGMEM_ALIGN(x)	(((x) + 7) & ~(size_t)7)
+
+struct ZomgMemHeader {
+	uint32_t magic;		// ZOMGMEM_MAGIC
+	uint32_t version;	// ZOMGMEM_VERSION
+	uint32_t size;		// Size of the savestate, including this header.
+	uint32_t blocks;	// Number of blocks.
+	uint32_t system;	// System ID. (ZomgMem::SystemID)
+	uint32_t reserved;	// Reserved. (Keeps blocks 64-bit aligned.)
+};
+
+struct ZomgMemBlock {
+	uint32_t id;		// ZomgMem::BlockID
+	uint32_t size;		// Size of the block data. (not including padding)
+};
+
+/**
+ * Open a memory buffer as a savestate.
+ * ZOMG_SAVE: buf is written to. Existing contents are overwritten.
+ * If buf is nullptr, nothing is written, but size() will
+ * return the required buffer size after all blocks are saved.
+ * ZOMG_LOAD: buf is only read from, and it must contain
+ * a savestate created by ZomgMem. (const_cast is safe.)
+ * @param buf Memory buffer.
+ * @param siz Size of buf, in bytes.
+ * @param mode ZOMG_LOAD or ZOMG_SAVE.
+ * @param system System ID. Loading fails if this doesn't match the savestate.
+ */
+ZomgMem::ZomgMem(void *buf, size_t siz, ZomgFileMode mode, SystemID system)
+	: ZomgBase(nullptr, mode)
+	, m_buf(reinterpret_cast<uint8_t*>(buf))
+	, m_siz(siz)
+	, m_pos(0)
+	, m_cur(0)
+	, m_system(system)
+{
+	if (!buf) {
+		// nullptr is only valid for size calculation.
+		if (mode != ZOMG_SAVE) {
+			m_lastError = -EINVAL;
+			return;
+		}
+		m_siz = ~(size_t)0;
+	} else if (siz < sizeof(ZomgMemHeader)) {
+		m_lastError = (mode == ZOMG_SAVE ? -ENOSPC : -EINVAL);
+		return;
+	}
+
+	ZomgMemHeader header;
+	switch (mode) {
+		case ZOMG_LOAD:
+			memcpy(&header, m_buf, sizeof(header));
+			if (header.magic != ZOMGMEM_MAGIC ||
+			    header.version != ZOMGMEM_VERSION ||
+			    header.system != (uint32_t)system ||
+			    header.size < sizeof(header) ||
+			    header.size > siz)
+			{
+				// Not a valid ZomgMem savestate,
+				// or it's for a different system.
+				m_lastError = -EINVAL;
+				return;
+			}
+			m_pos = header.size;
+			m_cur = sizeof(header);
+			break;
+
+		case ZOMG_SAVE:
+			// The header is written by close().
+			m_pos = sizeof(header);
+			break;
+
+		default:
+			m_lastError = -EINVAL;
+			return;
+	}
+
+	m_mode = mode;
+}
+
+ZomgMem::~ZomgMem()
+{
+	close();
+}
+
+/**
+ * Close the savestate.
+ * ZOMG_SAVE: The header is written to the buffer.
+ */
+void ZomgMem::close(void)
+{
+	if (m_mode == ZOMG_SAVE && m_buf) {
+		// Count the blocks.
+		ZomgMemHeader header;
+		header.magic = ZOMGMEM_MAGIC;
+		header.version = ZOMGMEM_VERSION;
+		header.size = (uint32_t)m_pos;
+		header.blocks = 0;
+		header.system = (uint32_t)m_system;
+		header.reserved = 0;
+		for (size_t pos = sizeof(header); pos < m_pos; header.blocks++) {
+			ZomgMemBlock block;
+			memcpy(&block, &m_buf[pos], sizeof(block));
+			pos += sizeof(block) + ZOMGMEM_ALIGN(block.size);
+		}
+		memcpy(m_buf, &header, sizeof(header));
+	}
+
+	m_mode = ZOMG_CLOSED;
+}
+
+/**
+ * Save a block.
+ * @param id Block ID.
+ * @param data Block data.
+ * @param siz Size of data, in bytes.
+ * @return 0 on success; negative errno on error.
+ */
+int ZomgMem::saveBlock(BlockID id, const void *data, size_t siz)
+{
+	if (m_mode != ZOMG_SAVE)
+		return -EBADF;
+
+	const size_t total = sizeof(ZomgMemBlock) + ZOMGMEM_ALIGN(siz);
+	if (total > (m_siz - m_pos)) {
+		// Not enough space in the buffer.
+		m_lastError = -ENOSPC;
+		return -ENOSPC;
+	}
+
+	if (m_buf) {
+		ZomgMemBlock block;
+		block.id = (uint32_t)id;
+		block.size = (uint32_t)siz;
+		memcpy(&m_buf[m_pos], &block, sizeof(block));
+		memcpy(&m_buf[m_pos + sizeof(block)], data, siz);
+		// Zero the alignment padding so the same state
+		// always serializes to the same bytes.
+		memset(&m_buf[m_pos + sizeof(block) + siz], 0, ZOMGMEM_ALIGN(siz) - siz);
+	}
+	m_pos += total;
+	return 0;
+}
+
+/**
+ * Load a block.
+ * If the stored block is larger than siz, only siz bytes are loaded.
+ * @param id Block ID.
+ * @param data Block data buffer.
+ * @param siz Size of data, in bytes.
+ * @return Bytes read on success; negative errno on error.
+ */
+int ZomgMem::loadBlock(BlockID id, void *data, size_t siz)
+{
+	if (m_mode != ZOMG_LOAD)
+		return -EBADF;
+
+	// Blocks are usually loaded in the same order
+	// they were saved, so start searching at the
+	// block following the previously-loaded block.
+	size_t pos = m_cur;
+	do {
+		if (pos >= m_pos) {
+			// Wrap around to the first block.
+			pos = sizeof(ZomgMemHeader);
+			if (pos >= m_pos)
+				break;
+		}
+
+		ZomgMemBlock block;
+		memcpy(&block, &m_buf[pos], sizeof(block));
+		const size_t next = pos + sizeof(block) + ZOMGMEM_ALIGN(block.size);
+		if (next > m_pos) {
+			// Block is truncated.
+			break;
+		}
+
+		if (block.id == (uint32_t)id) {
+			// Found the block.
+			if (siz > block.size)
+				siz = block.size;
+			memcpy(data, &m_buf[pos + sizeof(block)], siz);
+			m_cur = next;
+			return (int)siz;
+		}
+
+		pos = next;
+	} while (pos != m_cur);
+
+	// Block not found.
+	return -ENOENT;
+}
+
+/** Load functions. **/
+
+// VDP
+int ZomgMem::loadVdpReg(uint8_t *reg, size_t siz)
+{
+	return loadBlock(BLOCK_VDP_REG, reg, siz);
+}
+
+int ZomgMem::loadVdpCtrl_8(Zomg_VDP_ctrl_8_t *ctrl)
+{
+	int ret = loadBlock(BLOCK_VDP_CTRL_8, ctrl, sizeof(*ctrl));
+	if (ret != (int)sizeof(*ctrl))
+		return -1;
+	if (ctrl->header != ZOMG_VDPCTRL_8_HEADER)
+		return -2;
+	return ret;
+}
+
+int ZomgMem::loadVdpCtrl_16(Zomg_VDP_ctrl_16_t *ctrl)
+{
+	int ret = loadBlock(BLOCK_VDP_CTRL_16, ctrl, sizeof(*ctrl));
+	if (ret != (int)sizeof(*ctrl))
+		return -1;
+	if (ctrl->header != ZOMG_VDPCTRL_16_HEADER)
+		return -2;
+	return ret;
+}
+
+int ZomgMem::loadVRam(void *vram, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return loadBlock(BLOCK_VRAM, vram, siz);
+}
+
+int ZomgMem::loadCRam(Zomg_CRam_t *cram, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return loadBlock(BLOCK_CRAM, cram, sizeof(*cram));
+}
+
+/// MD-specific
+int ZomgMem::loadMD_VSRam(uint16_t *vsram, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return loadBlock(BLOCK_MD_VSRAM, vsram, siz);
+}
+
+int ZomgMem::loadMD_VDP_SAT(uint16_t *vdp_sat, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return loadBlock(BLOCK_MD_VDP_SAT, vdp_sat, siz);
+}
+
+// Audio
+int ZomgMem::loadPsgReg(Zomg_PsgSave_t *state)
+{
+	return loadBlock(BLOCK_PSG_REG, state, sizeof(*state));
+}
+
+/// MD-specific
+int ZomgMem::loadMD_YM2612_reg(Zomg_Ym2612Save_t *state)
+{
+	return loadBlock(BLOCK_MD_YM2612_REG, state, sizeof(*state));
+}
+
+// Z80
+int ZomgMem::loadZ80Mem(uint8_t *mem, size_t siz)
+{
+	return loadBlock(BLOCK_Z80_MEM, mem, siz);
+}
+
+int ZomgMem::loadZ80Reg(Zomg_Z80RegSave_t *state)
+{
+	return loadBlock(BLOCK_Z80_REG, state, sizeof(*state));
+}
+
+// M68K (MD-specific)
+int ZomgMem::loadM68KMem(uint16_t *mem, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return loadBlock(BLOCK_M68K_MEM, mem, siz);
+}
+
+int ZomgMem::loadM68KReg(Zomg_M68KRegSave_t *state)
+{
+	return loadBlock(BLOCK_M68K_REG, state, sizeof(*state));
+}
+
+// MD-specific registers
+int ZomgMem::loadMD_IO(Zomg_MD_IoSave_t *state)
+{
+	return loadBlock(BLOCK_MD_IO, state, sizeof(*state));
+}
+
+int ZomgMem::loadMD_Z80Ctrl(Zomg_MD_Z80CtrlSave_t *state)
+{
+	return loadBlock(BLOCK_MD_Z80_CTRL, state, sizeof(*state));
+}
+
+int ZomgMem::loadMD_TimeReg(Zomg_MD_TimeReg_t *state)
+{
+	memset(state, 0xFF, sizeof(*state));
+	int ret = loadBlock(BLOCK_MD_TIME_REG, state, sizeof(*state));
+	if (ret <= 0xF1) {
+		// SRAM control register wasn't loaded.
+		// Set it to 2 by default. (See Zomg::loadMD_TimeReg().)
+		state->SRAM_ctrl = 2;
+	}
+	return ret;
+}
+
+int ZomgMem::loadMD_TMSS_reg(Zomg_MD_TMSS_reg_t *tmss)
+{
+	int ret = loadBlock(BLOCK_MD_TMSS_REG, tmss, sizeof(*tmss));
+	if (ret > 0 && tmss->header != ZOMG_MD_TMSS_REG_HEADER)
+		return -2;
+	return ret;
+}
+
+// Miscellaneous
+int ZomgMem::loadSRam(uint8_t *sram, size_t siz)
+{
+	int ret = loadBlock(BLOCK_SRAM, sram, siz);
+	if (ret > 0 && ret < (int)siz) {
+		// Set the rest of the SRAM buffer to 0xFF.
+		memset(&sram[ret], 0xFF, siz - ret);
+	}
+	return ret;
+}
+
+int ZomgMem::loadEEPRomCtrl(Zomg_EPR_ctrl_t *ctrl)
+{
+	int ret = loadBlock(BLOCK_EEPROM_CTRL, ctrl, sizeof(*ctrl));
+	if (ret < 8)
+		return -1;
+	if (ctrl->header != ZOMG_EPR_CTRL_HEADER)
+		return -2;
+	return ret;
+}
+
+int ZomgMem::loadEEPRomCache(uint8_t *cache, size_t siz)
+{
+	return loadBlock(BLOCK_EEPROM_CACHE, cache, siz);
+}
+
+int ZomgMem::loadEEPRom(uint8_t *eeprom, size_t siz)
+{
+	return loadBlock(BLOCK_EEPROM, eeprom, siz);
+}
+
+/** Save functions. **/
+
+// VDP
+int ZomgMem::saveVdpReg(const uint8_t *reg, size_t siz)
+{
+	return saveBlock(BLOCK_VDP_REG, reg, siz);
+}
+
+int ZomgMem::saveVdpCtrl_8(const Zomg_VDP_ctrl_8_t *ctrl)
+{
+	return saveBlock(BLOCK_VDP_CTRL_8, ctrl, sizeof(*ctrl));
+}
+
+int ZomgMem::saveVdpCtrl_16(const Zomg_VDP_ctrl_16_t *ctrl)
+{
+	return saveBlock(BLOCK_VDP_CTRL_16, ctrl, sizeof(*ctrl));
+}
+
+int ZomgMem::saveVRam(const void *vram, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return saveBlock(BLOCK_VRAM, vram, siz);
+}
+
+int ZomgMem::saveCRam(const Zomg_CRam_t *cram, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return saveBlock(BLOCK_CRAM, cram, sizeof(*cram));
+}
+
+/// MD-specific
+int ZomgMem::saveMD_VSRam(const uint16_t *vsram, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return saveBlock(BLOCK_MD_VSRAM, vsram, siz);
+}
+
+int ZomgMem::saveMD_VDP_SAT(const void *vdp_sat, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return saveBlock(BLOCK_MD_VDP_SAT, vdp_sat, siz);
+}
+
+// Audio
+int ZomgMem::savePsgReg(const Zomg_PsgSave_t *state)
+{
+	return saveBlock(BLOCK_PSG_REG, state, sizeof(*state));
+}
+
+/// MD-specific
+int ZomgMem::saveMD_YM2612_reg(const Zomg_Ym2612Save_t *state)
+{
+	return saveBlock(BLOCK_MD_YM2612_REG, state, sizeof(*state));
+}
+
+// Z80
+int ZomgMem::saveZ80Mem(const uint8_t *mem, size_t siz)
+{
+	return saveBlock(BLOCK_Z80_MEM, mem, siz);
+}
+
+int ZomgMem::saveZ80Reg(const Zomg_Z80RegSave_t *state)
+{
+	return saveBlock(BLOCK_Z80_REG, state, sizeof(*state));
+}
+
+// M68K (MD-specific)
+int ZomgMem::saveM68KMem(const uint16_t *mem, size_t siz, ZomgByteorder_t byteorder)
+{
+	((void)byteorder);
+	return saveBlock(BLOCK_M68K_MEM, mem, siz);
+}
+
+int ZomgMem::saveM68KReg(const Zomg_M68KRegSave_t *state)
+{
+	return saveBlock(BLOCK_M68K_REG, state, sizeof(*state));
+}
+
+// MD-specific registers
+int ZomgMem::saveMD_IO(const Zomg_MD_IoSave_t *state)
+{
+	return saveBlock(BLOCK_MD_IO, state, sizeof(*state));
+}
+
+int ZomgMem::saveMD_Z80Ctrl(const Zomg_MD_Z80CtrlSave_t *state)
+{
+	return saveBlock(BLOCK_MD_Z80_CTRL, state, sizeof(*state));
+}
+
+int ZomgMem::saveMD_TimeReg(const Zomg_MD_TimeReg_t *state)
+{
+	return saveBlock(BLOCK_MD_TIME_REG, state, sizeof(*state));
+}
+
+int ZomgMem::saveMD_TMSS_reg(const Zomg_MD_TMSS_reg_t *tmss)
+{
+	return saveBlock(BLOCK_MD_TMSS_REG, tmss, sizeof(*tmss));
+}
+
+// Miscellaneous
+int ZomgMem::saveSRam(const uint8_t *sram, size_t siz)
+{
+	return saveBlock(BLOCK_SRAM, sram, siz);
+}
+
+int ZomgMem::saveEEPRomCtrl(const Zomg_EPR_ctrl_t *ctrl)
+{
+	return saveBlock(BLOCK_EEPROM_CTRL, ctrl, sizeof(*ctrl));
+}
+
+int ZomgMem::saveEEPRomCache(const uint8_t *cache, size_t siz)
+{
+	return saveBlock(BLOCK_EEPROM_CACHE, cache, siz);
+}
+
+int ZomgMem::saveEEPRom(const uint8_t *eeprom, size_t siz)
+{
+	return saveBlock(BLOCK_EEPROM, eeprom, siz);
+}
+
+}
@@ -0,0 +1,243 @@
+/***************************************************************************
+ * libzomg: Zipped Original Memory from Genesis.                           *
+ * ZomgMem.hpp: In-memory savestate handler.                               *
+ *                                                                         *
+ * Copyright (c) 2015 by David Korth.                                      *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published by the   *
+ * Free Software Foundation; either version 2 of the License, or (at your  *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful, but     *
+ * WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.           *
+ ***************************************************************************/
+
+/**
+ * ZomgMem stores a savestate in a caller-supplied memory buffer.
+ * There is no compression, no file I/O, and no byteswapping:
+ * each block is stored in host byteorder, so a ZomgMem buffer
+ * must only be loaded by the same build that saved it.
+ *
+ * This is intended for short-lived snapshots, e.g. run-ahead
+ * and rewind. Use Zomg for savestates that are written to disk.
+ */
+
+#ifndef __LIBZOMG_ZOMGMEM_HPP__
+#define __LIBZOMG_ZOMGMEM_HPP__
+
+#include "ZomgBase.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stddef.h>
+
+namespace LibZomg {
+
+class ZomgMem : public ZomgBase
+{
+	public:
+		/**
+		 * System IDs.
+		 * Stored in the header so a snapshot from one
+		 * system can't be loaded into another system.
+		 */
+		enum SystemID {
+			SYSTEM_UNKNOWN	= 0,
+			SYSTEM_MD	= 0x4D442020,	/* 'MD  ' */
+			SYSTEM_PICO	= 0x5049434F,	/* 'PICO' */
+		};
+
+		/**
+		 * Open a memory buffer as a savestate.
+		 * ZOMG_SAVE: buf is written to. Existing contents are overwritten.
+		 * If buf is nullptr, nothing is written, but size() will
+		 * return the required buffer size after all blocks are saved.
+		 * ZOMG_LOAD: buf is only read from, and it must contain
+		 * a savestate created by ZomgMem. (const_cast is safe.)
+		 * @param buf Memory buffer.
+		 * @param siz Size of buf, in bytes.
+		 * @param mode ZOMG_LOAD or ZOMG_SAVE.
+		 * @param system System ID. Loading fails if this doesn't match the savestate.
+		 */
+		ZomgMem(void *buf, size_t siz, ZomgFileMode mode, SystemID system);
+		virtual ~ZomgMem();
+
+	private:
+		// Q_DISABLE_COPY() equivalent.
+		// TODO: Add LibZomg-specific version of Q_DISABLE_COPY().
+		ZomgMem(const ZomgMem &);
+		ZomgMem &operator=(const ZomgMem &);
+
+	public:
+		virtual void close(void) final;
+
+		/**
+		 * Block IDs.
+		 * Values are only meaningful within a single build.
+		 */
+		enum BlockID {
+			BLOCK_NONE = 0,
+
+			// VDP
+			BLOCK_VDP_REG,
+			BLOCK_VDP_CTRL_8,
+			BLOCK_VDP_CTRL_16,
+			BLOCK_VRAM,
+			BLOCK_CRAM,
+			BLOCK_MD_VSRAM,
+			BLOCK_MD_VDP_SAT,
+
+			// Audio
+			BLOCK_PSG_REG,
+			BLOCK_MD_YM2612_REG,
+
+			// Z80
+			BLOCK_Z80_MEM,
+			BLOCK_Z80_REG,
+
+			// M68K
+			BLOCK_M68K_MEM,
+			BLOCK_M68K_REG,
+
+			// MD-specific registers
+			BLOCK_MD_IO,
+			BLOCK_MD_Z80_CTRL,
+			BLOCK_MD_TIME_REG,
+			BLOCK_MD_TMSS_REG,
+
+			// Miscellaneous
+			BLOCK_SRAM,
+			BLOCK_EEPROM_CTRL,
+			BLOCK_EEPROM_CACHE,
+			BLOCK_EEPROM,
+
+			// Emulator-internal state.
+			// This is state that isn't part of the ZOMG format,
+			// e.g. sound chip envelopes and CPU interrupt lines.
+			// It's needed for bit-exact snapshots.
+			BLOCK_INT_VDP = 0x100,
+			BLOCK_INT_PSG,
+			BLOCK_INT_YM2612,
+			BLOCK_INT_M68K,
+		};
+
+		/**
+		 * Get the number of bytes used in the buffer.
+		 * ZOMG_SAVE: Bytes written so far, including the header.
+		 * ZOMG_LOAD: Size of the savestate.
+		 * @return Number of bytes used.
+		 */
+		inline size_t size(void) const
+			{ return m_pos; }
+
+		/**
+		 * Save a block.
+		 * @param id Block ID.
+		 * @param data Block data.
+		 * @param siz Size of data, in bytes.
+		 * @return 0 on success; negative errno on error.
+		 */
+		int saveBlock(BlockID id, const void *data, size_t siz);
+
+		/**
+		 * Load a block.
+		 * If the stored block is larger than siz, only siz bytes are loaded.
+		 * @param id Block ID.
+		 * @param data Block data buffer.
+		 * @param siz Size of data, in bytes.
+		 * @return Bytes read on success; negative errno on error.
+		 */
+		int loadBlock(BlockID id, void *data, size_t siz);
+
+		/** Load functions. **/
+
+		// VDP
+		virtual int loadVdpReg(uint8_t *reg, size_t siz) final;
+		virtual int loadVdpCtrl_8(_Zomg_VDP_ctrl_8_t *ctrl) final;
+		virtual int loadVdpCtrl_16(_Zomg_VDP_ctrl_16_t *ctrl) final;
+		virtual int loadVRam(void *vram, size_t siz, ZomgByteorder_t byteorder) final;
+		virtual int loadCRam(_Zomg_CRam_t *cram, ZomgByteorder_t byteorder) final;
+		/// MD-specific
+		virtual int loadMD_VSRam(uint16_t *vsram, size_t siz, ZomgByteorder_t byteorder) final;
+		virtual int loadMD_VDP_SAT(uint16_t *vdp_sat, size_t siz, ZomgByteorder_t byteorder) final;
+
+		// Audio
+		virtual int loadPsgReg(_Zomg_PsgSave_t *state) final;
+		/// MD-specific
+		virtual int loadMD_YM2612_reg(_Zomg_Ym2612Save_t *state) final;
+
+		// Z80
+		virtual int loadZ80Mem(uint8_t *mem, size_t siz) final;
+		virtual int loadZ80Reg(_Zomg_Z80RegSave_t *state) final;
+
+		// M68K (MD-specific)
+		virtual int loadM68KMem(uint16_t *mem, size_t siz, ZomgByteorder_t byteorder) final;
+		virtual int loadM68KReg(_Zomg_M68KRegSave_t *state) final;
+
+		// MD-specific registers
+		virtual int loadMD_IO(_Zomg_MD_IoSave_t *state) final;
+		virtual int loadMD_Z80Ctrl(_Zomg_MD_Z80CtrlSave_t *state) final;
+		virtual int loadMD_TimeReg(_Zomg_MD_TimeReg_t *state) final;
+		virtual int loadMD_TMSS_reg(_Zomg_MD_TMSS_reg_t *tmss) final;
+
+		// Miscellaneous
+		virtual int loadSRam(uint8_t *sram, size_t siz) final;
+		virtual int loadEEPRomCtrl(_Zomg_EPR_ctrl_t *ctrl) final;
+		virtual int loadEEPRomCache(uint8_t *cache, size_t siz) final;
+		virtual int loadEEPRom(uint8_t *eeprom, size_t siz) final;
+
+		/** Save functions. **/
+
+		// VDP
+		virtual int saveVdpReg(const uint8_t *reg, size_t siz) final;
+		virtual int saveVdpCtrl_8(const _Zomg_VDP_ctrl_8_t *ctrl) final;
+		virtual int saveVdpCtrl_16(const _Zomg_VDP_ctrl_16_t *ctrl) final;
+		virtual int saveVRam(const void *vram, size_t siz, ZomgByteorder_t byteorder) final;
+		virtual int saveCRam(const _Zomg_CRam_t *cram, ZomgByteorder_t byteorder) final;
+		/// MD-specific
+		virtual int saveMD_VSRam(const uint16_t *vsram, size_t siz, ZomgByteorder_t byteorder) final;
+		virtual int saveMD_VDP_SAT(const void *vdp_sat, size_t siz, ZomgByteorder_t byteorder) final;
+
+		// Audio
+		virtual int savePsgReg(const _Zomg_PsgSave_t *state) final;
+		/// MD-specific
+		virtual int saveMD_YM2612_reg(const _Zomg_Ym2612Save_t *state) final;
+
+		// Z80
+		virtual int saveZ80Mem(const uint8_t *mem, size_t siz) final;
+		virtual int saveZ80Reg(const _Zomg_Z80RegSave_t *state) final;
+
+		// M68K (MD-specific)
+		virtual int saveM68KMem(const uint16_t *mem, size_t siz, ZomgByteorder_t byteorder) final;
+		virtual int saveM68KReg(const _Zomg_M68KRegSave_t *state) final;
+
+		// MD-specific registers
+		virtual int saveMD_IO(const _Zomg_MD_IoSave_t *state) final;
+		virtual int saveMD_Z80Ctrl(const _Zomg_MD_Z80CtrlSave_t *state) final;
+		virtual int saveMD_TimeReg(const _Zomg_MD_TimeReg_t *state) final;
+		virtual int saveMD_TMSS_reg(const _Zomg_MD_TMSS_reg_t *tmss) final;
+
+		// Miscellaneous
+		virtual int saveSRam(const uint8_t *sram, size_t siz) final;
+		virtual int saveEEPRomCtrl(const _Zomg_EPR_ctrl_t *ctrl) final;
+		virtual int saveEEPRomCache(const uint8_t *cache, size_t siz) final;
+		virtual int saveEEPRom(const uint8_t *eeprom, size_t siz) final;
+
+	protected:
+		uint8_t *m_buf;		// Memory buffer.
+		size_t m_siz;		// Size of m_buf.
+		size_t m_pos;		// End of the last block.
+		size_t m_cur;		// ZOMG_LOAD: Next block to check.
+		SystemID m_system;	// System ID.
+};
+
+}
+
+#endif /* __LIBZOMG_ZOMGMEM_HPP__ */